@@ -0,0 +1,121 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+#include "FileSource.h"
+
+namespace ResourceLoader {
+
+enum class AssetKind : uint32_t {
+  kMesh,
+  kTexture,
+  kCount,
+};
+
+// One loaded form of some file contents. Paths with the same bytes share an
+// asset; variant keeps apart forms built differently from the same bytes,
+// such as a mesh in two vertex layouts or a texture filtered as color and as
+// a normal map.
+struct AssetKey {
+  AssetKind kind = AssetKind::kMesh;
+  uint64_t content_hash = 0;
+  uint32_t variant = 0;
+};
+
+auto operator<(const AssetKey &lhs, const AssetKey &rhs) -> bool;
+
+struct AssetRegistryStats {
+  uint64_t hits = 0;
+  uint64_t misses = 0;
+  size_t resident_count = 0;
+  uint64_t resident_bytes = 0;
+};
+
+// Lower case, '/' separators, no "." or "dir/.." segments.
+auto NormalizeAssetPath(const std::wstring &path) -> std::wstring;
+
+auto HashAssetContent(const uint8_t *data, size_t size) -> uint64_t;
+
+// Hands out shared, reference-counted assets and loads each one once, however
+// many models ask for it. The registry only holds weak references: an asset
+// is freed with its last handle and loaded again when next asked for.
+//
+// Knows nothing about the GPU; loaders passed to Acquire do the uploads.
+class AssetRegistry {
+public:
+  AssetRegistry();
+
+  AssetRegistry(const AssetRegistry &rhs) = delete;
+
+  auto operator=(const AssetRegistry &rhs) -> AssetRegistry & = delete;
+
+  ~AssetRegistry() = default;
+
+  static auto Instance() -> AssetRegistry &;
+
+  // Hash of the file at path, read through file_source. Remembered per
+  // normalized path until the file's stamp changes, so asking again costs a
+  // stamp query rather than a read.
+  auto GetContentHash(FileSource &file_source, const std::wstring &path,
+                      uint64_t &hash) -> bool;
+
+  // Returns the asset for key, running load on the first request. load fills
+  // in the bytes the asset keeps resident and returns null on failure, which
+  // is not remembered. Concurrent requests for a key that is loading wait for
+  // that load instead of starting their own.
+  template <typename T>
+  auto Acquire(const AssetKey &key,
+               const std::function<std::shared_ptr<T>(size_t &)> &load)
+      -> std::shared_ptr<const T> {
+    return std::static_pointer_cast<const T>(
+        AcquireErased(key, [&load](size_t &resident_bytes) {
+          return std::shared_ptr<const void>(load(resident_bytes));
+        }));
+  }
+
+  auto GetStats(AssetKind kind) const -> AssetRegistryStats;
+
+  void LogStats() const;
+
+private:
+  using ErasedLoader =
+      std::function<std::shared_ptr<const void>(size_t &resident_bytes)>;
+
+  struct Entry {
+    std::weak_ptr<const void> asset = {};
+    bool is_loading = false;
+  };
+
+  struct PathHash {
+    FileStamp stamp = {};
+    uint64_t hash = 0;
+  };
+
+  // Outlives the registry while handles are alive, so releasing one late
+  // never touches a destroyed registry.
+  struct State {
+    std::mutex mutex;
+    std::condition_variable loaded;
+    std::map<AssetKey, Entry> entries;
+    std::unordered_map<std::wstring, PathHash> path_hashes;
+    AssetRegistryStats stats[static_cast<size_t>(AssetKind::kCount)];
+  };
+
+  auto AcquireErased(const AssetKey &key, const ErasedLoader &load)
+      -> std::shared_ptr<const void>;
+
+  static void Release(const std::weak_ptr<State> &weak_state,
+                      const AssetKey &key, size_t resident_bytes);
+
+  std::shared_ptr<State> state_ = nullptr;
+};
+
+} // namespace ResourceLoader
@@ -0,0 +1,143 @@
+#pragma once
+
+#include <condition_variable>
+#include <coroutine>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "FileSource.h"
+#include "MeshFile.h"
+#include "Task.h"
+
+class JobSystem;
+
+namespace ResourceLoader {
+
+// Runs asset loading as coroutines.
+//
+// A load co_awaits ResumeInBackground() for file reads, parsing and uploads,
+// then ResumeOnMainThread() to publish the result. Main-thread continuations
+// only run inside PumpMainThread(), which the renderer calls between frames,
+// so a renderable never changes while passes are being recorded. Loads are
+// started with Spawn() and drained with WaitIdle().
+class AssetStreamer {
+public:
+  AssetStreamer(FileSource &file_source, JobSystem &job_system);
+
+  AssetStreamer(const AssetStreamer &rhs) = delete;
+
+  auto operator=(const AssetStreamer &rhs) -> AssetStreamer & = delete;
+
+  ~AssetStreamer() = default;
+
+  // Disk-backed streamer on a small pool of its own, so a frame's
+  // JobSystem::Wait on the main thread never ends up running a file read.
+  static auto Instance() -> AssetStreamer &;
+
+  class BackgroundAwaiter {
+  public:
+    explicit BackgroundAwaiter(JobSystem &job_system)
+        : job_system_(job_system) {}
+
+    auto await_ready() const -> bool;
+
+    void await_suspend(std::coroutine_handle<> handle) const;
+
+    void await_resume() const noexcept {}
+
+  private:
+    JobSystem &job_system_;
+  };
+
+  class MainThreadAwaiter {
+  public:
+    explicit MainThreadAwaiter(AssetStreamer &streamer)
+        : streamer_(streamer) {}
+
+    auto await_ready() const noexcept -> bool { return false; }
+
+    void await_suspend(std::coroutine_handle<> handle) const;
+
+    void await_resume() const noexcept {}
+
+  private:
+    AssetStreamer &streamer_;
+  };
+
+  auto GetFileSource() -> FileSource & { return file_source_; }
+
+  // The streaming pool, for loads that split their own work into jobs.
+  auto GetJobSystem() -> JobSystem & { return job_system_; }
+
+  auto ResumeInBackground() -> BackgroundAwaiter {
+    return BackgroundAwaiter(job_system_);
+  }
+
+  auto ResumeOnMainThread() -> MainThreadAwaiter {
+    return MainThreadAwaiter(*this);
+  }
+
+  // Empty data when the file cannot be read.
+  auto ReadFile(std::wstring path) -> Task<FileData>;
+
+  // Same cache rules as OpenCookedMesh, but through the file source: uses the
+  // .mesh next to text_path when it is current, otherwise cooks the text
+  // source in memory and tries to refresh the cache. Null on failure.
+  auto LoadMesh(std::wstring text_path) -> Task<std::unique_ptr<MeshFile>>;
+
+  // LoadMesh for code already running on a streaming worker.
+  auto ReadMesh(const std::wstring &text_path) -> std::unique_ptr<MeshFile>;
+
+  // Starts task and lets it run to completion on its own.
+  void Spawn(Task<void> task);
+
+  // Resumes the coroutines waiting for the main thread. Call once per frame
+  // from the thread that owns the renderables.
+  void PumpMainThread();
+
+  // Main thread only. Blocks until every spawned task has finished, pumping
+  // main-thread continuations meanwhile.
+  void WaitIdle();
+
+  auto GetPendingTaskCount() const -> size_t;
+
+private:
+  struct DetachedTask {
+    struct promise_type {
+      auto get_return_object() const noexcept -> DetachedTask { return {}; }
+
+      auto initial_suspend() const noexcept -> std::suspend_never {
+        return {};
+      }
+
+      auto final_suspend() const noexcept -> std::suspend_never { return {}; }
+
+      void return_void() const noexcept {}
+
+      void unhandled_exception() const noexcept { std::terminate(); }
+    };
+  };
+
+  static auto RunDetached(AssetStreamer *streamer, Task<void> task)
+      -> DetachedTask;
+
+  void FinishTask();
+
+  FileSource &file_source_;
+
+  JobSystem &job_system_;
+
+  mutable std::mutex mutex_;
+
+  std::condition_variable idle_;
+
+  std::vector<std::coroutine_handle<>> main_thread_queue_ = {};
+
+  size_t pending_tasks_ = 0;
+};
+
+} // namespace ResourceLoader
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "MipGenerator.h"
+
+class JobSystem;
+
+namespace ResourceLoader {
+
+enum class BlockFormat {
+  kBC1, // RGB, 4 bpp
+  kBC3, // RGB + separate alpha, 8 bpp
+  kBC4, // one channel, 4 bpp
+  kBC5, // two channels, 8 bpp
+  kBC7, // RGBA, 8 bpp
+};
+
+enum class CompressionQuality {
+  // Bounding-box endpoints, no refinement.
+  kFast,
+  // Principal-axis endpoints refined by least squares.
+  kBalanced,
+  // More refinement, the BC4 six-value mode and the two-subset BC7 mode.
+  kHigh,
+};
+
+// Bytes per 4x4 block.
+auto GetBlockSize(BlockFormat format) -> size_t;
+
+auto GetCompressedSize(uint32_t width, uint32_t height, BlockFormat format)
+    -> size_t;
+
+// BC7 for color, BC5 for normal maps. Data textures get BC4 when they are
+// grey and opaque, BC1 when they are opaque and BC3 otherwise.
+auto SelectBlockFormat(TextureUsage usage, const uint8_t *pixels,
+                       uint32_t width, uint32_t height) -> BlockFormat;
+
+// Compresses one tightly packed width x height RGBA8 image, block rows top
+// to bottom. Edge blocks repeat the last column and row. BC4 stores channel 0
+// and BC5 channels 0 and 1. Large images are split across job_system by
+// block rows.
+auto CompressImage(JobSystem &job_system, const uint8_t *pixels,
+                   uint32_t width, uint32_t height, BlockFormat format,
+                   CompressionQuality quality, uint8_t *blocks,
+                   bool allow_parallel = true) -> bool;
+
+} // namespace ResourceLoader
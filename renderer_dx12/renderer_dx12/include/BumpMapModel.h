@@ -5,10 +5,17 @@
 #include <vector>
 
 #include "BumpMapMaterial.h"
+#include "ModelAssets.h"
 #include "TextureLoader.h"
 
 class DirectX12Device;
 
+namespace ResourceLoader {
+
+class MeshFile;
+
+} // namespace ResourceLoader
+
 class BumpMapModel {
 public:
   explicit BumpMapModel(std::shared_ptr<DirectX12Device> device);
@@ -17,88 +24,47 @@ public:
 
   auto operator=(const BumpMapModel &rhs) -> BumpMapModel & = delete;
 
-  ~BumpMapModel();
+  ~BumpMapModel() = default;
 
+  // Returns with placeholders in place; the real mesh and textures stream in.
   auto Initialize(WCHAR *model_filename, WCHAR **texture_filename_arr,
                   unsigned int texture_count) -> bool;
 
-  auto GetIndexCount() const -> UINT { return index_count_; }
+  auto GetIndexCount() const -> UINT { return mesh_->index_count; }
+
+  auto GetWorldBounds(const DirectX::XMMATRIX &world) const
+      -> BoundingVolume {
+    return ComputeWorldBounds(*mesh_, world);
+  }
 
   auto GetVertexBufferView() const -> const D3D12_VERTEX_BUFFER_VIEW & {
-    return vertex_buffer_view_;
+    return mesh_->vertex_buffer_view;
   }
 
   auto GetIndexBufferView() const -> const D3D12_INDEX_BUFFER_VIEW & {
-    return index_buffer_view_;
+    return mesh_->index_buffer_view;
   }
 
   auto GetMaterial() -> BumpMapMaterial * { return &material_; }
 
-  auto GetShaderResourceView() const -> DescriptorHeapPtr;
+  auto GetShaderResourceView() const -> D3D12_GPU_DESCRIPTOR_HANDLE;
 
 private:
   struct VertexType {
     DirectX::XMFLOAT3 position;
     DirectX::XMFLOAT2 texcoord;
     DirectX::XMFLOAT3 normal;
-    DirectX::XMFLOAT3 tangent;
-    DirectX::XMFLOAT3 binormal;
-  };
-
-  struct ModelType {
-    float x, y, z;
-    float tu, tv;
-    float nx, ny, nz;
-    float tx, ty, tz;
-    float bx, by, bz;
-  };
-
-  struct TempVertexType {
-    float x, y, z;
-    float tu, tv;
-    float nx, ny, nz;
-  };
-
-  struct VectorType {
-    float x, y, z;
+    DirectX::XMFLOAT4 tangent; // w = bitangent handedness
   };
 
-  auto LoadModel(WCHAR *filename) -> bool;
-
-  auto ReleaseModel() -> void;
-
-  auto InitializeBuffers() -> bool;
-
-  auto LoadTextures(WCHAR **texture_filename_arr, unsigned int texture_count)
-      -> bool;
-
-  void CalculateModelVectors();
-
-  void CalculateTangentBinormal(const TempVertexType &vertex1,
-                                const TempVertexType &vertex2,
-                                const TempVertexType &vertex3,
-                                VectorType &tangent, VectorType &binormal);
-
-  void CalculateNormal(const VectorType &tangent, const VectorType &binormal,
-                       VectorType &normal);
+  auto BuildMeshBuffers(const ResourceLoader::MeshFile &mesh,
+                        MeshBuffers &buffers) const -> bool;
 
   std::shared_ptr<DirectX12Device> device_;
 
   BumpMapMaterial material_;
 
-  ResourceSharedPtr vertex_buffer_ = nullptr;
-  
-  ResourceSharedPtr index_buffer_ = nullptr;
-
-  D3D12_VERTEX_BUFFER_VIEW vertex_buffer_view_ = {};
-  
-  D3D12_INDEX_BUFFER_VIEW index_buffer_view_ = {};
-
-  UINT vertex_count_ = 0;
-  
-  UINT index_count_ = 0;
-
-  ModelType *model_data_ = nullptr;
+  MeshHandle mesh_ = nullptr;
 
   std::shared_ptr<ResourceLoader::TextureLoader> texture_loader_ = nullptr;
 };
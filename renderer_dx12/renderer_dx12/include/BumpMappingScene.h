@@ -41,9 +41,14 @@ public:
 
   void SetRotationAngle(float radians);
 
+  // At the current rotation; empty until Initialize succeeds.
+  auto GetWorldBounds() const -> BoundingVolume;
+
 private:
   auto EnsureShadersLoaded() -> bool;
 
+  auto GetWorldMatrix() const -> DirectX::XMMATRIX;
+
   std::shared_ptr<DirectX12Device> device_;
 
   std::shared_ptr<ResourceLoader::ShaderLoader> shader_loader_;
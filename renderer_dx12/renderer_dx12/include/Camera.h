@@ -2,6 +2,9 @@
 
 #include <DirectXMath.h>
 
+#include "FrustumCulling.h"
+#include "SceneBvh.h"
+
 class Camera {
 public:
   Camera() { Construct2DViewMatrix(); }
@@ -44,6 +47,17 @@ public:
 
   void UpdateReflection(float height);
 
+  // Culling planes of view * projection; pass GetViewMatrix() or
+  // GetReflectionViewMatrix() for the camera's own views.
+  static auto BuildFrustumPlanes(const DirectX::XMMATRIX &view,
+                                 const DirectX::XMMATRIX &projection)
+      -> FrustumPlanes;
+
+  // World-space ray from the near plane through the center of a pixel, for
+  // picking. The direction spans the view depth and is not normalized.
+  auto ScreenPointToRay(int x, int y, int screen_width, int screen_height,
+                        const DirectX::XMMATRIX &projection) const -> Ray;
+
   auto GetReflectionViewMatrix() const -> DirectX::XMMATRIX {
     return reflection_view_matrix_;
   }
@@ -0,0 +1,206 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "FrustumCulling.h"
+
+namespace Lighting {
+
+// One point or spot light as the clustered shaders read it, in world space.
+// Matches ClusterLight in light.hlsl and pbr.hlsl.
+struct ClusterLightData {
+  float position[3] = {};
+  // Light reaches exactly this far; the shaders fade it out before.
+  float range = 0.0f;
+  // Unit vector the spot points along, zero for point lights.
+  float direction[3] = {};
+  // Cosines of the spot's outer and inner half-angles; -1 for point lights.
+  float spot_cos_outer = -1.0f;
+  // Color times intensity.
+  float color[3] = {};
+  float spot_cos_inner = -1.0f;
+  // Constant, linear and quadratic terms.
+  float attenuation[3] = {1.0f, 0.0f, 0.0f};
+  float padding = 0.0f;
+};
+
+// Where a cluster's lights start in the light index list, and how many
+// there are. uint2 in the shaders.
+struct ClusterRange {
+  uint32_t offset = 0;
+  uint32_t count = 0;
+};
+
+// cbuffer ClusterBuffer in light.hlsl and pbr.hlsl. A pixel's cluster is
+// its tile, pixel * tile_scale, and its slice,
+// log(view depth) * depth_scale + depth_bias.
+struct ClusterConstants {
+  uint32_t tiles_x = 0;
+  uint32_t tiles_y = 0;
+  uint32_t slices = 0;
+  uint32_t light_count = 0;
+  float tile_scale_x = 0.0f;
+  float tile_scale_y = 0.0f;
+  float depth_scale = 0.0f;
+  float depth_bias = 0.0f;
+};
+
+struct ClusterGridConfig {
+  // Screen tiles across and down.
+  uint32_t tiles_x = 16;
+  uint32_t tiles_y = 9;
+  // Depth slices, spaced exponentially between near_z and far_z.
+  uint32_t slices = 24;
+  float near_z = 0.1f;
+  float far_z = 1000.0f;
+  // Caps the shaders' loop; lights past it are dropped from the cluster.
+  uint32_t max_lights_per_cluster = 128;
+};
+
+// Point and spot lights binned into view-space froxels, the clusters of a
+// screen tile and depth slice, on the CPU.
+//
+// Build walks the slices, then the rows of each slice, then the clusters of
+// each row, narrowing a copy of the light list at every step, so each
+// light is only tested against clusters near it. The tests run on eight
+// lights at a time. A light's sphere must reach into the cluster's planes
+// and bounding sphere, and a spot's cone must reach the bounding sphere.
+// Clusters near the frustum edges may keep a light that just misses them.
+class ClusteredLightGrid {
+public:
+  explicit ClusteredLightGrid(const ClusterGridConfig &config = {});
+
+  ClusteredLightGrid(const ClusteredLightGrid &rhs) = delete;
+
+  auto operator=(const ClusteredLightGrid &rhs)
+      -> ClusteredLightGrid & = delete;
+
+  ~ClusteredLightGrid() = default;
+
+  void SetConfig(const ClusterGridConfig &config);
+
+  auto GetConfig() const -> const ClusterGridConfig & { return config_; }
+
+  void ClearLights();
+
+  auto AddLight(const ClusterLightData &light) -> uint32_t;
+
+  auto GetLights() const -> const std::vector<ClusterLightData> & {
+    return lights_;
+  }
+
+  // view and projection are row-major for row vectors, as DirectXMath stores
+  // them before the transpose for the shaders; projection is perspective.
+  // The screen size only goes into the shader constants.
+  void Build(const float view[16], const float projection[16],
+             uint32_t screen_width, uint32_t screen_height,
+             CullingPath path = CullingPath::kAuto);
+
+  // Indices into GetLights(), grouped by cluster.
+  auto GetLightIndices() const -> const std::vector<uint32_t> & {
+    return light_indices_;
+  }
+
+  // One per cluster, ordered by GetClusterIndex.
+  auto GetClusterRanges() const -> const std::vector<ClusterRange> & {
+    return cluster_ranges_;
+  }
+
+  auto GetConstants() const -> const ClusterConstants & {
+    return constants_;
+  }
+
+  auto GetClusterCount() const -> size_t { return cluster_ranges_.size(); }
+
+  // Tile rows count down from the top of the screen.
+  auto GetClusterIndex(uint32_t tile_x, uint32_t tile_y,
+                       uint32_t slice) const -> uint32_t {
+    return (slice * config_.tiles_y + tile_y) * config_.tiles_x + tile_x;
+  }
+
+  // Light assignments the last Build dropped at max_lights_per_cluster.
+  auto GetOverflowCount() const -> size_t { return overflow_count_; }
+
+private:
+  // View-space light bounds, one stream per component, padded to the lane
+  // count with lights that fail every test.
+  struct LightStream {
+    std::vector<float> x = {};
+    std::vector<float> y = {};
+    std::vector<float> z = {};
+    std::vector<float> radius = {};
+    std::vector<float> direction_x = {};
+    std::vector<float> direction_y = {};
+    std::vector<float> direction_z = {};
+    std::vector<float> cos_outer = {};
+    std::vector<float> sin_outer = {};
+    std::vector<uint32_t> light = {};
+
+    size_t count = 0;
+
+    void Resize(size_t capacity);
+
+    void CopyLane(const LightStream &source, size_t from);
+
+    void Pad();
+  };
+
+  // ax + by + cz + d >= 0 inside, normalized.
+  struct Plane {
+    float a = 0.0f;
+    float b = 0.0f;
+    float c = 0.0f;
+    float d = 0.0f;
+  };
+
+  struct Sphere {
+    float x = 0.0f;
+    float y = 0.0f;
+    float z = 0.0f;
+    float radius = 0.0f;
+  };
+
+  // Planes, slice depths and cluster spheres, kept until the projection or
+  // the config changes.
+  void UpdateGeometry(const float projection[16]);
+
+  void TransformLights(const float view[16]);
+
+  std::vector<ClusterLightData> lights_ = {};
+
+  ClusterGridConfig config_ = {};
+
+  bool geometry_valid_ = false;
+
+  float geometry_projection_[16] = {};
+
+  std::vector<float> slice_depths_ = {};
+
+  // Per column, the left plane then the right; per row, top then bottom.
+  std::vector<Plane> column_planes_ = {};
+
+  std::vector<Plane> row_planes_ = {};
+
+  std::vector<Sphere> cluster_spheres_ = {};
+
+  LightStream view_lights_ = {};
+
+  LightStream slice_lights_ = {};
+
+  LightStream row_lights_ = {};
+
+  // One bit per lane that passed, a byte per group of lanes.
+  std::vector<uint8_t> group_masks_ = {};
+
+  std::vector<uint32_t> light_indices_ = {};
+
+  std::vector<ClusterRange> cluster_ranges_ = {};
+
+  ClusterConstants constants_ = {};
+
+  size_t overflow_count_ = 0;
+};
+
+} // namespace Lighting
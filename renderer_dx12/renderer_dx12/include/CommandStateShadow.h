@@ -0,0 +1,152 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+enum class ShadowedCommand : uint32_t {
+  kRootSignature = 0,
+  kPipelineState,
+  kDescriptorHeaps,
+  kRootDescriptorTable,
+  kRootConstantBufferView,
+  kRootShaderResourceView,
+  kVertexBuffers,
+  kIndexBuffer,
+  kCount,
+};
+
+constexpr size_t kShadowedCommandCount =
+    static_cast<size_t>(ShadowedCommand::kCount);
+
+// Calls that reached the command list and calls dropped as redundant, by
+// kind.
+struct CommandRecorderStats {
+  uint64_t issued[kShadowedCommandCount] = {};
+  uint64_t elided[kShadowedCommandCount] = {};
+
+  auto GetIssued(ShadowedCommand command) const -> uint64_t {
+    return issued[static_cast<size_t>(command)];
+  }
+
+  auto GetElided(ShadowedCommand command) const -> uint64_t {
+    return elided[static_cast<size_t>(command)];
+  }
+
+  auto GetTotalIssued() const -> uint64_t;
+
+  auto GetTotalElided() const -> uint64_t;
+
+  void Add(const CommandRecorderStats &other);
+};
+
+// D3D12_VERTEX_BUFFER_VIEW and D3D12_INDEX_BUFFER_VIEW without the headers.
+struct ShadowVertexBuffer {
+  uint64_t location = 0;
+  uint32_t size = 0;
+  uint32_t stride = 0;
+};
+
+struct ShadowIndexBuffer {
+  uint64_t location = 0;
+  uint32_t size = 0;
+  uint32_t format = 0;
+};
+
+// State bound on one command list, mirrored on the CPU.
+//
+// Each Set call reports whether it changes what is bound, in which case the
+// caller forwards it to the command list, and counts it as issued or elided.
+// Nothing is known after Reset, so the first call of each kind is always
+// issued. A root signature change forgets every root argument, as D3D12
+// does; a descriptor heap change forgets the descriptor tables, which
+// point into the old heaps. Objects are compared by address, which is
+// exact while the PipelineCache hands out one object per description.
+// Not thread-safe; one per command list.
+class CommandStateShadow {
+public:
+  // Root arguments past this index are never elided.
+  static constexpr uint32_t kMaxRootParameters = 64;
+
+  static constexpr uint32_t kMaxVertexBuffers = 16;
+
+  static constexpr uint32_t kMaxDescriptorHeaps = 2;
+
+  CommandStateShadow() = default;
+
+  CommandStateShadow(const CommandStateShadow &rhs) = default;
+
+  auto operator=(const CommandStateShadow &rhs)
+      -> CommandStateShadow & = default;
+
+  ~CommandStateShadow() = default;
+
+  // Forgets the bound state, for a command list that was just reset. Keeps
+  // the counters.
+  void Reset();
+
+  auto SetRootSignature(const void *root_signature) -> bool;
+
+  auto SetPipelineState(const void *pipeline_state) -> bool;
+
+  auto SetDescriptorHeaps(uint32_t count, const void *const *heaps) -> bool;
+
+  auto SetRootDescriptorTable(uint32_t index, uint64_t base_descriptor)
+      -> bool;
+
+  auto SetRootConstantBufferView(uint32_t index, uint64_t buffer_location)
+      -> bool;
+
+  auto SetRootShaderResourceView(uint32_t index, uint64_t buffer_location)
+      -> bool;
+
+  // Issued when any of the count views differs; views may be null, which
+  // unbinds the slots.
+  auto SetVertexBuffers(uint32_t start_slot, uint32_t count,
+                        const ShadowVertexBuffer *views) -> bool;
+
+  // Null unbinds the index buffer.
+  auto SetIndexBuffer(const ShadowIndexBuffer *view) -> bool;
+
+  auto GetStats() const -> const CommandRecorderStats & { return stats_; }
+
+  // Returns the counters gathered since the last call and clears them.
+  auto TakeStats() -> CommandRecorderStats;
+
+private:
+  enum class RootArgumentKind : uint32_t {
+    kUnknown = 0,
+    kDescriptorTable,
+    kConstantBufferView,
+    kShaderResourceView,
+  };
+
+  struct RootArgument {
+    RootArgumentKind kind = RootArgumentKind::kUnknown;
+    uint64_t value = 0;
+  };
+
+  auto Count(ShadowedCommand command, bool issued) -> bool;
+
+  auto SetRootArgument(ShadowedCommand command, RootArgumentKind kind,
+                       uint32_t index, uint64_t value) -> bool;
+
+  bool root_signature_known_ = false;
+  const void *root_signature_ = nullptr;
+
+  bool pipeline_state_known_ = false;
+  const void *pipeline_state_ = nullptr;
+
+  bool descriptor_heaps_known_ = false;
+  uint32_t descriptor_heap_count_ = 0;
+  const void *descriptor_heaps_[kMaxDescriptorHeaps] = {};
+
+  RootArgument root_arguments_[kMaxRootParameters] = {};
+
+  bool vertex_buffer_known_[kMaxVertexBuffers] = {};
+  ShadowVertexBuffer vertex_buffers_[kMaxVertexBuffers] = {};
+
+  bool index_buffer_known_ = false;
+  ShadowIndexBuffer index_buffer_ = {};
+
+  CommandRecorderStats stats_ = {};
+};
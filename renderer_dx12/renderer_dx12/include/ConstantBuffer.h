@@ -1,23 +1,26 @@
 #pragma once
 
-#include <cstring>
 #include <memory>
 
 #include "DirectX12Device.h"
-#include "d3dx12.h"
 #include "TypeDefine.h"
 
+// Typed view of per-draw constant data. Every Update() writes a fresh
+// 256-byte-aligned slice of the current frame's constant memory, so the
+// address returned by GetGPUVirtualAddress() is only valid for the frame the
+// data was written in, and several draws in one frame can each see their own
+// values. The owning material keeps the device alive.
 template <typename T>
 class ConstantBuffer {
 public:
   ConstantBuffer() = default;
 
   ConstantBuffer(const ConstantBuffer &) = delete;
-  
+
   auto operator=(const ConstantBuffer &) -> ConstantBuffer & = delete;
 
   ConstantBuffer(ConstantBuffer &&) noexcept = default;
-  
+
   auto operator=(ConstantBuffer &&) noexcept -> ConstantBuffer & = default;
 
   ~ConstantBuffer() = default;
@@ -27,49 +30,32 @@ public:
       return false;
     }
 
-    auto d3d_device = device->GetD3d12Device();
-    if (!d3d_device) {
-      return false;
-    }
-
-    if (FAILED(d3d_device->CreateCommittedResource(
-            &CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD),
-            D3D12_HEAP_FLAG_NONE,
-            &CD3DX12_RESOURCE_DESC::Buffer(CBSIZE(T)),
-            D3D12_RESOURCE_STATE_GENERIC_READ, nullptr,
-            IID_PPV_ARGS(&resource_)))) {
-      return false;
-    }
-
-    std::memset(&data_, 0, sizeof(T));
+    device_ = device.get();
+    data_ = {};
+    gpu_address_ = 0;
     return true;
   }
 
   auto Update(const T &data) -> bool {
-    if (!resource_) {
-      return false;
-    }
-
-    UINT8 *mapped_data = nullptr;
-    if (FAILED(resource_->Map(0, nullptr,
-                              reinterpret_cast<void **>(&mapped_data)))) {
+    if (!device_) {
       return false;
     }
 
     data_ = data;
-    std::memcpy(mapped_data, &data_, sizeof(T));
-    resource_->Unmap(0, nullptr);
-    return true;
+    return device_->WriteFrameConstants(&data_, sizeof(T), gpu_address_);
   }
 
-  auto GetResource() const -> ResourceSharedPtr { return resource_; }
+  // 0 until the first Update().
+  auto GetGPUVirtualAddress() const -> D3D12_GPU_VIRTUAL_ADDRESS {
+    return gpu_address_;
+  }
 
   auto GetData() const -> const T & { return data_; }
 
 private:
-  ResourceSharedPtr resource_ = nullptr;
-  
-  T data_ = {};
-};
+  DirectX12Device *device_ = nullptr;
 
+  D3D12_GPU_VIRTUAL_ADDRESS gpu_address_ = 0;
 
+  T data_ = {};
+};
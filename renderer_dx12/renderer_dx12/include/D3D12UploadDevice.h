@@ -0,0 +1,91 @@
+#pragma once
+
+#include <deque>
+#include <unordered_map>
+#include <vector>
+
+#include "TypeDefine.h"
+#include "UploadContext.h"
+
+namespace ResourceLoader {
+
+// UploadDevice backed by a D3D12 copy queue. Command allocators are pooled
+// per submitted batch and recycled once the fence has passed them; the
+// destination resources of a batch are referenced until then as well.
+class D3D12UploadDevice : public UploadDevice {
+public:
+  D3D12UploadDevice(D3d12DevicePtr device, CommandQueuePtr copy_queue);
+
+  D3D12UploadDevice(const D3D12UploadDevice &rhs) = delete;
+
+  auto operator=(const D3D12UploadDevice &rhs) -> D3D12UploadDevice & = delete;
+
+  ~D3D12UploadDevice() override;
+
+  auto Initialize() -> bool;
+
+  // Lets other queues wait on uploads on the GPU timeline.
+  auto GetFence() const -> FencePtr { return fence_; }
+
+  auto CreateStagingBuffer(uint64_t size, uint8_t *&mapped_data)
+      -> StagingBufferId override;
+
+  void ReleaseStagingBuffer(StagingBufferId staging) override;
+
+  auto GetTextureFootprints(ID3D12Resource *destination,
+                            uint32_t first_subresource,
+                            uint32_t subresource_count,
+                            UploadTextureFootprint *footprints,
+                            uint64_t &total_bytes) -> bool override;
+
+  auto BeginBatch() -> bool override;
+
+  void CopyBufferRegion(ID3D12Resource *destination,
+                        uint64_t destination_offset, StagingBufferId staging,
+                        uint64_t staging_offset, uint64_t size) override;
+
+  void CopyTextureRegion(ID3D12Resource *destination, uint32_t subresource,
+                         StagingBufferId staging,
+                         const UploadTextureFootprint &footprint) override;
+
+  auto SubmitBatch(UploadToken fence_value) -> bool override;
+
+  auto GetCompletedValue() -> UploadToken override;
+
+  auto WaitForValue(UploadToken fence_value) -> bool override;
+
+  void ReportError(const wchar_t *message) override;
+
+private:
+  struct SubmittedBatch {
+    UploadToken fence_value = 0;
+    CommandAllocatorPtr allocator = nullptr;
+    std::vector<ResourceSharedPtr> references = {};
+  };
+
+  void RecycleCompleted();
+
+  D3d12DevicePtr device_ = nullptr;
+
+  CommandQueuePtr copy_queue_ = nullptr;
+
+  GraphicsCommandListPtr command_list_ = nullptr;
+
+  CommandAllocatorPtr open_allocator_ = nullptr;
+
+  std::vector<ResourceSharedPtr> open_references_ = {};
+
+  std::deque<SubmittedBatch> submitted_ = {};
+
+  std::vector<CommandAllocatorPtr> free_allocators_ = {};
+
+  std::unordered_map<StagingBufferId, ResourceSharedPtr> staging_buffers_ = {};
+
+  StagingBufferId next_staging_id_ = 1;
+
+  FencePtr fence_ = nullptr;
+
+  HANDLE fence_event_ = nullptr;
+};
+
+} // namespace ResourceLoader
@@ -0,0 +1,90 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "dds.h"
+
+enum DDS_ALPHA_MODE {
+  DDS_ALPHA_MODE_UNKNOWN = 0,
+  DDS_ALPHA_MODE_STRAIGHT = 1,
+  DDS_ALPHA_MODE_PREMULTIPLIED = 2,
+  DDS_ALPHA_MODE_OPAQUE = 3,
+  DDS_ALPHA_MODE_CUSTOM = 4,
+};
+
+namespace ResourceLoader {
+
+// Where one subresource's texels sit inside a .dds image. Rows are tightly
+// packed; for block-compressed formats a row is a row of 4x4 blocks.
+struct DDSSubresource {
+  uint64_t offset = 0; // from the start of the image
+  uint32_t width = 0;
+  uint32_t height = 0;
+  uint32_t depth = 0;
+  uint64_t row_bytes = 0;
+  uint32_t row_count = 0;
+  uint64_t slice_bytes = 0;
+};
+
+// Resource description of a .dds image plus the position of every texel
+// block it will upload. Built from the header alone, so the texels can stay
+// in a file mapping until they are copied to the GPU.
+struct DDSLayout {
+  DXGI_FORMAT format = DXGI_FORMAT_UNKNOWN;
+  DirectX::DDS_RESOURCE_DIMENSION dimension =
+      DirectX::DDS_DIMENSION_TEXTURE2D;
+
+  // Size of the first mip kept.
+  uint32_t width = 0;
+  uint32_t height = 0;
+  uint32_t depth = 0;
+
+  // Cube maps count each face.
+  uint32_t array_size = 0;
+  uint32_t mip_count = 0;
+  bool is_cube_map = false;
+
+  DDS_ALPHA_MODE alpha_mode = DDS_ALPHA_MODE_UNKNOWN;
+
+  // In D3D12 subresource order: every kept mip of slice 0, then of slice 1...
+  std::vector<DDSSubresource> subresources = {};
+};
+
+// Validates a .dds image in place and lays out its subresources. Mips larger
+// than max_size in any dimension are skipped (0 keeps them all). Fails on
+// unsupported formats, sizes beyond the D3D12 limits and images that end
+// before their last subresource.
+auto ParseDDSImage(const uint8_t *data, size_t size, size_t max_size,
+                   DDSLayout &layout) -> bool;
+
+// A 2D texture to be written as a .dds with a DX10 header.
+struct DDSImageDesc {
+  DXGI_FORMAT format = DXGI_FORMAT_UNKNOWN;
+  uint32_t width = 0;
+  uint32_t height = 0;
+  uint32_t mip_count = 0;
+  // Every mip, level 0 first, each laid out as GetSurfaceInfo reports.
+  const uint8_t *data = nullptr;
+  size_t size = 0;
+  // Stored in DDS_HEADER::reserved1, which readers skip.
+  uint32_t reserved[11] = {};
+};
+
+// Fails when size does not match the mips of the format.
+auto BuildDDSImage(const DDSImageDesc &desc, std::vector<uint8_t> &image)
+    -> bool;
+
+auto ReadDDSReserved(const uint8_t *data, size_t size, uint32_t reserved[11])
+    -> bool;
+
+// Bits per texel; 0 for formats the loader does not know.
+auto BitsPerPixel(DXGI_FORMAT fmt) -> size_t;
+
+// Bytes, bytes per row and row count of one width x height surface.
+void GetSurfaceInfo(size_t width, size_t height, DXGI_FORMAT fmt,
+                    size_t *out_num_bytes, size_t *out_row_bytes,
+                    size_t *out_num_rows);
+
+} // namespace ResourceLoader
@@ -0,0 +1,5 @@
+#pragma once
+
+// Log output for the platform-neutral modules: OutputDebugStringW on Windows,
+// stderr elsewhere. Messages carry their own "[Module] " prefix and newline.
+void WriteDebugOutput(const wchar_t *message);
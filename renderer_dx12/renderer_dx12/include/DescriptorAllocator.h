@@ -0,0 +1,101 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <vector>
+
+// Free-list allocator over the descriptor indices [0, capacity) of one heap.
+//
+// Hands out contiguous runs, so a run can back a descriptor table. Freed runs
+// are merged with their free neighbours, which keeps the list short for the
+// long-lived views it is meant for. Only tracks indices; the owner maps them
+// to heap handles and decides when a freed run is no longer read by the GPU.
+class DescriptorAllocator {
+public:
+  DescriptorAllocator() = default;
+
+  explicit DescriptorAllocator(uint32_t capacity) { Reset(capacity); }
+
+  DescriptorAllocator(const DescriptorAllocator &rhs) = default;
+
+  auto operator=(const DescriptorAllocator &rhs)
+      -> DescriptorAllocator & = default;
+
+  ~DescriptorAllocator() = default;
+
+  // Frees everything.
+  void Reset(uint32_t capacity);
+
+  // First fit. Fails when no free run holds count descriptors.
+  auto Allocate(uint32_t count, uint32_t &offset) -> bool;
+
+  // offset and count must describe a run returned by Allocate.
+  void Free(uint32_t offset, uint32_t count);
+
+  auto GetCapacity() const -> uint32_t { return capacity_; }
+
+  auto GetUsed() const -> uint32_t { return used_; }
+
+  auto GetPeakUsed() const -> uint32_t { return peak_used_; }
+
+  auto GetFreeRunCount() const -> size_t { return free_runs_.size(); }
+
+private:
+  // Start of each free run to its length.
+  std::map<uint32_t, uint32_t> free_runs_ = {};
+
+  uint32_t capacity_ = 0;
+
+  uint32_t used_ = 0;
+
+  uint32_t peak_used_ = 0;
+};
+
+// Ring of descriptors for tables that live one frame, one start mark per
+// frame slot.
+//
+// Allocations never wrap: a run that does not fit before the end of the ring
+// starts again at index 0. BeginFrame(slot) is called once the slot's
+// previous frame has retired, which frees everything up to the oldest frame
+// still in flight, so a busy frame can use more than its share of the ring.
+class DescriptorRing {
+public:
+  DescriptorRing() = default;
+
+  DescriptorRing(uint32_t capacity, uint32_t frame_count) {
+    Reset(capacity, frame_count);
+  }
+
+  DescriptorRing(const DescriptorRing &rhs) = default;
+
+  auto operator=(const DescriptorRing &rhs) -> DescriptorRing & = default;
+
+  ~DescriptorRing() = default;
+
+  void Reset(uint32_t capacity, uint32_t frame_count);
+
+  void BeginFrame(uint32_t slot);
+
+  // Fails when the frames in flight hold too much of the ring.
+  auto Allocate(uint32_t count, uint32_t &offset) -> bool;
+
+  auto GetCapacity() const -> uint32_t { return capacity_; }
+
+  // Descriptors held by the frames in flight, including skipped ends.
+  auto GetUsed() const -> uint32_t {
+    return static_cast<uint32_t>(head_ - tail_);
+  }
+
+private:
+  static constexpr uint64_t kNoFrame = ~0ull;
+
+  // Positions count up without wrapping; the index is position % capacity.
+  std::vector<uint64_t> frame_starts_ = {};
+
+  uint32_t capacity_ = 0;
+
+  uint64_t head_ = 0;
+
+  uint64_t tail_ = 0;
+};
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <limits>
+#include <mutex>
 #include <sstream>
 #include <unordered_map>
 #include <utility>
@@ -9,7 +10,13 @@
 #include <memory>
 #include <vector>
 
+#include "CommandStateShadow.h"
+#include "DescriptorAllocator.h"
+#include "FrameRing.h"
+#include "LinearAllocator.h"
+#include "PipelineCache.h"
 #include "TypeDefine.h"
+#include "UploadContext.h"
 #include "d3dx12.h"
 
 struct DirectX12DeviceConfig {
@@ -20,6 +27,9 @@ struct DirectX12DeviceConfig {
   bool fullscreen = false;
   float screen_depth = 1000.0f;
   float screen_near = 0.1f;
+  // Frames the CPU may record ahead of the GPU, clamped to
+  // [kMinFrameLatency, kMaxFrameLatency]. Also the swap chain buffer count.
+  UINT frame_latency = kMinFrameLatency;
 };
 
 class DxgiResourceManager {
@@ -74,12 +84,13 @@ public:
   HRESULT CreateSwapChain(const DirectX12DeviceConfig &config,
                           ID3D12CommandQueue *command_queue,
                           Microsoft::WRL::ComPtr<IDXGISwapChain3> &swap_chain,
-                          UINT frame_count) {
+                          UINT frame_count, HANDLE &frame_latency_waitable) {
     if (!factory_ || !command_queue) {
       return E_INVALIDARG;
     }
 
     swap_chain.Reset();
+    frame_latency_waitable = nullptr;
 
     DXGI_SWAP_CHAIN_DESC1 swap_chain_desc = {};
     swap_chain_desc.BufferCount = frame_count;
@@ -89,6 +100,7 @@ public:
     swap_chain_desc.BufferUsage = DXGI_USAGE_RENDER_TARGET_OUTPUT;
     swap_chain_desc.SwapEffect = DXGI_SWAP_EFFECT_FLIP_DISCARD;
     swap_chain_desc.SampleDesc.Count = 1;
+    swap_chain_desc.Flags = DXGI_SWAP_CHAIN_FLAG_FRAME_LATENCY_WAITABLE_OBJECT;
 
     Microsoft::WRL::ComPtr<IDXGISwapChain1> temp_swap_chain;
     HRESULT hr = factory_->CreateSwapChainForHwnd(command_queue, config.hwnd,
@@ -115,6 +127,16 @@ public:
       return hr;
     }
 
+    // Without this DXGI caps the present queue at three frames regardless of
+    // how many back buffers there are.
+    hr = swap_chain->SetMaximumFrameLatency(frame_count);
+    if (FAILED(hr)) {
+      OutputDebugStringW(
+          L"[DxgiResourceManager] SetMaximumFrameLatency failed.\n");
+      return hr;
+    }
+    frame_latency_waitable = swap_chain->GetFrameLatencyWaitableObject();
+
     std::wstringstream stream;
     stream << L"[DxgiResourceManager] Create SwapChain successfully, size "
            << config.screen_width << L"x" << config.screen_height
@@ -151,6 +173,38 @@ struct RenderTargetDescriptor {
 
 using RenderTargetHandle = size_t;
 
+enum class DescriptorHeapKind {
+  // CBV/SRV/UAV, bound once per command list.
+  kShaderVisible,
+  // CPU-only CBV/SRV/UAV views that tables are copied from.
+  kStaging,
+  kRenderTarget,
+  kDepthStencil,
+  kCount,
+};
+
+// A run of descriptors in one of the device's heaps. gpu_handle is only set
+// in the shader-visible heap.
+struct DescriptorRange {
+  DescriptorHeapKind kind = DescriptorHeapKind::kShaderVisible;
+  UINT offset = 0;
+  UINT count = 0;
+  UINT increment_size = 0;
+  D3D12_CPU_DESCRIPTOR_HANDLE cpu_handle = {};
+  D3D12_GPU_DESCRIPTOR_HANDLE gpu_handle = {};
+
+  auto GetCpuHandle(UINT index) const -> D3D12_CPU_DESCRIPTOR_HANDLE {
+    return {cpu_handle.ptr + static_cast<SIZE_T>(index) * increment_size};
+  }
+
+  auto GetGpuHandle(UINT index) const -> D3D12_GPU_DESCRIPTOR_HANDLE {
+    return {gpu_handle.ptr + static_cast<UINT64>(index) * increment_size};
+  }
+};
+
+// Goes back to its heap when the last reference is dropped.
+using DescriptorRangePtr = std::shared_ptr<const DescriptorRange>;
+
 static constexpr RenderTargetHandle kInvalidRenderTargetHandle =
     std::numeric_limits<RenderTargetHandle>::max();
 
@@ -175,19 +229,44 @@ public:
 
   bool ExecuteDefaultGraphicsCommandList();
 
+  // Parallel recording. Each pass records into its own command list, backed by
+  // one allocator per pass per frame slot, so every pass can be recorded on a
+  // different thread. BeginPassRecording resets pass_count lists for the
+  // current frame, ScopedPassRecording routes the recording helpers below to
+  // one of them on the calling thread, and ExecutePassCommandLists submits
+  // them all in pass order with a single ExecuteCommandLists and presents.
+  bool BeginPassRecording(UINT pass_count);
+
+  bool ExecutePassCommandLists();
+
+  class ScopedPassRecording {
+  public:
+    ScopedPassRecording(DirectX12Device &device, UINT pass);
+
+    ScopedPassRecording(const ScopedPassRecording &rhs) = delete;
+
+    ScopedPassRecording &operator=(const ScopedPassRecording &rhs) = delete;
+
+    ~ScopedPassRecording();
+
+  private:
+    ID3D12GraphicsCommandList *previous_ = nullptr;
+
+    CommandStateShadow *previous_shadow_ = nullptr;
+  };
+
   bool ResetCommandList();
 
   bool CloseCommandList();
 
   bool ResetCommandAllocator();
 
+  // The binding helpers below shadow what each command list has bound and
+  // drop calls that would not change it.
   void SetGraphicsRootSignature(const RootSignaturePtr &graphics_rootsignature);
 
   void SetPipelineStateObject(const PipelineStateObjectPtr &pso);
 
-  void SetDescriptorHeaps(UINT num_descriptors,
-                          ID3D12DescriptorHeap **descriptor_arr);
-
   void
   SetGraphicsRootDescriptorTable(UINT RootParameterIndex,
                                  D3D12_GPU_DESCRIPTOR_HANDLE BaseDescriptor);
@@ -196,6 +275,10 @@ public:
   SetGraphicsRootConstantBufferView(UINT RootParameterIndex,
                                     D3D12_GPU_VIRTUAL_ADDRESS BufferLocation);
 
+  void
+  SetGraphicsRootShaderResourceView(UINT RootParameterIndex,
+                                    D3D12_GPU_VIRTUAL_ADDRESS BufferLocation);
+
   void BindVertexBuffer(UINT start_slot, UINT num_views,
                         const VertexBufferView *vertex_buffer);
 
@@ -209,6 +292,10 @@ public:
 
   void DirectX12Device::BeginPopulateGraphicsCommandList();
 
+  // Viewport, scissor, back buffer + depth targets and topology, without the
+  // barrier and clear; for passes that continue drawing to the back buffer.
+  void BindBackBuffer();
+
   void DirectX12Device::EndPopulateGraphicsCommandList();
 
   void DirectX12Device::Draw(UINT IndexCountPerInstance, UINT InstanceCount = 1,
@@ -216,11 +303,14 @@ public:
                              INT BaseVertexLocation = 0,
                              UINT StartInstanceLocation = 0);
 
-  bool WaitForPreviousFrame();
+  // Signals the end of the current frame and moves to the next slot of the
+  // frame ring. Only blocks when that slot's previous frame is still on the
+  // GPU, i.e. when the CPU is a full frame_latency frames ahead.
+  bool MoveToNextFrame();
   
   bool WaitForGpuIdle();
 
-  DescriptorHeapPtr GetOffScreenTextureHeapView() {
+  D3D12_GPU_DESCRIPTOR_HANDLE GetOffScreenTextureSrv() const {
     return GetRenderTargetSrv(default_offscreen_handle_);
   }
 
@@ -228,10 +318,6 @@ public:
     return default_graphics_command_list_;
   }
 
-  GraphicsCommandListPtr GetDefaultcopyCommandList() {
-    return default_copy_command_list_;
-  }
-
   CommandQueuePtr GetDefaultGraphicsCommandQueeue() {
     return default_graphics_command_queue_;
   }
@@ -244,13 +330,69 @@ public:
     if (frame_resources_.empty()) {
       return {};
     }
-    return frame_resources_[frame_index_].command_allocator;
+    return CurrentFrameResource().command_allocator;
+  }
+
+  UINT GetFrameCount() const { return frame_ring_.GetFrameCount(); }
+
+  // Slot of the frame being recorded; per-frame resources are indexed by it.
+  UINT GetFrameIndex() const { return frame_ring_.GetCurrentSlot(); }
+
+  // Fence value the frame being recorded will signal. Changes at least once
+  // per frame, so it doubles as a frame id.
+  UINT64 GetCurrentFrameFenceValue() const { return fence_value_; }
+
+  // Batched staging uploads on the copy queue. Pending copies are flushed,
+  // and waited for on the GPU, before each graphics submission.
+  ResourceLoader::UploadContext *GetUploadContext() {
+    return upload_context_.get();
   }
 
-  CommandAllocatorPtr GetDefaultCopyCommandAllocator() {
-    return default_copy_command_allocator_;
+  // Shared root signatures and pipeline states; the builders go through it.
+  PipelineCache &GetPipelineCache() { return pipeline_cache_; }
+
+  // Binding calls issued and elided by the state shadows over the last
+  // submitted frame, all command lists together.
+  const CommandRecorderStats &GetLastFrameCommandStats() const {
+    return last_frame_command_stats_;
   }
 
+  // Creates a default-heap buffer in the COMMON state and queues its initial
+  // contents on the upload context.
+  bool CreateDefaultBuffer(const void *source_data, size_t buffer_size,
+                           ResourceSharedPtr &default_buffer,
+                           ResourceLoader::UploadToken *token = nullptr);
+
+  // Transient memory from the current frame's persistently mapped upload
+  // pages. Valid until this frame's fence retires, so it must be rewritten
+  // every frame it is bound in.
+  bool AllocateFrameMemory(size_t size, size_t alignment,
+                           LinearAllocation &allocation);
+
+  // AllocateFrameMemory with constant buffer placement alignment.
+  bool AllocateFrameConstants(size_t size, LinearAllocation &allocation);
+
+  bool WriteFrameConstants(const void *data, size_t size,
+                           D3D12_GPU_VIRTUAL_ADDRESS &gpu_address);
+
+  // Persistent descriptors from one of the device-wide heaps, null when the
+  // heap is full. Shader-visible ranges are only reused once the frames
+  // recorded before their release have retired. Thread-safe.
+  auto AllocateDescriptors(DescriptorHeapKind kind, UINT count)
+      -> DescriptorRangePtr;
+
+  // A shader-visible table for the frame being recorded, with sources[i]
+  // copied into entry i. Sources must be staging descriptors. Valid until
+  // this frame's fence retires.
+  bool AllocateTransientTable(UINT count,
+                              const D3D12_CPU_DESCRIPTOR_HANDLE *sources,
+                              D3D12_GPU_DESCRIPTOR_HANDLE &table);
+
+  // Keeps object alive until every frame recorded so far has retired, for
+  // assets replaced while earlier frames may still reference them. Call from
+  // the thread that records frames, between frames.
+  void DeferRelease(Microsoft::WRL::ComPtr<ID3D12Pageable> object);
+
   void inline GetProjectionMatrix(DirectX::XMMATRIX &projection) {
     projection = projection_matrix_;
   }
@@ -274,7 +416,12 @@ public:
 
   void DestroyRenderTarget(RenderTargetHandle handle);
 
-  DescriptorHeapPtr GetRenderTargetSrv(RenderTargetHandle handle) const;
+  D3D12_GPU_DESCRIPTOR_HANDLE
+  GetRenderTargetSrv(RenderTargetHandle handle) const;
+
+  // CPU-only copy of the render target's SRV, for building tables.
+  D3D12_CPU_DESCRIPTOR_HANDLE
+  GetRenderTargetStagingView(RenderTargetHandle handle) const;
 
   ResourceSharedPtr GetRenderTargetTexture(RenderTargetHandle handle) const;
 
@@ -283,6 +430,8 @@ private:
 
   HRESULT CreateCommandQueues();
 
+  HRESULT CreateDescriptorHeaps();
+
   HRESULT CreateRenderTargetViews();
 
   HRESULT CreateDepthStencilResources();
@@ -293,6 +442,26 @@ private:
 
   HRESULT CreateFenceAndEvent();
 
+  HRESULT CreateUploadContext();
+
+  bool SubmitPendingUploads();
+
+  bool SubmitAndPresent(UINT command_list_count,
+                        ID3D12CommandList *const *command_lists);
+
+  // The pass list bound to this thread, or the default graphics list.
+  ID3D12GraphicsCommandList *RecordingList() const;
+
+  // The shadow of RecordingList().
+  CommandStateShadow *RecordingShadow();
+
+  // Binds the shader-visible heap; the only SetDescriptorHeaps a command
+  // list gets.
+  void BindDescriptorHeaps(ID3D12GraphicsCommandList *command_list,
+                           CommandStateShadow &shadow);
+
+  void FreeDescriptors(const DescriptorRange &range);
+
   void InitializeViewportsAndScissors();
 
   void InitializeMatrices();
@@ -302,7 +471,18 @@ private:
   void LogInitializationFailure(const wchar_t *stage, HRESULT hr) const;
 
 private:
-  static const UINT frame_cout_ = 2;
+  static const UINT64 frame_constant_page_size_ = 1024 * 1024;
+
+  // The shader-visible heap ends in the transient ring.
+  static const UINT shader_visible_descriptor_count_ = 8192;
+
+  static const UINT transient_descriptor_count_ = 2048;
+
+  static const UINT staging_descriptor_count_ = 4096;
+
+  static const UINT render_target_descriptor_count_ = 64;
+
+  static const UINT depth_stencil_descriptor_count_ = 16;
 
   DirectX12DeviceConfig config_ = {};
 
@@ -327,12 +507,8 @@ private:
 
   D3d12DevicePtr d3d12device_ = nullptr;
 
-  CommandAllocatorPtr default_copy_command_allocator_ = nullptr;
-
   GraphicsCommandListPtr default_graphics_command_list_ = nullptr;
 
-  GraphicsCommandListPtr default_copy_command_list_ = nullptr;
-
   CommandQueuePtr default_graphics_command_queue_ = nullptr;
 
   CommandQueuePtr default_copy_command_queue_ = nullptr;
@@ -340,25 +516,40 @@ private:
   FencePtr fence_ = nullptr;
 
 private:
-  ResourceSharedPtr back_buffer_render_targets_[frame_cout_] = {nullptr};
+  std::vector<ResourceSharedPtr> back_buffer_render_targets_ = {};
 
   struct RenderTargetResource {
     RenderTargetDescriptor descriptor = {};
     ResourceSharedPtr texture = nullptr;
-    DescriptorHeapPtr srv = nullptr;
-    DescriptorHeapPtr rtv = nullptr;
+    DescriptorRangePtr srv = nullptr;
+    DescriptorRangePtr staging_srv = nullptr;
+    DescriptorRangePtr rtv = nullptr;
     D3D12_RESOURCE_STATES current_state = D3D12_RESOURCE_STATE_COMMON;
   };
 
-  DescriptorHeapPtr render_target_view_heap_ = nullptr;
+  struct DescriptorHeap {
+    DescriptorHeapPtr heap = nullptr;
+    DescriptorAllocator allocator = {};
+    UINT increment_size = 0;
+  };
 
-  UINT render_target_descriptor_size_ = 0;
+  DescriptorHeap descriptor_heaps_[static_cast<size_t>(
+      DescriptorHeapKind::kCount)] = {};
 
-  ResourceSharedPtr depth_stencil_resource_ = nullptr;
+  // Indices past the persistent part of the shader-visible heap.
+  DescriptorRing transient_descriptors_ = {};
+
+  // Shader-visible ranges released since the last frame boundary.
+  std::vector<DescriptorRange> released_descriptors_ = {};
+
+  // Descriptors are allocated and released from loading threads too.
+  std::mutex descriptor_mutex_;
 
-  DescriptorHeapPtr depth_stencil_view_heap_ = nullptr;
+  DescriptorRangePtr back_buffer_rtvs_ = nullptr;
+
+  ResourceSharedPtr depth_stencil_resource_ = nullptr;
 
-  UINT depth_stencil_descriptor_size_ = 0;
+  DescriptorRangePtr depth_stencil_view_ = nullptr;
 
   RootSignaturePtr root_signature_ = nullptr;
 
@@ -368,10 +559,14 @@ private:
 
   D3D12_INDEX_BUFFER_VIEW index_buffer_view_ = {};
 
-  UINT frame_index_ = 0;
+  FrameRing frame_ring_ = {};
+
+  UINT back_buffer_index_ = 0;
 
   HANDLE fence_handle_ = nullptr;
 
+  HANDLE frame_latency_waitable_ = nullptr;
+
   UINT64 fence_value_ = 1;
 
 private:
@@ -383,11 +578,29 @@ private:
 
   struct FrameResource {
     CommandAllocatorPtr command_allocator = nullptr;
-    UINT64 fence_value = 0;
+    std::vector<CommandAllocatorPtr> pass_allocators = {};
+    LinearAllocator constant_allocator = {};
+    std::vector<ResourceSharedPtr> constant_pages = {};
+    std::vector<Microsoft::WRL::ComPtr<ID3D12Pageable>> deferred_releases = {};
+    std::vector<DescriptorRange> deferred_descriptors = {};
   };
 
   std::vector<FrameResource> frame_resources_ = {};
 
+  std::vector<GraphicsCommandListPtr> pass_command_lists_ = {};
+
+  // One per pass command list, reset with it.
+  std::vector<CommandStateShadow> pass_shadows_ = {};
+
+  CommandStateShadow default_shadow_ = {};
+
+  CommandRecorderStats last_frame_command_stats_ = {};
+
+  UINT recording_pass_count_ = 0;
+
+  // Passes recorded in parallel share the frame's transient memory.
+  std::mutex frame_memory_mutex_;
+
   std::unique_ptr<DxgiResourceManager> dxgi_resources_ = nullptr;
 
   std::unordered_map<RenderTargetHandle, RenderTargetResource>
@@ -397,6 +610,14 @@ private:
 
   RenderTargetHandle next_render_target_handle_ = 0;
 
+  FencePtr upload_fence_ = nullptr;
+
+  ResourceLoader::UploadToken upload_token_waited_ = 0;
+
+  std::unique_ptr<ResourceLoader::UploadContext> upload_context_ = nullptr;
+
+  PipelineCache pipeline_cache_;
+
   RenderTargetResource *GetRenderTargetResource(RenderTargetHandle handle);
 
   const RenderTargetResource *
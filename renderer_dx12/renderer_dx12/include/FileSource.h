@@ -0,0 +1,99 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace ResourceLoader {
+
+// Contents of a whole file, either a view kept alive by an owner (such as a
+// read-only mapping) or bytes held in memory. Loaders take this instead of a
+// path so a file can come from disk, from a freshly cooked image or from a
+// fake source without copying.
+class FileData {
+public:
+  FileData() = default;
+
+  explicit FileData(std::vector<uint8_t> bytes) : bytes_(std::move(bytes)) {}
+
+  // data stays valid for as long as owner is alive.
+  FileData(std::shared_ptr<const void> owner, const uint8_t *data, size_t size)
+      : owner_(std::move(owner)), view_data_(data), view_size_(size) {}
+
+  FileData(const FileData &rhs) = delete;
+
+  auto operator=(const FileData &rhs) -> FileData & = delete;
+
+  FileData(FileData &&rhs) noexcept = default;
+
+  auto operator=(FileData &&rhs) noexcept -> FileData & = default;
+
+  ~FileData() = default;
+
+  void Reset() {
+    owner_.reset();
+    view_data_ = nullptr;
+    view_size_ = 0;
+    bytes_.clear();
+    bytes_.shrink_to_fit();
+  }
+
+  auto GetData() const -> const uint8_t * {
+    return owner_ ? view_data_ : bytes_.data();
+  }
+
+  auto GetSize() const -> size_t { return owner_ ? view_size_ : bytes_.size(); }
+
+  auto IsEmpty() const -> bool { return GetSize() == 0; }
+
+private:
+  std::shared_ptr<const void> owner_ = nullptr;
+
+  const uint8_t *view_data_ = nullptr;
+
+  size_t view_size_ = 0;
+
+  std::vector<uint8_t> bytes_ = {};
+};
+
+// Size and last-write time of a file, used to detect stale cooked caches.
+struct FileStamp {
+  uint64_t size = 0;
+  uint64_t last_write_time = 0;
+};
+
+// Where assets come from. The disk source maps files; a fake source can serve
+// them from memory so the loading code runs without a GPU or a data
+// directory.
+class FileSource {
+public:
+  virtual ~FileSource() = default;
+
+  virtual auto ReadFile(const std::wstring &path, FileData &data) -> bool = 0;
+
+  virtual auto GetStamp(const std::wstring &path, FileStamp &stamp)
+      -> bool = 0;
+
+  // Used to refresh caches; a source may refuse.
+  virtual auto WriteFile(const std::wstring &path,
+                         const std::vector<uint8_t> &data) -> bool = 0;
+};
+
+auto GetDiskFileSource() -> FileSource &;
+
+// The disk source's primitives, for code that always works on disk.
+
+// Maps the file read-only. Fails for missing and empty files.
+auto MapFile(const std::wstring &file_path, FileData &data) -> bool;
+
+auto GetFileStamp(const std::wstring &file_path, FileStamp &stamp) -> bool;
+
+// Writes next to the target and swaps it in, so a crash never leaves a torn
+// file behind.
+auto WriteFileAtomically(const std::wstring &file_path,
+                         const std::vector<uint8_t> &data) -> bool;
+
+} // namespace ResourceLoader
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+constexpr uint32_t kMinFrameLatency = 2;
+constexpr uint32_t kMaxFrameLatency = 4;
+
+// Round-robin bookkeeping for frames in flight.
+//
+// Each slot remembers the fence value signalled after the last frame recorded
+// into it. Advance() moves to the next slot and reports the fence value that
+// has to complete before that slot's resources may be touched again, so the
+// CPU only blocks once it has wrapped all the way around the ring. The ring
+// only tracks numbers; the owner signals and waits on the real fence.
+class FrameRing {
+public:
+  explicit FrameRing(uint32_t frame_count = kMinFrameLatency) {
+    Reset(frame_count);
+  }
+
+  FrameRing(const FrameRing &rhs) = default;
+
+  auto operator=(const FrameRing &rhs) -> FrameRing & = default;
+
+  ~FrameRing() = default;
+
+  // Clamps frame_count to [kMinFrameLatency, kMaxFrameLatency] and forgets
+  // every outstanding fence value.
+  void Reset(uint32_t frame_count);
+
+  auto GetFrameCount() const -> uint32_t {
+    return static_cast<uint32_t>(slot_fence_values_.size());
+  }
+
+  auto GetCurrentSlot() const -> uint32_t { return current_slot_; }
+
+  // 0 when nothing recorded into the slot is outstanding.
+  auto GetSlotFenceValue(uint32_t slot) const -> uint64_t;
+
+  // Records that the current slot's work signals fence_value, then moves to
+  // the next slot. Returns the fence value the caller must wait for before
+  // reusing the new slot, or 0 when it is already free.
+  auto Advance(uint64_t fence_value) -> uint64_t;
+
+  auto IsSlotReusable(uint32_t slot, uint64_t completed_fence_value) const
+      -> bool;
+
+private:
+  std::vector<uint64_t> slot_fence_values_ = {};
+
+  uint32_t current_slot_ = 0;
+};
@@ -0,0 +1,118 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+class JobSystem;
+
+// An axis-aligned box and a sphere around the same center. Either one alone
+// bounds the object; culling keeps whichever is tighter against each plane.
+struct BoundingVolume {
+  float center[3] = {};
+  float extents[3] = {};
+  float radius = 0.0f;
+};
+
+// Bounds of positions that start each interleaved vertex, as every model
+// vertex type here does. The sphere is centered on the box, with the radius
+// of the farthest vertex.
+auto ComputeBoundingVolume(const void *vertices, size_t stride, size_t count)
+    -> BoundingVolume;
+
+// world is row-major for row vectors, as DirectXMath stores it before the
+// transpose for the shaders. The box stays axis-aligned, so it grows under
+// rotation; the sphere does not.
+auto TransformBoundingVolume(const BoundingVolume &local, const float world[16])
+    -> BoundingVolume;
+
+// Inward-facing planes ax + by + cz + d >= 0, normalized: left, right,
+// bottom, top, near, far.
+struct FrustumPlanes {
+  float planes[6][4] = {};
+};
+
+// From a row-major view * projection for row vectors and D3D's 0..w clip
+// depth.
+void ExtractFrustumPlanes(const float view_projection[16],
+                          FrustumPlanes &frustum);
+
+// Single-object test for the few draws that are not worth batching.
+auto IsVisible(const FrustumPlanes &frustum, const BoundingVolume &bounds)
+    -> bool;
+
+// World-space bounds of many objects, one stream per component.
+//
+// Streams are padded to a multiple of kCullingLaneCount so the SIMD loops
+// have no scalar tail; padding lanes are tested but never reported.
+class CullingBounds {
+public:
+  static constexpr size_t kCullingLaneCount = 8;
+
+  CullingBounds() = default;
+
+  CullingBounds(const CullingBounds &rhs) = delete;
+
+  auto operator=(const CullingBounds &rhs) -> CullingBounds & = delete;
+
+  ~CullingBounds() = default;
+
+  // Keeps the storage.
+  void Clear();
+
+  void Reserve(size_t count);
+
+  auto Add(const BoundingVolume &bounds) -> uint32_t;
+
+  void Set(uint32_t index, const BoundingVolume &bounds);
+
+  auto GetCount() const -> size_t { return count_; }
+
+  auto GetCenterX() const -> const float * { return center_x_.data(); }
+  auto GetCenterY() const -> const float * { return center_y_.data(); }
+  auto GetCenterZ() const -> const float * { return center_z_.data(); }
+  auto GetExtentX() const -> const float * { return extent_x_.data(); }
+  auto GetExtentY() const -> const float * { return extent_y_.data(); }
+  auto GetExtentZ() const -> const float * { return extent_z_.data(); }
+  auto GetRadius() const -> const float * { return radius_.data(); }
+
+private:
+  void Pad(size_t count);
+
+  std::vector<float> center_x_ = {};
+  std::vector<float> center_y_ = {};
+  std::vector<float> center_z_ = {};
+  std::vector<float> extent_x_ = {};
+  std::vector<float> extent_y_ = {};
+  std::vector<float> extent_z_ = {};
+  std::vector<float> radius_ = {};
+
+  size_t count_ = 0;
+};
+
+enum class CullingPath : uint32_t {
+  // AVX when the CPU and OS support it, SSE otherwise on x64.
+  kAuto = 0,
+  kScalar,
+  // Four bounds at a time; every x64 CPU has SSE2.
+  kSse,
+  kAvx,
+};
+
+// True when the AVX path can run here.
+auto IsAvxCullingSupported() -> bool;
+
+// Writes 1 to visible[i] for every bound in [begin, end) that may intersect
+// the frustum, 0 otherwise, and returns how many were visible. begin must be
+// a multiple of kCullingLaneCount. kAvx falls back to SSE and kSse to scalar
+// where they cannot run.
+auto CullBounds(const FrustumPlanes &frustum, const CullingBounds &bounds,
+                size_t begin, size_t end, uint8_t *visible,
+                CullingPath path = CullingPath::kAuto) -> size_t;
+
+// Every bound, in chunks on the job system; small sets stay on the calling
+// thread. visible is resized to the bound count.
+auto CullBoundsParallel(JobSystem &job_system, const FrustumPlanes &frustum,
+                        const CullingBounds &bounds,
+                        std::vector<uint8_t> &visible,
+                        CullingPath path = CullingPath::kAuto) -> size_t;
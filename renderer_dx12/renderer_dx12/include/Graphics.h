@@ -3,17 +3,25 @@
 #include <DirectXMath.h>
 #include <Windows.h>
 #include <memory>
+#include <vector>
 
+#include "ClusteredLighting.h"
+#include "FrustumCulling.h"
+#include "RenderQueue.h"
+#include "SceneBvh.h"
 #include "ShaderLoader.h"
+#include "TypeDefine.h"
 
 namespace Lighting {
 class LightManager;
+class SceneLight;
 }
 
 constexpr bool FULL_SCREEN = false;
 constexpr bool VSYNC_ENABLED = true;
 constexpr float SCREEN_DEPTH = 1000.0f;
 constexpr float SCREEN_NEAR = 0.1f;
+constexpr unsigned int FRAME_LATENCY = 3;
 
 class DirectX12Device;
 class Light;
@@ -28,6 +36,7 @@ class CPUUsageTracker;
 class BumpMappingScene;
 class SpecularMappingScene;
 class ReflectionScene;
+class InstancingStressScene;
 
 class Graphics {
 public:
@@ -50,6 +59,26 @@ private:
 
   void UpdateCameraFromInput(float delta_seconds, Input *input);
 
+  // Renderables that are culled and picked through scene_bvh_.
+  enum SceneObject : UINT {
+    kModelObject = 0,
+    kPbrModelObject,
+    kBumpCubeObject,
+    kSpecularCubeObject,
+    kReflectionCubeObject,
+    kReflectionFloorObject,
+    kSceneObjectCount
+  };
+
+  // Moves every object to its bounds for this frame and refits the tree,
+  // rebuilding it when it was first filled or has degraded.
+  void UpdateSceneBvh();
+
+  // Logs the object under the cursor when the left button goes down.
+  void PickSceneObject(Input *input);
+
+  auto IsSceneObjectVisible(SceneObject object) const -> bool;
+
   // Helper methods for better organization
   auto InitializeShaders(HWND hwnd) -> bool;
 
@@ -57,28 +86,56 @@ private:
   
   auto InitializeScenes(HWND hwnd) -> bool;
 
+  // Point and spot lights circling the scene, past the LightManager's
+  // default cap, for the clustered pipelines.
+  auto InitializeLocalLights() -> bool;
+
   // Render pass helpers
   auto UpdateConstantBuffers(const DirectX::XMMATRIX& view_matrix,
                             const DirectX::XMMATRIX& projection_matrix) -> bool;
+
+  // Moves the local lights, bins them into light_grid_ and writes the grid
+  // to frame memory for this frame's draws.
+  auto UpdateClusteredLights(const DirectX::XMMATRIX &view_matrix,
+                             const DirectX::XMMATRIX &projection_matrix)
+      -> bool;
   
+  // Passes are recorded in parallel, one command list each, and submitted
+  // in this order.
+  enum RenderPass : UINT {
+    kOffscreenPass = 0,
+    kReflectionMapPass,
+    kReflectionScenePass,
+    kSpecularScenePass,
+    kBumpScenePass,
+    kInstancingScenePass,
+    kOverlayPass,
+    kRenderPassCount
+  };
+
+  void CacheRenderResources();
+
+  // Submits the visible draws of the offscreen and overlay passes to
+  // render_queue_ and sorts it. Runs before the fan-out, the passes only
+  // replay it.
+  auto BuildRenderQueue(const DirectX::XMMATRIX &view_matrix,
+                        const DirectX::XMMATRIX &projection_matrix) -> bool;
+
+  // Records one pass's share of render_queue_ on the calling thread.
+  void ReplayRenderQueue(RenderPass pass);
+
   auto RenderOffscreenPass() -> bool;
-  
-  auto RenderMainScenePass(const DirectX::XMMATRIX& view_matrix,
-                          const DirectX::XMMATRIX& projection_matrix) -> bool;
-  auto RenderUIPass() -> bool;
+
+  // PBR model, UI and the back buffer's transition to present.
+  auto RenderOverlayPass() -> bool;
 
   // Resource caching structure
   struct CachedRenderResources {
     ID3D12RootSignature* light_root_signature = nullptr;
     ID3D12PipelineState* light_pso = nullptr;
-    ID3D12Resource* light_matrix_cb = nullptr;
-    ID3D12Resource* light_cb = nullptr;
-    ID3D12Resource* fog_cb = nullptr;
 
     ID3D12RootSignature* font_root_signature = nullptr;
     ID3D12PipelineState* font_pso = nullptr;
-    ID3D12Resource* font_matrix_cb = nullptr;
-    ID3D12Resource* font_pixel_cb = nullptr;
 
     ID3D12RootSignature* offscreen_root_signature = nullptr;
     ID3D12PipelineState* offscreen_pso = nullptr;
@@ -86,10 +143,74 @@ private:
 
   CachedRenderResources cached_resources_;
 
+  // Root parameter 0 is the descriptor table, the constant buffers follow,
+  // then the root shader resource views.
+  struct MaterialBinding {
+    D3D12_GPU_DESCRIPTOR_HANDLE table = {};
+    UINT constant_buffer_count = 0;
+    D3D12_GPU_VIRTUAL_ADDRESS constant_buffers[4] = {};
+    UINT shader_resource_count = 0;
+    D3D12_GPU_VIRTUAL_ADDRESS shader_resources[3] = {};
+  };
+
+  // light_grid_ as uploaded for the current frame.
+  struct ClusteredLightBinding {
+    D3D12_GPU_VIRTUAL_ADDRESS constants = 0;
+    D3D12_GPU_VIRTUAL_ADDRESS lights = 0;
+    D3D12_GPU_VIRTUAL_ADDRESS light_indices = 0;
+    D3D12_GPU_VIRTUAL_ADDRESS cluster_ranges = 0;
+  };
+
+  // Appends the clustered lights to a material of the clustered pipelines.
+  void AddClusteredLights(MaterialBinding &material) const;
+
+  struct GeometryBinding {
+    VertexBufferView vertex_buffer = {};
+    IndexBufferView index_buffer = {};
+  };
+
+  // What the ids in render_queue_'s packets refer to, rebuilt every frame.
+  struct RenderBindings {
+    std::vector<ID3D12RootSignature *> root_signatures = {};
+    std::vector<ID3D12PipelineState *> pipeline_states = {};
+    std::vector<MaterialBinding> materials = {};
+    std::vector<GeometryBinding> geometries = {};
+
+    void Clear();
+
+    auto AddRootSignature(ID3D12RootSignature *root_signature) -> uint32_t;
+
+    auto AddPipelineState(ID3D12PipelineState *pipeline_state) -> uint32_t;
+
+    auto AddMaterial(const MaterialBinding &material) -> uint32_t;
+
+    auto AddGeometry(const GeometryBinding &geometry) -> uint32_t;
+  };
+
+  RenderQueue render_queue_;
+
+  RenderBindings render_bindings_;
+
+  SceneBvh scene_bvh_;
+
+  // scene_bvh_'s id for each SceneObject, kInvalidObject while absent.
+  uint32_t scene_object_ids_[kSceneObjectCount] = {};
+
+  // From the camera's frustum, rebuilt with the render queue.
+  std::vector<uint32_t> visible_objects_ = {};
+
+  bool left_mouse_was_pressed_ = false;
+
   std::shared_ptr<DirectX12Device> d3d12_device_ = nullptr;
 
   std::shared_ptr<Lighting::LightManager> light_manager_ = nullptr;
 
+  std::vector<std::shared_ptr<Lighting::SceneLight>> local_lights_ = {};
+
+  Lighting::ClusteredLightGrid light_grid_;
+
+  ClusteredLightBinding clustered_lights_ = {};
+
   std::shared_ptr<Camera> camera_ = nullptr;
 
   std::shared_ptr<ResourceLoader::ShaderLoader> shader_loader_ = nullptr;
@@ -111,6 +232,8 @@ private:
   std::shared_ptr<SpecularMappingScene> specular_mapping_scene_ = nullptr;
 
   std::shared_ptr<ReflectionScene> reflection_scene_ = nullptr;
+
+  std::shared_ptr<InstancingStressScene> instancing_scene_ = nullptr;
   
   float camera_move_speed_ = 5.0f;
 
@@ -63,6 +63,8 @@ public:
 
   auto IsEPressed() const -> bool;
 
+  auto IsLeftMouseButtonPressed() const -> bool;
+
 private:
   void ProcessInput();
 
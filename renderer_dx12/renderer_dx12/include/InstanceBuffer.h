@@ -0,0 +1,67 @@
+#pragma once
+
+#include <DirectXMath.h>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "TypeDefine.h"
+
+class DirectX12Device;
+
+// Vertex buffer slot the instance stream is bound to; slot 0 is the mesh.
+constexpr UINT kInstanceStreamSlot = 1;
+
+// One instance as the instanced shaders read it (WORLD0-3, COLOR0,
+// MATERIAL).
+struct InstanceData {
+  // Row-major and not transposed: rows go to WORLD0-3.
+  DirectX::XMFLOAT4X4 world = {};
+  DirectX::XMFLOAT4 tint = {1.0f, 1.0f, 1.0f, 1.0f};
+  // Which of the material's textures to sample.
+  uint32_t material_index = 0;
+  uint32_t padding[3] = {};
+};
+
+// Appends the per-instance elements for kInstanceStreamSlot to a material's
+// per-vertex input layout.
+void AppendInstanceInputElements(
+    std::vector<D3D12_INPUT_ELEMENT_DESC> &input_elements);
+
+// Per-instance data for instanced draws, bound as a second vertex stream.
+//
+// Static instances are uploaded once into a default heap buffer, so drawing
+// them costs the CPU the same whatever their number. Dynamic instances are
+// rewritten into the frame's upload memory on every frame they are drawn.
+class InstanceBuffer {
+public:
+  explicit InstanceBuffer(std::shared_ptr<DirectX12Device> device);
+
+  InstanceBuffer(const InstanceBuffer &rhs) = delete;
+
+  auto operator=(const InstanceBuffer &rhs) -> InstanceBuffer & = delete;
+
+  ~InstanceBuffer() = default;
+
+  // For instances that do not move. The copy is queued on the upload
+  // context, which is flushed before the next graphics submission.
+  auto InitializeStatic(const std::vector<InstanceData> &instances) -> bool;
+
+  // Valid for the frame being recorded only. Thread-safe.
+  auto UpdateDynamic(const InstanceData *instances, UINT count) -> bool;
+
+  auto GetVertexBufferView() const -> const VertexBufferView & {
+    return vertex_buffer_view_;
+  }
+
+  auto GetInstanceCount() const -> UINT { return instance_count_; }
+
+private:
+  std::shared_ptr<DirectX12Device> device_ = nullptr;
+
+  ResourceSharedPtr buffer_ = nullptr;
+
+  VertexBufferView vertex_buffer_view_ = {};
+
+  UINT instance_count_ = 0;
+};
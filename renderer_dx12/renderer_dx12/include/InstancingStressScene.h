@@ -0,0 +1,115 @@
+#pragma once
+
+#include <DirectXMath.h>
+#include <memory>
+#include <vector>
+
+#include "FrustumCulling.h"
+#include "InstanceBuffer.h"
+
+class Camera;
+class DirectX12Device;
+class Model;
+class PBRModel;
+
+namespace Lighting {
+class LightManager;
+class SceneLight;
+} // namespace Lighting
+
+namespace ResourceLoader {
+class ShaderLoader;
+}
+
+// What the last Render recorded.
+struct InstancingStats {
+  UINT draw_count = 0;
+  UINT instance_count = 0;
+  // CPU time Render took, culling and the dynamic upload included.
+  float record_milliseconds = 0.0f;
+};
+
+// Many objects in few draws, to keep instancing honest.
+//
+// A static field of textured cubes is uploaded once and drawn in a single
+// instanced call, so its CPU cost does not grow with the cube count. A
+// smaller block of PBR spheres is culled and the visible ones rewritten into
+// frame memory every frame, to cover the dynamic path.
+class InstancingStressScene {
+public:
+  InstancingStressScene(
+      std::shared_ptr<DirectX12Device> device,
+      std::shared_ptr<ResourceLoader::ShaderLoader> shader_loader,
+      std::shared_ptr<Lighting::LightManager> light_manager,
+      std::shared_ptr<Camera> camera);
+
+  InstancingStressScene(const InstancingStressScene &rhs) = delete;
+
+  auto operator=(const InstancingStressScene &rhs)
+      -> InstancingStressScene & = delete;
+
+  ~InstancingStressScene();
+
+  auto Initialize() -> bool;
+
+  void Shutdown();
+
+  void Update(float delta_seconds);
+
+  auto Render(const DirectX::XMMATRIX &view,
+              const DirectX::XMMATRIX &projection,
+              const Lighting::SceneLight *scene_light) -> bool;
+
+  auto GetInstanceCount() const -> UINT;
+
+  // Written by Render, so only read it while no frame is being recorded.
+  auto GetStats() const -> const InstancingStats & { return stats_; }
+
+private:
+  auto EnsureShadersLoaded() -> bool;
+
+  auto InitializeCubes() -> bool;
+
+  auto InitializeSpheres() -> bool;
+
+  auto RenderCubes(const FrustumPlanes &frustum,
+                   const DirectX::XMMATRIX &view_t,
+                   const DirectX::XMMATRIX &projection_t,
+                   const Lighting::SceneLight *scene_light) -> bool;
+
+  auto RenderSpheres(const FrustumPlanes &frustum,
+                     const DirectX::XMMATRIX &view_t,
+                     const DirectX::XMMATRIX &projection_t,
+                     const Lighting::SceneLight *scene_light) -> bool;
+
+  std::shared_ptr<DirectX12Device> device_;
+
+  std::shared_ptr<ResourceLoader::ShaderLoader> shader_loader_;
+
+  std::shared_ptr<Lighting::LightManager> light_manager_;
+
+  std::shared_ptr<Camera> camera_;
+
+  std::shared_ptr<Model> cube_model_ = nullptr;
+
+  std::unique_ptr<InstanceBuffer> cube_instances_ = nullptr;
+
+  std::shared_ptr<PBRModel> sphere_model_ = nullptr;
+
+  std::unique_ptr<InstanceBuffer> sphere_instances_ = nullptr;
+
+  // Rewritten every frame, kept to avoid reallocating.
+  std::vector<InstanceData> sphere_instance_data_ = {};
+
+  std::vector<InstanceData> visible_sphere_data_ = {};
+
+  CullingBounds sphere_bounds_;
+
+  std::vector<uint8_t> sphere_visibility_ = {};
+
+  InstancingStats stats_ = {};
+
+  bool shaders_loaded_ = false;
+
+  float elapsed_seconds_ = 0.0f;
+};
@@ -0,0 +1,156 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+using Job = std::function<void()>;
+
+// Counts outstanding jobs of one batch. Wait on it with JobSystem::Wait, or
+// hang follow-up work off it with JobSystem::SubmitAfter.
+class JobCounter {
+public:
+  JobCounter() = default;
+
+  JobCounter(const JobCounter &rhs) = delete;
+
+  auto operator=(const JobCounter &rhs) -> JobCounter & = delete;
+
+  ~JobCounter() = default;
+
+  auto IsDone() const -> bool { return pending_.load() == 0; }
+
+private:
+  friend class JobSystem;
+
+  struct Continuation {
+    Job job;
+    JobCounter *counter = nullptr;
+  };
+
+  std::atomic<size_t> pending_{0};
+
+  // Jobs released the next time pending_ drops to zero.
+  std::mutex continuation_mutex_;
+
+  std::vector<Continuation> continuations_ = {};
+};
+
+struct JobSystemConfig {
+  // 0 picks one worker per hardware thread, minus one when the caller
+  // participates.
+  unsigned int worker_count = 0;
+
+  // When set, a non-worker thread blocked in Wait() runs queued jobs instead
+  // of sleeping. Workers always help while they wait so nested waits cannot
+  // deadlock the pool.
+  bool caller_participates = true;
+};
+
+// Work-stealing pool of std::thread workers.
+//
+// Every worker owns a deque: jobs it submits go to the back and it pops from
+// the back, so freshly split work stays hot in its cache, while idle workers
+// steal the oldest (and usually largest) job from the front of someone else's
+// deque. Jobs submitted from threads outside the pool land in a shared
+// injection queue that every worker drains.
+class JobSystem {
+public:
+  explicit JobSystem(const JobSystemConfig &config = {});
+
+  JobSystem(const JobSystem &rhs) = delete;
+
+  auto operator=(const JobSystem &rhs) -> JobSystem & = delete;
+
+  ~JobSystem();
+
+  // Process-wide pool with the default config, created on first use.
+  static auto Instance() -> JobSystem &;
+
+  auto GetWorkerCount() const -> unsigned int {
+    return static_cast<unsigned int>(workers_.size());
+  }
+
+  // Threads that execute jobs during a ParallelFor from the caller.
+  auto GetConcurrency() const -> unsigned int;
+
+  // True on this pool's worker threads.
+  auto IsWorkerThread() const -> bool;
+
+  void Submit(Job job);
+
+  void Submit(Job job, JobCounter &counter);
+
+  // Queues job once dependency next reaches zero; runs it right away when the
+  // dependency is already done. counter covers the job from this call on.
+  void SubmitAfter(JobCounter &dependency, Job job, JobCounter &counter);
+
+  // Returns once every job submitted against counter has finished.
+  void Wait(JobCounter &counter);
+
+  // Blocks until function(begin, end) has covered [0, count). With
+  // grain_size == 0 the ranges split adaptively: each one halves itself while
+  // it is larger than a minimum chunk, and the halves are only handed to
+  // another thread if that thread goes idle and steals them.
+  void ParallelFor(size_t count, size_t grain_size,
+                   const std::function<void(size_t, size_t)> &function);
+
+private:
+  struct QueuedJob {
+    Job job;
+    JobCounter *counter = nullptr;
+  };
+
+  struct alignas(64) WorkQueue {
+    std::mutex mutex;
+    std::deque<QueuedJob> jobs;
+  };
+
+  void Push(QueuedJob queued);
+
+  void WorkerLoop(size_t worker_index);
+
+  auto TryRunOne() -> bool;
+
+  auto PopLocal(QueuedJob &queued) -> bool;
+
+  auto Steal(QueuedJob &queued) -> bool;
+
+  void Execute(QueuedJob &queued);
+
+  void Finish(JobCounter *counter);
+
+  void SplitRange(size_t begin, size_t end, size_t grain_size,
+                  const std::function<void(size_t, size_t)> &function,
+                  JobCounter &counter);
+
+  auto CurrentWorkerIndex() const -> size_t;
+
+  bool caller_participates_ = true;
+
+  std::vector<std::thread> workers_ = {};
+
+  // One deque per worker followed by the injection queue.
+  std::vector<std::unique_ptr<WorkQueue>> queues_ = {};
+
+  // Jobs sitting in any queue; lets sleepers decide without scanning.
+  std::atomic<size_t> queued_count_{0};
+
+  std::mutex sleep_mutex_;
+
+  std::condition_variable work_available_;
+
+  std::condition_variable job_finished_;
+
+  std::atomic<size_t> sleeping_workers_{0};
+
+  std::atomic<size_t> helping_waiters_{0};
+
+  bool stopping_ = false;
+};
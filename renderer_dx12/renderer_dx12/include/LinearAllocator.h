@@ -0,0 +1,88 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Mirrors D3D12_CONSTANT_BUFFER_DATA_PLACEMENT_ALIGNMENT.
+constexpr uint64_t kConstantBufferAlignment = 256;
+
+struct LinearAllocation {
+  uint8_t *cpu_address = nullptr;
+  uint64_t gpu_address = 0;
+  uint64_t size = 0;
+};
+
+// Bump allocator over persistently mapped pages, one per frame in flight.
+//
+// The owner supplies pages (CPU pointer + GPU virtual address) with AddPage;
+// the allocator never creates or frees memory itself, so it has no D3D
+// dependency. Once a frame has been submitted the allocator is closed with
+// that frame's fence value, and Retire() rewinds it to the first page when
+// the fence has completed. Pages are kept, so steady-state frames do not
+// allocate.
+class LinearAllocator {
+public:
+  LinearAllocator() = default;
+
+  LinearAllocator(const LinearAllocator &rhs) = delete;
+
+  auto operator=(const LinearAllocator &rhs) -> LinearAllocator & = delete;
+
+  LinearAllocator(LinearAllocator &&rhs) noexcept = default;
+
+  auto operator=(LinearAllocator &&rhs) noexcept -> LinearAllocator & = default;
+
+  ~LinearAllocator() = default;
+
+  void AddPage(uint8_t *cpu_base, uint64_t gpu_base, uint64_t size);
+
+  // Fails when the allocator is closed or no page has room; the caller may
+  // add a page and try again.
+  auto Allocate(uint64_t size, uint64_t alignment,
+                LinearAllocation &allocation) -> bool;
+
+  // Everything allocated so far is read by GPU work that signals fence_value.
+  void Close(uint64_t fence_value);
+
+  // Rewinds once completed_fence_value has reached the closing fence. Returns
+  // true when the allocator is open for new allocations.
+  auto Retire(uint64_t completed_fence_value) -> bool;
+
+  // Drops all pages.
+  void Clear();
+
+  auto IsClosed() const -> bool { return closed_; }
+
+  auto GetPageCount() const -> size_t { return pages_.size(); }
+
+  auto GetCapacity() const -> uint64_t { return capacity_; }
+
+  // Bytes handed out since the last rewind, including alignment padding.
+  auto GetUsed() const -> uint64_t { return used_; }
+
+  auto GetPeakUsed() const -> uint64_t { return peak_used_; }
+
+private:
+  struct Page {
+    uint8_t *cpu_base = nullptr;
+    uint64_t gpu_base = 0;
+    uint64_t size = 0;
+  };
+
+  std::vector<Page> pages_ = {};
+
+  size_t current_page_ = 0;
+
+  uint64_t page_offset_ = 0;
+
+  uint64_t capacity_ = 0;
+
+  uint64_t used_ = 0;
+
+  uint64_t peak_used_ = 0;
+
+  uint64_t fence_value_ = 0;
+
+  bool closed_ = false;
+};
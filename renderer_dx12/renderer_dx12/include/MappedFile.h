@@ -0,0 +1,48 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include <Windows.h>
+
+namespace ResourceLoader {
+
+// Read-only Win32 memory mapping of a whole file. The view stays valid until
+// Close() or destruction, so callers can hand pointers into it straight to an
+// upload. Platform-neutral code goes through MapFile in FileSource.h.
+class MappedFile {
+public:
+  MappedFile() = default;
+
+  MappedFile(const MappedFile &rhs) = delete;
+
+  auto operator=(const MappedFile &rhs) -> MappedFile & = delete;
+
+  MappedFile(MappedFile &&rhs) noexcept;
+
+  auto operator=(MappedFile &&rhs) noexcept -> MappedFile &;
+
+  ~MappedFile() { Close(); }
+
+  auto Open(const std::wstring &file_path) -> bool;
+
+  void Close();
+
+  auto IsOpen() const -> bool { return data_ != nullptr; }
+
+  auto GetData() const -> const uint8_t * { return data_; }
+
+  auto GetSize() const -> size_t { return size_; }
+
+private:
+  HANDLE file_handle_ = INVALID_HANDLE_VALUE;
+
+  HANDLE mapping_handle_ = nullptr;
+
+  const uint8_t *data_ = nullptr;
+
+  size_t size_ = 0;
+};
+
+} // namespace ResourceLoader
@@ -0,0 +1,185 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "FileSource.h"
+
+namespace ResourceLoader {
+
+// Binary mesh cache (.mesh). Layout on disk:
+//   MeshFileHeader
+//   MeshAttributeDesc[attribute_count]
+//   vertex blob (aligned to kMeshBlobAlignment)
+//   index blob  (aligned to kMeshBlobAlignment, optional)
+// All values are little-endian and the blobs are already in the final GPU
+// layout, so a mapped file can be copied to an upload heap as-is. Cooked
+// meshes are welded and cache-optimized (see MeshOptimizer.h).
+
+constexpr uint32_t kMeshFileMagic = 0x4853454D; // "MESH"
+constexpr uint32_t kMeshFileVersion = 2;
+constexpr uint32_t kMeshBlobAlignment = 16;
+constexpr uint32_t kMaxMeshAttributes = 8;
+
+enum class MeshAttributeSemantic : uint32_t {
+  Position = 0,
+  TexCoord = 1,
+  Normal = 2,
+  Tangent = 3,
+  Binormal = 4
+};
+
+enum class MeshAttributeFormat : uint32_t { Float2 = 0, Float3 = 1, Float4 = 2 };
+
+struct MeshAttributeDesc {
+  MeshAttributeSemantic semantic;
+  MeshAttributeFormat format;
+  uint32_t offset;
+  uint32_t reserved;
+};
+
+struct MeshFileHeader {
+  uint32_t magic;
+  uint32_t version;
+  uint32_t header_size;
+  uint32_t attribute_count;
+  uint32_t vertex_count;
+  uint32_t vertex_stride;
+  uint32_t index_count;
+  uint32_t index_size; // 0 (non-indexed), 2 or 4
+  uint64_t vertex_offset;
+  uint64_t vertex_bytes;
+  uint64_t index_offset;
+  uint64_t index_bytes;
+  uint64_t source_size;
+  uint64_t source_write_time;
+};
+
+static_assert(sizeof(MeshAttributeDesc) == 16, "MeshAttributeDesc is 16 bytes");
+static_assert(sizeof(MeshFileHeader) == 80, "MeshFileHeader is 80 bytes");
+
+// Vertex layout of the data/*.txt files: position, uv, normal.
+struct MeshSourceVertex {
+  float x, y, z;
+  float tu, tv;
+  float nx, ny, nz;
+};
+
+struct MeshImageDesc {
+  const MeshAttributeDesc *attributes = nullptr;
+  uint32_t attribute_count = 0;
+
+  const void *vertices = nullptr;
+  uint32_t vertex_count = 0;
+  uint32_t vertex_stride = 0;
+
+  const void *indices = nullptr;
+  uint32_t index_count = 0;
+  uint32_t index_size = 0;
+
+  FileStamp source = {};
+};
+
+auto GetSourceMeshAttributes(uint32_t &attribute_count)
+    -> const MeshAttributeDesc *;
+
+auto BuildMeshImage(const MeshImageDesc &desc, std::vector<uint8_t> &image)
+    -> bool;
+
+// Returns the header when the image is a well-formed .mesh of this version.
+auto ValidateMeshImage(const uint8_t *data, size_t size)
+    -> const MeshFileHeader *;
+
+class MeshFile {
+public:
+  MeshFile() = default;
+
+  MeshFile(const MeshFile &rhs) = delete;
+
+  auto operator=(const MeshFile &rhs) -> MeshFile & = delete;
+
+  ~MeshFile() = default;
+
+  auto Open(const std::wstring &mesh_path) -> bool;
+
+  auto OpenFromImage(std::vector<uint8_t> image) -> bool;
+
+  auto OpenFromData(FileData data) -> bool;
+
+  void Close();
+
+  auto IsOpen() const -> bool { return header_ != nullptr; }
+
+  auto IsUpToDate(const FileStamp &source) const -> bool;
+
+  // True when the vertex blob is exactly MeshSourceVertex.
+  auto HasSourceLayout() const -> bool;
+
+  auto GetAttributeCount() const -> uint32_t {
+    return header_->attribute_count;
+  }
+
+  auto GetAttributes() const -> const MeshAttributeDesc *;
+
+  auto GetVertexCount() const -> uint32_t { return header_->vertex_count; }
+
+  auto GetVertexStride() const -> uint32_t { return header_->vertex_stride; }
+
+  auto GetVertexData() const -> const void *;
+
+  // Scatters source-layout vertices to destination + i * stride, for vertex
+  // types that start with position/uv/normal.
+  auto CopySourceVertices(void *destination, size_t stride) const -> bool;
+
+  auto GetVertexBytes() const -> size_t {
+    return static_cast<size_t>(header_->vertex_bytes);
+  }
+
+  auto GetIndexCount() const -> uint32_t { return header_->index_count; }
+
+  auto GetIndexSize() const -> uint32_t { return header_->index_size; }
+
+  auto GetIndexData() const -> const void *;
+
+  // Widens the index blob to 32 bits; non-indexed meshes get 0..N-1.
+  auto CopyIndices(std::vector<uint32_t> &indices) const -> bool;
+
+  auto GetIndexBytes() const -> size_t {
+    return static_cast<size_t>(header_->index_bytes);
+  }
+
+private:
+  auto GetImageData() const -> const uint8_t * { return data_.GetData(); }
+
+  FileData data_;
+
+  const MeshFileHeader *header_ = nullptr;
+};
+
+auto GetMeshCachePath(const std::wstring &text_path) -> std::wstring;
+
+auto LoadTextMesh(const std::wstring &text_path,
+                  std::vector<MeshSourceVertex> &vertices) -> bool;
+
+// Parses, welds and cache-optimizes an in-memory data/*.txt mesh into a .mesh
+// image. text_path is only used for log messages.
+auto CookTextMeshImage(const std::wstring &text_path, const FileData &text,
+                       const FileStamp &source, std::vector<uint8_t> &image)
+    -> bool;
+
+// Opens a unit cube in the source layout, drawn while the real mesh streams
+// in.
+auto OpenPlaceholderMesh(MeshFile &mesh) -> bool;
+
+// Converts a data/*.txt mesh into its .mesh cache.
+auto CookTextMesh(const std::wstring &text_path, const std::wstring &mesh_path)
+    -> bool;
+
+// Maps the .mesh cache next to text_path, (re)cooking it first when it is
+// missing or older than the text source. Falls back to an in-memory image if
+// the cache cannot be written.
+auto OpenCookedMesh(const std::wstring &text_path, MeshFile &mesh) -> bool;
+
+} // namespace ResourceLoader
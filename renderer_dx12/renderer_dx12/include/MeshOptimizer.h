@@ -0,0 +1,62 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace ResourceLoader {
+
+// Load-time mesh optimization for triangle lists. Vertices are treated as
+// opaque byte records of a fixed stride, so every model layout can share it.
+
+constexpr uint32_t kVertexCacheSize = 32;
+
+struct VertexCacheStats {
+  // Average cache miss ratio: transformed vertices per triangle (0.5 - 3.0).
+  float acmr = 0.0f;
+  // Average transform to vertex ratio: transformed vertices per unique vertex.
+  float atvr = 0.0f;
+};
+
+struct MeshOptimizationStats {
+  uint32_t input_vertex_count = 0;
+  uint32_t vertex_count = 0;
+  uint32_t index_count = 0;
+  uint32_t index_size = 0;
+  VertexCacheStats before = {};
+  VertexCacheStats after = {};
+};
+
+// Merges bitwise-identical vertices in place and emits one index per input
+// vertex. Returns the welded vertex count.
+auto WeldVertices(std::vector<uint8_t> &vertices, uint32_t stride,
+                  std::vector<uint32_t> &indices) -> uint32_t;
+
+// Reorders triangles for post-transform cache locality (Forsyth's linear-speed
+// algorithm) without changing the set of triangles.
+void OptimizeVertexCache(std::vector<uint32_t> &indices, uint32_t vertex_count);
+
+// Reorders vertices into first-use order of the index buffer and drops
+// unreferenced ones. Returns the new vertex count.
+auto OptimizeVertexFetch(std::vector<uint8_t> &vertices, uint32_t stride,
+                         std::vector<uint32_t> &indices) -> uint32_t;
+
+// Simulates a FIFO post-transform cache of the given size.
+auto AnalyzeVertexCache(const std::vector<uint32_t> &indices,
+                        uint32_t vertex_count,
+                        uint32_t cache_size = kVertexCacheSize)
+    -> VertexCacheStats;
+
+// 2 when every index fits in 16 bits, 4 otherwise.
+auto SelectIndexSize(uint32_t vertex_count) -> uint32_t;
+
+// Packs indices to 16 or 32 bits according to SelectIndexSize.
+auto PackIndices(const std::vector<uint32_t> &indices, uint32_t vertex_count,
+                 std::vector<uint8_t> &packed) -> uint32_t;
+
+// Weld, cache-optimize and fetch-optimize a non-indexed triangle list.
+auto OptimizeMesh(std::vector<uint8_t> &vertices, uint32_t stride,
+                  std::vector<uint32_t> &indices,
+                  MeshOptimizationStats &stats) -> bool;
+
+} // namespace ResourceLoader
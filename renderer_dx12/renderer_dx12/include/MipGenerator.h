@@ -0,0 +1,61 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+class JobSystem;
+
+namespace ResourceLoader {
+
+// What a texture's channels hold, which decides how its mips are filtered.
+enum class TextureUsage {
+  // sRGB-encoded color with linear alpha (albedo, diffuse). Color is filtered
+  // in linear light.
+  kColor,
+  // Data such as roughness/metal or specular masks. Every channel is filtered
+  // on its own, as stored.
+  kLinear,
+  // Tangent-space normals in xyz. Each level is renormalized after filtering.
+  kNormalMap,
+};
+
+enum class MipFilter {
+  // Area average of the source texels under each destination texel.
+  kBox,
+  // Kaiser-windowed sinc; sharper, with less aliasing than the box.
+  kKaiser,
+};
+
+struct MipOptions {
+  TextureUsage usage = TextureUsage::kColor;
+  MipFilter filter = MipFilter::kKaiser;
+  // Levels larger than a few thousand texels are split across the job
+  // system passed to GenerateMipChain by rows.
+  bool allow_parallel = true;
+};
+
+// One level of an 8-bit, four-channel mip chain; rows are tightly packed.
+struct MipLevel {
+  size_t offset = 0;
+  uint32_t width = 0;
+  uint32_t height = 0;
+};
+
+auto GetMipLevelCount(uint32_t width, uint32_t height) -> uint32_t;
+
+// Lays out every level from width x height down to 1x1, level 0 first, and
+// returns the total size in bytes.
+auto LayoutMipChain(uint32_t width, uint32_t height,
+                    std::vector<MipLevel> &levels) -> size_t;
+
+// Fills levels 1 and up of pixels from level 0. Channels 0-2 are color (RGBA
+// and BGRA both work) and channel 3 is alpha. Each level is filtered from the
+// previous one, kept in float between levels so rounding does not build up.
+// Streaming loads pass their own pool, so a frame waiting on another one
+// never picks up their rows.
+auto GenerateMipChain(JobSystem &job_system, uint8_t *pixels,
+                      const std::vector<MipLevel> &levels,
+                      const MipOptions &options) -> bool;
+
+} // namespace ResourceLoader
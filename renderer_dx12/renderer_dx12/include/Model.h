@@ -4,11 +4,18 @@
 #include <memory>
 #include <vector>
 
+#include "ModelAssets.h"
 #include "ModelMaterial.h"
 #include "TextureLoader.h"
 
 class DirectX12Device;
 
+namespace ResourceLoader {
+
+class MeshFile;
+
+} // namespace ResourceLoader
+
 class Model {
 public:
   explicit Model(std::shared_ptr<DirectX12Device> device)
@@ -27,51 +34,39 @@ private:
     DirectX::XMFLOAT3 normal_;
   };
 
-  struct ModelType {
-    float x_, y_, z_;
-    float tu_, tv_;
-    float nx_, ny_, nz_;
-  };
-
 public:
+  // Returns with the placeholder cube and textures in place; the real assets
+  // stream in and are swapped in between frames.
   auto Initialize(WCHAR *model_filename, WCHAR **texture_filename_arr) -> bool;
 
-  auto GetIndexCount() const -> UINT { return index_count_; }
+  auto GetIndexCount() const -> UINT { return mesh_->index_count; }
+
+  auto GetWorldBounds(const DirectX::XMMATRIX &world) const
+      -> BoundingVolume {
+    return ComputeWorldBounds(*mesh_, world);
+  }
 
   auto GetMaterial() -> ModelMaterial * { return &material_; }
 
-  auto GetShaderResourceView() const -> DescriptorHeapPtr;
+  auto GetShaderResourceView() const -> D3D12_GPU_DESCRIPTOR_HANDLE;
   
   auto GetVertexBufferView() const -> const D3D12_VERTEX_BUFFER_VIEW & {
-    return vertex_buffer_view_;
+    return mesh_->vertex_buffer_view;
   }
 
   auto GetIndexBufferView() const -> const D3D12_INDEX_BUFFER_VIEW & {
-    return index_buffer_view_;
+    return mesh_->index_buffer_view;
   }
 
 private:
-  auto LoadModel(WCHAR *filename) -> bool;
-
-  auto InitializeBuffers() -> bool;
-
-  auto LoadTexture(WCHAR **texture_filename_arr) -> bool;
+  auto BuildMeshBuffers(const ResourceLoader::MeshFile &mesh,
+                        MeshBuffers &buffers) const -> bool;
 
   std::shared_ptr<DirectX12Device> device_ = nullptr;
 
   ModelMaterial material_;
 
-  ResourceSharedPtr vertex_buffer_ = nullptr;
-  D3D12_VERTEX_BUFFER_VIEW vertex_buffer_view_ = {};
-
-  ResourceSharedPtr index_buffer_ = nullptr;
-  D3D12_INDEX_BUFFER_VIEW index_buffer_view_ = {};
-
-  UINT vertex_count_ = 0;
-
-  UINT index_count_ = 0;
-
-  std::vector<ModelType> temp_model_;
+  MeshHandle mesh_ = nullptr;
 
   std::shared_ptr<ResourceLoader::TextureLoader> texture_container_ = nullptr;
 };
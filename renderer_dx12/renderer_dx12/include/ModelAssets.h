@@ -0,0 +1,96 @@
+#pragma once
+
+#include <DirectXMath.h>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "FrustumCulling.h"
+#include "MipGenerator.h"
+#include "Task.h"
+#include "TypeDefine.h"
+
+class DirectX12Device;
+
+namespace ResourceLoader {
+
+class AssetStreamer;
+
+class MeshFile;
+
+class TextureLoader;
+
+} // namespace ResourceLoader
+
+// Vertex and index buffers of one model, ready to bind.
+struct MeshBuffers {
+  ResourceSharedPtr vertex_buffer = nullptr;
+  ResourceSharedPtr index_buffer = nullptr;
+
+  D3D12_VERTEX_BUFFER_VIEW vertex_buffer_view = {};
+  D3D12_INDEX_BUFFER_VIEW index_buffer_view = {};
+
+  UINT index_count = 0;
+
+  // Model space, computed from the vertices when they are uploaded.
+  BoundingVolume bounds = {};
+};
+
+// Shared through the asset registry: every model drawing the same mesh file
+// in the same layout holds the same buffers.
+using MeshHandle = std::shared_ptr<const MeshBuffers>;
+
+// Vertex layout a MeshBufferBuilder produces. Models whose builders produce
+// the same layout share uploaded meshes.
+enum class MeshLayout : uint32_t {
+  // Position, texcoord, normal: the mesh cache's own layout.
+  kSource,
+  // kSource plus a tangent with the bitangent sign in w.
+  kTangentFrame,
+};
+
+// Turns a source-layout mesh into a model's own vertex format and uploads it.
+// Called from streaming workers, so it must not touch the model's live state.
+using MeshBufferBuilder = std::function<bool(
+    const ResourceLoader::MeshFile &mesh, MeshBuffers &buffers)>;
+
+// Uploads vertices (already in the model's format) together with the mesh's
+// index blob as stored.
+auto CreateMeshBuffers(DirectX12Device &device, const void *vertices,
+                       UINT vertex_stride, UINT vertex_count,
+                       const ResourceLoader::MeshFile &mesh,
+                       MeshBuffers &buffers) -> bool;
+
+// Bounds of mesh placed by world, which is not transposed.
+auto ComputeWorldBounds(const MeshBuffers &mesh,
+                        const DirectX::XMMATRIX &world) -> BoundingVolume;
+
+// Main thread only. The replaced buffers are released once the frames that
+// may still draw them have retired.
+void ReplaceMeshBuffers(DirectX12Device &device, MeshHandle &current,
+                        MeshHandle next);
+
+// Gives a model something to draw right away: the placeholder cube and
+// texture_count views of a white texture.
+auto CreatePlaceholderAssets(const MeshBufferBuilder &build_mesh,
+                             MeshLayout mesh_layout,
+                             unsigned int texture_count, MeshHandle &mesh,
+                             ResourceLoader::TextureLoader &textures) -> bool;
+
+// Loads a model's mesh and textures on the streamer's workers and swaps them
+// in on the main thread. A failed load is logged and leaves the placeholders
+// in place. texture_usages picks how each texture's mips are filtered (color
+// when missing). A mesh another model already loaded in mesh_layout is shared
+// rather than built again. mesh and textures must outlive the task (see
+// AssetStreamer::WaitIdle).
+auto StreamModelAssets(DirectX12Device &device,
+                       ResourceLoader::AssetStreamer &streamer,
+                       std::wstring model_path,
+                       std::vector<std::wstring> texture_paths,
+                       MeshBufferBuilder build_mesh, MeshLayout mesh_layout,
+                       MeshHandle &mesh,
+                       ResourceLoader::TextureLoader &textures,
+                       std::vector<ResourceLoader::TextureUsage>
+                           texture_usages = {}) -> Task<void>;
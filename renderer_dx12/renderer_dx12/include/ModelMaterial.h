@@ -2,6 +2,7 @@
 
 #include <DirectXMath.h>
 #include <memory>
+#include <vector>
 
 #include "ConstantBuffer.h"
 #include "Material.h"
@@ -24,16 +25,27 @@ public:
 
   auto Initialize() -> bool override;
 
-  auto GetMatrixConstantBuffer() const -> ResourceSharedPtr {
-    return matrix_constant_buffer_.GetResource();
+  // Optional, set before Initialize. Also builds "model_instanced", which
+  // reads an InstanceBuffer bound at kInstanceStreamSlot.
+  void SetInstancedShaders(const VertexShaderByteCode &vertex_shader,
+                           const PixelShaderByteCode &pixel_shader);
+
+  // Optional, set before Initialize. Also builds "model_clustered", which
+  // adds the local lights of a Lighting::ClusteredLightGrid: its constants
+  // at root parameter 4, then its light, index and range buffers as root
+  // shader resource views.
+  void SetClusteredPixelShader(const PixelShaderByteCode &pixel_shader);
+
+  auto GetMatrixConstantBufferAddress() const -> D3D12_GPU_VIRTUAL_ADDRESS {
+    return matrix_constant_buffer_.GetGPUVirtualAddress();
   }
 
-  auto GetLightConstantBuffer() const -> ResourceSharedPtr {
-    return light_constant_buffer_.GetResource();
+  auto GetLightConstantBufferAddress() const -> D3D12_GPU_VIRTUAL_ADDRESS {
+    return light_constant_buffer_.GetGPUVirtualAddress();
   }
 
-  auto GetFogConstantBuffer() const -> ResourceSharedPtr {
-    return fog_constant_buffer_.GetResource();
+  auto GetFogConstantBufferAddress() const -> D3D12_GPU_VIRTUAL_ADDRESS {
+    return fog_constant_buffer_.GetGPUVirtualAddress();
   }
 
   auto UpdateMatrixConstant(const DirectX::XMMATRIX &world,
@@ -74,8 +86,20 @@ private:
 
   auto InitializeGraphicsPipelineState() -> bool;
 
+  auto BuildPipelineState(
+      const VertexShaderByteCode &vertex_shader,
+      const PixelShaderByteCode &pixel_shader,
+      const std::vector<D3D12_INPUT_ELEMENT_DESC> &input_elements,
+      PipelineStateObjectPtr &pso) -> bool;
+
   std::shared_ptr<DirectX12Device> device_ = nullptr;
 
+  VertexShaderByteCode instanced_vs_bytecode_ = {};
+
+  PixelShaderByteCode instanced_ps_bytecode_ = {};
+
+  PixelShaderByteCode clustered_ps_bytecode_ = {};
+
   ConstantBuffer<MatrixBufferType> matrix_constant_buffer_ = {};
   MatrixBufferType matrix_constant_data_ = {};
 
@@ -2,6 +2,7 @@
 
 #include <DirectXMath.h>
 #include <memory>
+#include <vector>
 
 #include "ConstantBuffer.h"
 #include "Material.h"
@@ -24,6 +25,15 @@ public:
 
   auto Initialize() -> bool override;
 
+  // Optional, set before Initialize. Also builds "pbr_instanced", which
+  // reads an InstanceBuffer bound at kInstanceStreamSlot.
+  void SetInstancedShaders(const VertexShaderByteCode &vertex_shader,
+                           const PixelShaderByteCode &pixel_shader);
+
+  // Optional, set before Initialize. Also builds "pbr_clustered", laid out
+  // like ModelMaterial's "model_clustered".
+  void SetClusteredPixelShader(const PixelShaderByteCode &pixel_shader);
+
   auto UpdateMatrixConstant(const DirectX::XMMATRIX &world,
                             const DirectX::XMMATRIX &view,
                             const DirectX::XMMATRIX &projection) -> bool;
@@ -35,17 +45,23 @@ public:
   // New unified light interface - extract parameters from SceneLight
   auto UpdateFromLight(const Lighting::SceneLight *scene_light) -> bool;
 
-  auto GetMatrixConstantBuffer() const -> ResourceSharedPtr;
+  auto GetMatrixConstantBufferAddress() const -> D3D12_GPU_VIRTUAL_ADDRESS;
 
-  auto GetCameraConstantBuffer() const -> ResourceSharedPtr;
+  auto GetCameraConstantBufferAddress() const -> D3D12_GPU_VIRTUAL_ADDRESS;
 
-  auto GetLightConstantBuffer() const -> ResourceSharedPtr;
+  auto GetLightConstantBufferAddress() const -> D3D12_GPU_VIRTUAL_ADDRESS;
 
 private:
   auto InitializeRootSignature() -> bool;
 
   auto InitializeGraphicsPipelineState() -> bool;
 
+  auto BuildPipelineState(
+      const VertexShaderByteCode &vertex_shader,
+      const PixelShaderByteCode &pixel_shader,
+      const std::vector<D3D12_INPUT_ELEMENT_DESC> &input_elements,
+      PipelineStateObjectPtr &pso) -> bool;
+
   struct MatrixBufferType {
     DirectX::XMFLOAT4X4 world_;
     DirectX::XMFLOAT4X4 view_;
@@ -63,6 +79,12 @@ private:
 
   std::shared_ptr<DirectX12Device> device_ = nullptr;
 
+  VertexShaderByteCode instanced_vs_bytecode_ = {};
+
+  PixelShaderByteCode instanced_ps_bytecode_ = {};
+
+  PixelShaderByteCode clustered_ps_bytecode_ = {};
+
   ConstantBuffer<MatrixBufferType> matrix_constant_buffer_;
   MatrixBufferType matrix_constant_data_ = {};
 
@@ -0,0 +1,91 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include "PipelineDescription.h"
+#include "TypeDefine.h"
+
+struct PipelineCacheStats {
+  uint64_t root_signature_hits = 0;
+  uint64_t root_signature_misses = 0;
+  size_t root_signature_count = 0;
+  uint64_t pipeline_state_hits = 0;
+  uint64_t pipeline_state_misses = 0;
+  size_t pipeline_state_count = 0;
+};
+
+// A D3D12 desc translated into a GraphicsPipelineDescription, together with
+// the arrays the description points into. Shader bytecode and strings are
+// still borrowed from the desc.
+struct DescribedGraphicsPipeline {
+  GraphicsPipelineDescription description = {};
+  std::vector<PipelineInputElement> input_elements = {};
+  std::vector<PipelineStreamOutputEntry> stream_output_entries = {};
+};
+
+void DescribeGraphicsPipeline(const D3D12_GRAPHICS_PIPELINE_STATE_DESC &desc,
+                              DescribedGraphicsPipeline &described);
+
+// The key of CanonicalizePipelineDescription for a D3D12 desc. The root
+// signature is keyed by address.
+void CanonicalizeGraphicsPipelineDesc(
+    const D3D12_GRAPHICS_PIPELINE_STATE_DESC &desc, std::vector<uint8_t> &key);
+
+// Hash-consed root signatures and graphics pipeline states for one device.
+//
+// Root signatures are keyed by their serialized blob and pipeline states by
+// their canonical desc, so materials that describe the same state share one
+// object. Entries live as long as the cache. Thread-safe; creation runs
+// outside the lock, and when two threads race on one key the first object
+// in wins.
+class PipelineCache {
+public:
+  PipelineCache() = default;
+
+  PipelineCache(const PipelineCache &rhs) = delete;
+
+  auto operator=(const PipelineCache &rhs) -> PipelineCache & = delete;
+
+  ~PipelineCache() = default;
+
+  auto GetRootSignature(ID3D12Device *device, const void *serialized,
+                        size_t size, RootSignaturePtr &root_signature) -> bool;
+
+  auto GetGraphicsPipelineState(ID3D12Device *device,
+                                const D3D12_GRAPHICS_PIPELINE_STATE_DESC &desc,
+                                PipelineStateObjectPtr &pipeline_state)
+      -> bool;
+
+  auto GetStats() const -> PipelineCacheStats;
+
+  void LogStats() const;
+
+  void Clear();
+
+private:
+  struct RootSignatureEntry {
+    std::vector<uint8_t> key;
+    RootSignaturePtr root_signature;
+  };
+
+  struct PipelineStateEntry {
+    std::vector<uint8_t> key;
+    PipelineStateObjectPtr pipeline_state;
+    // Keeps the address in key from being reused by another root signature.
+    RootSignaturePtr root_signature;
+  };
+
+  mutable std::mutex mutex_;
+
+  std::unordered_map<uint64_t, std::vector<RootSignatureEntry>>
+      root_signatures_ = {};
+
+  std::unordered_map<uint64_t, std::vector<PipelineStateEntry>>
+      pipeline_states_ = {};
+
+  PipelineCacheStats stats_ = {};
+};
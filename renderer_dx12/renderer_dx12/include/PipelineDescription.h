@@ -0,0 +1,136 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// A graphics pipeline described with plain integers, so it can be compared and
+// hashed without the D3D12 headers. Enum fields hold the D3D12 enum values and
+// formats hold DXGI_FORMAT values; PipelineCache fills this in from a
+// D3D12_GRAPHICS_PIPELINE_STATE_DESC. Pointers are borrowed and must outlive
+// the call that reads them.
+
+constexpr uint32_t kPipelineRenderTargetCount = 8;
+
+struct PipelineBytecode {
+  const void *data = nullptr;
+  size_t size = 0;
+};
+
+struct PipelineRenderTargetBlend {
+  uint32_t blend_enable = 0;
+  uint32_t logic_op_enable = 0;
+  uint32_t src_blend = 0;
+  uint32_t dest_blend = 0;
+  uint32_t blend_op = 0;
+  uint32_t src_blend_alpha = 0;
+  uint32_t dest_blend_alpha = 0;
+  uint32_t blend_op_alpha = 0;
+  uint32_t logic_op = 0;
+  uint8_t write_mask = 0;
+};
+
+struct PipelineBlendState {
+  uint32_t alpha_to_coverage_enable = 0;
+  uint32_t independent_blend_enable = 0;
+  PipelineRenderTargetBlend render_targets[kPipelineRenderTargetCount] = {};
+};
+
+struct PipelineRasterizerState {
+  uint32_t fill_mode = 0;
+  uint32_t cull_mode = 0;
+  uint32_t front_counter_clockwise = 0;
+  int32_t depth_bias = 0;
+  float depth_bias_clamp = 0.0f;
+  float slope_scaled_depth_bias = 0.0f;
+  uint32_t depth_clip_enable = 0;
+  uint32_t multisample_enable = 0;
+  uint32_t antialiased_line_enable = 0;
+  uint32_t forced_sample_count = 0;
+  uint32_t conservative_raster = 0;
+};
+
+struct PipelineStencilFace {
+  uint32_t fail_op = 0;
+  uint32_t depth_fail_op = 0;
+  uint32_t pass_op = 0;
+  uint32_t func = 0;
+};
+
+struct PipelineDepthStencilState {
+  uint32_t depth_enable = 0;
+  uint32_t depth_write_mask = 0;
+  uint32_t depth_func = 0;
+  uint32_t stencil_enable = 0;
+  uint8_t stencil_read_mask = 0;
+  uint8_t stencil_write_mask = 0;
+  PipelineStencilFace front_face = {};
+  PipelineStencilFace back_face = {};
+};
+
+struct PipelineInputElement {
+  const char *semantic_name = nullptr;
+  uint32_t semantic_index = 0;
+  uint32_t format = 0;
+  uint32_t input_slot = 0;
+  uint32_t aligned_byte_offset = 0;
+  uint32_t input_slot_class = 0;
+  uint32_t instance_data_step_rate = 0;
+};
+
+struct PipelineStreamOutputEntry {
+  uint32_t stream = 0;
+  const char *semantic_name = nullptr;
+  uint32_t semantic_index = 0;
+  uint8_t start_component = 0;
+  uint8_t component_count = 0;
+  uint8_t output_slot = 0;
+};
+
+struct PipelineStreamOutput {
+  const PipelineStreamOutputEntry *entries = nullptr;
+  uint32_t entry_count = 0;
+  const uint32_t *buffer_strides = nullptr;
+  uint32_t stride_count = 0;
+  uint32_t rasterized_stream = 0;
+};
+
+struct GraphicsPipelineDescription {
+  // Identity of the root signature; canonical for root signatures handed out
+  // by the PipelineCache.
+  uintptr_t root_signature = 0;
+  PipelineBytecode vertex_shader = {};
+  PipelineBytecode pixel_shader = {};
+  PipelineBytecode domain_shader = {};
+  PipelineBytecode hull_shader = {};
+  PipelineBytecode geometry_shader = {};
+  PipelineStreamOutput stream_output = {};
+  PipelineBlendState blend = {};
+  uint32_t sample_mask = 0;
+  PipelineRasterizerState rasterizer = {};
+  PipelineDepthStencilState depth_stencil = {};
+  const PipelineInputElement *input_elements = nullptr;
+  uint32_t input_element_count = 0;
+  uint32_t strip_cut_value = 0;
+  uint32_t primitive_topology_type = 0;
+  uint32_t render_target_count = 0;
+  uint32_t render_target_formats[kPipelineRenderTargetCount] = {};
+  uint32_t depth_stencil_format = 0;
+  uint32_t sample_count = 0;
+  uint32_t sample_quality = 0;
+  uint32_t node_mask = 0;
+  PipelineBytecode cached_pipeline = {};
+  uint32_t flags = 0;
+};
+
+// Bytes that compare equal exactly when two descriptions build the same
+// pipeline. Pointers are followed (shader bytecode, input layout, stream
+// output) and fields the pipeline ignores are left out: unused render target
+// formats, blend targets past the first without independent blending, blend
+// factors of targets with blending off, depth and stencil state that is
+// disabled. Fields are written one by one, so struct padding never reaches
+// the key.
+void CanonicalizePipelineDescription(
+    const GraphicsPipelineDescription &description, std::vector<uint8_t> &key);
+
+auto HashPipelineKey(const std::vector<uint8_t> &key) -> uint64_t;
@@ -42,6 +42,11 @@ public:
   
   void SetDepthStencilState(const D3D12_DEPTH_STENCIL_DESC &depth_desc);
 
+  auto GetDesc() const -> const D3D12_GRAPHICS_PIPELINE_STATE_DESC & {
+    return desc_;
+  }
+
+  // Returns the device's shared pipeline state for this description.
   auto Build(const std::shared_ptr<DirectX12Device> &device,
              PipelineStateObjectPtr &pipeline_state) const -> bool;
 
@@ -2,11 +2,19 @@
 
 #include <DirectXMath.h>
 #include <memory>
+#include <vector>
 
+#include "ModelAssets.h"
 #include "TextureLoader.h"
 
 class DirectX12Device;
 
+namespace ResourceLoader {
+
+class MeshFile;
+
+} // namespace ResourceLoader
+
 class ReflectionModel {
 public:
   explicit ReflectionModel(std::shared_ptr<DirectX12Device> device);
@@ -15,24 +23,32 @@ public:
 
   auto operator=(const ReflectionModel &rhs) -> ReflectionModel & = delete;
 
-  ~ReflectionModel();
+  ~ReflectionModel() = default;
 
+  // Returns with placeholders in place; the real mesh and textures stream in.
   auto Initialize(WCHAR *model_filename, WCHAR **texture_filename_arr,
                   unsigned int texture_count) -> bool;
 
-  auto GetIndexCount() const -> UINT { return index_count_; }
+  auto GetIndexCount() const -> UINT { return mesh_->index_count; }
+
+  auto GetWorldBounds(const DirectX::XMMATRIX &world) const
+      -> BoundingVolume {
+    return ComputeWorldBounds(*mesh_, world);
+  }
 
   const D3D12_VERTEX_BUFFER_VIEW &GetVertexBufferView() const {
-    return vertex_buffer_view_;
+    return mesh_->vertex_buffer_view;
   }
 
   const D3D12_INDEX_BUFFER_VIEW &GetIndexBufferView() const {
-    return index_buffer_view_;
+    return mesh_->index_buffer_view;
   }
 
-  auto GetShaderResourceView() const -> DescriptorHeapPtr;
+  auto GetShaderResourceView() const -> D3D12_GPU_DESCRIPTOR_HANDLE;
 
-  auto GetTextureResource(size_t index) const -> ResourceSharedPtr;
+  // Staging view of texture index, for tables built by the scene.
+  auto GetTextureStagingView(size_t index) const
+      -> D3D12_CPU_DESCRIPTOR_HANDLE;
 
 private:
   struct VertexType {
@@ -41,34 +57,13 @@ private:
     DirectX::XMFLOAT3 normal;
   };
 
-  struct ModelType {
-    float x, y, z;
-    float tu, tv;
-    float nx, ny, nz;
-  };
-
-  auto LoadModel(WCHAR *filename) -> bool;
-
-  auto InitializeBuffers() -> bool;
-
-  auto LoadTextures(WCHAR **texture_filename_arr, unsigned int texture_count) -> bool;
-
-  void ReleaseModel();
+  auto BuildMeshBuffers(const ResourceLoader::MeshFile &mesh,
+                        MeshBuffers &buffers) const -> bool;
 
 private:
   std::shared_ptr<DirectX12Device> device_ = nullptr;
 
-  ResourceSharedPtr vertex_buffer_ = nullptr;
-  D3D12_VERTEX_BUFFER_VIEW vertex_buffer_view_ = {};
-
-  ResourceSharedPtr index_buffer_ = nullptr;
-  D3D12_INDEX_BUFFER_VIEW index_buffer_view_ = {};
-
-  UINT vertex_count_ = 0;
-  
-  UINT index_count_ = 0;
-
-  ModelType *model_data_ = nullptr;
+  MeshHandle mesh_ = nullptr;
 
   std::shared_ptr<ResourceLoader::TextureLoader> texture_loader_ = nullptr;
 };
@@ -43,12 +43,19 @@ public:
 
   auto SetRotationAngle(float radians) -> void { rotation_radians_ = radians; }
 
+  // Both empty until Initialize succeeds.
+  auto GetCubeWorldBounds() const -> BoundingVolume;
+
+  auto GetFloorWorldBounds() const -> BoundingVolume;
+
 private:
   auto EnsureShadersLoaded() -> bool;
 
-  auto RenderReflectionTexture(const DirectX::XMMATRIX &projection) -> bool;
+  auto GetCubeWorldMatrix() const -> DirectX::XMMATRIX;
 
-  auto BuildFloorDescriptorHeap() -> bool;
+  auto GetFloorWorldMatrix() const -> DirectX::XMMATRIX;
+
+  auto RenderReflectionTexture(const DirectX::XMMATRIX &projection) -> bool;
 
 private:
   std::shared_ptr<DirectX12Device> device_ = nullptr;
@@ -67,8 +74,6 @@ private:
   
   std::shared_ptr<ReflectionFloorMaterial> floor_material_ = nullptr;
 
-  DescriptorHeapPtr floor_descriptor_heap_ = nullptr;
-
   bool shaders_loaded_ = false;
 
   float rotation_radians_ = 0.0f;
@@ -0,0 +1,167 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Layers of a pass, drawn in this order.
+enum class RenderLayer : uint32_t {
+  // Grouped by pipeline state, root signature and material, front to back
+  // within a group.
+  kOpaque = 0,
+  // Back to front, state only breaks ties between equal depths.
+  kBlended,
+  // Submission order, for screen-space UI drawn over everything else.
+  kOverlay,
+};
+
+// One draw. The state ids index tables kept by whoever replays the queue;
+// the queue only compares them.
+struct DrawPacket {
+  uint32_t pipeline_state = 0;
+  uint32_t root_signature = 0;
+  // Everything bound through root parameters.
+  uint32_t material = 0;
+  // Vertex and index buffers.
+  uint32_t geometry = 0;
+  uint32_t index_count = 0;
+  uint32_t instance_count = 1;
+  uint32_t start_index = 0;
+  int32_t base_vertex = 0;
+};
+
+struct RenderQueueStats {
+  uint64_t draws = 0;
+  uint64_t root_signature_binds = 0;
+  uint64_t pipeline_state_binds = 0;
+  uint64_t material_binds = 0;
+  uint64_t geometry_binds = 0;
+};
+
+// Sort key layout, most significant bits first:
+//
+//   opaque:           pass:4 layer:2 pso:11 root:8 material:15 depth:24
+//   blended, overlay: pass:4 layer:2 depth:24 pso:11 root:8 material:15
+//
+// Blended draws store the inverted depth and overlay draws their submission
+// index in the depth field. Ids wider than their field wrap; replay compares
+// the packets themselves, so that costs batching but never correctness.
+constexpr uint32_t kDrawSortPassBits = 4;
+constexpr uint32_t kDrawSortLayerBits = 2;
+constexpr uint32_t kDrawSortPipelineStateBits = 11;
+constexpr uint32_t kDrawSortRootSignatureBits = 8;
+constexpr uint32_t kDrawSortMaterialBits = 15;
+constexpr uint32_t kDrawSortDepthBits = 24;
+
+constexpr uint32_t kMaxDrawSortPasses = 1u << kDrawSortPassBits;
+
+auto MakeDrawSortKey(uint32_t pass, RenderLayer layer, uint32_t depth,
+                     const DrawPacket &packet) -> uint64_t;
+
+// View-space depth in [0, max_depth] to the key's depth field, clamped.
+auto QuantizeDrawDepth(float depth, float max_depth) -> uint32_t;
+
+// Sorts 64-bit keys with their payload indices. LSD radix over bytes, so it
+// is stable; bytes every key shares are skipped, which leaves the pass and
+// layer bytes of a typical frame free.
+struct DrawSortEntry {
+  uint64_t key = 0;
+  uint32_t packet = 0;
+};
+
+void RadixSortDrawEntries(std::vector<DrawSortEntry> &entries,
+                          std::vector<DrawSortEntry> &scratch);
+
+// Draw packets of one frame, sorted to minimise state changes.
+//
+// Submit every draw, Sort once, then Replay each pass. Replay only calls the
+// recorder when a bound id changes, and rebinds the material after a root
+// signature change since that clears every root parameter. Replays of
+// different passes may run in parallel; Submit and Sort may not.
+class RenderQueue {
+public:
+  RenderQueue() = default;
+
+  RenderQueue(const RenderQueue &rhs) = delete;
+
+  auto operator=(const RenderQueue &rhs) -> RenderQueue & = delete;
+
+  ~RenderQueue() = default;
+
+  // Keeps the storage for the next frame.
+  void Clear();
+
+  void Reserve(size_t packet_count);
+
+  // depth comes from QuantizeDrawDepth and is ignored for overlay draws.
+  // pass must be below kMaxDrawSortPasses.
+  void Submit(uint32_t pass, RenderLayer layer, uint32_t depth,
+              const DrawPacket &packet);
+
+  void Sort();
+
+  auto GetPacketCount() const -> size_t { return packets_.size(); }
+
+  // The recorder provides SetRootSignature(id), SetPipelineState(id),
+  // BindMaterial(id), BindGeometry(id) and Draw(const DrawPacket &).
+  template <typename Recorder>
+  auto Replay(uint32_t pass, Recorder &recorder) const -> RenderQueueStats;
+
+private:
+  static constexpr uint32_t kUnbound = ~0u;
+
+  void GetPassRange(uint32_t pass, size_t &begin, size_t &end) const;
+
+  std::vector<DrawPacket> packets_ = {};
+
+  std::vector<DrawSortEntry> entries_ = {};
+
+  std::vector<DrawSortEntry> scratch_ = {};
+
+  uint32_t overlay_count_ = 0;
+};
+
+template <typename Recorder>
+auto RenderQueue::Replay(uint32_t pass, Recorder &recorder) const
+    -> RenderQueueStats {
+  RenderQueueStats stats = {};
+  size_t begin = 0;
+  size_t end = 0;
+  GetPassRange(pass, begin, end);
+
+  uint32_t root_signature = kUnbound;
+  uint32_t pipeline_state = kUnbound;
+  uint32_t material = kUnbound;
+  uint32_t geometry = kUnbound;
+
+  for (size_t i = begin; i < end; ++i) {
+    const DrawPacket &packet = packets_[entries_[i].packet];
+
+    if (packet.root_signature != root_signature) {
+      root_signature = packet.root_signature;
+      material = kUnbound;
+      recorder.SetRootSignature(root_signature);
+      ++stats.root_signature_binds;
+    }
+    if (packet.pipeline_state != pipeline_state) {
+      pipeline_state = packet.pipeline_state;
+      recorder.SetPipelineState(pipeline_state);
+      ++stats.pipeline_state_binds;
+    }
+    if (packet.material != material) {
+      material = packet.material;
+      recorder.BindMaterial(material);
+      ++stats.material_binds;
+    }
+    if (packet.geometry != geometry) {
+      geometry = packet.geometry;
+      recorder.BindGeometry(geometry);
+      ++stats.geometry_binds;
+    }
+
+    recorder.Draw(packet);
+    ++stats.draws;
+  }
+
+  return stats;
+}
@@ -22,7 +22,10 @@ public:
 
   void EndRender();
 
-  DescriptorHeapPtr GetShaderResourceView() const;
+  D3D12_GPU_DESCRIPTOR_HANDLE GetShaderResourceView() const;
+
+  // CPU-only copy of the SRV, for building tables.
+  D3D12_CPU_DESCRIPTOR_HANDLE GetStagingView() const;
 
   const RenderTargetDescriptor &GetDescriptor() const {
     return descriptor_;
@@ -30,9 +30,20 @@ public:
       UINT shader_register, UINT register_space,
       D3D12_SHADER_VISIBILITY visibility);
 
+  // A raw or structured buffer bound by GPU address, with no descriptor.
+  RootSignatureBuilder &AddShaderResourceView(
+      UINT shader_register, UINT register_space,
+      D3D12_SHADER_VISIBILITY visibility);
+
   RootSignatureBuilder &
   AddStaticSampler(const D3D12_STATIC_SAMPLER_DESC &sampler_desc);
 
+  // The serialized blob is what the PipelineCache keys root signatures by;
+  // producing it needs no device.
+  bool Serialize(D3D12_ROOT_SIGNATURE_FLAGS flags,
+                 Microsoft::WRL::ComPtr<ID3DBlob> &signature_blob) const;
+
+  // Returns the device's shared root signature for this description.
   bool Build(const std::shared_ptr<DirectX12Device> &device,
              RootSignaturePtr &root_signature,
              D3D12_ROOT_SIGNATURE_FLAGS flags) const;
@@ -43,7 +54,11 @@ private:
     D3D12_SHADER_VISIBILITY visibility = D3D12_SHADER_VISIBILITY_ALL;
   };
 
-  enum class ParameterType { DescriptorTable, ConstantBufferView };
+  enum class ParameterType {
+    DescriptorTable,
+    ConstantBufferView,
+    ShaderResourceView
+  };
 
   struct ParameterDesc {
     ParameterType type = ParameterType::ConstantBufferView;
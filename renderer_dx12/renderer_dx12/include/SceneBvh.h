@@ -0,0 +1,126 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "FrustumCulling.h"
+
+// direction need not be normalized; hit distances are in its units.
+struct Ray {
+  float origin[3] = {};
+  float direction[3] = {0.0f, 0.0f, 1.0f};
+};
+
+struct RayHit {
+  uint32_t object = ~0u;
+  float distance = 0.0f;
+};
+
+// Bounding volume hierarchy over scene objects, for culling and picking.
+//
+// Build sorts the objects into a binned-SAH tree. Moving objects only need
+// SetBounds and Refit, which grows the boxes of their leaves and ancestors
+// without changing the tree; once that has degraded it enough,
+// NeedsRebuild turns true. Inserted or removed objects take effect at the
+// next Build, which Refit runs itself when there are any. Queries see the
+// tree as of the last Build or Refit, so removed objects are reported until
+// then. Concurrent queries are safe; anything else needs exclusive access.
+class SceneBvh {
+public:
+  static constexpr uint32_t kInvalidObject = ~0u;
+
+  // Objects per leaf at most.
+  static constexpr uint32_t kMaxLeafSize = 4;
+
+  SceneBvh() = default;
+
+  SceneBvh(const SceneBvh &rhs) = delete;
+
+  auto operator=(const SceneBvh &rhs) -> SceneBvh & = delete;
+
+  ~SceneBvh() = default;
+
+  // Ids of removed objects are handed out again.
+  auto Insert(const BoundingVolume &bounds) -> uint32_t;
+
+  void Remove(uint32_t object);
+
+  void SetBounds(uint32_t object, const BoundingVolume &bounds);
+
+  auto GetBounds(uint32_t object) const -> const BoundingVolume &;
+
+  void Clear();
+
+  void Build();
+
+  // Brings the boxes up to date with SetBounds since the last Build or
+  // Refit. Only the paths above moved objects are visited, unless so many
+  // moved that one sweep over every node is cheaper.
+  void Refit();
+
+  // True when refits have pushed the tree's SAH cost well past what Build
+  // left it at. Walks every node.
+  auto NeedsRebuild() const -> bool;
+
+  // Appends every object that may intersect the frustum. Subtrees entirely
+  // inside it are taken without testing their objects.
+  void QueryFrustum(const FrustumPlanes &frustum,
+                    std::vector<uint32_t> &objects) const;
+
+  // Closest object whose box and sphere the ray enters within max_distance,
+  // at the farther of the two entry points.
+  auto RayCast(const Ray &ray, RayHit &hit,
+               float max_distance = 3.4e38f) const -> bool;
+
+  auto GetObjectCount() const -> size_t { return live_object_count_; }
+
+  auto GetNodeCount() const -> size_t { return nodes_.size(); }
+
+  // Expected cost of a query, relative to testing one object.
+  auto GetSahCost() const -> float;
+
+private:
+  static constexpr uint32_t kNoNode = ~0u;
+
+  // Every node owns a contiguous range of object_order_, so a subtree's
+  // objects can be taken without walking it.
+  struct Node {
+    float minimum[3] = {};
+    float maximum[3] = {};
+    uint32_t first_object = 0;
+    uint32_t object_count = 0;
+    // The second child follows the first; kNoNode for leaves.
+    uint32_t first_child = kNoNode;
+    uint32_t parent = kNoNode;
+  };
+
+  struct Object {
+    BoundingVolume bounds = {};
+    uint32_t leaf = kNoNode;
+    bool alive = false;
+    bool moved = false;
+  };
+
+  void SplitNode(uint32_t node_index, std::vector<uint32_t> &pending);
+
+  void FitObjects(Node &node) const;
+
+  void FitChildren(Node &node) const;
+
+  std::vector<Object> objects_ = {};
+
+  std::vector<uint32_t> free_objects_ = {};
+
+  std::vector<uint32_t> moved_objects_ = {};
+
+  std::vector<Node> nodes_ = {};
+
+  std::vector<uint32_t> object_order_ = {};
+
+  size_t live_object_count_ = 0;
+
+  bool structure_changed_ = false;
+
+  float built_sah_cost_ = 0.0f;
+};
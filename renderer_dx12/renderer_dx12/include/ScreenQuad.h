@@ -2,6 +2,7 @@
 
 #include <DirectXMath.h>
 #include <memory>
+#include <vector>
 
 #include "ScreenQuadMaterial.h"
 
@@ -28,17 +29,14 @@ public:
   bool Initialize(UINT screen_width, UINT screen_height, UINT bitmap_width,
                   UINT bitmap_height);
 
-  const VertexBufferView& GetVertexBufferView() const {
-      return vertex_buffer_view_;
-  }
+  // Valid for the frame being recorded only.
+  const VertexBufferView &GetVertexBufferView();
 
   const IndexBufferView& GetIndexBufferView() const {
       return index_buffer_view_;
   }
 
-  void SetVertexBufferView(const VertexBufferView& view) {
-      vertex_buffer_view_ = view;
-  }
+  void SetVertexBufferView(const VertexBufferView &view);
 
   void SetIndexBufferView(const IndexBufferView &view);
 
@@ -55,13 +53,17 @@ public:
 private:
   bool InitializeBuffers();
 
+  bool UploadVertices();
+
 private:
   std::shared_ptr<DirectX12Device> device_ = nullptr;
 
   std::shared_ptr<ScreenQuadMaterial> material_ = nullptr;
 
-  ResourceSharedPtr vertex_buffer_ = nullptr;
-  VertexBufferView vertex_buffer_view_;
+  std::vector<VertexType> vertices_ = {};
+  VertexBufferView vertex_buffer_view_ = {};
+  UINT64 uploaded_frame_ = 0;
+  bool external_vertex_buffer_view_ = false;
 
   ResourceSharedPtr index_buffer_ = nullptr;
   IndexBufferView index_buffer_view_;
@@ -25,7 +25,7 @@ public:
                             const DirectX::XMMATRIX &view,
                             const DirectX::XMMATRIX &orthogonality) -> bool;
 
-  auto GetConstantBuffer() const -> ResourceSharedPtr;
+  auto GetConstantBufferAddress() const -> D3D12_GPU_VIRTUAL_ADDRESS;
 
   auto IsInitialized() const -> bool { return initialized_; }
 
@@ -52,8 +52,6 @@ private:
 
   ResourceSharedPtr external_constant_buffer_ = nullptr;
   
-  ResourceSharedPtr current_constant_buffer_ = nullptr;
-  
   MatrixBufferType matrix_constant_data_ = {};
 
   bool initialized_ = false;
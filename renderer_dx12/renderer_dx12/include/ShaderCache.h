@@ -0,0 +1,114 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace ResourceLoader {
+
+class FileSource;
+
+// Raw D3D_SHADER_INPUT_TYPE and friends, so entries stay portable.
+struct ShaderBinding {
+  std::string name;
+  uint32_t type = 0;
+  uint32_t bind_point = 0;
+  uint32_t bind_count = 0;
+  uint32_t space = 0;
+};
+
+struct ShaderInputElement {
+  std::string semantic_name;
+  uint32_t semantic_index = 0;
+  uint32_t register_index = 0;
+  uint32_t component_type = 0;
+  uint32_t mask = 0;
+};
+
+struct ShaderReflectionData {
+  uint32_t instruction_count = 0;
+  uint32_t constant_buffer_count = 0;
+  std::vector<ShaderBinding> bindings = {};
+  std::vector<ShaderInputElement> inputs = {};
+};
+
+// A file the compiled shader was built from. Files that could not be read
+// are kept with hash 0, so one appearing later invalidates the entry too.
+struct ShaderDependency {
+  std::wstring path;
+  uint64_t content_hash = 0;
+};
+
+struct ShaderCacheEntry {
+  std::string shader_key;
+  uint32_t compile_flags = 0;
+  // The source file first, then everything it includes.
+  std::vector<ShaderDependency> dependencies = {};
+  std::vector<uint8_t> bytecode = {};
+  ShaderReflectionData reflection = {};
+};
+
+struct ShaderManifestEntry {
+  std::wstring file_path;
+  std::string entry_point;
+  std::string target;
+};
+
+// Targets of the #include "..." lines in source, in order, without
+// duplicates. <...> includes come from system paths and are not tracked.
+auto ScanShaderIncludes(const uint8_t *data, size_t size)
+    -> std::vector<std::string>;
+
+// source_path and every file it includes, transitively. Includes resolve
+// against the including file's directory, as with
+// D3D_COMPILE_STANDARD_FILE_INCLUDE. Fails only when the source itself
+// cannot be read.
+auto CollectShaderDependencies(FileSource &file_source,
+                               const std::wstring &source_path,
+                               std::vector<ShaderDependency> &dependencies)
+    -> bool;
+
+// <directory>/<16 hex digits>.shc, named after the key and compile flags.
+auto GetShaderCachePath(const std::wstring &directory,
+                        const std::string &shader_key, uint32_t compile_flags)
+    -> std::wstring;
+
+void SerializeShaderCacheEntry(const ShaderCacheEntry &entry,
+                               std::vector<uint8_t> &image);
+
+auto ParseShaderCacheEntry(const uint8_t *data, size_t size,
+                           ShaderCacheEntry &entry) -> bool;
+
+// One "file entry_point target" per line; '#' starts a comment.
+auto ParseShaderManifest(const uint8_t *data, size_t size,
+                         std::vector<ShaderManifestEntry> &entries) -> bool;
+
+// Compiled shaders on disk, one file per key and compile flags. An entry is
+// only handed back while every file it was built from hashes the same, so
+// editing a shader or anything it includes compiles it again. Knows nothing
+// about the compiler; the ShaderLoader fills entries in.
+class ShaderCache {
+public:
+  ShaderCache(FileSource &file_source, std::wstring directory);
+
+  ShaderCache(const ShaderCache &rhs) = delete;
+
+  auto operator=(const ShaderCache &rhs) -> ShaderCache & = delete;
+
+  ~ShaderCache() = default;
+
+  auto Load(const std::string &shader_key, uint32_t compile_flags,
+            ShaderCacheEntry &entry) -> bool;
+
+  auto Store(const ShaderCacheEntry &entry) -> bool;
+
+  auto GetDirectory() const -> const std::wstring & { return directory_; }
+
+private:
+  FileSource &file_source_;
+
+  std::wstring directory_;
+};
+
+} // namespace ResourceLoader
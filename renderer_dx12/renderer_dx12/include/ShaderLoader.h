@@ -2,6 +2,13 @@
 
 #include "TypeDefine.h"
 
+#include "JobSystem.h"
+#include "ShaderCache.h"
+
+#include <atomic>
+#include <future>
+#include <memory>
+#include <mutex>
 #include <unordered_map>
 #include <wrl.h>
 
@@ -11,6 +18,8 @@ typedef std::vector<BlobPtr> VSBlobVector;
 
 typedef std::vector<BlobPtr> PSBlobVector;
 
+typedef std::vector<ResourceLoader::ShaderReflectionData> ReflectionVector;
+
 typedef std::unordered_map<std::string, unsigned int> ShaderIndexContainer;
 
 namespace ResourceLoader {
@@ -22,17 +31,87 @@ struct ShaderCompileDesc {
   const D3D_SHADER_MACRO *defines = nullptr;
 };
 
+enum class ShaderStage { kVertex, kPixel };
+
+struct ShaderCompileRequest {
+  ShaderStage stage = ShaderStage::kVertex;
+  ShaderCompileDesc desc;
+};
+
+struct ShaderCompileStatus {
+  bool succeeded = false;
+  std::string error_message;
+};
+
+typedef std::shared_future<ShaderCompileStatus> ShaderCompileFuture;
+
+// Shaders compiling on the job system, handed out by
+// ShaderLoader::CompileShaders. Statuses are indexed like the requests,
+// whatever order the compiles finish in.
+class ShaderCompileBatch {
+public:
+  explicit ShaderCompileBatch(JobSystem &job_system)
+      : job_system_(job_system) {}
+
+  ShaderCompileBatch(const ShaderCompileBatch &rhs) = delete;
+
+  ShaderCompileBatch &operator=(const ShaderCompileBatch &rhs) = delete;
+
+  ~ShaderCompileBatch() { job_system_.Wait(counter_); }
+
+  bool IsDone() const;
+
+  // Runs queued jobs until every shader in the batch has compiled or failed.
+  // True when all of them compiled.
+  bool Wait();
+
+  size_t GetSize() const { return statuses_.size(); }
+
+  // Blocks until that shader is done; call Wait() first to help out.
+  const ShaderCompileStatus &GetStatus(size_t index) const {
+    return statuses_.at(index).get();
+  }
+
+private:
+  friend class ShaderLoader;
+
+  JobSystem &job_system_;
+
+  JobCounter counter_;
+
+  std::vector<ShaderCompileFuture> statuses_ = {};
+
+  // Earlier batches already compiling some of these shaders.
+  std::vector<std::shared_ptr<ShaderCompileBatch>> dependencies_ = {};
+};
+
+typedef std::shared_ptr<ShaderCompileBatch> ShaderCompileBatchPtr;
+
+// Compiles shaders on the job system, through the on-disk ShaderCache.
+//
+// Every call may come from any thread. A shader's index is reserved when its
+// compile is queued, in request order, so indices and the by-file lookups do
+// not depend on which compile finishes first. Blob and reflection getters
+// return nothing for a shader that is still compiling.
 class ShaderLoader {
 public:
-  ShaderLoader() {}
+  ShaderLoader();
+
+  explicit ShaderLoader(JobSystem &job_system);
 
   ShaderLoader(const ShaderLoader &rhs) = delete;
 
   ShaderLoader &operator=(const ShaderLoader &rhs) = delete;
 
-  ~ShaderLoader() {}
+  ~ShaderLoader();
 
 public:
+  // Queues every request and returns at once. Shaders already compiled or
+  // compiling are shared, not compiled again.
+  ShaderCompileBatchPtr
+  CompileShaders(const std::vector<ShaderCompileRequest> &requests);
+
+  // The synchronous calls below compile through CompileShaders and wait.
   bool CompileVertexAndPixelShaders(const ShaderCompileDesc &vs_desc,
                                     const ShaderCompileDesc &ps_desc);
 
@@ -56,17 +135,54 @@ public:
 
   BlobPtr GetPixelShaderBlobByEntryName(WCHAR *entry_name) const;
 
+  // Copies, since the containers may grow under other threads.
+  bool GetVertexShaderReflection(const ShaderCompileDesc &desc,
+                                 ShaderReflectionData &reflection) const;
+
+  bool GetPixelShaderReflection(const ShaderCompileDesc &desc,
+                                ShaderReflectionData &reflection) const;
+
+  // Compiles every shader listed in a manifest (see ParseShaderManifest) into
+  // the on-disk cache, so the first launch after a build skips the compiler.
+  bool CookShaders(const std::wstring &manifest_path);
+
+  // Set by the synchronous calls only; meant for the thread making them.
   const std::string &GetLastErrorMessage() const;
 
 private:
+  struct PendingCompile;
+
+  // Status of the compile that fills a slot, and the batch running it while
+  // it has not finished.
+  struct ShaderSlotState {
+    ShaderCompileFuture status;
+    std::weak_ptr<ShaderCompileBatch> batch;
+  };
+
   bool ValidateCompileDesc(const ShaderCompileDesc &desc,
-                           bool is_vertex_shader);
+                           bool is_vertex_shader,
+                           std::string &error_message) const;
 
   bool CompileShaderInternal(const ShaderCompileDesc &desc,
                              bool is_vertex_shader);
 
+  // Runs on a worker; publishes the result into the reserved slot.
+  void RunCompile(PendingCompile &pending);
+
+  // Bytecode from the cache when every file it was built from is unchanged,
+  // otherwise from the compiler, refreshing the cache entry.
+  bool LoadOrCompile(const ShaderCompileDesc &desc,
+                     const std::string &shader_key, bool is_vertex_shader,
+                     BlobPtr &shader_blob, ShaderReflectionData &reflection,
+                     std::string &error_message);
+
   std::string BuildShaderKey(const ShaderCompileDesc &desc) const;
 
+  JobSystem &job_system_;
+
+  // Guards the containers below and the batch list.
+  mutable std::mutex mutex_;
+
   ShaderIndexContainer vs_index_container_ = {};
 
   ShaderIndexContainer ps_index_container_ = {};
@@ -79,7 +195,23 @@ private:
 
   PSBlobVector pixel_shader_container = {};
 
-  BlobPtr last_compile_error_ = nullptr;
+  // Parallel to the blob containers.
+  ReflectionVector vertex_shader_reflection_ = {};
+
+  ReflectionVector pixel_shader_reflection_ = {};
+
+  std::vector<ShaderSlotState> vertex_shader_state_ = {};
+
+  std::vector<ShaderSlotState> pixel_shader_state_ = {};
+
+  // Batches with compiles in flight; the destructor waits for them.
+  std::vector<ShaderCompileBatchPtr> batches_ = {};
+
+  ShaderCache cache_;
+
+  std::atomic<unsigned int> cache_hits_{0};
+
+  std::atomic<unsigned int> cache_misses_{0};
 
   std::string last_error_message_;
 };
@@ -25,11 +25,11 @@ public:
 
   auto Initialize() -> bool override;
 
-  auto GetMatrixConstantBuffer() const -> ResourceSharedPtr;
+  auto GetMatrixConstantBufferAddress() const -> D3D12_GPU_VIRTUAL_ADDRESS;
 
-  auto GetCameraConstantBuffer() const -> ResourceSharedPtr;
+  auto GetCameraConstantBufferAddress() const -> D3D12_GPU_VIRTUAL_ADDRESS;
   
-  auto GetLightConstantBuffer() const -> ResourceSharedPtr;
+  auto GetLightConstantBufferAddress() const -> D3D12_GPU_VIRTUAL_ADDRESS;
 
   auto UpdateMatrixConstant(const DirectX::XMMATRIX &world,
                             const DirectX::XMMATRIX &view,
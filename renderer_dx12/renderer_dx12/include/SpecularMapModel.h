@@ -2,12 +2,20 @@
 
 #include <DirectXMath.h>
 #include <memory>
+#include <vector>
 
+#include "ModelAssets.h"
 #include "SpecularMapMaterial.h"
 #include "TextureLoader.h"
 
 class DirectX12Device;
 
+namespace ResourceLoader {
+
+class MeshFile;
+
+} // namespace ResourceLoader
+
 class SpecularMapModel {
 public:
   explicit SpecularMapModel(std::shared_ptr<DirectX12Device> device);
@@ -15,85 +23,47 @@ public:
   SpecularMapModel(const SpecularMapModel &rhs) = delete;
   auto operator=(const SpecularMapModel &rhs) -> SpecularMapModel & = delete;
 
-  ~SpecularMapModel();
+  ~SpecularMapModel() = default;
 
+  // Returns with placeholders in place; the real mesh and textures stream in.
   auto Initialize(WCHAR *model_filename, WCHAR **texture_filename_arr,
                   unsigned int texture_count) -> bool;
 
-  auto GetIndexCount() const -> UINT { return index_count_; }
+  auto GetIndexCount() const -> UINT { return mesh_->index_count; }
+
+  auto GetWorldBounds(const DirectX::XMMATRIX &world) const
+      -> BoundingVolume {
+    return ComputeWorldBounds(*mesh_, world);
+  }
 
   auto GetVertexBufferView() const -> const D3D12_VERTEX_BUFFER_VIEW & {
-    return vertex_buffer_view_;
+    return mesh_->vertex_buffer_view;
   }
 
   auto GetIndexBufferView() const -> const D3D12_INDEX_BUFFER_VIEW & {
-    return index_buffer_view_;
+    return mesh_->index_buffer_view;
   }
 
   auto GetMaterial() -> SpecularMapMaterial * { return &material_; }
 
-  auto GetShaderResourceView() const -> DescriptorHeapPtr;
+  auto GetShaderResourceView() const -> D3D12_GPU_DESCRIPTOR_HANDLE;
 
 private:
   struct VertexType {
     DirectX::XMFLOAT3 position;
     DirectX::XMFLOAT2 texcoord;
     DirectX::XMFLOAT3 normal;
-    DirectX::XMFLOAT3 tangent;
-    DirectX::XMFLOAT3 binormal;
+    DirectX::XMFLOAT4 tangent; // w = bitangent handedness
   };
 
-  struct ModelType {
-    float x, y, z;
-    float tu, tv;
-    float nx, ny, nz;
-    float tx, ty, tz;
-    float bx, by, bz;
-  };
-
-  struct TempVertexType {
-    float x, y, z;
-    float tu, tv;
-    float nx, ny, nz;
-  };
-
-  struct VectorType {
-    float x, y, z;
-  };
-
-  auto LoadModel(WCHAR *filename) -> bool;
-
-  void ReleaseModel();
-
-  auto InitializeBuffers() -> bool;
-
-  auto LoadTextures(WCHAR **texture_filename_arr, unsigned int texture_count)
-      -> bool;
-
-  void CalculateModelVectors();
-
-  void CalculateTangentBinormal(const TempVertexType &vertex1,
-                                const TempVertexType &vertex2,
-                                const TempVertexType &vertex3,
-                                VectorType &tangent, VectorType &binormal);
-  void CalculateNormal(const VectorType &tangent, const VectorType &binormal,
-                       VectorType &normal);
+  auto BuildMeshBuffers(const ResourceLoader::MeshFile &mesh,
+                        MeshBuffers &buffers) const -> bool;
 
 private:
   std::shared_ptr<DirectX12Device> device_;
   SpecularMapMaterial material_;
 
-  ResourceSharedPtr vertex_buffer_ = nullptr;
-  D3D12_VERTEX_BUFFER_VIEW vertex_buffer_view_ = {};
-
-  ResourceSharedPtr index_buffer_ = nullptr;
-  D3D12_INDEX_BUFFER_VIEW index_buffer_view_ = {};
-
-  UINT vertex_count_ = 0;
-  
-  UINT index_count_ = 0;
-
-  ModelType *model_data_ = nullptr;
+  MeshHandle mesh_ = nullptr;
 
   std::shared_ptr<ResourceLoader::TextureLoader> texture_loader_ = nullptr;
 };
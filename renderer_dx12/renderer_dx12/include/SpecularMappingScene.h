@@ -42,9 +42,14 @@ public:
 
   void SetRotationAngle(float radians);
 
+  // At the current rotation; empty until Initialize succeeds.
+  auto GetWorldBounds() const -> BoundingVolume;
+
 private:
   auto EnsureShadersLoaded() -> bool;
 
+  auto GetWorldMatrix() const -> DirectX::XMMATRIX;
+
 private:
   std::shared_ptr<DirectX12Device> device_;
 
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace ResourceLoader {
+
+// Smooth per-vertex tangent frames for indexed triangle lists.
+//
+// Face tangents are accumulated per vertex, then Gram-Schmidt orthonormalized
+// against the vertex normal. The bitangent is not stored; its direction is the
+// w component (+1/-1) so shaders rebuild it as cross(normal, tangent.xyz) * w.
+//
+// Inputs and outputs are structure-of-arrays so both passes run four lanes at
+// a time with SSE (scalar fallback), and large meshes are split across
+// threads.
+class TangentGenerator {
+public:
+  // Meshes with fewer triangles than this are processed on the calling thread.
+  static constexpr size_t kParallelTriangleThreshold = 16384;
+
+  TangentGenerator() = default;
+
+  TangentGenerator(const TangentGenerator &rhs) = delete;
+
+  auto operator=(const TangentGenerator &rhs) -> TangentGenerator & = delete;
+
+  ~TangentGenerator() = default;
+
+  // Splits interleaved vertices whose first eight floats are
+  // position/uv/normal (the MeshSourceVertex layout) into SoA streams.
+  auto SetSourceVertices(const void *vertices, uint32_t vertex_count,
+                         size_t stride) -> bool;
+
+  auto Generate(const uint32_t *indices, size_t index_count) -> bool;
+
+  // Writes tangent xyzw to destination + i * stride + offset.
+  void StoreTangents(void *destination, size_t stride, size_t offset) const;
+
+  auto GetVertexCount() const -> uint32_t { return vertex_count_; }
+
+  auto GetTangentX() const -> const float * { return tangent_x_.data(); }
+
+  auto GetTangentY() const -> const float * { return tangent_y_.data(); }
+
+  auto GetTangentZ() const -> const float * { return tangent_z_.data(); }
+
+  auto GetHandedness() const -> const float * { return tangent_w_.data(); }
+
+private:
+  void ComputeFaceTangents(const uint32_t *indices, size_t first_face,
+                           size_t last_face);
+
+  void ResolveVertexTangents(size_t first_vertex, size_t last_vertex);
+
+  uint32_t vertex_count_ = 0;
+
+  std::vector<float> position_x_, position_y_, position_z_;
+
+  std::vector<float> texcoord_u_, texcoord_v_;
+
+  std::vector<float> normal_x_, normal_y_, normal_z_;
+
+  std::vector<float> tangent_x_, tangent_y_, tangent_z_, tangent_w_;
+
+  // Per-face (unnormalized) tangent and bitangent.
+  std::vector<float> face_tangent_x_, face_tangent_y_, face_tangent_z_;
+
+  std::vector<float> face_bitangent_x_, face_bitangent_y_, face_bitangent_z_;
+
+  // Vertex -> face adjacency in CSR form, so accumulation is race-free.
+  std::vector<uint32_t> adjacency_offsets_;
+
+  std::vector<uint32_t> adjacency_;
+};
+
+} // namespace ResourceLoader
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace ResourceLoader {
+
+// What the loader needs from a .tga header.
+struct TargaInfo {
+  uint32_t width = 0;
+  uint32_t height = 0;
+  uint32_t bytes_per_pixel = 0; // 3 (BGR) or 4 (BGRA)
+  bool is_rle = false;
+  // Rows are stored top row first; the common default is bottom row first.
+  bool is_top_down = false;
+  // Offset of the first pixel (or RLE packet) in the image.
+  size_t pixel_offset = 0;
+};
+
+// Accepts uncompressed (type 2) and RLE (type 10) true-color images with 24
+// or 32 bits per pixel. Any color map is skipped.
+auto ReadTargaHeader(const uint8_t *data, size_t size, TargaInfo &info)
+    -> bool;
+
+// Decodes the image into width x height RGBA8 texels, top row first, at
+// row_pitch bytes per row. Swizzle, alpha fill and vertical flip happen in the
+// same pass, a row of pixels at a time with SSSE3/AVX2 where the CPU has it.
+// Fails if the image ends early; destination is then partly written.
+auto DecodeTargaImage(const uint8_t *data, size_t size, const TargaInfo &info,
+                      uint8_t *destination, size_t row_pitch) -> bool;
+
+} // namespace ResourceLoader
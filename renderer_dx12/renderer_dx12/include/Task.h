@@ -0,0 +1,146 @@
+#pragma once
+
+#include <coroutine>
+#include <exception>
+#include <utility>
+
+// Lazily started coroutine that produces a T. Nothing runs until the task is
+// co_awaited; the awaiting coroutine is then resumed, on whatever thread the
+// task finished on, with the co_returned value. Thread hops are explicit
+// awaits (see AssetStreamer), so a task never switches threads on its own.
+//
+// The engine builds without exceptions, so an escaping exception terminates.
+template <typename T = void>
+class Task;
+
+namespace task_detail {
+
+struct FinalAwaiter {
+  auto await_ready() const noexcept -> bool { return false; }
+
+  // Symmetric transfer to the awaiting coroutine keeps long co_await chains
+  // from growing the stack.
+  template <typename Promise>
+  auto await_suspend(std::coroutine_handle<Promise> handle) const noexcept
+      -> std::coroutine_handle<> {
+    auto continuation = handle.promise().continuation_;
+    return continuation ? continuation : std::noop_coroutine();
+  }
+
+  void await_resume() const noexcept {}
+};
+
+struct PromiseBase {
+  auto initial_suspend() const noexcept -> std::suspend_always { return {}; }
+
+  auto final_suspend() const noexcept -> FinalAwaiter { return {}; }
+
+  void unhandled_exception() const noexcept { std::terminate(); }
+
+  std::coroutine_handle<> continuation_ = nullptr;
+};
+
+template <typename Promise>
+class TaskBase {
+public:
+  using Handle = std::coroutine_handle<Promise>;
+
+  TaskBase() = default;
+
+  explicit TaskBase(Handle handle) : handle_(handle) {}
+
+  TaskBase(const TaskBase &rhs) = delete;
+
+  auto operator=(const TaskBase &rhs) -> TaskBase & = delete;
+
+  TaskBase(TaskBase &&rhs) noexcept
+      : handle_(std::exchange(rhs.handle_, nullptr)) {}
+
+  auto operator=(TaskBase &&rhs) noexcept -> TaskBase & {
+    if (this != &rhs) {
+      Reset();
+      handle_ = std::exchange(rhs.handle_, nullptr);
+    }
+    return *this;
+  }
+
+  ~TaskBase() { Reset(); }
+
+  auto IsValid() const -> bool { return static_cast<bool>(handle_); }
+
+  auto await_ready() const noexcept -> bool {
+    return !handle_ || handle_.done();
+  }
+
+  auto await_suspend(std::coroutine_handle<> awaiting) noexcept
+      -> std::coroutine_handle<> {
+    handle_.promise().continuation_ = awaiting;
+    return handle_;
+  }
+
+protected:
+  void Reset() {
+    if (handle_) {
+      handle_.destroy();
+      handle_ = nullptr;
+    }
+  }
+
+  Handle handle_ = nullptr;
+};
+
+template <typename T>
+struct ValuePromise;
+
+} // namespace task_detail
+
+template <typename T>
+class Task : public task_detail::TaskBase<task_detail::ValuePromise<T>> {
+public:
+  using promise_type = task_detail::ValuePromise<T>;
+
+  using task_detail::TaskBase<promise_type>::TaskBase;
+
+  auto await_resume() -> T { return std::move(this->handle_.promise().value_); }
+};
+
+template <>
+class Task<void>;
+
+namespace task_detail {
+
+template <typename T>
+struct ValuePromise : PromiseBase {
+  auto get_return_object() -> Task<T> {
+    return Task<T>(std::coroutine_handle<ValuePromise>::from_promise(*this));
+  }
+
+  template <typename U>
+  void return_value(U &&value) {
+    value_ = std::forward<U>(value);
+  }
+
+  T value_ = {};
+};
+
+struct VoidPromise : PromiseBase {
+  auto get_return_object() -> Task<void>;
+
+  void return_void() const noexcept {}
+};
+
+} // namespace task_detail
+
+template <>
+class Task<void> : public task_detail::TaskBase<task_detail::VoidPromise> {
+public:
+  using promise_type = task_detail::VoidPromise;
+
+  using task_detail::TaskBase<promise_type>::TaskBase;
+
+  void await_resume() const noexcept {}
+};
+
+inline auto task_detail::VoidPromise::get_return_object() -> Task<void> {
+  return Task<void>(std::coroutine_handle<VoidPromise>::from_promise(*this));
+}
@@ -2,6 +2,7 @@
 
 #include <DirectXMath.h>
 #include <memory>
+#include <vector>
 
 #include "TextMaterial.h"
 #include "TextureLoader.h"
@@ -20,16 +21,21 @@ public:
   virtual ~Text();
 
 private:
+  struct VertexType {
+    DirectX::XMFLOAT3 position_;
+    DirectX::XMFLOAT2 texture_position_;
+  };
+
   struct SentenceType {
-    ResourceSharedPtr vertex_buffer_ = nullptr;
+    // CPU copy of the vertices; re-copied into per-frame memory whenever the
+    // sentence is drawn in a frame it has not been uploaded in yet.
+    std::vector<VertexType> vertices_ = {};
     D3D12_VERTEX_BUFFER_VIEW vertex_buffer_view_ = {};
+    UINT64 uploaded_frame_ = 0;
 
     ResourceSharedPtr index_buffer_ = nullptr;
     D3D12_INDEX_BUFFER_VIEW index_buffer_view_ = {};
 
-    D3D12_RESOURCE_STATES vertex_buffer_state_ =
-        D3D12_RESOURCE_STATE_COMMON;
-        
     D3D12_RESOURCE_STATES index_buffer_state_ =
         D3D12_RESOURCE_STATE_COMMON;
 
@@ -37,16 +43,15 @@ private:
     float red_ = 0.0f, green_ = 0.0f, blue_ = 0.0f;
   };
 
-  struct VertexType {
-    DirectX::XMFLOAT3 position_;
-    DirectX::XMFLOAT2 texture_position_;
-  };
-
 public:
   bool SetFps(int fps);
 
   bool SetCpu(int cpu_percentage_value);
 
+  // Draw calls, instances and CPU recording time of the instancing scene.
+  bool SetInstancing(UINT draw_count, UINT instance_count,
+                     float record_milliseconds);
+
 public:
   bool Initialize(int screenWidth, int screenHeight,
                   const DirectX::XMMATRIX &baseViewMatrix);
@@ -55,15 +60,18 @@ public:
 
   TextMaterial *GetMaterial();
 
-  DescriptorHeapPtr GetShaderResourceView() const;
+  D3D12_GPU_DESCRIPTOR_HANDLE GetShaderResourceView() const;
 
   UINT GetIndexCount(int index) const {
     return sentence_vector_.at(index)->index_count_;
   }
 
-  const D3D12_VERTEX_BUFFER_VIEW &GetVertexBufferView(int index) const {
-    return sentence_vector_.at(index)->vertex_buffer_view_;
-  }
+  // Valid for the frame being recorded only.
+  const D3D12_VERTEX_BUFFER_VIEW &GetVertexBufferView(int index);
+
+  // Uploads every sentence not yet uploaded this frame, so that
+  // GetVertexBufferView is read-only while passes record in parallel.
+  bool PrepareFrame();
 
   const D3D12_INDEX_BUFFER_VIEW &GetIndexBufferView(int index) const {
     return sentence_vector_.at(index)->index_buffer_view_;
@@ -80,6 +88,8 @@ public:
 private:
   bool InitializeSentence(SentenceType **sentence, int max_length);
 
+  bool UploadSentenceVertices(SentenceType *sentence);
+
   bool LoadTexture(WCHAR **filename_arr);
 
   void ReleaseSentences();
@@ -21,12 +21,12 @@ public:
 
   auto Initialize() -> bool override;
 
-  auto GetMatrixConstantBuffer() const -> ResourceSharedPtr {
-    return matrix_constant_buffer_.GetResource();
+  auto GetMatrixConstantBufferAddress() const -> D3D12_GPU_VIRTUAL_ADDRESS {
+    return matrix_constant_buffer_.GetGPUVirtualAddress();
   }
 
-  auto GetPixelConstantBuffer() const -> ResourceSharedPtr {
-    return pixel_color_constant_buffer_.GetResource();
+  auto GetPixelConstantBufferAddress() const -> D3D12_GPU_VIRTUAL_ADDRESS {
+    return pixel_color_constant_buffer_.GetGPUVirtualAddress();
   }
 
   auto UpdateMatrixConstant(const DirectX::XMMATRIX &world,
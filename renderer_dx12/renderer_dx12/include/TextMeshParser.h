@@ -0,0 +1,68 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace ResourceLoader {
+
+struct TextMeshParseError {
+  uint32_t line = 0;
+  uint32_t column = 0;
+  const char *message = nullptr;
+};
+
+// Parser for the data/*.txt mesh format:
+//
+//   Vertex Count: N
+//   Data:
+//   x y z tu tv nx ny nz   (N lines)
+//
+// Works on an in-memory view of the whole file and never allocates. Floats are
+// read with std::from_chars, so the result does not depend on the C locale.
+class TextMeshParser {
+public:
+  static constexpr uint32_t kFloatsPerVertex = 8;
+
+  TextMeshParser(const char *data, size_t size)
+      : begin_(data), cursor_(data), end_(data + size) {}
+
+  TextMeshParser(const TextMeshParser &rhs) = delete;
+
+  auto operator=(const TextMeshParser &rhs) -> TextMeshParser & = delete;
+
+  ~TextMeshParser() = default;
+
+  // Reads the "Vertex Count:" and "Data:" header lines.
+  auto ParseHeader(uint32_t &vertex_count) -> bool;
+
+  // Writes the eight floats of each vertex to destination + i * stride, so
+  // callers can parse straight into any layout that starts with
+  // position/uv/normal.
+  auto ParseVertices(void *destination, size_t stride, uint32_t vertex_count)
+      -> bool;
+
+  auto GetError() const -> const TextMeshParseError & { return error_; }
+
+private:
+  void SkipWhitespace();
+
+  auto SkipPast(char delimiter) -> bool;
+
+  auto ParseFloat(float &value) -> bool;
+
+  auto Fail(const char *message) -> bool;
+
+  const char *begin_ = nullptr;
+
+  const char *cursor_ = nullptr;
+
+  const char *end_ = nullptr;
+
+  TextMeshParseError error_ = {};
+};
+
+auto FormatTextMeshParseError(const TextMeshParseError &error)
+    -> std::string;
+
+} // namespace ResourceLoader
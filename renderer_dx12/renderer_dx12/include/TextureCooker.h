@@ -0,0 +1,44 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "BlockCompressor.h"
+#include "FileSource.h"
+#include "MipGenerator.h"
+
+class JobSystem;
+
+namespace ResourceLoader {
+
+struct TextureCookDesc {
+  TextureUsage usage = TextureUsage::kColor;
+  CompressionQuality quality = CompressionQuality::kBalanced;
+  // Channel order and encoding of the source pixels.
+  bool is_bgra = false;
+  bool is_srgb = false;
+  // Recorded in the image so a stale cache can be detected.
+  FileStamp source = {};
+};
+
+// data/pbr/pbr_albedo.tga -> data/pbr/pbr_albedo.bc.dds
+auto GetTextureCachePath(const std::wstring &source_path) -> std::wstring;
+
+// Block-compresses a mip chain laid out by LayoutMipChain into a .dds image
+// that CreateDDSTextureFromFile/FromMemory load as is; the format comes from
+// SelectBlockFormat. Fails unless level 0 is a multiple of four in both
+// dimensions, as block-compressed textures require. Large levels are encoded
+// on job_system.
+auto CookTextureImage(JobSystem &job_system, const uint8_t *pixels,
+                      const std::vector<MipLevel> &levels,
+                      const TextureCookDesc &desc, std::vector<uint8_t> &image)
+    -> bool;
+
+// True when the image was cooked from desc.source with the same usage and
+// quality by this version of the cooker.
+auto IsCookedTextureCurrent(const uint8_t *data, size_t size,
+                            const TextureCookDesc &desc) -> bool;
+
+} // namespace ResourceLoader
@@ -1,18 +1,49 @@
 #pragma once
 
 #include <memory>
+#include <string>
 #include <unordered_map>
+#include <vector>
 
+#include "BlockCompressor.h"
+#include "DirectX12Device.h"
+#include "FileSource.h"
+#include "MipGenerator.h"
+#include "Task.h"
 #include "TypeDefine.h"
 
-class DirectX12Device;
+class JobSystem;
 
 namespace ResourceLoader {
 
-typedef std::vector<ResourceSharedPtr> TextureContainer;
+class AssetStreamer;
+
+class FileSource;
+
+struct DDSLayout;
+
+// A texture resident once however many sets use it. Its view is a staging
+// descriptor, copied into each set's shader-visible table.
+struct SharedTexture {
+  ResourceSharedPtr resource = nullptr;
+  DescriptorRangePtr view = nullptr;
+};
+
+using TextureHandle = std::shared_ptr<const SharedTexture>;
+
+typedef std::vector<TextureHandle> TextureContainer;
 
 typedef std::unordered_map<std::string, unsigned int> TextureIndexContainer;
 
+// Textures plus the shader-visible table holding their views, built off the
+// main thread and published with TextureLoader::CommitTextureSet. table is
+// null when loading failed.
+struct TextureSet {
+  DescriptorRangePtr table = nullptr;
+  TextureContainer textures = {};
+  TextureIndexContainer indices = {};
+};
+
 class TextureLoader {
 public:
   explicit TextureLoader(std::shared_ptr<DirectX12Device> device);
@@ -24,18 +55,66 @@ public:
   ~TextureLoader() {}
 
 public:
-  DescriptorHeapPtr GetTexturesDescriptorHeap() const {
-    return shader_resource_view_heap_;
+  D3D12_GPU_DESCRIPTOR_HANDLE GetTexturesDescriptorTable() const {
+    return table_ ? table_->gpu_handle : D3D12_GPU_DESCRIPTOR_HANDLE{};
   }
 
   bool LoadTextureByName(WCHAR **texture_filename);
 
+  // usages[i] says how texture i is filtered when its mips are generated;
+  // textures past the end of usages are treated as color.
   bool LoadTexturesByNameArray(unsigned int num_textures,
-                               WCHAR **texture_filename_arr);
+                               WCHAR **texture_filename_arr,
+                               const std::vector<TextureUsage> &usages = {});
+
+  // Points num_textures views at a 1x1 white texture so the owner can draw
+  // before its real textures arrive.
+  bool CreatePlaceholders(unsigned int num_textures);
+
+  // Reads, decodes and uploads the textures on a streaming worker. Textures
+  // already resident through the asset registry are reused.
+  Task<TextureSet> LoadTextureSet(AssetStreamer &streamer,
+                                  std::vector<std::wstring> paths,
+                                  std::vector<TextureUsage> usages = {});
+
+  // Main thread only. The previous table and textures are released once the
+  // frames that may still sample them have retired.
+  void CommitTextureSet(TextureSet set);
+
+  // TGA and mip-less DDS textures are block-compressed at this quality and
+  // cached as .bc.dds files beside their sources. Applies to loads started
+  // afterwards.
+  void SetCompression(bool enabled, CompressionQuality quality) {
+    compress_textures_ = enabled;
+    compression_quality_ = quality;
+  }
 
   ResourceSharedPtr GetTextureResource(size_t index) const;
 
+  // Staging view of texture index, for tables built elsewhere.
+  D3D12_CPU_DESCRIPTOR_HANDLE GetTextureStagingView(size_t index) const;
+
 private:
+  // Mips and cooking are split across job_system.
+  bool BuildTextureSet(FileSource &file_source, JobSystem &job_system,
+                       const std::vector<std::wstring> &paths,
+                       const std::vector<TextureUsage> &usages,
+                       TextureSet &set);
+
+  // Loads one texture and its staging view, for the registry.
+  std::shared_ptr<SharedTexture>
+  LoadSharedTexture(FileSource &file_source, JobSystem &job_system,
+                    const std::wstring &file_path, TextureUsage usage,
+                    size_t &resident_bytes);
+
+  // Decodes a TGA (layout null) or a mip-less DDS, generates its mips and
+  // uploads it, block-compressed through the cache when compression is on.
+  bool LoadDecodedTexture(FileSource &file_source, JobSystem &job_system,
+                          const std::wstring &file_path, const FileData &file,
+                          const DDSLayout *layout, TextureUsage usage,
+                          ResourceSharedPtr &texture,
+                          D3D12_CPU_DESCRIPTOR_HANDLE srv_handle);
+
   std::shared_ptr<DirectX12Device> device_ = nullptr;
 
   unsigned int num_textures_ = 0;
@@ -44,7 +123,11 @@ private:
 
   TextureIndexContainer index_container_ = {};
 
-  DescriptorHeapPtr shader_resource_view_heap_ = nullptr;
+  DescriptorRangePtr table_ = nullptr;
+
+  bool compress_textures_ = true;
+
+  CompressionQuality compression_quality_ = CompressionQuality::kBalanced;
 };
 } // namespace ResourceLoader
 
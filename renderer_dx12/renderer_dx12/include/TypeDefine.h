@@ -18,7 +18,7 @@ namespace Effect {}
 
 namespace ResourceLoader {
 
-void WCHARToString(WCHAR *wchar, std::string &s);
+void WCHARToString(const WCHAR *wchar, std::string &s);
 // TODO: finish this function
 void StringToWCHAR(std::string s, WCHAR *wchar);
 
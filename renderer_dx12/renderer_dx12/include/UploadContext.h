@@ -0,0 +1,232 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+struct ID3D12Resource;
+
+namespace ResourceLoader {
+
+// Fence value of the copy-queue batch that carries an upload. Tokens grow
+// monotonically and are never reused, not even after a batch fails to
+// submit; 0 means "nothing to wait for".
+using UploadToken = uint64_t;
+
+constexpr UploadToken kInvalidUploadToken = 0;
+
+// Staging ids handed out by UploadDevice::CreateStagingBuffer; 0 is invalid.
+using StagingBufferId = uint32_t;
+
+constexpr uint64_t kDefaultUploadRingSize = 32ull * 1024ull * 1024ull;
+
+// Mirrors D3D12_TEXTURE_DATA_PLACEMENT_ALIGNMENT.
+constexpr uint64_t kTexturePlacementAlignment = 512;
+
+constexpr uint64_t kBufferPlacementAlignment = 16;
+
+// Placed footprint of one texture subresource inside a staging buffer
+// (D3D12_PLACED_SUBRESOURCE_FOOTPRINT plus the row counts from
+// GetCopyableFootprints), kept free of D3D types so it can be mocked.
+struct UploadTextureFootprint {
+  uint64_t offset = 0;
+  uint32_t format = 0;
+  uint32_t width = 0;
+  uint32_t height = 0;
+  uint32_t depth = 0;
+  uint32_t row_pitch = 0;
+  uint32_t row_count = 0;
+  uint64_t row_bytes = 0;
+};
+
+struct UploadSubresourceData {
+  const void *data = nullptr;
+  uint64_t row_pitch = 0;
+  uint64_t slice_pitch = 0;
+};
+
+// The GPU side of an UploadContext. The D3D12 implementation lives in
+// D3D12UploadDevice.h; everything else (ring allocation, batching, fence
+// bookkeeping) is plain C++ so it can be driven by a fake device.
+class UploadDevice {
+public:
+  virtual ~UploadDevice() = default;
+
+  // Creates a persistently mapped upload-heap buffer.
+  virtual auto CreateStagingBuffer(uint64_t size, uint8_t *&mapped_data)
+      -> StagingBufferId = 0;
+
+  virtual void ReleaseStagingBuffer(StagingBufferId staging) = 0;
+
+  // Footprints relative to offset 0, one per subresource.
+  virtual auto GetTextureFootprints(ID3D12Resource *destination,
+                                    uint32_t first_subresource,
+                                    uint32_t subresource_count,
+                                    UploadTextureFootprint *footprints,
+                                    uint64_t &total_bytes) -> bool = 0;
+
+  // Opens the copy command list for a new batch.
+  virtual auto BeginBatch() -> bool = 0;
+
+  virtual void CopyBufferRegion(ID3D12Resource *destination,
+                                uint64_t destination_offset,
+                                StagingBufferId staging,
+                                uint64_t staging_offset, uint64_t size) = 0;
+
+  virtual void CopyTextureRegion(ID3D12Resource *destination,
+                                 uint32_t subresource, StagingBufferId staging,
+                                 const UploadTextureFootprint &footprint) = 0;
+
+  // Closes and executes the batch, then signals fence_value on the queue.
+  virtual auto SubmitBatch(UploadToken fence_value) -> bool = 0;
+
+  virtual auto GetCompletedValue() -> UploadToken = 0;
+
+  virtual auto WaitForValue(UploadToken fence_value) -> bool = 0;
+
+  // Failures of the context itself, one line each, "[UploadContext] ...\n".
+  virtual void ReportError(const wchar_t *message) = 0;
+};
+
+// Byte ring over one staging buffer. Allocations are released in bulk, in
+// the order they were made, by Release(bytes).
+class UploadRing {
+public:
+  void Reset(uint64_t capacity);
+
+  // Returns false when the free space cannot hold size bytes at alignment.
+  auto Allocate(uint64_t size, uint64_t alignment, uint64_t &offset) -> bool;
+
+  // Bytes consumed (allocations plus alignment and wrap padding) since the
+  // last call.
+  auto TakeConsumed() -> uint64_t;
+
+  void Release(uint64_t bytes);
+
+  // Gives back the newest bytes, e.g. those of a batch that failed to submit.
+  void Rewind(uint64_t bytes);
+
+  auto GetCapacity() const -> uint64_t { return capacity_; }
+
+  auto GetUsed() const -> uint64_t { return used_; }
+
+private:
+  uint64_t capacity_ = 0;
+  uint64_t head_ = 0;
+  uint64_t used_ = 0;
+  uint64_t consumed_ = 0;
+};
+
+struct UploadStats {
+  uint64_t batches = 0;
+  uint64_t copies = 0;
+  uint64_t bytes = 0;
+  // Times an allocation had to wait for an in-flight batch to retire.
+  uint64_t ring_stalls = 0;
+  uint64_t dedicated_buffers = 0;
+  uint64_t failed_batches = 0;
+};
+
+// Batches CPU -> GPU copies onto the copy queue.
+//
+// Source data is written into a staging ring right away; the copies are
+// recorded into a single open command list and go out together on Flush()
+// with one fence signal. Each upload returns the token of the batch it
+// belongs to. Ring space is reclaimed when the fence passes a batch's token,
+// and uploads larger than the ring get a dedicated staging buffer that is
+// released the same way.
+//
+// Destination resources must be created in the COMMON state: copy-queue
+// access promotes them to COPY_DEST and they decay back to COMMON when the
+// batch completes, from where the graphics queue promotes them implicitly.
+// They must stay alive until their token has completed.
+class UploadContext {
+public:
+  explicit UploadContext(std::unique_ptr<UploadDevice> device);
+
+  UploadContext(const UploadContext &rhs) = delete;
+
+  auto operator=(const UploadContext &rhs) -> UploadContext & = delete;
+
+  ~UploadContext();
+
+  auto Initialize(uint64_t ring_size = kDefaultUploadRingSize) -> bool;
+
+  auto UploadBuffer(ID3D12Resource *destination, uint64_t destination_offset,
+                    const void *data, uint64_t size) -> UploadToken;
+
+  auto UploadTexture(ID3D12Resource *destination, uint32_t first_subresource,
+                     uint32_t subresource_count,
+                     const UploadSubresourceData *subresources) -> UploadToken;
+
+  // Submits the open batch, if any. Returns the newest submitted token.
+  auto Flush() -> UploadToken;
+
+  // False for good when the batch failed to submit.
+  auto IsComplete(UploadToken token) -> bool;
+
+  // Flushes first when token belongs to the open batch. Returns false when
+  // the batch failed to submit.
+  auto Wait(UploadToken token) -> bool;
+
+  auto WaitIdle() -> bool;
+
+  auto GetLastSubmittedToken() const -> UploadToken;
+
+  auto GetStats() const -> UploadStats;
+
+private:
+  struct Batch {
+    UploadToken token = kInvalidUploadToken;
+    uint64_t ring_bytes = 0;
+    std::vector<StagingBufferId> dedicated = {};
+  };
+
+  auto AllocateStaging(uint64_t size, uint64_t alignment,
+                       StagingBufferId &staging, uint8_t *&mapped_data,
+                       uint64_t &offset) -> bool;
+
+  auto EnsureBatchOpen() -> bool;
+
+  auto FlushLocked() -> UploadToken;
+
+  auto WaitLocked(UploadToken token) -> bool;
+
+  void RetireCompleted();
+
+  void RetireBatch(Batch &batch);
+
+  auto IsFailedLocked(UploadToken token) const -> bool;
+
+  mutable std::mutex mutex_;
+
+  std::unique_ptr<UploadDevice> device_ = nullptr;
+
+  UploadRing ring_ = {};
+
+  StagingBufferId ring_buffer_ = 0;
+
+  uint8_t *ring_data_ = nullptr;
+
+  bool batch_open_ = false;
+
+  Batch open_batch_ = {};
+
+  std::deque<Batch> in_flight_ = {};
+
+  UploadToken next_token_ = kInvalidUploadToken + 1;
+
+  UploadToken last_submitted_ = kInvalidUploadToken;
+
+  // Tokens of batches that never reached the queue, ascending.
+  std::vector<UploadToken> failed_tokens_ = {};
+
+  UploadToken last_completed_ = kInvalidUploadToken;
+
+  UploadStats stats_ = {};
+};
+
+} // namespace ResourceLoader
@@ -24,10 +24,14 @@
 #include <dxgiformat.h>
 
 // VS 2010's stdint.h conflicts with intsafe.h
+#if defined(_MSC_VER)
 #pragma warning(push)
 #pragma warning(disable : 4005)
+#endif
 #include <stdint.h>
+#if defined(_MSC_VER)
 #pragma warning(pop)
+#endif
 
 namespace DirectX {
 
@@ -0,0 +1,260 @@
+#include "stdafx.h"
+
+#include "AssetRegistry.h"
+
+#include <cstring>
+#include <cwctype>
+#include <sstream>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#include "DebugOutput.h"
+
+namespace ResourceLoader {
+
+namespace {
+
+constexpr uint64_t kPrime1 = 11400714785074694791ull;
+constexpr uint64_t kPrime2 = 14029467366897019727ull;
+constexpr uint64_t kPrime3 = 1609587929392839161ull;
+constexpr uint64_t kPrime4 = 9650029242287828579ull;
+constexpr uint64_t kPrime5 = 2870177450012600261ull;
+
+auto RotateLeft(uint64_t value, int bits) -> uint64_t {
+  return (value << bits) | (value >> (64 - bits));
+}
+
+auto ReadWord(const uint8_t *data) -> uint64_t {
+  uint64_t word = 0;
+  memcpy(&word, data, sizeof(word));
+  return word;
+}
+
+auto MixLane(uint64_t lane, uint64_t word) -> uint64_t {
+  return RotateLeft(lane + word * kPrime2, 31) * kPrime1;
+}
+
+const wchar_t *kKindNames[] = {L"meshes", L"textures"};
+
+} // namespace
+
+auto operator<(const AssetKey &lhs, const AssetKey &rhs) -> bool {
+  return std::tie(lhs.kind, lhs.content_hash, lhs.variant) <
+         std::tie(rhs.kind, rhs.content_hash, rhs.variant);
+}
+
+auto NormalizeAssetPath(const std::wstring &path) -> std::wstring {
+  std::vector<std::wstring> segments = {};
+  std::wstring segment = {};
+  const bool is_absolute =
+      !path.empty() && (path[0] == L'/' || path[0] == L'\\');
+
+  auto flush = [&segments, &segment] {
+    if (segment == L"..") {
+      if (!segments.empty() && segments.back() != L"..") {
+        segments.pop_back();
+      } else {
+        segments.push_back(segment);
+      }
+    } else if (!segment.empty() && segment != L".") {
+      segments.push_back(segment);
+    }
+    segment.clear();
+  };
+
+  for (wchar_t c : path) {
+    if (c == L'/' || c == L'\\') {
+      flush();
+    } else {
+      segment.push_back(static_cast<wchar_t>(std::towlower(c)));
+    }
+  }
+  flush();
+
+  std::wstring normalized = is_absolute ? L"/" : L"";
+  for (size_t i = 0; i < segments.size(); ++i) {
+    if (i > 0) {
+      normalized.push_back(L'/');
+    }
+    normalized += segments[i];
+  }
+  return normalized;
+}
+
+// xxHash64: four independent lanes over 32-byte stripes, then the tail.
+auto HashAssetContent(const uint8_t *data, size_t size) -> uint64_t {
+  const uint8_t *cursor = data;
+  const uint8_t *end = data + size;
+  uint64_t hash = 0;
+
+  if (size >= 32) {
+    uint64_t lanes[4] = {kPrime1 + kPrime2, kPrime2, 0, 0ull - kPrime1};
+    for (; cursor + 32 <= end; cursor += 32) {
+      for (int i = 0; i < 4; ++i) {
+        lanes[i] = MixLane(lanes[i], ReadWord(cursor + i * 8));
+      }
+    }
+    hash = RotateLeft(lanes[0], 1) + RotateLeft(lanes[1], 7) +
+           RotateLeft(lanes[2], 12) + RotateLeft(lanes[3], 18);
+    for (uint64_t lane : lanes) {
+      hash = (hash ^ MixLane(0, lane)) * kPrime1 + kPrime4;
+    }
+  } else {
+    hash = kPrime5;
+  }
+  hash += size;
+
+  for (; cursor + 8 <= end; cursor += 8) {
+    hash ^= MixLane(0, ReadWord(cursor));
+    hash = RotateLeft(hash, 27) * kPrime1 + kPrime4;
+  }
+  if (cursor + 4 <= end) {
+    uint32_t word = 0;
+    memcpy(&word, cursor, sizeof(word));
+    hash ^= word * kPrime1;
+    hash = RotateLeft(hash, 23) * kPrime2 + kPrime3;
+    cursor += 4;
+  }
+  for (; cursor < end; ++cursor) {
+    hash ^= *cursor * kPrime5;
+    hash = RotateLeft(hash, 11) * kPrime1;
+  }
+
+  hash ^= hash >> 33;
+  hash *= kPrime2;
+  hash ^= hash >> 29;
+  hash *= kPrime3;
+  hash ^= hash >> 32;
+  return hash;
+}
+
+AssetRegistry::AssetRegistry() : state_(std::make_shared<State>()) {}
+
+auto AssetRegistry::Instance() -> AssetRegistry & {
+  static AssetRegistry registry;
+  return registry;
+}
+
+auto AssetRegistry::GetContentHash(FileSource &file_source,
+                                   const std::wstring &path, uint64_t &hash)
+    -> bool {
+  const std::wstring normalized = NormalizeAssetPath(path);
+
+  FileStamp stamp = {};
+  const bool has_stamp = file_source.GetStamp(path, stamp);
+  if (has_stamp) {
+    std::lock_guard<std::mutex> lock(state_->mutex);
+    auto it = state_->path_hashes.find(normalized);
+    if (it != state_->path_hashes.end() &&
+        it->second.stamp.size == stamp.size &&
+        it->second.stamp.last_write_time == stamp.last_write_time) {
+      hash = it->second.hash;
+      return true;
+    }
+  }
+
+  FileData file;
+  if (!file_source.ReadFile(path, file)) {
+    return false;
+  }
+  hash = HashAssetContent(file.GetData(), file.GetSize());
+
+  // Sources without stamps are hashed on every request.
+  if (has_stamp) {
+    std::lock_guard<std::mutex> lock(state_->mutex);
+    state_->path_hashes[normalized] = {stamp, hash};
+  }
+  return true;
+}
+
+auto AssetRegistry::AcquireErased(const AssetKey &key,
+                                  const ErasedLoader &load)
+    -> std::shared_ptr<const void> {
+  State &state = *state_;
+  AssetRegistryStats &stats = state.stats[static_cast<size_t>(key.kind)];
+
+  {
+    std::unique_lock<std::mutex> lock(state.mutex);
+    state.loaded.wait(lock, [&state, &key] {
+      auto it = state.entries.find(key);
+      return it == state.entries.end() || !it->second.is_loading;
+    });
+
+    Entry &entry = state.entries[key];
+    if (auto asset = entry.asset.lock()) {
+      ++stats.hits;
+      return asset;
+    }
+    ++stats.misses;
+    entry.is_loading = true;
+  }
+
+  // Loaded without the lock so other keys keep flowing.
+  size_t resident_bytes = 0;
+  std::shared_ptr<const void> asset = load(resident_bytes);
+
+  std::shared_ptr<const void> handle = nullptr;
+  if (asset) {
+    // The handle shares the asset's pointer but reports back to the registry
+    // when the last copy goes away.
+    std::weak_ptr<State> weak_state = state_;
+    handle = std::shared_ptr<const void>(
+        asset.get(), [asset, weak_state, key, resident_bytes](const void *) {
+          Release(weak_state, key, resident_bytes);
+        });
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(state.mutex);
+    if (handle) {
+      state.entries[key] = {handle, false};
+      ++stats.resident_count;
+      stats.resident_bytes += resident_bytes;
+    } else {
+      state.entries.erase(key);
+    }
+  }
+  state.loaded.notify_all();
+  return handle;
+}
+
+void AssetRegistry::Release(const std::weak_ptr<State> &weak_state,
+                            const AssetKey &key, size_t resident_bytes) {
+  auto state = weak_state.lock();
+  if (!state) {
+    return;
+  }
+
+  std::lock_guard<std::mutex> lock(state->mutex);
+  AssetRegistryStats &stats = state->stats[static_cast<size_t>(key.kind)];
+  --stats.resident_count;
+  stats.resident_bytes -= resident_bytes;
+
+  // A reload may already have replaced the entry.
+  auto it = state->entries.find(key);
+  if (it != state->entries.end() && !it->second.is_loading &&
+      it->second.asset.expired()) {
+    state->entries.erase(it);
+  }
+}
+
+auto AssetRegistry::GetStats(AssetKind kind) const -> AssetRegistryStats {
+  std::lock_guard<std::mutex> lock(state_->mutex);
+  return state_->stats[static_cast<size_t>(kind)];
+}
+
+void AssetRegistry::LogStats() const {
+  std::wstringstream stream;
+  for (size_t kind = 0; kind < static_cast<size_t>(AssetKind::kCount);
+       ++kind) {
+    const AssetRegistryStats stats = GetStats(static_cast<AssetKind>(kind));
+    stream << L"[AssetRegistry] " << kKindNames[kind] << L": " << stats.hits
+           << L" hits, " << stats.misses << L" misses, "
+           << stats.resident_count << L" resident ("
+           << stats.resident_bytes / 1024 << L" KB)\n";
+  }
+  WriteDebugOutput(stream.str().c_str());
+}
+
+} // namespace ResourceLoader
@@ -0,0 +1,163 @@
+#include "stdafx.h"
+
+#include "AssetStreamer.h"
+
+#include <sstream>
+#include <utility>
+
+#include "DebugOutput.h"
+#include "JobSystem.h"
+
+namespace ResourceLoader {
+
+namespace {
+
+// File reads block, so a couple of threads keep the disk busy without
+// competing with the frame's own jobs for cores.
+constexpr unsigned int kStreamingWorkerCount = 2;
+
+void LogStreamerMessage(const std::wstring &path, const wchar_t *message) {
+  std::wstringstream stream;
+  stream << L"[AssetStreamer] " << message << L": " << path << L"\n";
+  WriteDebugOutput(stream.str().c_str());
+}
+
+} // namespace
+
+auto AssetStreamer::BackgroundAwaiter::await_ready() const -> bool {
+  return job_system_.IsWorkerThread();
+}
+
+void AssetStreamer::BackgroundAwaiter::await_suspend(
+    std::coroutine_handle<> handle) const {
+  job_system_.Submit([handle] { handle.resume(); });
+}
+
+void AssetStreamer::MainThreadAwaiter::await_suspend(
+    std::coroutine_handle<> handle) const {
+  // The main thread may resume the coroutine, destroying this awaiter, as
+  // soon as the lock is released.
+  std::lock_guard<std::mutex> lock(streamer_.mutex_);
+  streamer_.main_thread_queue_.push_back(handle);
+  streamer_.idle_.notify_all();
+}
+
+AssetStreamer::AssetStreamer(FileSource &file_source, JobSystem &job_system)
+    : file_source_(file_source), job_system_(job_system) {}
+
+auto AssetStreamer::Instance() -> AssetStreamer & {
+  static JobSystem job_system(JobSystemConfig{kStreamingWorkerCount, false});
+  static AssetStreamer instance(GetDiskFileSource(), job_system);
+  return instance;
+}
+
+auto AssetStreamer::ReadFile(std::wstring path) -> Task<FileData> {
+  co_await ResumeInBackground();
+
+  FileData data;
+  if (!file_source_.ReadFile(path, data)) {
+    LogStreamerMessage(path, L"Could not read file");
+  }
+  co_return std::move(data);
+}
+
+auto AssetStreamer::LoadMesh(std::wstring text_path)
+    -> Task<std::unique_ptr<MeshFile>> {
+  co_await ResumeInBackground();
+  co_return ReadMesh(text_path);
+}
+
+auto AssetStreamer::ReadMesh(const std::wstring &text_path)
+    -> std::unique_ptr<MeshFile> {
+  const std::wstring mesh_path = GetMeshCachePath(text_path);
+  FileStamp source = {};
+  const bool has_source = file_source_.GetStamp(text_path, source);
+
+  auto mesh = std::make_unique<MeshFile>();
+  FileData cached;
+  if (file_source_.ReadFile(mesh_path, cached) &&
+      mesh->OpenFromData(std::move(cached)) && mesh->HasSourceLayout() &&
+      (!has_source || mesh->IsUpToDate(source))) {
+    return mesh;
+  }
+  mesh->Close();
+
+  FileData text;
+  if (!has_source || !file_source_.ReadFile(text_path, text)) {
+    LogStreamerMessage(text_path, L"Mesh source not found");
+    return nullptr;
+  }
+
+  std::vector<uint8_t> image;
+  if (!CookTextMeshImage(text_path, text, source, image)) {
+    return nullptr;
+  }
+
+  if (!file_source_.WriteFile(mesh_path, image)) {
+    LogStreamerMessage(mesh_path, L"Could not write mesh cache");
+  }
+
+  if (!mesh->OpenFromImage(std::move(image))) {
+    return nullptr;
+  }
+  return mesh;
+}
+
+void AssetStreamer::Spawn(Task<void> task) {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    ++pending_tasks_;
+  }
+  RunDetached(this, std::move(task));
+}
+
+auto AssetStreamer::RunDetached(AssetStreamer *streamer, Task<void> task)
+    -> DetachedTask {
+  co_await task;
+  // Free the task's frame before reporting it finished, so nothing is left
+  // running once WaitIdle returns.
+  task = Task<void>();
+  streamer->FinishTask();
+}
+
+void AssetStreamer::FinishTask() {
+  // Notified under the lock: once WaitIdle sees the count drop, the streamer
+  // may be destroyed.
+  std::lock_guard<std::mutex> lock(mutex_);
+  --pending_tasks_;
+  idle_.notify_all();
+}
+
+void AssetStreamer::PumpMainThread() {
+  std::vector<std::coroutine_handle<>> ready;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    ready.swap(main_thread_queue_);
+  }
+
+  // Anything these queue for the main thread runs on the next pump.
+  for (auto handle : ready) {
+    handle.resume();
+  }
+}
+
+void AssetStreamer::WaitIdle() {
+  for (;;) {
+    PumpMainThread();
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (pending_tasks_ == 0 && main_thread_queue_.empty()) {
+      return;
+    }
+    idle_.wait(lock, [this] {
+      return pending_tasks_ == 0 || !main_thread_queue_.empty();
+    });
+  }
+}
+
+auto AssetStreamer::GetPendingTaskCount() const -> size_t {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return pending_tasks_;
+}
+
+} // namespace ResourceLoader
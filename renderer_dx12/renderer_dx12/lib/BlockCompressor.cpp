@@ -0,0 +1,1035 @@
+#include "stdafx.h"
+
+#include "BlockCompressor.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+#include <iterator>
+#include <utility>
+
+#include "JobSystem.h"
+
+#if defined(_M_X64) || defined(_M_AMD64) || defined(__SSE2__)
+#define BLOCK_COMPRESSOR_USE_SSE 1
+#include <emmintrin.h>
+#else
+#define BLOCK_COMPRESSOR_USE_SSE 0
+#endif
+
+namespace ResourceLoader {
+
+namespace {
+
+constexpr uint32_t kBlockPixels = 16;
+
+constexpr uint32_t kAllPixels = 0xffff;
+
+// Images with fewer blocks than this are compressed on the calling thread.
+constexpr size_t kParallelBlockThreshold = 256;
+
+// Two-subset BC7 partitions fully encoded after ranking all 64 by estimate.
+constexpr uint32_t kBC7PartitionCandidates = 2;
+
+const float kColorWeights[4] = {1.0f, 1.0f, 1.0f, 0.0f};
+const float kAllWeights[4] = {1.0f, 1.0f, 1.0f, 1.0f};
+const float kFirstChannelWeights[4] = {1.0f, 0.0f, 0.0f, 0.0f};
+
+// Where each index sits between the two endpoints; a negative weight keeps
+// the index out of the endpoint fit (BC4's constant 0 and 255).
+const float kBC1IndexWeights[4] = {0.0f, 1.0f, 1.0f / 3.0f, 2.0f / 3.0f};
+const float kBC4IndexWeights8[8] = {0.0f,        1.0f,        1.0f / 7.0f,
+                                    2.0f / 7.0f, 3.0f / 7.0f, 4.0f / 7.0f,
+                                    5.0f / 7.0f, 6.0f / 7.0f};
+const float kBC4IndexWeights6[8] = {0.0f,        1.0f,        1.0f / 5.0f,
+                                    2.0f / 5.0f, 3.0f / 5.0f, 4.0f / 5.0f,
+                                    -1.0f,       -1.0f};
+
+const uint32_t kBC7Weights3[8] = {0, 9, 18, 27, 37, 46, 55, 64};
+const uint32_t kBC7Weights4[16] = {0,  4,  9,  13, 17, 21, 26, 30,
+                                   34, 38, 43, 47, 51, 55, 60, 64};
+
+// BC7 two-subset partitions: bit i set means pixel i is in subset 1.
+const uint16_t kBC7Partitions2[64] = {
+    0xcccc, 0x8888, 0xeeee, 0xecc8, 0xc880, 0xfeec, 0xfec8, 0xec80,
+    0xc800, 0xffec, 0xfe80, 0xe800, 0xffe8, 0xff00, 0xfff0, 0xf000,
+    0xf710, 0x008e, 0x7100, 0x08ce, 0x008c, 0x7310, 0x3100, 0x8cce,
+    0x088c, 0x3110, 0x6666, 0x366c, 0x17e8, 0x0ff0, 0x718e, 0x399c,
+    0xaaaa, 0xf0f0, 0x5a5a, 0x33cc, 0x3c3c, 0x55aa, 0x9696, 0xa55a,
+    0x73ce, 0x13c8, 0x324c, 0x3bdc, 0x6996, 0xc33c, 0x9966, 0x0660,
+    0x0272, 0x04e4, 0x4e40, 0x2720, 0xc936, 0x936c, 0x39c6, 0x639c,
+    0x9336, 0x9cc6, 0x817e, 0xe718, 0xccf0, 0x0fcc, 0x7744, 0xee22};
+
+// Anchor (first index with an implied zero top bit) of subset 1.
+const uint8_t kBC7Anchors2[64] = {
+    15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15,
+    15, 2,  8,  2,  2,  8,  8,  15, 2,  8,  2,  2,  8,  8,  2,  2,
+    15, 15, 6,  8,  2,  8,  15, 15, 2,  8,  2,  2,  2,  15, 15, 6,
+    6,  2,  6,  8,  15, 15, 2,  2,  15, 15, 15, 15, 15, 2,  2,  15};
+
+// One 4x4 block as floats, a row of 16 pixels per channel.
+struct Block {
+  alignas(16) float channel[4][kBlockPixels];
+};
+
+struct Endpoints {
+  float low[4] = {};
+  float high[4] = {};
+};
+
+struct QualitySettings {
+  uint32_t refine_iterations = 0;
+  bool use_principal_axis = false;
+  bool try_bc4_six_value_mode = false;
+  bool try_bc7_partitions = false;
+};
+
+auto GetQualitySettings(CompressionQuality quality) -> QualitySettings {
+  switch (quality) {
+  case CompressionQuality::kFast:
+    return {0, false, false, false};
+  case CompressionQuality::kBalanced:
+    return {2, true, false, false};
+  case CompressionQuality::kHigh:
+    return {6, true, true, true};
+  }
+  return {};
+}
+
+auto ClampByte(float value) -> float {
+  return std::min(std::max(value, 0.0f), 255.0f);
+}
+
+void LoadBlock(const uint8_t *pixels, uint32_t width, uint32_t height,
+               uint32_t block_x, uint32_t block_y, Block &block) {
+  for (uint32_t i = 0; i < kBlockPixels; ++i) {
+    const uint32_t x = std::min(block_x * 4 + (i & 3), width - 1);
+    const uint32_t y = std::min(block_y * 4 + (i >> 2), height - 1);
+    const uint8_t *texel = pixels + (static_cast<size_t>(y) * width + x) * 4;
+    for (uint32_t c = 0; c < 4; ++c) {
+      block.channel[c][i] = texel[c];
+    }
+  }
+}
+
+// Nearest palette entry for every pixel, four pixels at a time. errors gets
+// each pixel's weighted squared error; the sum over mask is returned.
+auto AssignIndices(const Block &block, const float (*palette)[4],
+                   uint32_t palette_size, const float weights[4],
+                   uint32_t mask, uint8_t indices[kBlockPixels],
+                   float errors[kBlockPixels]) -> float {
+#if BLOCK_COMPRESSOR_USE_SSE
+  alignas(16) float best_index[kBlockPixels];
+  for (uint32_t group = 0; group < kBlockPixels; group += 4) {
+    __m128 pixel[4];
+    for (uint32_t c = 0; c < 4; ++c) {
+      pixel[c] = _mm_load_ps(&block.channel[c][group]);
+    }
+
+    __m128 best = _mm_set1_ps(FLT_MAX);
+    __m128 index = _mm_setzero_ps();
+    for (uint32_t p = 0; p < palette_size; ++p) {
+      __m128 distance = _mm_setzero_ps();
+      for (uint32_t c = 0; c < 4; ++c) {
+        const __m128 delta = _mm_sub_ps(_mm_set1_ps(palette[p][c]), pixel[c]);
+        distance = _mm_add_ps(
+            distance,
+            _mm_mul_ps(_mm_mul_ps(delta, delta), _mm_set1_ps(weights[c])));
+      }
+      const __m128 closer = _mm_cmplt_ps(distance, best);
+      best = _mm_min_ps(distance, best);
+      index = _mm_or_ps(_mm_and_ps(closer, _mm_set1_ps(static_cast<float>(p))),
+                        _mm_andnot_ps(closer, index));
+    }
+    _mm_storeu_ps(errors + group, best);
+    _mm_store_ps(best_index + group, index);
+  }
+  for (uint32_t i = 0; i < kBlockPixels; ++i) {
+    indices[i] = static_cast<uint8_t>(best_index[i]);
+  }
+#else
+  for (uint32_t i = 0; i < kBlockPixels; ++i) {
+    float best = FLT_MAX;
+    uint8_t index = 0;
+    for (uint32_t p = 0; p < palette_size; ++p) {
+      float distance = 0.0f;
+      for (uint32_t c = 0; c < 4; ++c) {
+        const float delta = palette[p][c] - block.channel[c][i];
+        distance += delta * delta * weights[c];
+      }
+      if (distance < best) {
+        best = distance;
+        index = static_cast<uint8_t>(p);
+      }
+    }
+    errors[i] = best;
+    indices[i] = index;
+  }
+#endif
+
+  float total = 0.0f;
+  for (uint32_t i = 0; i < kBlockPixels; ++i) {
+    if (mask & (1u << i)) {
+      total += errors[i];
+    }
+  }
+  return total;
+}
+
+// Per-channel bounds of the pixels in mask.
+auto BoundingBoxEndpoints(const Block &block, uint32_t mask) -> Endpoints {
+  Endpoints endpoints = {};
+  for (uint32_t c = 0; c < 4; ++c) {
+    endpoints.low[c] = 255.0f;
+    endpoints.high[c] = 0.0f;
+    for (uint32_t i = 0; i < kBlockPixels; ++i) {
+      if (mask & (1u << i)) {
+        endpoints.low[c] = std::min(endpoints.low[c], block.channel[c][i]);
+        endpoints.high[c] = std::max(endpoints.high[c], block.channel[c][i]);
+      }
+    }
+  }
+  return endpoints;
+}
+
+// Extent of the pixels in mask along their principal axis, found by power
+// iteration on the covariance of the weighted channels.
+auto PrincipalAxisEndpoints(const Block &block, uint32_t mask,
+                            const float weights[4]) -> Endpoints {
+  float mean[4] = {};
+  float count = 0.0f;
+  for (uint32_t i = 0; i < kBlockPixels; ++i) {
+    if (mask & (1u << i)) {
+      for (uint32_t c = 0; c < 4; ++c) {
+        mean[c] += block.channel[c][i];
+      }
+      count += 1.0f;
+    }
+  }
+  if (count == 0.0f) {
+    return {};
+  }
+  for (float &value : mean) {
+    value /= count;
+  }
+
+  float covariance[4][4] = {};
+  for (uint32_t i = 0; i < kBlockPixels; ++i) {
+    if (!(mask & (1u << i))) {
+      continue;
+    }
+    float delta[4];
+    for (uint32_t c = 0; c < 4; ++c) {
+      delta[c] = (block.channel[c][i] - mean[c]) * weights[c];
+    }
+    for (uint32_t r = 0; r < 4; ++r) {
+      for (uint32_t c = 0; c < 4; ++c) {
+        covariance[r][c] += delta[r] * delta[c];
+      }
+    }
+  }
+
+  // Starting from the bounding-box diagonal converges in a few steps.
+  const Endpoints bounds = BoundingBoxEndpoints(block, mask);
+  float axis[4];
+  for (uint32_t c = 0; c < 4; ++c) {
+    axis[c] = (bounds.high[c] - bounds.low[c]) * weights[c];
+  }
+  for (int iteration = 0; iteration < 8; ++iteration) {
+    float next[4] = {};
+    for (uint32_t r = 0; r < 4; ++r) {
+      for (uint32_t c = 0; c < 4; ++c) {
+        next[r] += covariance[r][c] * axis[c];
+      }
+    }
+    const float length = std::sqrt(next[0] * next[0] + next[1] * next[1] +
+                                   next[2] * next[2] + next[3] * next[3]);
+    if (length < 1e-6f) {
+      break;
+    }
+    for (uint32_t c = 0; c < 4; ++c) {
+      axis[c] = next[c] / length;
+    }
+  }
+
+  const float axis_length_squared = axis[0] * axis[0] + axis[1] * axis[1] +
+                                    axis[2] * axis[2] + axis[3] * axis[3];
+  Endpoints endpoints = {};
+  if (axis_length_squared < 1e-12f) {
+    for (uint32_t c = 0; c < 4; ++c) {
+      endpoints.low[c] = endpoints.high[c] = mean[c];
+    }
+    return endpoints;
+  }
+
+  float low = FLT_MAX;
+  float high = -FLT_MAX;
+  for (uint32_t i = 0; i < kBlockPixels; ++i) {
+    if (!(mask & (1u << i))) {
+      continue;
+    }
+    float t = 0.0f;
+    for (uint32_t c = 0; c < 4; ++c) {
+      t += (block.channel[c][i] - mean[c]) * axis[c];
+    }
+    low = std::min(low, t);
+    high = std::max(high, t);
+  }
+  const float scale = 1.0f / axis_length_squared;
+  for (uint32_t c = 0; c < 4; ++c) {
+    endpoints.low[c] = ClampByte(mean[c] + axis[c] * low * scale);
+    endpoints.high[c] = ClampByte(mean[c] + axis[c] * high * scale);
+  }
+  return endpoints;
+}
+
+auto InitialEndpoints(const Block &block, uint32_t mask,
+                      const float weights[4], const QualitySettings &settings)
+    -> Endpoints {
+  return settings.use_principal_axis
+             ? PrincipalAxisEndpoints(block, mask, weights)
+             : BoundingBoxEndpoints(block, mask);
+}
+
+// Least-squares endpoints for fixed indices: each pixel in mask is modeled
+// as low + (high - low) * index_weights[index].
+auto FitEndpoints(const Block &block, uint32_t mask,
+                  const uint8_t indices[kBlockPixels],
+                  const float *index_weights, Endpoints &endpoints) -> bool {
+  float aa = 0.0f;
+  float ab = 0.0f;
+  float bb = 0.0f;
+  float ax[4] = {};
+  float bx[4] = {};
+  for (uint32_t i = 0; i < kBlockPixels; ++i) {
+    const float w = index_weights[indices[i]];
+    if (!(mask & (1u << i)) || w < 0.0f) {
+      continue;
+    }
+    const float a = 1.0f - w;
+    aa += a * a;
+    ab += a * w;
+    bb += w * w;
+    for (uint32_t c = 0; c < 4; ++c) {
+      ax[c] += a * block.channel[c][i];
+      bx[c] += w * block.channel[c][i];
+    }
+  }
+
+  const float determinant = aa * bb - ab * ab;
+  if (std::fabs(determinant) < 1e-6f) {
+    return false;
+  }
+  const float inverse = 1.0f / determinant;
+  for (uint32_t c = 0; c < 4; ++c) {
+    endpoints.low[c] = ClampByte((bb * ax[c] - ab * bx[c]) * inverse);
+    endpoints.high[c] = ClampByte((aa * bx[c] - ab * ax[c]) * inverse);
+  }
+  return true;
+}
+
+// Writes bits LSB first; the block must start zeroed.
+class BitWriter {
+public:
+  explicit BitWriter(uint8_t *output) : output_(output) {}
+
+  void Put(uint32_t value, uint32_t bit_count) {
+    for (uint32_t bit = 0; bit < bit_count; ++bit, ++position_) {
+      if ((value >> bit) & 1u) {
+        output_[position_ >> 3] |= static_cast<uint8_t>(1u << (position_ & 7));
+      }
+    }
+  }
+
+private:
+  uint8_t *output_ = nullptr;
+  uint32_t position_ = 0;
+};
+
+//
+// BC1 color
+//
+
+auto Pack565(const float color[4]) -> uint16_t {
+  const auto r =
+      static_cast<uint32_t>(ClampByte(color[0]) * 31.0f / 255.0f + 0.5f);
+  const auto g =
+      static_cast<uint32_t>(ClampByte(color[1]) * 63.0f / 255.0f + 0.5f);
+  const auto b =
+      static_cast<uint32_t>(ClampByte(color[2]) * 31.0f / 255.0f + 0.5f);
+  return static_cast<uint16_t>((r << 11) | (g << 5) | b);
+}
+
+void Unpack565(uint16_t packed, float color[4]) {
+  const uint32_t r = (packed >> 11) & 31;
+  const uint32_t g = (packed >> 5) & 63;
+  const uint32_t b = packed & 31;
+  color[0] = static_cast<float>((r << 3) | (r >> 2));
+  color[1] = static_cast<float>((g << 2) | (g >> 4));
+  color[2] = static_cast<float>((b << 3) | (b >> 2));
+  color[3] = 0.0f;
+}
+
+// Four-color BC1 block (color0 > color1); also the color half of BC3.
+// endpoints.low is color0 throughout, matching the index weights.
+void EncodeColorBlock(const Block &block, const QualitySettings &settings,
+                      uint8_t *output) {
+  Endpoints endpoints =
+      InitialEndpoints(block, kAllPixels, kColorWeights, settings);
+  // Brighter end first, so color0 > color1 usually holds without a swap.
+  std::swap(endpoints.low, endpoints.high);
+
+  float best_error = FLT_MAX;
+  uint16_t best_colors[2] = {};
+  uint8_t best_indices[kBlockPixels] = {};
+
+  for (uint32_t iteration = 0;; ++iteration) {
+    uint16_t color0 = Pack565(endpoints.low);
+    uint16_t color1 = Pack565(endpoints.high);
+    if (color0 < color1) {
+      std::swap(color0, color1);
+    }
+
+    float palette[4][4];
+    Unpack565(color0, palette[0]);
+    Unpack565(color1, palette[1]);
+    for (uint32_t c = 0; c < 3; ++c) {
+      palette[2][c] =
+          std::floor((2.0f * palette[0][c] + palette[1][c]) / 3.0f + 0.5f);
+      palette[3][c] =
+          std::floor((palette[0][c] + 2.0f * palette[1][c]) / 3.0f + 0.5f);
+    }
+    palette[2][3] = palette[3][3] = 0.0f;
+    // Equal colors select the three-color mode; index 0 is still color0.
+    const uint32_t palette_size = color0 == color1 ? 1 : 4;
+
+    uint8_t indices[kBlockPixels];
+    float errors[kBlockPixels];
+    const float error = AssignIndices(block, palette, palette_size,
+                                      kColorWeights, kAllPixels, indices,
+                                      errors);
+    if (error < best_error) {
+      best_error = error;
+      best_colors[0] = color0;
+      best_colors[1] = color1;
+      memcpy(best_indices, indices, sizeof(indices));
+    }
+
+    if (iteration >= settings.refine_iterations || error == 0.0f ||
+        palette_size == 1 ||
+        !FitEndpoints(block, kAllPixels, indices, kBC1IndexWeights,
+                      endpoints)) {
+      break;
+    }
+  }
+
+  uint32_t packed_indices = 0;
+  for (uint32_t i = 0; i < kBlockPixels; ++i) {
+    packed_indices |= static_cast<uint32_t>(best_indices[i]) << (i * 2);
+  }
+  memcpy(output, &best_colors[0], 2);
+  memcpy(output + 2, &best_colors[1], 2);
+  memcpy(output + 4, &packed_indices, 4);
+}
+
+//
+// BC4 single channel
+//
+
+struct ChannelBlockResult {
+  float error = FLT_MAX;
+  uint8_t endpoint0 = 0;
+  uint8_t endpoint1 = 0;
+  uint8_t indices[kBlockPixels] = {};
+};
+
+void BuildBC4Palette(uint8_t endpoint0, uint8_t endpoint1,
+                     float (&palette)[8][4]) {
+  for (auto &entry : palette) {
+    entry[0] = entry[1] = entry[2] = entry[3] = 0.0f;
+  }
+  const float a0 = endpoint0;
+  const float a1 = endpoint1;
+  palette[0][0] = a0;
+  palette[1][0] = a1;
+  if (endpoint0 > endpoint1) {
+    for (uint32_t i = 2; i < 8; ++i) {
+      palette[i][0] =
+          std::floor(((8.0f - i) * a0 + (i - 1.0f) * a1) / 7.0f + 0.5f);
+    }
+  } else {
+    for (uint32_t i = 2; i < 6; ++i) {
+      palette[i][0] =
+          std::floor(((6.0f - i) * a0 + (i - 1.0f) * a1) / 5.0f + 0.5f);
+    }
+    palette[6][0] = 0.0f;
+    palette[7][0] = 255.0f;
+  }
+}
+
+// One mode of a channel block: eight interpolated values (endpoint0 >
+// endpoint1), or six plus constant 0 and 255 (endpoint0 <= endpoint1).
+// endpoints.low is endpoint0 throughout, matching the index weights.
+void EncodeChannelMode(const Block &block, bool six_value_mode,
+                       Endpoints endpoints, uint32_t iterations,
+                       ChannelBlockResult &best) {
+  const float *index_weights =
+      six_value_mode ? kBC4IndexWeights6 : kBC4IndexWeights8;
+
+  for (uint32_t iteration = 0;; ++iteration) {
+    auto endpoint0 = static_cast<uint8_t>(ClampByte(endpoints.low[0]) + 0.5f);
+    auto endpoint1 = static_cast<uint8_t>(ClampByte(endpoints.high[0]) + 0.5f);
+    if (six_value_mode != (endpoint0 <= endpoint1)) {
+      std::swap(endpoint0, endpoint1);
+    }
+    if (!six_value_mode && endpoint0 == endpoint1) {
+      // Keeps the eight-value mode; index 0 or 1 is still exact.
+      if (endpoint0 < 255) {
+        ++endpoint0;
+      } else {
+        --endpoint1;
+      }
+    }
+
+    float palette[8][4];
+    BuildBC4Palette(endpoint0, endpoint1, palette);
+
+    uint8_t indices[kBlockPixels];
+    float errors[kBlockPixels];
+    const float error = AssignIndices(block, palette, 8, kFirstChannelWeights,
+                                      kAllPixels, indices, errors);
+    if (error < best.error) {
+      best.error = error;
+      best.endpoint0 = endpoint0;
+      best.endpoint1 = endpoint1;
+      memcpy(best.indices, indices, sizeof(indices));
+    }
+
+    if (iteration >= iterations || error == 0.0f ||
+        !FitEndpoints(block, kAllPixels, indices, index_weights, endpoints)) {
+      break;
+    }
+  }
+}
+
+// Encodes channel `channel` of the block as a BC4 block.
+void EncodeChannelBlock(const Block &source, uint32_t channel,
+                        const QualitySettings &settings, uint8_t *output) {
+  Block block = {};
+  memcpy(block.channel[0], source.channel[channel], sizeof(block.channel[0]));
+
+  ChannelBlockResult best = {};
+  Endpoints bounds = BoundingBoxEndpoints(block, kAllPixels);
+  std::swap(bounds.low, bounds.high);
+  EncodeChannelMode(block, false, bounds, settings.refine_iterations, best);
+
+  if (settings.try_bc4_six_value_mode && best.error > 0.0f) {
+    // Pixels at 0 or 255 come for free, so the range covers the rest.
+    Endpoints inner = {};
+    inner.low[0] = 255.0f;
+    inner.high[0] = 0.0f;
+    for (uint32_t i = 0; i < kBlockPixels; ++i) {
+      const float value = block.channel[0][i];
+      if (value > 0.0f && value < 255.0f) {
+        inner.low[0] = std::min(inner.low[0], value);
+        inner.high[0] = std::max(inner.high[0], value);
+      }
+    }
+    if (inner.low[0] <= inner.high[0]) {
+      EncodeChannelMode(block, true, inner, settings.refine_iterations, best);
+    }
+  }
+
+  output[0] = best.endpoint0;
+  output[1] = best.endpoint1;
+  uint64_t packed_indices = 0;
+  for (uint32_t i = 0; i < kBlockPixels; ++i) {
+    packed_indices |= static_cast<uint64_t>(best.indices[i]) << (i * 3);
+  }
+  for (uint32_t i = 0; i < 6; ++i) {
+    output[2 + i] = static_cast<uint8_t>(packed_indices >> (i * 8));
+  }
+}
+
+//
+// BC7
+//
+
+struct BC7Result {
+  float error = FLT_MAX;
+  uint32_t mode = 6;
+  uint32_t partition = 0;
+  // Quantized endpoints per subset (low, high) and their p-bits.
+  uint32_t endpoints[2][2][4] = {};
+  uint32_t pbits[2][2] = {};
+  uint8_t indices[kBlockPixels] = {};
+};
+
+auto InterpolateBC7(uint32_t low, uint32_t high, uint32_t weight) -> float {
+  return static_cast<float>(((64 - weight) * low + weight * high + 32) >> 6);
+}
+
+// Mode 6: one subset, RGBA 7.7.7.7 endpoints with a p-bit each, 4-bit
+// indices.
+void QuantizeMode6Endpoint(const float value[4], uint32_t quantized[4],
+                           uint32_t &pbit) {
+  float best_error = FLT_MAX;
+  for (uint32_t p = 0; p < 2; ++p) {
+    uint32_t candidate[4];
+    float error = 0.0f;
+    for (uint32_t c = 0; c < 4; ++c) {
+      const float q = std::floor((value[c] - p) / 2.0f + 0.5f);
+      candidate[c] = static_cast<uint32_t>(std::min(std::max(q, 0.0f), 127.0f));
+      const float delta = static_cast<float>(candidate[c] * 2 + p) - value[c];
+      error += delta * delta;
+    }
+    if (error < best_error) {
+      best_error = error;
+      pbit = p;
+      memcpy(quantized, candidate, sizeof(candidate));
+    }
+  }
+}
+
+void EncodeBC7Mode6(const Block &block, const QualitySettings &settings,
+                    BC7Result &best) {
+  Endpoints endpoints =
+      InitialEndpoints(block, kAllPixels, kAllWeights, settings);
+
+  float index_weights[16];
+  for (uint32_t i = 0; i < 16; ++i) {
+    index_weights[i] = kBC7Weights4[i] / 64.0f;
+  }
+
+  for (uint32_t iteration = 0;; ++iteration) {
+    uint32_t quantized[2][4];
+    uint32_t pbits[2];
+    QuantizeMode6Endpoint(endpoints.low, quantized[0], pbits[0]);
+    QuantizeMode6Endpoint(endpoints.high, quantized[1], pbits[1]);
+
+    uint32_t expanded[2][4];
+    for (uint32_t e = 0; e < 2; ++e) {
+      for (uint32_t c = 0; c < 4; ++c) {
+        expanded[e][c] = quantized[e][c] * 2 + pbits[e];
+      }
+    }
+    float palette[16][4];
+    for (uint32_t i = 0; i < 16; ++i) {
+      for (uint32_t c = 0; c < 4; ++c) {
+        palette[i][c] =
+            InterpolateBC7(expanded[0][c], expanded[1][c], kBC7Weights4[i]);
+      }
+    }
+
+    uint8_t indices[kBlockPixels];
+    float errors[kBlockPixels];
+    const float error = AssignIndices(block, palette, 16, kAllWeights,
+                                      kAllPixels, indices, errors);
+    if (error < best.error) {
+      best.error = error;
+      best.mode = 6;
+      best.partition = 0;
+      memcpy(best.endpoints[0], quantized, sizeof(quantized));
+      best.pbits[0][0] = pbits[0];
+      best.pbits[0][1] = pbits[1];
+      memcpy(best.indices, indices, sizeof(indices));
+    }
+
+    if (iteration >= settings.refine_iterations || error == 0.0f ||
+        !FitEndpoints(block, kAllPixels, indices, index_weights, endpoints)) {
+      break;
+    }
+  }
+}
+
+// Mode 1: two subsets, RGB 6.6.6 endpoints with one p-bit per subset, 3-bit
+// indices, alpha fixed at 255.
+void QuantizeMode1Endpoints(const Endpoints &endpoints,
+                            uint32_t quantized[2][4], uint32_t &pbit) {
+  float best_error = FLT_MAX;
+  for (uint32_t p = 0; p < 2; ++p) {
+    uint32_t candidate[2][4] = {};
+    float error = 0.0f;
+    for (uint32_t e = 0; e < 2; ++e) {
+      const float *value = e == 0 ? endpoints.low : endpoints.high;
+      for (uint32_t c = 0; c < 3; ++c) {
+        // Seven bits with the p-bit, expanded to eight by the decoder.
+        const float target = value[c] * 127.0f / 255.0f;
+        const float q = std::floor((target - p) / 2.0f + 0.5f);
+        candidate[e][c] =
+            static_cast<uint32_t>(std::min(std::max(q, 0.0f), 63.0f));
+        const uint32_t seven = candidate[e][c] * 2 + p;
+        const float delta =
+            static_cast<float>((seven << 1) | (seven >> 6)) - value[c];
+        error += delta * delta;
+      }
+    }
+    if (error < best_error) {
+      best_error = error;
+      pbit = p;
+      memcpy(quantized, candidate, sizeof(candidate));
+    }
+  }
+}
+
+void BuildMode1Palette(const uint32_t quantized[2][4], uint32_t pbit,
+                       float (&palette)[8][4]) {
+  uint32_t expanded[2][3];
+  for (uint32_t e = 0; e < 2; ++e) {
+    for (uint32_t c = 0; c < 3; ++c) {
+      const uint32_t seven = quantized[e][c] * 2 + pbit;
+      expanded[e][c] = (seven << 1) | (seven >> 6);
+    }
+  }
+  for (uint32_t i = 0; i < 8; ++i) {
+    for (uint32_t c = 0; c < 3; ++c) {
+      palette[i][c] =
+          InterpolateBC7(expanded[0][c], expanded[1][c], kBC7Weights3[i]);
+    }
+    palette[i][3] = 255.0f;
+  }
+}
+
+// Error of one subset for the given endpoints, with its indices merged into
+// indices.
+auto EncodeMode1Subset(const Block &block, uint32_t mask, Endpoints endpoints,
+                       uint32_t iterations, uint32_t quantized[2][4],
+                       uint32_t &pbit, uint8_t indices[kBlockPixels]) -> float {
+  float index_weights[8];
+  for (uint32_t i = 0; i < 8; ++i) {
+    index_weights[i] = kBC7Weights3[i] / 64.0f;
+  }
+
+  float best_error = FLT_MAX;
+  for (uint32_t iteration = 0;; ++iteration) {
+    uint32_t candidate[2][4];
+    uint32_t candidate_pbit = 0;
+    QuantizeMode1Endpoints(endpoints, candidate, candidate_pbit);
+
+    float palette[8][4];
+    BuildMode1Palette(candidate, candidate_pbit, palette);
+
+    uint8_t subset_indices[kBlockPixels];
+    float errors[kBlockPixels];
+    const float error = AssignIndices(block, palette, 8, kAllWeights, mask,
+                                      subset_indices, errors);
+    if (error < best_error) {
+      best_error = error;
+      memcpy(quantized, candidate, sizeof(candidate));
+      pbit = candidate_pbit;
+      for (uint32_t i = 0; i < kBlockPixels; ++i) {
+        if (mask & (1u << i)) {
+          indices[i] = subset_indices[i];
+        }
+      }
+    }
+
+    if (iteration >= iterations || error == 0.0f ||
+        !FitEndpoints(block, mask, subset_indices, index_weights, endpoints)) {
+      break;
+    }
+  }
+  return best_error;
+}
+
+// Sums over a set of pixels from which the best-fit line through their RGB
+// values can be found: count, sums and the six distinct products.
+struct LineMoments {
+  float value[10] = {};
+};
+
+// Each pixel's own moments, so a subset's sums are additions only.
+struct PixelMoments {
+  float value[10][kBlockPixels];
+};
+
+void ComputePixelMoments(const Block &block, PixelMoments &moments) {
+  for (uint32_t i = 0; i < kBlockPixels; ++i) {
+    const float r = block.channel[0][i];
+    const float g = block.channel[1][i];
+    const float b = block.channel[2][i];
+    const float values[10] = {1.0f,  r,     g,     b,     r * r,
+                              r * g, r * b, g * g, g * b, b * b};
+    for (uint32_t m = 0; m < 10; ++m) {
+      moments.value[m][i] = values[m];
+    }
+  }
+}
+
+auto SumMoments(const PixelMoments &moments, uint32_t mask) -> LineMoments {
+  LineMoments sum = {};
+  for (uint32_t i = 0; i < kBlockPixels; ++i) {
+    if (mask & (1u << i)) {
+      for (uint32_t m = 0; m < 10; ++m) {
+        sum.value[m] += moments.value[m][i];
+      }
+    }
+  }
+  return sum;
+}
+
+// Squared distance of the pixels from their best-fit line: the covariance
+// trace less its largest eigenvalue. Ignores quantization, so it is only good
+// for ranking partitions.
+auto EstimateLineError(const LineMoments &moments) -> float {
+  const float count = moments.value[0];
+  if (count < 2.0f) {
+    return 0.0f;
+  }
+  const float *sum = moments.value + 1;
+  const float *products = moments.value + 4;
+  const float inverse_count = 1.0f / count;
+  const float rr = products[0] - sum[0] * sum[0] * inverse_count;
+  const float rg = products[1] - sum[0] * sum[1] * inverse_count;
+  const float rb = products[2] - sum[0] * sum[2] * inverse_count;
+  const float gg = products[3] - sum[1] * sum[1] * inverse_count;
+  const float gb = products[4] - sum[1] * sum[2] * inverse_count;
+  const float bb = products[5] - sum[2] * sum[2] * inverse_count;
+
+  float axis[3] = {1.0f, 1.0f, 1.0f};
+  float eigenvalue = 0.0f;
+  for (int iteration = 0; iteration < 4; ++iteration) {
+    const float next[3] = {rr * axis[0] + rg * axis[1] + rb * axis[2],
+                           rg * axis[0] + gg * axis[1] + gb * axis[2],
+                           rb * axis[0] + gb * axis[1] + bb * axis[2]};
+    eigenvalue =
+        std::sqrt(next[0] * next[0] + next[1] * next[1] + next[2] * next[2]);
+    if (eigenvalue < 1e-6f) {
+      break;
+    }
+    for (uint32_t c = 0; c < 3; ++c) {
+      axis[c] = next[c] / eigenvalue;
+    }
+  }
+  return std::max(rr + gg + bb - eigenvalue, 0.0f);
+}
+
+void EncodeBC7Mode1(const Block &block, const QualitySettings &settings,
+                    BC7Result &best) {
+  // Rank every partition by how well a line fits each subset, then encode
+  // the few best for real.
+  uint32_t candidates[kBC7PartitionCandidates];
+  float estimates[kBC7PartitionCandidates];
+  std::fill(std::begin(estimates), std::end(estimates), FLT_MAX);
+  PixelMoments moments;
+  ComputePixelMoments(block, moments);
+  const LineMoments total = SumMoments(moments, kAllPixels);
+  for (uint32_t partition = 0; partition < 64; ++partition) {
+    const LineMoments subset1 = SumMoments(moments, kBC7Partitions2[partition]);
+    LineMoments subset0 = {};
+    for (uint32_t m = 0; m < 10; ++m) {
+      subset0.value[m] = total.value[m] - subset1.value[m];
+    }
+    const float estimate =
+        EstimateLineError(subset0) + EstimateLineError(subset1);
+    uint32_t slot = kBC7PartitionCandidates;
+    while (slot > 0 && estimate < estimates[slot - 1]) {
+      if (slot < kBC7PartitionCandidates) {
+        estimates[slot] = estimates[slot - 1];
+        candidates[slot] = candidates[slot - 1];
+      }
+      --slot;
+    }
+    if (slot < kBC7PartitionCandidates) {
+      estimates[slot] = estimate;
+      candidates[slot] = partition;
+    }
+  }
+
+  for (uint32_t candidate : candidates) {
+    BC7Result result = {};
+    result.mode = 1;
+    result.partition = candidate;
+    result.error = 0.0f;
+    const uint32_t masks[2] = {~kBC7Partitions2[candidate] & kAllPixels,
+                               kBC7Partitions2[candidate]};
+    for (uint32_t s = 0; s < 2 && result.error < best.error; ++s) {
+      result.error += EncodeMode1Subset(
+          block, masks[s],
+          PrincipalAxisEndpoints(block, masks[s], kColorWeights),
+          settings.refine_iterations, result.endpoints[s], result.pbits[s][0],
+          result.indices);
+      result.pbits[s][1] = result.pbits[s][0];
+    }
+    if (result.error < best.error) {
+      best = result;
+    }
+  }
+}
+
+// Swaps a subset's endpoints where its anchor index has the top bit set, so
+// that bit can be left out of the block.
+void FixAnchors(BC7Result &result, uint32_t index_bits) {
+  const uint32_t top = 1u << (index_bits - 1);
+  const uint32_t max_index = (1u << index_bits) - 1;
+  const uint32_t subset_count = result.mode == 1 ? 2 : 1;
+  for (uint32_t s = 0; s < subset_count; ++s) {
+    const uint32_t anchor = s == 0 ? 0 : kBC7Anchors2[result.partition];
+    if (result.indices[anchor] < top) {
+      continue;
+    }
+    std::swap(result.endpoints[s][0], result.endpoints[s][1]);
+    std::swap(result.pbits[s][0], result.pbits[s][1]);
+    const uint32_t mask =
+        result.mode == 1
+            ? (s == 0 ? ~kBC7Partitions2[result.partition] & kAllPixels
+                      : kBC7Partitions2[result.partition])
+            : kAllPixels;
+    for (uint32_t i = 0; i < kBlockPixels; ++i) {
+      if (mask & (1u << i)) {
+        result.indices[i] = static_cast<uint8_t>(max_index - result.indices[i]);
+      }
+    }
+  }
+}
+
+void PackBC7(BC7Result result, uint8_t *output) {
+  memset(output, 0, 16);
+  BitWriter writer(output);
+
+  if (result.mode == 6) {
+    FixAnchors(result, 4);
+    writer.Put(1u << 6, 7);
+    for (uint32_t c = 0; c < 4; ++c) {
+      writer.Put(result.endpoints[0][0][c], 7);
+      writer.Put(result.endpoints[0][1][c], 7);
+    }
+    writer.Put(result.pbits[0][0], 1);
+    writer.Put(result.pbits[0][1], 1);
+    for (uint32_t i = 0; i < kBlockPixels; ++i) {
+      writer.Put(result.indices[i], i == 0 ? 3 : 4);
+    }
+    return;
+  }
+
+  FixAnchors(result, 3);
+  const uint32_t anchor = kBC7Anchors2[result.partition];
+  writer.Put(1u << 1, 2);
+  writer.Put(result.partition, 6);
+  for (uint32_t c = 0; c < 3; ++c) {
+    for (uint32_t s = 0; s < 2; ++s) {
+      writer.Put(result.endpoints[s][0][c], 6);
+      writer.Put(result.endpoints[s][1][c], 6);
+    }
+  }
+  writer.Put(result.pbits[0][0], 1);
+  writer.Put(result.pbits[1][0], 1);
+  for (uint32_t i = 0; i < kBlockPixels; ++i) {
+    writer.Put(result.indices[i], (i == 0 || i == anchor) ? 2 : 3);
+  }
+}
+
+void EncodeBC7Block(const Block &block, const QualitySettings &settings,
+                    uint8_t *output) {
+  BC7Result best = {};
+  EncodeBC7Mode6(block, settings, best);
+
+  if (settings.try_bc7_partitions && best.error > 0.0f) {
+    bool opaque = true;
+    for (uint32_t i = 0; i < kBlockPixels && opaque; ++i) {
+      opaque = block.channel[3][i] == 255.0f;
+    }
+    if (opaque) {
+      EncodeBC7Mode1(block, settings, best);
+    }
+  }
+
+  PackBC7(best, output);
+}
+
+void EncodeBlock(const Block &block, BlockFormat format,
+                 const QualitySettings &settings, uint8_t *output) {
+  switch (format) {
+  case BlockFormat::kBC1:
+    EncodeColorBlock(block, settings, output);
+    break;
+  case BlockFormat::kBC3:
+    EncodeChannelBlock(block, 3, settings, output);
+    EncodeColorBlock(block, settings, output + 8);
+    break;
+  case BlockFormat::kBC4:
+    EncodeChannelBlock(block, 0, settings, output);
+    break;
+  case BlockFormat::kBC5:
+    EncodeChannelBlock(block, 0, settings, output);
+    EncodeChannelBlock(block, 1, settings, output + 8);
+    break;
+  case BlockFormat::kBC7:
+    EncodeBC7Block(block, settings, output);
+    break;
+  }
+}
+
+} // namespace
+
+auto GetBlockSize(BlockFormat format) -> size_t {
+  return format == BlockFormat::kBC1 || format == BlockFormat::kBC4 ? 8 : 16;
+}
+
+auto GetCompressedSize(uint32_t width, uint32_t height, BlockFormat format)
+    -> size_t {
+  const size_t blocks_x = (static_cast<size_t>(width) + 3) / 4;
+  const size_t blocks_y = (static_cast<size_t>(height) + 3) / 4;
+  return blocks_x * blocks_y * GetBlockSize(format);
+}
+
+auto SelectBlockFormat(TextureUsage usage, const uint8_t *pixels,
+                       uint32_t width, uint32_t height) -> BlockFormat {
+  switch (usage) {
+  case TextureUsage::kColor:
+    return BlockFormat::kBC7;
+  case TextureUsage::kNormalMap:
+    return BlockFormat::kBC5;
+  case TextureUsage::kLinear:
+    break;
+  }
+
+  bool is_grey = true;
+  bool is_opaque = true;
+  const size_t texel_count = static_cast<size_t>(width) * height;
+  for (size_t i = 0; i < texel_count && (is_grey || is_opaque); ++i) {
+    const uint8_t *texel = pixels + i * 4;
+    is_grey = is_grey && texel[0] == texel[1] && texel[0] == texel[2];
+    is_opaque = is_opaque && texel[3] == 255;
+  }
+  if (!is_opaque) {
+    return BlockFormat::kBC3;
+  }
+  return is_grey ? BlockFormat::kBC4 : BlockFormat::kBC1;
+}
+
+auto CompressImage(JobSystem &job_system, const uint8_t *pixels,
+                   uint32_t width, uint32_t height, BlockFormat format,
+                   CompressionQuality quality, uint8_t *blocks,
+                   bool allow_parallel) -> bool {
+  if (!pixels || !blocks || width == 0 || height == 0) {
+    return false;
+  }
+
+  const QualitySettings settings = GetQualitySettings(quality);
+  const uint32_t blocks_x = (width + 3) / 4;
+  const uint32_t blocks_y = (height + 3) / 4;
+  const size_t block_size = GetBlockSize(format);
+
+  auto compress_rows = [&](size_t begin, size_t end) {
+    Block block = {};
+    for (size_t y = begin; y < end; ++y) {
+      for (uint32_t x = 0; x < blocks_x; ++x) {
+        LoadBlock(pixels, width, height, x, static_cast<uint32_t>(y), block);
+        EncodeBlock(block, format, settings,
+                    blocks + (y * blocks_x + x) * block_size);
+      }
+    }
+  };
+
+  if (!allow_parallel ||
+      static_cast<size_t>(blocks_x) * blocks_y < kParallelBlockThreshold) {
+    compress_rows(0, blocks_y);
+  } else {
+    job_system.ParallelFor(blocks_y, 0, compress_rows);
+  }
+  return true;
+}
+
+} // namespace ResourceLoader
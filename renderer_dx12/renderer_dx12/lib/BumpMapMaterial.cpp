@@ -36,12 +36,14 @@ auto BumpMapMaterial::Initialize() -> bool {
   return true;
 }
 
-auto BumpMapMaterial::GetMatrixConstantBuffer() const -> ResourceSharedPtr {
-  return matrix_constant_buffer_.GetResource();
+auto BumpMapMaterial::GetMatrixConstantBufferAddress() const
+    -> D3D12_GPU_VIRTUAL_ADDRESS {
+  return matrix_constant_buffer_.GetGPUVirtualAddress();
 }
 
-auto BumpMapMaterial::GetLightConstantBuffer() const -> ResourceSharedPtr {
-  return light_constant_buffer_.GetResource();
+auto BumpMapMaterial::GetLightConstantBufferAddress() const
+    -> D3D12_GPU_VIRTUAL_ADDRESS {
+  return light_constant_buffer_.GetGPUVirtualAddress();
 }
 
 auto BumpMapMaterial::UpdateMatrixConstant(const XMMATRIX &world,
@@ -128,10 +130,7 @@ auto BumpMapMaterial::InitializeGraphicsPipelineState() -> bool {
       {"NORMAL", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0,
        D3D12_APPEND_ALIGNED_ELEMENT, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA,
        0},
-      {"TANGENT", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0,
-       D3D12_APPEND_ALIGNED_ELEMENT, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA,
-       0},
-      {"BINORMAL", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0,
+      {"TANGENT", 0, DXGI_FORMAT_R32G32B32A32_FLOAT, 0,
        D3D12_APPEND_ALIGNED_ELEMENT, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA,
        0}};
 
@@ -70,8 +70,13 @@ auto BumpMappingScene::Render(const XMMATRIX &view, const XMMATRIX &projection,
     return false;
   }
 
-  XMMATRIX world = XMMatrixRotationY(rotation_radians_) *
-                   XMMatrixTranslation(position_.x, position_.y, position_.z);
+  XMMATRIX world = GetWorldMatrix();
+
+  // Nothing to record while the model is out of view.
+  if (!IsVisible(Camera::BuildFrustumPlanes(view, projection),
+                 model_->GetWorldBounds(world))) {
+    return true;
+  }
 
   XMMATRIX world_t = XMMatrixTranspose(world);
   XMMATRIX view_t = XMMatrixTranspose(view);
@@ -98,13 +103,13 @@ auto BumpMappingScene::Render(const XMMATRIX &view, const XMMATRIX &projection,
     return false;
   }
 
-  auto descriptor_heap = model_->GetShaderResourceView();
-  if (!descriptor_heap) {
+  auto texture_table = model_->GetShaderResourceView();
+  if (!texture_table.ptr) {
     return false;
   }
 
-  auto matrix_cb = material->GetMatrixConstantBuffer();
-  auto light_cb = material->GetLightConstantBuffer();
+  auto matrix_cb = material->GetMatrixConstantBufferAddress();
+  auto light_cb = material->GetLightConstantBufferAddress();
   if (!matrix_cb || !light_cb) {
     return false;
   }
@@ -112,15 +117,9 @@ auto BumpMappingScene::Render(const XMMATRIX &view, const XMMATRIX &projection,
   device_->SetGraphicsRootSignature(root_signature);
   device_->SetPipelineStateObject(pso);
 
-  ID3D12DescriptorHeap *heaps[] = {descriptor_heap.Get()};
-  device_->SetDescriptorHeaps(1, heaps);
-
-  device_->SetGraphicsRootDescriptorTable(
-      0, descriptor_heap->GetGPUDescriptorHandleForHeapStart());
-  device_->SetGraphicsRootConstantBufferView(
-      1, matrix_cb->GetGPUVirtualAddress());
-  device_->SetGraphicsRootConstantBufferView(
-      2, light_cb->GetGPUVirtualAddress());
+  device_->SetGraphicsRootDescriptorTable(0, texture_table);
+  device_->SetGraphicsRootConstantBufferView(1, matrix_cb);
+  device_->SetGraphicsRootConstantBufferView(2, light_cb);
 
   device_->BindVertexBuffer(0, 1, &model_->GetVertexBufferView());
   device_->BindIndexBuffer(&model_->GetIndexBufferView());
@@ -133,6 +132,18 @@ void BumpMappingScene::SetRotationAngle(float radians) {
   rotation_radians_ = radians;
 }
 
+auto BumpMappingScene::GetWorldBounds() const -> BoundingVolume {
+  if (!model_) {
+    return {};
+  }
+  return model_->GetWorldBounds(GetWorldMatrix());
+}
+
+auto BumpMappingScene::GetWorldMatrix() const -> XMMATRIX {
+  return XMMatrixRotationY(rotation_radians_) *
+         XMMatrixTranslation(position_.x, position_.y, position_.z);
+}
+
 auto BumpMappingScene::EnsureShadersLoaded() -> bool {
   if (shaders_loaded_) {
     return true;
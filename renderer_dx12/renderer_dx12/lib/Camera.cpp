@@ -110,4 +110,49 @@ void Camera::UpdateReflection(float height) {
                                  cosf(yaw) + position_z_, 1.0f);
 
   reflection_view_matrix_ = XMMatrixLookAtLH(position, look_at, up);
-}
\ No newline at end of file
+}
+auto Camera::BuildFrustumPlanes(const DirectX::XMMATRIX &view,
+                                const DirectX::XMMATRIX &projection)
+    -> FrustumPlanes {
+  using namespace DirectX;
+
+  XMFLOAT4X4 view_projection;
+  XMStoreFloat4x4(&view_projection, XMMatrixMultiply(view, projection));
+
+  FrustumPlanes planes;
+  ExtractFrustumPlanes(&view_projection._11, planes);
+  return planes;
+}
+
+auto Camera::ScreenPointToRay(int x, int y, int screen_width,
+                              int screen_height,
+                              const DirectX::XMMATRIX &projection) const
+    -> Ray {
+  using namespace DirectX;
+
+  const float pixel_x = static_cast<float>(x) + 0.5f;
+  const float pixel_y = static_cast<float>(y) + 0.5f;
+  const float width = static_cast<float>(screen_width);
+  const float height = static_cast<float>(screen_height);
+
+  const XMVECTOR near_point = XMVector3Unproject(
+      XMVectorSet(pixel_x, pixel_y, 0.0f, 0.0f), 0.0f, 0.0f, width, height,
+      0.0f, 1.0f, projection, view_matrix_, XMMatrixIdentity());
+  const XMVECTOR far_point = XMVector3Unproject(
+      XMVectorSet(pixel_x, pixel_y, 1.0f, 0.0f), 0.0f, 0.0f, width, height,
+      0.0f, 1.0f, projection, view_matrix_, XMMatrixIdentity());
+
+  XMFLOAT3 origin;
+  XMFLOAT3 direction;
+  XMStoreFloat3(&origin, near_point);
+  XMStoreFloat3(&direction, XMVectorSubtract(far_point, near_point));
+
+  Ray ray;
+  ray.origin[0] = origin.x;
+  ray.origin[1] = origin.y;
+  ray.origin[2] = origin.z;
+  ray.direction[0] = direction.x;
+  ray.direction[1] = direction.y;
+  ray.direction[2] = direction.z;
+  return ray;
+}
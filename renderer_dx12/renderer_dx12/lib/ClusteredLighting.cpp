@@ -0,0 +1,631 @@
+#include "stdafx.h"
+
+#include "ClusteredLighting.h"
+
+#include <algorithm>
+#include <cmath>
+
+// Like the frustum culling kernels, the AVX tests are compiled on every x64
+// build and chosen at run time through IsAvxCullingSupported.
+#if defined(_M_X64) || defined(_M_AMD64) || defined(__x86_64__)
+#define CLUSTERED_LIGHTING_USE_AVX 1
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#define CLUSTERED_LIGHTING_AVX_TARGET
+#else
+#define CLUSTERED_LIGHTING_AVX_TARGET __attribute__((target("avx")))
+#endif
+#else
+#define CLUSTERED_LIGHTING_USE_AVX 0
+#endif
+
+namespace Lighting {
+
+namespace {
+
+constexpr size_t kLaneCount = CullingBounds::kCullingLaneCount;
+
+// Radius of padding lanes; no plane or depth test passes it.
+constexpr float kPaddingRadius = -1.0e30f;
+
+auto RoundUpToLanes(size_t count) -> size_t {
+  return (count + kLaneCount - 1) / kLaneCount * kLaneCount;
+}
+
+// Read-only view of a light stream, which the kernels below cannot name.
+struct StreamView {
+  const float *x = nullptr;
+  const float *y = nullptr;
+  const float *z = nullptr;
+  const float *radius = nullptr;
+  const float *direction_x = nullptr;
+  const float *direction_y = nullptr;
+  const float *direction_z = nullptr;
+  const float *cos_outer = nullptr;
+  const float *sin_outer = nullptr;
+  size_t group_count = 0;
+};
+
+struct PlanePair {
+  float first[4] = {};
+  float second[4] = {};
+};
+
+struct ClusterSphere {
+  float center[3] = {};
+  float radius = 0.0f;
+};
+
+auto IsInsidePlane(const float plane[4], float x, float y, float z,
+                   float radius) -> bool {
+  const float distance =
+      ((plane[0] * x + plane[1] * y) + plane[2] * z) + plane[3];
+  return distance >= -radius;
+}
+
+// Whether a light's sphere, and its cone for a spot, reaches the cluster's
+// bounding sphere. The cone test is the closest distance from the sphere
+// center to the cone's side, plus its front and back.
+auto ReachesSphere(const StreamView &lights, size_t i,
+                   const ClusterSphere &sphere) -> bool {
+  const float vx = sphere.center[0] - lights.x[i];
+  const float vy = sphere.center[1] - lights.y[i];
+  const float vz = sphere.center[2] - lights.z[i];
+  const float distance_squared = (vx * vx + vy * vy) + vz * vz;
+  const float reach = lights.radius[i] + sphere.radius;
+  if (!(distance_squared <= reach * reach)) {
+    return false;
+  }
+
+  const float along = (vx * lights.direction_x[i] +
+                       vy * lights.direction_y[i]) +
+                      vz * lights.direction_z[i];
+  const float across =
+      std::sqrt(std::max(distance_squared - along * along, 0.0f));
+  const float side_distance =
+      lights.cos_outer[i] * across - along * lights.sin_outer[i];
+  return side_distance <= sphere.radius &&
+         along <= sphere.radius + lights.radius[i] && along >= -sphere.radius;
+}
+
+void TestDepthScalar(const StreamView &lights, float near_z, float far_z,
+                     uint8_t *masks) {
+  for (size_t group = 0; group < lights.group_count; ++group) {
+    uint32_t mask = 0;
+    for (size_t lane = 0; lane < kLaneCount; ++lane) {
+      const size_t i = group * kLaneCount + lane;
+      if (lights.z[i] + lights.radius[i] >= near_z &&
+          lights.z[i] - lights.radius[i] <= far_z) {
+        mask |= 1u << lane;
+      }
+    }
+    masks[group] = static_cast<uint8_t>(mask);
+  }
+}
+
+void TestPlanesScalar(const StreamView &lights, const PlanePair &planes,
+                      uint8_t *masks) {
+  for (size_t group = 0; group < lights.group_count; ++group) {
+    uint32_t mask = 0;
+    for (size_t lane = 0; lane < kLaneCount; ++lane) {
+      const size_t i = group * kLaneCount + lane;
+      if (IsInsidePlane(planes.first, lights.x[i], lights.y[i], lights.z[i],
+                        lights.radius[i]) &&
+          IsInsidePlane(planes.second, lights.x[i], lights.y[i], lights.z[i],
+                        lights.radius[i])) {
+        mask |= 1u << lane;
+      }
+    }
+    masks[group] = static_cast<uint8_t>(mask);
+  }
+}
+
+void TestClusterScalar(const StreamView &lights, const PlanePair &planes,
+                       const ClusterSphere &sphere, uint8_t *masks) {
+  for (size_t group = 0; group < lights.group_count; ++group) {
+    uint32_t mask = 0;
+    for (size_t lane = 0; lane < kLaneCount; ++lane) {
+      const size_t i = group * kLaneCount + lane;
+      if (IsInsidePlane(planes.first, lights.x[i], lights.y[i], lights.z[i],
+                        lights.radius[i]) &&
+          IsInsidePlane(planes.second, lights.x[i], lights.y[i], lights.z[i],
+                        lights.radius[i]) &&
+          ReachesSphere(lights, i, sphere)) {
+        mask |= 1u << lane;
+      }
+    }
+    masks[group] = static_cast<uint8_t>(mask);
+  }
+}
+
+#if CLUSTERED_LIGHTING_USE_AVX
+
+// The same arithmetic as the scalar tests, in the same order, so both paths
+// bin identically.
+CLUSTERED_LIGHTING_AVX_TARGET
+void TestDepthAvx(const StreamView &lights, float near_z, float far_z,
+                  uint8_t *masks) {
+  const __m256 near_depth = _mm256_set1_ps(near_z);
+  const __m256 far_depth = _mm256_set1_ps(far_z);
+  for (size_t group = 0; group < lights.group_count; ++group) {
+    const size_t i = group * kLaneCount;
+    const __m256 z = _mm256_loadu_ps(lights.z + i);
+    const __m256 r = _mm256_loadu_ps(lights.radius + i);
+    const __m256 inside = _mm256_and_ps(
+        _mm256_cmp_ps(_mm256_add_ps(z, r), near_depth, _CMP_GE_OQ),
+        _mm256_cmp_ps(_mm256_sub_ps(z, r), far_depth, _CMP_LE_OQ));
+    masks[group] = static_cast<uint8_t>(_mm256_movemask_ps(inside));
+  }
+}
+
+CLUSTERED_LIGHTING_AVX_TARGET
+auto InsidePlaneAvx(const float plane[4], __m256 x, __m256 y, __m256 z,
+                    __m256 negative_radius) -> __m256 {
+  const __m256 distance = _mm256_add_ps(
+      _mm256_add_ps(
+          _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(plane[0]), x),
+                        _mm256_mul_ps(_mm256_set1_ps(plane[1]), y)),
+          _mm256_mul_ps(_mm256_set1_ps(plane[2]), z)),
+      _mm256_set1_ps(plane[3]));
+  return _mm256_cmp_ps(distance, negative_radius, _CMP_GE_OQ);
+}
+
+CLUSTERED_LIGHTING_AVX_TARGET
+void TestPlanesAvx(const StreamView &lights, const PlanePair &planes,
+                   uint8_t *masks) {
+  const __m256 zero = _mm256_setzero_ps();
+  for (size_t group = 0; group < lights.group_count; ++group) {
+    const size_t i = group * kLaneCount;
+    const __m256 x = _mm256_loadu_ps(lights.x + i);
+    const __m256 y = _mm256_loadu_ps(lights.y + i);
+    const __m256 z = _mm256_loadu_ps(lights.z + i);
+    const __m256 negative_radius =
+        _mm256_sub_ps(zero, _mm256_loadu_ps(lights.radius + i));
+    const __m256 inside =
+        _mm256_and_ps(InsidePlaneAvx(planes.first, x, y, z, negative_radius),
+                      InsidePlaneAvx(planes.second, x, y, z, negative_radius));
+    masks[group] = static_cast<uint8_t>(_mm256_movemask_ps(inside));
+  }
+}
+
+CLUSTERED_LIGHTING_AVX_TARGET
+void TestClusterAvx(const StreamView &lights, const PlanePair &planes,
+                    const ClusterSphere &sphere, uint8_t *masks) {
+  const __m256 zero = _mm256_setzero_ps();
+  const __m256 sphere_x = _mm256_set1_ps(sphere.center[0]);
+  const __m256 sphere_y = _mm256_set1_ps(sphere.center[1]);
+  const __m256 sphere_z = _mm256_set1_ps(sphere.center[2]);
+  const __m256 sphere_radius = _mm256_set1_ps(sphere.radius);
+  const __m256 negative_sphere_radius = _mm256_set1_ps(-sphere.radius);
+
+  for (size_t group = 0; group < lights.group_count; ++group) {
+    const size_t i = group * kLaneCount;
+    const __m256 x = _mm256_loadu_ps(lights.x + i);
+    const __m256 y = _mm256_loadu_ps(lights.y + i);
+    const __m256 z = _mm256_loadu_ps(lights.z + i);
+    const __m256 r = _mm256_loadu_ps(lights.radius + i);
+    const __m256 negative_radius = _mm256_sub_ps(zero, r);
+
+    __m256 inside =
+        _mm256_and_ps(InsidePlaneAvx(planes.first, x, y, z, negative_radius),
+                      InsidePlaneAvx(planes.second, x, y, z, negative_radius));
+    if (_mm256_movemask_ps(inside) == 0) {
+      masks[group] = 0;
+      continue;
+    }
+
+    const __m256 vx = _mm256_sub_ps(sphere_x, x);
+    const __m256 vy = _mm256_sub_ps(sphere_y, y);
+    const __m256 vz = _mm256_sub_ps(sphere_z, z);
+    const __m256 distance_squared = _mm256_add_ps(
+        _mm256_add_ps(_mm256_mul_ps(vx, vx), _mm256_mul_ps(vy, vy)),
+        _mm256_mul_ps(vz, vz));
+    const __m256 reach = _mm256_add_ps(r, sphere_radius);
+    inside = _mm256_and_ps(inside,
+                           _mm256_cmp_ps(distance_squared,
+                                         _mm256_mul_ps(reach, reach),
+                                         _CMP_LE_OQ));
+
+    const __m256 along = _mm256_add_ps(
+        _mm256_add_ps(
+            _mm256_mul_ps(vx, _mm256_loadu_ps(lights.direction_x + i)),
+            _mm256_mul_ps(vy, _mm256_loadu_ps(lights.direction_y + i))),
+        _mm256_mul_ps(vz, _mm256_loadu_ps(lights.direction_z + i)));
+    const __m256 across = _mm256_sqrt_ps(_mm256_max_ps(
+        _mm256_sub_ps(distance_squared, _mm256_mul_ps(along, along)), zero));
+    const __m256 side_distance = _mm256_sub_ps(
+        _mm256_mul_ps(_mm256_loadu_ps(lights.cos_outer + i), across),
+        _mm256_mul_ps(along, _mm256_loadu_ps(lights.sin_outer + i)));
+    inside = _mm256_and_ps(
+        inside, _mm256_cmp_ps(side_distance, sphere_radius, _CMP_LE_OQ));
+    inside = _mm256_and_ps(
+        inside, _mm256_cmp_ps(along, _mm256_add_ps(sphere_radius, r),
+                              _CMP_LE_OQ));
+    inside = _mm256_and_ps(
+        inside, _mm256_cmp_ps(along, negative_sphere_radius, _CMP_GE_OQ));
+
+    masks[group] = static_cast<uint8_t>(_mm256_movemask_ps(inside));
+  }
+}
+
+#endif
+
+// clip[axis] >= ndc * clip.w, for a row-major projection of row vectors.
+// sign -1 flips it to clip[axis] <= ndc * clip.w.
+template <typename PlaneType>
+void ClipPlane(const float projection[16], int axis, float ndc, float sign,
+               PlaneType &plane) {
+  float value[4];
+  for (int row = 0; row < 4; ++row) {
+    value[row] = projection[row * 4 + axis] - ndc * projection[row * 4 + 3];
+  }
+  float length = std::sqrt(value[0] * value[0] + value[1] * value[1] +
+                           value[2] * value[2]);
+  length = length > 0.0f ? sign / length : sign;
+  plane.a = value[0] * length;
+  plane.b = value[1] * length;
+  plane.c = value[2] * length;
+  plane.d = value[3] * length;
+}
+
+// The view-space point at depth z that projects to (ndc_x, ndc_y).
+void UnprojectAtDepth(const float projection[16], float ndc_x, float ndc_y,
+                      float z, float point[3]) {
+  auto row = [projection](int index, int axis, float ndc) {
+    return projection[index * 4 + axis] - ndc * projection[index * 4 + 3];
+  };
+  const float a = row(0, 0, ndc_x);
+  const float b = row(1, 0, ndc_x);
+  const float e = -(row(2, 0, ndc_x) * z + row(3, 0, ndc_x));
+  const float c = row(0, 1, ndc_y);
+  const float d = row(1, 1, ndc_y);
+  const float f = -(row(2, 1, ndc_y) * z + row(3, 1, ndc_y));
+  const float determinant = a * d - b * c;
+  point[0] = determinant != 0.0f ? (e * d - b * f) / determinant : 0.0f;
+  point[1] = determinant != 0.0f ? (a * f - e * c) / determinant : 0.0f;
+  point[2] = z;
+}
+
+} // namespace
+
+void ClusteredLightGrid::LightStream::Resize(size_t capacity) {
+  const size_t size = RoundUpToLanes(capacity);
+  for (auto *stream : {&x, &y, &z, &radius, &direction_x, &direction_y,
+                       &direction_z, &cos_outer, &sin_outer}) {
+    stream->resize(size);
+  }
+  light.resize(size);
+  count = 0;
+}
+
+void ClusteredLightGrid::LightStream::CopyLane(const LightStream &source,
+                                               size_t from) {
+  const size_t to = count++;
+  x[to] = source.x[from];
+  y[to] = source.y[from];
+  z[to] = source.z[from];
+  radius[to] = source.radius[from];
+  direction_x[to] = source.direction_x[from];
+  direction_y[to] = source.direction_y[from];
+  direction_z[to] = source.direction_z[from];
+  cos_outer[to] = source.cos_outer[from];
+  sin_outer[to] = source.sin_outer[from];
+  light[to] = source.light[from];
+}
+
+void ClusteredLightGrid::LightStream::Pad() {
+  for (size_t i = count; i < RoundUpToLanes(count); ++i) {
+    x[i] = 0.0f;
+    y[i] = 0.0f;
+    z[i] = 0.0f;
+    radius[i] = kPaddingRadius;
+    direction_x[i] = 0.0f;
+    direction_y[i] = 0.0f;
+    direction_z[i] = 0.0f;
+    cos_outer[i] = -1.0f;
+    sin_outer[i] = 0.0f;
+    light[i] = 0;
+  }
+}
+
+ClusteredLightGrid::ClusteredLightGrid(const ClusterGridConfig &config) {
+  SetConfig(config);
+}
+
+void ClusteredLightGrid::SetConfig(const ClusterGridConfig &config) {
+  config_ = config;
+  config_.tiles_x = std::max(config_.tiles_x, 1u);
+  config_.tiles_y = std::max(config_.tiles_y, 1u);
+  config_.slices = std::max(config_.slices, 1u);
+  config_.near_z = std::max(config_.near_z, 1.0e-4f);
+  config_.far_z = std::max(config_.far_z, config_.near_z * 2.0f);
+  geometry_valid_ = false;
+}
+
+void ClusteredLightGrid::ClearLights() { lights_.clear(); }
+
+auto ClusteredLightGrid::AddLight(const ClusterLightData &light) -> uint32_t {
+  lights_.push_back(light);
+  return static_cast<uint32_t>(lights_.size() - 1);
+}
+
+void ClusteredLightGrid::Build(const float view[16], const float projection[16],
+                               uint32_t screen_width, uint32_t screen_height,
+                               CullingPath path) {
+  UpdateGeometry(projection);
+  TransformLights(view);
+
+  bool use_avx = false;
+#if CLUSTERED_LIGHTING_USE_AVX
+  // There is no SSE version of the cluster tests.
+  use_avx = (path == CullingPath::kAuto || path == CullingPath::kAvx) &&
+            IsAvxCullingSupported();
+#endif
+
+  auto plane_pair = [](const Plane &first, const Plane &second) {
+    PlanePair result;
+    for (int i = 0; i < 2; ++i) {
+      const Plane &plane = i == 0 ? first : second;
+      float *target = i == 0 ? result.first : result.second;
+      target[0] = plane.a;
+      target[1] = plane.b;
+      target[2] = plane.c;
+      target[3] = plane.d;
+    }
+    return result;
+  };
+
+  auto view_of = [](const LightStream &stream) {
+    StreamView result;
+    result.x = stream.x.data();
+    result.y = stream.y.data();
+    result.z = stream.z.data();
+    result.radius = stream.radius.data();
+    result.direction_x = stream.direction_x.data();
+    result.direction_y = stream.direction_y.data();
+    result.direction_z = stream.direction_z.data();
+    result.cos_outer = stream.cos_outer.data();
+    result.sin_outer = stream.sin_outer.data();
+    result.group_count = RoundUpToLanes(stream.count) / kLaneCount;
+    return result;
+  };
+
+  // Copies the lanes that passed into target.
+  auto compact = [this](const LightStream &source, LightStream &target) {
+    target.Resize(source.count);
+    const size_t group_count = RoundUpToLanes(source.count) / kLaneCount;
+    for (size_t group = 0; group < group_count; ++group) {
+      for (uint32_t bits = group_masks_[group]; bits != 0; bits &= bits - 1) {
+        size_t lane = 0;
+        while ((bits & (1u << lane)) == 0) {
+          ++lane;
+        }
+        target.CopyLane(source, group * kLaneCount + lane);
+      }
+    }
+    target.Pad();
+  };
+
+  const size_t cluster_count = static_cast<size_t>(config_.tiles_x) *
+                               config_.tiles_y * config_.slices;
+  cluster_ranges_.assign(cluster_count, ClusterRange{});
+  light_indices_.clear();
+  overflow_count_ = 0;
+  group_masks_.resize(RoundUpToLanes(view_lights_.count) / kLaneCount);
+
+  for (uint32_t slice = 0; slice < config_.slices; ++slice) {
+    const StreamView all_lights = view_of(view_lights_);
+#if CLUSTERED_LIGHTING_USE_AVX
+    if (use_avx) {
+      TestDepthAvx(all_lights, slice_depths_[slice], slice_depths_[slice + 1],
+                   group_masks_.data());
+    } else
+#endif
+    {
+      TestDepthScalar(all_lights, slice_depths_[slice],
+                      slice_depths_[slice + 1], group_masks_.data());
+    }
+    compact(view_lights_, slice_lights_);
+    if (slice_lights_.count == 0) {
+      continue;
+    }
+
+    for (uint32_t tile_y = 0; tile_y < config_.tiles_y; ++tile_y) {
+      const PlanePair row =
+          plane_pair(row_planes_[tile_y * 2], row_planes_[tile_y * 2 + 1]);
+
+      const StreamView slice_view = view_of(slice_lights_);
+#if CLUSTERED_LIGHTING_USE_AVX
+      if (use_avx) {
+        TestPlanesAvx(slice_view, row, group_masks_.data());
+      } else
+#endif
+      {
+        TestPlanesScalar(slice_view, row, group_masks_.data());
+      }
+      compact(slice_lights_, row_lights_);
+      if (row_lights_.count == 0) {
+        continue;
+      }
+
+      const StreamView row_view = view_of(row_lights_);
+      for (uint32_t tile_x = 0; tile_x < config_.tiles_x; ++tile_x) {
+        const uint32_t cluster = GetClusterIndex(tile_x, tile_y, slice);
+        const PlanePair column = plane_pair(column_planes_[tile_x * 2],
+                                            column_planes_[tile_x * 2 + 1]);
+        ClusterSphere sphere;
+        sphere.center[0] = cluster_spheres_[cluster].x;
+        sphere.center[1] = cluster_spheres_[cluster].y;
+        sphere.center[2] = cluster_spheres_[cluster].z;
+        sphere.radius = cluster_spheres_[cluster].radius;
+
+#if CLUSTERED_LIGHTING_USE_AVX
+        if (use_avx) {
+          TestClusterAvx(row_view, column, sphere, group_masks_.data());
+        } else
+#endif
+        {
+          TestClusterScalar(row_view, column, sphere, group_masks_.data());
+        }
+
+        ClusterRange &range = cluster_ranges_[cluster];
+        range.offset = static_cast<uint32_t>(light_indices_.size());
+        for (size_t group = 0; group < row_view.group_count; ++group) {
+          for (uint32_t bits = group_masks_[group]; bits != 0;
+               bits &= bits - 1) {
+            size_t lane = 0;
+            while ((bits & (1u << lane)) == 0) {
+              ++lane;
+            }
+            if (range.count >= config_.max_lights_per_cluster) {
+              ++overflow_count_;
+              continue;
+            }
+            light_indices_.push_back(
+                row_lights_.light[group * kLaneCount + lane]);
+            ++range.count;
+          }
+        }
+      }
+    }
+  }
+
+  const float depth_ratio = std::log(config_.far_z / config_.near_z);
+  constants_.tiles_x = config_.tiles_x;
+  constants_.tiles_y = config_.tiles_y;
+  constants_.slices = config_.slices;
+  constants_.light_count = static_cast<uint32_t>(lights_.size());
+  constants_.tile_scale_x =
+      screen_width > 0 ? static_cast<float>(config_.tiles_x) / screen_width
+                       : 0.0f;
+  constants_.tile_scale_y =
+      screen_height > 0 ? static_cast<float>(config_.tiles_y) / screen_height
+                        : 0.0f;
+  constants_.depth_scale = config_.slices / depth_ratio;
+  constants_.depth_bias =
+      -(config_.slices * std::log(config_.near_z)) / depth_ratio;
+}
+
+void ClusteredLightGrid::UpdateGeometry(const float projection[16]) {
+  if (geometry_valid_ &&
+      std::equal(projection, projection + 16, geometry_projection_)) {
+    return;
+  }
+  std::copy(projection, projection + 16, geometry_projection_);
+  geometry_valid_ = true;
+
+  const uint32_t tiles_x = config_.tiles_x;
+  const uint32_t tiles_y = config_.tiles_y;
+  const uint32_t slices = config_.slices;
+
+  slice_depths_.resize(slices + 1);
+  for (uint32_t slice = 0; slice <= slices; ++slice) {
+    slice_depths_[slice] =
+        config_.near_z *
+        std::pow(config_.far_z / config_.near_z,
+                 static_cast<float>(slice) / static_cast<float>(slices));
+  }
+
+  auto ndc_x = [tiles_x](uint32_t edge) {
+    return -1.0f + 2.0f * static_cast<float>(edge) / tiles_x;
+  };
+  // Rows count down from the top of the screen.
+  auto ndc_y = [tiles_y](uint32_t edge) {
+    return 1.0f - 2.0f * static_cast<float>(edge) / tiles_y;
+  };
+
+  column_planes_.resize(tiles_x * 2);
+  for (uint32_t tile_x = 0; tile_x < tiles_x; ++tile_x) {
+    ClipPlane(projection, 0, ndc_x(tile_x), 1.0f, column_planes_[tile_x * 2]);
+    ClipPlane(projection, 0, ndc_x(tile_x + 1), -1.0f,
+              column_planes_[tile_x * 2 + 1]);
+  }
+
+  row_planes_.resize(tiles_y * 2);
+  for (uint32_t tile_y = 0; tile_y < tiles_y; ++tile_y) {
+    ClipPlane(projection, 1, ndc_y(tile_y), -1.0f, row_planes_[tile_y * 2]);
+    ClipPlane(projection, 1, ndc_y(tile_y + 1), 1.0f,
+              row_planes_[tile_y * 2 + 1]);
+  }
+
+  cluster_spheres_.resize(static_cast<size_t>(tiles_x) * tiles_y * slices);
+  for (uint32_t slice = 0; slice < slices; ++slice) {
+    for (uint32_t tile_y = 0; tile_y < tiles_y; ++tile_y) {
+      for (uint32_t tile_x = 0; tile_x < tiles_x; ++tile_x) {
+        float corners[8][3];
+        int corner = 0;
+        for (uint32_t depth = 0; depth < 2; ++depth) {
+          for (uint32_t edge_y = 0; edge_y < 2; ++edge_y) {
+            for (uint32_t edge_x = 0; edge_x < 2; ++edge_x) {
+              UnprojectAtDepth(projection, ndc_x(tile_x + edge_x),
+                               ndc_y(tile_y + edge_y),
+                               slice_depths_[slice + depth],
+                               corners[corner++]);
+            }
+          }
+        }
+
+        float minimum[3] = {corners[0][0], corners[0][1], corners[0][2]};
+        float maximum[3] = {corners[0][0], corners[0][1], corners[0][2]};
+        for (const auto &point : corners) {
+          for (int axis = 0; axis < 3; ++axis) {
+            minimum[axis] = std::min(minimum[axis], point[axis]);
+            maximum[axis] = std::max(maximum[axis], point[axis]);
+          }
+        }
+
+        Sphere &sphere =
+            cluster_spheres_[GetClusterIndex(tile_x, tile_y, slice)];
+        sphere.x = (minimum[0] + maximum[0]) * 0.5f;
+        sphere.y = (minimum[1] + maximum[1]) * 0.5f;
+        sphere.z = (minimum[2] + maximum[2]) * 0.5f;
+        float radius_squared = 0.0f;
+        for (const auto &point : corners) {
+          const float dx = point[0] - sphere.x;
+          const float dy = point[1] - sphere.y;
+          const float dz = point[2] - sphere.z;
+          radius_squared =
+              std::max(radius_squared, dx * dx + dy * dy + dz * dz);
+        }
+        sphere.radius = std::sqrt(radius_squared);
+      }
+    }
+  }
+}
+
+void ClusteredLightGrid::TransformLights(const float view[16]) {
+  view_lights_.Resize(lights_.size());
+  for (size_t index = 0; index < lights_.size(); ++index) {
+    const ClusterLightData &light = lights_[index];
+    if (!(light.range > 0.0f)) {
+      continue;
+    }
+
+    const float *p = light.position;
+    const float *d = light.direction;
+    const size_t i = view_lights_.count++;
+    view_lights_.x[i] =
+        p[0] * view[0] + p[1] * view[4] + p[2] * view[8] + view[12];
+    view_lights_.y[i] =
+        p[0] * view[1] + p[1] * view[5] + p[2] * view[9] + view[13];
+    view_lights_.z[i] =
+        p[0] * view[2] + p[1] * view[6] + p[2] * view[10] + view[14];
+    view_lights_.radius[i] = light.range;
+    view_lights_.direction_x[i] =
+        d[0] * view[0] + d[1] * view[4] + d[2] * view[8];
+    view_lights_.direction_y[i] =
+        d[0] * view[1] + d[1] * view[5] + d[2] * view[9];
+    view_lights_.direction_z[i] =
+        d[0] * view[2] + d[1] * view[6] + d[2] * view[10];
+    // Point lights have no direction and a cone of every angle, which the
+    // cone test always passes.
+    const float cos_outer =
+        std::min(std::max(light.spot_cos_outer, -1.0f), 1.0f);
+    view_lights_.cos_outer[i] = cos_outer;
+    view_lights_.sin_outer[i] = std::sqrt(1.0f - cos_outer * cos_outer);
+    view_lights_.light[i] = static_cast<uint32_t>(index);
+  }
+  view_lights_.Pad();
+}
+
+} // namespace Lighting
@@ -0,0 +1,197 @@
+#include "stdafx.h"
+
+#include "CommandStateShadow.h"
+
+namespace {
+
+auto SameVertexBuffer(const ShadowVertexBuffer &lhs,
+                      const ShadowVertexBuffer &rhs) -> bool {
+  return lhs.location == rhs.location && lhs.size == rhs.size &&
+         lhs.stride == rhs.stride;
+}
+
+auto SameIndexBuffer(const ShadowIndexBuffer &lhs,
+                     const ShadowIndexBuffer &rhs) -> bool {
+  return lhs.location == rhs.location && lhs.size == rhs.size &&
+         lhs.format == rhs.format;
+}
+
+} // namespace
+
+auto CommandRecorderStats::GetTotalIssued() const -> uint64_t {
+  uint64_t total = 0;
+  for (uint64_t count : issued) {
+    total += count;
+  }
+  return total;
+}
+
+auto CommandRecorderStats::GetTotalElided() const -> uint64_t {
+  uint64_t total = 0;
+  for (uint64_t count : elided) {
+    total += count;
+  }
+  return total;
+}
+
+void CommandRecorderStats::Add(const CommandRecorderStats &other) {
+  for (size_t i = 0; i < kShadowedCommandCount; ++i) {
+    issued[i] += other.issued[i];
+    elided[i] += other.elided[i];
+  }
+}
+
+void CommandStateShadow::Reset() {
+  const CommandRecorderStats stats = stats_;
+  *this = CommandStateShadow();
+  stats_ = stats;
+}
+
+auto CommandStateShadow::SetRootSignature(const void *root_signature)
+    -> bool {
+  if (root_signature_known_ && root_signature_ == root_signature) {
+    return Count(ShadowedCommand::kRootSignature, false);
+  }
+
+  root_signature_known_ = true;
+  root_signature_ = root_signature;
+  for (RootArgument &argument : root_arguments_) {
+    argument = RootArgument();
+  }
+  return Count(ShadowedCommand::kRootSignature, true);
+}
+
+auto CommandStateShadow::SetPipelineState(const void *pipeline_state)
+    -> bool {
+  if (pipeline_state_known_ && pipeline_state_ == pipeline_state) {
+    return Count(ShadowedCommand::kPipelineState, false);
+  }
+
+  pipeline_state_known_ = true;
+  pipeline_state_ = pipeline_state;
+  return Count(ShadowedCommand::kPipelineState, true);
+}
+
+auto CommandStateShadow::SetDescriptorHeaps(uint32_t count,
+                                            const void *const *heaps)
+    -> bool {
+  if (heaps == nullptr) {
+    count = 0;
+  }
+
+  bool same = descriptor_heaps_known_ && descriptor_heap_count_ == count;
+  for (uint32_t i = 0; same && i < count; ++i) {
+    same = descriptor_heaps_[i] == heaps[i];
+  }
+  if (same) {
+    return Count(ShadowedCommand::kDescriptorHeaps, false);
+  }
+
+  descriptor_heaps_known_ = count <= kMaxDescriptorHeaps;
+  descriptor_heap_count_ = descriptor_heaps_known_ ? count : 0;
+  for (uint32_t i = 0; i < descriptor_heap_count_; ++i) {
+    descriptor_heaps_[i] = heaps[i];
+  }
+  for (RootArgument &argument : root_arguments_) {
+    if (argument.kind == RootArgumentKind::kDescriptorTable) {
+      argument = RootArgument();
+    }
+  }
+  return Count(ShadowedCommand::kDescriptorHeaps, true);
+}
+
+auto CommandStateShadow::SetRootDescriptorTable(uint32_t index,
+                                                uint64_t base_descriptor)
+    -> bool {
+  return SetRootArgument(ShadowedCommand::kRootDescriptorTable,
+                         RootArgumentKind::kDescriptorTable, index,
+                         base_descriptor);
+}
+
+auto CommandStateShadow::SetRootConstantBufferView(uint32_t index,
+                                                   uint64_t buffer_location)
+    -> bool {
+  return SetRootArgument(ShadowedCommand::kRootConstantBufferView,
+                         RootArgumentKind::kConstantBufferView, index,
+                         buffer_location);
+}
+
+auto CommandStateShadow::SetRootShaderResourceView(uint32_t index,
+                                                   uint64_t buffer_location)
+    -> bool {
+  return SetRootArgument(ShadowedCommand::kRootShaderResourceView,
+                         RootArgumentKind::kShaderResourceView, index,
+                         buffer_location);
+}
+
+auto CommandStateShadow::SetVertexBuffers(uint32_t start_slot, uint32_t count,
+                                          const ShadowVertexBuffer *views)
+    -> bool {
+  const ShadowVertexBuffer unbound = {};
+  const bool in_range = start_slot < kMaxVertexBuffers &&
+                        count <= kMaxVertexBuffers - start_slot;
+
+  bool same = in_range;
+  for (uint32_t i = 0; same && i < count; ++i) {
+    const uint32_t slot = start_slot + i;
+    same = vertex_buffer_known_[slot] &&
+           SameVertexBuffer(vertex_buffers_[slot],
+                            views != nullptr ? views[i] : unbound);
+  }
+  if (same) {
+    return Count(ShadowedCommand::kVertexBuffers, false);
+  }
+
+  for (uint32_t i = 0; i < count && start_slot + i < kMaxVertexBuffers; ++i) {
+    const uint32_t slot = start_slot + i;
+    vertex_buffer_known_[slot] = in_range;
+    vertex_buffers_[slot] = views != nullptr ? views[i] : unbound;
+  }
+  return Count(ShadowedCommand::kVertexBuffers, true);
+}
+
+auto CommandStateShadow::SetIndexBuffer(const ShadowIndexBuffer *view)
+    -> bool {
+  const ShadowIndexBuffer bound = view != nullptr ? *view : ShadowIndexBuffer();
+  if (index_buffer_known_ && SameIndexBuffer(index_buffer_, bound)) {
+    return Count(ShadowedCommand::kIndexBuffer, false);
+  }
+
+  index_buffer_known_ = true;
+  index_buffer_ = bound;
+  return Count(ShadowedCommand::kIndexBuffer, true);
+}
+
+auto CommandStateShadow::TakeStats() -> CommandRecorderStats {
+  const CommandRecorderStats stats = stats_;
+  stats_ = CommandRecorderStats();
+  return stats;
+}
+
+auto CommandStateShadow::Count(ShadowedCommand command, bool issued) -> bool {
+  const size_t index = static_cast<size_t>(command);
+  if (issued) {
+    ++stats_.issued[index];
+  } else {
+    ++stats_.elided[index];
+  }
+  return issued;
+}
+
+auto CommandStateShadow::SetRootArgument(ShadowedCommand command,
+                                         RootArgumentKind kind,
+                                         uint32_t index, uint64_t value)
+    -> bool {
+  if (index >= kMaxRootParameters) {
+    return Count(command, true);
+  }
+
+  RootArgument &argument = root_arguments_[index];
+  if (argument.kind == kind && argument.value == value) {
+    return Count(command, false);
+  }
+
+  argument.kind = kind;
+  argument.value = value;
+  return Count(command, true);
+}
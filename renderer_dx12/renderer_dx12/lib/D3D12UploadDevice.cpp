@@ -0,0 +1,251 @@
+#include "stdafx.h"
+
+#include "D3D12UploadDevice.h"
+
+#include "d3dx12.h"
+
+#include <utility>
+
+namespace ResourceLoader {
+
+D3D12UploadDevice::D3D12UploadDevice(D3d12DevicePtr device,
+                                     CommandQueuePtr copy_queue)
+    : device_(std::move(device)), copy_queue_(std::move(copy_queue)) {}
+
+D3D12UploadDevice::~D3D12UploadDevice() {
+  if (fence_ && !submitted_.empty()) {
+    WaitForValue(submitted_.back().fence_value);
+  }
+  if (fence_event_) {
+    CloseHandle(fence_event_);
+    fence_event_ = nullptr;
+  }
+}
+
+auto D3D12UploadDevice::Initialize() -> bool {
+  if (!device_ || !copy_queue_) {
+    return false;
+  }
+
+  if (FAILED(device_->CreateFence(0, D3D12_FENCE_FLAG_NONE,
+                                  IID_PPV_ARGS(&fence_)))) {
+    return false;
+  }
+
+  fence_event_ = CreateEvent(nullptr, FALSE, FALSE, nullptr);
+  if (!fence_event_) {
+    return false;
+  }
+
+  CommandAllocatorPtr allocator = nullptr;
+  if (FAILED(device_->CreateCommandAllocator(D3D12_COMMAND_LIST_TYPE_COPY,
+                                             IID_PPV_ARGS(&allocator)))) {
+    return false;
+  }
+
+  if (FAILED(device_->CreateCommandList(0, D3D12_COMMAND_LIST_TYPE_COPY,
+                                        allocator.Get(), nullptr,
+                                        IID_PPV_ARGS(&command_list_)))) {
+    return false;
+  }
+
+  if (FAILED(command_list_->Close())) {
+    return false;
+  }
+
+  free_allocators_.push_back(allocator);
+  return true;
+}
+
+auto D3D12UploadDevice::CreateStagingBuffer(uint64_t size,
+                                            uint8_t *&mapped_data)
+    -> StagingBufferId {
+  mapped_data = nullptr;
+
+  ResourceSharedPtr buffer = nullptr;
+  if (FAILED(device_->CreateCommittedResource(
+          &CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD),
+          D3D12_HEAP_FLAG_NONE, &CD3DX12_RESOURCE_DESC::Buffer(size),
+          D3D12_RESOURCE_STATE_GENERIC_READ, nullptr,
+          IID_PPV_ARGS(&buffer)))) {
+    return 0;
+  }
+
+  // Upload heaps may stay mapped for their whole lifetime.
+  CD3DX12_RANGE read_range(0, 0);
+  if (FAILED(buffer->Map(0, &read_range,
+                         reinterpret_cast<void **>(&mapped_data)))) {
+    mapped_data = nullptr;
+    return 0;
+  }
+
+  const StagingBufferId id = next_staging_id_++;
+  staging_buffers_.emplace(id, std::move(buffer));
+  return id;
+}
+
+void D3D12UploadDevice::ReleaseStagingBuffer(StagingBufferId staging) {
+  // Only called once the fence has passed every batch that read it.
+  staging_buffers_.erase(staging);
+}
+
+auto D3D12UploadDevice::GetTextureFootprints(
+    ID3D12Resource *destination, uint32_t first_subresource,
+    uint32_t subresource_count, UploadTextureFootprint *footprints,
+    uint64_t &total_bytes) -> bool {
+  if (destination == nullptr || footprints == nullptr) {
+    return false;
+  }
+
+  const auto desc = destination->GetDesc();
+  std::vector<D3D12_PLACED_SUBRESOURCE_FOOTPRINT> layouts(subresource_count);
+  std::vector<UINT> row_counts(subresource_count);
+  std::vector<UINT64> row_sizes(subresource_count);
+  device_->GetCopyableFootprints(&desc, first_subresource, subresource_count,
+                                 0, layouts.data(), row_counts.data(),
+                                 row_sizes.data(), &total_bytes);
+  if (total_bytes == static_cast<UINT64>(-1)) {
+    return false;
+  }
+
+  for (uint32_t i = 0; i < subresource_count; ++i) {
+    auto &footprint = footprints[i];
+    footprint.offset = layouts[i].Offset;
+    footprint.format = static_cast<uint32_t>(layouts[i].Footprint.Format);
+    footprint.width = layouts[i].Footprint.Width;
+    footprint.height = layouts[i].Footprint.Height;
+    footprint.depth = layouts[i].Footprint.Depth;
+    footprint.row_pitch = layouts[i].Footprint.RowPitch;
+    footprint.row_count = row_counts[i];
+    footprint.row_bytes = row_sizes[i];
+  }
+
+  return true;
+}
+
+auto D3D12UploadDevice::BeginBatch() -> bool {
+  RecycleCompleted();
+
+  if (free_allocators_.empty()) {
+    CommandAllocatorPtr allocator = nullptr;
+    if (FAILED(device_->CreateCommandAllocator(D3D12_COMMAND_LIST_TYPE_COPY,
+                                               IID_PPV_ARGS(&allocator)))) {
+      return false;
+    }
+    free_allocators_.push_back(allocator);
+  }
+
+  open_allocator_ = free_allocators_.back();
+  free_allocators_.pop_back();
+
+  if (FAILED(open_allocator_->Reset()) ||
+      FAILED(command_list_->Reset(open_allocator_.Get(), nullptr))) {
+    free_allocators_.push_back(open_allocator_);
+    open_allocator_.Reset();
+    return false;
+  }
+
+  return true;
+}
+
+void D3D12UploadDevice::CopyBufferRegion(ID3D12Resource *destination,
+                                         uint64_t destination_offset,
+                                         StagingBufferId staging,
+                                         uint64_t staging_offset,
+                                         uint64_t size) {
+  auto found = staging_buffers_.find(staging);
+  if (found == staging_buffers_.end()) {
+    return;
+  }
+
+  command_list_->CopyBufferRegion(destination, destination_offset,
+                                  found->second.Get(), staging_offset, size);
+  open_references_.emplace_back(destination);
+}
+
+void D3D12UploadDevice::CopyTextureRegion(
+    ID3D12Resource *destination, uint32_t subresource,
+    StagingBufferId staging, const UploadTextureFootprint &footprint) {
+  auto found = staging_buffers_.find(staging);
+  if (found == staging_buffers_.end()) {
+    return;
+  }
+
+  D3D12_PLACED_SUBRESOURCE_FOOTPRINT layout = {};
+  layout.Offset = footprint.offset;
+  layout.Footprint.Format = static_cast<DXGI_FORMAT>(footprint.format);
+  layout.Footprint.Width = footprint.width;
+  layout.Footprint.Height = footprint.height;
+  layout.Footprint.Depth = footprint.depth;
+  layout.Footprint.RowPitch = footprint.row_pitch;
+
+  CD3DX12_TEXTURE_COPY_LOCATION destination_location(destination, subresource);
+  CD3DX12_TEXTURE_COPY_LOCATION source_location(found->second.Get(), layout);
+  command_list_->CopyTextureRegion(&destination_location, 0, 0, 0,
+                                   &source_location, nullptr);
+  open_references_.emplace_back(destination);
+}
+
+auto D3D12UploadDevice::SubmitBatch(UploadToken fence_value) -> bool {
+  if (!open_allocator_) {
+    return false;
+  }
+
+  SubmittedBatch batch = {};
+  batch.fence_value = fence_value;
+  batch.allocator = std::move(open_allocator_);
+  batch.references = std::move(open_references_);
+  open_references_.clear();
+
+  if (FAILED(command_list_->Close())) {
+    free_allocators_.push_back(batch.allocator);
+    return false;
+  }
+
+  ID3D12CommandList *command_lists[] = {command_list_.Get()};
+  copy_queue_->ExecuteCommandLists(1, command_lists);
+
+  if (FAILED(copy_queue_->Signal(fence_.Get(), fence_value))) {
+    // The copies are already queued; keep the batch alive until the queue is
+    // drained rather than recycling an allocator the GPU may still read.
+    submitted_.push_back(std::move(batch));
+    return false;
+  }
+
+  submitted_.push_back(std::move(batch));
+  return true;
+}
+
+auto D3D12UploadDevice::GetCompletedValue() -> UploadToken {
+  return fence_ ? fence_->GetCompletedValue() : 0;
+}
+
+auto D3D12UploadDevice::WaitForValue(UploadToken fence_value) -> bool {
+  if (!fence_ || !fence_event_) {
+    return false;
+  }
+
+  if (fence_->GetCompletedValue() < fence_value) {
+    if (FAILED(fence_->SetEventOnCompletion(fence_value, fence_event_))) {
+      return false;
+    }
+    WaitForSingleObject(fence_event_, INFINITE);
+  }
+
+  RecycleCompleted();
+  return true;
+}
+
+void D3D12UploadDevice::ReportError(const wchar_t *message) {
+  OutputDebugStringW(message);
+}
+
+void D3D12UploadDevice::RecycleCompleted() {
+  const UploadToken completed = GetCompletedValue();
+  while (!submitted_.empty() && submitted_.front().fence_value <= completed) {
+    free_allocators_.push_back(std::move(submitted_.front().allocator));
+    submitted_.pop_front();
+  }
+}
+
+} // namespace ResourceLoader
@@ -0,0 +1,809 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//--------------------------------------------------------------------------------------
+//
+// Header validation and subresource layout for DDS images, split out of
+// DDSTextureLoader.cpp so it builds without Direct3D.
+//--------------------------------------------------------------------------------------
+
+#include "stdafx.h"
+
+#include "DDSFile.h"
+
+#include <algorithm>
+#include <cstring>
+
+using namespace DirectX;
+
+namespace ResourceLoader {
+
+namespace {
+
+// D3D12 hardware limits (D3D12_REQ_*). A DDS header is untrusted input, so
+// nothing larger is laid out.
+constexpr uint32_t kMaxMipLevels = 15;
+constexpr uint32_t kMaxTexture1DSize = 16384;
+constexpr uint32_t kMaxTexture2DSize = 16384;
+constexpr uint32_t kMaxTextureCubeSize = 16384;
+constexpr uint32_t kMaxTexture3DSize = 2048;
+constexpr uint32_t kMaxTextureArraySize = 2048;
+
+auto IsDX10Header(const DDS_HEADER &header) -> bool {
+  return (header.ddspf.flags & DDS_FOURCC) &&
+         MAKEFOURCC('D', 'X', '1', '0') == header.ddspf.fourCC;
+}
+
+//--------------------------------------------------------------------------------------
+#define ISBITMASK(r, g, b, a)                                                  \
+  (ddpf.RBitMask == r && ddpf.GBitMask == g && ddpf.BBitMask == b &&           \
+   ddpf.ABitMask == a)
+
+DXGI_FORMAT GetDXGIFormat(const DirectX::DDS_PIXELFORMAT &ddpf) {
+  if (ddpf.flags & DDS_RGB) {
+    // Note that sRGB formats are written using the "DX10" extended header
+
+    switch (ddpf.RGBBitCount) {
+    case 32:
+      if (ISBITMASK(0x000000ff, 0x0000ff00, 0x00ff0000, 0xff000000)) {
+        return DXGI_FORMAT_R8G8B8A8_UNORM;
+      }
+
+      if (ISBITMASK(0x00ff0000, 0x0000ff00, 0x000000ff, 0xff000000)) {
+        return DXGI_FORMAT_B8G8R8A8_UNORM;
+      }
+
+      if (ISBITMASK(0x00ff0000, 0x0000ff00, 0x000000ff, 0x00000000)) {
+        return DXGI_FORMAT_B8G8R8X8_UNORM;
+      }
+
+      // No DXGI format maps to
+      // ISBITMASK(0x000000ff,0x0000ff00,0x00ff0000,0x00000000) aka
+      // D3DFMT_X8B8G8R8
+
+      // Note that many common DDS reader/writers (including D3DX) swap the
+      // the RED/BLUE masks for 10:10:10:2 formats. We assumme
+      // below that the 'backwards' header mask is being used since it is most
+      // likely written by D3DX. The more robust solution is to use the 'DX10'
+      // header extension and specify the DXGI_FORMAT_R10G10B10A2_UNORM format
+      // directly
+
+      // For 'correct' writers, this should be 0x000003ff,0x000ffc00,0x3ff00000
+      // for RGB data
+      if (ISBITMASK(0x3ff00000, 0x000ffc00, 0x000003ff, 0xc0000000)) {
+        return DXGI_FORMAT_R10G10B10A2_UNORM;
+      }
+
+      // No DXGI format maps to
+      // ISBITMASK(0x000003ff,0x000ffc00,0x3ff00000,0xc0000000) aka
+      // D3DFMT_A2R10G10B10
+
+      if (ISBITMASK(0x0000ffff, 0xffff0000, 0x00000000, 0x00000000)) {
+        return DXGI_FORMAT_R16G16_UNORM;
+      }
+
+      if (ISBITMASK(0xffffffff, 0x00000000, 0x00000000, 0x00000000)) {
+        // Only 32-bit color channel format in D3D9 was R32F
+        return DXGI_FORMAT_R32_FLOAT; // D3DX writes this out as a FourCC of 114
+      }
+      break;
+
+    case 24:
+      // No 24bpp DXGI formats aka D3DFMT_R8G8B8
+      break;
+
+    case 16:
+      if (ISBITMASK(0x7c00, 0x03e0, 0x001f, 0x8000)) {
+        return DXGI_FORMAT_B5G5R5A1_UNORM;
+      }
+      if (ISBITMASK(0xf800, 0x07e0, 0x001f, 0x0000)) {
+        return DXGI_FORMAT_B5G6R5_UNORM;
+      }
+
+      // No DXGI format maps to ISBITMASK(0x7c00,0x03e0,0x001f,0x0000) aka
+      // D3DFMT_X1R5G5B5
+
+      if (ISBITMASK(0x0f00, 0x00f0, 0x000f, 0xf000)) {
+        return DXGI_FORMAT_B4G4R4A4_UNORM;
+      }
+
+      // No DXGI format maps to ISBITMASK(0x0f00,0x00f0,0x000f,0x0000) aka
+      // D3DFMT_X4R4G4B4
+
+      // No 3:3:2, 3:3:2:8, or paletted DXGI formats aka D3DFMT_A8R3G3B2,
+      // D3DFMT_R3G3B2, D3DFMT_P8, D3DFMT_A8P8, etc.
+      break;
+    }
+  } else if (ddpf.flags & DDS_LUMINANCE) {
+    if (8 == ddpf.RGBBitCount) {
+      if (ISBITMASK(0x000000ff, 0x00000000, 0x00000000, 0x00000000)) {
+        return DXGI_FORMAT_R8_UNORM; // D3DX10/11 writes this out as DX10
+                                     // extension
+      }
+
+      // No DXGI format maps to ISBITMASK(0x0f,0x00,0x00,0xf0) aka D3DFMT_A4L4
+    }
+
+    if (16 == ddpf.RGBBitCount) {
+      if (ISBITMASK(0x0000ffff, 0x00000000, 0x00000000, 0x00000000)) {
+        return DXGI_FORMAT_R16_UNORM; // D3DX10/11 writes this out as DX10
+                                      // extension
+      }
+      if (ISBITMASK(0x000000ff, 0x00000000, 0x00000000, 0x0000ff00)) {
+        return DXGI_FORMAT_R8G8_UNORM; // D3DX10/11 writes this out as DX10
+                                       // extension
+      }
+    }
+  } else if (ddpf.flags & DDS_ALPHA) {
+    if (8 == ddpf.RGBBitCount) {
+      return DXGI_FORMAT_A8_UNORM;
+    }
+  } else if (ddpf.flags & DDS_FOURCC) {
+    if (MAKEFOURCC('D', 'X', 'T', '1') == ddpf.fourCC) {
+      return DXGI_FORMAT_BC1_UNORM;
+    }
+    if (MAKEFOURCC('D', 'X', 'T', '3') == ddpf.fourCC) {
+      return DXGI_FORMAT_BC2_UNORM;
+    }
+    if (MAKEFOURCC('D', 'X', 'T', '5') == ddpf.fourCC) {
+      return DXGI_FORMAT_BC3_UNORM;
+    }
+
+    // While pre-mulitplied alpha isn't directly supported by the DXGI formats,
+    // they are basically the same as these BC formats so they can be mapped
+    if (MAKEFOURCC('D', 'X', 'T', '2') == ddpf.fourCC) {
+      return DXGI_FORMAT_BC2_UNORM;
+    }
+    if (MAKEFOURCC('D', 'X', 'T', '4') == ddpf.fourCC) {
+      return DXGI_FORMAT_BC3_UNORM;
+    }
+
+    if (MAKEFOURCC('A', 'T', 'I', '1') == ddpf.fourCC) {
+      return DXGI_FORMAT_BC4_UNORM;
+    }
+    if (MAKEFOURCC('B', 'C', '4', 'U') == ddpf.fourCC) {
+      return DXGI_FORMAT_BC4_UNORM;
+    }
+    if (MAKEFOURCC('B', 'C', '4', 'S') == ddpf.fourCC) {
+      return DXGI_FORMAT_BC4_SNORM;
+    }
+
+    if (MAKEFOURCC('A', 'T', 'I', '2') == ddpf.fourCC) {
+      return DXGI_FORMAT_BC5_UNORM;
+    }
+    if (MAKEFOURCC('B', 'C', '5', 'U') == ddpf.fourCC) {
+      return DXGI_FORMAT_BC5_UNORM;
+    }
+    if (MAKEFOURCC('B', 'C', '5', 'S') == ddpf.fourCC) {
+      return DXGI_FORMAT_BC5_SNORM;
+    }
+
+    // BC6H and BC7 are written using the "DX10" extended header
+
+    if (MAKEFOURCC('R', 'G', 'B', 'G') == ddpf.fourCC) {
+      return DXGI_FORMAT_R8G8_B8G8_UNORM;
+    }
+    if (MAKEFOURCC('G', 'R', 'G', 'B') == ddpf.fourCC) {
+      return DXGI_FORMAT_G8R8_G8B8_UNORM;
+    }
+
+    if (MAKEFOURCC('Y', 'U', 'Y', '2') == ddpf.fourCC) {
+      return DXGI_FORMAT_YUY2;
+    }
+
+    // Check for D3DFORMAT enums being set here
+    switch (ddpf.fourCC) {
+    case 36: // D3DFMT_A16B16G16R16
+      return DXGI_FORMAT_R16G16B16A16_UNORM;
+
+    case 110: // D3DFMT_Q16W16V16U16
+      return DXGI_FORMAT_R16G16B16A16_SNORM;
+
+    case 111: // D3DFMT_R16F
+      return DXGI_FORMAT_R16_FLOAT;
+
+    case 112: // D3DFMT_G16R16F
+      return DXGI_FORMAT_R16G16_FLOAT;
+
+    case 113: // D3DFMT_A16B16G16R16F
+      return DXGI_FORMAT_R16G16B16A16_FLOAT;
+
+    case 114: // D3DFMT_R32F
+      return DXGI_FORMAT_R32_FLOAT;
+
+    case 115: // D3DFMT_G32R32F
+      return DXGI_FORMAT_R32G32_FLOAT;
+
+    case 116: // D3DFMT_A32B32G32R32F
+      return DXGI_FORMAT_R32G32B32A32_FLOAT;
+    }
+  }
+
+  return DXGI_FORMAT_UNKNOWN;
+}
+
+
+auto GetAlphaMode(const DDS_HEADER &header, const DDS_HEADER_DXT10 *dxt10)
+    -> DDS_ALPHA_MODE {
+  if (dxt10) {
+    const auto mode = static_cast<DDS_ALPHA_MODE>(
+        dxt10->miscFlags2 & DDS_MISC_FLAGS2_ALPHA_MODE_MASK);
+    switch (mode) {
+    case DDS_ALPHA_MODE_STRAIGHT:
+    case DDS_ALPHA_MODE_PREMULTIPLIED:
+    case DDS_ALPHA_MODE_OPAQUE:
+    case DDS_ALPHA_MODE_CUSTOM:
+      return mode;
+    default:
+      return DDS_ALPHA_MODE_UNKNOWN;
+    }
+  }
+
+  if ((header.ddspf.flags & DDS_FOURCC) &&
+      (MAKEFOURCC('D', 'X', 'T', '2') == header.ddspf.fourCC ||
+       MAKEFOURCC('D', 'X', 'T', '4') == header.ddspf.fourCC)) {
+    return DDS_ALPHA_MODE_PREMULTIPLIED;
+  }
+
+  return DDS_ALPHA_MODE_UNKNOWN;
+}
+
+auto IsWithinLimits(DDS_RESOURCE_DIMENSION dimension, bool is_cube_map,
+                    uint32_t width, uint32_t height, uint32_t depth,
+                    uint32_t array_size) -> bool {
+  switch (dimension) {
+  case DDS_DIMENSION_TEXTURE1D:
+    return array_size <= kMaxTextureArraySize && width <= kMaxTexture1DSize;
+
+  case DDS_DIMENSION_TEXTURE2D:
+    // array_size already counts the six faces of each cube.
+    if (is_cube_map) {
+      return array_size <= kMaxTextureArraySize &&
+             width <= kMaxTextureCubeSize && height <= kMaxTextureCubeSize;
+    }
+    return array_size <= kMaxTextureArraySize && width <= kMaxTexture2DSize &&
+           height <= kMaxTexture2DSize;
+
+  case DDS_DIMENSION_TEXTURE3D:
+    return array_size == 1 && width <= kMaxTexture3DSize &&
+           height <= kMaxTexture3DSize && depth <= kMaxTexture3DSize;
+
+  default:
+    return false;
+  }
+}
+
+} // namespace
+
+//--------------------------------------------------------------------------------------
+// Return the BPP for a particular format
+//--------------------------------------------------------------------------------------
+auto BitsPerPixel(DXGI_FORMAT fmt) -> size_t {
+  switch (fmt) {
+  case DXGI_FORMAT_R32G32B32A32_TYPELESS:
+  case DXGI_FORMAT_R32G32B32A32_FLOAT:
+  case DXGI_FORMAT_R32G32B32A32_UINT:
+  case DXGI_FORMAT_R32G32B32A32_SINT:
+    return 128;
+
+  case DXGI_FORMAT_R32G32B32_TYPELESS:
+  case DXGI_FORMAT_R32G32B32_FLOAT:
+  case DXGI_FORMAT_R32G32B32_UINT:
+  case DXGI_FORMAT_R32G32B32_SINT:
+    return 96;
+
+  case DXGI_FORMAT_R16G16B16A16_TYPELESS:
+  case DXGI_FORMAT_R16G16B16A16_FLOAT:
+  case DXGI_FORMAT_R16G16B16A16_UNORM:
+  case DXGI_FORMAT_R16G16B16A16_UINT:
+  case DXGI_FORMAT_R16G16B16A16_SNORM:
+  case DXGI_FORMAT_R16G16B16A16_SINT:
+  case DXGI_FORMAT_R32G32_TYPELESS:
+  case DXGI_FORMAT_R32G32_FLOAT:
+  case DXGI_FORMAT_R32G32_UINT:
+  case DXGI_FORMAT_R32G32_SINT:
+  case DXGI_FORMAT_R32G8X24_TYPELESS:
+  case DXGI_FORMAT_D32_FLOAT_S8X24_UINT:
+  case DXGI_FORMAT_R32_FLOAT_X8X24_TYPELESS:
+  case DXGI_FORMAT_X32_TYPELESS_G8X24_UINT:
+  case DXGI_FORMAT_Y416:
+  case DXGI_FORMAT_Y210:
+  case DXGI_FORMAT_Y216:
+    return 64;
+
+  case DXGI_FORMAT_R10G10B10A2_TYPELESS:
+  case DXGI_FORMAT_R10G10B10A2_UNORM:
+  case DXGI_FORMAT_R10G10B10A2_UINT:
+  case DXGI_FORMAT_R11G11B10_FLOAT:
+  case DXGI_FORMAT_R8G8B8A8_TYPELESS:
+  case DXGI_FORMAT_R8G8B8A8_UNORM:
+  case DXGI_FORMAT_R8G8B8A8_UNORM_SRGB:
+  case DXGI_FORMAT_R8G8B8A8_UINT:
+  case DXGI_FORMAT_R8G8B8A8_SNORM:
+  case DXGI_FORMAT_R8G8B8A8_SINT:
+  case DXGI_FORMAT_R16G16_TYPELESS:
+  case DXGI_FORMAT_R16G16_FLOAT:
+  case DXGI_FORMAT_R16G16_UNORM:
+  case DXGI_FORMAT_R16G16_UINT:
+  case DXGI_FORMAT_R16G16_SNORM:
+  case DXGI_FORMAT_R16G16_SINT:
+  case DXGI_FORMAT_R32_TYPELESS:
+  case DXGI_FORMAT_D32_FLOAT:
+  case DXGI_FORMAT_R32_FLOAT:
+  case DXGI_FORMAT_R32_UINT:
+  case DXGI_FORMAT_R32_SINT:
+  case DXGI_FORMAT_R24G8_TYPELESS:
+  case DXGI_FORMAT_D24_UNORM_S8_UINT:
+  case DXGI_FORMAT_R24_UNORM_X8_TYPELESS:
+  case DXGI_FORMAT_X24_TYPELESS_G8_UINT:
+  case DXGI_FORMAT_R9G9B9E5_SHAREDEXP:
+  case DXGI_FORMAT_R8G8_B8G8_UNORM:
+  case DXGI_FORMAT_G8R8_G8B8_UNORM:
+  case DXGI_FORMAT_B8G8R8A8_UNORM:
+  case DXGI_FORMAT_B8G8R8X8_UNORM:
+  case DXGI_FORMAT_R10G10B10_XR_BIAS_A2_UNORM:
+  case DXGI_FORMAT_B8G8R8A8_TYPELESS:
+  case DXGI_FORMAT_B8G8R8A8_UNORM_SRGB:
+  case DXGI_FORMAT_B8G8R8X8_TYPELESS:
+  case DXGI_FORMAT_B8G8R8X8_UNORM_SRGB:
+  case DXGI_FORMAT_AYUV:
+  case DXGI_FORMAT_Y410:
+  case DXGI_FORMAT_YUY2:
+    return 32;
+
+  case DXGI_FORMAT_P010:
+  case DXGI_FORMAT_P016:
+    return 24;
+
+  case DXGI_FORMAT_R8G8_TYPELESS:
+  case DXGI_FORMAT_R8G8_UNORM:
+  case DXGI_FORMAT_R8G8_UINT:
+  case DXGI_FORMAT_R8G8_SNORM:
+  case DXGI_FORMAT_R8G8_SINT:
+  case DXGI_FORMAT_R16_TYPELESS:
+  case DXGI_FORMAT_R16_FLOAT:
+  case DXGI_FORMAT_D16_UNORM:
+  case DXGI_FORMAT_R16_UNORM:
+  case DXGI_FORMAT_R16_UINT:
+  case DXGI_FORMAT_R16_SNORM:
+  case DXGI_FORMAT_R16_SINT:
+  case DXGI_FORMAT_B5G6R5_UNORM:
+  case DXGI_FORMAT_B5G5R5A1_UNORM:
+  case DXGI_FORMAT_A8P8:
+  case DXGI_FORMAT_B4G4R4A4_UNORM:
+    return 16;
+
+  case DXGI_FORMAT_NV12:
+  case DXGI_FORMAT_420_OPAQUE:
+  case DXGI_FORMAT_NV11:
+    return 12;
+
+  case DXGI_FORMAT_R8_TYPELESS:
+  case DXGI_FORMAT_R8_UNORM:
+  case DXGI_FORMAT_R8_UINT:
+  case DXGI_FORMAT_R8_SNORM:
+  case DXGI_FORMAT_R8_SINT:
+  case DXGI_FORMAT_A8_UNORM:
+  case DXGI_FORMAT_AI44:
+  case DXGI_FORMAT_IA44:
+  case DXGI_FORMAT_P8:
+    return 8;
+
+  case DXGI_FORMAT_R1_UNORM:
+    return 1;
+
+  case DXGI_FORMAT_BC1_TYPELESS:
+  case DXGI_FORMAT_BC1_UNORM:
+  case DXGI_FORMAT_BC1_UNORM_SRGB:
+  case DXGI_FORMAT_BC4_TYPELESS:
+  case DXGI_FORMAT_BC4_UNORM:
+  case DXGI_FORMAT_BC4_SNORM:
+    return 4;
+
+  case DXGI_FORMAT_BC2_TYPELESS:
+  case DXGI_FORMAT_BC2_UNORM:
+  case DXGI_FORMAT_BC2_UNORM_SRGB:
+  case DXGI_FORMAT_BC3_TYPELESS:
+  case DXGI_FORMAT_BC3_UNORM:
+  case DXGI_FORMAT_BC3_UNORM_SRGB:
+  case DXGI_FORMAT_BC5_TYPELESS:
+  case DXGI_FORMAT_BC5_UNORM:
+  case DXGI_FORMAT_BC5_SNORM:
+  case DXGI_FORMAT_BC6H_TYPELESS:
+  case DXGI_FORMAT_BC6H_UF16:
+  case DXGI_FORMAT_BC6H_SF16:
+  case DXGI_FORMAT_BC7_TYPELESS:
+  case DXGI_FORMAT_BC7_UNORM:
+  case DXGI_FORMAT_BC7_UNORM_SRGB:
+    return 8;
+
+  default:
+    return 0;
+  }
+}
+
+//--------------------------------------------------------------------------------------
+// Get surface information for a particular format
+//--------------------------------------------------------------------------------------
+void GetSurfaceInfo(size_t width, size_t height, DXGI_FORMAT fmt,
+                    size_t *outNumBytes, size_t *outRowBytes,
+                    size_t *outNumRows) {
+  size_t numBytes = 0;
+  size_t rowBytes = 0;
+  size_t numRows = 0;
+
+  bool bc = false;
+  bool packed = false;
+  bool planar = false;
+  size_t bpe = 0;
+  switch (fmt) {
+  case DXGI_FORMAT_BC1_TYPELESS:
+  case DXGI_FORMAT_BC1_UNORM:
+  case DXGI_FORMAT_BC1_UNORM_SRGB:
+  case DXGI_FORMAT_BC4_TYPELESS:
+  case DXGI_FORMAT_BC4_UNORM:
+  case DXGI_FORMAT_BC4_SNORM:
+    bc = true;
+    bpe = 8;
+    break;
+
+  case DXGI_FORMAT_BC2_TYPELESS:
+  case DXGI_FORMAT_BC2_UNORM:
+  case DXGI_FORMAT_BC2_UNORM_SRGB:
+  case DXGI_FORMAT_BC3_TYPELESS:
+  case DXGI_FORMAT_BC3_UNORM:
+  case DXGI_FORMAT_BC3_UNORM_SRGB:
+  case DXGI_FORMAT_BC5_TYPELESS:
+  case DXGI_FORMAT_BC5_UNORM:
+  case DXGI_FORMAT_BC5_SNORM:
+  case DXGI_FORMAT_BC6H_TYPELESS:
+  case DXGI_FORMAT_BC6H_UF16:
+  case DXGI_FORMAT_BC6H_SF16:
+  case DXGI_FORMAT_BC7_TYPELESS:
+  case DXGI_FORMAT_BC7_UNORM:
+  case DXGI_FORMAT_BC7_UNORM_SRGB:
+    bc = true;
+    bpe = 16;
+    break;
+
+  case DXGI_FORMAT_R8G8_B8G8_UNORM:
+  case DXGI_FORMAT_G8R8_G8B8_UNORM:
+  case DXGI_FORMAT_YUY2:
+    packed = true;
+    bpe = 4;
+    break;
+
+  case DXGI_FORMAT_Y210:
+  case DXGI_FORMAT_Y216:
+    packed = true;
+    bpe = 8;
+    break;
+
+  case DXGI_FORMAT_NV12:
+  case DXGI_FORMAT_420_OPAQUE:
+    planar = true;
+    bpe = 2;
+    break;
+
+  case DXGI_FORMAT_P010:
+  case DXGI_FORMAT_P016:
+    planar = true;
+    bpe = 4;
+    break;
+
+  default:
+    // One texel per element, sized by BitsPerPixel below.
+    break;
+  }
+
+  if (bc) {
+    size_t numBlocksWide = 0;
+    if (width > 0) {
+      numBlocksWide = std::max<size_t>(1, (width + 3) / 4);
+    }
+    size_t numBlocksHigh = 0;
+    if (height > 0) {
+      numBlocksHigh = std::max<size_t>(1, (height + 3) / 4);
+    }
+    rowBytes = numBlocksWide * bpe;
+    numRows = numBlocksHigh;
+    numBytes = rowBytes * numBlocksHigh;
+  } else if (packed) {
+    rowBytes = ((width + 1) >> 1) * bpe;
+    numRows = height;
+    numBytes = rowBytes * height;
+  } else if (fmt == DXGI_FORMAT_NV11) {
+    rowBytes = ((width + 3) >> 2) * 4;
+    numRows = height * 2; // Direct3D makes this simplifying assumption,
+                          // although it is larger than the 4:1:1 data
+    numBytes = rowBytes * numRows;
+  } else if (planar) {
+    rowBytes = ((width + 1) >> 1) * bpe;
+    numBytes = (rowBytes * height) + ((rowBytes * height + 1) >> 1);
+    numRows = height + ((height + 1) >> 1);
+  } else {
+    size_t bpp = BitsPerPixel(fmt);
+    rowBytes = (width * bpp + 7) / 8; // round up to nearest byte
+    numRows = height;
+    numBytes = rowBytes * height;
+  }
+
+  if (outNumBytes) {
+    *outNumBytes = numBytes;
+  }
+  if (outRowBytes) {
+    *outRowBytes = rowBytes;
+  }
+  if (outNumRows) {
+    *outNumRows = numRows;
+  }
+}
+
+auto ParseDDSImage(const uint8_t *data, size_t size, size_t max_size,
+                   DDSLayout &layout) -> bool {
+  layout = {};
+
+  if (!data || size < sizeof(uint32_t) + sizeof(DDS_HEADER)) {
+    return false;
+  }
+
+  // DDS files always start with the same magic number ("DDS ").
+  if (*reinterpret_cast<const uint32_t *>(data) != DDS_MAGIC) {
+    return false;
+  }
+
+  const auto &header =
+      *reinterpret_cast<const DDS_HEADER *>(data + sizeof(uint32_t));
+  if (header.size != sizeof(DDS_HEADER) ||
+      header.ddspf.size != sizeof(DDS_PIXELFORMAT)) {
+    return false;
+  }
+
+  size_t offset = sizeof(uint32_t) + sizeof(DDS_HEADER);
+  const DDS_HEADER_DXT10 *dxt10 = nullptr;
+  if (IsDX10Header(header)) {
+    if (size < offset + sizeof(DDS_HEADER_DXT10)) {
+      return false;
+    }
+    dxt10 = reinterpret_cast<const DDS_HEADER_DXT10 *>(data + offset);
+    offset += sizeof(DDS_HEADER_DXT10);
+  }
+
+  uint32_t width = header.width;
+  uint32_t height = header.height;
+  uint32_t depth = header.depth;
+  uint32_t array_size = 1;
+  const uint32_t mip_count = (std::max)(header.mipMapCount, 1u);
+  DXGI_FORMAT format = DXGI_FORMAT_UNKNOWN;
+  DDS_RESOURCE_DIMENSION dimension = DDS_DIMENSION_TEXTURE2D;
+  bool is_cube_map = false;
+
+  if (dxt10) {
+    array_size = dxt10->arraySize;
+    if (array_size == 0) {
+      return false;
+    }
+
+    switch (dxt10->dxgiFormat) {
+    case DXGI_FORMAT_AI44:
+    case DXGI_FORMAT_IA44:
+    case DXGI_FORMAT_P8:
+    case DXGI_FORMAT_A8P8:
+      return false;
+
+    default:
+      if (BitsPerPixel(dxt10->dxgiFormat) == 0) {
+        return false;
+      }
+    }
+    format = dxt10->dxgiFormat;
+
+    switch (dxt10->resourceDimension) {
+    case DDS_DIMENSION_TEXTURE1D:
+      // D3DX writes 1D textures with a fixed height of 1.
+      if ((header.flags & DDS_HEIGHT) && height != 1) {
+        return false;
+      }
+      height = depth = 1;
+      break;
+
+    case DDS_DIMENSION_TEXTURE2D:
+      if (dxt10->miscFlag & DDS_RESOURCE_MISC_TEXTURECUBE) {
+        array_size *= 6;
+        is_cube_map = true;
+      }
+      depth = 1;
+      break;
+
+    case DDS_DIMENSION_TEXTURE3D:
+      if (!(header.flags & DDS_HEADER_FLAGS_VOLUME) || array_size > 1) {
+        return false;
+      }
+      break;
+
+    default:
+      return false;
+    }
+    dimension = static_cast<DDS_RESOURCE_DIMENSION>(dxt10->resourceDimension);
+  } else {
+    format = GetDXGIFormat(header.ddspf);
+    if (format == DXGI_FORMAT_UNKNOWN) {
+      return false;
+    }
+
+    if (header.flags & DDS_HEADER_FLAGS_VOLUME) {
+      dimension = DDS_DIMENSION_TEXTURE3D;
+    } else {
+      if (header.caps2 & DDS_CUBEMAP) {
+        // Partial cube maps cannot be represented.
+        if ((header.caps2 & DDS_CUBEMAP_ALLFACES) != DDS_CUBEMAP_ALLFACES) {
+          return false;
+        }
+        array_size = 6;
+        is_cube_map = true;
+      }
+      // A legacy DDS has no way to express a 1D texture.
+      depth = 1;
+      dimension = DDS_DIMENSION_TEXTURE2D;
+    }
+  }
+
+  if (width == 0 || height == 0 || depth == 0 || mip_count > kMaxMipLevels ||
+      !IsWithinLimits(dimension, is_cube_map, width, height, depth,
+                      array_size)) {
+    return false;
+  }
+
+  layout.format = format;
+  layout.dimension = dimension;
+  layout.array_size = array_size;
+  layout.is_cube_map = is_cube_map;
+  layout.alpha_mode = GetAlphaMode(header, dxt10);
+  layout.subresources.reserve(static_cast<size_t>(mip_count) * array_size);
+
+  // Texels follow the headers slice by slice, each slice holding its whole
+  // mip chain.
+  uint64_t position = offset;
+  uint32_t skipped_mips = 0;
+  for (uint32_t slice = 0; slice < array_size; ++slice) {
+    uint32_t w = width;
+    uint32_t h = height;
+    uint32_t d = depth;
+    for (uint32_t mip = 0; mip < mip_count; ++mip) {
+      size_t num_bytes = 0;
+      size_t row_bytes = 0;
+      size_t num_rows = 0;
+      GetSurfaceInfo(w, h, format, &num_bytes, &row_bytes, &num_rows);
+
+      const uint64_t surface_bytes = static_cast<uint64_t>(num_bytes) * d;
+      if (num_bytes == 0 || surface_bytes > size - position) {
+        return false;
+      }
+
+      const bool keep = mip_count <= 1 || max_size == 0 ||
+                        (w <= max_size && h <= max_size && d <= max_size);
+      if (keep) {
+        if (layout.subresources.empty()) {
+          layout.width = w;
+          layout.height = h;
+          layout.depth = d;
+        }
+
+        DDSSubresource subresource = {};
+        subresource.offset = position;
+        subresource.width = w;
+        subresource.height = h;
+        subresource.depth = d;
+        subresource.row_bytes = row_bytes;
+        subresource.row_count = static_cast<uint32_t>(num_rows);
+        subresource.slice_bytes = num_bytes;
+        layout.subresources.push_back(subresource);
+      } else if (slice == 0) {
+        ++skipped_mips;
+      }
+
+      position += surface_bytes;
+      w = (std::max)(w >> 1, 1u);
+      h = (std::max)(h >> 1, 1u);
+      d = (std::max)(d >> 1, 1u);
+    }
+  }
+
+  if (layout.subresources.empty()) {
+    return false;
+  }
+  layout.mip_count = mip_count - skipped_mips;
+  return true;
+}
+
+auto BuildDDSImage(const DDSImageDesc &desc, std::vector<uint8_t> &image)
+    -> bool {
+  if (!desc.data || desc.width == 0 || desc.height == 0 ||
+      desc.mip_count == 0 || desc.mip_count > kMaxMipLevels ||
+      BitsPerPixel(desc.format) == 0) {
+    return false;
+  }
+
+  size_t expected_size = 0;
+  size_t top_bytes = 0;
+  size_t top_row_bytes = 0;
+  size_t width = desc.width;
+  size_t height = desc.height;
+  for (uint32_t level = 0; level < desc.mip_count; ++level) {
+    size_t num_bytes = 0;
+    size_t row_bytes = 0;
+    GetSurfaceInfo(width, height, desc.format, &num_bytes, &row_bytes,
+                   nullptr);
+    if (level == 0) {
+      top_bytes = num_bytes;
+      top_row_bytes = row_bytes;
+    }
+    expected_size += num_bytes;
+    width = (std::max)(width / 2, size_t{1});
+    height = (std::max)(height / 2, size_t{1});
+  }
+  if (expected_size != desc.size) {
+    return false;
+  }
+
+  const bool is_compressed = (desc.format >= DXGI_FORMAT_BC1_TYPELESS &&
+                              desc.format <= DXGI_FORMAT_BC5_SNORM) ||
+                             (desc.format >= DXGI_FORMAT_BC6H_TYPELESS &&
+                              desc.format <= DXGI_FORMAT_BC7_UNORM_SRGB);
+
+  DDS_HEADER header = {};
+  header.size = sizeof(DDS_HEADER);
+  header.flags = DDS_HEADER_FLAGS_TEXTURE |
+                 (is_compressed ? DDS_HEADER_FLAGS_LINEARSIZE
+                                : DDS_HEADER_FLAGS_PITCH);
+  if (desc.mip_count > 1) {
+    header.flags |= DDS_HEADER_FLAGS_MIPMAP;
+  }
+  header.height = desc.height;
+  header.width = desc.width;
+  header.pitchOrLinearSize =
+      static_cast<uint32_t>(is_compressed ? top_bytes : top_row_bytes);
+  header.mipMapCount = desc.mip_count;
+  memcpy(header.reserved1, desc.reserved, sizeof(header.reserved1));
+  header.ddspf = DDSPF_DX10;
+  header.caps = DDS_SURFACE_FLAGS_TEXTURE;
+  if (desc.mip_count > 1) {
+    header.caps |= DDS_SURFACE_FLAGS_MIPMAP;
+  }
+
+  DDS_HEADER_DXT10 dxt10 = {};
+  dxt10.dxgiFormat = desc.format;
+  dxt10.resourceDimension = DDS_DIMENSION_TEXTURE2D;
+  dxt10.arraySize = 1;
+
+  const uint32_t magic = DDS_MAGIC;
+  image.resize(sizeof(magic) + sizeof(header) + sizeof(dxt10) + desc.size);
+  uint8_t *output = image.data();
+  memcpy(output, &magic, sizeof(magic));
+  output += sizeof(magic);
+  memcpy(output, &header, sizeof(header));
+  output += sizeof(header);
+  memcpy(output, &dxt10, sizeof(dxt10));
+  output += sizeof(dxt10);
+  memcpy(output, desc.data, desc.size);
+  return true;
+}
+
+auto ReadDDSReserved(const uint8_t *data, size_t size, uint32_t reserved[11])
+    -> bool {
+  if (!data || size < sizeof(uint32_t) + sizeof(DDS_HEADER) ||
+      *reinterpret_cast<const uint32_t *>(data) != DDS_MAGIC) {
+    return false;
+  }
+  const auto &header =
+      *reinterpret_cast<const DDS_HEADER *>(data + sizeof(uint32_t));
+  memcpy(reserved, header.reserved1, sizeof(header.reserved1));
+  return true;
+}
+
+} // namespace ResourceLoader
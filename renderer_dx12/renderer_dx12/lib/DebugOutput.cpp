@@ -0,0 +1,18 @@
+#include "stdafx.h"
+
+#include "DebugOutput.h"
+
+#if defined(_WIN32)
+#include <Windows.h>
+#else
+#include <cstdio>
+#include <cwchar>
+#endif
+
+void WriteDebugOutput(const wchar_t *message) {
+#if defined(_WIN32)
+  OutputDebugStringW(message);
+#else
+  fputws(message, stderr);
+#endif
+}
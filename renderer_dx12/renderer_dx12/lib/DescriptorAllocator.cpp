@@ -0,0 +1,108 @@
+#include "stdafx.h"
+
+#include "DescriptorAllocator.h"
+
+#include <algorithm>
+#include <iterator>
+
+void DescriptorAllocator::Reset(uint32_t capacity) {
+  free_runs_.clear();
+  if (capacity > 0) {
+    free_runs_.emplace(0, capacity);
+  }
+  capacity_ = capacity;
+  used_ = 0;
+  peak_used_ = 0;
+}
+
+auto DescriptorAllocator::Allocate(uint32_t count, uint32_t &offset) -> bool {
+  if (count == 0) {
+    return false;
+  }
+
+  for (auto it = free_runs_.begin(); it != free_runs_.end(); ++it) {
+    if (it->second < count) {
+      continue;
+    }
+
+    offset = it->first;
+    const uint32_t remaining = it->second - count;
+    free_runs_.erase(it);
+    if (remaining > 0) {
+      free_runs_.emplace(offset + count, remaining);
+    }
+
+    used_ += count;
+    peak_used_ = (std::max)(peak_used_, used_);
+    return true;
+  }
+
+  return false;
+}
+
+void DescriptorAllocator::Free(uint32_t offset, uint32_t count) {
+  if (count == 0) {
+    return;
+  }
+
+  uint32_t start = offset;
+  uint32_t length = count;
+
+  // Merge with the free run right after this one, then the one before.
+  auto next = free_runs_.lower_bound(offset);
+  if (next != free_runs_.end() && next->first == offset + count) {
+    length += next->second;
+    next = free_runs_.erase(next);
+  }
+  if (next != free_runs_.begin()) {
+    auto previous = std::prev(next);
+    if (previous->first + previous->second == offset) {
+      start = previous->first;
+      length += previous->second;
+      free_runs_.erase(previous);
+    }
+  }
+
+  free_runs_.emplace(start, length);
+  used_ -= count;
+}
+
+void DescriptorRing::Reset(uint32_t capacity, uint32_t frame_count) {
+  frame_starts_.assign((std::max)(frame_count, 1u), kNoFrame);
+  capacity_ = capacity;
+  head_ = 0;
+  tail_ = 0;
+}
+
+void DescriptorRing::BeginFrame(uint32_t slot) {
+  if (slot >= frame_starts_.size()) {
+    return;
+  }
+
+  // Whatever is left in flight was recorded after this slot's last frame.
+  frame_starts_[slot] = kNoFrame;
+  tail_ = head_;
+  for (uint64_t start : frame_starts_) {
+    tail_ = (std::min)(tail_, start);
+  }
+
+  frame_starts_[slot] = head_;
+}
+
+auto DescriptorRing::Allocate(uint32_t count, uint32_t &offset) -> bool {
+  if (count == 0 || count > capacity_) {
+    return false;
+  }
+
+  uint64_t start = head_;
+  if (start % capacity_ + count > capacity_) {
+    start += capacity_ - start % capacity_;
+  }
+  if (start + count - tail_ > capacity_) {
+    return false;
+  }
+
+  offset = static_cast<uint32_t>(start % capacity_);
+  head_ = start + count;
+  return true;
+}
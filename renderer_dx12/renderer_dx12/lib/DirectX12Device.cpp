@@ -2,16 +2,50 @@
 
 #include "DirectX12Device.h"
 
+#include "D3D12UploadDevice.h"
+
+#include <algorithm>
+#include <cstring>
+#include <iterator>
 #include <sstream>
 
+namespace {
+
+// Set by ScopedPassRecording for the duration of a pass.
+thread_local ID3D12GraphicsCommandList *bound_command_list = nullptr;
+
+thread_local CommandStateShadow *bound_shadow = nullptr;
+
+auto ToShadow(const D3D12_VERTEX_BUFFER_VIEW &view) -> ShadowVertexBuffer {
+  ShadowVertexBuffer shadow;
+  shadow.location = view.BufferLocation;
+  shadow.size = view.SizeInBytes;
+  shadow.stride = view.StrideInBytes;
+  return shadow;
+}
+
+auto ToShadow(const D3D12_INDEX_BUFFER_VIEW &view) -> ShadowIndexBuffer {
+  ShadowIndexBuffer shadow;
+  shadow.location = view.BufferLocation;
+  shadow.size = view.SizeInBytes;
+  shadow.format = static_cast<uint32_t>(view.Format);
+  return shadow;
+}
+
+} // namespace
+
 DirectX12Device::~DirectX12Device() {
   if (fence_ && default_graphics_command_queue_) {
-    WaitForPreviousFrame();
+    WaitForGpuIdle();
   }
   if (fence_handle_) {
     CloseHandle(fence_handle_);
     fence_handle_ = nullptr;
   }
+  if (frame_latency_waitable_) {
+    CloseHandle(frame_latency_waitable_);
+    frame_latency_waitable_ = nullptr;
+  }
 }
 
 std::shared_ptr<DirectX12Device>
@@ -30,6 +64,9 @@ bool DirectX12Device::Initialize(const DirectX12DeviceConfig &config) {
   config_ = config;
   is_vsync_enabled_ = config.vsync_enabled;
 
+  frame_ring_.Reset(config.frame_latency);
+  config_.frame_latency = frame_ring_.GetFrameCount();
+
   HRESULT hr = EnableDebugLayer();
   if (FAILED(hr)) {
     LogInitializationFailure(L"EnableDebugLayer", hr);
@@ -62,14 +99,22 @@ bool DirectX12Device::Initialize(const DirectX12DeviceConfig &config) {
   }
 
   hr = dxgi_resources_->CreateSwapChain(
-      config_, default_graphics_command_queue_.Get(), swap_chain_, frame_cout_);
+      config_, default_graphics_command_queue_.Get(), swap_chain_,
+      GetFrameCount(), frame_latency_waitable_);
   if (FAILED(hr)) {
     LogInitializationFailure(L"CreateSwapChain", hr);
     ResetDeviceState();
     return false;
   }
 
-  frame_index_ = swap_chain_->GetCurrentBackBufferIndex();
+  back_buffer_index_ = swap_chain_->GetCurrentBackBufferIndex();
+
+  hr = CreateDescriptorHeaps();
+  if (FAILED(hr)) {
+    LogInitializationFailure(L"CreateDescriptorHeaps", hr);
+    ResetDeviceState();
+    return false;
+  }
 
   hr = CreateRenderTargetViews();
   if (FAILED(hr)) {
@@ -106,6 +151,13 @@ bool DirectX12Device::Initialize(const DirectX12DeviceConfig &config) {
     return false;
   }
 
+  hr = CreateUploadContext();
+  if (FAILED(hr)) {
+    LogInitializationFailure(L"CreateUploadContext", hr);
+    ResetDeviceState();
+    return false;
+  }
+
   InitializeViewportsAndScissors();
   InitializeMatrices();
 
@@ -148,44 +200,180 @@ HRESULT DirectX12Device::CreateCommandQueues() {
   return hr;
 }
 
-HRESULT DirectX12Device::CreateRenderTargetViews() {
-  if (!d3d12device_ || !swap_chain_) {
+HRESULT DirectX12Device::CreateDescriptorHeaps() {
+  if (!d3d12device_) {
     return E_FAIL;
   }
 
-  render_target_view_heap_.Reset();
-  for (auto &render_target : back_buffer_render_targets_) {
-    render_target.Reset();
+  struct HeapLayout {
+    D3D12_DESCRIPTOR_HEAP_TYPE type;
+    D3D12_DESCRIPTOR_HEAP_FLAGS flags;
+    UINT descriptor_count;
+  };
+  // In DescriptorHeapKind order.
+  const HeapLayout layouts[] = {
+      {D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV,
+       D3D12_DESCRIPTOR_HEAP_FLAG_SHADER_VISIBLE,
+       shader_visible_descriptor_count_},
+      {D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV, D3D12_DESCRIPTOR_HEAP_FLAG_NONE,
+       staging_descriptor_count_},
+      {D3D12_DESCRIPTOR_HEAP_TYPE_RTV, D3D12_DESCRIPTOR_HEAP_FLAG_NONE,
+       render_target_descriptor_count_},
+      {D3D12_DESCRIPTOR_HEAP_TYPE_DSV, D3D12_DESCRIPTOR_HEAP_FLAG_NONE,
+       depth_stencil_descriptor_count_},
+  };
+
+  std::lock_guard<std::mutex> lock(descriptor_mutex_);
+
+  for (size_t kind = 0; kind < std::size(layouts); ++kind) {
+    const HeapLayout &layout = layouts[kind];
+    DescriptorHeap &heap = descriptor_heaps_[kind];
+
+    D3D12_DESCRIPTOR_HEAP_DESC heap_desc = {};
+    heap_desc.NumDescriptors = layout.descriptor_count;
+    heap_desc.Type = layout.type;
+    heap_desc.Flags = layout.flags;
+
+    HRESULT hr = d3d12device_->CreateDescriptorHeap(
+        &heap_desc, IID_PPV_ARGS(&heap.heap));
+    if (FAILED(hr)) {
+      return hr;
+    }
+
+    heap.increment_size =
+        d3d12device_->GetDescriptorHandleIncrementSize(layout.type);
+    heap.allocator.Reset(layout.descriptor_count);
   }
 
-  D3D12_DESCRIPTOR_HEAP_DESC render_target_heap_desc = {};
-  render_target_heap_desc.NumDescriptors = frame_cout_;
-  render_target_heap_desc.Type = D3D12_DESCRIPTOR_HEAP_TYPE_RTV;
-  render_target_heap_desc.Flags = D3D12_DESCRIPTOR_HEAP_FLAG_NONE;
+  // The tail of the shader-visible heap is the transient ring, kept out of
+  // the free list.
+  descriptor_heaps_[static_cast<size_t>(DescriptorHeapKind::kShaderVisible)]
+      .allocator.Reset(shader_visible_descriptor_count_ -
+                       transient_descriptor_count_);
+  transient_descriptors_.Reset(transient_descriptor_count_, GetFrameCount());
+  transient_descriptors_.BeginFrame(GetFrameIndex());
+  released_descriptors_.clear();
 
-  HRESULT hr = d3d12device_->CreateDescriptorHeap(
-      &render_target_heap_desc, IID_PPV_ARGS(&render_target_view_heap_));
-  if (FAILED(hr)) {
-    return hr;
+  return S_OK;
+}
+
+auto DirectX12Device::AllocateDescriptors(DescriptorHeapKind kind, UINT count)
+    -> DescriptorRangePtr {
+  auto range = std::make_unique<DescriptorRange>();
+  {
+    std::lock_guard<std::mutex> lock(descriptor_mutex_);
+    DescriptorHeap &heap = descriptor_heaps_[static_cast<size_t>(kind)];
+    if (!heap.heap || !heap.allocator.Allocate(count, range->offset)) {
+      std::wstringstream stream;
+      stream << L"[DirectX12Device] Descriptor heap " << static_cast<int>(kind)
+             << L" is out of space for " << count << L" descriptors.\n";
+      OutputDebugStringW(stream.str().c_str());
+      return nullptr;
+    }
+
+    range->kind = kind;
+    range->count = count;
+    range->increment_size = heap.increment_size;
+    range->cpu_handle = CD3DX12_CPU_DESCRIPTOR_HANDLE(
+        heap.heap->GetCPUDescriptorHandleForHeapStart(), range->offset,
+        heap.increment_size);
+    if (kind == DescriptorHeapKind::kShaderVisible) {
+      range->gpu_handle = CD3DX12_GPU_DESCRIPTOR_HANDLE(
+          heap.heap->GetGPUDescriptorHandleForHeapStart(), range->offset,
+          heap.increment_size);
+    }
+  }
+
+  // Ranges may outlive the device; by then there is nothing to return.
+  std::weak_ptr<DirectX12Device> weak_device = weak_from_this();
+  return DescriptorRangePtr(
+      range.release(), [weak_device](const DescriptorRange *released) {
+        if (auto device = weak_device.lock()) {
+          device->FreeDescriptors(*released);
+        }
+        delete released;
+      });
+}
+
+void DirectX12Device::FreeDescriptors(const DescriptorRange &range) {
+  std::lock_guard<std::mutex> lock(descriptor_mutex_);
+  if (range.kind == DescriptorHeapKind::kShaderVisible) {
+    // Frames already recorded may still bind it.
+    released_descriptors_.push_back(range);
+    return;
+  }
+  // CPU-only descriptors are consumed while recording.
+  descriptor_heaps_[static_cast<size_t>(range.kind)].allocator.Free(
+      range.offset, range.count);
+}
+
+bool DirectX12Device::AllocateTransientTable(
+    UINT count, const D3D12_CPU_DESCRIPTOR_HANDLE *sources,
+    D3D12_GPU_DESCRIPTOR_HANDLE &table) {
+  if (!d3d12device_ || count == 0 || sources == nullptr) {
+    return false;
+  }
+
+  const DescriptorHeap &heap = descriptor_heaps_[static_cast<size_t>(
+      DescriptorHeapKind::kShaderVisible)];
+  uint32_t offset = 0;
+  {
+    std::lock_guard<std::mutex> lock(frame_memory_mutex_);
+    if (!heap.heap || !transient_descriptors_.Allocate(count, offset)) {
+      return false;
+    }
+  }
+  offset += shader_visible_descriptor_count_ - transient_descriptor_count_;
+
+  CD3DX12_CPU_DESCRIPTOR_HANDLE destination(
+      heap.heap->GetCPUDescriptorHandleForHeapStart(), offset,
+      heap.increment_size);
+  for (UINT i = 0; i < count; ++i) {
+    d3d12device_->CopyDescriptorsSimple(1, destination, sources[i],
+                                        D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
+    destination.Offset(1, heap.increment_size);
+  }
+
+  table = CD3DX12_GPU_DESCRIPTOR_HANDLE(
+      heap.heap->GetGPUDescriptorHandleForHeapStart(), offset,
+      heap.increment_size);
+  return true;
+}
+
+void DirectX12Device::BindDescriptorHeaps(
+    ID3D12GraphicsCommandList *command_list, CommandStateShadow &shadow) {
+  ID3D12DescriptorHeap *heaps[] = {
+      descriptor_heaps_[static_cast<size_t>(DescriptorHeapKind::kShaderVisible)]
+          .heap.Get()};
+  const void *shadow_heaps[] = {heaps[0]};
+  if (shadow.SetDescriptorHeaps(1, shadow_heaps)) {
+    command_list->SetDescriptorHeaps(1, heaps);
+  }
+}
+
+HRESULT DirectX12Device::CreateRenderTargetViews() {
+  if (!d3d12device_ || !swap_chain_) {
+    return E_FAIL;
   }
 
-  render_target_descriptor_size_ =
-      d3d12device_->GetDescriptorHandleIncrementSize(
-          D3D12_DESCRIPTOR_HEAP_TYPE_RTV);
+  back_buffer_rtvs_.reset();
+  back_buffer_render_targets_.assign(GetFrameCount(), nullptr);
 
-  CD3DX12_CPU_DESCRIPTOR_HANDLE render_target_handle(
-      render_target_view_heap_->GetCPUDescriptorHandleForHeapStart());
+  back_buffer_rtvs_ =
+      AllocateDescriptors(DescriptorHeapKind::kRenderTarget, GetFrameCount());
+  if (!back_buffer_rtvs_) {
+    return E_OUTOFMEMORY;
+  }
 
-  for (UINT index = 0; index < frame_cout_; ++index) {
-    hr = swap_chain_->GetBuffer(
+  for (UINT index = 0; index < GetFrameCount(); ++index) {
+    HRESULT hr = swap_chain_->GetBuffer(
         index, IID_PPV_ARGS(&back_buffer_render_targets_[index]));
     if (FAILED(hr)) {
       return hr;
     }
     d3d12device_->CreateRenderTargetView(
         back_buffer_render_targets_[index].Get(), nullptr,
-        render_target_handle);
-    render_target_handle.Offset(1, render_target_descriptor_size_);
+        back_buffer_rtvs_->GetCpuHandle(index));
   }
 
   return S_OK;
@@ -196,18 +384,13 @@ HRESULT DirectX12Device::CreateDepthStencilResources() {
     return E_FAIL;
   }
 
-  depth_stencil_view_heap_.Reset();
+  depth_stencil_view_.reset();
   depth_stencil_resource_.Reset();
 
-  D3D12_DESCRIPTOR_HEAP_DESC dsv_heap_desc = {};
-  dsv_heap_desc.NumDescriptors = 1;
-  dsv_heap_desc.Type = D3D12_DESCRIPTOR_HEAP_TYPE_DSV;
-  dsv_heap_desc.Flags = D3D12_DESCRIPTOR_HEAP_FLAG_NONE;
-
-  HRESULT hr = d3d12device_->CreateDescriptorHeap(
-      &dsv_heap_desc, IID_PPV_ARGS(&depth_stencil_view_heap_));
-  if (FAILED(hr)) {
-    return hr;
+  depth_stencil_view_ =
+      AllocateDescriptors(DescriptorHeapKind::kDepthStencil, 1);
+  if (!depth_stencil_view_) {
+    return E_OUTOFMEMORY;
   }
 
   D3D12_DEPTH_STENCIL_VIEW_DESC depth_stencil_desc = {};
@@ -220,7 +403,7 @@ HRESULT DirectX12Device::CreateDepthStencilResources() {
   depth_clear_value.DepthStencil.Depth = 1.0f;
   depth_clear_value.DepthStencil.Stencil = 0;
 
-  hr = d3d12device_->CreateCommittedResource(
+  HRESULT hr = d3d12device_->CreateCommittedResource(
       &CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_DEFAULT), D3D12_HEAP_FLAG_NONE,
       &CD3DX12_RESOURCE_DESC::Tex2D(DXGI_FORMAT_D32_FLOAT, config_.screen_width,
                                     config_.screen_height, 1, 0, 1, 0,
@@ -231,13 +414,9 @@ HRESULT DirectX12Device::CreateDepthStencilResources() {
     return hr;
   }
 
-  d3d12device_->CreateDepthStencilView(
-      depth_stencil_resource_.Get(), &depth_stencil_desc,
-      depth_stencil_view_heap_->GetCPUDescriptorHandleForHeapStart());
-
-  depth_stencil_descriptor_size_ =
-      d3d12device_->GetDescriptorHandleIncrementSize(
-          D3D12_DESCRIPTOR_HEAP_TYPE_DSV);
+  d3d12device_->CreateDepthStencilView(depth_stencil_resource_.Get(),
+                                       &depth_stencil_desc,
+                                       depth_stencil_view_->cpu_handle);
 
   return S_OK;
 }
@@ -277,18 +456,23 @@ HRESULT DirectX12Device::CreateCommandAllocatorsAndLists() {
     return E_FAIL;
   }
 
-  if (frame_resources_.empty()) {
-    frame_resources_.resize(frame_cout_);
+  if (frame_resources_.size() != GetFrameCount()) {
+    frame_resources_.clear();
+    frame_resources_.resize(GetFrameCount());
   }
 
   for (auto &frame : frame_resources_) {
     frame.command_allocator.Reset();
-    frame.fence_value = 0;
+    frame.pass_allocators.clear();
+    frame.constant_allocator.Clear();
+    frame.constant_pages.clear();
   }
 
-  default_copy_command_allocator_.Reset();
   default_graphics_command_list_.Reset();
-  default_copy_command_list_.Reset();
+  default_shadow_.Reset();
+  pass_command_lists_.clear();
+  pass_shadows_.clear();
+  recording_pass_count_ = 0;
 
   HRESULT hr = S_OK;
 
@@ -300,34 +484,15 @@ HRESULT DirectX12Device::CreateCommandAllocatorsAndLists() {
     }
   }
 
-  hr = d3d12device_->CreateCommandAllocator(
-      D3D12_COMMAND_LIST_TYPE_COPY,
-      IID_PPV_ARGS(&default_copy_command_allocator_));
-  if (FAILED(hr)) {
-    return hr;
-  }
-
   hr = d3d12device_->CreateCommandList(
       0, D3D12_COMMAND_LIST_TYPE_DIRECT,
-      frame_resources_[frame_index_].command_allocator.Get(), nullptr,
+      CurrentFrameResource().command_allocator.Get(), nullptr,
       IID_PPV_ARGS(&default_graphics_command_list_));
   if (FAILED(hr)) {
     return hr;
   }
 
-  hr = d3d12device_->CreateCommandList(
-      0, D3D12_COMMAND_LIST_TYPE_COPY, default_copy_command_allocator_.Get(),
-      nullptr, IID_PPV_ARGS(&default_copy_command_list_));
-  if (FAILED(hr)) {
-    return hr;
-  }
-
-  hr = default_graphics_command_list_->Close();
-  if (FAILED(hr)) {
-    return hr;
-  }
-
-  return default_copy_command_list_->Close();
+  return default_graphics_command_list_->Close();
 }
 
 HRESULT DirectX12Device::CreateFenceAndEvent() {
@@ -349,6 +514,163 @@ HRESULT DirectX12Device::CreateFenceAndEvent() {
   return S_OK;
 }
 
+HRESULT DirectX12Device::CreateUploadContext() {
+  if (!d3d12device_ || !default_copy_command_queue_) {
+    return E_FAIL;
+  }
+
+  auto upload_device = std::make_unique<ResourceLoader::D3D12UploadDevice>(
+      d3d12device_, default_copy_command_queue_);
+  if (!upload_device->Initialize()) {
+    return E_FAIL;
+  }
+  upload_fence_ = upload_device->GetFence();
+
+  upload_context_ = std::make_unique<ResourceLoader::UploadContext>(
+      std::move(upload_device));
+  if (!upload_context_->Initialize()) {
+    upload_context_.reset();
+    return E_OUTOFMEMORY;
+  }
+
+  return S_OK;
+}
+
+bool DirectX12Device::CreateDefaultBuffer(const void *source_data,
+                                          size_t buffer_size,
+                                          ResourceSharedPtr &default_buffer,
+                                          ResourceLoader::UploadToken *token) {
+  if (!d3d12device_ || !upload_context_ || source_data == nullptr ||
+      buffer_size == 0) {
+    return false;
+  }
+
+  // Buffers start in COMMON so the copy queue can promote them to COPY_DEST;
+  // afterwards they decay to COMMON and are promoted by the graphics queue.
+  if (FAILED(d3d12device_->CreateCommittedResource(
+          &CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_DEFAULT),
+          D3D12_HEAP_FLAG_NONE, &CD3DX12_RESOURCE_DESC::Buffer(buffer_size),
+          D3D12_RESOURCE_STATE_COMMON, nullptr,
+          IID_PPV_ARGS(&default_buffer)))) {
+    return false;
+  }
+
+  const auto upload_token = upload_context_->UploadBuffer(
+      default_buffer.Get(), 0, source_data, buffer_size);
+  if (upload_token == ResourceLoader::kInvalidUploadToken) {
+    default_buffer.Reset();
+    return false;
+  }
+
+  if (token) {
+    *token = upload_token;
+  }
+  return true;
+}
+
+void DirectX12Device::DeferRelease(
+    Microsoft::WRL::ComPtr<ID3D12Pageable> object) {
+  if (!object) {
+    return;
+  }
+  if (frame_resources_.empty()) {
+    // Nothing has been recorded that could still use it.
+    return;
+  }
+  // Frames retire in order, so once this slot's fence passes, every earlier
+  // frame that could have used the object has too.
+  CurrentFrameResource().deferred_releases.push_back(std::move(object));
+}
+
+bool DirectX12Device::AllocateFrameMemory(size_t size, size_t alignment,
+                                          LinearAllocation &allocation) {
+  if (!d3d12device_ || frame_resources_.empty() || size == 0) {
+    return false;
+  }
+
+  std::lock_guard<std::mutex> lock(frame_memory_mutex_);
+
+  auto &frame = CurrentFrameResource();
+  auto &allocator = frame.constant_allocator;
+  if (allocator.Allocate(size, alignment, allocation)) {
+    return true;
+  }
+  if (allocator.IsClosed()) {
+    return false;
+  }
+
+  // Out of room: add a page. Pages are kept across frames, so this only
+  // happens while the per-frame high-water mark is still growing.
+  const UINT64 page_size =
+      (std::max)(frame_constant_page_size_,
+                 (static_cast<UINT64>(size) + alignment - 1) /
+                     alignment * alignment);
+
+  ResourceSharedPtr page = nullptr;
+  if (FAILED(d3d12device_->CreateCommittedResource(
+          &CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD),
+          D3D12_HEAP_FLAG_NONE, &CD3DX12_RESOURCE_DESC::Buffer(page_size),
+          D3D12_RESOURCE_STATE_GENERIC_READ, nullptr,
+          IID_PPV_ARGS(&page)))) {
+    return false;
+  }
+
+  UINT8 *mapped_data = nullptr;
+  CD3DX12_RANGE read_range(0, 0);
+  if (FAILED(page->Map(0, &read_range,
+                       reinterpret_cast<void **>(&mapped_data)))) {
+    return false;
+  }
+
+  allocator.AddPage(mapped_data, page->GetGPUVirtualAddress(), page_size);
+  frame.constant_pages.push_back(page);
+
+  std::wstringstream stream;
+  stream << L"[DirectX12Device] Frame " << GetFrameIndex()
+         << L" transient memory grown to " << allocator.GetCapacity() / 1024
+         << L" KB.\n";
+  OutputDebugStringW(stream.str().c_str());
+
+  return allocator.Allocate(size, alignment, allocation);
+}
+
+bool DirectX12Device::AllocateFrameConstants(size_t size,
+                                             LinearAllocation &allocation) {
+  return AllocateFrameMemory(size, kConstantBufferAlignment, allocation);
+}
+
+bool DirectX12Device::WriteFrameConstants(
+    const void *data, size_t size, D3D12_GPU_VIRTUAL_ADDRESS &gpu_address) {
+  LinearAllocation allocation = {};
+  if (data == nullptr || !AllocateFrameConstants(size, allocation)) {
+    return false;
+  }
+
+  memcpy(allocation.cpu_address, data, size);
+  gpu_address = allocation.gpu_address;
+  return true;
+}
+
+bool DirectX12Device::SubmitPendingUploads() {
+  if (!upload_context_) {
+    return true;
+  }
+
+  const auto token = upload_context_->Flush();
+  if (token <= upload_token_waited_) {
+    return true;
+  }
+
+  // GPU-side wait: the graphics queue stalls only if the copies are still
+  // running, and the CPU never blocks here.
+  if (FAILED(default_graphics_command_queue_->Wait(upload_fence_.Get(),
+                                                   token))) {
+    return false;
+  }
+  upload_token_waited_ = token;
+  return true;
+}
+
 auto DirectX12Device::CreateRenderTarget(
     const RenderTargetDescriptor &descriptor) -> RenderTargetHandle {
   if (!d3d12device_) {
@@ -391,15 +713,12 @@ auto DirectX12Device::CreateRenderTarget(
   resource.current_state = D3D12_RESOURCE_STATE_GENERIC_READ;
 
   if (descriptor.create_srv) {
-    D3D12_DESCRIPTOR_HEAP_DESC srv_heap_desc = {};
-    srv_heap_desc.NumDescriptors = 1;
-    srv_heap_desc.Type = D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV;
-    srv_heap_desc.Flags = D3D12_DESCRIPTOR_HEAP_FLAG_SHADER_VISIBLE;
-
-    hr = d3d12device_->CreateDescriptorHeap(&srv_heap_desc,
-                                            IID_PPV_ARGS(&resource.srv));
-    if (FAILED(hr)) {
-      LogInitializationFailure(L"CreateRenderTarget::CreateSrvHeap", hr);
+    // The staging copy lets scenes put the target in tables of their own.
+    resource.srv = AllocateDescriptors(DescriptorHeapKind::kShaderVisible, 1);
+    resource.staging_srv = AllocateDescriptors(DescriptorHeapKind::kStaging, 1);
+    if (!resource.srv || !resource.staging_srv) {
+      LogInitializationFailure(L"CreateRenderTarget::AllocateSrv",
+                               E_OUTOFMEMORY);
       return kInvalidRenderTargetHandle;
     }
 
@@ -411,21 +730,18 @@ auto DirectX12Device::CreateRenderTarget(
     srv_desc.Texture2D.MostDetailedMip = 0;
     srv_desc.Texture2D.ResourceMinLODClamp = 0.0f;
 
-    d3d12device_->CreateShaderResourceView(
-        resource.texture.Get(), &srv_desc,
-        resource.srv->GetCPUDescriptorHandleForHeapStart());
+    d3d12device_->CreateShaderResourceView(resource.texture.Get(), &srv_desc,
+                                           resource.staging_srv->cpu_handle);
+    d3d12device_->CopyDescriptorsSimple(1, resource.srv->cpu_handle,
+                                        resource.staging_srv->cpu_handle,
+                                        D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
   }
 
   if (descriptor.create_rtv) {
-    D3D12_DESCRIPTOR_HEAP_DESC rtv_heap_desc = {};
-    rtv_heap_desc.NumDescriptors = 1;
-    rtv_heap_desc.Type = D3D12_DESCRIPTOR_HEAP_TYPE_RTV;
-    rtv_heap_desc.Flags = D3D12_DESCRIPTOR_HEAP_FLAG_NONE;
-
-    hr = d3d12device_->CreateDescriptorHeap(&rtv_heap_desc,
-                                            IID_PPV_ARGS(&resource.rtv));
-    if (FAILED(hr)) {
-      LogInitializationFailure(L"CreateRenderTarget::CreateRtvHeap", hr);
+    resource.rtv = AllocateDescriptors(DescriptorHeapKind::kRenderTarget, 1);
+    if (!resource.rtv) {
+      LogInitializationFailure(L"CreateRenderTarget::AllocateRtv",
+                               E_OUTOFMEMORY);
       return kInvalidRenderTargetHandle;
     }
 
@@ -435,9 +751,8 @@ auto DirectX12Device::CreateRenderTarget(
     rtv_desc.Texture2D.MipSlice = 0;
     rtv_desc.Texture2D.PlaneSlice = 0;
 
-    d3d12device_->CreateRenderTargetView(
-        resource.texture.Get(), &rtv_desc,
-        resource.rtv->GetCPUDescriptorHandleForHeapStart());
+    d3d12device_->CreateRenderTargetView(resource.texture.Get(), &rtv_desc,
+                                         resource.rtv->cpu_handle);
   }
 
   RenderTargetHandle handle = next_render_target_handle_++;
@@ -469,13 +784,21 @@ void DirectX12Device::DestroyRenderTarget(RenderTargetHandle handle) {
 }
 
 auto DirectX12Device::GetRenderTargetSrv(RenderTargetHandle handle) const
-    -> DescriptorHeapPtr {
-  auto resolved = ResolveRenderTargetHandle(handle);
-  auto it = user_render_targets_.find(resolved);
-  if (it == user_render_targets_.end()) {
-    return nullptr;
+    -> D3D12_GPU_DESCRIPTOR_HANDLE {
+  auto resource = GetRenderTargetResource(handle);
+  if (!resource || !resource->srv) {
+    return {};
   }
-  return it->second.srv;
+  return resource->srv->gpu_handle;
+}
+
+auto DirectX12Device::GetRenderTargetStagingView(
+    RenderTargetHandle handle) const -> D3D12_CPU_DESCRIPTOR_HANDLE {
+  auto resource = GetRenderTargetResource(handle);
+  if (!resource || !resource->staging_srv) {
+    return {};
+  }
+  return resource->staging_srv->cpu_handle;
 }
 
 auto DirectX12Device::GetRenderTargetTexture(RenderTargetHandle handle) const
@@ -568,20 +891,123 @@ bool DirectX12Device::ExecuteDefaultGraphicsCommandList() {
     return false;
   }
 
+  if (!SubmitPendingUploads()) {
+    return false;
+  }
+
   ID3D12CommandList *command_list[] = {default_graphics_command_list_.Get()};
-  default_graphics_command_queue_->ExecuteCommandLists(1, command_list);
+  return SubmitAndPresent(1, command_list);
+}
+
+bool DirectX12Device::BeginPassRecording(UINT pass_count) {
+  if (!d3d12device_ || frame_resources_.empty() || pass_count == 0) {
+    return false;
+  }
+
+  auto &frame = CurrentFrameResource();
+  while (frame.pass_allocators.size() < pass_count) {
+    CommandAllocatorPtr allocator = nullptr;
+    if (FAILED(d3d12device_->CreateCommandAllocator(
+            D3D12_COMMAND_LIST_TYPE_DIRECT, IID_PPV_ARGS(&allocator)))) {
+      return false;
+    }
+    frame.pass_allocators.push_back(allocator);
+  }
+
+  while (pass_command_lists_.size() < pass_count) {
+    GraphicsCommandListPtr command_list = nullptr;
+    const auto &allocator = frame.pass_allocators[pass_command_lists_.size()];
+    if (FAILED(d3d12device_->CreateCommandList(
+            0, D3D12_COMMAND_LIST_TYPE_DIRECT, allocator.Get(), nullptr,
+            IID_PPV_ARGS(&command_list))) ||
+        FAILED(command_list->Close())) {
+      return false;
+    }
+    pass_command_lists_.push_back(command_list);
+  }
+  pass_shadows_.resize(pass_command_lists_.size());
+
+  // This slot's previous frame has retired, so its allocators are free.
+  for (UINT pass = 0; pass < pass_count; ++pass) {
+    const auto &allocator = frame.pass_allocators[pass];
+    if (FAILED(allocator->Reset()) ||
+        FAILED(pass_command_lists_[pass]->Reset(allocator.Get(), nullptr))) {
+      return false;
+    }
+    pass_shadows_[pass].Reset();
+    BindDescriptorHeaps(pass_command_lists_[pass].Get(), pass_shadows_[pass]);
+  }
+
+  recording_pass_count_ = pass_count;
+  return true;
+}
+
+bool DirectX12Device::ExecutePassCommandLists() {
+  std::vector<ID3D12CommandList *> command_lists;
+  command_lists.reserve(recording_pass_count_);
+  for (UINT pass = 0; pass < recording_pass_count_; ++pass) {
+    if (FAILED(pass_command_lists_[pass]->Close())) {
+      return false;
+    }
+    command_lists.push_back(pass_command_lists_[pass].Get());
+  }
+  recording_pass_count_ = 0;
+
+  if (command_lists.empty()) {
+    return false;
+  }
+
+  if (!SubmitPendingUploads()) {
+    return false;
+  }
+
+  return SubmitAndPresent(static_cast<UINT>(command_lists.size()),
+                          command_lists.data());
+}
+
+DirectX12Device::ScopedPassRecording::ScopedPassRecording(
+    DirectX12Device &device, UINT pass)
+    : previous_(bound_command_list), previous_shadow_(bound_shadow) {
+  bound_command_list = device.pass_command_lists_.at(pass).Get();
+  bound_shadow = &device.pass_shadows_.at(pass);
+}
+
+DirectX12Device::ScopedPassRecording::~ScopedPassRecording() {
+  bound_command_list = previous_;
+  bound_shadow = previous_shadow_;
+}
+
+bool DirectX12Device::SubmitAndPresent(
+    UINT command_list_count, ID3D12CommandList *const *command_lists) {
+  default_graphics_command_queue_->ExecuteCommandLists(command_list_count,
+                                                       command_lists);
+
+  CommandRecorderStats frame_stats = default_shadow_.TakeStats();
+  for (auto &shadow : pass_shadows_) {
+    frame_stats.Add(shadow.TakeStats());
+  }
+  last_frame_command_stats_ = frame_stats;
 
   if (FAILED(swap_chain_->Present(1, 0))) {
     return false;
   }
 
-  if (!WaitForPreviousFrame()) {
+  if (!MoveToNextFrame()) {
     return false;
   }
 
   return true;
 }
 
+ID3D12GraphicsCommandList *DirectX12Device::RecordingList() const {
+  return bound_command_list ? bound_command_list
+                            : default_graphics_command_list_.Get();
+}
+
+CommandStateShadow *DirectX12Device::RecordingShadow() {
+  return bound_shadow ? bound_shadow : &default_shadow_;
+}
+
 bool DirectX12Device::ResetCommandList() {
   auto &frame = CurrentFrameResource();
   if (!frame.command_allocator) {
@@ -591,6 +1017,8 @@ bool DirectX12Device::ResetCommandList() {
           frame.command_allocator.Get(), nullptr))) {
     return false;
   }
+  default_shadow_.Reset();
+  BindDescriptorHeaps(default_graphics_command_list_.Get(), default_shadow_);
   return true;
 }
 
@@ -614,42 +1042,73 @@ bool DirectX12Device::ResetCommandAllocator() {
 
 void DirectX12Device::SetGraphicsRootSignature(
     const RootSignaturePtr &graphics_rootsignature) {
-  default_graphics_command_list_->SetGraphicsRootSignature(
-      graphics_rootsignature.Get());
+  if (RecordingShadow()->SetRootSignature(graphics_rootsignature.Get())) {
+    RecordingList()->SetGraphicsRootSignature(graphics_rootsignature.Get());
+  }
 }
 
 void DirectX12Device::SetPipelineStateObject(
     const PipelineStateObjectPtr &pso) {
-  default_graphics_command_list_->SetPipelineState(pso.Get());
-}
-
-void DirectX12Device::SetDescriptorHeaps(
-    UINT num_descriptors, ID3D12DescriptorHeap **descriptor_arr) {
-  default_graphics_command_list_->SetDescriptorHeaps(num_descriptors,
-                                                     descriptor_arr);
+  if (RecordingShadow()->SetPipelineState(pso.Get())) {
+    RecordingList()->SetPipelineState(pso.Get());
+  }
 }
 
 void DirectX12Device::SetGraphicsRootDescriptorTable(
     UINT RootParameterIndex, D3D12_GPU_DESCRIPTOR_HANDLE BaseDescriptor) {
-  default_graphics_command_list_->SetGraphicsRootDescriptorTable(
-      RootParameterIndex, BaseDescriptor);
+  if (RecordingShadow()->SetRootDescriptorTable(RootParameterIndex,
+                                                BaseDescriptor.ptr)) {
+    RecordingList()->SetGraphicsRootDescriptorTable(RootParameterIndex,
+                                                    BaseDescriptor);
+  }
 }
 
 void DirectX12Device::SetGraphicsRootConstantBufferView(
     UINT RootParameterIndex, D3D12_GPU_VIRTUAL_ADDRESS BufferLocation) {
-  default_graphics_command_list_->SetGraphicsRootConstantBufferView(
-      RootParameterIndex, BufferLocation);
+  if (RecordingShadow()->SetRootConstantBufferView(RootParameterIndex,
+                                                   BufferLocation)) {
+    RecordingList()->SetGraphicsRootConstantBufferView(RootParameterIndex,
+                                                       BufferLocation);
+  }
+}
+
+void DirectX12Device::SetGraphicsRootShaderResourceView(
+    UINT RootParameterIndex, D3D12_GPU_VIRTUAL_ADDRESS BufferLocation) {
+  if (RecordingShadow()->SetRootShaderResourceView(RootParameterIndex,
+                                                   BufferLocation)) {
+    RecordingList()->SetGraphicsRootShaderResourceView(RootParameterIndex,
+                                                       BufferLocation);
+  }
 }
 
 void DirectX12Device::BindVertexBuffer(UINT start_slot, UINT num_views,
                                        const VertexBufferView *vertex_buffer) {
-  default_graphics_command_list_->IASetVertexBuffers(start_slot, num_views,
-                                                     vertex_buffer);
+  ShadowVertexBuffer views[CommandStateShadow::kMaxVertexBuffers] = {};
+  if (vertex_buffer != nullptr) {
+    const UINT count =
+        (std::min)(num_views, CommandStateShadow::kMaxVertexBuffers);
+    for (UINT i = 0; i < count; ++i) {
+      views[i] = ToShadow(vertex_buffer[i]);
+    }
+  }
+
+  if (RecordingShadow()->SetVertexBuffers(
+          start_slot, num_views, vertex_buffer != nullptr ? views : nullptr)) {
+    RecordingList()->IASetVertexBuffers(start_slot, num_views, vertex_buffer);
+  }
 }
 
 void DirectX12Device::BindIndexBuffer(
     const IndexBufferView *index_buffer_view) {
-  default_graphics_command_list_->IASetIndexBuffer(index_buffer_view);
+  ShadowIndexBuffer view = {};
+  if (index_buffer_view != nullptr) {
+    view = ToShadow(*index_buffer_view);
+  }
+
+  if (RecordingShadow()->SetIndexBuffer(
+          index_buffer_view != nullptr ? &view : nullptr)) {
+    RecordingList()->IASetIndexBuffer(index_buffer_view);
+  }
 }
 
 void DirectX12Device::BeginDrawToOffScreen(RenderTargetHandle handle) {
@@ -658,32 +1117,29 @@ void DirectX12Device::BeginDrawToOffScreen(RenderTargetHandle handle) {
     return;
   }
 
-  default_graphics_command_list_->RSSetViewports(1, &viewport_.at(0));
-  default_graphics_command_list_->RSSetScissorRects(1, &scissor_rect_.at(0));
+  auto command_list = RecordingList();
+  command_list->RSSetViewports(1, &viewport_.at(0));
+  command_list->RSSetScissorRects(1, &scissor_rect_.at(0));
 
   if (resource->current_state != D3D12_RESOURCE_STATE_RENDER_TARGET) {
     auto barrier = CD3DX12_RESOURCE_BARRIER::Transition(
         resource->texture.Get(), resource->current_state,
         D3D12_RESOURCE_STATE_RENDER_TARGET);
-    default_graphics_command_list_->ResourceBarrier(1, &barrier);
+    command_list->ResourceBarrier(1, &barrier);
     resource->current_state = D3D12_RESOURCE_STATE_RENDER_TARGET;
   }
 
-  CD3DX12_CPU_DESCRIPTOR_HANDLE rtv_handle(
-      resource->rtv->GetCPUDescriptorHandleForHeapStart());
+  const D3D12_CPU_DESCRIPTOR_HANDLE rtv_handle = resource->rtv->cpu_handle;
+  const D3D12_CPU_DESCRIPTOR_HANDLE dsv_handle =
+      depth_stencil_view_->cpu_handle;
 
-  CD3DX12_CPU_DESCRIPTOR_HANDLE dsv_handle(
-      depth_stencil_view_heap_->GetCPUDescriptorHandleForHeapStart());
+  command_list->OMSetRenderTargets(1, &rtv_handle, FALSE, &dsv_handle);
 
-  default_graphics_command_list_->OMSetRenderTargets(1, &rtv_handle, FALSE,
-                                                     &dsv_handle);
-
-  default_graphics_command_list_->ClearRenderTargetView(
+  command_list->ClearRenderTargetView(
       rtv_handle, resource->descriptor.clear_color, 0, nullptr);
-  default_graphics_command_list_->ClearDepthStencilView(
-      dsv_handle, D3D12_CLEAR_FLAG_DEPTH, 1.0f, 0, 0, nullptr);
-  default_graphics_command_list_->IASetPrimitiveTopology(
-      D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+  command_list->ClearDepthStencilView(dsv_handle, D3D12_CLEAR_FLAG_DEPTH,
+                                      1.0f, 0, 0, nullptr);
+  command_list->IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
 }
 
 void DirectX12Device::EndDrawToOffScreen(RenderTargetHandle handle) {
@@ -696,43 +1152,48 @@ void DirectX12Device::EndDrawToOffScreen(RenderTargetHandle handle) {
     auto barrier = CD3DX12_RESOURCE_BARRIER::Transition(
         resource->texture.Get(), resource->current_state,
         D3D12_RESOURCE_STATE_GENERIC_READ);
-    default_graphics_command_list_->ResourceBarrier(1, &barrier);
+    RecordingList()->ResourceBarrier(1, &barrier);
     resource->current_state = D3D12_RESOURCE_STATE_GENERIC_READ;
   }
 }
 
 void DirectX12Device::BeginPopulateGraphicsCommandList() {
-  default_graphics_command_list_->RSSetViewports(1, &viewport_.at(0));
-  default_graphics_command_list_->RSSetScissorRects(1, &scissor_rect_.at(0));
-
-  default_graphics_command_list_->ResourceBarrier(
+  RecordingList()->ResourceBarrier(
       1, &CD3DX12_RESOURCE_BARRIER::Transition(
-             back_buffer_render_targets_[frame_index_].Get(),
+             back_buffer_render_targets_[back_buffer_index_].Get(),
              D3D12_RESOURCE_STATE_PRESENT, D3D12_RESOURCE_STATE_RENDER_TARGET));
 
-  CD3DX12_CPU_DESCRIPTOR_HANDLE rtv_handle(
-      render_target_view_heap_->GetCPUDescriptorHandleForHeapStart(),
-      frame_index_, render_target_descriptor_size_);
+  BindBackBuffer();
 
-  CD3DX12_CPU_DESCRIPTOR_HANDLE dsv_handle(
-      depth_stencil_view_heap_->GetCPUDescriptorHandleForHeapStart());
-
-  default_graphics_command_list_->OMSetRenderTargets(1, &rtv_handle, FALSE,
-                                                     &dsv_handle);
+  const D3D12_CPU_DESCRIPTOR_HANDLE rtv_handle =
+      back_buffer_rtvs_->GetCpuHandle(back_buffer_index_);
+  const D3D12_CPU_DESCRIPTOR_HANDLE dsv_handle =
+      depth_stencil_view_->cpu_handle;
 
   const float clear_color[] = {0.0f, 0.2f, 0.4f, 1.0f};
-  default_graphics_command_list_->ClearRenderTargetView(rtv_handle, clear_color,
-                                                        0, nullptr);
-  default_graphics_command_list_->ClearDepthStencilView(
-      dsv_handle, D3D12_CLEAR_FLAG_DEPTH, 1.0f, 0, 0, nullptr);
-  default_graphics_command_list_->IASetPrimitiveTopology(
-      D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+  RecordingList()->ClearRenderTargetView(rtv_handle, clear_color, 0, nullptr);
+  RecordingList()->ClearDepthStencilView(dsv_handle, D3D12_CLEAR_FLAG_DEPTH,
+                                         1.0f, 0, 0, nullptr);
+}
+
+void DirectX12Device::BindBackBuffer() {
+  auto command_list = RecordingList();
+  command_list->RSSetViewports(1, &viewport_.at(0));
+  command_list->RSSetScissorRects(1, &scissor_rect_.at(0));
+
+  const D3D12_CPU_DESCRIPTOR_HANDLE rtv_handle =
+      back_buffer_rtvs_->GetCpuHandle(back_buffer_index_);
+  const D3D12_CPU_DESCRIPTOR_HANDLE dsv_handle =
+      depth_stencil_view_->cpu_handle;
+
+  command_list->OMSetRenderTargets(1, &rtv_handle, FALSE, &dsv_handle);
+  command_list->IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
 }
 
 void DirectX12Device::EndPopulateGraphicsCommandList() {
-  default_graphics_command_list_->ResourceBarrier(
+  RecordingList()->ResourceBarrier(
       1, &CD3DX12_RESOURCE_BARRIER::Transition(
-             back_buffer_render_targets_[frame_index_].Get(),
+             back_buffer_render_targets_[back_buffer_index_].Get(),
              D3D12_RESOURCE_STATE_RENDER_TARGET, D3D12_RESOURCE_STATE_PRESENT));
 }
 
@@ -740,35 +1201,62 @@ void DirectX12Device::Draw(UINT IndexCountPerInstance, UINT InstanceCount,
                            UINT StartIndexLocation, INT BaseVertexLocation,
                            UINT StartInstanceLocation) {
 
-  default_graphics_command_list_->DrawIndexedInstanced(
+  RecordingList()->DrawIndexedInstanced(
       IndexCountPerInstance, InstanceCount, StartIndexLocation,
       BaseVertexLocation, StartInstanceLocation);
 }
 
-bool DirectX12Device::WaitForPreviousFrame() {
-
-  auto &current_frame = CurrentFrameResource();
+bool DirectX12Device::MoveToNextFrame() {
 
-  const UINT64 fence_to_wait = fence_value_;
+  const UINT64 frame_fence_value = fence_value_;
   if (FAILED(default_graphics_command_queue_->Signal(fence_.Get(),
-                                                     fence_to_wait))) {
+                                                     frame_fence_value))) {
     return false;
   }
-  current_frame.fence_value = fence_to_wait;
   ++fence_value_;
 
-  frame_index_ = swap_chain_->GetCurrentBackBufferIndex();
+  CurrentFrameResource().constant_allocator.Close(frame_fence_value);
+  {
+    // Whatever was released up to now can only be bound by this frame or
+    // earlier ones.
+    std::lock_guard<std::mutex> lock(descriptor_mutex_);
+    auto &deferred = CurrentFrameResource().deferred_descriptors;
+    deferred.insert(deferred.end(), released_descriptors_.begin(),
+                    released_descriptors_.end());
+    released_descriptors_.clear();
+  }
+
+  const UINT64 fence_to_wait = frame_ring_.Advance(frame_fence_value);
+  back_buffer_index_ = swap_chain_->GetCurrentBackBufferIndex();
 
-  auto &next_frame = CurrentFrameResource();
-  if (next_frame.fence_value != 0 &&
-      fence_->GetCompletedValue() < next_frame.fence_value) {
-    if (FAILED(fence_->SetEventOnCompletion(next_frame.fence_value,
-                                            fence_handle_))) {
+  if (fence_->GetCompletedValue() < fence_to_wait) {
+    if (FAILED(fence_->SetEventOnCompletion(fence_to_wait, fence_handle_))) {
       return false;
     }
     WaitForSingleObject(fence_handle_, INFINITE);
   }
 
+  // The GPU is done with everything recorded into this slot.
+  CurrentFrameResource().constant_allocator.Retire(
+      fence_->GetCompletedValue());
+  CurrentFrameResource().deferred_releases.clear();
+  {
+    std::lock_guard<std::mutex> lock(descriptor_mutex_);
+    auto &shader_visible = descriptor_heaps_[static_cast<size_t>(
+        DescriptorHeapKind::kShaderVisible)];
+    for (const auto &range : CurrentFrameResource().deferred_descriptors) {
+      shader_visible.allocator.Free(range.offset, range.count);
+    }
+    CurrentFrameResource().deferred_descriptors.clear();
+  }
+  transient_descriptors_.BeginFrame(GetFrameIndex());
+
+  // Let DXGI throttle us to the present queue as well, so frame_latency
+  // frames are queued rather than the driver default.
+  if (frame_latency_waitable_) {
+    WaitForSingleObjectEx(frame_latency_waitable_, 1000, TRUE);
+  }
+
   return true;
 }
 
@@ -810,22 +1298,36 @@ void DirectX12Device::GetVideoCardInfo(char *card_name, int &memory) {
 }
 
 void DirectX12Device::ResetDeviceState() {
-  for (auto &target : back_buffer_render_targets_) {
-    target.Reset();
-  }
+  back_buffer_render_targets_.clear();
   user_render_targets_.clear();
   default_offscreen_handle_ = kInvalidRenderTargetHandle;
   next_render_target_handle_ = 0;
 
-  render_target_view_heap_.Reset();
+  back_buffer_rtvs_.reset();
   depth_stencil_resource_.Reset();
-  depth_stencil_view_heap_.Reset();
+  depth_stencil_view_.reset();
+
+  upload_context_.reset();
+  upload_fence_.Reset();
+  pipeline_cache_.Clear();
+  upload_token_waited_ = 0;
 
   default_graphics_command_list_.Reset();
-  default_copy_command_list_.Reset();
-  default_copy_command_allocator_.Reset();
+  default_shadow_.Reset();
+  pass_command_lists_.clear();
+  pass_shadows_.clear();
+  recording_pass_count_ = 0;
   frame_resources_.clear();
 
+  {
+    // Every range handed out so far is dropped with the heaps.
+    std::lock_guard<std::mutex> lock(descriptor_mutex_);
+    for (auto &heap : descriptor_heaps_) {
+      heap = {};
+    }
+    released_descriptors_.clear();
+  }
+
   default_graphics_command_queue_.Reset();
   default_copy_command_queue_.Reset();
 
@@ -835,6 +1337,10 @@ void DirectX12Device::ResetDeviceState() {
   }
   fence_.Reset();
 
+  if (frame_latency_waitable_) {
+    CloseHandle(frame_latency_waitable_);
+    frame_latency_waitable_ = nullptr;
+  }
   swap_chain_.Reset();
   dxgi_resources_.reset();
   d3d12device_.Reset();
@@ -846,7 +1352,8 @@ void DirectX12Device::ResetDeviceState() {
   world_matrix_ = DirectX::XMMatrixIdentity();
   ortho_matrix_ = DirectX::XMMatrixIdentity();
 
-  frame_index_ = 0;
+  frame_ring_.Reset(config_.frame_latency);
+  back_buffer_index_ = 0;
   fence_value_ = 1;
 }
 
@@ -859,10 +1366,10 @@ void DirectX12Device::LogInitializationFailure(const wchar_t *stage,
 }
 
 DirectX12Device::FrameResource &DirectX12Device::CurrentFrameResource() {
-  return frame_resources_.at(frame_index_);
+  return frame_resources_.at(frame_ring_.GetCurrentSlot());
 }
 
 const DirectX12Device::FrameResource &
 DirectX12Device::CurrentFrameResource() const {
-  return frame_resources_.at(frame_index_);
+  return frame_resources_.at(frame_ring_.GetCurrentSlot());
 }
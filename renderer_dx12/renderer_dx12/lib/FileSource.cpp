@@ -0,0 +1,195 @@
+#include "stdafx.h"
+
+#include "FileSource.h"
+
+#include <fstream>
+
+#if defined(_WIN32)
+#include "MappedFile.h"
+#else
+#include <cstdio>
+#include <fcntl.h>
+#include <filesystem>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace ResourceLoader {
+
+namespace {
+
+class DiskFileSource : public FileSource {
+public:
+  auto ReadFile(const std::wstring &path, FileData &data) -> bool override {
+    return MapFile(path, data);
+  }
+
+  auto GetStamp(const std::wstring &path, FileStamp &stamp) -> bool override {
+    return GetFileStamp(path, stamp);
+  }
+
+  auto WriteFile(const std::wstring &path, const std::vector<uint8_t> &data)
+      -> bool override {
+    return WriteFileAtomically(path, data);
+  }
+};
+
+#if !defined(_WIN32)
+auto ToNativePath(const std::wstring &path) -> std::string {
+  return std::filesystem::path(path).string();
+}
+
+// Unmaps the view when the last FileData referring to it goes away.
+class PosixMapping {
+public:
+  PosixMapping(void *data, size_t size) : data_(data), size_(size) {}
+
+  PosixMapping(const PosixMapping &rhs) = delete;
+
+  auto operator=(const PosixMapping &rhs) -> PosixMapping & = delete;
+
+  ~PosixMapping() { munmap(data_, size_); }
+
+  auto GetData() const -> const uint8_t * {
+    return static_cast<const uint8_t *>(data_);
+  }
+
+private:
+  void *data_ = nullptr;
+
+  size_t size_ = 0;
+};
+#endif
+
+} // namespace
+
+auto GetDiskFileSource() -> FileSource & {
+  static DiskFileSource source;
+  return source;
+}
+
+#if defined(_WIN32)
+
+auto MapFile(const std::wstring &file_path, FileData &data) -> bool {
+  data.Reset();
+  auto mapped = std::make_shared<MappedFile>();
+  if (!mapped->Open(file_path)) {
+    return false;
+  }
+  const uint8_t *view = mapped->GetData();
+  const size_t size = mapped->GetSize();
+  data = FileData(std::move(mapped), view, size);
+  return true;
+}
+
+auto GetFileStamp(const std::wstring &file_path, FileStamp &stamp) -> bool {
+  WIN32_FILE_ATTRIBUTE_DATA attributes = {};
+  if (!GetFileAttributesExW(file_path.c_str(), GetFileExInfoStandard,
+                            &attributes)) {
+    return false;
+  }
+
+  stamp.size = (static_cast<uint64_t>(attributes.nFileSizeHigh) << 32) |
+               attributes.nFileSizeLow;
+  stamp.last_write_time =
+      (static_cast<uint64_t>(attributes.ftLastWriteTime.dwHighDateTime) << 32) |
+      attributes.ftLastWriteTime.dwLowDateTime;
+  return true;
+}
+
+auto WriteFileAtomically(const std::wstring &file_path,
+                         const std::vector<uint8_t> &data) -> bool {
+  const std::wstring temp_path = file_path + L".tmp";
+  {
+    std::ofstream fout(temp_path, std::ios::binary | std::ios::trunc);
+    if (!fout) {
+      return false;
+    }
+    fout.write(reinterpret_cast<const char *>(data.data()),
+               static_cast<std::streamsize>(data.size()));
+    if (!fout) {
+      fout.close();
+      DeleteFileW(temp_path.c_str());
+      return false;
+    }
+  }
+
+  if (!MoveFileExW(temp_path.c_str(), file_path.c_str(),
+                   MOVEFILE_REPLACE_EXISTING)) {
+    DeleteFileW(temp_path.c_str());
+    return false;
+  }
+  return true;
+}
+
+#else
+
+auto MapFile(const std::wstring &file_path, FileData &data) -> bool {
+  data.Reset();
+  const int file = open(ToNativePath(file_path).c_str(), O_RDONLY);
+  if (file < 0) {
+    return false;
+  }
+
+  struct stat status = {};
+  if (fstat(file, &status) != 0 || status.st_size <= 0) {
+    close(file);
+    return false;
+  }
+
+  const auto size = static_cast<size_t>(status.st_size);
+  void *view = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, file, 0);
+  // The mapping keeps the file alive on its own.
+  close(file);
+  if (view == MAP_FAILED) {
+    return false;
+  }
+
+  auto mapping = std::make_shared<PosixMapping>(view, size);
+  const uint8_t *bytes = mapping->GetData();
+  data = FileData(std::move(mapping), bytes, size);
+  return true;
+}
+
+auto GetFileStamp(const std::wstring &file_path, FileStamp &stamp) -> bool {
+  struct stat status = {};
+  if (stat(ToNativePath(file_path).c_str(), &status) != 0) {
+    return false;
+  }
+
+  stamp.size = static_cast<uint64_t>(status.st_size);
+  stamp.last_write_time =
+      static_cast<uint64_t>(status.st_mtim.tv_sec) * 1000000000ull +
+      static_cast<uint64_t>(status.st_mtim.tv_nsec);
+  return true;
+}
+
+auto WriteFileAtomically(const std::wstring &file_path,
+                         const std::vector<uint8_t> &data) -> bool {
+  const std::string path = ToNativePath(file_path);
+  const std::string temp_path = path + ".tmp";
+  {
+    std::ofstream fout(temp_path, std::ios::binary | std::ios::trunc);
+    if (!fout) {
+      return false;
+    }
+    fout.write(reinterpret_cast<const char *>(data.data()),
+               static_cast<std::streamsize>(data.size()));
+    if (!fout) {
+      fout.close();
+      std::remove(temp_path.c_str());
+      return false;
+    }
+  }
+
+  if (std::rename(temp_path.c_str(), path.c_str()) != 0) {
+    std::remove(temp_path.c_str());
+    return false;
+  }
+  return true;
+}
+
+#endif
+
+} // namespace ResourceLoader
@@ -0,0 +1,30 @@
+#include "stdafx.h"
+
+#include "FrameRing.h"
+
+#include <algorithm>
+
+void FrameRing::Reset(uint32_t frame_count) {
+  frame_count = (std::max)(kMinFrameLatency,
+                           (std::min)(frame_count, kMaxFrameLatency));
+  slot_fence_values_.assign(frame_count, 0);
+  current_slot_ = 0;
+}
+
+auto FrameRing::GetSlotFenceValue(uint32_t slot) const -> uint64_t {
+  if (slot >= slot_fence_values_.size()) {
+    return 0;
+  }
+  return slot_fence_values_[slot];
+}
+
+auto FrameRing::Advance(uint64_t fence_value) -> uint64_t {
+  slot_fence_values_[current_slot_] = fence_value;
+  current_slot_ = (current_slot_ + 1) % GetFrameCount();
+  return slot_fence_values_[current_slot_];
+}
+
+auto FrameRing::IsSlotReusable(uint32_t slot,
+                               uint64_t completed_fence_value) const -> bool {
+  return GetSlotFenceValue(slot) <= completed_fence_value;
+}
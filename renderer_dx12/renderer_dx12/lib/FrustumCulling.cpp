@@ -0,0 +1,472 @@
+#include "stdafx.h"
+
+#include "FrustumCulling.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstring>
+
+#include "JobSystem.h"
+
+// The SIMD paths are compiled on every x64 build. SSE2 is part of x64; AVX
+// is chosen at run time, so the binary still runs on CPUs without it.
+#if defined(_M_X64) || defined(_M_AMD64) || defined(__x86_64__)
+#define FRUSTUM_CULLING_USE_SIMD 1
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#define FRUSTUM_CULLING_AVX_TARGET
+#else
+#include <cpuid.h>
+#define FRUSTUM_CULLING_AVX_TARGET __attribute__((target("avx")))
+#endif
+#else
+#define FRUSTUM_CULLING_USE_SIMD 0
+#endif
+
+namespace {
+
+constexpr size_t kLaneCount = CullingBounds::kCullingLaneCount;
+
+constexpr size_t kPlaneCount = 6;
+
+// Bound sets smaller than this are culled on the calling thread.
+constexpr size_t kParallelCullThreshold = 16384;
+
+auto RoundUpToLanes(size_t count) -> size_t {
+  return (count + kLaneCount - 1) / kLaneCount * kLaneCount;
+}
+
+void NormalizePlane(float plane[4]) {
+  const float length = std::sqrt(plane[0] * plane[0] + plane[1] * plane[1] +
+                                 plane[2] * plane[2]);
+  if (length <= 0.0f) {
+    return;
+  }
+  for (int i = 0; i < 4; ++i) {
+    plane[i] /= length;
+  }
+}
+
+// Signed distance from the plane to the center, and the extent of the
+// tighter of the two volumes along the plane normal.
+auto IsOutsidePlane(const float plane[4], float center_x, float center_y,
+                    float center_z, float extent_x, float extent_y,
+                    float extent_z, float radius) -> bool {
+  const float distance = plane[0] * center_x + plane[1] * center_y +
+                         plane[2] * center_z + plane[3];
+  const float box_radius = std::fabs(plane[0]) * extent_x +
+                           std::fabs(plane[1]) * extent_y +
+                           std::fabs(plane[2]) * extent_z;
+  return distance < -std::min(radius, box_radius);
+}
+
+auto CullScalar(const FrustumPlanes &frustum, const CullingBounds &bounds,
+                size_t begin, size_t end, uint8_t *visible) -> size_t {
+  const float *center_x = bounds.GetCenterX();
+  const float *center_y = bounds.GetCenterY();
+  const float *center_z = bounds.GetCenterZ();
+  const float *extent_x = bounds.GetExtentX();
+  const float *extent_y = bounds.GetExtentY();
+  const float *extent_z = bounds.GetExtentZ();
+  const float *radius = bounds.GetRadius();
+
+  size_t visible_count = 0;
+  for (size_t i = begin; i < end; ++i) {
+    bool outside = false;
+    for (size_t plane = 0; plane < kPlaneCount && !outside; ++plane) {
+      outside = IsOutsidePlane(frustum.planes[plane], center_x[i], center_y[i],
+                               center_z[i], extent_x[i], extent_y[i],
+                               extent_z[i], radius[i]);
+    }
+    visible[i] = outside ? 0 : 1;
+    visible_count += outside ? 0 : 1;
+  }
+  return visible_count;
+}
+
+#if FRUSTUM_CULLING_USE_SIMD
+
+auto QueryAvxSupport() -> bool {
+  unsigned int registers[4] = {};
+#if defined(_MSC_VER)
+  int info[4] = {};
+  __cpuid(info, 1);
+  std::memcpy(registers, info, sizeof(registers));
+#else
+  if (!__get_cpuid(1, &registers[0], &registers[1], &registers[2],
+                   &registers[3])) {
+    return false;
+  }
+#endif
+  const bool has_avx = (registers[2] & (1u << 28)) != 0;
+  const bool has_osxsave = (registers[2] & (1u << 27)) != 0;
+  if (!has_avx || !has_osxsave) {
+    return false;
+  }
+
+  // The OS must save the YMM registers across context switches.
+#if defined(_MSC_VER)
+  const unsigned long long enabled_state = _xgetbv(0);
+#else
+  unsigned int eax = 0;
+  unsigned int edx = 0;
+  __asm__ volatile("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+  const unsigned long long enabled_state =
+      (static_cast<unsigned long long>(edx) << 32) | eax;
+#endif
+  return (enabled_state & 0x6) == 0x6;
+}
+
+auto CullSse(const FrustumPlanes &frustum, const CullingBounds &bounds,
+             size_t begin, size_t end, uint8_t *visible) -> size_t {
+  constexpr size_t kSseLaneCount = 4;
+  const float *center_x = bounds.GetCenterX();
+  const float *center_y = bounds.GetCenterY();
+  const float *center_z = bounds.GetCenterZ();
+  const float *extent_x = bounds.GetExtentX();
+  const float *extent_y = bounds.GetExtentY();
+  const float *extent_z = bounds.GetExtentZ();
+  const float *radius = bounds.GetRadius();
+
+  __m128 plane_x[kPlaneCount];
+  __m128 plane_y[kPlaneCount];
+  __m128 plane_z[kPlaneCount];
+  __m128 plane_w[kPlaneCount];
+  __m128 abs_x[kPlaneCount];
+  __m128 abs_y[kPlaneCount];
+  __m128 abs_z[kPlaneCount];
+  for (size_t plane = 0; plane < kPlaneCount; ++plane) {
+    const float *p = frustum.planes[plane];
+    plane_x[plane] = _mm_set1_ps(p[0]);
+    plane_y[plane] = _mm_set1_ps(p[1]);
+    plane_z[plane] = _mm_set1_ps(p[2]);
+    plane_w[plane] = _mm_set1_ps(p[3]);
+    abs_x[plane] = _mm_set1_ps(std::fabs(p[0]));
+    abs_y[plane] = _mm_set1_ps(std::fabs(p[1]));
+    abs_z[plane] = _mm_set1_ps(std::fabs(p[2]));
+  }
+  const __m128 zero = _mm_setzero_ps();
+
+  size_t visible_count = 0;
+  for (size_t i = begin; i < end; i += kSseLaneCount) {
+    const __m128 cx = _mm_loadu_ps(center_x + i);
+    const __m128 cy = _mm_loadu_ps(center_y + i);
+    const __m128 cz = _mm_loadu_ps(center_z + i);
+    const __m128 ex = _mm_loadu_ps(extent_x + i);
+    const __m128 ey = _mm_loadu_ps(extent_y + i);
+    const __m128 ez = _mm_loadu_ps(extent_z + i);
+    const __m128 r = _mm_loadu_ps(radius + i);
+
+    __m128 outside = zero;
+    for (size_t plane = 0; plane < kPlaneCount; ++plane) {
+      const __m128 distance = _mm_add_ps(
+          _mm_add_ps(_mm_mul_ps(plane_x[plane], cx),
+                     _mm_mul_ps(plane_y[plane], cy)),
+          _mm_add_ps(_mm_mul_ps(plane_z[plane], cz), plane_w[plane]));
+      const __m128 box_radius =
+          _mm_add_ps(_mm_add_ps(_mm_mul_ps(abs_x[plane], ex),
+                                _mm_mul_ps(abs_y[plane], ey)),
+                     _mm_mul_ps(abs_z[plane], ez));
+      const __m128 reach = _mm_min_ps(r, box_radius);
+      outside = _mm_or_ps(outside,
+                          _mm_cmplt_ps(_mm_add_ps(distance, reach), zero));
+    }
+
+    const unsigned int visible_mask =
+        ~static_cast<unsigned int>(_mm_movemask_ps(outside)) & 0xF;
+    const size_t lanes = std::min(kSseLaneCount, end - i);
+    for (size_t lane = 0; lane < lanes; ++lane) {
+      visible[i + lane] = static_cast<uint8_t>((visible_mask >> lane) & 1);
+    }
+    const unsigned int counted = visible_mask & ((1u << lanes) - 1);
+    for (unsigned int bits = counted; bits != 0; bits &= bits - 1) {
+      ++visible_count;
+    }
+  }
+  return visible_count;
+}
+
+FRUSTUM_CULLING_AVX_TARGET
+auto CullAvx(const FrustumPlanes &frustum, const CullingBounds &bounds,
+             size_t begin, size_t end, uint8_t *visible) -> size_t {
+  const float *center_x = bounds.GetCenterX();
+  const float *center_y = bounds.GetCenterY();
+  const float *center_z = bounds.GetCenterZ();
+  const float *extent_x = bounds.GetExtentX();
+  const float *extent_y = bounds.GetExtentY();
+  const float *extent_z = bounds.GetExtentZ();
+  const float *radius = bounds.GetRadius();
+
+  __m256 plane_x[kPlaneCount];
+  __m256 plane_y[kPlaneCount];
+  __m256 plane_z[kPlaneCount];
+  __m256 plane_w[kPlaneCount];
+  __m256 abs_x[kPlaneCount];
+  __m256 abs_y[kPlaneCount];
+  __m256 abs_z[kPlaneCount];
+  for (size_t plane = 0; plane < kPlaneCount; ++plane) {
+    const float *p = frustum.planes[plane];
+    plane_x[plane] = _mm256_set1_ps(p[0]);
+    plane_y[plane] = _mm256_set1_ps(p[1]);
+    plane_z[plane] = _mm256_set1_ps(p[2]);
+    plane_w[plane] = _mm256_set1_ps(p[3]);
+    abs_x[plane] = _mm256_set1_ps(std::fabs(p[0]));
+    abs_y[plane] = _mm256_set1_ps(std::fabs(p[1]));
+    abs_z[plane] = _mm256_set1_ps(std::fabs(p[2]));
+  }
+  const __m256 zero = _mm256_setzero_ps();
+
+  size_t visible_count = 0;
+  for (size_t i = begin; i < end; i += kLaneCount) {
+    // The streams are padded, so full loads are always in bounds.
+    const __m256 cx = _mm256_loadu_ps(center_x + i);
+    const __m256 cy = _mm256_loadu_ps(center_y + i);
+    const __m256 cz = _mm256_loadu_ps(center_z + i);
+    const __m256 ex = _mm256_loadu_ps(extent_x + i);
+    const __m256 ey = _mm256_loadu_ps(extent_y + i);
+    const __m256 ez = _mm256_loadu_ps(extent_z + i);
+    const __m256 r = _mm256_loadu_ps(radius + i);
+
+    __m256 outside = zero;
+    for (size_t plane = 0; plane < kPlaneCount; ++plane) {
+      const __m256 distance = _mm256_add_ps(
+          _mm256_add_ps(_mm256_mul_ps(plane_x[plane], cx),
+                        _mm256_mul_ps(plane_y[plane], cy)),
+          _mm256_add_ps(_mm256_mul_ps(plane_z[plane], cz), plane_w[plane]));
+      const __m256 box_radius = _mm256_add_ps(
+          _mm256_add_ps(_mm256_mul_ps(abs_x[plane], ex),
+                        _mm256_mul_ps(abs_y[plane], ey)),
+          _mm256_mul_ps(abs_z[plane], ez));
+      const __m256 reach = _mm256_min_ps(r, box_radius);
+      outside = _mm256_or_ps(
+          outside, _mm256_cmp_ps(_mm256_add_ps(distance, reach), zero,
+                                 _CMP_LT_OQ));
+    }
+
+    const unsigned int visible_mask =
+        ~static_cast<unsigned int>(_mm256_movemask_ps(outside)) & 0xFF;
+    const size_t lanes = std::min(kLaneCount, end - i);
+    for (size_t lane = 0; lane < lanes; ++lane) {
+      visible[i + lane] = static_cast<uint8_t>((visible_mask >> lane) & 1);
+    }
+    const unsigned int counted =
+        lanes == kLaneCount ? visible_mask
+                            : visible_mask & ((1u << lanes) - 1);
+    for (unsigned int bits = counted; bits != 0; bits &= bits - 1) {
+      ++visible_count;
+    }
+  }
+  return visible_count;
+}
+
+#endif
+
+} // namespace
+
+auto ComputeBoundingVolume(const void *vertices, size_t stride, size_t count)
+    -> BoundingVolume {
+  BoundingVolume bounds;
+  if (vertices == nullptr || count == 0 || stride < sizeof(float) * 3) {
+    return bounds;
+  }
+
+  const auto *bytes = static_cast<const uint8_t *>(vertices);
+  auto position = [bytes, stride](size_t index, float out[3]) {
+    std::memcpy(out, bytes + index * stride, sizeof(float) * 3);
+  };
+
+  float minimum[3];
+  float maximum[3];
+  position(0, minimum);
+  position(0, maximum);
+  for (size_t i = 1; i < count; ++i) {
+    float p[3];
+    position(i, p);
+    for (int axis = 0; axis < 3; ++axis) {
+      minimum[axis] = std::min(minimum[axis], p[axis]);
+      maximum[axis] = std::max(maximum[axis], p[axis]);
+    }
+  }
+
+  for (int axis = 0; axis < 3; ++axis) {
+    bounds.center[axis] = (minimum[axis] + maximum[axis]) * 0.5f;
+    bounds.extents[axis] = (maximum[axis] - minimum[axis]) * 0.5f;
+  }
+
+  float radius_squared = 0.0f;
+  for (size_t i = 0; i < count; ++i) {
+    float p[3];
+    position(i, p);
+    const float dx = p[0] - bounds.center[0];
+    const float dy = p[1] - bounds.center[1];
+    const float dz = p[2] - bounds.center[2];
+    radius_squared = std::max(radius_squared, dx * dx + dy * dy + dz * dz);
+  }
+  bounds.radius = std::sqrt(radius_squared);
+  return bounds;
+}
+
+auto TransformBoundingVolume(const BoundingVolume &local, const float world[16])
+    -> BoundingVolume {
+  BoundingVolume result;
+  float largest_scale_squared = 0.0f;
+  for (int column = 0; column < 3; ++column) {
+    result.center[column] = world[12 + column];
+    result.extents[column] = 0.0f;
+    for (int row = 0; row < 3; ++row) {
+      const float m = world[row * 4 + column];
+      result.center[column] += local.center[row] * m;
+      result.extents[column] += local.extents[row] * std::fabs(m);
+    }
+  }
+  for (int row = 0; row < 3; ++row) {
+    const float *axis = world + row * 4;
+    largest_scale_squared =
+        std::max(largest_scale_squared,
+                 axis[0] * axis[0] + axis[1] * axis[1] + axis[2] * axis[2]);
+  }
+  result.radius = local.radius * std::sqrt(largest_scale_squared);
+  return result;
+}
+
+void ExtractFrustumPlanes(const float view_projection[16],
+                          FrustumPlanes &frustum) {
+  // Clip coordinates are v * M, so each one is a dot product with a column.
+  auto column = [view_projection](int index, int row) {
+    return view_projection[row * 4 + index];
+  };
+
+  for (int row = 0; row < 4; ++row) {
+    const float x = column(0, row);
+    const float y = column(1, row);
+    const float z = column(2, row);
+    const float w = column(3, row);
+    frustum.planes[0][row] = w + x; // left:   -w <= x
+    frustum.planes[1][row] = w - x; // right:   x <= w
+    frustum.planes[2][row] = w + y; // bottom: -w <= y
+    frustum.planes[3][row] = w - y; // top:     y <= w
+    frustum.planes[4][row] = z;     // near:    0 <= z
+    frustum.planes[5][row] = w - z; // far:     z <= w
+  }
+
+  for (auto &plane : frustum.planes) {
+    NormalizePlane(plane);
+  }
+}
+
+auto IsVisible(const FrustumPlanes &frustum, const BoundingVolume &bounds)
+    -> bool {
+  for (const auto &plane : frustum.planes) {
+    if (IsOutsidePlane(plane, bounds.center[0], bounds.center[1],
+                       bounds.center[2], bounds.extents[0], bounds.extents[1],
+                       bounds.extents[2], bounds.radius)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+void CullingBounds::Clear() {
+  center_x_.clear();
+  center_y_.clear();
+  center_z_.clear();
+  extent_x_.clear();
+  extent_y_.clear();
+  extent_z_.clear();
+  radius_.clear();
+  count_ = 0;
+}
+
+void CullingBounds::Reserve(size_t count) {
+  const size_t padded = RoundUpToLanes(count);
+  for (auto *stream : {&center_x_, &center_y_, &center_z_, &extent_x_,
+                       &extent_y_, &extent_z_, &radius_}) {
+    stream->reserve(padded);
+  }
+}
+
+auto CullingBounds::Add(const BoundingVolume &bounds) -> uint32_t {
+  const uint32_t index = static_cast<uint32_t>(count_);
+  Pad(count_ + 1);
+  Set(index, bounds);
+  return index;
+}
+
+void CullingBounds::Set(uint32_t index, const BoundingVolume &bounds) {
+  if (index >= count_) {
+    return;
+  }
+  center_x_[index] = bounds.center[0];
+  center_y_[index] = bounds.center[1];
+  center_z_[index] = bounds.center[2];
+  extent_x_[index] = bounds.extents[0];
+  extent_y_[index] = bounds.extents[1];
+  extent_z_[index] = bounds.extents[2];
+  radius_[index] = bounds.radius;
+}
+
+void CullingBounds::Pad(size_t count) {
+  count_ = count;
+  const size_t padded = RoundUpToLanes(count);
+  if (padded == center_x_.size()) {
+    return;
+  }
+  for (auto *stream : {&center_x_, &center_y_, &center_z_, &extent_x_,
+                       &extent_y_, &extent_z_, &radius_}) {
+    stream->resize(padded, 0.0f);
+  }
+}
+
+auto IsAvxCullingSupported() -> bool {
+#if FRUSTUM_CULLING_USE_SIMD
+  static const bool supported = QueryAvxSupport();
+  return supported;
+#else
+  return false;
+#endif
+}
+
+auto CullBounds(const FrustumPlanes &frustum, const CullingBounds &bounds,
+                size_t begin, size_t end, uint8_t *visible, CullingPath path)
+    -> size_t {
+  end = std::min(end, bounds.GetCount());
+  if (visible == nullptr || begin >= end) {
+    return 0;
+  }
+
+#if FRUSTUM_CULLING_USE_SIMD
+  if (path != CullingPath::kScalar && begin % kLaneCount == 0) {
+    if (path != CullingPath::kSse && IsAvxCullingSupported()) {
+      return CullAvx(frustum, bounds, begin, end, visible);
+    }
+    return CullSse(frustum, bounds, begin, end, visible);
+  }
+#else
+  (void)path;
+#endif
+  return CullScalar(frustum, bounds, begin, end, visible);
+}
+
+auto CullBoundsParallel(JobSystem &job_system, const FrustumPlanes &frustum,
+                        const CullingBounds &bounds,
+                        std::vector<uint8_t> &visible, CullingPath path)
+    -> size_t {
+  const size_t count = bounds.GetCount();
+  visible.resize(count);
+  if (count < kParallelCullThreshold) {
+    return CullBounds(frustum, bounds, 0, count, visible.data(), path);
+  }
+
+  // Ranges are split on lane groups so every chunk can take the AVX path.
+  std::atomic<size_t> visible_count{0};
+  const size_t lane_groups = RoundUpToLanes(count) / kLaneCount;
+  job_system.ParallelFor(lane_groups, 0, [&](size_t begin, size_t end) {
+    visible_count.fetch_add(
+        CullBounds(frustum, bounds, begin * kLaneCount,
+                   std::min(count, end * kLaneCount), visible.data(), path),
+        std::memory_order_relaxed);
+  });
+  return visible_count.load();
+}
@@ -2,12 +2,23 @@
 
 #include "Graphics.h"
 
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <iterator>
+#include <sstream>
+#include <string>
+
+#include "AssetRegistry.h"
+#include "AssetStreamer.h"
 #include "BumpMappingScene.h"
 #include "CPUUsageTracker.h"
 #include "Camera.h"
 #include "DirectX12Device.h"
 #include "Fps.h"
 #include "Input.h"
+#include "InstancingStressScene.h"
+#include "JobSystem.h"
 #include "LightManager.h"
 #include "PBRModel.h"
 #include "SpecularMappingScene.h"
@@ -17,6 +28,111 @@
 #include "Model.h"
 #include "Text.h"
 
+namespace {
+
+const DirectX::XMFLOAT3 kModelPosition(-6.0f, 1.5f, -6.0f);
+
+const DirectX::XMFLOAT3 kPbrModelPosition(6.0f, 1.5f, -6.0f);
+
+// Local lights on two rings around both models; every fourth is a spot
+// shining down.
+constexpr size_t kLocalLightCount = 64;
+constexpr size_t kSpotLightStride = 4;
+const DirectX::XMFLOAT3 kLocalLightCenter(0.0f, 2.5f, -6.0f);
+constexpr float kInnerRingRadius = 4.0f;
+constexpr float kOuterRingRadius = 9.0f;
+constexpr float kPointLightRange = 4.0f;
+constexpr float kSpotLightRange = 8.0f;
+constexpr float kLocalLightIntensity = 1.5f;
+
+const ResourceLoader::ShaderCompileDesc kLightClusteredPixelShader = {
+    L"shader/light.hlsl", "LightClusteredPixelShader", "ps_5_0"};
+const ResourceLoader::ShaderCompileDesc kPbrClusteredPixelShader = {
+    L"shader/pbr.hlsl", "PbrClusteredPixelShader", "ps_5_0"};
+
+// Placement of the model and the PBR model, not transposed.
+auto GetModelWorld(const DirectX::XMFLOAT3 &position, float rotation)
+    -> DirectX::XMMATRIX {
+  return DirectX::XMMatrixRotationY(rotation) *
+         DirectX::XMMatrixTranslationFromVector(
+             DirectX::XMLoadFloat3(&position));
+}
+
+auto GetViewDepth(const DirectX::XMFLOAT3 &position,
+                  const DirectX::XMMATRIX &view_matrix) -> float {
+  DirectX::XMVECTOR view_position = DirectX::XMVector3TransformCoord(
+      DirectX::XMLoadFloat3(&position), view_matrix);
+  return DirectX::XMVectorGetZ(view_position);
+}
+
+// Root shader resource views may not be null while a shader can read them,
+// so an empty list still gets one zeroed element.
+template <typename T>
+auto WriteFrameBuffer(DirectX12Device &device, const std::vector<T> &data,
+                      D3D12_GPU_VIRTUAL_ADDRESS &gpu_address) -> bool {
+  const size_t size = sizeof(T) * (std::max)(data.size(), size_t{1});
+  LinearAllocation allocation = {};
+  if (!device.AllocateFrameMemory(size, alignof(T), allocation)) {
+    return false;
+  }
+  if (data.empty()) {
+    std::memset(allocation.cpu_address, 0, size);
+  } else {
+    std::memcpy(allocation.cpu_address, data.data(), size);
+  }
+  gpu_address = allocation.gpu_address;
+  return true;
+}
+
+// Replaces grid's lights with the enabled point and spot lights; the
+// directional ones stay with the per-material light constants.
+void GatherClusterLights(const Lighting::LightManager &light_manager,
+                         Lighting::ClusteredLightGrid &grid) {
+  using Lighting::LightType;
+
+  grid.ClearLights();
+  for (const auto &light : light_manager.GetAllLights()) {
+    if (!light || !light->IsEnabled()) {
+      continue;
+    }
+    const LightType type = light->GetType();
+    if (type != LightType::Point && type != LightType::Spot) {
+      continue;
+    }
+
+    Lighting::ClusterLightData data;
+    const DirectX::XMFLOAT3 &position = light->GetPosition();
+    data.position[0] = position.x;
+    data.position[1] = position.y;
+    data.position[2] = position.z;
+    data.range = light->GetRange();
+
+    const DirectX::XMFLOAT3 color = light->GetEffectiveColor();
+    data.color[0] = color.x;
+    data.color[1] = color.y;
+    data.color[2] = color.z;
+
+    data.attenuation[0] = light->GetAttenuationConstant();
+    data.attenuation[1] = light->GetAttenuationLinear();
+    data.attenuation[2] = light->GetAttenuationQuadratic();
+
+    if (type == LightType::Spot) {
+      const DirectX::XMFLOAT3 &direction = light->GetDirection();
+      data.direction[0] = direction.x;
+      data.direction[1] = direction.y;
+      data.direction[2] = direction.z;
+      data.spot_cos_outer = std::cos(
+          DirectX::XMConvertToRadians(light->GetSpotOuterAngle()));
+      data.spot_cos_inner = std::cos(
+          DirectX::XMConvertToRadians(light->GetSpotInnerAngle()));
+    }
+
+    grid.AddLight(data);
+  }
+}
+
+} // namespace
+
 bool Graphics::Initialize(int screenWidth, int screenHeight, HWND hwnd) {
   // Initialize DirectX12 Device
   DirectX12DeviceConfig device_config = {};
@@ -27,6 +143,7 @@ bool Graphics::Initialize(int screenWidth, int screenHeight, HWND hwnd) {
   device_config.fullscreen = FULL_SCREEN;
   device_config.screen_depth = SCREEN_DEPTH;
   device_config.screen_near = SCREEN_NEAR;
+  device_config.frame_latency = FRAME_LATENCY;
 
   d3d12_device_ = DirectX12Device::Create(device_config);
   if (!d3d12_device_) {
@@ -73,6 +190,10 @@ bool Graphics::Initialize(int screenWidth, int screenHeight, HWND hwnd) {
   main_light->SetColor(1.0f, 1.0f, 1.0f); // White light
   main_light->SetIntensity(1.0f);
 
+  if (!InitializeLocalLights()) {
+    return false;
+  }
+
   // Initialize shaders
   if (!InitializeShaders(hwnd)) {
     return false;
@@ -88,12 +209,22 @@ bool Graphics::Initialize(int screenWidth, int screenHeight, HWND hwnd) {
     return false;
   }
 
+  scene_bvh_.Clear();
+  std::fill(std::begin(scene_object_ids_), std::end(scene_object_ids_),
+            SceneBvh::kInvalidObject);
+  UpdateSceneBvh();
+
   return true;
 }
 
 void Graphics::Shutdown() {
 
+  // Streaming loads write into the models below; let them land first.
+  ResourceLoader::AssetStreamer::Instance().WaitIdle();
+  ResourceLoader::AssetRegistry::Instance().LogStats();
+
   if (d3d12_device_) {
+    d3d12_device_->GetPipelineCache().LogStats();
     d3d12_device_->WaitForGpuIdle();
   }
 
@@ -112,12 +243,18 @@ void Graphics::Shutdown() {
     reflection_scene_.reset();
   }
 
+  if (instancing_scene_) {
+    instancing_scene_->Shutdown();
+    instancing_scene_.reset();
+  }
+
   bitmap_.reset();
   text_.reset();
   model_.reset();
   pbr_model_.reset();
 
   shader_loader_.reset();
+  local_lights_.clear();
   light_manager_.reset();
   camera_.reset();
   fps_.reset();
@@ -132,6 +269,9 @@ void Graphics::Shutdown() {
 
 bool Graphics::Frame(float delta_seconds, Input *input) {
 
+  // Swap in assets that finished streaming since the last frame.
+  ResourceLoader::AssetStreamer::Instance().PumpMainThread();
+
   cpu_usage_tracker_->Update();
   if (!text_->SetCpu(cpu_usage_tracker_->GetCpuPercentage())) {
     return false;
@@ -142,6 +282,15 @@ bool Graphics::Frame(float delta_seconds, Input *input) {
     return false;
   }
 
+  // The last frame's recording has finished, so its stats are complete.
+  if (instancing_scene_) {
+    const InstancingStats &stats = instancing_scene_->GetStats();
+    if (!text_->SetInstancing(stats.draw_count, stats.instance_count,
+                              stats.record_milliseconds)) {
+      return false;
+    }
+  }
+
   if (bump_mapping_scene_) {
     bump_mapping_scene_->Update(delta_seconds);
   }
@@ -154,6 +303,10 @@ bool Graphics::Frame(float delta_seconds, Input *input) {
     reflection_scene_->Update(delta_seconds);
   }
 
+  if (instancing_scene_) {
+    instancing_scene_->Update(delta_seconds);
+  }
+
   shared_rotation_angle_ += shared_rotation_speed_ * delta_seconds;
   if (shared_rotation_angle_ > DirectX::XM_2PI) {
     shared_rotation_angle_ -= DirectX::XM_2PI;
@@ -171,9 +324,13 @@ bool Graphics::Frame(float delta_seconds, Input *input) {
     reflection_scene_->SetRotationAngle(shared_rotation_angle_);
   }
 
+  UpdateSceneBvh();
+
   UpdateCameraFromInput(delta_seconds, input);
 
   camera_->Update();
+  PickSceneObject(input);
+
   if (FAILED(Render())) {
     return false;
   }
@@ -267,6 +424,111 @@ void Graphics::UpdateCameraFromInput(float delta_seconds, Input *input) {
   }
 }
 
+void Graphics::UpdateSceneBvh() {
+  BoundingVolume bounds[kSceneObjectCount] = {};
+  bool present[kSceneObjectCount] = {};
+
+  if (model_) {
+    bounds[kModelObject] = model_->GetWorldBounds(
+        GetModelWorld(kModelPosition, shared_rotation_angle_));
+    present[kModelObject] = true;
+  }
+  if (pbr_model_) {
+    bounds[kPbrModelObject] = pbr_model_->GetWorldBounds(
+        GetModelWorld(kPbrModelPosition, shared_rotation_angle_));
+    present[kPbrModelObject] = true;
+  }
+  if (bump_mapping_scene_) {
+    bounds[kBumpCubeObject] = bump_mapping_scene_->GetWorldBounds();
+    present[kBumpCubeObject] = true;
+  }
+  if (specular_mapping_scene_) {
+    bounds[kSpecularCubeObject] = specular_mapping_scene_->GetWorldBounds();
+    present[kSpecularCubeObject] = true;
+  }
+  if (reflection_scene_) {
+    bounds[kReflectionCubeObject] = reflection_scene_->GetCubeWorldBounds();
+    bounds[kReflectionFloorObject] = reflection_scene_->GetFloorWorldBounds();
+    present[kReflectionCubeObject] = true;
+    present[kReflectionFloorObject] = true;
+  }
+
+  for (UINT object = 0; object < kSceneObjectCount; ++object) {
+    uint32_t &id = scene_object_ids_[object];
+    if (present[object] && id == SceneBvh::kInvalidObject) {
+      id = scene_bvh_.Insert(bounds[object]);
+    } else if (present[object]) {
+      scene_bvh_.SetBounds(id, bounds[object]);
+    } else if (id != SceneBvh::kInvalidObject) {
+      scene_bvh_.Remove(id);
+      id = SceneBvh::kInvalidObject;
+    }
+  }
+
+  // Refit alone builds after inserts and removals.
+  if (scene_bvh_.NeedsRebuild()) {
+    scene_bvh_.Build();
+  } else {
+    scene_bvh_.Refit();
+  }
+}
+
+void Graphics::PickSceneObject(Input *input) {
+  if (!input || !camera_ || !d3d12_device_) {
+    return;
+  }
+
+  const bool pressed = input->IsLeftMouseButtonPressed();
+  const bool clicked = pressed && !left_mouse_was_pressed_;
+  left_mouse_was_pressed_ = pressed;
+  if (!clicked) {
+    return;
+  }
+
+  static const wchar_t *const kSceneObjectNames[] = {
+      L"model",
+      L"PBR model",
+      L"bump mapping cube",
+      L"specular mapping cube",
+      L"reflection cube",
+      L"reflection floor",
+  };
+  static_assert(std::size(kSceneObjectNames) == kSceneObjectCount,
+                "one name per scene object");
+
+  int mouse_x = 0;
+  int mouse_y = 0;
+  input->GetMouseLocation(mouse_x, mouse_y);
+
+  DirectX::XMMATRIX projection_matrix = {};
+  d3d12_device_->GetProjectionMatrix(projection_matrix);
+  const Ray ray = camera_->ScreenPointToRay(
+      mouse_x, mouse_y, d3d12_device_->GetScreenWidth(),
+      d3d12_device_->GetScreenHeight(), projection_matrix);
+
+  RayHit hit;
+  const wchar_t *name = L"nothing";
+  if (scene_bvh_.RayCast(ray, hit)) {
+    for (UINT object = 0; object < kSceneObjectCount; ++object) {
+      if (scene_object_ids_[object] == hit.object) {
+        name = kSceneObjectNames[object];
+      }
+    }
+  }
+
+  std::wstringstream stream;
+  stream << L"[Graphics] Picked " << name << L" at (" << mouse_x << L", "
+         << mouse_y << L")\n";
+  OutputDebugStringW(stream.str().c_str());
+}
+
+auto Graphics::IsSceneObjectVisible(SceneObject object) const -> bool {
+  const uint32_t id = scene_object_ids_[object];
+  return id != SceneBvh::kInvalidObject &&
+         std::find(visible_objects_.begin(), visible_objects_.end(), id) !=
+             visible_objects_.end();
+}
+
 bool Graphics::Render() {
   // Get view and projection matrices
   DirectX::XMMATRIX view_matrix = camera_->GetViewMatrix();
@@ -278,30 +540,101 @@ bool Graphics::Render() {
   if (!UpdateConstantBuffers(view_matrix, projection_matrix)) {
     return false;
   }
-
-  // Reset command allocator and command list
-  if (!d3d12_device_->ResetCommandAllocator() || !d3d12_device_->ResetCommandList()) {
+  if (!UpdateClusteredLights(view_matrix, projection_matrix)) {
     return false;
   }
 
-  // Render to offscreen target
-  if (!RenderOffscreenPass()) {
+  // Everything below may touch shared state, so it runs before the fan-out.
+  CacheRenderResources();
+  if (!text_->PrepareFrame()) {
+    return false;
+  }
+  if (!BuildRenderQueue(view_matrix, projection_matrix)) {
     return false;
   }
 
-  // Render reflection maps if needed
-  if (reflection_scene_) {
-    if (!reflection_scene_->RenderReflectionMap(projection_matrix)) {
-      return false;
-    }
+  auto main_light = light_manager_->GetPrimaryLight();
+  if (!main_light) {
+    return false;
   }
 
-  // Render main scene
-  if (!RenderMainScenePass(view_matrix, projection_matrix)) {
+  if (!d3d12_device_->BeginPassRecording(kRenderPassCount)) {
     return false;
   }
 
-  if (!d3d12_device_->ExecuteDefaultGraphicsCommandList()) {
+  // Each job records its passes into their own command lists. The reflection
+  // scene records both of its passes in one job because they share the cube's
+  // constant buffer and the camera's reflection matrix.
+  bool pass_results[kRenderPassCount] = {};
+  auto record = [this, &pass_results](RenderPass pass, auto &&function) {
+    DirectX12Device::ScopedPassRecording scope(*d3d12_device_, pass);
+    pass_results[pass] = function();
+  };
+
+  auto &job_system = JobSystem::Instance();
+  JobCounter counter;
+
+  job_system.Submit(
+      [&] { record(kOffscreenPass, [&] { return RenderOffscreenPass(); }); },
+      counter);
+
+  job_system.Submit(
+      [&] {
+        record(kReflectionMapPass, [&] {
+          return !reflection_scene_ ||
+                 reflection_scene_->RenderReflectionMap(projection_matrix);
+        });
+        record(kReflectionScenePass, [&] {
+          d3d12_device_->BeginPopulateGraphicsCommandList();
+          return !reflection_scene_ ||
+                 reflection_scene_->Render(view_matrix, projection_matrix);
+        });
+      },
+      counter);
+
+  job_system.Submit(
+      [&] {
+        record(kSpecularScenePass, [&] {
+          d3d12_device_->BindBackBuffer();
+          return !specular_mapping_scene_ ||
+                 specular_mapping_scene_->Render(view_matrix, projection_matrix,
+                                                 main_light.get());
+        });
+      },
+      counter);
+
+  job_system.Submit(
+      [&] {
+        record(kBumpScenePass, [&] {
+          d3d12_device_->BindBackBuffer();
+          return !bump_mapping_scene_ ||
+                 bump_mapping_scene_->Render(view_matrix, projection_matrix,
+                                             main_light.get());
+        });
+      },
+      counter);
+
+  job_system.Submit(
+      [&] {
+        record(kInstancingScenePass, [&] {
+          d3d12_device_->BindBackBuffer();
+          return !instancing_scene_ ||
+                 instancing_scene_->Render(view_matrix, projection_matrix,
+                                           main_light.get());
+        });
+      },
+      counter);
+
+  record(kOverlayPass, [&] { return RenderOverlayPass(); });
+  job_system.Wait(counter);
+
+  for (bool result : pass_results) {
+    if (!result) {
+      return false;
+    }
+  }
+
+  if (!d3d12_device_->ExecutePassCommandLists()) {
     return false;
   }
 
@@ -314,68 +647,78 @@ bool Graphics::InitializeShaders(HWND hwnd) {
     return false;
   }
 
-  using ResourceLoader::ShaderCompileDesc;
+  using ResourceLoader::ShaderCompileRequest;
+  using ResourceLoader::ShaderStage;
 
-  const auto report_shader_error = [this, hwnd](const wchar_t *fallback) {
-    const auto &error = shader_loader_->GetLastErrorMessage();
-    if (!error.empty()) {
-      MessageBoxA(hwnd, error.c_str(), "Shader Compilation Error", MB_OK);
-    } else if (fallback != nullptr) {
-      MessageBox(hwnd, fallback, L"Error", MB_OK);
-    }
+  struct ShaderProgram {
+    const wchar_t *file_path;
+    const char *vertex_entry_point;
+    const char *pixel_entry_point;
+    const wchar_t *name;
   };
 
-  // Compile texture shaders
-  ShaderCompileDesc texture_vs{L"shader/texture.hlsl",
-                               "TextureVertexShader", "vs_5_0"};
-  ShaderCompileDesc texture_ps{L"shader/texture.hlsl",
-                               "TexturePixelShader", "ps_5_0"};
-  if (!shader_loader_->CompileVertexAndPixelShaders(texture_vs, texture_ps)) {
-    report_shader_error(L"Could not initialize Texture Shader.");
-    return false;
-  }
+  // Compiled as one batch, so startup waits for the slowest shader rather
+  // than the sum. The scenes' shaders ride along; their EnsureShadersLoaded
+  // then finds them compiled or in flight.
+  const ShaderProgram programs[] = {
+      {L"shader/texture.hlsl", "TextureVertexShader", "TexturePixelShader",
+       L"Texture Shader"},
+      {L"shader/light.hlsl", "LightVertexShader", "LightPixelShader",
+       L"Light Shader"},
+      {L"shader/font.hlsl", "FontVertexShader", "FontPixelShader",
+       L"Font Shader"},
+      {L"shader/pbr.hlsl", "PbrVertexShader", "PbrPixelShader",
+       L"PBR Shader"},
+      {L"shader/specMap.hlsl", "SpecMapVertexShader", "SpecMapPixelShader",
+       L"Specular Map Shader"},
+      {L"shader/bumpMap.hlsl", "BumpMapVertexShader", "BumpMapPixelShader",
+       L"Bump Map Shader"},
+      {L"shader/reflection.hlsl", "ReflectionVertexShader",
+       "ReflectionPixelShader", L"Reflection Shader"},
+      // After the plain programs of the same files, which the by-file
+      // lookups return.
+      {L"shader/light.hlsl", "LightInstancedVertexShader",
+       "LightInstancedPixelShader", L"Instanced Light Shader"},
+      {L"shader/pbr.hlsl", "PbrInstancedVertexShader",
+       "PbrInstancedPixelShader", L"Instanced PBR Shader"},
+      {L"shader/light.hlsl", "LightVertexShader", "LightClusteredPixelShader",
+       L"Clustered Light Shader"},
+      {L"shader/pbr.hlsl", "PbrVertexShader", "PbrClusteredPixelShader",
+       L"Clustered PBR Shader"},
+  };
 
-  // Compile light shaders
-  ShaderCompileDesc light_vs{L"shader/light.hlsl", "LightVertexShader",
-                             "vs_5_0"};
-  ShaderCompileDesc light_ps{L"shader/light.hlsl", "LightPixelShader",
-                             "ps_5_0"};
-  if (!shader_loader_->CompileVertexAndPixelShaders(light_vs, light_ps)) {
-    report_shader_error(L"Could not initialize Light Shader.");
-    return false;
+  std::vector<ShaderCompileRequest> requests;
+  for (const auto &program : programs) {
+    requests.push_back({ShaderStage::kVertex,
+                        {program.file_path, program.vertex_entry_point,
+                         "vs_5_0"}});
+    requests.push_back({ShaderStage::kPixel,
+                        {program.file_path, program.pixel_entry_point,
+                         "ps_5_0"}});
   }
 
-  // Compile font shaders
-  ShaderCompileDesc font_vs{L"shader/font.hlsl", "FontVertexShader",
-                            "vs_5_0"};
-  ShaderCompileDesc font_ps{L"shader/font.hlsl", "FontPixelShader",
-                            "ps_5_0"};
-  if (!shader_loader_->CompileVertexAndPixelShaders(font_vs, font_ps)) {
-    report_shader_error(L"Could not initialize Font Shader.");
-    return false;
+  auto batch = shader_loader_->CompileShaders(requests);
+  if (batch->Wait()) {
+    return true;
   }
 
-  // Compile PBR shaders
-  ShaderCompileDesc pbr_vs{L"shader/pbr.hlsl", "PbrVertexShader",
-                           "vs_5_0"};
-  ShaderCompileDesc pbr_ps{L"shader/pbr.hlsl", "PbrPixelShader",
-                           "ps_5_0"};
-  if (!shader_loader_->CompileVertexAndPixelShaders(pbr_vs, pbr_ps)) {
-    report_shader_error(L"Could not initialize PBR Shader.");
-    return false;
-  }
-
-  // Compile specular mapping shaders
-  ShaderCompileDesc spec_vs{L"shader/specMap.hlsl", "SpecMapVertexShader",
-                            "vs_5_0"};
-  ShaderCompileDesc spec_ps{L"shader/specMap.hlsl", "SpecMapPixelShader",
-                            "ps_5_0"};
-  if (!shader_loader_->CompileVertexAndPixelShaders(spec_vs, spec_ps)) {
-    report_shader_error(L"Could not initialize Specular Map Shader.");
-    return false;
+  // Requests come in pairs, so the failing program is index / 2.
+  for (size_t i = 0; i < batch->GetSize(); ++i) {
+    const auto &status = batch->GetStatus(i);
+    if (status.succeeded) {
+      continue;
+    }
+    if (!status.error_message.empty()) {
+      MessageBoxA(hwnd, status.error_message.c_str(),
+                  "Shader Compilation Error", MB_OK);
+    } else {
+      const std::wstring message = std::wstring(L"Could not initialize ") +
+                                   programs[i / 2].name + L".";
+      MessageBox(hwnd, message.c_str(), L"Error", MB_OK);
+    }
+    break;
   }
-
-  return true;
+  return false;
 }
 
 bool Graphics::InitializeRenderObjects(int screenWidth, int screenHeight, HWND hwnd) {
@@ -412,6 +755,8 @@ bool Graphics::InitializeRenderObjects(int screenWidth, int screenHeight, HWND h
   model_material->SetPSByteCode(CD3DX12_SHADER_BYTECODE(
       shader_loader_->GetPixelShaderBlobByFileName(L"shader/light.hlsl")
           .Get()));
+  model_material->SetClusteredPixelShader(CD3DX12_SHADER_BYTECODE(
+      shader_loader_->GetPixelShaderBlob(kLightClusteredPixelShader).Get()));
 
   WCHAR *texture_filename_arr[3] = {L"data/stone01.dds", L"data/dirt01.dds",
                                     L"data/alpha01.dds"};
@@ -457,6 +802,8 @@ bool Graphics::InitializeRenderObjects(int screenWidth, int screenHeight, HWND h
   pbr_material->SetPSByteCode(CD3DX12_SHADER_BYTECODE(
       shader_loader_->GetPixelShaderBlobByFileName(L"shader/pbr.hlsl")
           .Get()));
+  pbr_material->SetClusteredPixelShader(CD3DX12_SHADER_BYTECODE(
+      shader_loader_->GetPixelShaderBlob(kPbrClusteredPixelShader).Get()));
 
   WCHAR *pbr_textures[3] = {L"data/pbr/pbr_albedo.tga",
                             L"data/pbr/pbr_normal.tga",
@@ -506,6 +853,18 @@ bool Graphics::InitializeScenes(HWND hwnd) {
     return false;
   }
 
+  // Initialize instancing stress scene
+  instancing_scene_ = std::make_shared<InstancingStressScene>(
+      d3d12_device_, shader_loader_, light_manager_, camera_);
+  if (!instancing_scene_) {
+    return false;
+  }
+  if (!instancing_scene_->Initialize()) {
+    MessageBox(hwnd, L"Could not initialize instancing stress scene.",
+               L"Error", MB_OK);
+    return false;
+  }
+
   return true;
 }
 
@@ -518,8 +877,7 @@ bool Graphics::UpdateConstantBuffers(const DirectX::XMMATRIX& view_matrix,
   float rotation = shared_rotation_angle_;
 
   DirectX::XMMATRIX rotate_world =
-      DirectX::XMMatrixTranspose(DirectX::XMMatrixRotationY(rotation) *
-                                 DirectX::XMMatrixTranslation(-6.0f, 1.5f, -6.0f));
+      DirectX::XMMatrixTranspose(GetModelWorld(kModelPosition, rotation));
 
   DirectX::XMMATRIX font_world = DirectX::XMMatrixTranspose(world_matrix);
   DirectX::XMMATRIX view = DirectX::XMMatrixTranspose(view_matrix);
@@ -530,9 +888,8 @@ bool Graphics::UpdateConstantBuffers(const DirectX::XMMATRIX& view_matrix,
   d3d12_device_->GetOrthoMatrix(orthogonality);
   orthogonality = DirectX::XMMatrixTranspose(orthogonality);
 
-  DirectX::XMMATRIX pbr_world = DirectX::XMMatrixRotationY(rotation) *
-                                DirectX::XMMatrixTranslation(6.0f, 1.5f, -6.0f);
-  pbr_world = DirectX::XMMatrixTranspose(pbr_world);
+  DirectX::XMMATRIX pbr_world =
+      DirectX::XMMatrixTranspose(GetModelWorld(kPbrModelPosition, rotation));
 
   // Get unified light system
   auto main_light = light_manager_->GetPrimaryLight();
@@ -568,231 +925,352 @@ bool Graphics::UpdateConstantBuffers(const DirectX::XMMATRIX& view_matrix,
     }
   }
 
+  // Written here rather than while the overlay pass records, which may be
+  // on another thread.
+  if (!bitmap_->UpdatePosition(100, 100) ||
+      !bitmap_->GetMaterial()->UpdateConstantBuffer(font_world, base_view,
+                                                    orthogonality)) {
+    return false;
+  }
+
   return true;
 }
 
-bool Graphics::RenderOffscreenPass() {
+auto Graphics::InitializeLocalLights() -> bool {
+  // The cap is there for the per-material light constants, which only ever
+  // take the primary light; the clustered shaders take any number.
+  light_manager_->SetMaxLights(light_manager_->GetLightCount() +
+                               kLocalLightCount);
+
+  local_lights_.clear();
+  for (size_t i = 0; i < kLocalLightCount; ++i) {
+    const bool spot = i % kSpotLightStride == 0;
+    auto light = light_manager_->CreateLight(
+        "LocalLight" + std::to_string(i),
+        spot ? Lighting::LightType::Spot : Lighting::LightType::Point);
+    if (!light) {
+      return false;
+    }
+
+    const float hue = DirectX::XM_2PI * static_cast<float>(i) /
+                      static_cast<float>(kLocalLightCount);
+    light->SetColor(0.5f + 0.5f * std::cos(hue),
+                    0.5f + 0.5f * std::cos(hue - DirectX::XM_2PI / 3.0f),
+                    0.5f + 0.5f * std::cos(hue + DirectX::XM_2PI / 3.0f));
+    light->SetIntensity(kLocalLightIntensity);
+    light->SetRange(spot ? kSpotLightRange : kPointLightRange);
+    if (spot) {
+      light->SetDirection(0.0f, -1.0f, 0.0f);
+      light->SetSpotAngles(20.0f, 35.0f);
+    }
+    local_lights_.push_back(light);
+  }
+
+  Lighting::ClusterGridConfig config;
+  config.near_z = SCREEN_NEAR;
+  config.far_z = SCREEN_DEPTH;
+  light_grid_.SetConfig(config);
+  return true;
+}
+
+auto Graphics::UpdateClusteredLights(
+    const DirectX::XMMATRIX &view_matrix,
+    const DirectX::XMMATRIX &projection_matrix) -> bool {
+  for (size_t i = 0; i < local_lights_.size(); ++i) {
+    const float angle = shared_rotation_angle_ +
+                        DirectX::XM_2PI * static_cast<float>(i) /
+                            static_cast<float>(local_lights_.size());
+    const float radius = i % 2 == 0 ? kInnerRingRadius : kOuterRingRadius;
+    const float height = i % kSpotLightStride == 0
+                             ? 3.0f
+                             : 0.5f * static_cast<float>(i % 3);
+    local_lights_[i]->SetPosition(
+        kLocalLightCenter.x + radius * std::cos(angle),
+        kLocalLightCenter.y + height,
+        kLocalLightCenter.z + radius * std::sin(angle));
+  }
+
+  GatherClusterLights(*light_manager_, light_grid_);
+
+  DirectX::XMFLOAT4X4 view = {};
+  DirectX::XMFLOAT4X4 projection = {};
+  DirectX::XMStoreFloat4x4(&view, view_matrix);
+  DirectX::XMStoreFloat4x4(&projection, projection_matrix);
+  light_grid_.Build(&view.m[0][0], &projection.m[0][0],
+                    static_cast<uint32_t>(d3d12_device_->GetScreenWidth()),
+                    static_cast<uint32_t>(d3d12_device_->GetScreenHeight()));
+
+  const Lighting::ClusterConstants &constants = light_grid_.GetConstants();
+  return d3d12_device_->WriteFrameConstants(&constants, sizeof(constants),
+                                            clustered_lights_.constants) &&
+         WriteFrameBuffer(*d3d12_device_, light_grid_.GetLights(),
+                          clustered_lights_.lights) &&
+         WriteFrameBuffer(*d3d12_device_, light_grid_.GetLightIndices(),
+                          clustered_lights_.light_indices) &&
+         WriteFrameBuffer(*d3d12_device_, light_grid_.GetClusterRanges(),
+                          clustered_lights_.cluster_ranges);
+}
+
+void Graphics::AddClusteredLights(MaterialBinding &material) const {
+  material.constant_buffers[material.constant_buffer_count++] =
+      clustered_lights_.constants;
+  material.shader_resource_count = 3;
+  material.shader_resources[0] = clustered_lights_.lights;
+  material.shader_resources[1] = clustered_lights_.light_indices;
+  material.shader_resources[2] = clustered_lights_.cluster_ranges;
+}
+
+void Graphics::CacheRenderResources() {
   // Cache resources to avoid repeated lookups
   if (!cached_resources_.light_root_signature) {
     cached_resources_.light_root_signature = model_->GetMaterial()->GetRootSignature().Get();
-    cached_resources_.light_pso = model_->GetMaterial()->GetPSOByName("model_normal").Get();
-    cached_resources_.light_matrix_cb = model_->GetMaterial()->GetMatrixConstantBuffer().Get();
-    cached_resources_.light_cb = model_->GetMaterial()->GetLightConstantBuffer().Get();
-    cached_resources_.fog_cb = model_->GetMaterial()->GetFogConstantBuffer().Get();
+    cached_resources_.light_pso = model_->GetMaterial()->GetPSOByName("model_clustered").Get();
 
     cached_resources_.font_root_signature = text_->GetMaterial()->GetRootSignature().Get();
     cached_resources_.font_pso = text_->GetMaterial()->GetPSOByName("text_blend_enable").Get();
-    cached_resources_.font_matrix_cb = text_->GetMaterial()->GetMatrixConstantBuffer().Get();
-    cached_resources_.font_pixel_cb = text_->GetMaterial()->GetPixelConstantBuffer().Get();
   }
 
-  d3d12_device_->BeginDrawToOffScreen();
-
-  // Render model to offscreen
-  d3d12_device_->SetGraphicsRootSignature(cached_resources_.light_root_signature);
-  d3d12_device_->SetPipelineStateObject(cached_resources_.light_pso);
-
-  ID3D12DescriptorHeap *light_shader_heap[] = {
-      model_.get()->GetShaderResourceView().Get()};
-  d3d12_device_->SetDescriptorHeaps(1, light_shader_heap);
-
-  d3d12_device_->SetGraphicsRootDescriptorTable(
-      0, light_shader_heap[0]->GetGPUDescriptorHandleForHeapStart());
-  d3d12_device_->SetGraphicsRootConstantBufferView(
-      1, cached_resources_.light_matrix_cb->GetGPUVirtualAddress());
-  d3d12_device_->SetGraphicsRootConstantBufferView(
-      2, cached_resources_.light_cb->GetGPUVirtualAddress());
-  d3d12_device_->SetGraphicsRootConstantBufferView(
-      3, cached_resources_.fog_cb->GetGPUVirtualAddress());
-
-  d3d12_device_->BindIndexBuffer(&model_->GetIndexBufferView());
-  d3d12_device_->BindVertexBuffer(0, 1, &model_->GetVertexBufferView());
-  d3d12_device_->Draw(model_->GetIndexCount());
-
-  // Render text to offscreen
-  d3d12_device_->SetGraphicsRootSignature(cached_resources_.font_root_signature);
-  d3d12_device_->SetPipelineStateObject(cached_resources_.font_pso);
-
-  ID3D12DescriptorHeap *font_shader_heap[] = {
-      text_.get()->GetShaderResourceView().Get()};
-  d3d12_device_->SetDescriptorHeaps(1, font_shader_heap);
-
-  d3d12_device_->SetGraphicsRootDescriptorTable(
-      0, font_shader_heap[0]->GetGPUDescriptorHandleForHeapStart());
-  d3d12_device_->SetGraphicsRootConstantBufferView(
-      1, cached_resources_.font_matrix_cb->GetGPUVirtualAddress());
-  d3d12_device_->SetGraphicsRootConstantBufferView(
-      2, cached_resources_.font_pixel_cb->GetGPUVirtualAddress());
-
-  // Render both text sections
-  auto vertex1 = text_->GetVertexBufferView(0);
-  auto vertex2 = text_->GetVertexBufferView(1);
-  auto index1 = text_->GetIndexBufferView(0);
-  auto index2 = text_->GetIndexBufferView(1);
-
-  d3d12_device_->BindIndexBuffer(&index1);
-  d3d12_device_->BindVertexBuffer(0, 1, &vertex1);
-  d3d12_device_->Draw(text_->GetIndexCount(0));
-
-  d3d12_device_->BindIndexBuffer(&index2);
-  d3d12_device_->BindVertexBuffer(0, 1, &vertex2);
-  d3d12_device_->Draw(text_->GetIndexCount(1));
-
-  d3d12_device_->EndDrawToOffScreen();
-  return true;
+  if (!cached_resources_.offscreen_root_signature) {
+    cached_resources_.offscreen_root_signature = bitmap_->GetMaterial()->GetRootSignature().Get();
+    cached_resources_.offscreen_pso = bitmap_->GetMaterial()->GetPSOByName("bitmap_normal").Get();
+  }
 }
 
-bool Graphics::RenderMainScenePass(const DirectX::XMMATRIX& view_matrix,
-                                 const DirectX::XMMATRIX& projection_matrix) {
-  d3d12_device_->BeginPopulateGraphicsCommandList();
+void Graphics::RenderBindings::Clear() {
+  root_signatures.clear();
+  pipeline_states.clear();
+  materials.clear();
+  geometries.clear();
+}
 
-  // Get main light for scenes
-  auto main_light = light_manager_->GetPrimaryLight();
-  if (!main_light) {
-    return false;
+auto Graphics::RenderBindings::AddRootSignature(
+    ID3D12RootSignature *root_signature) -> uint32_t {
+  auto it = std::find(root_signatures.begin(), root_signatures.end(),
+                      root_signature);
+  if (it != root_signatures.end()) {
+    return static_cast<uint32_t>(it - root_signatures.begin());
   }
+  root_signatures.push_back(root_signature);
+  return static_cast<uint32_t>(root_signatures.size() - 1);
+}
 
-  // Render modern scenes
-  if (reflection_scene_) {
-    if (!reflection_scene_->Render(view_matrix, projection_matrix)) {
-      return false;
-    }
+auto Graphics::RenderBindings::AddPipelineState(
+    ID3D12PipelineState *pipeline_state) -> uint32_t {
+  auto it = std::find(pipeline_states.begin(), pipeline_states.end(),
+                      pipeline_state);
+  if (it != pipeline_states.end()) {
+    return static_cast<uint32_t>(it - pipeline_states.begin());
   }
+  pipeline_states.push_back(pipeline_state);
+  return static_cast<uint32_t>(pipeline_states.size() - 1);
+}
 
-  if (specular_mapping_scene_) {
-    if (!specular_mapping_scene_->Render(view_matrix, projection_matrix, main_light.get())) {
-      return false;
-    }
-  }
+auto Graphics::RenderBindings::AddMaterial(const MaterialBinding &material)
+    -> uint32_t {
+  materials.push_back(material);
+  return static_cast<uint32_t>(materials.size() - 1);
+}
 
-  if (bump_mapping_scene_) {
-    if (!bump_mapping_scene_->Render(view_matrix, projection_matrix, main_light.get())) {
-      return false;
-    }
-  }
+auto Graphics::RenderBindings::AddGeometry(const GeometryBinding &geometry)
+    -> uint32_t {
+  geometries.push_back(geometry);
+  return static_cast<uint32_t>(geometries.size() - 1);
+}
 
-  // Render PBR model
-  if (pbr_model_) {
+bool Graphics::BuildRenderQueue(const DirectX::XMMATRIX &view_matrix,
+                                const DirectX::XMMATRIX &projection_matrix) {
+  render_queue_.Clear();
+  render_bindings_.Clear();
+  auto &bindings = render_bindings_;
+
+  // Both passes share the camera, so one query covers them.
+  visible_objects_.clear();
+  scene_bvh_.QueryFrustum(
+      Camera::BuildFrustumPlanes(view_matrix, projection_matrix),
+      visible_objects_);
+
+  // Model, drawn offscreen and to the back buffer.
+  DrawPacket model_draw;
+  model_draw.root_signature =
+      bindings.AddRootSignature(cached_resources_.light_root_signature);
+  model_draw.pipeline_state =
+      bindings.AddPipelineState(cached_resources_.light_pso);
+
+  MaterialBinding model_material;
+  model_material.table = model_->GetShaderResourceView();
+  model_material.constant_buffer_count = 3;
+  model_material.constant_buffers[0] =
+      model_->GetMaterial()->GetMatrixConstantBufferAddress();
+  model_material.constant_buffers[1] =
+      model_->GetMaterial()->GetLightConstantBufferAddress();
+  model_material.constant_buffers[2] =
+      model_->GetMaterial()->GetFogConstantBufferAddress();
+  AddClusteredLights(model_material);
+  model_draw.material = bindings.AddMaterial(model_material);
+
+  GeometryBinding model_geometry;
+  model_geometry.vertex_buffer = model_->GetVertexBufferView();
+  model_geometry.index_buffer = model_->GetIndexBufferView();
+  model_draw.geometry = bindings.AddGeometry(model_geometry);
+  model_draw.index_count = model_->GetIndexCount();
+
+  if (IsSceneObjectVisible(kModelObject)) {
+    const uint32_t model_depth = QuantizeDrawDepth(
+        GetViewDepth(kModelPosition, view_matrix), SCREEN_DEPTH);
+    render_queue_.Submit(kOffscreenPass, RenderLayer::kOpaque, model_depth,
+                         model_draw);
+    render_queue_.Submit(kOverlayPass, RenderLayer::kOpaque, model_depth,
+                         model_draw);
+  }
+
+  // Text is screen-space at depth 0, so its sentences keep their order.
+  DrawPacket text_draw;
+  text_draw.root_signature =
+      bindings.AddRootSignature(cached_resources_.font_root_signature);
+  text_draw.pipeline_state =
+      bindings.AddPipelineState(cached_resources_.font_pso);
+
+  MaterialBinding text_material;
+  text_material.table = text_->GetShaderResourceView();
+  text_material.constant_buffer_count = 2;
+  text_material.constant_buffers[0] =
+      text_->GetMaterial()->GetMatrixConstantBufferAddress();
+  text_material.constant_buffers[1] =
+      text_->GetMaterial()->GetPixelConstantBufferAddress();
+  text_draw.material = bindings.AddMaterial(text_material);
+
+  for (unsigned int i = 0; i < text_->GetSentenceCount(); ++i) {
+    const int sentence = static_cast<int>(i);
+    GeometryBinding text_geometry;
+    text_geometry.vertex_buffer = text_->GetVertexBufferView(sentence);
+    text_geometry.index_buffer = text_->GetIndexBufferView(sentence);
+    text_draw.geometry = bindings.AddGeometry(text_geometry);
+    text_draw.index_count = text_->GetIndexCount(sentence);
+
+    render_queue_.Submit(kOffscreenPass, RenderLayer::kBlended, 0, text_draw);
+    render_queue_.Submit(kOverlayPass, RenderLayer::kBlended, 0, text_draw);
+  }
+
+  if (pbr_model_ && IsSceneObjectVisible(kPbrModelObject)) {
     auto pbr_material = pbr_model_->GetMaterial();
-    auto pbr_root_signature = pbr_material->GetRootSignature();
-    auto pbr_pso = pbr_material->GetPSOByName("pbr_pipeline");
-    auto pbr_matrix_cb = pbr_material->GetMatrixConstantBuffer();
-    auto pbr_camera_cb = pbr_material->GetCameraConstantBuffer();
-    auto pbr_light_cb = pbr_material->GetLightConstantBuffer();
 
-    ID3D12DescriptorHeap *pbr_heap[] = {
-        pbr_model_->GetShaderResourceView().Get()};
-    d3d12_device_->SetDescriptorHeaps(1, pbr_heap);
-
-    d3d12_device_->SetGraphicsRootSignature(pbr_root_signature);
-    d3d12_device_->SetPipelineStateObject(pbr_pso);
-    d3d12_device_->SetGraphicsRootDescriptorTable(
-        0, pbr_heap[0]->GetGPUDescriptorHandleForHeapStart());
-    d3d12_device_->SetGraphicsRootConstantBufferView(
-        1, pbr_matrix_cb->GetGPUVirtualAddress());
-    d3d12_device_->SetGraphicsRootConstantBufferView(
-        2, pbr_camera_cb->GetGPUVirtualAddress());
-    d3d12_device_->SetGraphicsRootConstantBufferView(
-        3, pbr_light_cb->GetGPUVirtualAddress());
+    DrawPacket pbr_draw;
+    pbr_draw.root_signature =
+        bindings.AddRootSignature(pbr_material->GetRootSignature().Get());
+    pbr_draw.pipeline_state = bindings.AddPipelineState(
+        pbr_material->GetPSOByName("pbr_clustered").Get());
+
+    MaterialBinding pbr_binding;
+    pbr_binding.table = pbr_model_->GetShaderResourceView();
+    pbr_binding.constant_buffer_count = 3;
+    pbr_binding.constant_buffers[0] =
+        pbr_material->GetMatrixConstantBufferAddress();
+    pbr_binding.constant_buffers[1] =
+        pbr_material->GetCameraConstantBufferAddress();
+    pbr_binding.constant_buffers[2] =
+        pbr_material->GetLightConstantBufferAddress();
+    AddClusteredLights(pbr_binding);
+    pbr_draw.material = bindings.AddMaterial(pbr_binding);
+
+    GeometryBinding pbr_geometry;
+    pbr_geometry.vertex_buffer = pbr_model_->GetVertexBufferView();
+    pbr_geometry.index_buffer = pbr_model_->GetIndexBufferView();
+    pbr_draw.geometry = bindings.AddGeometry(pbr_geometry);
+    pbr_draw.index_count = pbr_model_->GetIndexCount();
+
+    render_queue_.Submit(
+        kOverlayPass, RenderLayer::kOpaque,
+        QuantizeDrawDepth(GetViewDepth(kPbrModelPosition, view_matrix),
+                          SCREEN_DEPTH),
+        pbr_draw);
+  }
+
+  // The offscreen texture as a bitmap, over everything else.
+  DrawPacket bitmap_draw;
+  bitmap_draw.root_signature =
+      bindings.AddRootSignature(cached_resources_.offscreen_root_signature);
+  bitmap_draw.pipeline_state =
+      bindings.AddPipelineState(cached_resources_.offscreen_pso);
+
+  MaterialBinding bitmap_material;
+  bitmap_material.table = d3d12_device_->GetOffScreenTextureSrv();
+  bitmap_material.constant_buffer_count = 1;
+  bitmap_material.constant_buffers[0] =
+      bitmap_->GetMaterial()->GetConstantBufferAddress();
+  bitmap_draw.material = bindings.AddMaterial(bitmap_material);
+
+  GeometryBinding bitmap_geometry;
+  bitmap_geometry.vertex_buffer = bitmap_->GetVertexBufferView();
+  bitmap_geometry.index_buffer = bitmap_->GetIndexBufferView();
+  bitmap_draw.geometry = bindings.AddGeometry(bitmap_geometry);
+  bitmap_draw.index_count = static_cast<uint32_t>(bitmap_->GetIndexCount());
+
+  render_queue_.Submit(kOverlayPass, RenderLayer::kOverlay, 0, bitmap_draw);
+
+  render_queue_.Sort();
+  return true;
+}
 
-    d3d12_device_->BindVertexBuffer(0, 1, &pbr_model_->GetVertexBufferView());
-    d3d12_device_->BindIndexBuffer(&pbr_model_->GetIndexBufferView());
-    d3d12_device_->Draw(pbr_model_->GetIndexCount());
-  }
+void Graphics::ReplayRenderQueue(RenderPass pass) {
+  // Local so that it can name the private binding types.
+  class DeviceRecorder {
+  public:
+    DeviceRecorder(DirectX12Device &device, const RenderBindings &bindings)
+        : device_(device), bindings_(bindings) {}
 
-  // Render legacy objects to main screen
-  if (!RenderUIPass()) {
-    return false;
-  }
+    void SetRootSignature(uint32_t id) {
+      device_.SetGraphicsRootSignature(bindings_.root_signatures[id]);
+    }
 
-  d3d12_device_->EndPopulateGraphicsCommandList();
-  return true;
-}
+    void SetPipelineState(uint32_t id) {
+      device_.SetPipelineStateObject(bindings_.pipeline_states[id]);
+    }
 
-bool Graphics::RenderUIPass() {
-  // Render model to main screen
-  d3d12_device_->SetGraphicsRootSignature(cached_resources_.light_root_signature);
-  d3d12_device_->SetPipelineStateObject(cached_resources_.light_pso);
-
-  ID3D12DescriptorHeap *light_shader_heap[] = {
-      model_.get()->GetShaderResourceView().Get()};
-  d3d12_device_->SetDescriptorHeaps(1, light_shader_heap);
-
-  d3d12_device_->SetGraphicsRootDescriptorTable(
-      0, light_shader_heap[0]->GetGPUDescriptorHandleForHeapStart());
-  d3d12_device_->SetGraphicsRootConstantBufferView(
-      1, cached_resources_.light_matrix_cb->GetGPUVirtualAddress());
-  d3d12_device_->SetGraphicsRootConstantBufferView(
-      2, cached_resources_.light_cb->GetGPUVirtualAddress());
-  d3d12_device_->SetGraphicsRootConstantBufferView(
-      3, cached_resources_.fog_cb->GetGPUVirtualAddress());
-
-  d3d12_device_->BindIndexBuffer(&model_->GetIndexBufferView());
-  d3d12_device_->BindVertexBuffer(0, 1, &model_->GetVertexBufferView());
-  d3d12_device_->Draw(model_->GetIndexCount());
-
-  // Render text to main screen
-  d3d12_device_->SetGraphicsRootSignature(cached_resources_.font_root_signature);
-  d3d12_device_->SetPipelineStateObject(cached_resources_.font_pso);
-
-  ID3D12DescriptorHeap *font_shader_heap[] = {
-      text_.get()->GetShaderResourceView().Get()};
-  d3d12_device_->SetDescriptorHeaps(1, font_shader_heap);
-
-  d3d12_device_->SetGraphicsRootDescriptorTable(
-      0, font_shader_heap[0]->GetGPUDescriptorHandleForHeapStart());
-  d3d12_device_->SetGraphicsRootConstantBufferView(
-      1, cached_resources_.font_matrix_cb->GetGPUVirtualAddress());
-  d3d12_device_->SetGraphicsRootConstantBufferView(
-      2, cached_resources_.font_pixel_cb->GetGPUVirtualAddress());
-
-  // Render both text sections
-  auto vertex1 = text_->GetVertexBufferView(0);
-  auto vertex2 = text_->GetVertexBufferView(1);
-  auto index1 = text_->GetIndexBufferView(0);
-  auto index2 = text_->GetIndexBufferView(1);
-
-  d3d12_device_->BindIndexBuffer(&index1);
-  d3d12_device_->BindVertexBuffer(0, 1, &vertex1);
-  d3d12_device_->Draw(text_->GetIndexCount(0));
-
-  d3d12_device_->BindIndexBuffer(&index2);
-  d3d12_device_->BindVertexBuffer(0, 1, &vertex2);
-  d3d12_device_->Draw(text_->GetIndexCount(1));
-
-  // Render offscreen texture as bitmap
-  if (!cached_resources_.offscreen_root_signature) {
-    cached_resources_.offscreen_root_signature = bitmap_->GetMaterial()->GetRootSignature().Get();
-    cached_resources_.offscreen_pso = bitmap_->GetMaterial()->GetPSOByName("bitmap_normal").Get();
-  }
+    void BindMaterial(uint32_t id) {
+      const MaterialBinding &material = bindings_.materials[id];
+      device_.SetGraphicsRootDescriptorTable(0, material.table);
+      for (UINT i = 0; i < material.constant_buffer_count; ++i) {
+        device_.SetGraphicsRootConstantBufferView(
+            i + 1, material.constant_buffers[i]);
+      }
+      for (UINT i = 0; i < material.shader_resource_count; ++i) {
+        device_.SetGraphicsRootShaderResourceView(
+            1 + material.constant_buffer_count + i,
+            material.shader_resources[i]);
+      }
+    }
 
-  d3d12_device_->BindVertexBuffer(0, 1, &bitmap_->GetVertexBufferView());
-  d3d12_device_->BindIndexBuffer(&bitmap_->GetIndexBufferView());
+    void BindGeometry(uint32_t id) {
+      const GeometryBinding &geometry = bindings_.geometries[id];
+      device_.BindIndexBuffer(&geometry.index_buffer);
+      device_.BindVertexBuffer(0, 1, &geometry.vertex_buffer);
+    }
 
-  d3d12_device_->SetGraphicsRootSignature(cached_resources_.offscreen_root_signature);
-  d3d12_device_->SetPipelineStateObject(cached_resources_.offscreen_pso);
+    void Draw(const DrawPacket &packet) {
+      device_.Draw(packet.index_count, packet.instance_count,
+                   packet.start_index, packet.base_vertex);
+    }
 
-  // Update bitmap position and matrices
-  DirectX::XMMATRIX world_matrix = {};
-  d3d12_device_->GetWorldMatrix(world_matrix);
-  DirectX::XMMATRIX font_world = DirectX::XMMatrixTranspose(world_matrix);
-  DirectX::XMMATRIX base_view = DirectX::XMMatrixTranspose(base_view_matrix_);
-  DirectX::XMMATRIX orthogonality = {};
-  d3d12_device_->GetOrthoMatrix(orthogonality);
-  orthogonality = DirectX::XMMatrixTranspose(orthogonality);
+  private:
+    DirectX12Device &device_;
 
-  bitmap_->GetMaterial()->UpdateConstantBuffer(font_world, base_view, orthogonality);
-  bitmap_->UpdatePosition(100, 100);
+    const RenderBindings &bindings_;
+  };
 
-  auto off_screen_heap = d3d12_device_->GetOffScreenTextureHeapView();
-  ID3D12DescriptorHeap *off_screen_descriptor_heap[] = {off_screen_heap.Get()};
-  d3d12_device_->SetDescriptorHeaps(1, off_screen_descriptor_heap);
-  d3d12_device_->SetGraphicsRootDescriptorTable(
-      0, off_screen_descriptor_heap[0]->GetGPUDescriptorHandleForHeapStart());
-  d3d12_device_->SetGraphicsRootConstantBufferView(
-      1, bitmap_->GetMaterial()->GetConstantBuffer()->GetGPUVirtualAddress());
+  DeviceRecorder recorder(*d3d12_device_, render_bindings_);
+  render_queue_.Replay(pass, recorder);
+}
 
-  d3d12_device_->Draw(bitmap_->GetIndexCount());
+bool Graphics::RenderOffscreenPass() {
+  d3d12_device_->BeginDrawToOffScreen();
+  ReplayRenderQueue(kOffscreenPass);
+  d3d12_device_->EndDrawToOffScreen();
+  return true;
+}
 
+bool Graphics::RenderOverlayPass() {
+  d3d12_device_->BindBackBuffer();
+  ReplayRenderQueue(kOverlayPass);
+  d3d12_device_->EndPopulateGraphicsCommandList();
   return true;
 }
@@ -252,4 +252,9 @@ bool Input::IsPageDownPressed() const {
   if (keyboard_state_[DIK_PGDN] & 0x80)
     return true;
   return false;
-}
\ No newline at end of file
+}
+bool Input::IsLeftMouseButtonPressed() const {
+  if (mouse_state_.rgbButtons[0] & 0x80)
+    return true;
+  return false;
+}
@@ -0,0 +1,86 @@
+#include "stdafx.h"
+
+#include "InstanceBuffer.h"
+
+#include <cstring>
+#include <utility>
+
+#include "DirectX12Device.h"
+
+static_assert(sizeof(InstanceData) == 96,
+              "InstanceData must match the instance input layout");
+
+void AppendInstanceInputElements(
+    std::vector<D3D12_INPUT_ELEMENT_DESC> &input_elements) {
+  constexpr D3D12_INPUT_CLASSIFICATION kPerInstance =
+      D3D12_INPUT_CLASSIFICATION_PER_INSTANCE_DATA;
+
+  for (UINT row = 0; row < 4; ++row) {
+    input_elements.push_back({"WORLD", row, DXGI_FORMAT_R32G32B32A32_FLOAT,
+                              kInstanceStreamSlot,
+                              D3D12_APPEND_ALIGNED_ELEMENT, kPerInstance, 1});
+  }
+  input_elements.push_back({"COLOR", 0, DXGI_FORMAT_R32G32B32A32_FLOAT,
+                            kInstanceStreamSlot, D3D12_APPEND_ALIGNED_ELEMENT,
+                            kPerInstance, 1});
+  input_elements.push_back({"MATERIAL", 0, DXGI_FORMAT_R32_UINT,
+                            kInstanceStreamSlot, D3D12_APPEND_ALIGNED_ELEMENT,
+                            kPerInstance, 1});
+}
+
+InstanceBuffer::InstanceBuffer(std::shared_ptr<DirectX12Device> device)
+    : device_(std::move(device)) {}
+
+auto InstanceBuffer::InitializeStatic(
+    const std::vector<InstanceData> &instances) -> bool {
+  if (!device_ || instances.empty()) {
+    return false;
+  }
+
+  ResourceSharedPtr buffer = nullptr;
+  const size_t buffer_size = sizeof(InstanceData) * instances.size();
+  if (!device_->CreateDefaultBuffer(instances.data(), buffer_size, buffer)) {
+    OutputDebugStringW(L"[InstanceBuffer] Failed to create instance buffer\n");
+    return false;
+  }
+
+  if (buffer_) {
+    device_->DeferRelease(buffer_);
+  }
+  buffer_ = std::move(buffer);
+
+  vertex_buffer_view_.BufferLocation = buffer_->GetGPUVirtualAddress();
+  vertex_buffer_view_.SizeInBytes = static_cast<UINT>(buffer_size);
+  vertex_buffer_view_.StrideInBytes = sizeof(InstanceData);
+  instance_count_ = static_cast<UINT>(instances.size());
+  return true;
+}
+
+auto InstanceBuffer::UpdateDynamic(const InstanceData *instances, UINT count)
+    -> bool {
+  if (!device_ || instances == nullptr || count == 0) {
+    instance_count_ = 0;
+    return false;
+  }
+
+  const size_t size = sizeof(InstanceData) * count;
+  LinearAllocation allocation = {};
+  if (!device_->AllocateFrameMemory(size, alignof(InstanceData),
+                                    allocation)) {
+    instance_count_ = 0;
+    return false;
+  }
+  std::memcpy(allocation.cpu_address, instances, size);
+
+  // A static buffer this replaced stays alive for frames still using it.
+  if (buffer_) {
+    device_->DeferRelease(buffer_);
+    buffer_.Reset();
+  }
+
+  vertex_buffer_view_.BufferLocation = allocation.gpu_address;
+  vertex_buffer_view_.SizeInBytes = static_cast<UINT>(size);
+  vertex_buffer_view_.StrideInBytes = sizeof(InstanceData);
+  instance_count_ = count;
+  return true;
+}
@@ -0,0 +1,433 @@
+#include "stdafx.h"
+
+#include "InstancingStressScene.h"
+
+#include <chrono>
+#include <cmath>
+
+#include "Camera.h"
+#include "DirectX12Device.h"
+#include "LightManager.h"
+#include "Model.h"
+#include "PBRModel.h"
+#include "SceneLight.h"
+#include "ShaderLoader.h"
+
+using namespace DirectX;
+using namespace Lighting;
+using namespace ResourceLoader;
+
+namespace {
+
+// 100 x 100 cubes on a plane below the camera, reaching into the distance.
+constexpr UINT kCubeGridSize = 100;
+constexpr float kCubeSpacing = 2.5f;
+constexpr float kCubeScale = 0.5f;
+const XMFLOAT3 kCubeGridOrigin(-123.75f, -6.0f, 10.0f);
+
+// Far enough for the whole field to show before it fades into the fog.
+constexpr float kCubeFogStart = 40.0f;
+constexpr float kCubeFogEnd = 260.0f;
+
+// 10 x 10 spheres bobbing above it.
+constexpr UINT kSphereGridSize = 10;
+constexpr float kSphereSpacing = 3.0f;
+constexpr float kSphereScale = 0.6f;
+const XMFLOAT3 kSphereGridOrigin(-13.5f, 8.0f, 20.0f);
+
+// Textures the cubes pick from by material index.
+constexpr UINT kCubeMaterialCount = 3;
+
+const ShaderCompileDesc kLightVertexShader = {L"shader/light.hlsl",
+                                              "LightVertexShader", "vs_5_0"};
+const ShaderCompileDesc kLightPixelShader = {L"shader/light.hlsl",
+                                             "LightPixelShader", "ps_5_0"};
+const ShaderCompileDesc kLightInstancedVertexShader = {
+    L"shader/light.hlsl", "LightInstancedVertexShader", "vs_5_0"};
+const ShaderCompileDesc kLightInstancedPixelShader = {
+    L"shader/light.hlsl", "LightInstancedPixelShader", "ps_5_0"};
+
+const ShaderCompileDesc kPbrVertexShader = {L"shader/pbr.hlsl",
+                                            "PbrVertexShader", "vs_5_0"};
+const ShaderCompileDesc kPbrPixelShader = {L"shader/pbr.hlsl",
+                                           "PbrPixelShader", "ps_5_0"};
+const ShaderCompileDesc kPbrInstancedVertexShader = {
+    L"shader/pbr.hlsl", "PbrInstancedVertexShader", "vs_5_0"};
+const ShaderCompileDesc kPbrInstancedPixelShader = {
+    L"shader/pbr.hlsl", "PbrInstancedPixelShader", "ps_5_0"};
+
+// Integer hash, so the field looks the same on every run.
+auto HashInstance(uint32_t value) -> uint32_t {
+  value ^= value >> 16;
+  value *= 0x7FEB352Du;
+  value ^= value >> 15;
+  value *= 0x846CA68Bu;
+  value ^= value >> 16;
+  return value;
+}
+
+auto UnitFloat(uint32_t hash) -> float {
+  return static_cast<float>(hash & 0xFFFFFF) / static_cast<float>(0xFFFFFF);
+}
+
+auto MakeInstance(const XMMATRIX &world, const XMFLOAT4 &tint,
+                  uint32_t material_index) -> InstanceData {
+  InstanceData instance;
+  XMStoreFloat4x4(&instance.world, world);
+  instance.tint = tint;
+  instance.material_index = material_index;
+  return instance;
+}
+
+} // namespace
+
+InstancingStressScene::InstancingStressScene(
+    std::shared_ptr<DirectX12Device> device,
+    std::shared_ptr<ShaderLoader> shader_loader,
+    std::shared_ptr<LightManager> light_manager,
+    std::shared_ptr<Camera> camera)
+    : device_(std::move(device)),
+      shader_loader_(std::move(shader_loader)),
+      light_manager_(std::move(light_manager)),
+      camera_(std::move(camera)) {}
+
+InstancingStressScene::~InstancingStressScene() = default;
+
+auto InstancingStressScene::Initialize() -> bool {
+  if (!device_ || !shader_loader_ || !light_manager_ || !camera_) {
+    return false;
+  }
+
+  if (!EnsureShadersLoaded()) {
+    return false;
+  }
+
+  if (!InitializeCubes() || !InitializeSpheres()) {
+    return false;
+  }
+
+  return true;
+}
+
+void InstancingStressScene::Shutdown() {
+  cube_instances_.reset();
+  cube_model_.reset();
+  sphere_instances_.reset();
+  sphere_model_.reset();
+  sphere_instance_data_.clear();
+  visible_sphere_data_.clear();
+  shaders_loaded_ = false;
+}
+
+void InstancingStressScene::Update(float delta_seconds) {
+  elapsed_seconds_ += delta_seconds;
+  // Keeps the sines precise over a long session.
+  if (elapsed_seconds_ > 1000.0f * XM_2PI) {
+    elapsed_seconds_ -= 1000.0f * XM_2PI;
+  }
+}
+
+auto InstancingStressScene::Render(const XMMATRIX &view,
+                                   const XMMATRIX &projection,
+                                   const SceneLight *scene_light) -> bool {
+  if (!device_ || !cube_model_ || !sphere_model_) {
+    return false;
+  }
+
+  const SceneLight *light_to_use = scene_light;
+  if (!light_to_use && light_manager_) {
+    light_to_use = light_manager_->GetPrimaryLight().get();
+  }
+  if (!light_to_use) {
+    return false;
+  }
+
+  stats_ = {};
+  const auto start = std::chrono::steady_clock::now();
+
+  const FrustumPlanes frustum = Camera::BuildFrustumPlanes(view, projection);
+  const XMMATRIX view_t = XMMatrixTranspose(view);
+  const XMMATRIX projection_t = XMMatrixTranspose(projection);
+
+  const bool recorded =
+      RenderCubes(frustum, view_t, projection_t, light_to_use) &&
+      RenderSpheres(frustum, view_t, projection_t, light_to_use);
+
+  stats_.record_milliseconds = std::chrono::duration<float, std::milli>(
+                                   std::chrono::steady_clock::now() - start)
+                                   .count();
+  return recorded;
+}
+
+auto InstancingStressScene::GetInstanceCount() const -> UINT {
+  UINT count = 0;
+  if (cube_instances_) {
+    count += cube_instances_->GetInstanceCount();
+  }
+  if (sphere_instances_) {
+    count += sphere_instances_->GetInstanceCount();
+  }
+  return count;
+}
+
+auto InstancingStressScene::EnsureShadersLoaded() -> bool {
+  if (shaders_loaded_) {
+    return true;
+  }
+
+  if (!shader_loader_) {
+    return false;
+  }
+
+  if (!shader_loader_->CompileVertexAndPixelShaders(kLightVertexShader,
+                                                    kLightPixelShader) ||
+      !shader_loader_->CompileVertexAndPixelShaders(
+          kLightInstancedVertexShader, kLightInstancedPixelShader) ||
+      !shader_loader_->CompileVertexAndPixelShaders(kPbrVertexShader,
+                                                    kPbrPixelShader) ||
+      !shader_loader_->CompileVertexAndPixelShaders(
+          kPbrInstancedVertexShader, kPbrInstancedPixelShader)) {
+    return false;
+  }
+
+  shaders_loaded_ = true;
+  return true;
+}
+
+auto InstancingStressScene::InitializeCubes() -> bool {
+  cube_model_ = std::make_shared<Model>(device_);
+  if (!cube_model_) {
+    return false;
+  }
+
+  ModelMaterial *material = cube_model_->GetMaterial();
+  material->SetVSByteCode(CD3DX12_SHADER_BYTECODE(
+      shader_loader_->GetVertexShaderBlob(kLightVertexShader).Get()));
+  material->SetPSByteCode(CD3DX12_SHADER_BYTECODE(
+      shader_loader_->GetPixelShaderBlob(kLightPixelShader).Get()));
+  material->SetInstancedShaders(
+      CD3DX12_SHADER_BYTECODE(
+          shader_loader_->GetVertexShaderBlob(kLightInstancedVertexShader)
+              .Get()),
+      CD3DX12_SHADER_BYTECODE(
+          shader_loader_->GetPixelShaderBlob(kLightInstancedPixelShader)
+              .Get()));
+
+  WCHAR *textures[kCubeMaterialCount] = {
+      L"data/stone01.dds", L"data/dirt01.dds", L"data/alpha01.dds"};
+  if (!cube_model_->Initialize(L"data/cube.txt", textures)) {
+    return false;
+  }
+
+  std::vector<InstanceData> instances;
+  instances.reserve(kCubeGridSize * kCubeGridSize);
+  for (UINT row = 0; row < kCubeGridSize; ++row) {
+    for (UINT column = 0; column < kCubeGridSize; ++column) {
+      const uint32_t hash = HashInstance(row * kCubeGridSize + column);
+      const float yaw = UnitFloat(hash) * XM_2PI;
+      const float height = UnitFloat(hash >> 8) * 1.5f;
+
+      const XMMATRIX world =
+          XMMatrixScaling(kCubeScale, kCubeScale, kCubeScale) *
+          XMMatrixRotationY(yaw) *
+          XMMatrixTranslation(kCubeGridOrigin.x + column * kCubeSpacing,
+                              kCubeGridOrigin.y + height,
+                              kCubeGridOrigin.z + row * kCubeSpacing);
+
+      const float shade = 0.6f + 0.4f * UnitFloat(hash >> 4);
+      const XMFLOAT4 tint = {shade, 0.8f + 0.2f * UnitFloat(hash >> 12),
+                             shade, 1.0f};
+      instances.push_back(
+          MakeInstance(world, tint, (hash >> 24) % kCubeMaterialCount));
+    }
+  }
+
+  cube_instances_ = std::make_unique<InstanceBuffer>(device_);
+  return cube_instances_->InitializeStatic(instances);
+}
+
+auto InstancingStressScene::InitializeSpheres() -> bool {
+  sphere_model_ = std::make_shared<PBRModel>(device_);
+  if (!sphere_model_) {
+    return false;
+  }
+
+  PBRMaterial *material = sphere_model_->GetMaterial();
+  material->SetVSByteCode(CD3DX12_SHADER_BYTECODE(
+      shader_loader_->GetVertexShaderBlob(kPbrVertexShader).Get()));
+  material->SetPSByteCode(CD3DX12_SHADER_BYTECODE(
+      shader_loader_->GetPixelShaderBlob(kPbrPixelShader).Get()));
+  material->SetInstancedShaders(
+      CD3DX12_SHADER_BYTECODE(
+          shader_loader_->GetVertexShaderBlob(kPbrInstancedVertexShader)
+              .Get()),
+      CD3DX12_SHADER_BYTECODE(
+          shader_loader_->GetPixelShaderBlob(kPbrInstancedPixelShader)
+              .Get()));
+
+  WCHAR *textures[3] = {L"data/pbr/pbr_albedo.tga", L"data/pbr/pbr_normal.tga",
+                        L"data/pbr/pbr_roughmetal.tga"};
+  if (!sphere_model_->Initialize(L"data/pbr/sphere.txt", textures)) {
+    return false;
+  }
+
+  sphere_instance_data_.resize(kSphereGridSize * kSphereGridSize);
+  visible_sphere_data_.reserve(sphere_instance_data_.size());
+  sphere_bounds_.Reserve(sphere_instance_data_.size());
+  sphere_instances_ = std::make_unique<InstanceBuffer>(device_);
+  return true;
+}
+
+auto InstancingStressScene::RenderCubes(const FrustumPlanes &frustum,
+                                        const XMMATRIX &view_t,
+                                        const XMMATRIX &projection_t,
+                                        const SceneLight *scene_light)
+    -> bool {
+  // The field is one static batch, so it is culled as a whole: the grid's
+  // box, grown by the reach of a rotated cube.
+  const float cube_reach =
+      cube_model_->GetWorldBounds(XMMatrixScaling(kCubeScale, kCubeScale,
+                                                  kCubeScale))
+          .radius;
+  const float field_size = (kCubeGridSize - 1) * kCubeSpacing;
+  BoundingVolume field;
+  field.center[0] = kCubeGridOrigin.x + field_size * 0.5f;
+  field.center[1] = kCubeGridOrigin.y + 0.75f;
+  field.center[2] = kCubeGridOrigin.z + field_size * 0.5f;
+  field.extents[0] = field_size * 0.5f + cube_reach;
+  field.extents[1] = 0.75f + cube_reach;
+  field.extents[2] = field_size * 0.5f + cube_reach;
+  field.radius = std::sqrt(field.extents[0] * field.extents[0] +
+                           field.extents[1] * field.extents[1] +
+                           field.extents[2] * field.extents[2]);
+  if (!IsVisible(frustum, field)) {
+    return true;
+  }
+
+  ModelMaterial *material = cube_model_->GetMaterial();
+
+  // The instances carry the placement; the batch itself stays put.
+  const XMMATRIX world_t = XMMatrixIdentity();
+  if (!material->UpdateMatrixConstant(world_t, view_t, projection_t) ||
+      !material->UpdateFromLight(scene_light) ||
+      !material->UpdateFogConstant(kCubeFogStart, kCubeFogEnd)) {
+    return false;
+  }
+
+  auto root_signature = material->GetRootSignature();
+  auto pso = material->GetPSOByName("model_instanced");
+  auto texture_table = cube_model_->GetShaderResourceView();
+  if (!root_signature || !pso || !texture_table.ptr) {
+    return false;
+  }
+
+  device_->SetGraphicsRootSignature(root_signature);
+  device_->SetPipelineStateObject(pso);
+
+  device_->SetGraphicsRootDescriptorTable(0, texture_table);
+  device_->SetGraphicsRootConstantBufferView(
+      1, material->GetMatrixConstantBufferAddress());
+  device_->SetGraphicsRootConstantBufferView(
+      2, material->GetLightConstantBufferAddress());
+  device_->SetGraphicsRootConstantBufferView(
+      3, material->GetFogConstantBufferAddress());
+
+  const VertexBufferView streams[] = {
+      cube_model_->GetVertexBufferView(),
+      cube_instances_->GetVertexBufferView()};
+  device_->BindVertexBuffer(0, _countof(streams), streams);
+  device_->BindIndexBuffer(&cube_model_->GetIndexBufferView());
+  device_->Draw(cube_model_->GetIndexCount(),
+                cube_instances_->GetInstanceCount());
+  ++stats_.draw_count;
+  stats_.instance_count += cube_instances_->GetInstanceCount();
+
+  return true;
+}
+
+auto InstancingStressScene::RenderSpheres(const FrustumPlanes &frustum,
+                                          const XMMATRIX &view_t,
+                                          const XMMATRIX &projection_t,
+                                          const SceneLight *scene_light)
+    -> bool {
+  sphere_bounds_.Clear();
+  const UINT count = static_cast<UINT>(sphere_instance_data_.size());
+  for (UINT i = 0; i < count; ++i) {
+    const UINT row = i / kSphereGridSize;
+    const UINT column = i % kSphereGridSize;
+    const float phase = static_cast<float>(row + column) * 0.5f;
+    const float bob = std::sin(elapsed_seconds_ * 2.0f + phase) * 0.75f;
+
+    const XMMATRIX world =
+        XMMatrixScaling(kSphereScale, kSphereScale, kSphereScale) *
+        XMMatrixRotationY(elapsed_seconds_ + phase) *
+        XMMatrixTranslation(kSphereGridOrigin.x + column * kSphereSpacing,
+                            kSphereGridOrigin.y + bob,
+                            kSphereGridOrigin.z + row * kSphereSpacing);
+
+    sphere_bounds_.Add(sphere_model_->GetWorldBounds(world));
+
+    const float u = static_cast<float>(column) / (kSphereGridSize - 1);
+    const float v = static_cast<float>(row) / (kSphereGridSize - 1);
+    sphere_instance_data_[i] =
+        MakeInstance(world, XMFLOAT4(1.0f - 0.5f * u, 0.6f + 0.4f * v,
+                                     0.5f + 0.5f * u, 1.0f),
+                     0);
+  }
+
+  // Only the spheres in view are uploaded and drawn.
+  sphere_visibility_.resize(count);
+  CullBounds(frustum, sphere_bounds_, 0, count, sphere_visibility_.data());
+  visible_sphere_data_.clear();
+  for (UINT i = 0; i < count; ++i) {
+    if (sphere_visibility_[i]) {
+      visible_sphere_data_.push_back(sphere_instance_data_[i]);
+    }
+  }
+  if (visible_sphere_data_.empty()) {
+    return true;
+  }
+
+  const UINT visible_count = static_cast<UINT>(visible_sphere_data_.size());
+  if (!sphere_instances_->UpdateDynamic(visible_sphere_data_.data(),
+                                        visible_count)) {
+    return false;
+  }
+
+  PBRMaterial *material = sphere_model_->GetMaterial();
+  const XMMATRIX world_t = XMMatrixIdentity();
+  if (!material->UpdateMatrixConstant(world_t, view_t, projection_t) ||
+      !material->UpdateCameraConstant(camera_->GetPosition()) ||
+      !material->UpdateFromLight(scene_light)) {
+    return false;
+  }
+
+  auto root_signature = material->GetRootSignature();
+  auto pso = material->GetPSOByName("pbr_instanced");
+  auto texture_table = sphere_model_->GetShaderResourceView();
+  if (!root_signature || !pso || !texture_table.ptr) {
+    return false;
+  }
+
+  device_->SetGraphicsRootSignature(root_signature);
+  device_->SetPipelineStateObject(pso);
+
+  device_->SetGraphicsRootDescriptorTable(0, texture_table);
+  device_->SetGraphicsRootConstantBufferView(
+      1, material->GetMatrixConstantBufferAddress());
+  device_->SetGraphicsRootConstantBufferView(
+      2, material->GetCameraConstantBufferAddress());
+  device_->SetGraphicsRootConstantBufferView(
+      3, material->GetLightConstantBufferAddress());
+
+  const VertexBufferView streams[] = {
+      sphere_model_->GetVertexBufferView(),
+      sphere_instances_->GetVertexBufferView()};
+  device_->BindVertexBuffer(0, _countof(streams), streams);
+  device_->BindIndexBuffer(&sphere_model_->GetIndexBufferView());
+  device_->Draw(sphere_model_->GetIndexCount(), visible_count);
+  ++stats_.draw_count;
+  stats_.instance_count += visible_count;
+
+  return true;
+}
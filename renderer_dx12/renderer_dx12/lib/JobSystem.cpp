@@ -0,0 +1,325 @@
+#include "stdafx.h"
+
+#include "JobSystem.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <utility>
+
+namespace {
+
+// Roughly this many chunks per thread when ParallelFor picks the grain size:
+// enough slack to even out uneven ranges without drowning short loops in
+// scheduling overhead.
+constexpr size_t kAdaptiveChunksPerThread = 8;
+
+thread_local const JobSystem *current_job_system = nullptr;
+
+thread_local size_t current_worker_index = 0;
+
+// Cheap per-thread xorshift so thieves do not all start on the same victim.
+auto NextStealSeed() -> uint32_t {
+  thread_local uint32_t state = static_cast<uint32_t>(
+      std::hash<std::thread::id>{}(std::this_thread::get_id()) | 1u);
+  state ^= state << 13;
+  state ^= state >> 17;
+  state ^= state << 5;
+  return state;
+}
+
+} // namespace
+
+JobSystem::JobSystem(const JobSystemConfig &config)
+    : caller_participates_(config.caller_participates) {
+  unsigned int worker_count = config.worker_count;
+  if (worker_count == 0) {
+    const unsigned int hardware =
+        (std::max)(std::thread::hardware_concurrency(), 1u);
+    worker_count = caller_participates_ && hardware > 1 ? hardware - 1
+                                                        : hardware;
+  }
+
+  queues_.reserve(worker_count + 1);
+  for (unsigned int i = 0; i <= worker_count; ++i) {
+    queues_.push_back(std::make_unique<WorkQueue>());
+  }
+
+  workers_.reserve(worker_count);
+  for (unsigned int i = 0; i < worker_count; ++i) {
+    workers_.emplace_back([this, i] { WorkerLoop(i); });
+  }
+}
+
+JobSystem::~JobSystem() {
+  {
+    std::lock_guard<std::mutex> lock(sleep_mutex_);
+    stopping_ = true;
+  }
+  work_available_.notify_all();
+
+  for (auto &worker : workers_) {
+    worker.join();
+  }
+}
+
+auto JobSystem::Instance() -> JobSystem & {
+  static JobSystem instance;
+  return instance;
+}
+
+auto JobSystem::GetConcurrency() const -> unsigned int {
+  const bool caller_runs_jobs =
+      caller_participates_ || current_job_system == this;
+  return GetWorkerCount() + (caller_runs_jobs ? 1 : 0);
+}
+
+auto JobSystem::IsWorkerThread() const -> bool {
+  return current_job_system == this;
+}
+
+void JobSystem::Submit(Job job) { Push({std::move(job), nullptr}); }
+
+void JobSystem::Submit(Job job, JobCounter &counter) {
+  counter.pending_.fetch_add(1);
+  Push({std::move(job), &counter});
+}
+
+void JobSystem::SubmitAfter(JobCounter &dependency, Job job,
+                            JobCounter &counter) {
+  {
+    // Finish() drops the last pending job under this lock, so the dependency
+    // either still sees the continuation or is already done here.
+    std::lock_guard<std::mutex> lock(dependency.continuation_mutex_);
+    if (dependency.pending_.load() != 0) {
+      counter.pending_.fetch_add(1);
+      dependency.continuations_.push_back({std::move(job), &counter});
+      return;
+    }
+  }
+
+  Submit(std::move(job), counter);
+}
+
+void JobSystem::Wait(JobCounter &counter) {
+  const bool helps = caller_participates_ || current_job_system == this;
+
+  while (!counter.IsDone()) {
+    if (helps && TryRunOne()) {
+      continue;
+    }
+
+    std::unique_lock<std::mutex> lock(sleep_mutex_);
+    if (helps) {
+      helping_waiters_.fetch_add(1);
+    }
+    job_finished_.wait(lock, [&] {
+      return counter.IsDone() || (helps && queued_count_.load() > 0);
+    });
+    if (helps) {
+      helping_waiters_.fetch_sub(1);
+    }
+  }
+
+  // Finish() may still hold the counter's lock right after the last job;
+  // taking it once keeps the caller from destroying the counter under it.
+  std::lock_guard<std::mutex> lock(counter.continuation_mutex_);
+}
+
+void JobSystem::ParallelFor(
+    size_t count, size_t grain_size,
+    const std::function<void(size_t, size_t)> &function) {
+  if (count == 0) {
+    return;
+  }
+
+  const size_t concurrency = GetConcurrency();
+  if (grain_size == 0) {
+    grain_size = (std::max)(
+        count / (concurrency * kAdaptiveChunksPerThread), static_cast<size_t>(1));
+  }
+
+  if (concurrency <= 1 || count <= grain_size) {
+    function(0, count);
+    return;
+  }
+
+  JobCounter counter;
+  if (caller_participates_ || current_job_system == this) {
+    SplitRange(0, count, grain_size, function, counter);
+  } else {
+    Submit(
+        [this, count, grain_size, &function, &counter] {
+          SplitRange(0, count, grain_size, function, counter);
+        },
+        counter);
+  }
+  Wait(counter);
+}
+
+void JobSystem::Push(QueuedJob queued) {
+  // Counted before it becomes visible so a pop can never underflow the count;
+  // a sleeper that wakes early just retries.
+  queued_count_.fetch_add(1);
+  {
+    auto &queue = *queues_[CurrentWorkerIndex()];
+    std::lock_guard<std::mutex> lock(queue.mutex);
+    queue.jobs.push_back(std::move(queued));
+  }
+
+  // Sleepers register before re-checking queued_count_, so either they see
+  // this job or this sees them; a busy pool skips the lock entirely.
+  const bool wake_worker = sleeping_workers_.load() > 0;
+  const bool wake_helpers = helping_waiters_.load() > 0;
+  if (!wake_worker && !wake_helpers) {
+    return;
+  }
+
+  {
+    // Taking the lock orders the notify after a sleeper's predicate check.
+    std::lock_guard<std::mutex> lock(sleep_mutex_);
+  }
+  if (wake_worker) {
+    work_available_.notify_one();
+  }
+  if (wake_helpers) {
+    job_finished_.notify_all();
+  }
+}
+
+void JobSystem::WorkerLoop(size_t worker_index) {
+  current_job_system = this;
+  current_worker_index = worker_index;
+
+  for (;;) {
+    if (TryRunOne()) {
+      continue;
+    }
+
+    std::unique_lock<std::mutex> lock(sleep_mutex_);
+    sleeping_workers_.fetch_add(1);
+    work_available_.wait(
+        lock, [this] { return stopping_ || queued_count_.load() > 0; });
+    sleeping_workers_.fetch_sub(1);
+    if (stopping_ && queued_count_.load() == 0) {
+      return;
+    }
+  }
+}
+
+auto JobSystem::TryRunOne() -> bool {
+  QueuedJob queued;
+  if (!PopLocal(queued) && !Steal(queued)) {
+    return false;
+  }
+
+  Execute(queued);
+  return true;
+}
+
+auto JobSystem::PopLocal(QueuedJob &queued) -> bool {
+  if (current_job_system != this) {
+    return false;
+  }
+
+  auto &queue = *queues_[current_worker_index];
+  std::lock_guard<std::mutex> lock(queue.mutex);
+  if (queue.jobs.empty()) {
+    return false;
+  }
+
+  queued = std::move(queue.jobs.back());
+  queue.jobs.pop_back();
+  queued_count_.fetch_sub(1);
+  return true;
+}
+
+auto JobSystem::Steal(QueuedJob &queued) -> bool {
+  const size_t self = current_job_system == this ? current_worker_index
+                                                 : queues_.size();
+  const size_t queue_count = queues_.size();
+  const size_t start = NextStealSeed() % queue_count;
+
+  for (size_t i = 0; i < queue_count; ++i) {
+    const size_t index = (start + i) % queue_count;
+    if (index == self) {
+      continue;
+    }
+
+    auto &queue = *queues_[index];
+    std::lock_guard<std::mutex> lock(queue.mutex);
+    if (queue.jobs.empty()) {
+      continue;
+    }
+
+    queued = std::move(queue.jobs.front());
+    queue.jobs.pop_front();
+    queued_count_.fetch_sub(1);
+    return true;
+  }
+
+  return false;
+}
+
+void JobSystem::Execute(QueuedJob &queued) {
+  queued.job();
+  Finish(queued.counter);
+}
+
+void JobSystem::Finish(JobCounter *counter) {
+  if (!counter) {
+    return;
+  }
+
+  // Only the drop to zero needs the lock; everything above it is a plain
+  // atomic decrement.
+  size_t pending = counter->pending_.load();
+  while (pending > 1) {
+    if (counter->pending_.compare_exchange_weak(pending, pending - 1)) {
+      return;
+    }
+  }
+
+  std::vector<JobCounter::Continuation> released;
+  {
+    std::lock_guard<std::mutex> lock(counter->continuation_mutex_);
+    if (counter->pending_.fetch_sub(1) != 1) {
+      return;
+    }
+    released.swap(counter->continuations_);
+  }
+  // The counter may be gone from here on.
+
+  for (auto &continuation : released) {
+    Push({std::move(continuation.job), continuation.counter});
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(sleep_mutex_);
+  }
+  job_finished_.notify_all();
+}
+
+void JobSystem::SplitRange(size_t begin, size_t end, size_t grain_size,
+                           const std::function<void(size_t, size_t)> &function,
+                           JobCounter &counter) {
+  // Hand the upper half to the local deque and keep halving the lower one.
+  // Halves nobody steals come straight back off the same deque.
+  while (end - begin > grain_size) {
+    const size_t middle = begin + (end - begin) / 2;
+    Submit(
+        [this, middle, end, grain_size, &function, &counter] {
+          SplitRange(middle, end, grain_size, function, counter);
+        },
+        counter);
+    end = middle;
+  }
+
+  function(begin, end);
+}
+
+auto JobSystem::CurrentWorkerIndex() const -> size_t {
+  if (current_job_system == this) {
+    return current_worker_index;
+  }
+  return workers_.size();
+}
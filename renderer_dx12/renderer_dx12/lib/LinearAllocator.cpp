@@ -0,0 +1,85 @@
+#include "stdafx.h"
+
+#include "LinearAllocator.h"
+
+#include <algorithm>
+
+namespace {
+
+auto AlignUp(uint64_t value, uint64_t alignment) -> uint64_t {
+  return (value + alignment - 1) / alignment * alignment;
+}
+
+} // namespace
+
+void LinearAllocator::AddPage(uint8_t *cpu_base, uint64_t gpu_base,
+                              uint64_t size) {
+  if (cpu_base == nullptr || size == 0) {
+    return;
+  }
+  pages_.push_back({cpu_base, gpu_base, size});
+  capacity_ += size;
+}
+
+auto LinearAllocator::Allocate(uint64_t size, uint64_t alignment,
+                               LinearAllocation &allocation) -> bool {
+  if (closed_ || size == 0 || alignment == 0) {
+    return false;
+  }
+
+  while (current_page_ < pages_.size()) {
+    const auto &page = pages_[current_page_];
+
+    // Align the GPU address, which is what the hardware checks; the CPU
+    // pointer follows at the same offset.
+    const uint64_t start =
+        AlignUp(page.gpu_base + page_offset_, alignment) - page.gpu_base;
+    if (start + size <= page.size) {
+      allocation.cpu_address = page.cpu_base + start;
+      allocation.gpu_address = page.gpu_base + start;
+      allocation.size = size;
+
+      used_ += start + size - page_offset_;
+      peak_used_ = std::max(peak_used_, used_);
+      page_offset_ = start + size;
+      return true;
+    }
+
+    // The rest of this page is skipped for the remainder of the frame.
+    used_ += page.size - page_offset_;
+    ++current_page_;
+    page_offset_ = 0;
+  }
+
+  return false;
+}
+
+void LinearAllocator::Close(uint64_t fence_value) {
+  fence_value_ = fence_value;
+  closed_ = true;
+}
+
+auto LinearAllocator::Retire(uint64_t completed_fence_value) -> bool {
+  if (!closed_) {
+    return true;
+  }
+  if (completed_fence_value < fence_value_) {
+    return false;
+  }
+
+  closed_ = false;
+  current_page_ = 0;
+  page_offset_ = 0;
+  used_ = 0;
+  return true;
+}
+
+void LinearAllocator::Clear() {
+  pages_.clear();
+  current_page_ = 0;
+  page_offset_ = 0;
+  capacity_ = 0;
+  used_ = 0;
+  fence_value_ = 0;
+  closed_ = false;
+}
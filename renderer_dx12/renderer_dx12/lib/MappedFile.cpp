@@ -0,0 +1,77 @@
+#include "stdafx.h"
+
+#include "MappedFile.h"
+
+#include <utility>
+
+namespace ResourceLoader {
+
+MappedFile::MappedFile(MappedFile &&rhs) noexcept
+    : file_handle_(std::exchange(rhs.file_handle_, INVALID_HANDLE_VALUE)),
+      mapping_handle_(std::exchange(rhs.mapping_handle_, nullptr)),
+      data_(std::exchange(rhs.data_, nullptr)),
+      size_(std::exchange(rhs.size_, 0)) {}
+
+auto MappedFile::operator=(MappedFile &&rhs) noexcept -> MappedFile & {
+  if (this != &rhs) {
+    Close();
+    file_handle_ = std::exchange(rhs.file_handle_, INVALID_HANDLE_VALUE);
+    mapping_handle_ = std::exchange(rhs.mapping_handle_, nullptr);
+    data_ = std::exchange(rhs.data_, nullptr);
+    size_ = std::exchange(rhs.size_, 0);
+  }
+  return *this;
+}
+
+auto MappedFile::Open(const std::wstring &file_path) -> bool {
+  Close();
+
+  file_handle_ = CreateFileW(file_path.c_str(), GENERIC_READ, FILE_SHARE_READ,
+                             nullptr, OPEN_EXISTING,
+                             FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN,
+                             nullptr);
+  if (file_handle_ == INVALID_HANDLE_VALUE) {
+    return false;
+  }
+
+  LARGE_INTEGER file_size = {};
+  if (!GetFileSizeEx(file_handle_, &file_size) || file_size.QuadPart == 0) {
+    Close();
+    return false;
+  }
+
+  mapping_handle_ =
+      CreateFileMappingW(file_handle_, nullptr, PAGE_READONLY, 0, 0, nullptr);
+  if (!mapping_handle_) {
+    Close();
+    return false;
+  }
+
+  data_ = static_cast<const uint8_t *>(
+      MapViewOfFile(mapping_handle_, FILE_MAP_READ, 0, 0, 0));
+  if (!data_) {
+    Close();
+    return false;
+  }
+
+  size_ = static_cast<size_t>(file_size.QuadPart);
+  return true;
+}
+
+void MappedFile::Close() {
+  if (data_) {
+    UnmapViewOfFile(data_);
+    data_ = nullptr;
+  }
+  if (mapping_handle_) {
+    CloseHandle(mapping_handle_);
+    mapping_handle_ = nullptr;
+  }
+  if (file_handle_ != INVALID_HANDLE_VALUE) {
+    CloseHandle(file_handle_);
+    file_handle_ = INVALID_HANDLE_VALUE;
+  }
+  size_ = 0;
+}
+
+} // namespace ResourceLoader
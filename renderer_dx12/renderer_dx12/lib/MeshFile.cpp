@@ -0,0 +1,466 @@
+#include "stdafx.h"
+
+#include "MeshFile.h"
+
+#include <algorithm>
+#include <cstring>
+#include <iterator>
+#include <numeric>
+#include <sstream>
+#include <utility>
+
+#include "DebugOutput.h"
+#include "MeshOptimizer.h"
+#include "TextMeshParser.h"
+
+namespace ResourceLoader {
+
+namespace {
+
+constexpr MeshAttributeDesc kSourceMeshAttributes[] = {
+    {MeshAttributeSemantic::Position, MeshAttributeFormat::Float3,
+     offsetof(MeshSourceVertex, x), 0},
+    {MeshAttributeSemantic::TexCoord, MeshAttributeFormat::Float2,
+     offsetof(MeshSourceVertex, tu), 0},
+    {MeshAttributeSemantic::Normal, MeshAttributeFormat::Float3,
+     offsetof(MeshSourceVertex, nx), 0},
+};
+
+auto AlignUp(uint64_t value, uint64_t alignment) -> uint64_t {
+  return (value + alignment - 1) & ~(alignment - 1);
+}
+
+auto GetFormatSize(MeshAttributeFormat format) -> uint32_t {
+  switch (format) {
+  case MeshAttributeFormat::Float2:
+    return 8;
+  case MeshAttributeFormat::Float3:
+    return 12;
+  case MeshAttributeFormat::Float4:
+    return 16;
+  }
+  return 0;
+}
+
+void LogMeshMessage(const std::wstring &path, const wchar_t *message) {
+  std::wstringstream stream;
+  stream << L"[MeshFile] " << message << L": " << path << L"\n";
+  WriteDebugOutput(stream.str().c_str());
+}
+
+void LogOptimizationStats(const std::wstring &path,
+                          const MeshOptimizationStats &stats) {
+  std::wstringstream stream;
+  stream.precision(3);
+  stream << L"[MeshFile] " << path << L": vertices "
+         << stats.input_vertex_count << L" -> " << stats.vertex_count
+         << L", " << stats.index_size * 8 << L"-bit indices, ACMR "
+         << stats.before.acmr << L" -> " << stats.after.acmr << L", ATVR "
+         << stats.before.atvr << L" -> " << stats.after.atvr << L"\n";
+  WriteDebugOutput(stream.str().c_str());
+}
+
+auto ParseTextMesh(const std::wstring &text_path, const FileData &text,
+                   std::vector<MeshSourceVertex> &vertices) -> bool {
+  TextMeshParser parser(reinterpret_cast<const char *>(text.GetData()),
+                        text.GetSize());
+
+  uint32_t vertex_count = 0;
+  if (parser.ParseHeader(vertex_count)) {
+    vertices.resize(vertex_count);
+    if (parser.ParseVertices(vertices.data(), sizeof(MeshSourceVertex),
+                             vertex_count)) {
+      return true;
+    }
+  }
+
+  const std::string error = FormatTextMeshParseError(parser.GetError());
+  std::wstringstream stream;
+  stream << L"[MeshFile] " << text_path << L"("
+         << std::wstring(error.begin(), error.end()) << L")\n";
+  WriteDebugOutput(stream.str().c_str());
+  vertices.clear();
+  return false;
+}
+
+} // namespace
+
+auto GetSourceMeshAttributes(uint32_t &attribute_count)
+    -> const MeshAttributeDesc * {
+  attribute_count = static_cast<uint32_t>(std::size(kSourceMeshAttributes));
+  return kSourceMeshAttributes;
+}
+
+auto BuildMeshImage(const MeshImageDesc &desc, std::vector<uint8_t> &image)
+    -> bool {
+  if (!desc.attributes || desc.attribute_count == 0 ||
+      desc.attribute_count > kMaxMeshAttributes || !desc.vertices ||
+      desc.vertex_count == 0 || desc.vertex_stride == 0) {
+    return false;
+  }
+  if (desc.index_count > 0 &&
+      (!desc.indices || (desc.index_size != 2 && desc.index_size != 4))) {
+    return false;
+  }
+
+  MeshFileHeader header = {};
+  header.magic = kMeshFileMagic;
+  header.version = kMeshFileVersion;
+  header.header_size = sizeof(MeshFileHeader);
+  header.attribute_count = desc.attribute_count;
+  header.vertex_count = desc.vertex_count;
+  header.vertex_stride = desc.vertex_stride;
+  header.index_count = desc.index_count;
+  header.index_size = desc.index_count > 0 ? desc.index_size : 0;
+  header.source_size = desc.source.size;
+  header.source_write_time = desc.source.last_write_time;
+
+  const uint64_t attributes_end =
+      sizeof(MeshFileHeader) +
+      sizeof(MeshAttributeDesc) * static_cast<uint64_t>(desc.attribute_count);
+  header.vertex_offset = AlignUp(attributes_end, kMeshBlobAlignment);
+  header.vertex_bytes =
+      static_cast<uint64_t>(desc.vertex_stride) * desc.vertex_count;
+  header.index_offset = AlignUp(header.vertex_offset + header.vertex_bytes,
+                                kMeshBlobAlignment);
+  header.index_bytes =
+      static_cast<uint64_t>(header.index_size) * desc.index_count;
+
+  image.assign(static_cast<size_t>(header.index_offset + header.index_bytes),
+               0);
+  memcpy(image.data(), &header, sizeof(header));
+  memcpy(image.data() + sizeof(header), desc.attributes,
+         sizeof(MeshAttributeDesc) * desc.attribute_count);
+  memcpy(image.data() + header.vertex_offset, desc.vertices,
+         static_cast<size_t>(header.vertex_bytes));
+  if (header.index_bytes > 0) {
+    memcpy(image.data() + header.index_offset, desc.indices,
+           static_cast<size_t>(header.index_bytes));
+  }
+  return true;
+}
+
+auto ValidateMeshImage(const uint8_t *data, size_t size)
+    -> const MeshFileHeader * {
+  if (!data || size < sizeof(MeshFileHeader)) {
+    return nullptr;
+  }
+
+  const auto *header = reinterpret_cast<const MeshFileHeader *>(data);
+  if (header->magic != kMeshFileMagic || header->version != kMeshFileVersion ||
+      header->header_size != sizeof(MeshFileHeader)) {
+    return nullptr;
+  }
+  if (header->attribute_count == 0 ||
+      header->attribute_count > kMaxMeshAttributes ||
+      header->vertex_count == 0 || header->vertex_stride == 0) {
+    return nullptr;
+  }
+  if (header->index_count > 0 && header->index_size != 2 &&
+      header->index_size != 4) {
+    return nullptr;
+  }
+
+  // Every range is checked as offset > size - bytes once bytes <= size is
+  // known: the header is untrusted and offset + bytes could wrap.
+  const uint64_t attributes_end =
+      sizeof(MeshFileHeader) +
+      sizeof(MeshAttributeDesc) * static_cast<uint64_t>(header->attribute_count);
+  if (header->vertex_offset < attributes_end ||
+      header->vertex_offset % kMeshBlobAlignment != 0 ||
+      header->vertex_bytes !=
+          static_cast<uint64_t>(header->vertex_stride) * header->vertex_count ||
+      header->vertex_bytes > size ||
+      header->vertex_offset > size - header->vertex_bytes) {
+    return nullptr;
+  }
+  const uint64_t vertex_end = header->vertex_offset + header->vertex_bytes;
+  if (header->index_bytes !=
+          static_cast<uint64_t>(header->index_size) * header->index_count ||
+      (header->index_bytes > 0 &&
+       (header->index_offset < vertex_end ||
+        header->index_offset % kMeshBlobAlignment != 0 ||
+        header->index_bytes > size ||
+        header->index_offset > size - header->index_bytes))) {
+    return nullptr;
+  }
+
+  const auto *attributes =
+      reinterpret_cast<const MeshAttributeDesc *>(data + sizeof(MeshFileHeader));
+  for (uint32_t i = 0; i < header->attribute_count; ++i) {
+    const uint32_t format_size = GetFormatSize(attributes[i].format);
+    if (format_size == 0 || attributes[i].offset > header->vertex_stride ||
+        format_size > header->vertex_stride - attributes[i].offset) {
+      return nullptr;
+    }
+  }
+
+  return header;
+}
+
+auto MeshFile::Open(const std::wstring &mesh_path) -> bool {
+  FileData data;
+  if (!MapFile(mesh_path, data)) {
+    Close();
+    return false;
+  }
+
+  if (!OpenFromData(std::move(data))) {
+    LogMeshMessage(mesh_path, L"Invalid mesh cache");
+    return false;
+  }
+  return true;
+}
+
+auto MeshFile::OpenFromImage(std::vector<uint8_t> image) -> bool {
+  return OpenFromData(FileData(std::move(image)));
+}
+
+auto MeshFile::OpenFromData(FileData data) -> bool {
+  Close();
+
+  data_ = std::move(data);
+  header_ = ValidateMeshImage(data_.GetData(), data_.GetSize());
+  if (!header_) {
+    data_.Reset();
+    return false;
+  }
+  return true;
+}
+
+void MeshFile::Close() {
+  header_ = nullptr;
+  data_.Reset();
+}
+
+auto MeshFile::IsUpToDate(const FileStamp &source) const -> bool {
+  return header_ && header_->source_size == source.size &&
+         header_->source_write_time == source.last_write_time;
+}
+
+auto MeshFile::HasSourceLayout() const -> bool {
+  if (!header_ || header_->vertex_stride != sizeof(MeshSourceVertex) ||
+      header_->attribute_count != std::size(kSourceMeshAttributes)) {
+    return false;
+  }
+  return memcmp(GetAttributes(), kSourceMeshAttributes,
+                sizeof(kSourceMeshAttributes)) == 0;
+}
+
+auto MeshFile::GetAttributes() const -> const MeshAttributeDesc * {
+  return reinterpret_cast<const MeshAttributeDesc *>(GetImageData() +
+                                                     sizeof(MeshFileHeader));
+}
+
+auto MeshFile::GetVertexData() const -> const void * {
+  return GetImageData() + header_->vertex_offset;
+}
+
+auto MeshFile::CopySourceVertices(void *destination, size_t stride) const
+    -> bool {
+  if (!destination || stride < sizeof(MeshSourceVertex) || !HasSourceLayout()) {
+    return false;
+  }
+
+  const auto *source = static_cast<const uint8_t *>(GetVertexData());
+  auto *output = static_cast<uint8_t *>(destination);
+  if (stride == sizeof(MeshSourceVertex)) {
+    memcpy(output, source, GetVertexBytes());
+    return true;
+  }
+
+  for (uint32_t i = 0; i < header_->vertex_count; ++i) {
+    memcpy(output, source, sizeof(MeshSourceVertex));
+    source += sizeof(MeshSourceVertex);
+    output += stride;
+  }
+  return true;
+}
+
+auto MeshFile::CopyIndices(std::vector<uint32_t> &indices) const -> bool {
+  if (!header_) {
+    return false;
+  }
+
+  if (header_->index_count == 0) {
+    indices.resize(header_->vertex_count);
+    std::iota(indices.begin(), indices.end(), 0u);
+    return true;
+  }
+
+  indices.resize(header_->index_count);
+  if (header_->index_size == 4) {
+    memcpy(indices.data(), GetIndexData(), GetIndexBytes());
+  } else {
+    const auto *source = static_cast<const uint16_t *>(GetIndexData());
+    std::copy(source, source + header_->index_count, indices.begin());
+  }
+  return true;
+}
+
+auto MeshFile::GetIndexData() const -> const void * {
+  if (header_->index_count == 0) {
+    return nullptr;
+  }
+  return GetImageData() + header_->index_offset;
+}
+
+auto GetMeshCachePath(const std::wstring &text_path) -> std::wstring {
+  const auto dot = text_path.find_last_of(L'.');
+  const auto slash = text_path.find_last_of(L"\\/");
+  if (dot == std::wstring::npos ||
+      (slash != std::wstring::npos && dot < slash)) {
+    return text_path + L".mesh";
+  }
+  return text_path.substr(0, dot) + L".mesh";
+}
+
+auto LoadTextMesh(const std::wstring &text_path,
+                  std::vector<MeshSourceVertex> &vertices) -> bool {
+  FileData text;
+  if (!MapFile(text_path, text)) {
+    return false;
+  }
+  return ParseTextMesh(text_path, text, vertices);
+}
+
+auto CookTextMeshImage(const std::wstring &text_path, const FileData &text,
+                       const FileStamp &source, std::vector<uint8_t> &image)
+    -> bool {
+  std::vector<MeshSourceVertex> source_vertices;
+  if (!ParseTextMesh(text_path, text, source_vertices)) {
+    return false;
+  }
+
+  std::vector<uint8_t> vertices(
+      reinterpret_cast<const uint8_t *>(source_vertices.data()),
+      reinterpret_cast<const uint8_t *>(source_vertices.data() +
+                                        source_vertices.size()));
+  source_vertices = {};
+
+  std::vector<uint32_t> indices;
+  MeshOptimizationStats stats = {};
+  if (!OptimizeMesh(vertices, sizeof(MeshSourceVertex), indices, stats)) {
+    LogMeshMessage(text_path, L"Mesh is not a triangle list");
+    return false;
+  }
+  LogOptimizationStats(text_path, stats);
+
+  std::vector<uint8_t> packed_indices;
+  MeshImageDesc desc = {};
+  desc.attributes = GetSourceMeshAttributes(desc.attribute_count);
+  desc.vertices = vertices.data();
+  desc.vertex_count = stats.vertex_count;
+  desc.vertex_stride = sizeof(MeshSourceVertex);
+  desc.index_count = stats.index_count;
+  desc.index_size = PackIndices(indices, stats.vertex_count, packed_indices);
+  desc.indices = packed_indices.data();
+  desc.source = source;
+  return BuildMeshImage(desc, image);
+}
+
+auto OpenPlaceholderMesh(MeshFile &mesh) -> bool {
+  // Outward normal and the face's up axis; right = normal x up puts the
+  // corners in clockwise (front-facing) order seen from outside.
+  constexpr float kFaces[6][2][3] = {
+      {{1, 0, 0}, {0, 1, 0}},  {{-1, 0, 0}, {0, 1, 0}},
+      {{0, 1, 0}, {0, 0, 1}},  {{0, -1, 0}, {0, 0, -1}},
+      {{0, 0, 1}, {0, 1, 0}},  {{0, 0, -1}, {0, 1, 0}},
+  };
+  constexpr float kCorners[4][2] = {{-1, 1}, {1, 1}, {1, -1}, {-1, -1}};
+  constexpr uint16_t kFaceIndices[6] = {0, 1, 2, 0, 2, 3};
+
+  std::vector<MeshSourceVertex> vertices;
+  std::vector<uint16_t> indices;
+  for (const auto &face : kFaces) {
+    const float *normal = face[0];
+    const float *up = face[1];
+    const float right[3] = {normal[1] * up[2] - normal[2] * up[1],
+                            normal[2] * up[0] - normal[0] * up[2],
+                            normal[0] * up[1] - normal[1] * up[0]};
+
+    const auto base = static_cast<uint16_t>(vertices.size());
+    for (const auto &corner : kCorners) {
+      MeshSourceVertex vertex = {};
+      vertex.x = normal[0] + right[0] * corner[0] + up[0] * corner[1];
+      vertex.y = normal[1] + right[1] * corner[0] + up[1] * corner[1];
+      vertex.z = normal[2] + right[2] * corner[0] + up[2] * corner[1];
+      vertex.tu = (corner[0] + 1.0f) * 0.5f;
+      vertex.tv = (1.0f - corner[1]) * 0.5f;
+      vertex.nx = normal[0];
+      vertex.ny = normal[1];
+      vertex.nz = normal[2];
+      vertices.push_back(vertex);
+    }
+    for (const auto index : kFaceIndices) {
+      indices.push_back(static_cast<uint16_t>(base + index));
+    }
+  }
+
+  MeshImageDesc desc = {};
+  desc.attributes = GetSourceMeshAttributes(desc.attribute_count);
+  desc.vertices = vertices.data();
+  desc.vertex_count = static_cast<uint32_t>(vertices.size());
+  desc.vertex_stride = sizeof(MeshSourceVertex);
+  desc.indices = indices.data();
+  desc.index_count = static_cast<uint32_t>(indices.size());
+  desc.index_size = sizeof(uint16_t);
+
+  std::vector<uint8_t> image;
+  return BuildMeshImage(desc, image) && mesh.OpenFromImage(std::move(image));
+}
+
+namespace {
+
+auto BuildSourceMeshImage(const std::wstring &text_path,
+                          std::vector<uint8_t> &image) -> bool {
+  FileStamp source = {};
+  FileData text;
+  if (!GetFileStamp(text_path, source) || !MapFile(text_path, text)) {
+    return false;
+  }
+  return CookTextMeshImage(text_path, text, source, image);
+}
+
+} // namespace
+
+auto CookTextMesh(const std::wstring &text_path, const std::wstring &mesh_path)
+    -> bool {
+  std::vector<uint8_t> image;
+  if (!BuildSourceMeshImage(text_path, image)) {
+    return false;
+  }
+  return WriteFileAtomically(mesh_path, image);
+}
+
+auto OpenCookedMesh(const std::wstring &text_path, MeshFile &mesh) -> bool {
+  const std::wstring mesh_path = GetMeshCachePath(text_path);
+
+  FileStamp source = {};
+  const bool has_source = GetFileStamp(text_path, source);
+
+  if (mesh.Open(mesh_path) && mesh.HasSourceLayout() &&
+      (!has_source || mesh.IsUpToDate(source))) {
+    return true;
+  }
+  mesh.Close();
+
+  if (!has_source) {
+    LogMeshMessage(text_path, L"Mesh source not found");
+    return false;
+  }
+
+  std::vector<uint8_t> image;
+  if (!BuildSourceMeshImage(text_path, image)) {
+    return false;
+  }
+
+  if (WriteFileAtomically(mesh_path, image) && mesh.Open(mesh_path)) {
+    return true;
+  }
+
+  LogMeshMessage(mesh_path, L"Could not write mesh cache, using memory copy");
+  return mesh.OpenFromImage(std::move(image));
+}
+
+} // namespace ResourceLoader
@@ -0,0 +1,332 @@
+#include "stdafx.h"
+
+#include "MeshOptimizer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <numeric>
+
+namespace ResourceLoader {
+
+namespace {
+
+constexpr uint32_t kInvalidIndex = 0xffffffffu;
+
+// Forsyth's scoring constants, see "Linear-Speed Vertex Cache Optimisation".
+constexpr float kCacheDecayPower = 1.5f;
+constexpr float kLastTriangleScore = 0.75f;
+constexpr float kValenceBoostScale = 2.0f;
+constexpr float kValenceBoostPower = 0.5f;
+
+auto HashBytes(const uint8_t *data, size_t size) -> uint64_t {
+  uint64_t hash = 14695981039346656037ull;
+  for (size_t i = 0; i < size; ++i) {
+    hash ^= data[i];
+    hash *= 1099511628211ull;
+  }
+  return hash;
+}
+
+auto ComputeVertexScore(int cache_position, uint32_t live_triangles) -> float {
+  if (live_triangles == 0) {
+    return -1.0f;
+  }
+
+  float score = 0.0f;
+  if (cache_position >= 0) {
+    if (cache_position < 3) {
+      // The last triangle's vertices get a fixed score so the algorithm does
+      // not simply re-use the triangle it just emitted.
+      score = kLastTriangleScore;
+    } else {
+      const float scaler = 1.0f / static_cast<float>(kVertexCacheSize - 3);
+      score = powf(1.0f - static_cast<float>(cache_position - 3) * scaler,
+                   kCacheDecayPower);
+    }
+  }
+
+  score += kValenceBoostScale *
+           powf(static_cast<float>(live_triangles), -kValenceBoostPower);
+  return score;
+}
+
+} // namespace
+
+auto WeldVertices(std::vector<uint8_t> &vertices, uint32_t stride,
+                  std::vector<uint32_t> &indices) -> uint32_t {
+  if (stride == 0) {
+    indices.clear();
+    return 0;
+  }
+
+  const auto vertex_count = static_cast<uint32_t>(vertices.size() / stride);
+  indices.resize(vertex_count);
+
+  size_t table_size = 1;
+  while (table_size < static_cast<size_t>(vertex_count) * 2) {
+    table_size <<= 1;
+  }
+  const size_t mask = table_size - 1;
+  std::vector<uint32_t> table(table_size, kInvalidIndex);
+
+  uint32_t unique_count = 0;
+  for (uint32_t i = 0; i < vertex_count; ++i) {
+    const uint8_t *vertex = vertices.data() + static_cast<size_t>(i) * stride;
+    size_t slot = static_cast<size_t>(HashBytes(vertex, stride)) & mask;
+
+    for (;;) {
+      const uint32_t entry = table[slot];
+      if (entry == kInvalidIndex) {
+        // Compact in place; unique_count never runs ahead of i.
+        if (unique_count != i) {
+          memmove(vertices.data() + static_cast<size_t>(unique_count) * stride,
+                  vertex, stride);
+        }
+        table[slot] = unique_count;
+        indices[i] = unique_count++;
+        break;
+      }
+      if (memcmp(vertices.data() + static_cast<size_t>(entry) * stride, vertex,
+                 stride) == 0) {
+        indices[i] = entry;
+        break;
+      }
+      slot = (slot + 1) & mask;
+    }
+  }
+
+  vertices.resize(static_cast<size_t>(unique_count) * stride);
+  return unique_count;
+}
+
+void OptimizeVertexCache(std::vector<uint32_t> &indices,
+                         uint32_t vertex_count) {
+  const size_t triangle_count = indices.size() / 3;
+  if (triangle_count == 0 || vertex_count == 0) {
+    return;
+  }
+
+  // Vertex -> triangle adjacency; the first live_triangles[v] entries of each
+  // vertex range are the triangles not yet emitted.
+  std::vector<uint32_t> live_triangles(vertex_count, 0);
+  for (size_t i = 0; i < triangle_count * 3; ++i) {
+    ++live_triangles[indices[i]];
+  }
+
+  std::vector<uint32_t> adjacency_offsets(vertex_count + 1, 0);
+  for (uint32_t v = 0; v < vertex_count; ++v) {
+    adjacency_offsets[v + 1] = adjacency_offsets[v] + live_triangles[v];
+  }
+
+  std::vector<uint32_t> adjacency(triangle_count * 3);
+  {
+    std::vector<uint32_t> fill(adjacency_offsets.begin(),
+                               adjacency_offsets.end() - 1);
+    for (size_t t = 0; t < triangle_count; ++t) {
+      for (size_t k = 0; k < 3; ++k) {
+        adjacency[fill[indices[t * 3 + k]]++] = static_cast<uint32_t>(t);
+      }
+    }
+  }
+
+  std::vector<float> vertex_scores(vertex_count);
+  for (uint32_t v = 0; v < vertex_count; ++v) {
+    vertex_scores[v] = ComputeVertexScore(-1, live_triangles[v]);
+  }
+
+  auto triangle_score = [&](size_t t) {
+    return vertex_scores[indices[t * 3]] + vertex_scores[indices[t * 3 + 1]] +
+           vertex_scores[indices[t * 3 + 2]];
+  };
+
+  std::vector<bool> emitted(triangle_count, false);
+  std::vector<uint32_t> result;
+  result.reserve(triangle_count * 3);
+
+  uint32_t cache[kVertexCacheSize + 3] = {};
+  size_t cache_count = 0;
+
+  size_t best_triangle = 0;
+  float best_score = -1.0f;
+  for (size_t t = 0; t < triangle_count; ++t) {
+    const float score = triangle_score(t);
+    if (score > best_score) {
+      best_score = score;
+      best_triangle = t;
+    }
+  }
+
+  size_t fallback_cursor = 0;
+  for (size_t n = 0; n < triangle_count; ++n) {
+    if (best_triangle == SIZE_MAX) {
+      // Nothing adjacent to the cache is left; continue in input order.
+      while (emitted[fallback_cursor]) {
+        ++fallback_cursor;
+      }
+      best_triangle = fallback_cursor;
+    }
+
+    const size_t triangle = best_triangle;
+    emitted[triangle] = true;
+
+    const uint32_t corners[3] = {indices[triangle * 3],
+                                 indices[triangle * 3 + 1],
+                                 indices[triangle * 3 + 2]};
+    result.insert(result.end(), corners, corners + 3);
+
+    for (uint32_t v : corners) {
+      auto begin = adjacency.begin() + adjacency_offsets[v];
+      auto end = begin + live_triangles[v];
+      auto it = std::find(begin, end, static_cast<uint32_t>(triangle));
+      if (it != end) {
+        std::iter_swap(it, end - 1);
+        --live_triangles[v];
+      }
+    }
+
+    uint32_t new_cache[kVertexCacheSize + 3] = {};
+    size_t new_count = 0;
+    for (uint32_t v : corners) {
+      new_cache[new_count++] = v;
+    }
+    for (size_t i = 0; i < cache_count; ++i) {
+      const uint32_t v = cache[i];
+      if (v != corners[0] && v != corners[1] && v != corners[2]) {
+        new_cache[new_count++] = v;
+      }
+    }
+
+    for (size_t i = kVertexCacheSize; i < new_count; ++i) {
+      vertex_scores[new_cache[i]] =
+          ComputeVertexScore(-1, live_triangles[new_cache[i]]);
+    }
+
+    cache_count = std::min<size_t>(new_count, kVertexCacheSize);
+    std::copy(new_cache, new_cache + cache_count, cache);
+    for (size_t i = 0; i < cache_count; ++i) {
+      vertex_scores[cache[i]] =
+          ComputeVertexScore(static_cast<int>(i), live_triangles[cache[i]]);
+    }
+
+    best_triangle = SIZE_MAX;
+    best_score = -1.0f;
+    for (size_t i = 0; i < cache_count; ++i) {
+      const uint32_t v = cache[i];
+      const uint32_t *begin = adjacency.data() + adjacency_offsets[v];
+      for (uint32_t j = 0; j < live_triangles[v]; ++j) {
+        const float score = triangle_score(begin[j]);
+        if (score > best_score) {
+          best_score = score;
+          best_triangle = begin[j];
+        }
+      }
+    }
+  }
+
+  indices.swap(result);
+}
+
+auto OptimizeVertexFetch(std::vector<uint8_t> &vertices, uint32_t stride,
+                         std::vector<uint32_t> &indices) -> uint32_t {
+  if (stride == 0) {
+    return 0;
+  }
+
+  const auto vertex_count = static_cast<uint32_t>(vertices.size() / stride);
+  std::vector<uint32_t> remap(vertex_count, kInvalidIndex);
+
+  uint32_t next_vertex = 0;
+  for (auto &index : indices) {
+    if (remap[index] == kInvalidIndex) {
+      remap[index] = next_vertex++;
+    }
+    index = remap[index];
+  }
+
+  std::vector<uint8_t> reordered(static_cast<size_t>(next_vertex) * stride);
+  for (uint32_t v = 0; v < vertex_count; ++v) {
+    if (remap[v] != kInvalidIndex) {
+      memcpy(reordered.data() + static_cast<size_t>(remap[v]) * stride,
+             vertices.data() + static_cast<size_t>(v) * stride, stride);
+    }
+  }
+
+  vertices.swap(reordered);
+  return next_vertex;
+}
+
+auto AnalyzeVertexCache(const std::vector<uint32_t> &indices,
+                        uint32_t vertex_count, uint32_t cache_size)
+    -> VertexCacheStats {
+  VertexCacheStats stats = {};
+  if (indices.size() < 3 || vertex_count == 0 || cache_size == 0) {
+    return stats;
+  }
+
+  // FIFO cache simulated with per-vertex insertion timestamps.
+  std::vector<uint32_t> timestamps(vertex_count, 0);
+  uint32_t time = cache_size + 1;
+  uint32_t misses = 0;
+  for (uint32_t index : indices) {
+    if (time - timestamps[index] > cache_size) {
+      timestamps[index] = time++;
+      ++misses;
+    }
+  }
+
+  stats.acmr = static_cast<float>(misses) /
+               static_cast<float>(indices.size() / 3);
+  stats.atvr = static_cast<float>(misses) / static_cast<float>(vertex_count);
+  return stats;
+}
+
+auto SelectIndexSize(uint32_t vertex_count) -> uint32_t {
+  return vertex_count <= 0xffffu ? 2 : 4;
+}
+
+auto PackIndices(const std::vector<uint32_t> &indices, uint32_t vertex_count,
+                 std::vector<uint8_t> &packed) -> uint32_t {
+  const uint32_t index_size = SelectIndexSize(vertex_count);
+  packed.resize(indices.size() * index_size);
+  if (index_size == 4) {
+    memcpy(packed.data(), indices.data(), packed.size());
+  } else {
+    auto *output = reinterpret_cast<uint16_t *>(packed.data());
+    for (size_t i = 0; i < indices.size(); ++i) {
+      output[i] = static_cast<uint16_t>(indices[i]);
+    }
+  }
+  return index_size;
+}
+
+auto OptimizeMesh(std::vector<uint8_t> &vertices, uint32_t stride,
+                  std::vector<uint32_t> &indices,
+                  MeshOptimizationStats &stats) -> bool {
+  if (stride == 0 || vertices.size() % stride != 0) {
+    return false;
+  }
+
+  const auto input_count = static_cast<uint32_t>(vertices.size() / stride);
+  if (input_count < 3 || input_count % 3 != 0) {
+    return false;
+  }
+
+  stats = {};
+  stats.input_vertex_count = input_count;
+
+  indices.resize(input_count);
+  std::iota(indices.begin(), indices.end(), 0u);
+  stats.before = AnalyzeVertexCache(indices, input_count);
+
+  const uint32_t welded_count = WeldVertices(vertices, stride, indices);
+  OptimizeVertexCache(indices, welded_count);
+  stats.vertex_count = OptimizeVertexFetch(vertices, stride, indices);
+
+  stats.index_count = static_cast<uint32_t>(indices.size());
+  stats.index_size = SelectIndexSize(stats.vertex_count);
+  stats.after = AnalyzeVertexCache(indices, stats.vertex_count);
+  return true;
+}
+
+} // namespace ResourceLoader
@@ -0,0 +1,391 @@
+#include "stdafx.h"
+
+#include "MipGenerator.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <utility>
+
+#include "JobSystem.h"
+
+#if defined(_M_X64) || defined(_M_AMD64) || defined(__SSE2__)
+#define MIP_GENERATOR_USE_SSE 1
+#include <emmintrin.h>
+#else
+#define MIP_GENERATOR_USE_SSE 0
+#endif
+
+namespace ResourceLoader {
+
+namespace {
+
+constexpr size_t kChannelCount = 4;
+
+// Levels with fewer texels than this are filtered on the calling thread.
+constexpr size_t kParallelTexelThreshold = 16384;
+
+// Half-width in destination texels and shape of the Kaiser window.
+constexpr double kKaiserWidth = 3.0;
+constexpr double kKaiserAlpha = 4.0;
+
+constexpr double kPi = 3.14159265358979323846;
+
+// Per destination texel of one axis: tap_count source texels (clamped to the
+// edge) and their normalized weights.
+struct AxisFilter {
+  uint32_t tap_count = 0;
+  std::vector<uint32_t> taps = {};
+  std::vector<float> weights = {};
+};
+
+auto BesselI0(double x) -> double {
+  double sum = 1.0;
+  double term = 1.0;
+  const double half_x = x * 0.5;
+  for (int k = 1; k < 32; ++k) {
+    term *= (half_x / k) * (half_x / k);
+    sum += term;
+    if (term < sum * 1e-12) {
+      break;
+    }
+  }
+  return sum;
+}
+
+auto KaiserSinc(double t) -> double {
+  const double ratio = t / kKaiserWidth;
+  if (ratio * ratio >= 1.0) {
+    return 0.0;
+  }
+  const double sinc = t == 0.0 ? 1.0 : std::sin(kPi * t) / (kPi * t);
+  const double window = BesselI0(kKaiserAlpha * std::sqrt(1.0 - ratio * ratio)) /
+                        BesselI0(kKaiserAlpha);
+  return sinc * window;
+}
+
+auto BuildAxisFilter(uint32_t source_size, uint32_t destination_size,
+                     MipFilter filter) -> AxisFilter {
+  AxisFilter result = {};
+  if (source_size == destination_size) {
+    result.tap_count = 1;
+    result.taps.resize(destination_size);
+    result.weights.assign(destination_size, 1.0f);
+    for (uint32_t x = 0; x < destination_size; ++x) {
+      result.taps[x] = x;
+    }
+    return result;
+  }
+
+  const double scale = static_cast<double>(source_size) / destination_size;
+  // Half-width of the footprint in source texels.
+  const double support =
+      filter == MipFilter::kBox ? 0.5 * scale : kKaiserWidth * scale;
+
+  result.tap_count = static_cast<uint32_t>(std::ceil(2.0 * support)) + 1;
+  result.taps.resize(static_cast<size_t>(destination_size) * result.tap_count);
+  result.weights.resize(result.taps.size());
+
+  for (uint32_t x = 0; x < destination_size; ++x) {
+    const double center = (x + 0.5) * scale;
+    const int64_t first = static_cast<int64_t>(std::floor(center - support));
+    uint32_t *taps = &result.taps[static_cast<size_t>(x) * result.tap_count];
+    float *weights =
+        &result.weights[static_cast<size_t>(x) * result.tap_count];
+
+    double total = 0.0;
+    for (uint32_t k = 0; k < result.tap_count; ++k) {
+      const int64_t texel = first + k;
+      double weight = 0.0;
+      if (filter == MipFilter::kBox) {
+        weight = std::min<double>(texel + 1, center + support) -
+                 std::max<double>(texel, center - support);
+        weight = std::max(weight, 0.0);
+      } else {
+        weight = KaiserSinc((texel + 0.5 - center) / scale);
+      }
+      taps[k] = static_cast<uint32_t>(
+          std::clamp<int64_t>(texel, 0, int64_t{source_size} - 1));
+      weights[k] = static_cast<float>(weight);
+      total += weight;
+    }
+
+    for (uint32_t k = 0; k < result.tap_count; ++k) {
+      weights[k] = static_cast<float>(weights[k] / total);
+    }
+  }
+
+  return result;
+}
+
+auto BuildSrgbToLinearTable() -> std::array<float, 256> {
+  std::array<float, 256> table = {};
+  for (size_t i = 0; i < table.size(); ++i) {
+    const double value = i / 255.0;
+    table[i] = static_cast<float>(
+        value <= 0.04045 ? value / 12.92
+                         : std::pow((value + 0.055) / 1.055, 2.4));
+  }
+  return table;
+}
+
+auto LinearToSrgb(float value) -> float {
+  value = std::clamp(value, 0.0f, 1.0f);
+  return value <= 0.0031308f
+             ? value * 12.92f
+             : 1.055f * std::pow(value, 1.0f / 2.4f) - 0.055f;
+}
+
+auto ToUnorm8(float value) -> uint8_t {
+  return static_cast<uint8_t>(std::clamp(value, 0.0f, 1.0f) * 255.0f + 0.5f);
+}
+
+void Normalize3(float *value) {
+  const float length_squared =
+      value[0] * value[0] + value[1] * value[1] + value[2] * value[2];
+  if (length_squared > 1e-12f) {
+    const float scale = 1.0f / std::sqrt(length_squared);
+    value[0] *= scale;
+    value[1] *= scale;
+    value[2] *= scale;
+  }
+}
+
+void DecodeRow(const uint8_t *source, size_t texel_count, TextureUsage usage,
+               float *destination) {
+  static const std::array<float, 256> srgb_to_linear =
+      BuildSrgbToLinearTable();
+
+  for (size_t i = 0; i < texel_count; ++i) {
+    const uint8_t *texel = source + i * kChannelCount;
+    float *value = destination + i * kChannelCount;
+    switch (usage) {
+    case TextureUsage::kColor:
+      value[0] = srgb_to_linear[texel[0]];
+      value[1] = srgb_to_linear[texel[1]];
+      value[2] = srgb_to_linear[texel[2]];
+      break;
+    case TextureUsage::kLinear:
+      value[0] = texel[0] / 255.0f;
+      value[1] = texel[1] / 255.0f;
+      value[2] = texel[2] / 255.0f;
+      break;
+    case TextureUsage::kNormalMap:
+      value[0] = texel[0] / 127.5f - 1.0f;
+      value[1] = texel[1] / 127.5f - 1.0f;
+      value[2] = texel[2] / 127.5f - 1.0f;
+      Normalize3(value);
+      break;
+    }
+    value[3] = texel[3] / 255.0f;
+  }
+}
+
+// Normal maps are renormalized in place, so the next level is filtered from
+// unit vectors too.
+void EncodeRow(float *source, size_t texel_count, TextureUsage usage,
+               uint8_t *destination) {
+  for (size_t i = 0; i < texel_count; ++i) {
+    float *value = source + i * kChannelCount;
+    uint8_t *texel = destination + i * kChannelCount;
+    switch (usage) {
+    case TextureUsage::kColor:
+      texel[0] = ToUnorm8(LinearToSrgb(value[0]));
+      texel[1] = ToUnorm8(LinearToSrgb(value[1]));
+      texel[2] = ToUnorm8(LinearToSrgb(value[2]));
+      break;
+    case TextureUsage::kLinear:
+      texel[0] = ToUnorm8(value[0]);
+      texel[1] = ToUnorm8(value[1]);
+      texel[2] = ToUnorm8(value[2]);
+      break;
+    case TextureUsage::kNormalMap:
+      Normalize3(value);
+      texel[0] = ToUnorm8(value[0] * 0.5f + 0.5f);
+      texel[1] = ToUnorm8(value[1] * 0.5f + 0.5f);
+      texel[2] = ToUnorm8(value[2] * 0.5f + 0.5f);
+      break;
+    }
+    texel[3] = ToUnorm8(value[3]);
+  }
+}
+
+// Each destination texel is a weighted sum of whole source texels; with SSE
+// one register holds all four channels.
+void FilterRowHorizontal(const float *source, const AxisFilter &filter,
+                         uint32_t destination_width, float *destination) {
+  const uint32_t tap_count = filter.tap_count;
+  for (uint32_t x = 0; x < destination_width; ++x) {
+    const uint32_t *taps = &filter.taps[static_cast<size_t>(x) * tap_count];
+    const float *weights =
+        &filter.weights[static_cast<size_t>(x) * tap_count];
+#if MIP_GENERATOR_USE_SSE
+    __m128 sum = _mm_setzero_ps();
+    for (uint32_t k = 0; k < tap_count; ++k) {
+      const __m128 texel = _mm_loadu_ps(source + taps[k] * kChannelCount);
+      sum = _mm_add_ps(sum, _mm_mul_ps(texel, _mm_set1_ps(weights[k])));
+    }
+    _mm_storeu_ps(destination + x * kChannelCount, sum);
+#else
+    float sum[kChannelCount] = {};
+    for (uint32_t k = 0; k < tap_count; ++k) {
+      const float *texel = source + taps[k] * kChannelCount;
+      for (size_t c = 0; c < kChannelCount; ++c) {
+        sum[c] += texel[c] * weights[k];
+      }
+    }
+    for (size_t c = 0; c < kChannelCount; ++c) {
+      destination[x * kChannelCount + c] = sum[c];
+    }
+#endif
+  }
+}
+
+// destination += weight * source over a whole row; count is a multiple of
+// four.
+void AccumulateRow(const float *source, float weight, size_t count,
+                   float *destination) {
+#if MIP_GENERATOR_USE_SSE
+  const __m128 weights = _mm_set1_ps(weight);
+  for (size_t i = 0; i < count; i += 4) {
+    const __m128 sum = _mm_add_ps(
+        _mm_loadu_ps(destination + i),
+        _mm_mul_ps(_mm_loadu_ps(source + i), weights));
+    _mm_storeu_ps(destination + i, sum);
+  }
+#else
+  for (size_t i = 0; i < count; ++i) {
+    destination[i] += source[i] * weight;
+  }
+#endif
+}
+
+template <typename Function>
+void ParallelRows(JobSystem &job_system, uint32_t row_count,
+                  uint32_t row_texels, bool allow_parallel,
+                  Function &&function) {
+  if (!allow_parallel || static_cast<size_t>(row_count) * row_texels <
+                             kParallelTexelThreshold) {
+    function(size_t{0}, size_t{row_count});
+    return;
+  }
+  job_system.ParallelFor(row_count, 0, function);
+}
+
+} // namespace
+
+auto GetMipLevelCount(uint32_t width, uint32_t height) -> uint32_t {
+  uint32_t count = 1;
+  while (width > 1 || height > 1) {
+    width = std::max(width / 2, 1u);
+    height = std::max(height / 2, 1u);
+    ++count;
+  }
+  return count;
+}
+
+auto LayoutMipChain(uint32_t width, uint32_t height,
+                    std::vector<MipLevel> &levels) -> size_t {
+  levels.clear();
+  if (width == 0 || height == 0) {
+    return 0;
+  }
+
+  size_t offset = 0;
+  const uint32_t level_count = GetMipLevelCount(width, height);
+  for (uint32_t i = 0; i < level_count; ++i) {
+    levels.push_back({offset, width, height});
+    offset += static_cast<size_t>(width) * height * kChannelCount;
+    width = std::max(width / 2, 1u);
+    height = std::max(height / 2, 1u);
+  }
+  return offset;
+}
+
+auto GenerateMipChain(JobSystem &job_system, uint8_t *pixels,
+                      const std::vector<MipLevel> &levels,
+                      const MipOptions &options) -> bool {
+  if (!pixels || levels.empty() || levels[0].width == 0 ||
+      levels[0].height == 0) {
+    return false;
+  }
+  for (size_t i = 1; i < levels.size(); ++i) {
+    if (levels[i].width != std::max(levels[i - 1].width / 2, 1u) ||
+        levels[i].height != std::max(levels[i - 1].height / 2, 1u)) {
+      return false;
+    }
+  }
+  if (levels.size() == 1) {
+    return true;
+  }
+
+  const TextureUsage usage = options.usage;
+  const uint32_t top_width = levels[0].width;
+  const size_t top_row_floats = static_cast<size_t>(top_width) * kChannelCount;
+
+  std::vector<float> previous(top_row_floats * levels[0].height);
+  std::vector<float> next = {};
+  std::vector<float> horizontal = {};
+
+  ParallelRows(job_system, levels[0].height, top_width,
+               options.allow_parallel, [&](size_t begin, size_t end) {
+                 for (size_t y = begin; y < end; ++y) {
+                   DecodeRow(pixels + levels[0].offset +
+                                 y * top_width * kChannelCount,
+                             top_width, usage,
+                             previous.data() + y * top_row_floats);
+                 }
+               });
+
+  for (size_t level = 1; level < levels.size(); ++level) {
+    const MipLevel &source = levels[level - 1];
+    const MipLevel &destination = levels[level];
+    const AxisFilter filter_x =
+        BuildAxisFilter(source.width, destination.width, options.filter);
+    const AxisFilter filter_y =
+        BuildAxisFilter(source.height, destination.height, options.filter);
+
+    const size_t source_row_floats =
+        static_cast<size_t>(source.width) * kChannelCount;
+    const size_t destination_row_floats =
+        static_cast<size_t>(destination.width) * kChannelCount;
+
+    // Rows of the source level narrowed to the destination width.
+    horizontal.resize(destination_row_floats * source.height);
+    ParallelRows(job_system, source.height, destination.width,
+                 options.allow_parallel, [&](size_t begin, size_t end) {
+                   for (size_t y = begin; y < end; ++y) {
+                     FilterRowHorizontal(
+                         previous.data() + y * source_row_floats, filter_x,
+                         destination.width,
+                         horizontal.data() + y * destination_row_floats);
+                   }
+                 });
+
+    next.assign(destination_row_floats * destination.height, 0.0f);
+    uint8_t *destination_pixels = pixels + destination.offset;
+    ParallelRows(
+        job_system, destination.height, destination.width,
+        options.allow_parallel, [&](size_t begin, size_t end) {
+          for (size_t y = begin; y < end; ++y) {
+            float *row = next.data() + y * destination_row_floats;
+            for (uint32_t k = 0; k < filter_y.tap_count; ++k) {
+              const size_t tap = y * filter_y.tap_count + k;
+              AccumulateRow(horizontal.data() +
+                                filter_y.taps[tap] * destination_row_floats,
+                            filter_y.weights[tap], destination_row_floats,
+                            row);
+            }
+            EncodeRow(row, destination.width, usage,
+                      destination_pixels +
+                          y * destination.width * kChannelCount);
+          }
+        });
+
+    std::swap(previous, next);
+  }
+
+  return true;
+}
+
+} // namespace ResourceLoader
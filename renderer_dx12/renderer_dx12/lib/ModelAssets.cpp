@@ -0,0 +1,170 @@
+#include "stdafx.h"
+
+#include "ModelAssets.h"
+
+#include <memory>
+#include <sstream>
+#include <utility>
+
+#include "AssetRegistry.h"
+#include "AssetStreamer.h"
+#include "DirectX12Device.h"
+#include "MeshFile.h"
+#include "TextureLoader.h"
+
+using namespace ResourceLoader;
+
+namespace {
+
+void LogModelMessage(const std::wstring &path, const wchar_t *message) {
+  std::wstringstream stream;
+  stream << L"[Model] " << message << L": " << path << L"\n";
+  OutputDebugStringW(stream.str().c_str());
+}
+
+// Builds mesh in mesh_layout and notes what it keeps on the GPU.
+auto BuildSharedMesh(const MeshBufferBuilder &build_mesh, const MeshFile &mesh,
+                     size_t &resident_bytes) -> std::shared_ptr<MeshBuffers> {
+  auto buffers = std::make_shared<MeshBuffers>();
+  if (!build_mesh(mesh, *buffers)) {
+    return nullptr;
+  }
+  resident_bytes =
+      static_cast<size_t>(buffers->vertex_buffer_view.SizeInBytes) +
+      buffers->index_buffer_view.SizeInBytes;
+  return buffers;
+}
+
+} // namespace
+
+auto CreateMeshBuffers(DirectX12Device &device, const void *vertices,
+                       UINT vertex_stride, UINT vertex_count,
+                       const MeshFile &mesh, MeshBuffers &buffers) -> bool {
+  if (!vertices || vertex_stride == 0 || vertex_count == 0 || !mesh.IsOpen() ||
+      mesh.GetIndexCount() == 0) {
+    return false;
+  }
+
+  MeshBuffers result = {};
+
+  const size_t vertex_buffer_size =
+      static_cast<size_t>(vertex_stride) * vertex_count;
+  if (!device.CreateDefaultBuffer(vertices, vertex_buffer_size,
+                                  result.vertex_buffer)) {
+    return false;
+  }
+
+  result.vertex_buffer_view.BufferLocation =
+      result.vertex_buffer->GetGPUVirtualAddress();
+  result.vertex_buffer_view.SizeInBytes =
+      static_cast<UINT>(vertex_buffer_size);
+  result.vertex_buffer_view.StrideInBytes = vertex_stride;
+
+  const size_t index_buffer_size = mesh.GetIndexBytes();
+  if (!device.CreateDefaultBuffer(mesh.GetIndexData(), index_buffer_size,
+                                  result.index_buffer)) {
+    return false;
+  }
+
+  result.index_buffer_view.BufferLocation =
+      result.index_buffer->GetGPUVirtualAddress();
+  result.index_buffer_view.SizeInBytes = static_cast<UINT>(index_buffer_size);
+  result.index_buffer_view.Format = mesh.GetIndexSize() == 2
+                                        ? DXGI_FORMAT_R16_UINT
+                                        : DXGI_FORMAT_R32_UINT;
+
+  result.index_count = mesh.GetIndexCount();
+  result.bounds = ComputeBoundingVolume(vertices, vertex_stride, vertex_count);
+
+  buffers = std::move(result);
+  return true;
+}
+
+auto ComputeWorldBounds(const MeshBuffers &mesh,
+                        const DirectX::XMMATRIX &world) -> BoundingVolume {
+  DirectX::XMFLOAT4X4 matrix;
+  DirectX::XMStoreFloat4x4(&matrix, world);
+  return TransformBoundingVolume(mesh.bounds, &matrix._11);
+}
+
+void ReplaceMeshBuffers(DirectX12Device &device, MeshHandle &current,
+                        MeshHandle next) {
+  // Other models may still hold the buffers; the deferred references only
+  // cover this model's frames in flight.
+  if (current) {
+    device.DeferRelease(current->vertex_buffer);
+    device.DeferRelease(current->index_buffer);
+  }
+  current = std::move(next);
+}
+
+auto CreatePlaceholderAssets(const MeshBufferBuilder &build_mesh,
+                             MeshLayout mesh_layout,
+                             unsigned int texture_count, MeshHandle &mesh,
+                             TextureLoader &textures) -> bool {
+  MeshFile placeholder;
+  if (!OpenPlaceholderMesh(placeholder)) {
+    return false;
+  }
+
+  const auto *vertices =
+      static_cast<const uint8_t *>(placeholder.GetVertexData());
+  const AssetKey key = {
+      AssetKind::kMesh,
+      HashAssetContent(vertices, placeholder.GetVertexBytes()),
+      static_cast<uint32_t>(mesh_layout)};
+  mesh = AssetRegistry::Instance().Acquire<MeshBuffers>(
+      key, [&](size_t &resident_bytes) {
+        return BuildSharedMesh(build_mesh, placeholder, resident_bytes);
+      });
+  if (!mesh) {
+    return false;
+  }
+  return textures.CreatePlaceholders(texture_count);
+}
+
+auto StreamModelAssets(DirectX12Device &device, AssetStreamer &streamer,
+                       std::wstring model_path,
+                       std::vector<std::wstring> texture_paths,
+                       MeshBufferBuilder build_mesh, MeshLayout mesh_layout,
+                       MeshHandle &mesh, TextureLoader &textures,
+                       std::vector<TextureUsage> texture_usages)
+    -> Task<void> {
+  co_await streamer.ResumeInBackground();
+
+  // The mesh is read, converted and uploaded only by the first model to ask
+  // for it; the rest share its buffers.
+  auto &registry = AssetRegistry::Instance();
+  MeshHandle buffers = nullptr;
+  uint64_t content_hash = 0;
+  if (registry.GetContentHash(streamer.GetFileSource(), model_path,
+                              content_hash)) {
+    const AssetKey key = {AssetKind::kMesh, content_hash,
+                          static_cast<uint32_t>(mesh_layout)};
+    buffers = registry.Acquire<MeshBuffers>(key, [&](size_t &resident_bytes) {
+      std::unique_ptr<MeshFile> mesh_file = streamer.ReadMesh(model_path);
+      return mesh_file
+                 ? BuildSharedMesh(build_mesh, *mesh_file, resident_bytes)
+                 : nullptr;
+    });
+  }
+  const bool has_mesh = buffers != nullptr;
+
+  TextureSet texture_set =
+      co_await textures.LoadTextureSet(streamer, std::move(texture_paths),
+                                       std::move(texture_usages));
+
+  co_await streamer.ResumeOnMainThread();
+
+  if (has_mesh) {
+    ReplaceMeshBuffers(device, mesh, std::move(buffers));
+  } else {
+    LogModelMessage(model_path, L"Keeping placeholder mesh");
+  }
+
+  if (texture_set.heap) {
+    textures.CommitTextureSet(std::move(texture_set));
+  } else {
+    LogModelMessage(model_path, L"Keeping placeholder textures");
+  }
+}
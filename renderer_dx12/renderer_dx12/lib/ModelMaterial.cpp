@@ -3,6 +3,7 @@
 #include "ModelMaterial.h"
 
 #include "DirectX12Device.h"
+#include "InstanceBuffer.h"
 #include "PipelineStateBuilder.h"
 #include "RootSignatureBuilder.h"
 #include "SceneLight.h"
@@ -37,6 +38,18 @@ auto ModelMaterial::Initialize() -> bool {
   return true;
 }
 
+void ModelMaterial::SetInstancedShaders(
+    const VertexShaderByteCode &vertex_shader,
+    const PixelShaderByteCode &pixel_shader) {
+  instanced_vs_bytecode_ = vertex_shader;
+  instanced_ps_bytecode_ = pixel_shader;
+}
+
+void ModelMaterial::SetClusteredPixelShader(
+    const PixelShaderByteCode &pixel_shader) {
+  clustered_ps_bytecode_ = pixel_shader;
+}
+
 auto ModelMaterial::UpdateMatrixConstant(const XMMATRIX &world,
                                          const XMMATRIX &view,
                                          const XMMATRIX &projection) -> bool {
@@ -91,11 +104,18 @@ auto ModelMaterial::InitializeRootSignature() -> bool {
   }
 
   RootSignatureBuilder builder;
-  builder.AddDescriptorTable(D3D12_DESCRIPTOR_RANGE_TYPE_SRV, 1, 0, 0,
+  // All three of the model's textures; the instanced pixel shader picks one
+  // per instance.
+  builder.AddDescriptorTable(D3D12_DESCRIPTOR_RANGE_TYPE_SRV, 3, 0, 0,
                              D3D12_SHADER_VISIBILITY_PIXEL);
   builder.AddConstantBufferView(0, 0, D3D12_SHADER_VISIBILITY_VERTEX);
   builder.AddConstantBufferView(0, 0, D3D12_SHADER_VISIBILITY_PIXEL);
   builder.AddConstantBufferView(1, 0, D3D12_SHADER_VISIBILITY_VERTEX);
+  // Clustered lights, left unbound by the other pipelines.
+  builder.AddConstantBufferView(2, 0, D3D12_SHADER_VISIBILITY_PIXEL);
+  builder.AddShaderResourceView(3, 0, D3D12_SHADER_VISIBILITY_PIXEL);
+  builder.AddShaderResourceView(4, 0, D3D12_SHADER_VISIBILITY_PIXEL);
+  builder.AddShaderResourceView(5, 0, D3D12_SHADER_VISIBILITY_PIXEL);
 
   D3D12_STATIC_SAMPLER_DESC sampler_desc = {};
   sampler_desc.Filter = D3D12_FILTER_MIN_MAG_MIP_POINT;
@@ -135,7 +155,7 @@ auto ModelMaterial::InitializeGraphicsPipelineState() -> bool {
     return false;
   }
 
-  D3D12_INPUT_ELEMENT_DESC input_element_descs[] = {
+  std::vector<D3D12_INPUT_ELEMENT_DESC> input_elements = {
       {"POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 0,
        D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0},
       {"TEXCOORD", 0, DXGI_FORMAT_R32G32_FLOAT, 0, D3D12_APPEND_ALIGNED_ELEMENT,
@@ -144,11 +164,49 @@ auto ModelMaterial::InitializeGraphicsPipelineState() -> bool {
        D3D12_APPEND_ALIGNED_ELEMENT, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA,
        0}};
 
+  PipelineStateObjectPtr pso = nullptr;
+  if (!BuildPipelineState(GetVSByteCode(), GetPSByteCode(), input_elements,
+                          pso)) {
+    return false;
+  }
+  SetPSOByName("model_normal", pso);
+
+  if (clustered_ps_bytecode_.pShaderBytecode != nullptr) {
+    PipelineStateObjectPtr clustered_pso = nullptr;
+    if (!BuildPipelineState(GetVSByteCode(), clustered_ps_bytecode_,
+                            input_elements, clustered_pso)) {
+      return false;
+    }
+    SetPSOByName("model_clustered", clustered_pso);
+  }
+
+  if (instanced_vs_bytecode_.pShaderBytecode == nullptr ||
+      instanced_ps_bytecode_.pShaderBytecode == nullptr) {
+    return true;
+  }
+
+  AppendInstanceInputElements(input_elements);
+  PipelineStateObjectPtr instanced_pso = nullptr;
+  if (!BuildPipelineState(instanced_vs_bytecode_, instanced_ps_bytecode_,
+                          input_elements, instanced_pso)) {
+    return false;
+  }
+  SetPSOByName("model_instanced", instanced_pso);
+
+  return true;
+}
+
+auto ModelMaterial::BuildPipelineState(
+    const VertexShaderByteCode &vertex_shader,
+    const PixelShaderByteCode &pixel_shader,
+    const std::vector<D3D12_INPUT_ELEMENT_DESC> &input_elements,
+    PipelineStateObjectPtr &pso) -> bool {
   GraphicsPipelineStateBuilder builder;
   builder.SetRootSignature(GetRootSignature());
-  builder.SetVertexShader(GetVSByteCode());
-  builder.SetPixelShader(GetPSByteCode());
-  builder.SetInputLayout(input_element_descs, _countof(input_element_descs));
+  builder.SetVertexShader(vertex_shader);
+  builder.SetPixelShader(pixel_shader);
+  builder.SetInputLayout(input_elements.data(),
+                         static_cast<UINT>(input_elements.size()));
   builder.SetPrimitiveTopologyType(D3D12_PRIMITIVE_TOPOLOGY_TYPE_TRIANGLE);
 
   const DXGI_FORMAT rtv_formats[] = {DXGI_FORMAT_R8G8B8A8_UNORM};
@@ -158,13 +216,7 @@ auto ModelMaterial::InitializeGraphicsPipelineState() -> bool {
   builder.SetBlendState(CD3DX12_BLEND_DESC(D3D12_DEFAULT));
   builder.SetDepthStencilState(CD3DX12_DEPTH_STENCIL_DESC(D3D12_DEFAULT));
 
-  PipelineStateObjectPtr pso = nullptr;
-  if (!builder.Build(device_, pso)) {
-    return false;
-  }
-  SetPSOByName("model_normal", pso);
-
-  return true;
+  return builder.Build(device_, pso);
 }
 
 
@@ -3,6 +3,7 @@
 #include "PBRMaterial.h"
 
 #include "DirectX12Device.h"
+#include "InstanceBuffer.h"
 #include "PipelineStateBuilder.h"
 #include "RootSignatureBuilder.h"
 #include "SceneLight.h"
@@ -14,6 +15,17 @@ PBRMaterial::PBRMaterial(std::shared_ptr<DirectX12Device> device)
 
 PBRMaterial::~PBRMaterial() = default;
 
+void PBRMaterial::SetInstancedShaders(const VertexShaderByteCode &vertex_shader,
+                                      const PixelShaderByteCode &pixel_shader) {
+  instanced_vs_bytecode_ = vertex_shader;
+  instanced_ps_bytecode_ = pixel_shader;
+}
+
+void PBRMaterial::SetClusteredPixelShader(
+    const PixelShaderByteCode &pixel_shader) {
+  clustered_ps_bytecode_ = pixel_shader;
+}
+
 auto PBRMaterial::Initialize() -> bool {
   if (!device_) {
     return false;
@@ -85,16 +97,19 @@ auto PBRMaterial::UpdateFromLight(const Lighting::SceneLight *scene_light)
   return UpdateLightConstant(direction);
 }
 
-auto PBRMaterial::GetMatrixConstantBuffer() const -> ResourceSharedPtr {
-  return matrix_constant_buffer_.GetResource();
+auto PBRMaterial::GetMatrixConstantBufferAddress() const
+    -> D3D12_GPU_VIRTUAL_ADDRESS {
+  return matrix_constant_buffer_.GetGPUVirtualAddress();
 }
 
-auto PBRMaterial::GetCameraConstantBuffer() const -> ResourceSharedPtr {
-  return camera_constant_buffer_.GetResource();
+auto PBRMaterial::GetCameraConstantBufferAddress() const
+    -> D3D12_GPU_VIRTUAL_ADDRESS {
+  return camera_constant_buffer_.GetGPUVirtualAddress();
 }
 
-auto PBRMaterial::GetLightConstantBuffer() const -> ResourceSharedPtr {
-  return light_constant_buffer_.GetResource();
+auto PBRMaterial::GetLightConstantBufferAddress() const
+    -> D3D12_GPU_VIRTUAL_ADDRESS {
+  return light_constant_buffer_.GetGPUVirtualAddress();
 }
 
 auto PBRMaterial::InitializeRootSignature() -> bool {
@@ -108,6 +123,11 @@ auto PBRMaterial::InitializeRootSignature() -> bool {
   builder.AddConstantBufferView(0, 0, D3D12_SHADER_VISIBILITY_VERTEX);
   builder.AddConstantBufferView(1, 0, D3D12_SHADER_VISIBILITY_VERTEX);
   builder.AddConstantBufferView(2, 0, D3D12_SHADER_VISIBILITY_PIXEL);
+  // Clustered lights, left unbound by the other pipelines.
+  builder.AddConstantBufferView(3, 0, D3D12_SHADER_VISIBILITY_PIXEL);
+  builder.AddShaderResourceView(3, 0, D3D12_SHADER_VISIBILITY_PIXEL);
+  builder.AddShaderResourceView(4, 0, D3D12_SHADER_VISIBILITY_PIXEL);
+  builder.AddShaderResourceView(5, 0, D3D12_SHADER_VISIBILITY_PIXEL);
 
   D3D12_STATIC_SAMPLER_DESC sampler_desc = {};
   sampler_desc.Filter = D3D12_FILTER_MIN_MAG_MIP_LINEAR;
@@ -145,7 +165,7 @@ auto PBRMaterial::InitializeGraphicsPipelineState() -> bool {
     return false;
   }
 
-  D3D12_INPUT_ELEMENT_DESC input_layout[] = {
+  std::vector<D3D12_INPUT_ELEMENT_DESC> input_elements = {
       {"POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 0,
        D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0},
       {"TEXCOORD", 0, DXGI_FORMAT_R32G32_FLOAT, 0, D3D12_APPEND_ALIGNED_ELEMENT,
@@ -153,18 +173,53 @@ auto PBRMaterial::InitializeGraphicsPipelineState() -> bool {
       {"NORMAL", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0,
        D3D12_APPEND_ALIGNED_ELEMENT, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA,
        0},
-      {"TANGENT", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0,
-       D3D12_APPEND_ALIGNED_ELEMENT, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA,
-       0},
-      {"BINORMAL", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0,
+      {"TANGENT", 0, DXGI_FORMAT_R32G32B32A32_FLOAT, 0,
        D3D12_APPEND_ALIGNED_ELEMENT, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA,
        0}};
 
+  PipelineStateObjectPtr pso = nullptr;
+  if (!BuildPipelineState(GetVSByteCode(), GetPSByteCode(), input_elements,
+                          pso)) {
+    return false;
+  }
+  SetPSOByName("pbr_pipeline", pso);
+
+  if (clustered_ps_bytecode_.pShaderBytecode != nullptr) {
+    PipelineStateObjectPtr clustered_pso = nullptr;
+    if (!BuildPipelineState(GetVSByteCode(), clustered_ps_bytecode_,
+                            input_elements, clustered_pso)) {
+      return false;
+    }
+    SetPSOByName("pbr_clustered", clustered_pso);
+  }
+
+  if (instanced_vs_bytecode_.pShaderBytecode == nullptr ||
+      instanced_ps_bytecode_.pShaderBytecode == nullptr) {
+    return true;
+  }
+
+  AppendInstanceInputElements(input_elements);
+  PipelineStateObjectPtr instanced_pso = nullptr;
+  if (!BuildPipelineState(instanced_vs_bytecode_, instanced_ps_bytecode_,
+                          input_elements, instanced_pso)) {
+    return false;
+  }
+  SetPSOByName("pbr_instanced", instanced_pso);
+
+  return true;
+}
+
+auto PBRMaterial::BuildPipelineState(
+    const VertexShaderByteCode &vertex_shader,
+    const PixelShaderByteCode &pixel_shader,
+    const std::vector<D3D12_INPUT_ELEMENT_DESC> &input_elements,
+    PipelineStateObjectPtr &pso) -> bool {
   GraphicsPipelineStateBuilder builder;
   builder.SetRootSignature(GetRootSignature());
-  builder.SetVertexShader(GetVSByteCode());
-  builder.SetPixelShader(GetPSByteCode());
-  builder.SetInputLayout(input_layout, _countof(input_layout));
+  builder.SetVertexShader(vertex_shader);
+  builder.SetPixelShader(pixel_shader);
+  builder.SetInputLayout(input_elements.data(),
+                         static_cast<UINT>(input_elements.size()));
   builder.SetPrimitiveTopologyType(D3D12_PRIMITIVE_TOPOLOGY_TYPE_TRIANGLE);
 
   const DXGI_FORMAT rtv_formats[] = {DXGI_FORMAT_R8G8B8A8_UNORM};
@@ -174,12 +229,5 @@ auto PBRMaterial::InitializeGraphicsPipelineState() -> bool {
   builder.SetBlendState(CD3DX12_BLEND_DESC(D3D12_DEFAULT));
   builder.SetDepthStencilState(CD3DX12_DEPTH_STENCIL_DESC(D3D12_DEFAULT));
 
-  PipelineStateObjectPtr pso = nullptr;
-  if (!builder.Build(device_, pso)) {
-    return false;
-  }
-
-  SetPSOByName("pbr_pipeline", pso);
-
-  return true;
+  return builder.Build(device_, pso);
 }
@@ -0,0 +1,264 @@
+#include "stdafx.h"
+
+#include "PipelineCache.h"
+
+#include <sstream>
+
+namespace {
+
+auto DescribeShader(const D3D12_SHADER_BYTECODE &shader) -> PipelineBytecode {
+  return {shader.pShaderBytecode, shader.BytecodeLength};
+}
+
+auto DescribeRenderTargetBlend(const D3D12_RENDER_TARGET_BLEND_DESC &target)
+    -> PipelineRenderTargetBlend {
+  PipelineRenderTargetBlend blend;
+  blend.blend_enable = target.BlendEnable;
+  blend.logic_op_enable = target.LogicOpEnable;
+  blend.src_blend = target.SrcBlend;
+  blend.dest_blend = target.DestBlend;
+  blend.blend_op = target.BlendOp;
+  blend.src_blend_alpha = target.SrcBlendAlpha;
+  blend.dest_blend_alpha = target.DestBlendAlpha;
+  blend.blend_op_alpha = target.BlendOpAlpha;
+  blend.logic_op = target.LogicOp;
+  blend.write_mask = target.RenderTargetWriteMask;
+  return blend;
+}
+
+auto DescribeStencilFace(const D3D12_DEPTH_STENCILOP_DESC &face)
+    -> PipelineStencilFace {
+  return {static_cast<uint32_t>(face.StencilFailOp),
+          static_cast<uint32_t>(face.StencilDepthFailOp),
+          static_cast<uint32_t>(face.StencilPassOp),
+          static_cast<uint32_t>(face.StencilFunc)};
+}
+
+void LogCacheLine(std::wstringstream &stream, const wchar_t *name,
+                  uint64_t hits, uint64_t misses, size_t count) {
+  stream << L"[PipelineCache] " << name << L": " << hits << L" hits, "
+         << misses << L" misses, " << count << L" unique\n";
+}
+
+} // namespace
+
+void DescribeGraphicsPipeline(const D3D12_GRAPHICS_PIPELINE_STATE_DESC &desc,
+                              DescribedGraphicsPipeline &described) {
+  GraphicsPipelineDescription &description = described.description;
+  description = {};
+  description.root_signature =
+      reinterpret_cast<uintptr_t>(desc.pRootSignature);
+  description.vertex_shader = DescribeShader(desc.VS);
+  description.pixel_shader = DescribeShader(desc.PS);
+  description.domain_shader = DescribeShader(desc.DS);
+  description.hull_shader = DescribeShader(desc.HS);
+  description.geometry_shader = DescribeShader(desc.GS);
+
+  const D3D12_STREAM_OUTPUT_DESC &stream_output = desc.StreamOutput;
+  described.stream_output_entries.clear();
+  if (stream_output.pSODeclaration != nullptr) {
+    for (UINT i = 0; i < stream_output.NumEntries; ++i) {
+      const D3D12_SO_DECLARATION_ENTRY &entry = stream_output.pSODeclaration[i];
+      described.stream_output_entries.push_back(
+          {entry.Stream, entry.SemanticName, entry.SemanticIndex,
+           entry.StartComponent, entry.ComponentCount, entry.OutputSlot});
+    }
+  }
+  description.stream_output.entries = described.stream_output_entries.data();
+  description.stream_output.entry_count =
+      static_cast<uint32_t>(described.stream_output_entries.size());
+  description.stream_output.buffer_strides = stream_output.pBufferStrides;
+  description.stream_output.stride_count = stream_output.NumStrides;
+  description.stream_output.rasterized_stream = stream_output.RasterizedStream;
+
+  const D3D12_BLEND_DESC &blend = desc.BlendState;
+  description.blend.alpha_to_coverage_enable = blend.AlphaToCoverageEnable;
+  description.blend.independent_blend_enable = blend.IndependentBlendEnable;
+  static_assert(_countof(blend.RenderTarget) == kPipelineRenderTargetCount,
+                "Blend target count differs from the SDK");
+  for (uint32_t i = 0; i < kPipelineRenderTargetCount; ++i) {
+    description.blend.render_targets[i] =
+        DescribeRenderTargetBlend(blend.RenderTarget[i]);
+  }
+  description.sample_mask = desc.SampleMask;
+
+  const D3D12_RASTERIZER_DESC &rasterizer = desc.RasterizerState;
+  description.rasterizer.fill_mode = rasterizer.FillMode;
+  description.rasterizer.cull_mode = rasterizer.CullMode;
+  description.rasterizer.front_counter_clockwise =
+      rasterizer.FrontCounterClockwise;
+  description.rasterizer.depth_bias = rasterizer.DepthBias;
+  description.rasterizer.depth_bias_clamp = rasterizer.DepthBiasClamp;
+  description.rasterizer.slope_scaled_depth_bias =
+      rasterizer.SlopeScaledDepthBias;
+  description.rasterizer.depth_clip_enable = rasterizer.DepthClipEnable;
+  description.rasterizer.multisample_enable = rasterizer.MultisampleEnable;
+  description.rasterizer.antialiased_line_enable =
+      rasterizer.AntialiasedLineEnable;
+  description.rasterizer.forced_sample_count = rasterizer.ForcedSampleCount;
+  description.rasterizer.conservative_raster = rasterizer.ConservativeRaster;
+
+  const D3D12_DEPTH_STENCIL_DESC &depth_stencil = desc.DepthStencilState;
+  description.depth_stencil.depth_enable = depth_stencil.DepthEnable;
+  description.depth_stencil.depth_write_mask = depth_stencil.DepthWriteMask;
+  description.depth_stencil.depth_func = depth_stencil.DepthFunc;
+  description.depth_stencil.stencil_enable = depth_stencil.StencilEnable;
+  description.depth_stencil.stencil_read_mask = depth_stencil.StencilReadMask;
+  description.depth_stencil.stencil_write_mask =
+      depth_stencil.StencilWriteMask;
+  description.depth_stencil.front_face =
+      DescribeStencilFace(depth_stencil.FrontFace);
+  description.depth_stencil.back_face =
+      DescribeStencilFace(depth_stencil.BackFace);
+
+  const D3D12_INPUT_LAYOUT_DESC &input_layout = desc.InputLayout;
+  described.input_elements.clear();
+  if (input_layout.pInputElementDescs != nullptr) {
+    for (UINT i = 0; i < input_layout.NumElements; ++i) {
+      const D3D12_INPUT_ELEMENT_DESC &element =
+          input_layout.pInputElementDescs[i];
+      described.input_elements.push_back(
+          {element.SemanticName, element.SemanticIndex,
+           static_cast<uint32_t>(element.Format), element.InputSlot,
+           element.AlignedByteOffset,
+           static_cast<uint32_t>(element.InputSlotClass),
+           element.InstanceDataStepRate});
+    }
+  }
+  description.input_elements = described.input_elements.data();
+  description.input_element_count =
+      static_cast<uint32_t>(described.input_elements.size());
+
+  description.strip_cut_value = desc.IBStripCutValue;
+  description.primitive_topology_type = desc.PrimitiveTopologyType;
+  description.render_target_count = desc.NumRenderTargets;
+  for (uint32_t i = 0; i < kPipelineRenderTargetCount; ++i) {
+    description.render_target_formats[i] = desc.RTVFormats[i];
+  }
+  description.depth_stencil_format = desc.DSVFormat;
+  description.sample_count = desc.SampleDesc.Count;
+  description.sample_quality = desc.SampleDesc.Quality;
+  description.node_mask = desc.NodeMask;
+  description.cached_pipeline = {desc.CachedPSO.pCachedBlob,
+                                 desc.CachedPSO.CachedBlobSizeInBytes};
+  description.flags = desc.Flags;
+}
+
+void CanonicalizeGraphicsPipelineDesc(
+    const D3D12_GRAPHICS_PIPELINE_STATE_DESC &desc, std::vector<uint8_t> &key) {
+  DescribedGraphicsPipeline described;
+  DescribeGraphicsPipeline(desc, described);
+  CanonicalizePipelineDescription(described.description, key);
+}
+
+auto PipelineCache::GetRootSignature(ID3D12Device *device,
+                                     const void *serialized, size_t size,
+                                     RootSignaturePtr &root_signature)
+    -> bool {
+  if (device == nullptr || serialized == nullptr || size == 0) {
+    return false;
+  }
+
+  const auto *bytes = static_cast<const uint8_t *>(serialized);
+  std::vector<uint8_t> key(bytes, bytes + size);
+  const uint64_t hash = HashPipelineKey(key);
+
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (const auto &entry : root_signatures_[hash]) {
+      if (entry.key == key) {
+        ++stats_.root_signature_hits;
+        root_signature = entry.root_signature;
+        return true;
+      }
+    }
+  }
+
+  RootSignaturePtr created = nullptr;
+  if (FAILED(device->CreateRootSignature(0, serialized, size,
+                                         IID_PPV_ARGS(&created)))) {
+    return false;
+  }
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto &bucket = root_signatures_[hash];
+  for (const auto &entry : bucket) {
+    if (entry.key == key) {
+      ++stats_.root_signature_hits;
+      root_signature = entry.root_signature;
+      return true;
+    }
+  }
+  ++stats_.root_signature_misses;
+  ++stats_.root_signature_count;
+  bucket.push_back({std::move(key), created});
+  root_signature = created;
+  return true;
+}
+
+auto PipelineCache::GetGraphicsPipelineState(
+    ID3D12Device *device, const D3D12_GRAPHICS_PIPELINE_STATE_DESC &desc,
+    PipelineStateObjectPtr &pipeline_state) -> bool {
+  if (device == nullptr) {
+    return false;
+  }
+
+  std::vector<uint8_t> key;
+  CanonicalizeGraphicsPipelineDesc(desc, key);
+  const uint64_t hash = HashPipelineKey(key);
+
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (const auto &entry : pipeline_states_[hash]) {
+      if (entry.key == key) {
+        ++stats_.pipeline_state_hits;
+        pipeline_state = entry.pipeline_state;
+        return true;
+      }
+    }
+  }
+
+  PipelineStateObjectPtr created = nullptr;
+  if (FAILED(device->CreateGraphicsPipelineState(&desc,
+                                                 IID_PPV_ARGS(&created)))) {
+    return false;
+  }
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto &bucket = pipeline_states_[hash];
+  for (const auto &entry : bucket) {
+    if (entry.key == key) {
+      ++stats_.pipeline_state_hits;
+      pipeline_state = entry.pipeline_state;
+      return true;
+    }
+  }
+  ++stats_.pipeline_state_misses;
+  ++stats_.pipeline_state_count;
+  bucket.push_back({std::move(key), created, desc.pRootSignature});
+  pipeline_state = created;
+  return true;
+}
+
+auto PipelineCache::GetStats() const -> PipelineCacheStats {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return stats_;
+}
+
+void PipelineCache::LogStats() const {
+  const PipelineCacheStats stats = GetStats();
+  std::wstringstream stream;
+  LogCacheLine(stream, L"root signatures", stats.root_signature_hits,
+               stats.root_signature_misses, stats.root_signature_count);
+  LogCacheLine(stream, L"pipeline states", stats.pipeline_state_hits,
+               stats.pipeline_state_misses, stats.pipeline_state_count);
+  OutputDebugStringW(stream.str().c_str());
+}
+
+void PipelineCache::Clear() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  root_signatures_.clear();
+  pipeline_states_.clear();
+  stats_.root_signature_count = 0;
+  stats_.pipeline_state_count = 0;
+}
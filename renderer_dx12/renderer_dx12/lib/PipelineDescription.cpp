@@ -0,0 +1,192 @@
+#include "stdafx.h"
+
+#include "PipelineDescription.h"
+
+#include <algorithm>
+#include <cstring>
+#include <type_traits>
+
+#include "AssetRegistry.h"
+
+namespace {
+
+class KeyWriter {
+public:
+  explicit KeyWriter(std::vector<uint8_t> &key) : key_(key) {}
+
+  template <typename T> void Write(const T &value) {
+    static_assert(std::is_arithmetic<T>::value || std::is_enum<T>::value,
+                  "Write fields one by one so padding stays out of the key");
+    WriteBytes(&value, sizeof(value));
+  }
+
+  void WriteString(const char *value) {
+    const size_t length = value != nullptr ? strlen(value) : 0;
+    Write(static_cast<uint32_t>(length));
+    WriteBytes(value, length);
+  }
+
+  void WriteBlob(const PipelineBytecode &blob) {
+    Write(static_cast<uint64_t>(blob.data != nullptr ? blob.size : 0));
+    if (blob.data != nullptr) {
+      WriteBytes(blob.data, blob.size);
+    }
+  }
+
+private:
+  void WriteBytes(const void *data, size_t size) {
+    const auto *bytes = static_cast<const uint8_t *>(data);
+    key_.insert(key_.end(), bytes, bytes + size);
+  }
+
+  std::vector<uint8_t> &key_;
+};
+
+void WriteBlendState(KeyWriter &writer, const PipelineBlendState &blend) {
+  writer.Write(blend.alpha_to_coverage_enable);
+  writer.Write(blend.independent_blend_enable);
+
+  // Without independent blending every target uses render_targets[0].
+  const uint32_t target_count =
+      blend.independent_blend_enable ? kPipelineRenderTargetCount : 1;
+  for (uint32_t i = 0; i < target_count; ++i) {
+    const PipelineRenderTargetBlend &target = blend.render_targets[i];
+    writer.Write(target.blend_enable);
+    if (target.blend_enable) {
+      writer.Write(target.src_blend);
+      writer.Write(target.dest_blend);
+      writer.Write(target.blend_op);
+      writer.Write(target.src_blend_alpha);
+      writer.Write(target.dest_blend_alpha);
+      writer.Write(target.blend_op_alpha);
+    }
+    writer.Write(target.logic_op_enable);
+    if (target.logic_op_enable) {
+      writer.Write(target.logic_op);
+    }
+    writer.Write(target.write_mask);
+  }
+}
+
+void WriteRasterizerState(KeyWriter &writer,
+                          const PipelineRasterizerState &rasterizer) {
+  writer.Write(rasterizer.fill_mode);
+  writer.Write(rasterizer.cull_mode);
+  writer.Write(rasterizer.front_counter_clockwise);
+  writer.Write(rasterizer.depth_bias);
+  writer.Write(rasterizer.depth_bias_clamp);
+  writer.Write(rasterizer.slope_scaled_depth_bias);
+  writer.Write(rasterizer.depth_clip_enable);
+  writer.Write(rasterizer.multisample_enable);
+  writer.Write(rasterizer.antialiased_line_enable);
+  writer.Write(rasterizer.forced_sample_count);
+  writer.Write(rasterizer.conservative_raster);
+}
+
+void WriteStencilFace(KeyWriter &writer, const PipelineStencilFace &face) {
+  writer.Write(face.fail_op);
+  writer.Write(face.depth_fail_op);
+  writer.Write(face.pass_op);
+  writer.Write(face.func);
+}
+
+void WriteDepthStencilState(KeyWriter &writer,
+                            const PipelineDepthStencilState &depth_stencil) {
+  writer.Write(depth_stencil.depth_enable);
+  if (depth_stencil.depth_enable) {
+    writer.Write(depth_stencil.depth_write_mask);
+    writer.Write(depth_stencil.depth_func);
+  }
+  writer.Write(depth_stencil.stencil_enable);
+  if (depth_stencil.stencil_enable) {
+    writer.Write(depth_stencil.stencil_read_mask);
+    writer.Write(depth_stencil.stencil_write_mask);
+    WriteStencilFace(writer, depth_stencil.front_face);
+    WriteStencilFace(writer, depth_stencil.back_face);
+  }
+}
+
+void WriteInputLayout(KeyWriter &writer,
+                      const GraphicsPipelineDescription &description) {
+  const uint32_t element_count = description.input_elements != nullptr
+                                     ? description.input_element_count
+                                     : 0;
+  writer.Write(element_count);
+  for (uint32_t i = 0; i < element_count; ++i) {
+    const PipelineInputElement &element = description.input_elements[i];
+    writer.WriteString(element.semantic_name);
+    writer.Write(element.semantic_index);
+    writer.Write(element.format);
+    writer.Write(element.input_slot);
+    writer.Write(element.aligned_byte_offset);
+    writer.Write(element.input_slot_class);
+    writer.Write(element.instance_data_step_rate);
+  }
+}
+
+void WriteStreamOutput(KeyWriter &writer,
+                       const PipelineStreamOutput &stream_output) {
+  const uint32_t entry_count =
+      stream_output.entries != nullptr ? stream_output.entry_count : 0;
+  writer.Write(entry_count);
+  for (uint32_t i = 0; i < entry_count; ++i) {
+    const PipelineStreamOutputEntry &entry = stream_output.entries[i];
+    writer.Write(entry.stream);
+    writer.WriteString(entry.semantic_name);
+    writer.Write(entry.semantic_index);
+    writer.Write(entry.start_component);
+    writer.Write(entry.component_count);
+    writer.Write(entry.output_slot);
+  }
+
+  const uint32_t stride_count = stream_output.buffer_strides != nullptr
+                                    ? stream_output.stride_count
+                                    : 0;
+  writer.Write(stride_count);
+  for (uint32_t i = 0; i < stride_count; ++i) {
+    writer.Write(stream_output.buffer_strides[i]);
+  }
+  if (entry_count > 0) {
+    writer.Write(stream_output.rasterized_stream);
+  }
+}
+
+} // namespace
+
+void CanonicalizePipelineDescription(
+    const GraphicsPipelineDescription &description, std::vector<uint8_t> &key) {
+  key.clear();
+  KeyWriter writer(key);
+
+  writer.Write(description.root_signature);
+  writer.WriteBlob(description.vertex_shader);
+  writer.WriteBlob(description.pixel_shader);
+  writer.WriteBlob(description.domain_shader);
+  writer.WriteBlob(description.hull_shader);
+  writer.WriteBlob(description.geometry_shader);
+  WriteStreamOutput(writer, description.stream_output);
+  WriteBlendState(writer, description.blend);
+  writer.Write(description.sample_mask);
+  WriteRasterizerState(writer, description.rasterizer);
+  WriteDepthStencilState(writer, description.depth_stencil);
+  WriteInputLayout(writer, description);
+  writer.Write(description.strip_cut_value);
+  writer.Write(description.primitive_topology_type);
+
+  const uint32_t render_target_count =
+      (std::min)(description.render_target_count, kPipelineRenderTargetCount);
+  writer.Write(render_target_count);
+  for (uint32_t i = 0; i < render_target_count; ++i) {
+    writer.Write(description.render_target_formats[i]);
+  }
+  writer.Write(description.depth_stencil_format);
+  writer.Write(description.sample_count);
+  writer.Write(description.sample_quality);
+  writer.Write(description.node_mask);
+  writer.WriteBlob(description.cached_pipeline);
+  writer.Write(description.flags);
+}
+
+auto HashPipelineKey(const std::vector<uint8_t> &key) -> uint64_t {
+  return ResourceLoader::HashAssetContent(key.data(), key.size());
+}
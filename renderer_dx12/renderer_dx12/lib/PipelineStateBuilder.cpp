@@ -85,9 +85,8 @@ bool GraphicsPipelineStateBuilder::Build(
     return false;
   }
 
-  auto hr = d3d_device->CreateGraphicsPipelineState(
-      &desc_, IID_PPV_ARGS(&pipeline_state));
-  return SUCCEEDED(hr);
+  return device->GetPipelineCache().GetGraphicsPipelineState(
+      d3d_device.Get(), desc_, pipeline_state);
 }
 
 
@@ -36,14 +36,14 @@ auto ReflectionFloorMaterial::Initialize() -> bool {
   return true;
 }
 
-auto ReflectionFloorMaterial::GetMatrixConstantBuffer() const
-    -> ResourceSharedPtr {
-  return matrix_constant_buffer_.GetResource();
+auto ReflectionFloorMaterial::GetMatrixConstantBufferAddress() const
+    -> D3D12_GPU_VIRTUAL_ADDRESS {
+  return matrix_constant_buffer_.GetGPUVirtualAddress();
 }
 
-auto ReflectionFloorMaterial::GetReflectionConstantBuffer() const
-    -> ResourceSharedPtr {
-  return reflection_constant_buffer_.GetResource();
+auto ReflectionFloorMaterial::GetReflectionConstantBufferAddress() const
+    -> D3D12_GPU_VIRTUAL_ADDRESS {
+  return reflection_constant_buffer_.GetGPUVirtualAddress();
 }
 
 auto ReflectionFloorMaterial::UpdateMatrixConstant(const XMMATRIX &world,
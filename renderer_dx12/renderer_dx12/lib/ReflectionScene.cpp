@@ -115,10 +115,6 @@ auto ReflectionScene::Initialize() -> bool {
     return false;
   }
 
-  if (!BuildFloorDescriptorHeap()) {
-    return false;
-  }
-
   return true;
 }
 
@@ -128,7 +124,6 @@ auto ReflectionScene::Shutdown() -> void {
   cube_material_.reset();
   floor_material_.reset();
   render_texture_.reset();
-  floor_descriptor_heap_.Reset();
   shaders_loaded_ = false;
 }
 
@@ -150,46 +145,46 @@ auto ReflectionScene::Render(const XMMATRIX &view,
     return false;
   }
 
-  const XMMATRIX world = XMMatrixRotationY(rotation_radians_) *
-                         XMMatrixTranslation(cube_position_.x, cube_position_.y,
-                                             cube_position_.z);
+  const XMMATRIX world = GetCubeWorldMatrix();
   const XMMATRIX world_t = XMMatrixTranspose(world);
   const XMMATRIX view_t = XMMatrixTranspose(view);
   const XMMATRIX projection_t = XMMatrixTranspose(projection);
 
-  if (!cube_material_->UpdateMatrixConstant(world_t, view_t, projection_t)) {
-    return false;
-  }
+  const FrustumPlanes frustum = Camera::BuildFrustumPlanes(view, projection);
 
-  auto cube_srv = cube_model_->GetShaderResourceView();
-  auto cube_matrix_cb = cube_material_->GetMatrixConstantBuffer();
-  if (!cube_srv || !cube_matrix_cb) {
-    return false;
-  }
+  if (IsVisible(frustum, cube_model_->GetWorldBounds(world))) {
+    if (!cube_material_->UpdateMatrixConstant(world_t, view_t, projection_t)) {
+      return false;
+    }
 
-  auto cube_root_signature = cube_material_->GetRootSignature();
-  auto cube_pso = cube_material_->GetPSOByName("reflection_texture_main");
-  if (!cube_root_signature || !cube_pso) {
-    return false;
-  }
+    auto cube_srv = cube_model_->GetShaderResourceView();
+    auto cube_matrix_cb = cube_material_->GetMatrixConstantBufferAddress();
+    if (!cube_srv.ptr || !cube_matrix_cb) {
+      return false;
+    }
 
-  device_->SetGraphicsRootSignature(cube_root_signature);
-  device_->SetPipelineStateObject(cube_pso);
+    auto cube_root_signature = cube_material_->GetRootSignature();
+    auto cube_pso = cube_material_->GetPSOByName("reflection_texture_main");
+    if (!cube_root_signature || !cube_pso) {
+      return false;
+    }
 
-  ID3D12DescriptorHeap *cube_heaps[] = {cube_srv.Get()};
-  device_->SetDescriptorHeaps(1, cube_heaps);
-  device_->SetGraphicsRootDescriptorTable(
-      0, cube_srv->GetGPUDescriptorHandleForHeapStart());
-  device_->SetGraphicsRootConstantBufferView(
-      1, cube_matrix_cb->GetGPUVirtualAddress());
+    device_->SetGraphicsRootSignature(cube_root_signature);
+    device_->SetPipelineStateObject(cube_pso);
 
-  device_->BindVertexBuffer(0, 1, &cube_model_->GetVertexBufferView());
-  device_->BindIndexBuffer(&cube_model_->GetIndexBufferView());
-  device_->Draw(cube_model_->GetIndexCount());
+    device_->SetGraphicsRootDescriptorTable(0, cube_srv);
+    device_->SetGraphicsRootConstantBufferView(1, cube_matrix_cb);
+
+    device_->BindVertexBuffer(0, 1, &cube_model_->GetVertexBufferView());
+    device_->BindIndexBuffer(&cube_model_->GetIndexBufferView());
+    device_->Draw(cube_model_->GetIndexCount());
+  }
+
+  const XMMATRIX floor_world = GetFloorWorldMatrix();
+  if (!IsVisible(frustum, floor_model_->GetWorldBounds(floor_world))) {
+    return true;
+  }
 
-  const XMMATRIX floor_world =
-      XMMatrixScaling(floor_scale_, 1.0f, floor_scale_) *
-      XMMatrixTranslation(0.0f, reflection_plane_height_, 0.0f);
   const XMMATRIX floor_world_t = XMMatrixTranspose(floor_world);
   if (!floor_material_->UpdateMatrixConstant(floor_world_t, view_t,
                                              projection_t)) {
@@ -203,9 +198,21 @@ auto ReflectionScene::Render(const XMMATRIX &view,
     return false;
   }
 
-  auto floor_matrix_cb = floor_material_->GetMatrixConstantBuffer();
-  auto floor_reflection_cb = floor_material_->GetReflectionConstantBuffer();
-  if (!floor_descriptor_heap_ || !floor_matrix_cb || !floor_reflection_cb) {
+  auto floor_matrix_cb = floor_material_->GetMatrixConstantBufferAddress();
+  auto floor_reflection_cb =
+      floor_material_->GetReflectionConstantBufferAddress();
+  if (!floor_matrix_cb || !floor_reflection_cb) {
+    return false;
+  }
+
+  // The floor samples its own texture and the reflection target; the pair
+  // is put together each frame, so a streamed-in texture shows up at once.
+  const D3D12_CPU_DESCRIPTOR_HANDLE floor_views[] = {
+      floor_model_->GetTextureStagingView(0),
+      render_texture_->GetStagingView()};
+  D3D12_GPU_DESCRIPTOR_HANDLE floor_table = {};
+  if (!floor_views[0].ptr || !floor_views[1].ptr ||
+      !device_->AllocateTransientTable(2, floor_views, floor_table)) {
     return false;
   }
 
@@ -218,14 +225,9 @@ auto ReflectionScene::Render(const XMMATRIX &view,
   device_->SetGraphicsRootSignature(floor_root_signature);
   device_->SetPipelineStateObject(floor_pso);
 
-  ID3D12DescriptorHeap *floor_heaps[] = {floor_descriptor_heap_.Get()};
-  device_->SetDescriptorHeaps(1, floor_heaps);
-  device_->SetGraphicsRootDescriptorTable(
-      0, floor_descriptor_heap_->GetGPUDescriptorHandleForHeapStart());
-  device_->SetGraphicsRootConstantBufferView(
-      1, floor_matrix_cb->GetGPUVirtualAddress());
-  device_->SetGraphicsRootConstantBufferView(
-      2, floor_reflection_cb->GetGPUVirtualAddress());
+  device_->SetGraphicsRootDescriptorTable(0, floor_table);
+  device_->SetGraphicsRootConstantBufferView(1, floor_matrix_cb);
+  device_->SetGraphicsRootConstantBufferView(2, floor_reflection_cb);
 
   device_->BindVertexBuffer(0, 1, &floor_model_->GetVertexBufferView());
   device_->BindIndexBuffer(&floor_model_->GetIndexBufferView());
@@ -234,6 +236,31 @@ auto ReflectionScene::Render(const XMMATRIX &view,
   return true;
 }
 
+auto ReflectionScene::GetCubeWorldBounds() const -> BoundingVolume {
+  if (!cube_model_) {
+    return {};
+  }
+  return cube_model_->GetWorldBounds(GetCubeWorldMatrix());
+}
+
+auto ReflectionScene::GetFloorWorldBounds() const -> BoundingVolume {
+  if (!floor_model_) {
+    return {};
+  }
+  return floor_model_->GetWorldBounds(GetFloorWorldMatrix());
+}
+
+auto ReflectionScene::GetCubeWorldMatrix() const -> XMMATRIX {
+  return XMMatrixRotationY(rotation_radians_) *
+         XMMatrixTranslation(cube_position_.x, cube_position_.y,
+                             cube_position_.z);
+}
+
+auto ReflectionScene::GetFloorWorldMatrix() const -> XMMATRIX {
+  return XMMatrixScaling(floor_scale_, 1.0f, floor_scale_) *
+         XMMatrixTranslation(0.0f, reflection_plane_height_, 0.0f);
+}
+
 auto ReflectionScene::RenderReflectionTexture(const XMMATRIX &projection)
     -> bool {
   if (!render_texture_ || !cube_model_ || !cube_material_) {
@@ -248,21 +275,26 @@ auto ReflectionScene::RenderReflectionTexture(const XMMATRIX &projection)
 
   XMMATRIX reflection_view = camera_->GetReflectionViewMatrix();
 
-  const XMMATRIX world = XMMatrixRotationY(rotation_radians_) *
-                         XMMatrixTranslation(cube_position_.x, cube_position_.y,
-                                             cube_position_.z);
+  const XMMATRIX world = GetCubeWorldMatrix();
   const XMMATRIX world_t = XMMatrixTranspose(world);
   const XMMATRIX view_t = XMMatrixTranspose(reflection_view);
   const XMMATRIX projection_t = XMMatrixTranspose(projection);
 
+  // The target is still cleared, so the floor reflects nothing.
+  if (!IsVisible(Camera::BuildFrustumPlanes(reflection_view, projection),
+                 cube_model_->GetWorldBounds(world))) {
+    render_texture_->EndRender();
+    return true;
+  }
+
   if (!cube_material_->UpdateMatrixConstant(world_t, view_t, projection_t)) {
     render_texture_->EndRender();
     return false;
   }
 
   auto cube_srv = cube_model_->GetShaderResourceView();
-  auto cube_matrix_cb = cube_material_->GetMatrixConstantBuffer();
-  if (!cube_srv || !cube_matrix_cb) {
+  auto cube_matrix_cb = cube_material_->GetMatrixConstantBufferAddress();
+  if (!cube_srv.ptr || !cube_matrix_cb) {
     render_texture_->EndRender();
     return false;
   }
@@ -277,12 +309,8 @@ auto ReflectionScene::RenderReflectionTexture(const XMMATRIX &projection)
   device_->SetGraphicsRootSignature(root_signature);
   device_->SetPipelineStateObject(pso);
 
-  ID3D12DescriptorHeap *heaps[] = {cube_srv.Get()};
-  device_->SetDescriptorHeaps(1, heaps);
-  device_->SetGraphicsRootDescriptorTable(
-      0, cube_srv->GetGPUDescriptorHandleForHeapStart());
-  device_->SetGraphicsRootConstantBufferView(
-      1, cube_matrix_cb->GetGPUVirtualAddress());
+  device_->SetGraphicsRootDescriptorTable(0, cube_srv);
+  device_->SetGraphicsRootConstantBufferView(1, cube_matrix_cb);
 
   device_->BindVertexBuffer(0, 1, &cube_model_->GetVertexBufferView());
   device_->BindIndexBuffer(&cube_model_->GetIndexBufferView());
@@ -292,67 +320,3 @@ auto ReflectionScene::RenderReflectionTexture(const XMMATRIX &projection)
   return true;
 }
 
-auto ReflectionScene::BuildFloorDescriptorHeap() -> bool {
-  if (!device_ || !floor_model_ || !render_texture_) {
-    return false;
-  }
-
-  auto base_texture = floor_model_->GetTextureResource(0);
-  auto reflection_texture = render_texture_->GetTexture();
-  if (!base_texture || !reflection_texture) {
-    return false;
-  }
-
-  auto d3d_device = device_->GetD3d12Device();
-  if (!d3d_device) {
-    return false;
-  }
-
-  floor_descriptor_heap_.Reset();
-
-  D3D12_DESCRIPTOR_HEAP_DESC heap_desc = {};
-  heap_desc.NumDescriptors = 2;
-  heap_desc.Type = D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV;
-  heap_desc.Flags = D3D12_DESCRIPTOR_HEAP_FLAG_SHADER_VISIBLE;
-
-  if (FAILED(d3d_device->CreateDescriptorHeap(&heap_desc,
-                                              IID_PPV_ARGS(&floor_descriptor_heap_)))) {
-    return false;
-  }
-
-  UINT increment_size =
-      d3d_device->GetDescriptorHandleIncrementSize(
-          D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
-
-  CD3DX12_CPU_DESCRIPTOR_HANDLE dest_handle(
-      floor_descriptor_heap_->GetCPUDescriptorHandleForHeapStart());
-
-  D3D12_SHADER_RESOURCE_VIEW_DESC base_srv_desc = {};
-  auto base_desc = base_texture->GetDesc();
-  base_srv_desc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
-  base_srv_desc.ViewDimension = D3D12_SRV_DIMENSION_TEXTURE2D;
-  base_srv_desc.Format = base_desc.Format;
-  base_srv_desc.Texture2D.MipLevels = base_desc.MipLevels;
-  base_srv_desc.Texture2D.MostDetailedMip = 0;
-  base_srv_desc.Texture2D.ResourceMinLODClamp = 0.0f;
-
-  d3d_device->CreateShaderResourceView(base_texture.Get(), &base_srv_desc,
-                                       dest_handle);
-
-  dest_handle.Offset(1, increment_size);
-
-  D3D12_SHADER_RESOURCE_VIEW_DESC reflection_srv_desc = {};
-  auto reflection_desc = reflection_texture->GetDesc();
-  reflection_srv_desc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
-  reflection_srv_desc.ViewDimension = D3D12_SRV_DIMENSION_TEXTURE2D;
-  reflection_srv_desc.Format = reflection_desc.Format;
-  reflection_srv_desc.Texture2D.MipLevels = reflection_desc.MipLevels;
-  reflection_srv_desc.Texture2D.MostDetailedMip = 0;
-  reflection_srv_desc.Texture2D.ResourceMinLODClamp = 0.0f;
-
-  d3d_device->CreateShaderResourceView(reflection_texture.Get(),
-                                       &reflection_srv_desc, dest_handle);
-
-  return true;
-}
-
@@ -32,9 +32,9 @@ auto ReflectionTextureMaterial::Initialize() -> bool {
   return true;
 }
 
-auto ReflectionTextureMaterial::GetMatrixConstantBuffer() const
-    -> ResourceSharedPtr {
-  return matrix_constant_buffer_.GetResource();
+auto ReflectionTextureMaterial::GetMatrixConstantBufferAddress() const
+    -> D3D12_GPU_VIRTUAL_ADDRESS {
+  return matrix_constant_buffer_.GetGPUVirtualAddress();
 }
 
 auto ReflectionTextureMaterial::UpdateMatrixConstant(const XMMATRIX &world,
@@ -0,0 +1,151 @@
+#include "stdafx.h"
+
+#include "RenderQueue.h"
+
+#include <algorithm>
+#include <utility>
+
+namespace {
+
+constexpr uint32_t kDrawSortStateBits = kDrawSortPipelineStateBits +
+                                        kDrawSortRootSignatureBits +
+                                        kDrawSortMaterialBits;
+
+constexpr uint32_t kDrawSortPassShift = 64 - kDrawSortPassBits;
+
+constexpr uint32_t kDrawSortLayerShift =
+    kDrawSortPassShift - kDrawSortLayerBits;
+
+constexpr uint32_t kMaxSortDepth = (1u << kDrawSortDepthBits) - 1;
+
+auto KeyField(uint32_t value, uint32_t bits) -> uint64_t {
+  return value & ((1u << bits) - 1);
+}
+
+} // namespace
+
+auto MakeDrawSortKey(uint32_t pass, RenderLayer layer, uint32_t depth,
+                     const DrawPacket &packet) -> uint64_t {
+  const uint64_t state =
+      (KeyField(packet.pipeline_state, kDrawSortPipelineStateBits)
+       << (kDrawSortRootSignatureBits + kDrawSortMaterialBits)) |
+      (KeyField(packet.root_signature, kDrawSortRootSignatureBits)
+       << kDrawSortMaterialBits) |
+      KeyField(packet.material, kDrawSortMaterialBits);
+
+  uint64_t key =
+      (KeyField(pass, kDrawSortPassBits) << kDrawSortPassShift) |
+      (KeyField(static_cast<uint32_t>(layer), kDrawSortLayerBits)
+       << kDrawSortLayerShift);
+
+  uint64_t depth_field = KeyField(depth, kDrawSortDepthBits);
+  if (layer == RenderLayer::kOpaque) {
+    return key | (state << kDrawSortDepthBits) | depth_field;
+  }
+  if (layer == RenderLayer::kBlended) {
+    depth_field = kMaxSortDepth - depth_field;
+  }
+  return key | (depth_field << kDrawSortStateBits) | state;
+}
+
+auto QuantizeDrawDepth(float depth, float max_depth) -> uint32_t {
+  // Also catches NaN.
+  if (!(depth > 0.0f) || !(max_depth > 0.0f)) {
+    return 0;
+  }
+  if (depth >= max_depth) {
+    return kMaxSortDepth;
+  }
+  return static_cast<uint32_t>(depth / max_depth *
+                               static_cast<float>(kMaxSortDepth));
+}
+
+void RadixSortDrawEntries(std::vector<DrawSortEntry> &entries,
+                          std::vector<DrawSortEntry> &scratch) {
+  const size_t count = entries.size();
+  if (count < 2) {
+    return;
+  }
+  scratch.resize(count);
+
+  // One read of the keys builds the histograms of all eight bytes.
+  constexpr size_t kDigitCount = sizeof(uint64_t);
+  size_t histograms[kDigitCount][256] = {};
+  for (const DrawSortEntry &entry : entries) {
+    for (size_t digit = 0; digit < kDigitCount; ++digit) {
+      ++histograms[digit][(entry.key >> (digit * 8)) & 0xFF];
+    }
+  }
+
+  DrawSortEntry *source = entries.data();
+  DrawSortEntry *destination = scratch.data();
+  for (size_t digit = 0; digit < kDigitCount; ++digit) {
+    const size_t shift = digit * 8;
+    size_t *histogram = histograms[digit];
+    if (histogram[(source[0].key >> shift) & 0xFF] == count) {
+      continue;
+    }
+
+    size_t offset = 0;
+    for (size_t bucket = 0; bucket < 256; ++bucket) {
+      const size_t bucket_count = histogram[bucket];
+      histogram[bucket] = offset;
+      offset += bucket_count;
+    }
+
+    for (size_t i = 0; i < count; ++i) {
+      destination[histogram[(source[i].key >> shift) & 0xFF]++] = source[i];
+    }
+    std::swap(source, destination);
+  }
+
+  if (source != entries.data()) {
+    entries.swap(scratch);
+  }
+}
+
+void RenderQueue::Clear() {
+  packets_.clear();
+  entries_.clear();
+  overlay_count_ = 0;
+}
+
+void RenderQueue::Reserve(size_t packet_count) {
+  packets_.reserve(packet_count);
+  entries_.reserve(packet_count);
+  scratch_.reserve(packet_count);
+}
+
+void RenderQueue::Submit(uint32_t pass, RenderLayer layer, uint32_t depth,
+                         const DrawPacket &packet) {
+  if (layer == RenderLayer::kOverlay) {
+    depth = overlay_count_++;
+  }
+
+  DrawSortEntry entry;
+  entry.key = MakeDrawSortKey(pass, layer, depth, packet);
+  entry.packet = static_cast<uint32_t>(packets_.size());
+  entries_.push_back(entry);
+  packets_.push_back(packet);
+}
+
+void RenderQueue::Sort() { RadixSortDrawEntries(entries_, scratch_); }
+
+void RenderQueue::GetPassRange(uint32_t pass, size_t &begin,
+                               size_t &end) const {
+  begin = 0;
+  end = 0;
+  if (pass >= kMaxDrawSortPasses) {
+    return;
+  }
+
+  auto before_pass = [](const DrawSortEntry &entry, uint64_t value) {
+    return (entry.key >> kDrawSortPassShift) < value;
+  };
+  auto first = std::lower_bound(entries_.begin(), entries_.end(),
+                                uint64_t{pass}, before_pass);
+  auto last = std::lower_bound(first, entries_.end(), uint64_t{pass} + 1,
+                               before_pass);
+  begin = static_cast<size_t>(first - entries_.begin());
+  end = static_cast<size_t>(last - entries_.begin());
+}
@@ -58,14 +58,22 @@ void RenderTexture::EndRender() {
   device_->EndDrawToOffScreen(render_target_handle_);
 }
 
-DescriptorHeapPtr RenderTexture::GetShaderResourceView() const {
+D3D12_GPU_DESCRIPTOR_HANDLE RenderTexture::GetShaderResourceView() const {
   if (!device_ || render_target_handle_ == kInvalidRenderTargetHandle) {
-    return nullptr;
+    return {};
   }
 
   return device_->GetRenderTargetSrv(render_target_handle_);
 }
 
+D3D12_CPU_DESCRIPTOR_HANDLE RenderTexture::GetStagingView() const {
+  if (!device_ || render_target_handle_ == kInvalidRenderTargetHandle) {
+    return {};
+  }
+
+  return device_->GetRenderTargetStagingView(render_target_handle_);
+}
+
 ResourceSharedPtr RenderTexture::GetTexture() const {
   if (!device_ || render_target_handle_ == kInvalidRenderTargetHandle) {
     return nullptr;
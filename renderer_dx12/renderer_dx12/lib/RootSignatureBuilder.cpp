@@ -28,25 +28,27 @@ RootSignatureBuilder &RootSignatureBuilder::AddConstantBufferView(
   return *this;
 }
 
+RootSignatureBuilder &RootSignatureBuilder::AddShaderResourceView(
+    UINT shader_register, UINT register_space,
+    D3D12_SHADER_VISIBILITY visibility) {
+  ParameterDesc desc = {};
+  desc.type = ParameterType::ShaderResourceView;
+  desc.shader_register = shader_register;
+  desc.register_space = register_space;
+  desc.visibility = visibility;
+  parameters_.push_back(std::move(desc));
+  return *this;
+}
+
 RootSignatureBuilder &RootSignatureBuilder::AddStaticSampler(
     const D3D12_STATIC_SAMPLER_DESC &sampler_desc) {
   static_samplers_.push_back(sampler_desc);
   return *this;
 }
 
-bool RootSignatureBuilder::Build(
-    const std::shared_ptr<DirectX12Device> &device,
-    RootSignaturePtr &root_signature,
-    D3D12_ROOT_SIGNATURE_FLAGS flags) const {
-  if (!device) {
-    return false;
-  }
-
-  auto d3d_device = device->GetD3d12Device();
-  if (!d3d_device) {
-    return false;
-  }
-
+bool RootSignatureBuilder::Serialize(
+    D3D12_ROOT_SIGNATURE_FLAGS flags,
+    Microsoft::WRL::ComPtr<ID3DBlob> &signature_blob) const {
   std::vector<CD3DX12_ROOT_PARAMETER> root_parameters;
   root_parameters.reserve(parameters_.size());
 
@@ -78,6 +80,12 @@ bool RootSignatureBuilder::Build(
           parameter.visibility);
       root_parameters.push_back(root_param);
       range_index += range_count;
+    } else if (parameter.type == ParameterType::ShaderResourceView) {
+      CD3DX12_ROOT_PARAMETER root_param = {};
+      root_param.InitAsShaderResourceView(parameter.shader_register,
+                                          parameter.register_space,
+                                          parameter.visibility);
+      root_parameters.push_back(root_param);
     } else {
       CD3DX12_ROOT_PARAMETER root_param = {};
       root_param.InitAsConstantBufferView(parameter.shader_register,
@@ -92,22 +100,33 @@ bool RootSignatureBuilder::Build(
       static_cast<UINT>(static_samplers_.size()), static_samplers_.data(),
       flags);
 
-  Microsoft::WRL::ComPtr<ID3DBlob> signature_blob = nullptr;
   Microsoft::WRL::ComPtr<ID3DBlob> error_blob = nullptr;
   auto hr = D3D12SerializeRootSignature(
       &root_desc, D3D_ROOT_SIGNATURE_VERSION_1, &signature_blob, &error_blob);
-  if (FAILED(hr)) {
+  return SUCCEEDED(hr);
+}
+
+bool RootSignatureBuilder::Build(
+    const std::shared_ptr<DirectX12Device> &device,
+    RootSignaturePtr &root_signature,
+    D3D12_ROOT_SIGNATURE_FLAGS flags) const {
+  if (!device) {
+    return false;
+  }
+
+  auto d3d_device = device->GetD3d12Device();
+  if (!d3d_device) {
     return false;
   }
 
-  hr = d3d_device->CreateRootSignature(
-      0, signature_blob->GetBufferPointer(),
-      signature_blob->GetBufferSize(), IID_PPV_ARGS(&root_signature));
-  if (FAILED(hr)) {
+  Microsoft::WRL::ComPtr<ID3DBlob> signature_blob = nullptr;
+  if (!Serialize(flags, signature_blob)) {
     return false;
   }
 
-  return true;
+  return device->GetPipelineCache().GetRootSignature(
+      d3d_device.Get(), signature_blob->GetBufferPointer(),
+      signature_blob->GetBufferSize(), root_signature);
 }
 
 
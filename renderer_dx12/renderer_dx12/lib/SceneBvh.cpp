@@ -0,0 +1,555 @@
+#include "stdafx.h"
+
+#include "SceneBvh.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <utility>
+
+namespace {
+
+// Centroid bins per axis for the SAH split search.
+constexpr uint32_t kBinCount = 16;
+
+// Once more than this share of the nodes moved, refitting walks every node
+// once instead of the paths above each moved object.
+constexpr size_t kSweepRefitDivisor = 8;
+
+// Refitting that raises the SAH cost past this multiple of the built cost
+// asks for a rebuild.
+constexpr float kRebuildCostRatio = 1.5f;
+
+constexpr float kInfinity = std::numeric_limits<float>::infinity();
+
+struct Box {
+  float minimum[3] = {kInfinity, kInfinity, kInfinity};
+  float maximum[3] = {-kInfinity, -kInfinity, -kInfinity};
+};
+
+void GrowBox(Box &box, const float minimum[3], const float maximum[3]) {
+  for (int axis = 0; axis < 3; ++axis) {
+    box.minimum[axis] = std::min(box.minimum[axis], minimum[axis]);
+    box.maximum[axis] = std::max(box.maximum[axis], maximum[axis]);
+  }
+}
+
+void GrowBox(Box &box, const BoundingVolume &bounds) {
+  const float minimum[3] = {bounds.center[0] - bounds.extents[0],
+                            bounds.center[1] - bounds.extents[1],
+                            bounds.center[2] - bounds.extents[2]};
+  const float maximum[3] = {bounds.center[0] + bounds.extents[0],
+                            bounds.center[1] + bounds.extents[1],
+                            bounds.center[2] + bounds.extents[2]};
+  GrowBox(box, minimum, maximum);
+}
+
+// Half the surface area, which is all the SAH needs.
+auto HalfArea(const float minimum[3], const float maximum[3]) -> float {
+  const float x = std::max(maximum[0] - minimum[0], 0.0f);
+  const float y = std::max(maximum[1] - minimum[1], 0.0f);
+  const float z = std::max(maximum[2] - minimum[2], 0.0f);
+  return x * y + y * z + z * x;
+}
+
+auto HalfArea(const Box &box) -> float {
+  return HalfArea(box.minimum, box.maximum);
+}
+
+struct RaySetup {
+  float origin[3] = {};
+  float inverse_direction[3] = {};
+};
+
+// Entry and exit distances of the ray through the box; false on a miss.
+auto IntersectBox(const RaySetup &ray, const float minimum[3],
+                  const float maximum[3], float &entry, float &exit)
+    -> bool {
+  entry = 0.0f;
+  exit = kInfinity;
+  for (int axis = 0; axis < 3; ++axis) {
+    float near_distance =
+        (minimum[axis] - ray.origin[axis]) * ray.inverse_direction[axis];
+    float far_distance =
+        (maximum[axis] - ray.origin[axis]) * ray.inverse_direction[axis];
+    if (near_distance > far_distance) {
+      std::swap(near_distance, far_distance);
+    }
+    entry = std::max(entry, near_distance);
+    exit = std::min(exit, far_distance);
+  }
+  return entry <= exit;
+}
+
+auto IntersectSphere(const Ray &ray, const BoundingVolume &bounds,
+                     float &entry, float &exit) -> bool {
+  const float offset[3] = {ray.origin[0] - bounds.center[0],
+                           ray.origin[1] - bounds.center[1],
+                           ray.origin[2] - bounds.center[2]};
+  const float a = ray.direction[0] * ray.direction[0] +
+                  ray.direction[1] * ray.direction[1] +
+                  ray.direction[2] * ray.direction[2];
+  const float b = offset[0] * ray.direction[0] +
+                  offset[1] * ray.direction[1] +
+                  offset[2] * ray.direction[2];
+  const float c = offset[0] * offset[0] + offset[1] * offset[1] +
+                  offset[2] * offset[2] - bounds.radius * bounds.radius;
+  const float discriminant = b * b - a * c;
+  if (a <= 0.0f || discriminant < 0.0f) {
+    return false;
+  }
+  const float root = std::sqrt(discriminant);
+  entry = std::max((-b - root) / a, 0.0f);
+  exit = (-b + root) / a;
+  return entry <= exit;
+}
+
+} // namespace
+
+auto SceneBvh::Insert(const BoundingVolume &bounds) -> uint32_t {
+  uint32_t object = 0;
+  if (!free_objects_.empty()) {
+    object = free_objects_.back();
+    free_objects_.pop_back();
+  } else {
+    object = static_cast<uint32_t>(objects_.size());
+    objects_.emplace_back();
+  }
+
+  objects_[object] = Object{};
+  objects_[object].bounds = bounds;
+  objects_[object].alive = true;
+  ++live_object_count_;
+  structure_changed_ = true;
+  return object;
+}
+
+void SceneBvh::Remove(uint32_t object) {
+  if (object >= objects_.size() || !objects_[object].alive) {
+    return;
+  }
+  objects_[object].alive = false;
+  free_objects_.push_back(object);
+  --live_object_count_;
+  structure_changed_ = true;
+}
+
+void SceneBvh::SetBounds(uint32_t object, const BoundingVolume &bounds) {
+  if (object >= objects_.size() || !objects_[object].alive) {
+    return;
+  }
+  Object &entry = objects_[object];
+  entry.bounds = bounds;
+  if (!entry.moved && entry.leaf != kNoNode) {
+    entry.moved = true;
+    moved_objects_.push_back(object);
+  }
+}
+
+auto SceneBvh::GetBounds(uint32_t object) const -> const BoundingVolume & {
+  return objects_[object].bounds;
+}
+
+void SceneBvh::Clear() {
+  objects_.clear();
+  free_objects_.clear();
+  moved_objects_.clear();
+  nodes_.clear();
+  object_order_.clear();
+  live_object_count_ = 0;
+  structure_changed_ = false;
+  built_sah_cost_ = 0.0f;
+}
+
+void SceneBvh::Build() {
+  nodes_.clear();
+  object_order_.clear();
+  moved_objects_.clear();
+  structure_changed_ = false;
+  built_sah_cost_ = 0.0f;
+
+  object_order_.reserve(live_object_count_);
+  for (uint32_t object = 0; object < objects_.size(); ++object) {
+    objects_[object].leaf = kNoNode;
+    objects_[object].moved = false;
+    if (objects_[object].alive) {
+      object_order_.push_back(object);
+    }
+  }
+  if (object_order_.empty()) {
+    return;
+  }
+
+  nodes_.reserve(object_order_.size() * 2);
+  nodes_.emplace_back();
+  nodes_[0].object_count = static_cast<uint32_t>(object_order_.size());
+  FitObjects(nodes_[0]);
+
+  // Children are always appended after their parent, which Refit's sweep
+  // relies on.
+  std::vector<uint32_t> pending = {0};
+  while (!pending.empty()) {
+    const uint32_t node_index = pending.back();
+    pending.pop_back();
+    SplitNode(node_index, pending);
+  }
+
+  built_sah_cost_ = GetSahCost();
+}
+
+void SceneBvh::SplitNode(uint32_t node_index,
+                         std::vector<uint32_t> &pending) {
+  const uint32_t first = nodes_[node_index].first_object;
+  const uint32_t count = nodes_[node_index].object_count;
+  if (count <= kMaxLeafSize) {
+    for (uint32_t i = first; i < first + count; ++i) {
+      objects_[object_order_[i]].leaf = node_index;
+    }
+    return;
+  }
+
+  auto *begin = object_order_.data() + first;
+  auto *end = begin + count;
+
+  Box centroids;
+  for (auto *it = begin; it != end; ++it) {
+    const float *center = objects_[*it].bounds.center;
+    GrowBox(centroids, center, center);
+  }
+
+  // Cheapest split between bins over the three axes, by the surface area
+  // heuristic. Axes the centroids do not spread along are skipped.
+  float best_cost = kInfinity;
+  int best_axis = -1;
+  uint32_t best_split = 0;
+  for (int axis = 0; axis < 3; ++axis) {
+    const float extent = centroids.maximum[axis] - centroids.minimum[axis];
+    if (extent <= 0.0f) {
+      continue;
+    }
+    const float scale = kBinCount / extent;
+
+    Box bin_boxes[kBinCount];
+    uint32_t bin_counts[kBinCount] = {};
+    for (auto *it = begin; it != end; ++it) {
+      const BoundingVolume &bounds = objects_[*it].bounds;
+      const uint32_t bin = std::min(
+          kBinCount - 1, static_cast<uint32_t>(
+                             (bounds.center[axis] - centroids.minimum[axis]) *
+                             scale));
+      ++bin_counts[bin];
+      GrowBox(bin_boxes[bin], bounds);
+    }
+
+    // right_costs[i] covers bins i + 1 and up.
+    float right_costs[kBinCount] = {};
+    Box right_box;
+    uint32_t right_count = 0;
+    for (uint32_t bin = kBinCount - 1; bin > 0; --bin) {
+      GrowBox(right_box, bin_boxes[bin].minimum, bin_boxes[bin].maximum);
+      right_count += bin_counts[bin];
+      right_costs[bin - 1] =
+          right_count > 0 ? HalfArea(right_box) * right_count : kInfinity;
+    }
+
+    Box left_box;
+    uint32_t left_count = 0;
+    for (uint32_t bin = 0; bin + 1 < kBinCount; ++bin) {
+      GrowBox(left_box, bin_boxes[bin].minimum, bin_boxes[bin].maximum);
+      left_count += bin_counts[bin];
+      if (left_count == 0) {
+        continue;
+      }
+      const float cost = HalfArea(left_box) * left_count + right_costs[bin];
+      if (cost < best_cost) {
+        best_cost = cost;
+        best_axis = axis;
+        best_split = bin;
+      }
+    }
+  }
+
+  auto *middle = begin + count / 2;
+  if (best_axis >= 0) {
+    const float minimum = centroids.minimum[best_axis];
+    const float scale =
+        kBinCount / (centroids.maximum[best_axis] - minimum);
+    middle = std::partition(begin, end, [&](uint32_t object) {
+      const float center = objects_[object].bounds.center[best_axis];
+      const uint32_t bin = std::min(
+          kBinCount - 1, static_cast<uint32_t>((center - minimum) * scale));
+      return bin <= best_split;
+    });
+  }
+  // Identical centroids give no split to search for; halving still bounds
+  // the leaf size.
+  if (middle == begin || middle == end) {
+    middle = begin + count / 2;
+  }
+
+  const uint32_t left_count = static_cast<uint32_t>(middle - begin);
+  const uint32_t first_child = static_cast<uint32_t>(nodes_.size());
+  nodes_.resize(nodes_.size() + 2);
+
+  Node &left = nodes_[first_child];
+  left.first_object = first;
+  left.object_count = left_count;
+  left.parent = node_index;
+  FitObjects(left);
+
+  Node &right = nodes_[first_child + 1];
+  right.first_object = first + left_count;
+  right.object_count = count - left_count;
+  right.parent = node_index;
+  FitObjects(right);
+
+  nodes_[node_index].first_child = first_child;
+  pending.push_back(first_child + 1);
+  pending.push_back(first_child);
+}
+
+void SceneBvh::FitObjects(Node &node) const {
+  Box box;
+  for (uint32_t i = node.first_object;
+       i < node.first_object + node.object_count; ++i) {
+    GrowBox(box, objects_[object_order_[i]].bounds);
+  }
+  std::copy(box.minimum, box.minimum + 3, node.minimum);
+  std::copy(box.maximum, box.maximum + 3, node.maximum);
+}
+
+void SceneBvh::FitChildren(Node &node) const {
+  const Node &left = nodes_[node.first_child];
+  const Node &right = nodes_[node.first_child + 1];
+  for (int axis = 0; axis < 3; ++axis) {
+    node.minimum[axis] = std::min(left.minimum[axis], right.minimum[axis]);
+    node.maximum[axis] = std::max(left.maximum[axis], right.maximum[axis]);
+  }
+}
+
+void SceneBvh::Refit() {
+  if (structure_changed_) {
+    Build();
+    return;
+  }
+  if (moved_objects_.empty()) {
+    return;
+  }
+
+  if (moved_objects_.size() > nodes_.size() / kSweepRefitDivisor) {
+    for (size_t i = nodes_.size(); i-- > 0;) {
+      Node &node = nodes_[i];
+      if (node.first_child == kNoNode) {
+        FitObjects(node);
+      } else {
+        FitChildren(node);
+      }
+    }
+  } else {
+    for (const uint32_t object : moved_objects_) {
+      uint32_t node_index = objects_[object].leaf;
+      FitObjects(nodes_[node_index]);
+      node_index = nodes_[node_index].parent;
+      // An ancestor that comes out unchanged already holds every moved
+      // object below it.
+      while (node_index != kNoNode) {
+        Node &node = nodes_[node_index];
+        const Node previous = node;
+        FitChildren(node);
+        if (std::equal(node.minimum, node.minimum + 3, previous.minimum) &&
+            std::equal(node.maximum, node.maximum + 3, previous.maximum)) {
+          break;
+        }
+        node_index = node.parent;
+      }
+    }
+  }
+
+  for (const uint32_t object : moved_objects_) {
+    objects_[object].moved = false;
+  }
+  moved_objects_.clear();
+}
+
+auto SceneBvh::NeedsRebuild() const -> bool {
+  return !nodes_.empty() &&
+         GetSahCost() > built_sah_cost_ * kRebuildCostRatio;
+}
+
+auto SceneBvh::GetSahCost() const -> float {
+  if (nodes_.empty()) {
+    return 0.0f;
+  }
+  const float root_area = HalfArea(nodes_[0].minimum, nodes_[0].maximum);
+  if (root_area <= 0.0f) {
+    return static_cast<float>(live_object_count_);
+  }
+
+  // A box test costs about as much as an object test.
+  float cost = 0.0f;
+  for (const Node &node : nodes_) {
+    const float area = HalfArea(node.minimum, node.maximum) / root_area;
+    cost += node.first_child == kNoNode ? area * node.object_count : area;
+  }
+  return cost;
+}
+
+void SceneBvh::QueryFrustum(const FrustumPlanes &frustum,
+                            std::vector<uint32_t> &objects) const {
+  if (nodes_.empty()) {
+    return;
+  }
+
+  // Each entry carries the planes its box still straddles; planes a box is
+  // wholly inside of are not tested again below it.
+  constexpr uint32_t kAllPlanes = 0x3f;
+  std::vector<std::pair<uint32_t, uint32_t>> stack;
+  stack.reserve(64);
+  stack.emplace_back(0, kAllPlanes);
+
+  while (!stack.empty()) {
+    const uint32_t node_index = stack.back().first;
+    uint32_t plane_mask = stack.back().second;
+    stack.pop_back();
+    const Node &node = nodes_[node_index];
+
+    bool outside = false;
+    for (int plane = 0; plane < 6 && !outside; ++plane) {
+      if ((plane_mask & (1u << plane)) == 0) {
+        continue;
+      }
+      const float *p = frustum.planes[plane];
+      float center[3];
+      float extents[3];
+      for (int axis = 0; axis < 3; ++axis) {
+        center[axis] = (node.minimum[axis] + node.maximum[axis]) * 0.5f;
+        extents[axis] = (node.maximum[axis] - node.minimum[axis]) * 0.5f;
+      }
+      const float distance =
+          p[0] * center[0] + p[1] * center[1] + p[2] * center[2] + p[3];
+      const float radius = std::fabs(p[0]) * extents[0] +
+                           std::fabs(p[1]) * extents[1] +
+                           std::fabs(p[2]) * extents[2];
+      if (distance < -radius) {
+        outside = true;
+      } else if (distance >= radius) {
+        plane_mask &= ~(1u << plane);
+      }
+    }
+    if (outside) {
+      continue;
+    }
+
+    const auto *first = object_order_.data() + node.first_object;
+    const auto *last = first + node.object_count;
+    if (plane_mask == 0) {
+      objects.insert(objects.end(), first, last);
+    } else if (node.first_child == kNoNode) {
+      for (const auto *it = first; it != last; ++it) {
+        if (IsVisible(frustum, objects_[*it].bounds)) {
+          objects.push_back(*it);
+        }
+      }
+    } else {
+      stack.emplace_back(node.first_child + 1, plane_mask);
+      stack.emplace_back(node.first_child, plane_mask);
+    }
+  }
+}
+
+auto SceneBvh::RayCast(const Ray &ray, RayHit &hit, float max_distance) const
+    -> bool {
+  hit = RayHit{};
+  hit.distance = max_distance;
+  if (nodes_.empty()) {
+    return false;
+  }
+
+  RaySetup setup;
+  for (int axis = 0; axis < 3; ++axis) {
+    setup.origin[axis] = ray.origin[axis];
+    // A zero component would make 0 * inf slab distances; a huge inverse
+    // keeps them ordered instead.
+    const float direction = ray.direction[axis] != 0.0f
+                                ? ray.direction[axis]
+                                : std::numeric_limits<float>::min();
+    setup.inverse_direction[axis] = 1.0f / direction;
+  }
+
+  float entry = 0.0f;
+  float exit = 0.0f;
+  if (!IntersectBox(setup, nodes_[0].minimum, nodes_[0].maximum, entry,
+                    exit) ||
+      entry > hit.distance) {
+    return false;
+  }
+
+  // Nearer child first, and nothing entered past the closest hit so far.
+  std::vector<std::pair<uint32_t, float>> stack;
+  stack.reserve(64);
+  stack.emplace_back(0, entry);
+  bool found = false;
+
+  while (!stack.empty()) {
+    const uint32_t node_index = stack.back().first;
+    const float node_entry = stack.back().second;
+    stack.pop_back();
+    if (node_entry > hit.distance) {
+      continue;
+    }
+
+    const Node &node = nodes_[node_index];
+    if (node.first_child == kNoNode) {
+      for (uint32_t i = node.first_object;
+           i < node.first_object + node.object_count; ++i) {
+        const uint32_t object = object_order_[i];
+        const BoundingVolume &bounds = objects_[object].bounds;
+        const float minimum[3] = {bounds.center[0] - bounds.extents[0],
+                                  bounds.center[1] - bounds.extents[1],
+                                  bounds.center[2] - bounds.extents[2]};
+        const float maximum[3] = {bounds.center[0] + bounds.extents[0],
+                                  bounds.center[1] + bounds.extents[1],
+                                  bounds.center[2] + bounds.extents[2]};
+        float box_entry = 0.0f;
+        float box_exit = 0.0f;
+        float sphere_entry = 0.0f;
+        float sphere_exit = 0.0f;
+        if (!IntersectBox(setup, minimum, maximum, box_entry, box_exit) ||
+            !IntersectSphere(ray, bounds, sphere_entry, sphere_exit)) {
+          continue;
+        }
+        // The object lies in both volumes, so the ray is only inside it
+        // where the two spans overlap.
+        const float object_entry = std::max(box_entry, sphere_entry);
+        const float object_exit = std::min(box_exit, sphere_exit);
+        if (object_entry <= object_exit && object_entry < hit.distance) {
+          hit.object = object;
+          hit.distance = object_entry;
+          found = true;
+        }
+      }
+      continue;
+    }
+
+    float child_entry[2] = {kInfinity, kInfinity};
+    for (uint32_t child = 0; child < 2; ++child) {
+      const Node &child_node = nodes_[node.first_child + child];
+      if (!IntersectBox(setup, child_node.minimum, child_node.maximum,
+                        child_entry[child], exit)) {
+        child_entry[child] = kInfinity;
+      }
+    }
+    const uint32_t near_child = child_entry[1] < child_entry[0] ? 1 : 0;
+    const uint32_t far_child = 1 - near_child;
+    if (child_entry[far_child] <= hit.distance) {
+      stack.emplace_back(node.first_child + far_child,
+                         child_entry[far_child]);
+    }
+    if (child_entry[near_child] <= hit.distance) {
+      stack.emplace_back(node.first_child + near_child,
+                         child_entry[near_child]);
+    }
+  }
+
+  return found;
+}
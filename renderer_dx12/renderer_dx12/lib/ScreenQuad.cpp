@@ -72,10 +72,7 @@ bool ScreenQuad::UpdatePosition(int pos_x, int pos_y) {
 
   auto bottom = top - static_cast<float>(quad_height_);
 
-  auto vertices = new VertexType[vertex_count_];
-  if (!vertices) {
-    return false;
-  }
+  auto &vertices = vertices_;
 
   // First triangle.
   // Top left.
@@ -99,21 +96,38 @@ bool ScreenQuad::UpdatePosition(int pos_x, int pos_y) {
   vertices[5].position_ = DirectX::XMFLOAT3(right, bottom, 0.0f);
   vertices[5].texture_position_ = DirectX::XMFLOAT2(1.0f, 1.0f);
 
-  D3D12_RANGE range;
-  range.Begin = 0;
-  range.End = 0;
-  UINT8 *data_begin = nullptr;
-  if (FAILED(vertex_buffer_->Map(0, &range,
-                                 reinterpret_cast<void **>(&data_begin)))) {
-    return false;
-  } else {
-    memcpy(data_begin, vertices, sizeof(VertexType) * vertex_count_);
-    vertex_buffer_->Unmap(0, nullptr);
+  // Picked up by the next GetVertexBufferView().
+  uploaded_frame_ = 0;
+
+  return true;
+}
+
+const VertexBufferView &ScreenQuad::GetVertexBufferView() {
+  if (!external_vertex_buffer_view_ &&
+      uploaded_frame_ != device_->GetCurrentFrameFenceValue()) {
+    UploadVertices();
   }
+  return vertex_buffer_view_;
+}
 
-  delete[] vertices;
-  vertices = nullptr;
+void ScreenQuad::SetVertexBufferView(const VertexBufferView &view) {
+  vertex_buffer_view_ = view;
+  external_vertex_buffer_view_ = true;
+}
+
+bool ScreenQuad::UploadVertices() {
+  // The quad is redrawn every frame while earlier frames may still be
+  // reading their copy, so each frame gets its own slice of upload memory.
+  const auto size = sizeof(VertexType) * vertices_.size();
+
+  LinearAllocation allocation = {};
+  if (!device_->AllocateFrameMemory(size, alignof(VertexType), allocation)) {
+    return false;
+  }
+  memcpy(allocation.cpu_address, vertices_.data(), size);
 
+  vertex_buffer_view_.BufferLocation = allocation.gpu_address;
+  uploaded_frame_ = device_->GetCurrentFrameFenceValue();
   return true;
 }
 
@@ -121,45 +135,16 @@ bool ScreenQuad::InitializeBuffers() {
   vertex_count_ = 6;
   index_count_ = 6;
 
-  auto vertices = new VertexType[vertex_count_];
-  if (!vertices) {
-    return false;
-  }
-
   auto indices = new uint16_t[index_count_];
   if (!indices) {
     return false;
   }
 
-  ZeroMemory(vertices, sizeof(VertexType) * vertex_count_);
-
-  auto device = device_->GetD3d12Device();
-
-  if (FAILED(device->CreateCommittedResource(
-          &CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD),
-          D3D12_HEAP_FLAG_NONE,
-          &CD3DX12_RESOURCE_DESC::Buffer(sizeof(VertexType) * vertex_count_),
-          D3D12_RESOURCE_STATE_GENERIC_READ, nullptr,
-          IID_PPV_ARGS(&vertex_buffer_)))) {
-    return false;
-  }
-
-  UINT8 *vertex_data_begin = nullptr;
-  CD3DX12_RANGE read_range(0, 0);
-  if (FAILED(vertex_buffer_->Map(
-          0, &read_range, reinterpret_cast<void **>(&vertex_data_begin)))) {
-    return false;
-  }
-
-  memcpy(vertex_data_begin, vertices, sizeof(VertexType) * vertex_count_);
-  vertex_buffer_->Unmap(0, nullptr);
-
-  vertex_buffer_view_.BufferLocation = vertex_buffer_->GetGPUVirtualAddress();
+  vertices_.assign(vertex_count_, VertexType{});
   vertex_buffer_view_.SizeInBytes = sizeof(VertexType) * vertex_count_;
   vertex_buffer_view_.StrideInBytes = sizeof(VertexType);
 
-  delete[] vertices;
-  vertices = nullptr;
+  auto device = device_->GetD3d12Device();
 
   for (UINT i = 0; i < index_count_; ++i) {
     indices[i] = i;
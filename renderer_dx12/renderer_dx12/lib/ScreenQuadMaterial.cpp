@@ -22,9 +22,6 @@ auto ScreenQuadMaterial::Initialize() -> bool {
     if (!constant_buffer_.Initialize(device_)) {
       return false;
     }
-    current_constant_buffer_ = constant_buffer_.GetResource();
-  } else {
-    current_constant_buffer_ = external_constant_buffer_;
   }
 
   ZeroMemory(&matrix_constant_data_, sizeof(MatrixBufferType));
@@ -64,8 +61,12 @@ auto ScreenQuadMaterial::UpdateConstantBuffer(const XMMATRIX &world,
   return constant_buffer_.Update(matrix_constant_data_);
 }
 
-auto ScreenQuadMaterial::GetConstantBuffer() const -> ResourceSharedPtr {
-  return current_constant_buffer_;
+auto ScreenQuadMaterial::GetConstantBufferAddress() const
+    -> D3D12_GPU_VIRTUAL_ADDRESS {
+  if (external_constant_buffer_) {
+    return external_constant_buffer_->GetGPUVirtualAddress();
+  }
+  return constant_buffer_.GetGPUVirtualAddress();
 }
 
 void ScreenQuadMaterial::SetExternalConstantBuffer(
@@ -74,7 +75,6 @@ void ScreenQuadMaterial::SetExternalConstantBuffer(
     const XMMATRIX &initial_view,
     const XMMATRIX &initial_ortho) {
   external_constant_buffer_ = constant_buffer;
-  current_constant_buffer_ = constant_buffer;
   XMStoreFloat4x4(&matrix_constant_data_.world_, initial_world);
   XMStoreFloat4x4(&matrix_constant_data_.view_, initial_view);
   XMStoreFloat4x4(&matrix_constant_data_.orthogonality_, initial_ortho);
@@ -0,0 +1,473 @@
+#include "stdafx.h"
+
+#include "ShaderCache.h"
+
+#include <cstring>
+#include <set>
+#include <utility>
+
+#include "AssetRegistry.h"
+#include "FileSource.h"
+
+namespace ResourceLoader {
+
+namespace {
+
+constexpr uint32_t kShaderCacheMagic = 0x43444853; // "SHDC"
+
+// Bump when the entry layout changes so old entries are compiled again.
+constexpr uint32_t kShaderCacheVersion = 1;
+
+class ImageWriter {
+public:
+  explicit ImageWriter(std::vector<uint8_t> &image) : image_(image) {}
+
+  void Write32(uint32_t value) { WriteBytes(&value, sizeof(value)); }
+
+  void Write64(uint64_t value) { WriteBytes(&value, sizeof(value)); }
+
+  void WriteString(const std::string &value) {
+    Write32(static_cast<uint32_t>(value.size()));
+    WriteBytes(value.data(), value.size());
+  }
+
+  // UTF-16 units whatever the size of wchar_t.
+  void WriteWideString(const std::wstring &value) {
+    Write32(static_cast<uint32_t>(value.size()));
+    for (wchar_t c : value) {
+      const uint16_t unit = static_cast<uint16_t>(c);
+      WriteBytes(&unit, sizeof(unit));
+    }
+  }
+
+  void WriteBlob(const std::vector<uint8_t> &value) {
+    Write32(static_cast<uint32_t>(value.size()));
+    WriteBytes(value.data(), value.size());
+  }
+
+private:
+  // Grows and copies rather than inserting a range: GCC 12 cannot see that
+  // insert into a just-cleared vector reallocates, and warns that the copy
+  // overflows it.
+  void WriteBytes(const void *data, size_t size) {
+    if (size == 0) {
+      return;
+    }
+    const size_t offset = image_.size();
+    image_.resize(offset + size);
+    memcpy(image_.data() + offset, data, size);
+  }
+
+  std::vector<uint8_t> &image_;
+};
+
+// Every read fails once the image runs out, so callers check at the end.
+class ImageReader {
+public:
+  ImageReader(const uint8_t *data, size_t size) : data_(data), size_(size) {}
+
+  auto Read32() -> uint32_t {
+    uint32_t value = 0;
+    ReadBytes(&value, sizeof(value));
+    return value;
+  }
+
+  auto Read64() -> uint64_t {
+    uint64_t value = 0;
+    ReadBytes(&value, sizeof(value));
+    return value;
+  }
+
+  auto ReadString() -> std::string {
+    const uint32_t length = Read32();
+    if (!HasRoom(length)) {
+      return {};
+    }
+    std::string value(reinterpret_cast<const char *>(data_ + offset_), length);
+    offset_ += length;
+    return value;
+  }
+
+  auto ReadWideString() -> std::wstring {
+    const uint32_t length = Read32();
+    if (!HasRoom(static_cast<size_t>(length) * 2)) {
+      return {};
+    }
+    std::wstring value(length, L'\0');
+    for (uint32_t i = 0; i < length; ++i) {
+      uint16_t unit = 0;
+      ReadBytes(&unit, sizeof(unit));
+      value[i] = static_cast<wchar_t>(unit);
+    }
+    return value;
+  }
+
+  auto ReadBlob() -> std::vector<uint8_t> {
+    const uint32_t length = Read32();
+    if (!HasRoom(length)) {
+      return {};
+    }
+    std::vector<uint8_t> value(data_ + offset_, data_ + offset_ + length);
+    offset_ += length;
+    return value;
+  }
+
+  // Guards counts read from the image before anything is reserved for them.
+  auto HasRoom(size_t size) -> bool {
+    if (failed_ || size > size_ - offset_) {
+      failed_ = true;
+      return false;
+    }
+    return true;
+  }
+
+  auto IsValid() const -> bool { return !failed_; }
+
+  auto IsAtEnd() const -> bool { return offset_ == size_; }
+
+private:
+  void ReadBytes(void *out, size_t size) {
+    if (!HasRoom(size)) {
+      return;
+    }
+    memcpy(out, data_ + offset_, size);
+    offset_ += size;
+  }
+
+  const uint8_t *data_ = nullptr;
+
+  size_t size_ = 0;
+
+  size_t offset_ = 0;
+
+  bool failed_ = false;
+};
+
+auto IsSpace(uint8_t c) -> bool { return c == ' ' || c == '\t' || c == '\r'; }
+
+auto GetDirectoryPrefix(const std::wstring &path) -> std::wstring {
+  const auto slash = path.find_last_of(L"\\/");
+  return slash == std::wstring::npos ? std::wstring()
+                                      : path.substr(0, slash + 1);
+}
+
+auto WidenAscii(const std::string &value) -> std::wstring {
+  return std::wstring(value.begin(), value.end());
+}
+
+auto HashFile(FileSource &file_source, const std::wstring &path,
+              uint64_t &hash) -> bool {
+  FileData file;
+  if (!file_source.ReadFile(path, file)) {
+    hash = 0;
+    return false;
+  }
+  hash = HashAssetContent(file.GetData(), file.GetSize());
+  return true;
+}
+
+} // namespace
+
+auto ScanShaderIncludes(const uint8_t *data, size_t size)
+    -> std::vector<std::string> {
+  std::vector<std::string> includes = {};
+  size_t cursor = 0;
+
+  while (cursor < size) {
+    size_t line_end = cursor;
+    while (line_end < size && data[line_end] != '\n') {
+      ++line_end;
+    }
+
+    size_t i = cursor;
+    while (i < line_end && IsSpace(data[i])) {
+      ++i;
+    }
+    if (i < line_end && data[i] == '#') {
+      ++i;
+      while (i < line_end && IsSpace(data[i])) {
+        ++i;
+      }
+      static const char kInclude[] = "include";
+      const size_t keyword_length = sizeof(kInclude) - 1;
+      if (line_end - i > keyword_length &&
+          memcmp(data + i, kInclude, keyword_length) == 0) {
+        i += keyword_length;
+        while (i < line_end && IsSpace(data[i])) {
+          ++i;
+        }
+        if (i < line_end && data[i] == '"') {
+          const size_t name_begin = ++i;
+          while (i < line_end && data[i] != '"') {
+            ++i;
+          }
+          if (i < line_end && i > name_begin) {
+            std::string name(reinterpret_cast<const char *>(data + name_begin),
+                             i - name_begin);
+            bool seen = false;
+            for (const auto &include : includes) {
+              seen = seen || include == name;
+            }
+            if (!seen) {
+              includes.push_back(std::move(name));
+            }
+          }
+        }
+      }
+    }
+
+    cursor = line_end + 1;
+  }
+
+  return includes;
+}
+
+auto CollectShaderDependencies(FileSource &file_source,
+                               const std::wstring &source_path,
+                               std::vector<ShaderDependency> &dependencies)
+    -> bool {
+  dependencies.clear();
+
+  std::set<std::wstring> visited = {NormalizeAssetPath(source_path)};
+  std::vector<std::wstring> pending = {source_path};
+
+  while (!pending.empty()) {
+    const std::wstring path = std::move(pending.back());
+    pending.pop_back();
+
+    FileData file;
+    const bool is_readable = file_source.ReadFile(path, file);
+    if (!is_readable && dependencies.empty()) {
+      return false;
+    }
+
+    ShaderDependency dependency = {};
+    dependency.path = path;
+    if (is_readable) {
+      dependency.content_hash =
+          HashAssetContent(file.GetData(), file.GetSize());
+
+      const std::wstring directory = GetDirectoryPrefix(path);
+      const auto includes = ScanShaderIncludes(file.GetData(), file.GetSize());
+      // Reversed so the stack hands them out in source order.
+      for (auto it = includes.rbegin(); it != includes.rend(); ++it) {
+        std::wstring include_path = directory + WidenAscii(*it);
+        if (visited.insert(NormalizeAssetPath(include_path)).second) {
+          pending.push_back(std::move(include_path));
+        }
+      }
+    }
+    dependencies.push_back(std::move(dependency));
+  }
+
+  return true;
+}
+
+auto GetShaderCachePath(const std::wstring &directory,
+                        const std::string &shader_key, uint32_t compile_flags)
+    -> std::wstring {
+  std::vector<uint8_t> name(shader_key.begin(), shader_key.end());
+  ImageWriter writer(name);
+  writer.Write32(compile_flags);
+  writer.Write32(kShaderCacheVersion);
+  const uint64_t hash = HashAssetContent(name.data(), name.size());
+
+  static const wchar_t kDigits[] = L"0123456789abcdef";
+  std::wstring path = directory;
+  if (!path.empty() && path.back() != L'/' && path.back() != L'\\') {
+    path.push_back(L'/');
+  }
+  for (int shift = 60; shift >= 0; shift -= 4) {
+    path.push_back(kDigits[(hash >> shift) & 0xf]);
+  }
+  return path + L".shc";
+}
+
+void SerializeShaderCacheEntry(const ShaderCacheEntry &entry,
+                               std::vector<uint8_t> &image) {
+  image.clear();
+  ImageWriter writer(image);
+  writer.Write32(kShaderCacheMagic);
+  writer.Write32(kShaderCacheVersion);
+  writer.Write32(entry.compile_flags);
+  writer.WriteString(entry.shader_key);
+
+  writer.Write32(static_cast<uint32_t>(entry.dependencies.size()));
+  for (const auto &dependency : entry.dependencies) {
+    writer.WriteWideString(dependency.path);
+    writer.Write64(dependency.content_hash);
+  }
+
+  writer.WriteBlob(entry.bytecode);
+
+  const ShaderReflectionData &reflection = entry.reflection;
+  writer.Write32(reflection.instruction_count);
+  writer.Write32(reflection.constant_buffer_count);
+  writer.Write32(static_cast<uint32_t>(reflection.bindings.size()));
+  for (const auto &binding : reflection.bindings) {
+    writer.WriteString(binding.name);
+    writer.Write32(binding.type);
+    writer.Write32(binding.bind_point);
+    writer.Write32(binding.bind_count);
+    writer.Write32(binding.space);
+  }
+  writer.Write32(static_cast<uint32_t>(reflection.inputs.size()));
+  for (const auto &input : reflection.inputs) {
+    writer.WriteString(input.semantic_name);
+    writer.Write32(input.semantic_index);
+    writer.Write32(input.register_index);
+    writer.Write32(input.component_type);
+    writer.Write32(input.mask);
+  }
+}
+
+auto ParseShaderCacheEntry(const uint8_t *data, size_t size,
+                           ShaderCacheEntry &entry) -> bool {
+  if (data == nullptr) {
+    return false;
+  }
+
+  ImageReader reader(data, size);
+  if (reader.Read32() != kShaderCacheMagic ||
+      reader.Read32() != kShaderCacheVersion) {
+    return false;
+  }
+
+  ShaderCacheEntry parsed = {};
+  parsed.compile_flags = reader.Read32();
+  parsed.shader_key = reader.ReadString();
+
+  // Every record takes at least 4 bytes, which bounds the counts.
+  const uint32_t dependency_count = reader.Read32();
+  if (!reader.HasRoom(static_cast<size_t>(dependency_count) * 4)) {
+    return false;
+  }
+  parsed.dependencies.resize(dependency_count);
+  for (auto &dependency : parsed.dependencies) {
+    dependency.path = reader.ReadWideString();
+    dependency.content_hash = reader.Read64();
+  }
+
+  parsed.bytecode = reader.ReadBlob();
+
+  ShaderReflectionData &reflection = parsed.reflection;
+  reflection.instruction_count = reader.Read32();
+  reflection.constant_buffer_count = reader.Read32();
+  const uint32_t binding_count = reader.Read32();
+  if (!reader.HasRoom(static_cast<size_t>(binding_count) * 4)) {
+    return false;
+  }
+  reflection.bindings.resize(binding_count);
+  for (auto &binding : reflection.bindings) {
+    binding.name = reader.ReadString();
+    binding.type = reader.Read32();
+    binding.bind_point = reader.Read32();
+    binding.bind_count = reader.Read32();
+    binding.space = reader.Read32();
+  }
+  const uint32_t input_count = reader.Read32();
+  if (!reader.HasRoom(static_cast<size_t>(input_count) * 4)) {
+    return false;
+  }
+  reflection.inputs.resize(input_count);
+  for (auto &input : reflection.inputs) {
+    input.semantic_name = reader.ReadString();
+    input.semantic_index = reader.Read32();
+    input.register_index = reader.Read32();
+    input.component_type = reader.Read32();
+    input.mask = reader.Read32();
+  }
+
+  if (!reader.IsValid() || !reader.IsAtEnd() || parsed.bytecode.empty()) {
+    return false;
+  }
+
+  entry = std::move(parsed);
+  return true;
+}
+
+auto ParseShaderManifest(const uint8_t *data, size_t size,
+                         std::vector<ShaderManifestEntry> &entries) -> bool {
+  entries.clear();
+  if (data == nullptr) {
+    return false;
+  }
+
+  size_t cursor = 0;
+  while (cursor < size) {
+    size_t line_end = cursor;
+    while (line_end < size && data[line_end] != '\n') {
+      ++line_end;
+    }
+
+    std::vector<std::string> fields = {};
+    size_t i = cursor;
+    while (i < line_end && data[i] != '#') {
+      if (IsSpace(data[i])) {
+        ++i;
+        continue;
+      }
+      const size_t field_begin = i;
+      while (i < line_end && !IsSpace(data[i]) && data[i] != '#') {
+        ++i;
+      }
+      fields.emplace_back(reinterpret_cast<const char *>(data + field_begin),
+                          i - field_begin);
+    }
+    cursor = line_end + 1;
+
+    if (fields.empty()) {
+      continue;
+    }
+    if (fields.size() != 3) {
+      return false;
+    }
+    entries.push_back({WidenAscii(fields[0]), fields[1], fields[2]});
+  }
+
+  return true;
+}
+
+ShaderCache::ShaderCache(FileSource &file_source, std::wstring directory)
+    : file_source_(file_source), directory_(std::move(directory)) {}
+
+auto ShaderCache::Load(const std::string &shader_key, uint32_t compile_flags,
+                       ShaderCacheEntry &entry) -> bool {
+  FileData file;
+  if (!file_source_.ReadFile(
+          GetShaderCachePath(directory_, shader_key, compile_flags), file)) {
+    return false;
+  }
+
+  ShaderCacheEntry cached = {};
+  if (!ParseShaderCacheEntry(file.GetData(), file.GetSize(), cached) ||
+      cached.shader_key != shader_key ||
+      cached.compile_flags != compile_flags || cached.dependencies.empty()) {
+    return false;
+  }
+
+  for (const auto &dependency : cached.dependencies) {
+    uint64_t hash = 0;
+    HashFile(file_source_, dependency.path, hash);
+    if (hash != dependency.content_hash) {
+      return false;
+    }
+  }
+
+  entry = std::move(cached);
+  return true;
+}
+
+auto ShaderCache::Store(const ShaderCacheEntry &entry) -> bool {
+  if (entry.bytecode.empty() || entry.dependencies.empty()) {
+    return false;
+  }
+
+  std::vector<uint8_t> image = {};
+  SerializeShaderCacheEntry(entry, image);
+  return file_source_.WriteFile(
+      GetShaderCachePath(directory_, entry.shader_key, entry.compile_flags),
+      image);
+}
+
+} // namespace ResourceLoader
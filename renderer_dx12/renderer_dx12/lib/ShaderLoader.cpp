@@ -2,13 +2,29 @@
 
 #include "ShaderLoader.h"
 
+#include <d3d12shader.h>
 #include <d3dcompiler.h>
 #include <windows.h>
 
+#include <algorithm>
+#include <chrono>
+#include <cstring>
 #include <sstream>
 
+#include "FileSource.h"
+
 namespace {
 
+const wchar_t kShaderCacheDirectory[] = L"shader/cache";
+
+UINT GetCompileFlags() {
+#if defined(_DEBUG)
+  return D3DCOMPILE_DEBUG | D3DCOMPILE_SKIP_OPTIMIZATION;
+#else
+  return 0;
+#endif
+}
+
 std::string ToAnsiString(const std::wstring &source) {
   std::string result;
   if (!source.empty()) {
@@ -27,21 +43,273 @@ void OutputErrorMessage(const std::string &message) {
   }
 }
 
+bool ReflectShader(ID3DBlob *shader_blob,
+                   ResourceLoader::ShaderReflectionData &data) {
+  Microsoft::WRL::ComPtr<ID3D12ShaderReflection> reflection;
+  if (FAILED(D3DReflect(shader_blob->GetBufferPointer(),
+                        shader_blob->GetBufferSize(),
+                        IID_PPV_ARGS(&reflection)))) {
+    return false;
+  }
+
+  D3D12_SHADER_DESC shader_desc = {};
+  if (FAILED(reflection->GetDesc(&shader_desc))) {
+    return false;
+  }
+  data.instruction_count = shader_desc.InstructionCount;
+  data.constant_buffer_count = shader_desc.ConstantBuffers;
+
+  data.bindings.clear();
+  for (UINT i = 0; i < shader_desc.BoundResources; ++i) {
+    D3D12_SHADER_INPUT_BIND_DESC bind_desc = {};
+    if (SUCCEEDED(reflection->GetResourceBindingDesc(i, &bind_desc))) {
+      data.bindings.push_back({bind_desc.Name,
+                               static_cast<uint32_t>(bind_desc.Type),
+                               bind_desc.BindPoint, bind_desc.BindCount,
+                               bind_desc.Space});
+    }
+  }
+
+  data.inputs.clear();
+  for (UINT i = 0; i < shader_desc.InputParameters; ++i) {
+    D3D12_SIGNATURE_PARAMETER_DESC parameter = {};
+    if (SUCCEEDED(reflection->GetInputParameterDesc(i, &parameter))) {
+      data.inputs.push_back({parameter.SemanticName, parameter.SemanticIndex,
+                             parameter.Register,
+                             static_cast<uint32_t>(parameter.ComponentType),
+                             parameter.Mask});
+    }
+  }
+  return true;
+}
+
 } // namespace
 
 namespace ResourceLoader {
 
-bool ShaderLoader::CompileVertexAndPixelShaders(
-    const ShaderCompileDesc &vs_desc, const ShaderCompileDesc &ps_desc) {
-  if (!CompileVertexShader(vs_desc)) {
+// Owns a copy of everything the compile reads, since the caller's desc and
+// defines may be gone before a worker picks the job up.
+struct ShaderLoader::PendingCompile {
+  ShaderCompileDesc desc;
+  std::string shader_key;
+  bool is_vertex_shader = true;
+  unsigned int index = 0;
+  std::vector<std::string> define_strings;
+  std::vector<D3D_SHADER_MACRO> defines;
+  std::promise<ShaderCompileStatus> status;
+};
+
+bool ShaderCompileBatch::IsDone() const {
+  if (!counter_.IsDone()) {
     return false;
   }
-  if (!CompilePixelShader(ps_desc)) {
-    return false;
+  for (const auto &status : statuses_) {
+    if (status.wait_for(std::chrono::seconds(0)) !=
+        std::future_status::ready) {
+      return false;
+    }
   }
   return true;
 }
 
+bool ShaderCompileBatch::Wait() {
+  job_system_.Wait(counter_);
+  for (const auto &dependency : dependencies_) {
+    dependency->Wait();
+  }
+
+  bool all_succeeded = true;
+  for (const auto &status : statuses_) {
+    all_succeeded = status.get().succeeded && all_succeeded;
+  }
+  return all_succeeded;
+}
+
+ShaderLoader::ShaderLoader() : ShaderLoader(JobSystem::Instance()) {}
+
+ShaderLoader::ShaderLoader(JobSystem &job_system)
+    : job_system_(job_system),
+      cache_(GetDiskFileSource(), kShaderCacheDirectory) {
+  // Fails harmlessly when the directory exists; entries that cannot be
+  // written only cost a compile next launch.
+  CreateDirectoryW(cache_.GetDirectory().c_str(), nullptr);
+}
+
+ShaderLoader::~ShaderLoader() {
+  // Queued compiles write into this loader.
+  std::vector<ShaderCompileBatchPtr> batches;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    batches.swap(batches_);
+  }
+  for (auto &batch : batches) {
+    batch->Wait();
+  }
+}
+
+ShaderCompileBatchPtr ShaderLoader::CompileShaders(
+    const std::vector<ShaderCompileRequest> &requests) {
+  auto batch = std::make_shared<ShaderCompileBatch>(job_system_);
+  batch->statuses_.reserve(requests.size());
+
+  std::vector<std::shared_ptr<PendingCompile>> queued;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    batches_.erase(std::remove_if(batches_.begin(), batches_.end(),
+                                  [](const ShaderCompileBatchPtr &pending) {
+                                    return pending->IsDone();
+                                  }),
+                   batches_.end());
+
+    for (const auto &request : requests) {
+      const ShaderCompileDesc &desc = request.desc;
+      const bool is_vertex_shader = request.stage == ShaderStage::kVertex;
+
+      ShaderCompileStatus invalid;
+      if (!ValidateCompileDesc(desc, is_vertex_shader,
+                               invalid.error_message)) {
+        OutputErrorMessage(invalid.error_message);
+        std::promise<ShaderCompileStatus> status;
+        status.set_value(std::move(invalid));
+        batch->statuses_.push_back(status.get_future().share());
+        continue;
+      }
+
+      const std::string file_key = ToAnsiString(desc.file_path);
+      const std::string shader_key = BuildShaderKey(desc);
+
+      ShaderIndexContainer &index_container =
+          is_vertex_shader ? vs_index_container_ : ps_index_container_;
+      ShaderIndexContainer &file_index_container =
+          is_vertex_shader ? vs_file_index_container_
+                           : ps_file_index_container_;
+      auto &blob_container = is_vertex_shader ? vertex_shader_container
+                                              : pixel_shader_container;
+      auto &reflection_container = is_vertex_shader
+                                       ? vertex_shader_reflection_
+                                       : pixel_shader_reflection_;
+      auto &state_container =
+          is_vertex_shader ? vertex_shader_state_ : pixel_shader_state_;
+
+      const auto it = index_container.find(shader_key);
+      if (it != index_container.end()) {
+        const ShaderSlotState &state = state_container[it->second];
+        batch->statuses_.push_back(state.status);
+        // A repeat within this batch is covered by its own counter.
+        auto owner = state.batch.lock();
+        if (owner && owner != batch) {
+          batch->dependencies_.push_back(std::move(owner));
+        }
+        continue;
+      }
+
+      auto pending = std::make_shared<PendingCompile>();
+      pending->desc = desc;
+      pending->shader_key = shader_key;
+      pending->is_vertex_shader = is_vertex_shader;
+      pending->index = static_cast<unsigned int>(blob_container.size());
+      for (const D3D_SHADER_MACRO *macro = desc.defines;
+           macro != nullptr && macro->Name != nullptr; ++macro) {
+        pending->define_strings.push_back(macro->Name);
+        pending->define_strings.push_back(
+            macro->Definition != nullptr ? macro->Definition : "");
+      }
+      for (size_t i = 0; i < pending->define_strings.size(); i += 2) {
+        pending->defines.push_back({pending->define_strings[i].c_str(),
+                                    pending->define_strings[i + 1].c_str()});
+      }
+      if (!pending->defines.empty()) {
+        pending->defines.push_back({nullptr, nullptr});
+        pending->desc.defines = pending->defines.data();
+      } else {
+        pending->desc.defines = nullptr;
+      }
+
+      // Reserved now, in request order, and filled in by the worker.
+      blob_container.push_back(nullptr);
+      reflection_container.emplace_back();
+      state_container.push_back(
+          {pending->status.get_future().share(), batch});
+      batch->statuses_.push_back(state_container.back().status);
+
+      index_container.emplace(shader_key, pending->index);
+      if (file_index_container.find(file_key) == file_index_container.end()) {
+        file_index_container.emplace(file_key, pending->index);
+      }
+
+      queued.push_back(std::move(pending));
+    }
+
+    if (!queued.empty()) {
+      batches_.push_back(batch);
+    }
+  }
+
+  for (auto &pending : queued) {
+    job_system_.Submit([this, pending] { RunCompile(*pending); },
+                       batch->counter_);
+  }
+  return batch;
+}
+
+void ShaderLoader::RunCompile(PendingCompile &pending) {
+  BlobPtr shader_blob;
+  ShaderReflectionData reflection;
+  ShaderCompileStatus status;
+  status.succeeded =
+      LoadOrCompile(pending.desc, pending.shader_key, pending.is_vertex_shader,
+                    shader_blob, reflection, status.error_message);
+
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    const bool is_vertex_shader = pending.is_vertex_shader;
+    if (status.succeeded) {
+      auto &blob_container = is_vertex_shader ? vertex_shader_container
+                                              : pixel_shader_container;
+      auto &reflection_container = is_vertex_shader
+                                       ? vertex_shader_reflection_
+                                       : pixel_shader_reflection_;
+      blob_container[pending.index] = shader_blob;
+      reflection_container[pending.index] = std::move(reflection);
+    } else {
+      // The slot stays empty; dropping its keys lets a later request retry.
+      ShaderIndexContainer &index_container =
+          is_vertex_shader ? vs_index_container_ : ps_index_container_;
+      ShaderIndexContainer &file_index_container =
+          is_vertex_shader ? vs_file_index_container_
+                           : ps_file_index_container_;
+      index_container.erase(pending.shader_key);
+      const auto it =
+          file_index_container.find(ToAnsiString(pending.desc.file_path));
+      if (it != file_index_container.end() && it->second == pending.index) {
+        file_index_container.erase(it);
+      }
+    }
+  }
+
+  pending.status.set_value(std::move(status));
+}
+
+bool ShaderLoader::CompileVertexAndPixelShaders(
+    const ShaderCompileDesc &vs_desc, const ShaderCompileDesc &ps_desc) {
+  last_error_message_.clear();
+
+  auto batch = CompileShaders(
+      {{ShaderStage::kVertex, vs_desc}, {ShaderStage::kPixel, ps_desc}});
+  if (batch->Wait()) {
+    return true;
+  }
+
+  for (size_t i = 0; i < batch->GetSize(); ++i) {
+    if (!batch->GetStatus(i).succeeded) {
+      last_error_message_ = batch->GetStatus(i).error_message;
+      break;
+    }
+  }
+  return false;
+}
+
 bool ShaderLoader::CompileVertexShader(const ShaderCompileDesc &desc) {
   return CompileShaderInternal(desc, true);
 }
@@ -51,49 +319,55 @@ bool ShaderLoader::CompilePixelShader(const ShaderCompileDesc &desc) {
 }
 
 BlobPtr ShaderLoader::GetVertexShaderBlobByIndex(unsigned int index) const {
+  std::lock_guard<std::mutex> lock(mutex_);
   return vertex_shader_container.at(index);
 }
 
 BlobPtr ShaderLoader::GetPixelShaderBlobByIndex(unsigned int index) const {
+  std::lock_guard<std::mutex> lock(mutex_);
   return pixel_shader_container.at(index);
 }
 
 BlobPtr ShaderLoader::GetVertexShaderBlob(const ShaderCompileDesc &desc) const {
   const std::string key = BuildShaderKey(desc);
+  std::lock_guard<std::mutex> lock(mutex_);
   const auto it = vs_index_container_.find(key);
   if (it == vs_index_container_.end()) {
     return nullptr;
   }
-  return GetVertexShaderBlobByIndex(it->second);
+  return vertex_shader_container.at(it->second);
 }
 
 BlobPtr ShaderLoader::GetPixelShaderBlob(const ShaderCompileDesc &desc) const {
   const std::string key = BuildShaderKey(desc);
+  std::lock_guard<std::mutex> lock(mutex_);
   const auto it = ps_index_container_.find(key);
   if (it == ps_index_container_.end()) {
     return nullptr;
   }
-  return GetPixelShaderBlobByIndex(it->second);
+  return pixel_shader_container.at(it->second);
 }
 
 BlobPtr ShaderLoader::GetVertexShaderBlobByFileName(WCHAR *filename) const {
   std::string s;
   WCHARToString(filename, s);
+  std::lock_guard<std::mutex> lock(mutex_);
   const auto it = vs_file_index_container_.find(s);
   if (it == vs_file_index_container_.end()) {
     return nullptr;
   }
-  return GetVertexShaderBlobByIndex(it->second);
+  return vertex_shader_container.at(it->second);
 }
 
 BlobPtr ShaderLoader::GetPixelShaderBlobByFileName(WCHAR *filename) const {
   std::string s;
   WCHARToString(filename, s);
+  std::lock_guard<std::mutex> lock(mutex_);
   const auto it = ps_file_index_container_.find(s);
   if (it == ps_file_index_container_.end()) {
     return nullptr;
   }
-  return GetPixelShaderBlobByIndex(it->second);
+  return pixel_shader_container.at(it->second);
 }
 
 BlobPtr ShaderLoader::GetVertexShaderBlobByEntryName(WCHAR * /*entry_name*/) const {
@@ -104,18 +378,81 @@ BlobPtr ShaderLoader::GetPixelShaderBlobByEntryName(WCHAR * /*entry_name*/) cons
   return BlobPtr();
 }
 
+bool ShaderLoader::GetVertexShaderReflection(
+    const ShaderCompileDesc &desc, ShaderReflectionData &reflection) const {
+  const std::string key = BuildShaderKey(desc);
+  std::lock_guard<std::mutex> lock(mutex_);
+  const auto it = vs_index_container_.find(key);
+  if (it == vs_index_container_.end() ||
+      !vertex_shader_container.at(it->second)) {
+    return false;
+  }
+  reflection = vertex_shader_reflection_.at(it->second);
+  return true;
+}
+
+bool ShaderLoader::GetPixelShaderReflection(
+    const ShaderCompileDesc &desc, ShaderReflectionData &reflection) const {
+  const std::string key = BuildShaderKey(desc);
+  std::lock_guard<std::mutex> lock(mutex_);
+  const auto it = ps_index_container_.find(key);
+  if (it == ps_index_container_.end() ||
+      !pixel_shader_container.at(it->second)) {
+    return false;
+  }
+  reflection = pixel_shader_reflection_.at(it->second);
+  return true;
+}
+
+bool ShaderLoader::CookShaders(const std::wstring &manifest_path) {
+  FileData manifest;
+  std::vector<ShaderManifestEntry> entries;
+  if (!GetDiskFileSource().ReadFile(manifest_path, manifest) ||
+      !ParseShaderManifest(manifest.GetData(), manifest.GetSize(), entries)) {
+    last_error_message_ = "ShaderLoader: Could not read shader manifest '" +
+                          ToAnsiString(manifest_path) + "'.";
+    OutputErrorMessage(last_error_message_);
+    return false;
+  }
+
+  bool all_compiled = true;
+  std::vector<ShaderCompileRequest> requests;
+  for (const auto &entry : entries) {
+    const ShaderCompileDesc desc{entry.file_path, entry.entry_point,
+                                 entry.target};
+    if (entry.target.compare(0, 3, "vs_") == 0) {
+      requests.push_back({ShaderStage::kVertex, desc});
+    } else if (entry.target.compare(0, 3, "ps_") == 0) {
+      requests.push_back({ShaderStage::kPixel, desc});
+    } else {
+      last_error_message_ = "ShaderLoader: Unsupported target '" +
+                            entry.target + "' in shader manifest.";
+      OutputErrorMessage(last_error_message_);
+      all_compiled = false;
+    }
+  }
+  all_compiled = CompileShaders(requests)->Wait() && all_compiled;
+
+  std::ostringstream oss;
+  oss << "[ShaderLoader] Cooked " << requests.size() << " shaders: "
+      << cache_hits_.load() << " up to date, " << cache_misses_.load()
+      << " compiled\n";
+  OutputDebugStringA(oss.str().c_str());
+  return all_compiled;
+}
+
 const std::string &ShaderLoader::GetLastErrorMessage() const {
   return last_error_message_;
 }
 
 bool ShaderLoader::ValidateCompileDesc(const ShaderCompileDesc &desc,
-                                       bool is_vertex_shader) {
+                                       bool is_vertex_shader,
+                                       std::string &error_message) const {
   if (desc.file_path.empty()) {
     std::ostringstream oss;
     oss << "ShaderLoader: " << ShaderTypeName(is_vertex_shader)
         << " shader file path is empty.";
-    last_error_message_ = oss.str();
-    OutputErrorMessage(last_error_message_);
+    error_message = oss.str();
     return false;
   }
 
@@ -123,8 +460,7 @@ bool ShaderLoader::ValidateCompileDesc(const ShaderCompileDesc &desc,
     std::ostringstream oss;
     oss << "ShaderLoader: entry point is empty for "
         << ShaderTypeName(is_vertex_shader) << " shader.";
-    last_error_message_ = oss.str();
-    OutputErrorMessage(last_error_message_);
+    error_message = oss.str();
     return false;
   }
 
@@ -133,8 +469,7 @@ bool ShaderLoader::ValidateCompileDesc(const ShaderCompileDesc &desc,
     oss << "ShaderLoader: target profile is empty for "
         << ShaderTypeName(is_vertex_shader) << " shader '"
         << desc.entry_point << "'.";
-    last_error_message_ = oss.str();
-    OutputErrorMessage(last_error_message_);
+    error_message = oss.str();
     return false;
   }
 
@@ -145,62 +480,82 @@ bool ShaderLoader::CompileShaderInternal(const ShaderCompileDesc &desc,
                                          bool is_vertex_shader) {
   last_error_message_.clear();
 
-  if (!ValidateCompileDesc(desc, is_vertex_shader)) {
-    return false;
+  const ShaderStage stage =
+      is_vertex_shader ? ShaderStage::kVertex : ShaderStage::kPixel;
+  auto batch = CompileShaders({{stage, desc}});
+  if (batch->Wait()) {
+    return true;
   }
 
-  const std::string file_key = ToAnsiString(desc.file_path);
-  const std::string shader_key = BuildShaderKey(desc);
-
-  ShaderIndexContainer &index_container =
-      is_vertex_shader ? vs_index_container_ : ps_index_container_;
-  ShaderIndexContainer &file_index_container =
-      is_vertex_shader ? vs_file_index_container_ : ps_file_index_container_;
-  auto &blob_container = is_vertex_shader ? vertex_shader_container
-                                          : pixel_shader_container;
+  last_error_message_ = batch->GetStatus(0).error_message;
+  return false;
+}
 
-  if (index_container.find(shader_key) != index_container.end()) {
+bool ShaderLoader::LoadOrCompile(const ShaderCompileDesc &desc,
+                                 const std::string &shader_key,
+                                 bool is_vertex_shader, BlobPtr &shader_blob,
+                                 ShaderReflectionData &reflection,
+                                 std::string &error_message) {
+  const UINT compile_flags = GetCompileFlags();
+
+  ShaderCacheEntry entry;
+  if (cache_.Load(shader_key, compile_flags, entry) &&
+      SUCCEEDED(D3DCreateBlob(entry.bytecode.size(), &shader_blob))) {
+    memcpy(shader_blob->GetBufferPointer(), entry.bytecode.data(),
+           entry.bytecode.size());
+    reflection = std::move(entry.reflection);
+    ++cache_hits_;
     return true;
   }
+  ++cache_misses_;
 
-#if defined(_DEBUG)
-  UINT compile_flags = D3DCOMPILE_DEBUG | D3DCOMPILE_SKIP_OPTIMIZATION;
-#else
-  UINT compile_flags = 0;
-#endif
+  // Hashed before compiling, so an edit made mid-compile is not mistaken for
+  // what the bytecode was built from.
+  entry = {};
+  entry.shader_key = shader_key;
+  entry.compile_flags = compile_flags;
+  const bool has_dependencies = CollectShaderDependencies(
+      GetDiskFileSource(), desc.file_path, entry.dependencies);
 
-  BlobPtr shader_blob;
+  const std::string file_key = ToAnsiString(desc.file_path);
+  BlobPtr compile_error;
+  shader_blob.Reset();
   HRESULT hr = D3DCompileFromFile(
-      desc.file_path.c_str(), desc.defines, nullptr, desc.entry_point.c_str(),
-      desc.target.c_str(), compile_flags, 0, &shader_blob, &last_compile_error_);
+      desc.file_path.c_str(), desc.defines, D3D_COMPILE_STANDARD_FILE_INCLUDE,
+      desc.entry_point.c_str(), desc.target.c_str(), compile_flags, 0,
+      &shader_blob, &compile_error);
 
   if (FAILED(hr)) {
-    if (last_compile_error_) {
-      last_error_message_.assign(
-          static_cast<const char *>(last_compile_error_->GetBufferPointer()),
-          static_cast<size_t>(last_compile_error_->GetBufferSize()));
-      last_compile_error_.Reset();
+    if (compile_error) {
+      error_message.assign(
+          static_cast<const char *>(compile_error->GetBufferPointer()),
+          static_cast<size_t>(compile_error->GetBufferSize()));
     } else {
       std::ostringstream oss;
       oss << "ShaderLoader: Failed to compile " << ShaderTypeName(is_vertex_shader)
           << " shader '" << desc.entry_point << "' from file '" << file_key
           << "'. HRESULT=0x" << std::hex << hr;
-      last_error_message_ = oss.str();
+      error_message = oss.str();
     }
-    OutputErrorMessage(last_error_message_);
+    OutputErrorMessage(error_message);
     return false;
   }
 
-  blob_container.push_back(shader_blob);
-  const unsigned int index =
-      static_cast<unsigned int>(blob_container.size() - 1);
-
-  index_container.emplace(shader_key, index);
-  if (file_index_container.find(file_key) == file_index_container.end()) {
-    file_index_container.emplace(file_key, index);
+  if (!ReflectShader(shader_blob.Get(), reflection)) {
+    reflection = {};
   }
 
-  last_error_message_.clear();
+  if (has_dependencies) {
+    const auto *bytes =
+        static_cast<const uint8_t *>(shader_blob->GetBufferPointer());
+    entry.bytecode.assign(bytes, bytes + shader_blob->GetBufferSize());
+    entry.reflection = reflection;
+    if (!cache_.Store(entry)) {
+      const std::string message =
+          "[ShaderLoader] Could not write shader cache: " + file_key + "\n";
+      OutputDebugStringA(message.c_str());
+    }
+  }
   return true;
 }
 
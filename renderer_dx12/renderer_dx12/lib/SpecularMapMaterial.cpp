@@ -41,16 +41,19 @@ auto SpecularMapMaterial::Initialize() -> bool {
   return true;
 }
 
-auto SpecularMapMaterial::GetMatrixConstantBuffer() const -> ResourceSharedPtr {
-  return matrix_constant_buffer_.GetResource();
+auto SpecularMapMaterial::GetMatrixConstantBufferAddress() const
+    -> D3D12_GPU_VIRTUAL_ADDRESS {
+  return matrix_constant_buffer_.GetGPUVirtualAddress();
 }
 
-auto SpecularMapMaterial::GetCameraConstantBuffer() const -> ResourceSharedPtr {
-  return camera_constant_buffer_.GetResource();
+auto SpecularMapMaterial::GetCameraConstantBufferAddress() const
+    -> D3D12_GPU_VIRTUAL_ADDRESS {
+  return camera_constant_buffer_.GetGPUVirtualAddress();
 }
 
-auto SpecularMapMaterial::GetLightConstantBuffer() const -> ResourceSharedPtr {
-  return light_constant_buffer_.GetResource();
+auto SpecularMapMaterial::GetLightConstantBufferAddress() const
+    -> D3D12_GPU_VIRTUAL_ADDRESS {
+  return light_constant_buffer_.GetGPUVirtualAddress();
 }
 
 auto SpecularMapMaterial::UpdateMatrixConstant(const XMMATRIX &world,
@@ -150,10 +153,7 @@ auto SpecularMapMaterial::InitializeGraphicsPipelineState() -> bool {
       {"NORMAL", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0,
        D3D12_APPEND_ALIGNED_ELEMENT, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA,
        0},
-      {"TANGENT", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0,
-       D3D12_APPEND_ALIGNED_ELEMENT, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA,
-       0},
-      {"BINORMAL", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0,
+      {"TANGENT", 0, DXGI_FORMAT_R32G32B32A32_FLOAT, 0,
        D3D12_APPEND_ALIGNED_ELEMENT, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA,
        0}};
 
@@ -0,0 +1,398 @@
+#include "stdafx.h"
+
+#include "TangentGenerator.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#include "JobSystem.h"
+
+// Defining TANGENT_GENERATOR_USE_SSE=0 forces the scalar path, which is how
+// the benchmarks measure what the SSE path buys.
+#if !defined(TANGENT_GENERATOR_USE_SSE)
+#if defined(_M_X64) || defined(_M_AMD64) || defined(__SSE2__)
+#define TANGENT_GENERATOR_USE_SSE 1
+#else
+#define TANGENT_GENERATOR_USE_SSE 0
+#endif
+#endif
+
+#if TANGENT_GENERATOR_USE_SSE
+#include <emmintrin.h>
+#endif
+
+namespace ResourceLoader {
+
+namespace {
+
+constexpr float kDegenerateEpsilon = 1e-12f;
+
+constexpr size_t kLaneCount = 4;
+
+// Runs function over lane-aligned ranges of [0, count) on the job system;
+// small inputs stay on the calling thread.
+template <typename Function>
+void ParallelRanges(size_t count, bool allow_parallel, Function &&function) {
+  if (!allow_parallel) {
+    function(size_t{0}, count);
+    return;
+  }
+
+  const size_t lane_groups = (count + kLaneCount - 1) / kLaneCount;
+  JobSystem::Instance().ParallelFor(
+      lane_groups, 0, [&function, count](size_t begin, size_t end) {
+        function(begin * kLaneCount, std::min(count, end * kLaneCount));
+      });
+}
+
+void FaceTangentScalar(const float p0[3], const float p1[3], const float p2[3],
+                       const float uv0[2], const float uv1[2],
+                       const float uv2[2], float tangent[3],
+                       float bitangent[3]) {
+  const float e1[3] = {p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2]};
+  const float e2[3] = {p2[0] - p0[0], p2[1] - p0[1], p2[2] - p0[2]};
+  const float du1 = uv1[0] - uv0[0];
+  const float dv1 = uv1[1] - uv0[1];
+  const float du2 = uv2[0] - uv0[0];
+  const float dv2 = uv2[1] - uv0[1];
+
+  const float determinant = du1 * dv2 - du2 * dv1;
+  if (fabsf(determinant) < kDegenerateEpsilon) {
+    tangent[0] = tangent[1] = tangent[2] = 0.0f;
+    bitangent[0] = bitangent[1] = bitangent[2] = 0.0f;
+    return;
+  }
+
+  const float r = 1.0f / determinant;
+  for (int i = 0; i < 3; ++i) {
+    tangent[i] = (e1[i] * dv2 - e2[i] * dv1) * r;
+    bitangent[i] = (e2[i] * du1 - e1[i] * du2) * r;
+  }
+}
+
+// Gram-Schmidt against the normal plus handedness; picks an arbitrary
+// perpendicular when the accumulated tangent vanishes (e.g. no UVs).
+void OrthonormalizeScalar(float nx, float ny, float nz, float tx, float ty,
+                          float tz, float bx, float by, float bz, float &out_x,
+                          float &out_y, float &out_z, float &out_w) {
+  const float normal_length = sqrtf(nx * nx + ny * ny + nz * nz);
+  if (normal_length > 0.0f) {
+    nx /= normal_length;
+    ny /= normal_length;
+    nz /= normal_length;
+  } else {
+    nx = 0.0f;
+    ny = 0.0f;
+    nz = 1.0f;
+  }
+
+  float n_dot_t = nx * tx + ny * ty + nz * tz;
+  float x = tx - nx * n_dot_t;
+  float y = ty - ny * n_dot_t;
+  float z = tz - nz * n_dot_t;
+  float length_squared = x * x + y * y + z * z;
+
+  if (length_squared < kDegenerateEpsilon) {
+    const bool use_x_axis = fabsf(nx) < 0.9f;
+    tx = use_x_axis ? 1.0f : 0.0f;
+    ty = use_x_axis ? 0.0f : 1.0f;
+    tz = 0.0f;
+    n_dot_t = nx * tx + ny * ty;
+    x = tx - nx * n_dot_t;
+    y = ty - ny * n_dot_t;
+    z = tz - nz * n_dot_t;
+    length_squared = x * x + y * y + z * z;
+  }
+
+  const float inverse_length = 1.0f / sqrtf(length_squared);
+  out_x = x * inverse_length;
+  out_y = y * inverse_length;
+  out_z = z * inverse_length;
+
+  const float cross_x = ny * out_z - nz * out_y;
+  const float cross_y = nz * out_x - nx * out_z;
+  const float cross_z = nx * out_y - ny * out_x;
+  out_w = (cross_x * bx + cross_y * by + cross_z * bz) < 0.0f ? -1.0f : 1.0f;
+}
+
+} // namespace
+
+auto TangentGenerator::SetSourceVertices(const void *vertices,
+                                         uint32_t vertex_count, size_t stride)
+    -> bool {
+  if (!vertices || vertex_count == 0 || stride < sizeof(float) * 8) {
+    return false;
+  }
+
+  vertex_count_ = vertex_count;
+  for (auto *stream :
+       {&position_x_, &position_y_, &position_z_, &texcoord_u_, &texcoord_v_,
+        &normal_x_, &normal_y_, &normal_z_}) {
+    stream->resize(vertex_count);
+  }
+
+  const auto *source = static_cast<const uint8_t *>(vertices);
+  for (uint32_t i = 0; i < vertex_count; ++i) {
+    float values[8];
+    memcpy(values, source, sizeof(values));
+    position_x_[i] = values[0];
+    position_y_[i] = values[1];
+    position_z_[i] = values[2];
+    texcoord_u_[i] = values[3];
+    texcoord_v_[i] = values[4];
+    normal_x_[i] = values[5];
+    normal_y_[i] = values[6];
+    normal_z_[i] = values[7];
+    source += stride;
+  }
+  return true;
+}
+
+auto TangentGenerator::Generate(const uint32_t *indices, size_t index_count)
+    -> bool {
+  if (vertex_count_ == 0 || !indices || index_count < 3) {
+    return false;
+  }
+
+  const size_t face_count = index_count / 3;
+  for (size_t i = 0; i < face_count * 3; ++i) {
+    if (indices[i] >= vertex_count_) {
+      return false;
+    }
+  }
+
+  for (auto *stream : {&face_tangent_x_, &face_tangent_y_, &face_tangent_z_,
+                       &face_bitangent_x_, &face_bitangent_y_,
+                       &face_bitangent_z_}) {
+    stream->resize(face_count);
+  }
+  for (auto *stream : {&tangent_x_, &tangent_y_, &tangent_z_, &tangent_w_}) {
+    stream->resize(vertex_count_);
+  }
+
+  adjacency_offsets_.assign(vertex_count_ + 1, 0);
+  for (size_t i = 0; i < face_count * 3; ++i) {
+    ++adjacency_offsets_[indices[i] + 1];
+  }
+  for (uint32_t v = 0; v < vertex_count_; ++v) {
+    adjacency_offsets_[v + 1] += adjacency_offsets_[v];
+  }
+  adjacency_.resize(face_count * 3);
+  {
+    std::vector<uint32_t> fill(adjacency_offsets_.begin(),
+                               adjacency_offsets_.end() - 1);
+    for (size_t i = 0; i < face_count * 3; ++i) {
+      adjacency_[fill[indices[i]]++] = static_cast<uint32_t>(i / 3);
+    }
+  }
+
+  const bool allow_parallel = face_count >= kParallelTriangleThreshold;
+  ParallelRanges(face_count, allow_parallel, [&](size_t begin, size_t end) {
+    ComputeFaceTangents(indices, begin, end);
+  });
+  ParallelRanges(vertex_count_, allow_parallel, [&](size_t begin, size_t end) {
+    ResolveVertexTangents(begin, end);
+  });
+  return true;
+}
+
+void TangentGenerator::StoreTangents(void *destination, size_t stride,
+                                     size_t offset) const {
+  auto *output = static_cast<uint8_t *>(destination) + offset;
+  for (uint32_t i = 0; i < vertex_count_; ++i) {
+    const float tangent[4] = {tangent_x_[i], tangent_y_[i], tangent_z_[i],
+                              tangent_w_[i]};
+    memcpy(output, tangent, sizeof(tangent));
+    output += stride;
+  }
+}
+
+void TangentGenerator::ComputeFaceTangents(const uint32_t *indices,
+                                           size_t first_face,
+                                           size_t last_face) {
+  size_t face = first_face;
+
+#if TANGENT_GENERATOR_USE_SSE
+  const __m128 epsilon = _mm_set1_ps(kDegenerateEpsilon);
+  const __m128 sign_mask = _mm_set1_ps(-0.0f);
+  const __m128 one = _mm_set1_ps(1.0f);
+
+  auto gather = [](const std::vector<float> &stream, const uint32_t *corner) {
+    return _mm_setr_ps(stream[corner[0]], stream[corner[3]], stream[corner[6]],
+                       stream[corner[9]]);
+  };
+
+  for (; face + kLaneCount <= last_face; face += kLaneCount) {
+    const uint32_t *corners = indices + face * 3;
+
+    const __m128 p0x = gather(position_x_, corners);
+    const __m128 p0y = gather(position_y_, corners);
+    const __m128 p0z = gather(position_z_, corners);
+    const __m128 e1x = _mm_sub_ps(gather(position_x_, corners + 1), p0x);
+    const __m128 e1y = _mm_sub_ps(gather(position_y_, corners + 1), p0y);
+    const __m128 e1z = _mm_sub_ps(gather(position_z_, corners + 1), p0z);
+    const __m128 e2x = _mm_sub_ps(gather(position_x_, corners + 2), p0x);
+    const __m128 e2y = _mm_sub_ps(gather(position_y_, corners + 2), p0y);
+    const __m128 e2z = _mm_sub_ps(gather(position_z_, corners + 2), p0z);
+
+    const __m128 u0 = gather(texcoord_u_, corners);
+    const __m128 v0 = gather(texcoord_v_, corners);
+    const __m128 du1 = _mm_sub_ps(gather(texcoord_u_, corners + 1), u0);
+    const __m128 dv1 = _mm_sub_ps(gather(texcoord_v_, corners + 1), v0);
+    const __m128 du2 = _mm_sub_ps(gather(texcoord_u_, corners + 2), u0);
+    const __m128 dv2 = _mm_sub_ps(gather(texcoord_v_, corners + 2), v0);
+
+    const __m128 determinant =
+        _mm_sub_ps(_mm_mul_ps(du1, dv2), _mm_mul_ps(du2, dv1));
+    // Degenerate UV triangles contribute nothing.
+    const __m128 valid =
+        _mm_cmpge_ps(_mm_andnot_ps(sign_mask, determinant), epsilon);
+    const __m128 safe_determinant = _mm_or_ps(_mm_and_ps(valid, determinant),
+                                              _mm_andnot_ps(valid, one));
+    const __m128 r = _mm_and_ps(valid, _mm_div_ps(one, safe_determinant));
+
+    auto tangent = [&](__m128 e1, __m128 e2) {
+      return _mm_mul_ps(_mm_sub_ps(_mm_mul_ps(e1, dv2), _mm_mul_ps(e2, dv1)),
+                        r);
+    };
+    auto bitangent = [&](__m128 e1, __m128 e2) {
+      return _mm_mul_ps(_mm_sub_ps(_mm_mul_ps(e2, du1), _mm_mul_ps(e1, du2)),
+                        r);
+    };
+
+    _mm_storeu_ps(&face_tangent_x_[face], tangent(e1x, e2x));
+    _mm_storeu_ps(&face_tangent_y_[face], tangent(e1y, e2y));
+    _mm_storeu_ps(&face_tangent_z_[face], tangent(e1z, e2z));
+    _mm_storeu_ps(&face_bitangent_x_[face], bitangent(e1x, e2x));
+    _mm_storeu_ps(&face_bitangent_y_[face], bitangent(e1y, e2y));
+    _mm_storeu_ps(&face_bitangent_z_[face], bitangent(e1z, e2z));
+  }
+#endif
+
+  for (; face < last_face; ++face) {
+    const uint32_t *corners = indices + face * 3;
+    float p[3][3];
+    float uv[3][2];
+    for (int k = 0; k < 3; ++k) {
+      p[k][0] = position_x_[corners[k]];
+      p[k][1] = position_y_[corners[k]];
+      p[k][2] = position_z_[corners[k]];
+      uv[k][0] = texcoord_u_[corners[k]];
+      uv[k][1] = texcoord_v_[corners[k]];
+    }
+
+    float tangent[3];
+    float bitangent[3];
+    FaceTangentScalar(p[0], p[1], p[2], uv[0], uv[1], uv[2], tangent,
+                      bitangent);
+    face_tangent_x_[face] = tangent[0];
+    face_tangent_y_[face] = tangent[1];
+    face_tangent_z_[face] = tangent[2];
+    face_bitangent_x_[face] = bitangent[0];
+    face_bitangent_y_[face] = bitangent[1];
+    face_bitangent_z_[face] = bitangent[2];
+  }
+}
+
+void TangentGenerator::ResolveVertexTangents(size_t first_vertex,
+                                             size_t last_vertex) {
+  for (size_t base = first_vertex; base < last_vertex; base += kLaneCount) {
+    const size_t lanes = std::min(kLaneCount, last_vertex - base);
+
+    // Accumulate adjacent face vectors into a lane block.
+    alignas(16) float sum_t[3][kLaneCount] = {};
+    alignas(16) float sum_b[3][kLaneCount] = {};
+    alignas(16) float normal[3][kLaneCount] = {};
+    for (size_t lane = 0; lane < lanes; ++lane) {
+      const size_t v = base + lane;
+      for (uint32_t j = adjacency_offsets_[v]; j < adjacency_offsets_[v + 1];
+           ++j) {
+        const uint32_t face = adjacency_[j];
+        sum_t[0][lane] += face_tangent_x_[face];
+        sum_t[1][lane] += face_tangent_y_[face];
+        sum_t[2][lane] += face_tangent_z_[face];
+        sum_b[0][lane] += face_bitangent_x_[face];
+        sum_b[1][lane] += face_bitangent_y_[face];
+        sum_b[2][lane] += face_bitangent_z_[face];
+      }
+      normal[0][lane] = normal_x_[v];
+      normal[1][lane] = normal_y_[v];
+      normal[2][lane] = normal_z_[v];
+    }
+
+    alignas(16) float out[4][kLaneCount] = {};
+    int fallback_mask = (1 << lanes) - 1;
+
+#if TANGENT_GENERATOR_USE_SSE
+    const __m128 nx_raw = _mm_load_ps(normal[0]);
+    const __m128 ny_raw = _mm_load_ps(normal[1]);
+    const __m128 nz_raw = _mm_load_ps(normal[2]);
+    const __m128 tx = _mm_load_ps(sum_t[0]);
+    const __m128 ty = _mm_load_ps(sum_t[1]);
+    const __m128 tz = _mm_load_ps(sum_t[2]);
+
+    auto dot = [](__m128 ax, __m128 ay, __m128 az, __m128 bx, __m128 by,
+                  __m128 bz) {
+      return _mm_add_ps(_mm_add_ps(_mm_mul_ps(ax, bx), _mm_mul_ps(ay, by)),
+                        _mm_mul_ps(az, bz));
+    };
+
+    const __m128 epsilon = _mm_set1_ps(kDegenerateEpsilon);
+    const __m128 normal_length_squared =
+        dot(nx_raw, ny_raw, nz_raw, nx_raw, ny_raw, nz_raw);
+    const __m128 normal_scale =
+        _mm_div_ps(_mm_set1_ps(1.0f),
+                   _mm_sqrt_ps(_mm_max_ps(normal_length_squared, epsilon)));
+    const __m128 nx = _mm_mul_ps(nx_raw, normal_scale);
+    const __m128 ny = _mm_mul_ps(ny_raw, normal_scale);
+    const __m128 nz = _mm_mul_ps(nz_raw, normal_scale);
+
+    const __m128 n_dot_t = dot(nx, ny, nz, tx, ty, tz);
+    const __m128 ox = _mm_sub_ps(tx, _mm_mul_ps(nx, n_dot_t));
+    const __m128 oy = _mm_sub_ps(ty, _mm_mul_ps(ny, n_dot_t));
+    const __m128 oz = _mm_sub_ps(tz, _mm_mul_ps(nz, n_dot_t));
+    const __m128 length_squared = dot(ox, oy, oz, ox, oy, oz);
+    const __m128 valid = _mm_and_ps(_mm_cmpge_ps(length_squared, epsilon),
+                                    _mm_cmpge_ps(normal_length_squared, epsilon));
+    const __m128 scale = _mm_div_ps(
+        _mm_set1_ps(1.0f), _mm_sqrt_ps(_mm_max_ps(length_squared, epsilon)));
+    const __m128 rx = _mm_mul_ps(ox, scale);
+    const __m128 ry = _mm_mul_ps(oy, scale);
+    const __m128 rz = _mm_mul_ps(oz, scale);
+
+    // w = sign(dot(cross(n, t), b))
+    const __m128 cx = _mm_sub_ps(_mm_mul_ps(ny, rz), _mm_mul_ps(nz, ry));
+    const __m128 cy = _mm_sub_ps(_mm_mul_ps(nz, rx), _mm_mul_ps(nx, rz));
+    const __m128 cz = _mm_sub_ps(_mm_mul_ps(nx, ry), _mm_mul_ps(ny, rx));
+    const __m128 handedness = dot(cx, cy, cz, _mm_load_ps(sum_b[0]),
+                                  _mm_load_ps(sum_b[1]), _mm_load_ps(sum_b[2]));
+    const __m128 w = _mm_or_ps(_mm_set1_ps(1.0f),
+                               _mm_and_ps(_mm_cmplt_ps(handedness,
+                                                       _mm_setzero_ps()),
+                                          _mm_set1_ps(-0.0f)));
+
+    _mm_store_ps(out[0], rx);
+    _mm_store_ps(out[1], ry);
+    _mm_store_ps(out[2], rz);
+    _mm_store_ps(out[3], w);
+    fallback_mask &= ~_mm_movemask_ps(valid);
+#endif
+
+    for (size_t lane = 0; lane < lanes; ++lane) {
+      if (fallback_mask & (1 << lane)) {
+        OrthonormalizeScalar(normal[0][lane], normal[1][lane], normal[2][lane],
+                             sum_t[0][lane], sum_t[1][lane], sum_t[2][lane],
+                             sum_b[0][lane], sum_b[1][lane], sum_b[2][lane],
+                             out[0][lane], out[1][lane], out[2][lane],
+                             out[3][lane]);
+      }
+      tangent_x_[base + lane] = out[0][lane];
+      tangent_y_[base + lane] = out[1][lane];
+      tangent_z_[base + lane] = out[2][lane];
+      tangent_w_[base + lane] = out[3][lane];
+    }
+  }
+}
+
+} // namespace ResourceLoader
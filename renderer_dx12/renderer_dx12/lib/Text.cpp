@@ -2,6 +2,7 @@
 
 #include "Text.h"
 
+#include <cwchar>
 #include <utility>
 
 #include "DirectX12Device.h"
@@ -73,6 +74,23 @@ bool Text::SetCpu(int cpu_percentage_value) {
   return true;
 }
 
+bool Text::SetInstancing(UINT draw_count, UINT instance_count,
+                         float record_milliseconds) {
+
+  // Cut short rather than fail if the numbers ever outgrow the sentence.
+  WCHAR instancingString[48] = {};
+  _snwprintf_s(instancingString, _countof(instancingString), _TRUNCATE,
+               L"Draws: %u  Instances: %u  %.2f ms", draw_count,
+               instance_count, record_milliseconds);
+
+  if (!UpdateSentenceVertexBuffer(sentence_vector_.at(2), instancingString,
+                                  20, 60, 0.0f, 1.0f, 0.0f)) {
+    return false;
+  }
+
+  return true;
+}
+
 bool Text::Initialize(int screen_width, int screen_height,
                       const DirectX::XMMATRIX &base_view_matrix) {
 
@@ -109,6 +127,19 @@ bool Text::Initialize(int screen_width, int screen_height,
   }
   sentence_vector_.push_back(sentence2);
 
+  SentenceType *sentence3 = nullptr;
+  if (!InitializeSentence(&sentence3, 48)) {
+    delete sentence3;
+    return false;
+  }
+
+  if (!UpdateSentenceVertexBuffer(sentence3, L"Draws: 0", 20, 60, 0.0f,
+                                       1.0f, 0.0f)) {
+    delete sentence3;
+    return false;
+  }
+  sentence_vector_.push_back(sentence3);
+
   if (!material_.Initialize()) {
     return false;
   }
@@ -155,22 +186,10 @@ bool Text::InitializeSentence(SentenceType **sentence, int max_length) {
     indices[i] = i;
   }
 
-  if (FAILED(device_->GetD3d12Device()->CreateCommittedResource(
-          &CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_DEFAULT),
-          D3D12_HEAP_FLAG_NONE,
-          &CD3DX12_RESOURCE_DESC::Buffer(sizeof(VertexType) *
-                                         (*sentence)->vertex_count_),
-          D3D12_RESOURCE_STATE_COMMON, nullptr,
-          IID_PPV_ARGS(&(*sentence)->vertex_buffer_)))) {
-    return false;
-  }
-
-  (*sentence)->vertex_buffer_view_.BufferLocation =
-      (*sentence)->vertex_buffer_->GetGPUVirtualAddress();
+  (*sentence)->vertices_.assign((*sentence)->vertex_count_, VertexType{});
   (*sentence)->vertex_buffer_view_.SizeInBytes =
       sizeof(VertexType) * (*sentence)->vertex_count_;
   (*sentence)->vertex_buffer_view_.StrideInBytes = sizeof(VertexType);
-  (*sentence)->vertex_buffer_state_ = D3D12_RESOURCE_STATE_COMMON;
 
   auto device = device_->GetD3d12Device();
 
@@ -295,8 +314,8 @@ bool Text::InitializeSentence(SentenceType **sentence, int max_length) {
   return true;
 }
 
-DescriptorHeapPtr Text::GetShaderResourceView() const {
-  return texture_container_->GetTexturesDescriptorHeap();
+D3D12_GPU_DESCRIPTOR_HANDLE Text::GetShaderResourceView() const {
+  return texture_container_->GetTexturesDescriptorTable();
 }
 
 bool Text::LoadTexture(WCHAR **filename_arr) {
@@ -325,99 +344,49 @@ bool Text::UpdateSentenceVertexBuffer(SentenceType *sentence, WCHAR *text,
     return false;
   }
 
-  auto vertices = new VertexType[sentence->vertex_count_];
-  if (!vertices) {
-    return false;
-  }
-
-  memset(vertices, 0, (sizeof(VertexType) * sentence->vertex_count_));
+  sentence->vertices_.assign(sentence->vertex_count_, VertexType{});
 
   auto drawX = static_cast<float>(((screen_width_ / 2) * -1) + positionX);
   auto drawY = static_cast<float>((screen_height_ / 2) - positionY);
 
-  font_->BuildVertexArray((void *)vertices, text, drawX, drawY);
+  font_->BuildVertexArray((void *)sentence->vertices_.data(), text, drawX,
+                          drawY);
 
-  auto device = device_->GetD3d12Device();
-
-  ResourceSharedPtr upload_vertex_buffer = nullptr;
-  if (FAILED(device->CreateCommittedResource(
-          &CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD),
-          D3D12_HEAP_FLAG_NONE,
-          &CD3DX12_RESOURCE_DESC::Buffer(sizeof(VertexType) *
-                                         sentence->vertex_count_),
-          D3D12_RESOURCE_STATE_GENERIC_READ, nullptr,
-          IID_PPV_ARGS(&upload_vertex_buffer)))) {
-    return false;
-  }
-
-  D3D12_SUBRESOURCE_DATA init_data = {};
-  init_data.pData = vertices;
-  init_data.RowPitch = sizeof(VertexType);
-  init_data.SlicePitch = sizeof(VertexType) * sentence->vertex_count_;
-
-  auto command_allocator = device_->GetDefaultGraphicsCommandAllocator().Get();
-  auto command_list = device_->GetDefaultGraphicsCommandList().Get();
-
-  if (FAILED(command_allocator->Reset())) {
-    return false;
-  }
-  if (FAILED(command_list->Reset(command_allocator, nullptr))) {
-    return false;
-  }
-
-  if (sentence->vertex_buffer_state_ != D3D12_RESOURCE_STATE_COPY_DEST) {
-    auto to_copy = CD3DX12_RESOURCE_BARRIER::Transition(
-        sentence->vertex_buffer_.Get(), sentence->vertex_buffer_state_,
-        D3D12_RESOURCE_STATE_COPY_DEST);
-    command_list->ResourceBarrier(1, &to_copy);
-    sentence->vertex_buffer_state_ = D3D12_RESOURCE_STATE_COPY_DEST;
-  }
-
-  UpdateSubresources(command_list, sentence->vertex_buffer_.Get(),
-                     upload_vertex_buffer.Get(), 0, 0, 1, &init_data);
-
-  auto to_vertex = CD3DX12_RESOURCE_BARRIER::Transition(
-      sentence->vertex_buffer_.Get(), sentence->vertex_buffer_state_,
-      D3D12_RESOURCE_STATE_VERTEX_AND_CONSTANT_BUFFER);
-  command_list->ResourceBarrier(1, &to_vertex);
-  sentence->vertex_buffer_state_ =
-      D3D12_RESOURCE_STATE_VERTEX_AND_CONSTANT_BUFFER;
-
-  if (FAILED(command_list->Close())) {
-    return false;
-  }
-
-  auto command_queue = device_->GetDefaultGraphicsCommandQueeue().Get();
-  ID3D12CommandList *ppCommandLists[] = {command_list};
-  command_queue->ExecuteCommandLists(1, ppCommandLists);
-
-  auto fence_event = CreateEvent(nullptr, false, false, nullptr);
-  if (nullptr == fence_event) {
-    return false;
-  }
-
-  Microsoft::WRL::ComPtr<ID3D12Fence> fence;
-  if (FAILED(device_->GetD3d12Device()->CreateFence(0, D3D12_FENCE_FLAG_NONE,
-                                                    IID_PPV_ARGS(&fence)))) {
-    return false;
-  }
+  return UploadSentenceVertices(sentence);
+}
 
-  if (FAILED(command_queue->Signal(fence.Get(), 1))) {
-    return false;
+const D3D12_VERTEX_BUFFER_VIEW &Text::GetVertexBufferView(int index) {
+  auto sentence = sentence_vector_.at(index);
+  if (sentence->uploaded_frame_ != device_->GetCurrentFrameFenceValue()) {
+    UploadSentenceVertices(sentence);
   }
+  return sentence->vertex_buffer_view_;
+}
 
-  if (fence->GetCompletedValue() < 1) {
-    if (FAILED(fence->SetEventOnCompletion(1, fence_event))) {
+bool Text::PrepareFrame() {
+  for (auto sentence : sentence_vector_) {
+    if (sentence->uploaded_frame_ != device_->GetCurrentFrameFenceValue() &&
+        !UploadSentenceVertices(sentence)) {
       return false;
     }
-    WaitForSingleObject(fence_event, INFINITE);
   }
+  return true;
+}
 
-  CloseHandle(fence_event);
+bool Text::UploadSentenceVertices(SentenceType *sentence) {
+  // Sentences change every frame, so the vertices live in the frame's
+  // transient upload memory instead of a buffer the GPU may still be reading.
+  const auto size = sizeof(VertexType) * sentence->vertices_.size();
 
-  delete[] vertices;
-  vertices = nullptr;
+  LinearAllocation allocation = {};
+  if (!device_->AllocateFrameMemory(size, alignof(VertexType), allocation)) {
+    OutputDebugStringW(L"[Text] Out of frame memory for sentence vertices.\n");
+    return false;
+  }
+  memcpy(allocation.cpu_address, sentence->vertices_.data(), size);
 
+  sentence->vertex_buffer_view_.BufferLocation = allocation.gpu_address;
+  sentence->uploaded_frame_ = device_->GetCurrentFrameFenceValue();
   return true;
 }
 
@@ -0,0 +1,107 @@
+#include "stdafx.h"
+
+#include "TextMeshParser.h"
+
+#include <charconv>
+#include <cstring>
+
+namespace ResourceLoader {
+
+auto TextMeshParser::ParseHeader(uint32_t &vertex_count) -> bool {
+  if (!SkipPast(':')) {
+    return Fail("expected 'Vertex Count:'");
+  }
+
+  SkipWhitespace();
+  const auto result = std::from_chars(cursor_, end_, vertex_count);
+  if (result.ec != std::errc() || vertex_count == 0) {
+    return Fail("expected a positive vertex count");
+  }
+  cursor_ = result.ptr;
+
+  if (!SkipPast(':')) {
+    return Fail("expected 'Data:'");
+  }
+  return true;
+}
+
+auto TextMeshParser::ParseVertices(void *destination, size_t stride,
+                                   uint32_t vertex_count) -> bool {
+  if (!destination || stride < sizeof(float) * kFloatsPerVertex) {
+    return Fail("invalid vertex destination");
+  }
+
+  auto *output = static_cast<uint8_t *>(destination);
+  for (uint32_t i = 0; i < vertex_count; ++i) {
+    float values[kFloatsPerVertex];
+    for (auto &value : values) {
+      if (!ParseFloat(value)) {
+        return false;
+      }
+    }
+    memcpy(output, values, sizeof(values));
+    output += stride;
+  }
+  return true;
+}
+
+void TextMeshParser::SkipWhitespace() {
+  while (cursor_ < end_ && (*cursor_ == ' ' || *cursor_ == '\t' ||
+                            *cursor_ == '\r' || *cursor_ == '\n')) {
+    ++cursor_;
+  }
+}
+
+auto TextMeshParser::SkipPast(char delimiter) -> bool {
+  const void *found = memchr(cursor_, delimiter, end_ - cursor_);
+  if (!found) {
+    return false;
+  }
+  cursor_ = static_cast<const char *>(found) + 1;
+  return true;
+}
+
+auto TextMeshParser::ParseFloat(float &value) -> bool {
+  SkipWhitespace();
+  if (cursor_ == end_) {
+    return Fail("unexpected end of file");
+  }
+
+  // from_chars rejects an explicit '+', which some exporters emit.
+  const char *start = cursor_;
+  if (*start == '+') {
+    ++start;
+  }
+
+  const auto result = std::from_chars(start, end_, value);
+  if (result.ec != std::errc()) {
+    return Fail("expected a floating-point value");
+  }
+  cursor_ = result.ptr;
+  return true;
+}
+
+auto TextMeshParser::Fail(const char *message) -> bool {
+  // Line/column are only needed on failure, so compute them lazily here.
+  error_.line = 1;
+  error_.column = 1;
+  for (const char *it = begin_; it < cursor_ && it < end_; ++it) {
+    if (*it == '\n') {
+      ++error_.line;
+      error_.column = 1;
+    } else {
+      ++error_.column;
+    }
+  }
+  error_.message = message;
+  return false;
+}
+
+auto FormatTextMeshParseError(const TextMeshParseError &error)
+    -> std::string {
+  return "line " + std::to_string(error.line) + ", column " +
+         std::to_string(error.column) + ": " +
+         (error.message ? error.message : "unknown error");
+}
+
+} // namespace ResourceLoader
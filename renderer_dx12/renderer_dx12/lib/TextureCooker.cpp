@@ -0,0 +1,142 @@
+#include "stdafx.h"
+
+#include "TextureCooker.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include "DDSFile.h"
+
+namespace ResourceLoader {
+
+namespace {
+
+constexpr uint32_t kCookMagic = MAKEFOURCC('C', 'O', 'O', 'K');
+
+// Bump when the encoder output changes so old caches are cooked again.
+constexpr uint32_t kCookVersion = 1;
+
+// DDS_HEADER::reserved1 of a cooked image.
+enum CookField : uint32_t {
+  kCookFieldMagic,
+  kCookFieldKey,
+  kCookFieldSourceSizeLow,
+  kCookFieldSourceSizeHigh,
+  kCookFieldSourceTimeLow,
+  kCookFieldSourceTimeHigh,
+};
+
+auto GetCookKey(const TextureCookDesc &desc) -> uint32_t {
+  return (kCookVersion << 16) | (static_cast<uint32_t>(desc.quality) << 8) |
+         static_cast<uint32_t>(desc.usage);
+}
+
+auto GetBlockDXGIFormat(BlockFormat format, bool is_srgb) -> DXGI_FORMAT {
+  switch (format) {
+  case BlockFormat::kBC1:
+    return is_srgb ? DXGI_FORMAT_BC1_UNORM_SRGB : DXGI_FORMAT_BC1_UNORM;
+  case BlockFormat::kBC3:
+    return is_srgb ? DXGI_FORMAT_BC3_UNORM_SRGB : DXGI_FORMAT_BC3_UNORM;
+  case BlockFormat::kBC4:
+    return DXGI_FORMAT_BC4_UNORM;
+  case BlockFormat::kBC5:
+    return DXGI_FORMAT_BC5_UNORM;
+  case BlockFormat::kBC7:
+    return is_srgb ? DXGI_FORMAT_BC7_UNORM_SRGB : DXGI_FORMAT_BC7_UNORM;
+  }
+  return DXGI_FORMAT_UNKNOWN;
+}
+
+} // namespace
+
+auto GetTextureCachePath(const std::wstring &source_path) -> std::wstring {
+  const auto dot = source_path.find_last_of(L'.');
+  const auto slash = source_path.find_last_of(L"\\/");
+  if (dot == std::wstring::npos ||
+      (slash != std::wstring::npos && dot < slash)) {
+    return source_path + L".bc.dds";
+  }
+  return source_path.substr(0, dot) + L".bc.dds";
+}
+
+auto CookTextureImage(JobSystem &job_system, const uint8_t *pixels,
+                      const std::vector<MipLevel> &levels,
+                      const TextureCookDesc &desc, std::vector<uint8_t> &image)
+    -> bool {
+  if (!pixels || levels.empty() || levels[0].width % 4 != 0 ||
+      levels[0].height % 4 != 0) {
+    return false;
+  }
+
+  const MipLevel &last = levels.back();
+  const size_t chain_size =
+      last.offset + static_cast<size_t>(last.width) * last.height * 4;
+
+  // The encoder reads RGBA.
+  std::vector<uint8_t> swizzled = {};
+  if (desc.is_bgra) {
+    swizzled.assign(pixels, pixels + chain_size);
+    for (size_t i = 0; i < chain_size; i += 4) {
+      std::swap(swizzled[i], swizzled[i + 2]);
+    }
+    pixels = swizzled.data();
+  }
+
+  const BlockFormat format = SelectBlockFormat(
+      desc.usage, pixels + levels[0].offset, levels[0].width, levels[0].height);
+
+  size_t compressed_size = 0;
+  for (const auto &level : levels) {
+    compressed_size += GetCompressedSize(level.width, level.height, format);
+  }
+
+  std::vector<uint8_t> blocks(compressed_size);
+  size_t offset = 0;
+  for (const auto &level : levels) {
+    if (!CompressImage(job_system, pixels + level.offset, level.width,
+                       level.height, format, desc.quality,
+                       blocks.data() + offset)) {
+      return false;
+    }
+    offset += GetCompressedSize(level.width, level.height, format);
+  }
+
+  DDSImageDesc dds = {};
+  dds.format = GetBlockDXGIFormat(format, desc.is_srgb);
+  dds.width = levels[0].width;
+  dds.height = levels[0].height;
+  dds.mip_count = static_cast<uint32_t>(levels.size());
+  dds.data = blocks.data();
+  dds.size = blocks.size();
+  dds.reserved[kCookFieldMagic] = kCookMagic;
+  dds.reserved[kCookFieldKey] = GetCookKey(desc);
+  dds.reserved[kCookFieldSourceSizeLow] =
+      static_cast<uint32_t>(desc.source.size);
+  dds.reserved[kCookFieldSourceSizeHigh] =
+      static_cast<uint32_t>(desc.source.size >> 32);
+  dds.reserved[kCookFieldSourceTimeLow] =
+      static_cast<uint32_t>(desc.source.last_write_time);
+  dds.reserved[kCookFieldSourceTimeHigh] =
+      static_cast<uint32_t>(desc.source.last_write_time >> 32);
+  return BuildDDSImage(dds, image);
+}
+
+auto IsCookedTextureCurrent(const uint8_t *data, size_t size,
+                            const TextureCookDesc &desc) -> bool {
+  uint32_t reserved[11] = {};
+  if (!ReadDDSReserved(data, size, reserved)) {
+    return false;
+  }
+  const uint64_t source_size =
+      reserved[kCookFieldSourceSizeLow] |
+      (static_cast<uint64_t>(reserved[kCookFieldSourceSizeHigh]) << 32);
+  const uint64_t source_time =
+      reserved[kCookFieldSourceTimeLow] |
+      (static_cast<uint64_t>(reserved[kCookFieldSourceTimeHigh]) << 32);
+  return reserved[kCookFieldMagic] == kCookMagic &&
+         reserved[kCookFieldKey] == GetCookKey(desc) &&
+         source_size == desc.source.size &&
+         source_time == desc.source.last_write_time;
+}
+
+} // namespace ResourceLoader
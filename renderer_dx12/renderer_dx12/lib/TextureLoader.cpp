@@ -1,12 +1,22 @@
 #include "stdafx.h"
 
+#include "AssetRegistry.h"
+#include "AssetStreamer.h"
+#include "DDSFile.h"
 #include "DDSTextureLoader.h"
 #include "DirectX12Device.h"
+#include "JobSystem.h"
+#include "MipGenerator.h"
+#include "TargaFile.h"
+#include "TextureCooker.h"
 #include "TextureLoader.h"
+#include "UploadContext.h"
 
 #include <algorithm>
+#include <cstring>
 #include <cwctype>
-#include <fstream>
+#include <memory>
+#include <sstream>
 #include <string>
 #include <utility>
 #include <vector>
@@ -17,113 +27,27 @@ namespace ResourceLoader {
 
 namespace {
 
-#pragma pack(push, 1)
-struct TargaHeader {
-  uint8_t id_length;
-  uint8_t color_map_type;
-  uint8_t data_type_code;
-  uint16_t color_map_origin;
-  uint16_t color_map_length;
-  uint8_t color_map_depth;
-  uint16_t x_origin;
-  uint16_t y_origin;
-  uint16_t width;
-  uint16_t height;
-  uint8_t bits_per_pixel;
-  uint8_t image_descriptor;
-};
-#pragma pack(pop)
-
-struct HandleCloser {
-  explicit HandleCloser(HANDLE h) : handle(h) {}
-  ~HandleCloser() {
-    if (handle) {
-      CloseHandle(handle);
-    }
-  }
-  HANDLE Handle() const { return handle; }
-  HANDLE handle = nullptr;
-};
-
-bool LoadTarga32Bit(const std::wstring &file_path, std::vector<uint8_t> &data,
-                    uint32_t &width, uint32_t &height) {
-  std::ifstream file(file_path, std::ios::binary);
-  if (!file) {
-    return false;
-  }
-
-  TargaHeader header = {};
-  file.read(reinterpret_cast<char *>(&header), sizeof(TargaHeader));
-  if (!file) {
-    return false;
-  }
-
-  if (header.bits_per_pixel != 32) {
-    return false;
-  }
-
-  if (header.id_length > 0) {
-    file.seekg(header.id_length, std::ios::cur);
-  }
-
-  if (header.color_map_length > 0 && header.color_map_depth > 0) {
-    size_t color_map_size =
-        static_cast<size_t>(header.color_map_length) *
-        static_cast<size_t>((header.color_map_depth + 7) / 8);
-    file.seekg(static_cast<std::streamoff>(color_map_size), std::ios::cur);
-  }
-
-  width = header.width;
-  height = header.height;
-
-  size_t image_size =
-      static_cast<size_t>(width) * static_cast<size_t>(height) * 4u;
-  std::vector<uint8_t> raw_data(image_size);
-  file.read(reinterpret_cast<char *>(raw_data.data()),
-            static_cast<std::streamsize>(image_size));
-  if (!file) {
+// Creates a 2D texture holding every level in levels (four bytes per texel,
+// tightly packed rows) and stages them all for upload.
+bool CreateTexture2D(ID3D12Device *device, UploadContext &upload_context,
+                     DXGI_FORMAT format, const uint8_t *pixels,
+                     const std::vector<MipLevel> &levels,
+                     ResourceSharedPtr &texture,
+                     D3D12_CPU_DESCRIPTOR_HANDLE srv_handle) {
+  if (levels.empty()) {
     return false;
   }
 
-  data.resize(image_size);
-
-  const bool flip_vertical = ((header.image_descriptor & 0x20) == 0);
-  for (uint32_t y = 0; y < height; ++y) {
-    uint32_t src_row = flip_vertical ? (height - 1 - y) : y;
-    const uint8_t *src =
-        raw_data.data() + (static_cast<size_t>(src_row) * width * 4);
-    uint8_t *dst = data.data() + (static_cast<size_t>(y) * width * 4);
-    for (uint32_t x = 0; x < width; ++x) {
-      dst[0] = src[2];
-      dst[1] = src[1];
-      dst[2] = src[0];
-      dst[3] = src[3];
-      dst += 4;
-      src += 4;
-    }
-  }
-
-  return true;
-}
-
-bool CreateTextureFromTga(ID3D12Device *device, const std::wstring &file_path,
-                          ResourceSharedPtr &texture,
-                          D3D12_CPU_DESCRIPTOR_HANDLE srv_handle) {
-  std::vector<uint8_t> image_data = {};
-  uint32_t width = 0;
-  uint32_t height = 0;
-  if (!LoadTarga32Bit(file_path, image_data, width, height)) {
-    return false;
-  }
+  const auto mip_count = static_cast<UINT16>(levels.size());
 
   D3D12_RESOURCE_DESC resource_desc = {};
   resource_desc.Dimension = D3D12_RESOURCE_DIMENSION_TEXTURE2D;
   resource_desc.Alignment = 0;
-  resource_desc.Width = width;
-  resource_desc.Height = height;
+  resource_desc.Width = levels[0].width;
+  resource_desc.Height = levels[0].height;
   resource_desc.DepthOrArraySize = 1;
-  resource_desc.MipLevels = 1;
-  resource_desc.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
+  resource_desc.MipLevels = mip_count;
+  resource_desc.Format = format;
   resource_desc.SampleDesc.Count = 1;
   resource_desc.SampleDesc.Quality = 0;
   resource_desc.Layout = D3D12_TEXTURE_LAYOUT_UNKNOWN;
@@ -137,103 +61,123 @@ bool CreateTextureFromTga(ID3D12Device *device, const std::wstring &file_path,
     return false;
   }
 
-  UINT64 upload_size =
-      GetRequiredIntermediateSize(texture_resource.Get(), 0, 1);
-
-  ResourceSharedPtr upload_resource = nullptr;
-  if (FAILED(device->CreateCommittedResource(
-          &CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD),
-          D3D12_HEAP_FLAG_NONE, &CD3DX12_RESOURCE_DESC::Buffer(upload_size),
-          D3D12_RESOURCE_STATE_GENERIC_READ, nullptr,
-          IID_PPV_ARGS(&upload_resource)))) {
-    return false;
-  }
-
-  D3D12_SUBRESOURCE_DATA subresource_data = {};
-  subresource_data.pData = image_data.data();
-  subresource_data.RowPitch = static_cast<LONG_PTR>(width) * 4;
-  subresource_data.SlicePitch =
-      static_cast<LONG_PTR>(subresource_data.RowPitch) * height;
-
-  Microsoft::WRL::ComPtr<ID3D12CommandQueue> command_queue = nullptr;
-  D3D12_COMMAND_QUEUE_DESC queue_desc = {};
-  queue_desc.Type = D3D12_COMMAND_LIST_TYPE_DIRECT;
-  queue_desc.Flags = D3D12_COMMAND_QUEUE_FLAG_NONE;
-  if (FAILED(device->CreateCommandQueue(&queue_desc,
-                                        IID_PPV_ARGS(&command_queue)))) {
-    return false;
+  std::vector<UploadSubresourceData> subresources(levels.size());
+  for (size_t i = 0; i < levels.size(); ++i) {
+    subresources[i].data = pixels + levels[i].offset;
+    subresources[i].row_pitch = static_cast<uint64_t>(levels[i].width) * 4;
+    subresources[i].slice_pitch =
+        subresources[i].row_pitch * levels[i].height;
   }
 
-  Microsoft::WRL::ComPtr<ID3D12CommandAllocator> command_allocator = nullptr;
-  if (FAILED(device->CreateCommandAllocator(
-          D3D12_COMMAND_LIST_TYPE_DIRECT, IID_PPV_ARGS(&command_allocator)))) {
+  // The pixels are staged right away; the copy itself goes out with the next
+  // upload batch, before the first frame that can sample the texture.
+  if (upload_context.UploadTexture(texture_resource.Get(), 0, mip_count,
+                                   subresources.data()) ==
+      kInvalidUploadToken) {
     return false;
   }
 
-  Microsoft::WRL::ComPtr<ID3D12GraphicsCommandList> command_list = nullptr;
-  if (FAILED(device->CreateCommandList(0, D3D12_COMMAND_LIST_TYPE_DIRECT,
-                                       command_allocator.Get(), nullptr,
-                                       IID_PPV_ARGS(&command_list)))) {
-    return false;
-  }
+  D3D12_SHADER_RESOURCE_VIEW_DESC srv_desc = {};
+  srv_desc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
+  srv_desc.Format = format;
+  srv_desc.ViewDimension = D3D12_SRV_DIMENSION_TEXTURE2D;
+  srv_desc.Texture2D.MipLevels = mip_count;
+  srv_desc.Texture2D.MostDetailedMip = 0;
+  srv_desc.Texture2D.ResourceMinLODClamp = 0.0f;
 
-  auto to_copy = CD3DX12_RESOURCE_BARRIER::Transition(
-      texture_resource.Get(), D3D12_RESOURCE_STATE_COMMON,
-      D3D12_RESOURCE_STATE_COPY_DEST);
-  command_list->ResourceBarrier(1, &to_copy);
+  device->CreateShaderResourceView(texture_resource.Get(), &srv_desc,
+                                   srv_handle);
 
-  UpdateSubresources(command_list.Get(), texture_resource.Get(),
-                     upload_resource.Get(), 0, 0, 1, &subresource_data);
+  texture = texture_resource;
+  return true;
+}
 
-  auto to_shader = CD3DX12_RESOURCE_BARRIER::Transition(
-      texture_resource.Get(), D3D12_RESOURCE_STATE_COPY_DEST,
-      D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
-  command_list->ResourceBarrier(1, &to_shader);
+// A decoded image and its generated mips, ready to upload or cook.
+struct DecodedTexture {
+  std::unique_ptr<uint8_t[]> pixels = nullptr;
+  std::vector<MipLevel> levels = {};
+  DXGI_FORMAT format = DXGI_FORMAT_R8G8B8A8_UNORM;
+};
 
-  if (FAILED(command_list->Close())) {
+bool DecodeTga(JobSystem &job_system, const FileData &file,
+               TextureUsage usage, DecodedTexture &decoded) {
+  TargaInfo info = {};
+  if (!ReadTargaHeader(file.GetData(), file.GetSize(), info)) {
     return false;
   }
 
-  ID3D12CommandList *command_lists[] = {command_list.Get()};
-  command_queue->ExecuteCommandLists(1, command_lists);
-
-  Microsoft::WRL::ComPtr<ID3D12Fence> fence = nullptr;
-  if (FAILED(device->CreateFence(0, D3D12_FENCE_FLAG_NONE,
-                                 IID_PPV_ARGS(&fence)))) {
+  // The decoder writes level 0 and the generator every level below it, so
+  // the buffer is left uninitialized.
+  const size_t chain_size =
+      LayoutMipChain(info.width, info.height, decoded.levels);
+  decoded.pixels.reset(new uint8_t[chain_size]);
+  decoded.format = DXGI_FORMAT_R8G8B8A8_UNORM;
+  if (!DecodeTargaImage(file.GetData(), file.GetSize(), info,
+                        decoded.pixels.get(),
+                        static_cast<size_t>(info.width) * 4)) {
     return false;
   }
 
-  HandleCloser fence_event(CreateEvent(nullptr, FALSE, FALSE, nullptr));
-  if (!fence_event.Handle()) {
+  MipOptions options = {};
+  options.usage = usage;
+  return GenerateMipChain(job_system, decoded.pixels.get(), decoded.levels,
+                          options);
+}
+
+// Plain 8-bit RGBA/BGRA 2D images that come without mips.
+bool NeedsGeneratedMips(const DDSLayout &layout) {
+  switch (layout.format) {
+  case DXGI_FORMAT_R8G8B8A8_UNORM:
+  case DXGI_FORMAT_R8G8B8A8_UNORM_SRGB:
+  case DXGI_FORMAT_B8G8R8A8_UNORM:
+  case DXGI_FORMAT_B8G8R8A8_UNORM_SRGB:
+    break;
+  default:
     return false;
   }
+  return layout.dimension == DirectX::DDS_DIMENSION_TEXTURE2D &&
+         !layout.is_cube_map && layout.array_size == 1 &&
+         layout.mip_count == 1 && layout.subresources.size() == 1;
+}
 
-  UINT64 fence_value = 1;
-  if (FAILED(command_queue->Signal(fence.Get(), fence_value))) {
+bool DecodeFlatDDS(JobSystem &job_system, const FileData &file,
+                   const DDSLayout &layout, TextureUsage usage,
+                   DecodedTexture &decoded) {
+  const DDSSubresource &top = layout.subresources[0];
+  const size_t row_bytes = static_cast<size_t>(layout.width) * 4;
+  if (top.row_bytes < row_bytes || top.row_count != layout.height) {
     return false;
   }
 
-  if (fence->GetCompletedValue() < fence_value) {
-    if (FAILED(
-            fence->SetEventOnCompletion(fence_value, fence_event.Handle()))) {
-      return false;
-    }
-    WaitForSingleObject(fence_event.Handle(), INFINITE);
-  }
+  const size_t chain_size =
+      LayoutMipChain(layout.width, layout.height, decoded.levels);
+  decoded.pixels.reset(new uint8_t[chain_size]);
+  decoded.format = layout.format;
 
-  D3D12_SHADER_RESOURCE_VIEW_DESC srv_desc = {};
-  srv_desc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
-  srv_desc.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
-  srv_desc.ViewDimension = D3D12_SRV_DIMENSION_TEXTURE2D;
-  srv_desc.Texture2D.MipLevels = 1;
-  srv_desc.Texture2D.MostDetailedMip = 0;
-  srv_desc.Texture2D.ResourceMinLODClamp = 0.0f;
+  const uint8_t *source = file.GetData() + top.offset;
+  for (uint32_t y = 0; y < layout.height; ++y) {
+    memcpy(decoded.pixels.get() + y * row_bytes, source + y * top.row_bytes,
+           row_bytes);
+  }
 
-  device->CreateShaderResourceView(texture_resource.Get(), &srv_desc,
-                                   srv_handle);
+  MipOptions options = {};
+  options.usage = usage;
+  return GenerateMipChain(job_system, decoded.pixels.get(), decoded.levels,
+                          options);
+}
 
-  texture = texture_resource;
-  return true;
+auto MakeCookDesc(const DecodedTexture &decoded, TextureUsage usage,
+                  CompressionQuality quality, const FileStamp &source)
+    -> TextureCookDesc {
+  TextureCookDesc desc = {};
+  desc.usage = usage;
+  desc.quality = quality;
+  desc.is_bgra = decoded.format == DXGI_FORMAT_B8G8R8A8_UNORM ||
+                 decoded.format == DXGI_FORMAT_B8G8R8A8_UNORM_SRGB;
+  desc.is_srgb = decoded.format == DXGI_FORMAT_R8G8B8A8_UNORM_SRGB ||
+                 decoded.format == DXGI_FORMAT_B8G8R8A8_UNORM_SRGB;
+  desc.source = source;
+  return desc;
 }
 
 std::wstring ToLower(std::wstring value) {
@@ -251,6 +195,31 @@ bool EndsWith(const std::wstring &value, const std::wstring &suffix) {
                        suffix) == 0;
 }
 
+void LogTextureMessage(const std::wstring &path, const wchar_t *message) {
+  std::wstringstream stream;
+  stream << L"[TextureLoader] " << message << L": " << path << L"\n";
+  OutputDebugStringW(stream.str().c_str());
+}
+
+// Registry variant of the placeholder, apart from every usage.
+constexpr uint32_t kPlaceholderVariant = 0xffffffff;
+
+// Which loaded form of a file a texture is: its mips depend on the usage and
+// its format on the compression settings.
+auto GetTextureVariant(TextureUsage usage, bool compress,
+                       CompressionQuality quality) -> uint32_t {
+  const uint32_t compression =
+      compress ? static_cast<uint32_t>(quality) + 1 : 0;
+  return static_cast<uint32_t>(usage) | (compression << 8);
+}
+
+auto GetResidentBytes(ID3D12Device *device, ID3D12Resource *resource)
+    -> size_t {
+  const D3D12_RESOURCE_DESC desc = resource->GetDesc();
+  return static_cast<size_t>(
+      device->GetResourceAllocationInfo(0, 1, &desc).SizeInBytes);
+}
+
 } // namespace
 
 TextureLoader::TextureLoader(std::shared_ptr<DirectX12Device> device)
@@ -260,67 +229,280 @@ bool TextureLoader::LoadTextureByName(WCHAR **texture_filename) {
   return false;
 }
 
-bool TextureLoader::LoadTexturesByNameArray(unsigned int num_textures,
-                                            WCHAR **texture_filename_arr) {
+bool TextureLoader::LoadTexturesByNameArray(
+    unsigned int num_textures, WCHAR **texture_filename_arr,
+    const std::vector<TextureUsage> &usages) {
+  std::vector<std::wstring> paths(texture_filename_arr,
+                                  texture_filename_arr + num_textures);
+
+  TextureSet set = {};
+  if (!BuildTextureSet(GetDiskFileSource(), JobSystem::Instance(), paths,
+                       usages, set)) {
+    return false;
+  }
+
+  CommitTextureSet(std::move(set));
+  return true;
+}
+
+bool TextureLoader::CreatePlaceholders(unsigned int num_textures) {
+  if (!device_ || num_textures == 0) {
+    return false;
+  }
 
   auto device = device_->GetD3d12Device();
 
-  D3D12_DESCRIPTOR_HEAP_DESC srv_heap_desc = {};
-  srv_heap_desc.NumDescriptors = num_textures;
-  srv_heap_desc.Type = D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV;
-  srv_heap_desc.Flags = D3D12_DESCRIPTOR_HEAP_FLAG_SHADER_VISIBLE;
+  DescriptorRangePtr table = device_->AllocateDescriptors(
+      DescriptorHeapKind::kShaderVisible, num_textures);
+  if (!table) {
+    return false;
+  }
+
+  // One white texture serves every model's placeholders.
+  const uint8_t white_texel[4] = {255, 255, 255, 255};
+  const AssetKey key = {AssetKind::kTexture,
+                        HashAssetContent(white_texel, sizeof(white_texel)),
+                        kPlaceholderVariant};
+  TextureHandle placeholder = AssetRegistry::Instance().Acquire<SharedTexture>(
+      key, [&](size_t &resident_bytes) -> std::shared_ptr<SharedTexture> {
+        auto texture = std::make_shared<SharedTexture>();
+        const std::vector<MipLevel> white_level = {{0, 1, 1}};
+        texture->view =
+            device_->AllocateDescriptors(DescriptorHeapKind::kStaging, 1);
+        if (!texture->view ||
+            !CreateTexture2D(device.Get(), *device_->GetUploadContext(),
+                             DXGI_FORMAT_R8G8B8A8_UNORM, white_texel,
+                             white_level, texture->resource,
+                             texture->view->cpu_handle)) {
+          return nullptr;
+        }
+        resident_bytes =
+            GetResidentBytes(device.Get(), texture->resource.Get());
+        return texture;
+      });
+  if (!placeholder) {
+    return false;
+  }
+
+  for (unsigned int i = 0; i < num_textures; ++i) {
+    device->CopyDescriptorsSimple(1, table->GetCpuHandle(i),
+                                  placeholder->view->cpu_handle,
+                                  D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
+  }
+
+  TextureSet set = {};
+  set.table = table;
+  set.textures.assign(num_textures, placeholder);
+  CommitTextureSet(std::move(set));
+  return true;
+}
+
+Task<TextureSet>
+TextureLoader::LoadTextureSet(AssetStreamer &streamer,
+                              std::vector<std::wstring> paths,
+                              std::vector<TextureUsage> usages) {
+  co_await streamer.ResumeInBackground();
+
+  TextureSet set = {};
+  if (!BuildTextureSet(streamer.GetFileSource(), streamer.GetJobSystem(),
+                       paths, usages, set)) {
+    set = {};
+  }
+  co_return std::move(set);
+}
+
+void TextureLoader::CommitTextureSet(TextureSet set) {
+  // The old table goes back to the heap once the frames in flight retire.
+  // Other sets may hold the same textures; the deferred references only
+  // cover this set's frames in flight.
+  for (auto &texture : texture_container_) {
+    device_->DeferRelease(texture->resource);
+  }
+
+  table_ = std::move(set.table);
+  texture_container_ = std::move(set.textures);
+  index_container_ = std::move(set.indices);
+  num_textures_ = static_cast<unsigned int>(texture_container_.size());
+}
+
+ResourceSharedPtr TextureLoader::GetTextureResource(size_t index) const {
+  if (index >= texture_container_.size()) {
+    return nullptr;
+  }
+  return texture_container_[index]->resource;
+}
+
+D3D12_CPU_DESCRIPTOR_HANDLE
+TextureLoader::GetTextureStagingView(size_t index) const {
+  if (index >= texture_container_.size()) {
+    return {};
+  }
+  return texture_container_[index]->view->cpu_handle;
+}
+
+bool TextureLoader::BuildTextureSet(FileSource &file_source,
+                                    JobSystem &job_system,
+                                    const std::vector<std::wstring> &paths,
+                                    const std::vector<TextureUsage> &usages,
+                                    TextureSet &set) {
+  if (!device_ || paths.empty()) {
+    return false;
+  }
+
+  auto device = device_->GetD3d12Device();
 
-  if (FAILED(device->CreateDescriptorHeap(
-          &srv_heap_desc, IID_PPV_ARGS(&shader_resource_view_heap_)))) {
+  set.table = device_->AllocateDescriptors(
+      DescriptorHeapKind::kShaderVisible,
+      static_cast<UINT>(paths.size()));
+  if (!set.table) {
     return false;
   }
 
-  auto increasement_size = device->GetDescriptorHandleIncrementSize(
-      D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
-  CD3DX12_CPU_DESCRIPTOR_HANDLE handle(
-      shader_resource_view_heap_.Get()->GetCPUDescriptorHandleForHeapStart());
-  ResourceSharedPtr tem_texture = nullptr;
-  auto index = 0;
   string filename = {};
 
-  for (unsigned int i = 0; i < num_textures; ++i) {
-    tem_texture.Reset();
-    std::wstring file_path(texture_filename_arr[i]);
-    std::wstring lowercase = ToLower(file_path);
-
-    bool load_result = false;
-    if (EndsWith(lowercase, L".dds")) {
-      load_result = SUCCEEDED(
-          CreateDDSTextureFromFile(device.Get(), texture_filename_arr[i], 0,
-                                   false, &tem_texture, handle));
-    } else if (EndsWith(lowercase, L".tga")) {
-      load_result =
-          CreateTextureFromTga(device.Get(), file_path, tem_texture, handle);
-    } else {
+  auto &registry = AssetRegistry::Instance();
+  for (size_t i = 0; i < paths.size(); ++i) {
+    const std::wstring &file_path = paths[i];
+    const TextureUsage usage =
+        i < usages.size() ? usages[i] : TextureUsage::kColor;
+
+    uint64_t content_hash = 0;
+    if (!registry.GetContentHash(file_source, file_path, content_hash)) {
+      LogTextureMessage(file_path, L"Could not read texture");
       return false;
     }
 
-    if (!load_result) {
+    const AssetKey key = {
+        AssetKind::kTexture, content_hash,
+        GetTextureVariant(usage, compress_textures_, compression_quality_)};
+    TextureHandle texture = registry.Acquire<SharedTexture>(
+        key, [&](size_t &resident_bytes) {
+          return LoadSharedTexture(file_source, job_system, file_path,
+                                   usage, resident_bytes);
+        });
+    if (!texture) {
+      LogTextureMessage(file_path, L"Could not load texture");
       return false;
     }
 
-    texture_container_.push_back(tem_texture);
+    device->CopyDescriptorsSimple(
+        1, set.table->GetCpuHandle(static_cast<UINT>(i)),
+        texture->view->cpu_handle, D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
+    set.textures.push_back(texture);
 
     filename.clear();
-    WCHARToString(texture_filename_arr[i], filename);
-    index_container_.insert(make_pair(
-        filename, static_cast<unsigned int>(texture_container_.size() - 1)));
-
-    handle.Offset(increasement_size);
+    WCHARToString(file_path.c_str(), filename);
+    set.indices.insert(make_pair(
+        filename, static_cast<unsigned int>(set.textures.size() - 1)));
   }
 
   return true;
 }
 
-ResourceSharedPtr TextureLoader::GetTextureResource(size_t index) const {
-  if (index >= texture_container_.size()) {
+std::shared_ptr<SharedTexture>
+TextureLoader::LoadSharedTexture(FileSource &file_source,
+                                 JobSystem &job_system,
+                                 const std::wstring &file_path,
+                                 TextureUsage usage, size_t &resident_bytes) {
+  auto device = device_->GetD3d12Device();
+
+  FileData file;
+  if (!file_source.ReadFile(file_path, file)) {
+    return nullptr;
+  }
+
+  auto texture = std::make_shared<SharedTexture>();
+  texture->view = device_->AllocateDescriptors(DescriptorHeapKind::kStaging, 1);
+  if (!texture->view) {
     return nullptr;
   }
-  return texture_container_[index];
+  const D3D12_CPU_DESCRIPTOR_HANDLE handle = texture->view->cpu_handle;
+
+  std::wstring lowercase = ToLower(file_path);
+
+  bool load_result = false;
+  if (EndsWith(lowercase, L".dds")) {
+    DDSLayout layout = {};
+    if (ParseDDSImage(file.GetData(), file.GetSize(), 0, layout) &&
+        NeedsGeneratedMips(layout)) {
+      load_result =
+          LoadDecodedTexture(file_source, job_system, file_path, file,
+                             &layout, usage, texture->resource, handle);
+    } else {
+      load_result = SUCCEEDED(CreateDDSTextureFromMemory(
+          device.Get(), *device_->GetUploadContext(), file.GetData(),
+          file.GetSize(), 0, false, &texture->resource, handle));
+    }
+  } else if (EndsWith(lowercase, L".tga")) {
+    load_result =
+        LoadDecodedTexture(file_source, job_system, file_path, file, nullptr,
+                           usage, texture->resource, handle);
+  }
+
+  if (!load_result) {
+    return nullptr;
+  }
+
+  resident_bytes = GetResidentBytes(device.Get(), texture->resource.Get());
+  return texture;
+}
+
+bool TextureLoader::LoadDecodedTexture(FileSource &file_source,
+                                       JobSystem &job_system,
+                                       const std::wstring &file_path,
+                                       const FileData &file,
+                                       const DDSLayout *layout,
+                                       TextureUsage usage,
+                                       ResourceSharedPtr &texture,
+                                       D3D12_CPU_DESCRIPTOR_HANDLE srv_handle) {
+  auto device = device_->GetD3d12Device();
+  UploadContext &upload_context = *device_->GetUploadContext();
+
+  // The block-compressed copy lives next to the source and is cooked again
+  // whenever the source, its usage or the quality changes.
+  const std::wstring cache_path = GetTextureCachePath(file_path);
+  FileStamp source = {};
+  const bool can_compress =
+      compress_textures_ && file_source.GetStamp(file_path, source);
+  if (can_compress) {
+    TextureCookDesc desc = {};
+    desc.usage = usage;
+    desc.quality = compression_quality_;
+    desc.source = source;
+
+    FileData cached;
+    if (file_source.ReadFile(cache_path, cached) &&
+        IsCookedTextureCurrent(cached.GetData(), cached.GetSize(), desc)) {
+      return SUCCEEDED(CreateDDSTextureFromMemory(
+          device.Get(), upload_context, cached.GetData(), cached.GetSize(), 0,
+          false, &texture, srv_handle));
+    }
+  }
+
+  DecodedTexture decoded = {};
+  const bool decode_result =
+      layout ? DecodeFlatDDS(job_system, file, *layout, usage, decoded)
+             : DecodeTga(job_system, file, usage, decoded);
+  if (!decode_result) {
+    return false;
+  }
+
+  // Images that are not a multiple of four texels stay uncompressed.
+  std::vector<uint8_t> image = {};
+  if (can_compress &&
+      CookTextureImage(
+          job_system, decoded.pixels.get(), decoded.levels,
+          MakeCookDesc(decoded, usage, compression_quality_, source), image)) {
+    if (!file_source.WriteFile(cache_path, image)) {
+      LogTextureMessage(cache_path, L"Could not write texture cache");
+    }
+    return SUCCEEDED(CreateDDSTextureFromMemory(device.Get(), upload_context,
+                                                image.data(), image.size(), 0,
+                                                false, &texture, srv_handle));
+  }
+
+  return CreateTexture2D(device.Get(), upload_context, decoded.format,
+                         decoded.pixels.get(), decoded.levels, texture,
+                         srv_handle);
 }
 } // namespace ResourceLoader
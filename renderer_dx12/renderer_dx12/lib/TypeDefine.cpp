@@ -2,9 +2,9 @@
 
 #include "TypeDefine.h"
 
-void ResourceLoader::WCHARToString(WCHAR *wchar, std::string &s) {
+void ResourceLoader::WCHARToString(const WCHAR *wchar, std::string &s) {
 
-  wchar_t *wText = wchar;
+  const wchar_t *wText = wchar;
   DWORD length_of_wchar =
       WideCharToMultiByte(CP_OEMCP, NULL, wText, -1, NULL, 0, NULL, FALSE);
   char *tem = new char[length_of_wchar];
@@ -0,0 +1,384 @@
+#include "stdafx.h"
+
+#include "UploadContext.h"
+
+#include <algorithm>
+#include <cstring>
+#include <sstream>
+#include <utility>
+
+namespace ResourceLoader {
+
+namespace {
+
+auto AlignUp(uint64_t value, uint64_t alignment) -> uint64_t {
+  return (value + alignment - 1) / alignment * alignment;
+}
+
+void CopyRows(uint8_t *destination, const UploadTextureFootprint &footprint,
+              const UploadSubresourceData &source) {
+  const auto *source_bytes = static_cast<const uint8_t *>(source.data);
+  const uint64_t row_bytes = std::min<uint64_t>(
+      footprint.row_bytes, source.row_pitch ? source.row_pitch
+                                            : footprint.row_bytes);
+  const uint64_t slice_bytes =
+      static_cast<uint64_t>(footprint.row_pitch) * footprint.row_count;
+
+  for (uint32_t z = 0; z < footprint.depth; ++z) {
+    const uint8_t *source_slice = source_bytes + z * source.slice_pitch;
+    uint8_t *destination_slice = destination + z * slice_bytes;
+    if (source.row_pitch == footprint.row_pitch) {
+      memcpy(destination_slice, source_slice,
+             static_cast<size_t>(source.row_pitch * (footprint.row_count - 1) +
+                                 row_bytes));
+      continue;
+    }
+    for (uint32_t y = 0; y < footprint.row_count; ++y) {
+      memcpy(destination_slice + static_cast<uint64_t>(y) * footprint.row_pitch,
+             source_slice + y * source.row_pitch,
+             static_cast<size_t>(row_bytes));
+    }
+  }
+}
+
+} // namespace
+
+void UploadRing::Reset(uint64_t capacity) {
+  capacity_ = capacity;
+  head_ = 0;
+  used_ = 0;
+  consumed_ = 0;
+}
+
+auto UploadRing::Allocate(uint64_t size, uint64_t alignment, uint64_t &offset)
+    -> bool {
+  if (size == 0 || size > capacity_ || alignment == 0) {
+    return false;
+  }
+
+  if (used_ == 0) {
+    head_ = 0;
+  }
+
+  // The free space starts at head_ and may wrap around the end.
+  const uint64_t free_bytes = capacity_ - used_;
+  const uint64_t start = AlignUp(head_, alignment);
+  const uint64_t padding = start - head_;
+
+  uint64_t charged = 0;
+  if (start + size <= capacity_ && padding + size <= free_bytes) {
+    offset = start;
+    charged = padding + size;
+    head_ = start + size;
+  } else {
+    // Skip the tail end of the buffer and start over at offset 0.
+    const uint64_t wasted = capacity_ - head_;
+    if (wasted + size > free_bytes) {
+      return false;
+    }
+    offset = 0;
+    charged = wasted + size;
+    head_ = size;
+  }
+
+  if (head_ == capacity_) {
+    head_ = 0;
+  }
+  used_ += charged;
+  consumed_ += charged;
+  return true;
+}
+
+auto UploadRing::TakeConsumed() -> uint64_t {
+  return std::exchange(consumed_, 0);
+}
+
+void UploadRing::Release(uint64_t bytes) {
+  used_ -= std::min(bytes, used_);
+}
+
+void UploadRing::Rewind(uint64_t bytes) {
+  bytes = std::min(bytes, used_);
+  used_ -= bytes;
+  head_ = (head_ + capacity_ - bytes % capacity_) % capacity_;
+}
+
+UploadContext::UploadContext(std::unique_ptr<UploadDevice> device)
+    : device_(std::move(device)) {}
+
+UploadContext::~UploadContext() {
+  if (!device_) {
+    return;
+  }
+
+  WaitIdle();
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (ring_buffer_ != 0) {
+    device_->ReleaseStagingBuffer(ring_buffer_);
+    ring_buffer_ = 0;
+  }
+}
+
+auto UploadContext::Initialize(uint64_t ring_size) -> bool {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (!device_ || ring_size == 0 || ring_buffer_ != 0) {
+    return false;
+  }
+
+  ring_size = AlignUp(ring_size, kTexturePlacementAlignment);
+  ring_buffer_ = device_->CreateStagingBuffer(ring_size, ring_data_);
+  if (ring_buffer_ == 0 || ring_data_ == nullptr) {
+    device_->ReportError(L"[UploadContext] Create staging ring failed.\n");
+    ring_buffer_ = 0;
+    return false;
+  }
+
+  ring_.Reset(ring_size);
+  return true;
+}
+
+auto UploadContext::UploadBuffer(ID3D12Resource *destination,
+                                 uint64_t destination_offset, const void *data,
+                                 uint64_t size) -> UploadToken {
+  if (destination == nullptr || data == nullptr || size == 0) {
+    return kInvalidUploadToken;
+  }
+
+  std::lock_guard<std::mutex> lock(mutex_);
+
+  StagingBufferId staging = 0;
+  uint8_t *mapped_data = nullptr;
+  uint64_t staging_offset = 0;
+  if (!AllocateStaging(size, kBufferPlacementAlignment, staging, mapped_data,
+                       staging_offset)) {
+    return kInvalidUploadToken;
+  }
+
+  memcpy(mapped_data + staging_offset, data, static_cast<size_t>(size));
+  device_->CopyBufferRegion(destination, destination_offset, staging,
+                            staging_offset, size);
+
+  ++stats_.copies;
+  stats_.bytes += size;
+  return open_batch_.token;
+}
+
+auto UploadContext::UploadTexture(ID3D12Resource *destination,
+                                  uint32_t first_subresource,
+                                  uint32_t subresource_count,
+                                  const UploadSubresourceData *subresources)
+    -> UploadToken {
+  if (destination == nullptr || subresources == nullptr ||
+      subresource_count == 0) {
+    return kInvalidUploadToken;
+  }
+
+  std::lock_guard<std::mutex> lock(mutex_);
+
+  std::vector<UploadTextureFootprint> footprints(subresource_count);
+  uint64_t total_bytes = 0;
+  if (!device_->GetTextureFootprints(destination, first_subresource,
+                                     subresource_count, footprints.data(),
+                                     total_bytes) ||
+      total_bytes == 0) {
+    return kInvalidUploadToken;
+  }
+
+  StagingBufferId staging = 0;
+  uint8_t *mapped_data = nullptr;
+  uint64_t staging_offset = 0;
+  if (!AllocateStaging(total_bytes, kTexturePlacementAlignment, staging,
+                       mapped_data, staging_offset)) {
+    return kInvalidUploadToken;
+  }
+
+  for (uint32_t i = 0; i < subresource_count; ++i) {
+    auto &footprint = footprints[i];
+    footprint.offset += staging_offset;
+    CopyRows(mapped_data + footprint.offset, footprint, subresources[i]);
+    device_->CopyTextureRegion(destination, first_subresource + i, staging,
+                               footprint);
+  }
+
+  stats_.copies += subresource_count;
+  stats_.bytes += total_bytes;
+  return open_batch_.token;
+}
+
+auto UploadContext::Flush() -> UploadToken {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return FlushLocked();
+}
+
+auto UploadContext::IsComplete(UploadToken token) -> bool {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (IsFailedLocked(token)) {
+    return false;
+  }
+  if (token <= last_completed_) {
+    return true;
+  }
+  RetireCompleted();
+  return token <= last_completed_;
+}
+
+auto UploadContext::Wait(UploadToken token) -> bool {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return WaitLocked(token);
+}
+
+auto UploadContext::WaitIdle() -> bool {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return WaitLocked(FlushLocked());
+}
+
+auto UploadContext::GetLastSubmittedToken() const -> UploadToken {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return last_submitted_;
+}
+
+auto UploadContext::GetStats() const -> UploadStats {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return stats_;
+}
+
+auto UploadContext::AllocateStaging(uint64_t size, uint64_t alignment,
+                                    StagingBufferId &staging,
+                                    uint8_t *&mapped_data, uint64_t &offset)
+    -> bool {
+  if (!device_ || ring_buffer_ == 0 || !EnsureBatchOpen()) {
+    return false;
+  }
+
+  if (size > ring_.GetCapacity()) {
+    staging = device_->CreateStagingBuffer(size, mapped_data);
+    if (staging == 0 || mapped_data == nullptr) {
+      return false;
+    }
+    open_batch_.dedicated.push_back(staging);
+    offset = 0;
+    ++stats_.dedicated_buffers;
+    return true;
+  }
+
+  RetireCompleted();
+  while (!ring_.Allocate(size, alignment, offset)) {
+    // The open batch owns part of the ring too, so it has to go out before
+    // waiting can free anything.
+    if (in_flight_.empty()) {
+      FlushLocked();
+    }
+    if (in_flight_.empty()) {
+      return false;
+    }
+    ++stats_.ring_stalls;
+    if (!WaitLocked(in_flight_.front().token)) {
+      return false;
+    }
+    if (!EnsureBatchOpen()) {
+      return false;
+    }
+  }
+
+  staging = ring_buffer_;
+  mapped_data = ring_data_;
+  return true;
+}
+
+auto UploadContext::EnsureBatchOpen() -> bool {
+  if (batch_open_) {
+    return true;
+  }
+  if (!device_->BeginBatch()) {
+    device_->ReportError(L"[UploadContext] Begin copy batch failed.\n");
+    return false;
+  }
+  batch_open_ = true;
+  open_batch_ = {};
+  open_batch_.token = next_token_++;
+  return true;
+}
+
+auto UploadContext::FlushLocked() -> UploadToken {
+  if (!batch_open_) {
+    return last_submitted_;
+  }
+
+  batch_open_ = false;
+  open_batch_.ring_bytes = ring_.TakeConsumed();
+
+  if (!device_->SubmitBatch(open_batch_.token)) {
+    std::wstringstream stream;
+    stream << L"[UploadContext] Submit copy batch " << open_batch_.token
+           << L" failed.\n";
+    device_->ReportError(stream.str().c_str());
+    // Nothing from this batch will ever run; it is the newest user of the
+    // ring, so its bytes can be handed back from the head. Its token stays
+    // failed: the next batch signals a higher value, which would otherwise
+    // look like this one completing.
+    ring_.Rewind(open_batch_.ring_bytes);
+    open_batch_.ring_bytes = 0;
+    RetireBatch(open_batch_);
+    failed_tokens_.push_back(open_batch_.token);
+    ++stats_.failed_batches;
+    return last_submitted_;
+  }
+
+  last_submitted_ = open_batch_.token;
+  in_flight_.push_back(std::move(open_batch_));
+  open_batch_ = {};
+  ++stats_.batches;
+  return last_submitted_;
+}
+
+auto UploadContext::WaitLocked(UploadToken token) -> bool {
+  if (token == kInvalidUploadToken) {
+    return true;
+  }
+  if (batch_open_ && token >= open_batch_.token) {
+    FlushLocked();
+  }
+  if (IsFailedLocked(token)) {
+    return false;
+  }
+  if (token <= last_completed_) {
+    return true;
+  }
+  if (token > last_submitted_) {
+    return false;
+  }
+  if (!device_->WaitForValue(token)) {
+    return false;
+  }
+  RetireCompleted();
+  return true;
+}
+
+void UploadContext::RetireCompleted() {
+  if (in_flight_.empty()) {
+    return;
+  }
+
+  const UploadToken completed = device_->GetCompletedValue();
+  while (!in_flight_.empty() && in_flight_.front().token <= completed) {
+    RetireBatch(in_flight_.front());
+    last_completed_ = in_flight_.front().token;
+    in_flight_.pop_front();
+  }
+}
+
+auto UploadContext::IsFailedLocked(UploadToken token) const -> bool {
+  return std::binary_search(failed_tokens_.begin(), failed_tokens_.end(),
+                            token);
+}
+
+void UploadContext::RetireBatch(Batch &batch) {
+  ring_.Release(batch.ring_bytes);
+  for (auto staging : batch.dedicated) {
+    device_->ReleaseStagingBuffer(staging);
+  }
+  batch.dedicated.clear();
+}
+
+} // namespace ResourceLoader
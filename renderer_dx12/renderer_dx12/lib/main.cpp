@@ -1,7 +1,9 @@
 ﻿#include "stdafx.h"
+#include "ShaderLoader.h"
 #include "System.h"
 
 #include <cstdio>
+#include <cstring>
 #include <iostream>
 
 namespace {
@@ -40,6 +42,13 @@ void ShutdownConsole() {
 int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, PSTR pScmdline,
                    int iCmdshow) {
 
+  // Run by the post-build step: fill the shader cache and exit without a
+  // window.
+  if (pScmdline != nullptr && strstr(pScmdline, "--cook-shaders") != nullptr) {
+    ResourceLoader::ShaderLoader shader_loader;
+    return shader_loader.CookShaders(L"shader/shaders.manifest") ? 0 : 1;
+  }
+
   const bool console_initialized = InitializeConsole();
 
   auto system = new System();
@@ -10,8 +10,7 @@ struct VertexInputType
     float3 position : POSITION;
     float2 tex      : TEXCOORD0;
     float3 normal   : NORMAL;
-    float3 tangent  : TANGENT;
-    float3 binormal : BINORMAL;
+    float4 tangent  : TANGENT; // w = bitangent handedness
 };
 
 struct PixelInputType
@@ -37,8 +36,8 @@ PixelInputType BumpMapVertexShader(VertexInputType input)
 
     float3x3 world3x3 = (float3x3)worldMatrix;
     output.normal   = normalize(mul(input.normal,   world3x3));
-    output.tangent  = normalize(mul(input.tangent,  world3x3));
-    output.binormal = normalize(mul(input.binormal, world3x3));
+    output.tangent  = normalize(mul(input.tangent.xyz, world3x3));
+    output.binormal = cross(output.normal, output.tangent) * input.tangent.w;
 
     return output;
 }
@@ -57,8 +56,10 @@ float4 BumpMapPixelShader(PixelInputType input) : SV_TARGET
 {
     float4 textureColor = shaderTextures[0].Sample(SampleType, input.tex);
 
-    float4 bumpMap = shaderTextures[1].Sample(SampleType, input.tex);
-    bumpMap = bumpMap * 2.0f - 1.0f;
+    // Normal maps may be stored as two channels (BC5); z is rebuilt from x and y
+    float3 bumpMap;
+    bumpMap.xy = shaderTextures[1].Sample(SampleType, input.tex).rg * 2.0f - 1.0f;
+    bumpMap.z = sqrt(saturate(1.0f - dot(bumpMap.xy, bumpMap.xy)));
 
     // Correct bump normal calculation using TBN matrix
     // bumpMap contains the normal in tangent space (from normal map texture)
@@ -27,6 +27,7 @@ struct PixelInputType
     float2 tex : TEXCOORD0;
     float3 normal : NORMAL;
     float fogFactor : FOG;
+    float3 worldPosition : TEXCOORD1;
 };
 
 PixelInputType LightVertexShader(VertexInputType input)
@@ -46,6 +47,7 @@ PixelInputType LightVertexShader(VertexInputType input)
     output.normal = normalize(output.normal);
 
     float4 cameraPosition = mul(input_pos, worldMatrix);
+    output.worldPosition = cameraPosition.xyz;
     cameraPosition = mul(cameraPosition, viewMatrix);
 
     // Calculate linear fog.
@@ -54,7 +56,58 @@ PixelInputType LightVertexShader(VertexInputType input)
     return output;
 }
 
+// Instanced variant. Each instance brings its own world matrix, applied
+// before worldMatrix and normalMatrix, which then place the whole batch.
+// Instance scale must be uniform for the normals to stay correct.
+struct InstancedVertexInputType
+{
+    float3 position : POSITION;
+    float2 tex : TEXCOORD0;
+    float3 normal : NORMAL;
+    float4 world0 : WORLD0;
+    float4 world1 : WORLD1;
+    float4 world2 : WORLD2;
+    float4 world3 : WORLD3;
+    float4 tint : COLOR0;
+    uint materialIndex : MATERIAL;
+};
+
+struct InstancedPixelInputType
+{
+    float4 position : SV_POSITION;
+    float2 tex : TEXCOORD0;
+    float3 normal : NORMAL;
+    float fogFactor : FOG;
+    float4 tint : COLOR0;
+    nointerpolation uint materialIndex : MATERIAL;
+};
+
+InstancedPixelInputType LightInstancedVertexShader(InstancedVertexInputType input)
+{
+    InstancedPixelInputType output;
+    float4x4 instanceWorld = float4x4(input.world0, input.world1, input.world2, input.world3);
+
+    float4 worldPosition = mul(mul(float4(input.position, 1.0f), instanceWorld), worldMatrix);
+    float4 viewPosition = mul(worldPosition, viewMatrix);
+    output.position = mul(viewPosition, projectionMatrix);
+
+    output.tex = input.tex;
+
+    float3 normal = mul(input.normal, (float3x3)instanceWorld);
+    output.normal = normalize(mul(normal, (float3x3)normalMatrix));
+
+    output.fogFactor = saturate((fogEnd - viewPosition.z) / (fogEnd - fogStart));
+
+    output.tint = input.tint;
+    output.materialIndex = input.materialIndex;
+
+    return output;
+}
+
 Texture2D shaderTexture : register(t0);
+// Picked by the instanced pixel shader's material index.
+Texture2D secondTexture : register(t1);
+Texture2D thirdTexture : register(t2);
 SamplerState SampleType : register(s0);
 
 cbuffer LightBuffer : register(b0)
@@ -65,14 +118,77 @@ cbuffer LightBuffer : register(b0)
     float padding;
 };
 
-float4 LightPixelShader(PixelInputType input) : SV_TARGET
+// Local lights binned into view clusters by Lighting::ClusteredLightGrid,
+// for the clustered pixel shader. Tile rows count down from the top and
+// slices are spaced exponentially in view depth.
+cbuffer ClusterBuffer : register(b2)
 {
-    float4 textureColor = shaderTexture.Sample(SampleType, input.tex);
+    uint clusterTilesX;
+    uint clusterTilesY;
+    uint clusterSlices;
+    uint clusterLightCount;
+    float2 clusterTileScale;
+    float clusterDepthScale;
+    float clusterDepthBias;
+};
+
+struct ClusterLight
+{
+    float3 position;
+    float range;
+    float3 direction;
+    float spotCosOuter;  // -1 for point lights
+    float3 color;
+    float spotCosInner;
+    float3 attenuation;  // constant, linear, quadratic
+    float clusterPadding;
+};
 
-    float4 color = ambientColor;
+StructuredBuffer<ClusterLight> clusterLights : register(t3);
+StructuredBuffer<uint> clusterLightIndices : register(t4);
+// Offset into clusterLightIndices and light count, per cluster.
+StructuredBuffer<uint2> clusterRanges : register(t5);
+
+uint2 FindClusterRange(float4 screenPosition)
+{
+    // SV_Position.w is the view depth under a perspective projection.
+    uint2 tile = min(uint2(screenPosition.xy * clusterTileScale),
+                     uint2(clusterTilesX - 1, clusterTilesY - 1));
+    float slice = floor(log(screenPosition.w) * clusterDepthScale + clusterDepthBias);
+    uint sliceIndex = (uint)clamp(slice, 0.0f, (float)(clusterSlices - 1));
+    return clusterRanges[(sliceIndex * clusterTilesY + tile.y) * clusterTilesX + tile.x];
+}
+
+// Light arriving at worldPosition, and the unit direction towards the light.
+// The attenuation is windowed to reach zero at the light's range.
+float3 ClusterLightRadiance(ClusterLight light, float3 worldPosition, out float3 lightDir)
+{
+    float3 toLight = light.position - worldPosition;
+    float lightDistance = length(toLight);
+    lightDir = toLight / max(lightDistance, 0.0001f);
+
+    float ratio = lightDistance / light.range;
+    float window = saturate(1.0f - ratio * ratio * ratio * ratio);
+    float falloff = dot(light.attenuation,
+                        float3(1.0f, lightDistance, lightDistance * lightDistance));
+    float intensity = window * window / max(falloff, 0.0001f);
+
+    if (light.spotCosOuter > -1.0f)
+    {
+        intensity *= smoothstep(light.spotCosOuter, light.spotCosInner, dot(-lightDir, light.direction));
+    }
+
+    return light.color * intensity;
+}
+
+// localDiffuse is the clustered lights' diffuse term, added to the
+// directional light's before the texture.
+float4 ShadeLight(float4 textureColor, float3 normal, float fogFactor, float3 localDiffuse)
+{
+    float4 color = ambientColor + float4(localDiffuse, 0.0f);
 
     float3 lightDir = normalize(-lightDirection);
-    float lightIntensity = saturate(dot(input.normal, lightDir));
+    float lightIntensity = saturate(dot(normal, lightDir));
 
     if (lightIntensity > 0.0f)
     {
@@ -86,9 +202,58 @@ float4 LightPixelShader(PixelInputType input) : SV_TARGET
     const float4 fogColor = float4(0.5f, 0.5f, 0.5f, 1.0f);  // Gray fog instead of yellow-green
 
     // Calculate the final color using the fog effect equation.
-    color = input.fogFactor * color + (1.0f - input.fogFactor) * fogColor;
+    color = fogFactor * color + (1.0f - fogFactor) * fogColor;
 
     return color;
 }
 
+float4 LightPixelShader(PixelInputType input) : SV_TARGET
+{
+    float4 textureColor = shaderTexture.Sample(SampleType, input.tex);
+    return ShadeLight(textureColor, input.normal, input.fogFactor, float3(0.0f, 0.0f, 0.0f));
+}
+
+float4 LightClusteredPixelShader(PixelInputType input) : SV_TARGET
+{
+    float4 textureColor = shaderTexture.Sample(SampleType, input.tex);
+    float3 normal = normalize(input.normal);
+
+    float3 localDiffuse = float3(0.0f, 0.0f, 0.0f);
+    uint2 range = FindClusterRange(input.position);
+    for (uint i = 0; i < range.y; ++i)
+    {
+        ClusterLight light = clusterLights[clusterLightIndices[range.x + i]];
+        float3 lightDir;
+        float3 radiance = ClusterLightRadiance(light, input.worldPosition, lightDir);
+        localDiffuse += radiance * saturate(dot(normal, lightDir));
+    }
+
+    return ShadeLight(textureColor, normal, input.fogFactor, localDiffuse);
+}
+
+float4 LightInstancedPixelShader(InstancedPixelInputType input) : SV_TARGET
+{
+    // The index is constant per triangle, but gradients are still taken
+    // outside the branch.
+    float2 texDdx = ddx(input.tex);
+    float2 texDdy = ddy(input.tex);
+
+    float4 textureColor;
+    [branch] if (input.materialIndex == 1)
+    {
+        textureColor = secondTexture.SampleGrad(SampleType, input.tex, texDdx, texDdy);
+    }
+    else if (input.materialIndex == 2)
+    {
+        textureColor = thirdTexture.SampleGrad(SampleType, input.tex, texDdx, texDdy);
+    }
+    else
+    {
+        textureColor = shaderTexture.SampleGrad(SampleType, input.tex, texDdx, texDdy);
+    }
+
+    return ShadeLight(textureColor * input.tint, normalize(input.normal), input.fogFactor,
+                      float3(0.0f, 0.0f, 0.0f));
+}
+
 
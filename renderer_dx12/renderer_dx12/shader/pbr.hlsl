@@ -20,8 +20,7 @@ struct VertexInputType
     float4 position : POSITION;
     float2 tex : TEXCOORD0;
     float3 normal : NORMAL;
-    float3 tangent : TANGENT;
-    float3 binormal : BINORMAL;
+    float4 tangent : TANGENT; // w = bitangent handedness
 };
 
 struct PixelInputType
@@ -32,6 +31,7 @@ struct PixelInputType
     float3 tangent : TANGENT;
     float3 binormal : BINORMAL;
     float3 viewDirection : TEXCOORD1;
+    float3 worldPosition : TEXCOORD2;
 };
 
 PixelInputType PbrVertexShader(VertexInputType input)
@@ -60,10 +60,11 @@ PixelInputType PbrVertexShader(VertexInputType input)
     // the object is scaled non-uniformly or transformed in complex ways.
     float3x3 normal3x3 = (float3x3)normalMatrix;
     output.normal = normalize(mul(input.normal, normal3x3));
-    output.tangent = normalize(mul(input.tangent, normal3x3));
-    output.binormal = normalize(mul(input.binormal, normal3x3));
+    output.tangent = normalize(mul(input.tangent.xyz, normal3x3));
+    output.binormal = cross(output.normal, output.tangent) * input.tangent.w;
 
     worldPosition = mul(input.position, worldMatrix);
+    output.worldPosition = worldPosition.xyz;
     // Pre-normalize in VS to reduce interpolation error and maintain data range
     // PS will re-normalize because linear interpolation destroys unit length
     output.viewDirection = normalize(cameraPosition - worldPosition.xyz);
@@ -71,6 +72,60 @@ PixelInputType PbrVertexShader(VertexInputType input)
     return output;
 }
 
+// Instanced variant. Each instance brings its own world matrix, applied
+// before worldMatrix and normalMatrix, which then place the whole batch.
+// Instance scale must be uniform for the tangent frame to stay correct.
+struct InstancedVertexInputType
+{
+    float4 position : POSITION;
+    float2 tex : TEXCOORD0;
+    float3 normal : NORMAL;
+    float4 tangent : TANGENT;
+    float4 world0 : WORLD0;
+    float4 world1 : WORLD1;
+    float4 world2 : WORLD2;
+    float4 world3 : WORLD3;
+    float4 tint : COLOR0;
+};
+
+struct InstancedPixelInputType
+{
+    float4 position : SV_POSITION;
+    float2 tex : TEXCOORD0;
+    float3 normal : NORMAL;
+    float3 tangent : TANGENT;
+    float3 binormal : BINORMAL;
+    float3 viewDirection : TEXCOORD1;
+    float3 worldPosition : TEXCOORD2;
+    float4 tint : COLOR0;
+};
+
+InstancedPixelInputType PbrInstancedVertexShader(InstancedVertexInputType input)
+{
+    InstancedPixelInputType output;
+    float4x4 instanceWorld = float4x4(input.world0, input.world1, input.world2, input.world3);
+
+    input.position.w = 1.0f;
+
+    float4 worldPosition = mul(mul(input.position, instanceWorld), worldMatrix);
+    output.position = mul(worldPosition, viewMatrix);
+    output.position = mul(output.position, projectionMatrix);
+
+    output.tex = input.tex;
+
+    float3x3 normal3x3 = mul((float3x3)instanceWorld, (float3x3)normalMatrix);
+    output.normal = normalize(mul(input.normal, normal3x3));
+    output.tangent = normalize(mul(input.tangent.xyz, normal3x3));
+    output.binormal = cross(output.normal, output.tangent) * input.tangent.w;
+
+    output.viewDirection = normalize(cameraPosition - worldPosition.xyz);
+    output.worldPosition = worldPosition.xyz;
+
+    output.tint = input.tint;
+
+    return output;
+}
+
 Texture2D diffuseTexture : register(t0);
 Texture2D normalMap : register(t1);
 Texture2D rmTexture : register(t2);
@@ -84,6 +139,69 @@ cbuffer LightBuffer : register(b2)
     float padding2;
 };
 
+// Local lights binned into view clusters by Lighting::ClusteredLightGrid,
+// for the clustered pixel shader. Tile rows count down from the top and
+// slices are spaced exponentially in view depth.
+cbuffer ClusterBuffer : register(b3)
+{
+    uint clusterTilesX;
+    uint clusterTilesY;
+    uint clusterSlices;
+    uint clusterLightCount;
+    float2 clusterTileScale;
+    float clusterDepthScale;
+    float clusterDepthBias;
+};
+
+struct ClusterLight
+{
+    float3 position;
+    float range;
+    float3 direction;
+    float spotCosOuter;  // -1 for point lights
+    float3 color;
+    float spotCosInner;
+    float3 attenuation;  // constant, linear, quadratic
+    float clusterPadding;
+};
+
+StructuredBuffer<ClusterLight> clusterLights : register(t3);
+StructuredBuffer<uint> clusterLightIndices : register(t4);
+// Offset into clusterLightIndices and light count, per cluster.
+StructuredBuffer<uint2> clusterRanges : register(t5);
+
+uint2 FindClusterRange(float4 screenPosition)
+{
+    // SV_Position.w is the view depth under a perspective projection.
+    uint2 tile = min(uint2(screenPosition.xy * clusterTileScale),
+                     uint2(clusterTilesX - 1, clusterTilesY - 1));
+    float slice = floor(log(screenPosition.w) * clusterDepthScale + clusterDepthBias);
+    uint sliceIndex = (uint)clamp(slice, 0.0f, (float)(clusterSlices - 1));
+    return clusterRanges[(sliceIndex * clusterTilesY + tile.y) * clusterTilesX + tile.x];
+}
+
+// Light arriving at worldPosition, and the unit direction towards the light.
+// The attenuation is windowed to reach zero at the light's range.
+float3 ClusterLightRadiance(ClusterLight light, float3 worldPosition, out float3 lightDir)
+{
+    float3 toLight = light.position - worldPosition;
+    float lightDistance = length(toLight);
+    lightDir = toLight / max(lightDistance, 0.0001f);
+
+    float ratio = lightDistance / light.range;
+    float window = saturate(1.0f - ratio * ratio * ratio * ratio);
+    float falloff = dot(light.attenuation,
+                        float3(1.0f, lightDistance, lightDistance * lightDistance));
+    float intensity = window * window / max(falloff, 0.0001f);
+
+    if (light.spotCosOuter > -1.0f)
+    {
+        intensity *= smoothstep(light.spotCosOuter, light.spotCosInner, dot(-lightDir, light.direction));
+    }
+
+    return light.color * intensity;
+}
+
 float DistributionGGX(float NdotH, float roughness)
 {
     float a = roughness * roughness;
@@ -122,24 +240,52 @@ float3 LinearToSRGB(float3 linearColor)
     return sRGB;
 }
 
-float4 PbrPixelShader(PixelInputType input) : SV_TARGET
+struct PbrSurface
+{
+    float3 albedo;
+    float roughness;
+    float metallic;
+    float3 normal;
+    float3 viewDirection;
+    float3 F0;
+};
+
+// albedoTint scales the albedo texture; 1 outside the instanced path.
+PbrSurface SamplePbrSurface(PixelInputType input, float3 albedoTint)
 {
-    float3 lightDir = normalize(-lightDirection);
-    float3 albedo = diffuseTexture.Sample(SampleType, input.tex).rgb;
+    float3 albedo = diffuseTexture.Sample(SampleType, input.tex).rgb * albedoTint;
     float3 rmColor = rmTexture.Sample(SampleType, input.tex).rgb;
     float roughness = saturate(rmColor.r);
     float metallic = saturate(rmColor.b);
 
-    float3 bumpMap = normalMap.Sample(SampleType, input.tex).rgb;
-    bumpMap = bumpMap * 2.0f - 1.0f;
+    // Normal maps may be stored as two channels (BC5); z is rebuilt from x and y
+    float3 bumpMap;
+    bumpMap.xy = normalMap.Sample(SampleType, input.tex).rg * 2.0f - 1.0f;
+    bumpMap.z = sqrt(saturate(1.0f - dot(bumpMap.xy, bumpMap.xy)));
     // Reconstruct TBN normal - the result needs normalization due to weighted sum
     float3 bumpNormal =
         normalize(bumpMap.x * input.tangent + bumpMap.y * input.binormal + bumpMap.z * input.normal);
 
+    PbrSurface surface;
+    surface.albedo = albedo;
+    surface.roughness = roughness;
+    surface.metallic = metallic;
+    surface.normal = bumpNormal;
     // IMPORTANT: Re-normalize after rasterizer interpolation
     // Even though viewDirection was normalized in VS, linear interpolation destroys unit length
     // Example: normalize(A) + normalize(B) != normalize(A + B)
-    float3 viewDir = normalize(input.viewDirection);
+    surface.viewDirection = normalize(input.viewDirection);
+    surface.F0 = lerp(float3(0.04f, 0.04f, 0.04f), albedo, metallic);
+    return surface;
+}
+
+// Reflected light for unit radiance from lightDir. kD is the diffuse share
+// left after the specular reflection.
+float3 EvaluatePbrLight(PbrSurface surface, float3 lightDir, out float3 kD)
+{
+    float3 bumpNormal = surface.normal;
+    float3 viewDir = surface.viewDirection;
+    float roughness = surface.roughness;
     float3 halfDir = normalize(viewDir + lightDir);
 
     float NdotV = max(dot(bumpNormal, viewDir), 0.0f);
@@ -147,7 +293,7 @@ float4 PbrPixelShader(PixelInputType input) : SV_TARGET
     float NdotH = max(dot(bumpNormal, halfDir), 0.0f);
     float HdotV = max(dot(halfDir, viewDir), 0.0f);
 
-    float3 F0 = lerp(float3(0.04f, 0.04f, 0.04f), albedo, metallic);
+    float3 F0 = surface.F0;
 
     float normalDistribution = DistributionGGX(NdotH, roughness);
     float geometricShadow = GeometrySmith(NdotV, NdotL, roughness);
@@ -158,9 +304,18 @@ float4 PbrPixelShader(PixelInputType input) : SV_TARGET
     float3 specular = numerator / denominator;
 
     float3 kS = fresnel;
-    float3 kD = (1.0f - kS) * (1.0f - metallic);
+    kD = (1.0f - kS) * (1.0f - surface.metallic);
+
+    float3 diffuse = kD * surface.albedo / 3.14159265f;
 
-    float3 diffuse = kD * albedo / 3.14159265f;
+    return (diffuse + specular) * NdotL;
+}
+
+// Ambient plus the directional light, in linear space.
+float3 ShadePbrLinear(PbrSurface surface)
+{
+    float3 kD;
+    float3 Lo = EvaluatePbrLight(surface, normalize(-lightDirection), kD);  // Direct lighting
 
     // Ambient lighting using simple approximation
     // NOTE: This is a simplified approach. For proper PBR, use:
@@ -169,11 +324,16 @@ float4 PbrPixelShader(PixelInputType input) : SV_TARGET
     // - Pre-filtered environment maps for specular
     //
     // Current implementation: Simple hemisphere ambient with energy conservation
-    float3 ambient = float3(0.03f, 0.03f, 0.03f) * albedo * kD;  // Only diffuse gets ambient
+    float3 ambient = float3(0.03f, 0.03f, 0.03f) * surface.albedo * kD;  // Only diffuse gets ambient
 
     // Combine: ambient (constant) + directional light contribution
-    float3 Lo = (diffuse + specular) * NdotL;  // Direct lighting
-    float3 color = ambient + Lo;               // Total lighting
+    return ambient + Lo;  // Total lighting
+}
+
+// albedoTint scales the albedo texture; 1 outside the instanced path.
+float4 ShadePbr(PixelInputType input, float3 albedoTint)
+{
+    float3 color = ShadePbrLinear(SamplePbrSurface(input, albedoTint));
 
     // Apply gamma correction for proper display on sRGB monitors
     // Since render target is DXGI_FORMAT_R8G8B8A8_UNORM (linear),
@@ -183,4 +343,41 @@ float4 PbrPixelShader(PixelInputType input) : SV_TARGET
     return float4(color, 1.0f);
 }
 
+float4 PbrPixelShader(PixelInputType input) : SV_TARGET
+{
+    return ShadePbr(input, float3(1.0f, 1.0f, 1.0f));
+}
+
+float4 PbrClusteredPixelShader(PixelInputType input) : SV_TARGET
+{
+    PbrSurface surface = SamplePbrSurface(input, float3(1.0f, 1.0f, 1.0f));
+    float3 color = ShadePbrLinear(surface);
+
+    uint2 range = FindClusterRange(input.position);
+    for (uint i = 0; i < range.y; ++i)
+    {
+        ClusterLight light = clusterLights[clusterLightIndices[range.x + i]];
+        float3 lightDir;
+        float3 radiance = ClusterLightRadiance(light, input.worldPosition, lightDir);
+        float3 kD;
+        color += EvaluatePbrLight(surface, lightDir, kD) * radiance;
+    }
+
+    return float4(LinearToSRGB(color), 1.0f);
+}
+
+float4 PbrInstancedPixelShader(InstancedPixelInputType input) : SV_TARGET
+{
+    PixelInputType pixel;
+    pixel.position = input.position;
+    pixel.tex = input.tex;
+    pixel.normal = input.normal;
+    pixel.tangent = input.tangent;
+    pixel.binormal = input.binormal;
+    pixel.viewDirection = input.viewDirection;
+    pixel.worldPosition = input.worldPosition;
+
+    return ShadePbr(pixel, input.tint.rgb);
+}
+
 
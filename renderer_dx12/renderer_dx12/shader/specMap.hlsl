@@ -16,8 +16,7 @@ struct VertexInputType
     float3 position : POSITION;
     float2 tex      : TEXCOORD0;
     float3 normal   : NORMAL;
-    float3 tangent  : TANGENT;
-    float3 binormal : BINORMAL;
+    float4 tangent  : TANGENT; // w = bitangent handedness
 };
 
 struct PixelInputType
@@ -44,8 +43,8 @@ PixelInputType SpecMapVertexShader(VertexInputType input)
 
     float3x3 world3x3 = (float3x3)worldMatrix;
     output.normal   = normalize(mul(input.normal,   world3x3));
-    output.tangent  = normalize(mul(input.tangent,  world3x3));
-    output.binormal = normalize(mul(input.binormal, world3x3));
+    output.tangent  = normalize(mul(input.tangent.xyz, world3x3));
+    output.binormal = cross(output.normal, output.tangent) * input.tangent.w;
 
     output.viewDirection = normalize(cameraPosition - worldPosition.xyz);
 
@@ -67,8 +66,10 @@ float4 SpecMapPixelShader(PixelInputType input) : SV_TARGET
 {
     float4 textureColor = shaderTextures[0].Sample(SampleType, input.tex);
 
-    float4 bumpMap = shaderTextures[1].Sample(SampleType, input.tex);
-    bumpMap = bumpMap * 2.0f - 1.0f;
+    // Normal maps may be stored as two channels (BC5); z is rebuilt from x and y
+    float3 bumpMap;
+    bumpMap.xy = shaderTextures[1].Sample(SampleType, input.tex).rg * 2.0f - 1.0f;
+    bumpMap.z = sqrt(saturate(1.0f - dot(bumpMap.xy, bumpMap.xy)));
 
     // Correctly transform the tangent-space normal from the bump map to world space
     // using the TBN (Tangent, Binormal, Normal) matrix.
@@ -0,0 +1,216 @@
+#include "AssetRegistry.h"
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "FakeFileSource.h"
+
+using namespace ResourceLoader;
+
+namespace {
+
+struct FakeMesh {
+  int id = 0;
+};
+
+// Counts loads and hands out meshes of a fixed resident size.
+class CountingLoader {
+public:
+  explicit CountingLoader(size_t resident_bytes = 1024)
+      : resident_bytes_(resident_bytes) {}
+
+  auto operator()(size_t &resident_bytes) -> std::shared_ptr<FakeMesh> {
+    auto mesh = std::make_shared<FakeMesh>();
+    mesh->id = ++loads;
+    resident_bytes = resident_bytes_;
+    return mesh;
+  }
+
+  std::atomic<int> loads{0};
+
+private:
+  size_t resident_bytes_ = 0;
+};
+
+auto Load(AssetRegistry &registry, const AssetKey &key,
+          CountingLoader &loader) -> std::shared_ptr<const FakeMesh> {
+  return registry.Acquire<FakeMesh>(key, [&loader](size_t &resident_bytes) {
+    return loader(resident_bytes);
+  });
+}
+
+} // namespace
+
+TEST(AssetRegistryPathTest, NormalizesSeparatorsCaseAndDots) {
+  EXPECT_EQ(NormalizeAssetPath(L"Data\\Models\\Sphere.TXT"),
+            L"data/models/sphere.txt");
+  EXPECT_EQ(NormalizeAssetPath(L"./data//models/../textures/./a.dds"),
+            L"data/textures/a.dds");
+  EXPECT_EQ(NormalizeAssetPath(L"/root/a/"), L"/root/a");
+  // Leading ".." segments cannot be resolved and are kept.
+  EXPECT_EQ(NormalizeAssetPath(L"../../shared/a.dds"), L"../../shared/a.dds");
+  EXPECT_EQ(NormalizeAssetPath(L"a/../../b"), L"../b");
+  EXPECT_EQ(NormalizeAssetPath(L""), L"");
+}
+
+TEST(AssetRegistryHashTest, EqualBytesShareAHash) {
+  FakeFileSource files;
+  files.SetFile(L"data/a.txt", "vertex count: 3");
+  files.SetFile(L"data/copy_of_a.txt", "vertex count: 3");
+  files.SetFile(L"data/b.txt", "vertex count: 4");
+
+  AssetRegistry registry;
+  uint64_t a = 0;
+  uint64_t copy = 0;
+  uint64_t b = 0;
+  ASSERT_TRUE(registry.GetContentHash(files, L"data/a.txt", a));
+  ASSERT_TRUE(registry.GetContentHash(files, L"data/copy_of_a.txt", copy));
+  ASSERT_TRUE(registry.GetContentHash(files, L"data/b.txt", b));
+  EXPECT_EQ(a, copy);
+  EXPECT_NE(a, b);
+
+  uint64_t missing = 0;
+  EXPECT_FALSE(registry.GetContentHash(files, L"data/missing.txt", missing));
+}
+
+TEST(AssetRegistryHashTest, StampsSkipRereadingUnchangedFiles) {
+  FakeFileSource files;
+  files.SetFile(L"data/a.txt", "first");
+
+  AssetRegistry registry;
+  uint64_t first = 0;
+  ASSERT_TRUE(registry.GetContentHash(files, L"data/a.txt", first));
+  EXPECT_EQ(files.reads, 1u);
+
+  uint64_t again = 0;
+  ASSERT_TRUE(registry.GetContentHash(files, L"data/a.txt", again));
+  EXPECT_EQ(again, first);
+  EXPECT_EQ(files.reads, 1u);
+
+  // A save bumps the stamp, so the file is read and hashed again.
+  files.SetFile(L"data/a.txt", "second");
+  uint64_t second = 0;
+  ASSERT_TRUE(registry.GetContentHash(files, L"data/a.txt", second));
+  EXPECT_EQ(files.reads, 2u);
+  EXPECT_NE(second, first);
+}
+
+TEST(AssetRegistryHashTest, SourcesWithoutStampsHashEveryTime) {
+  FakeFileSource files;
+  files.has_stamps = false;
+  files.SetFile(L"data/a.txt", "bytes");
+
+  AssetRegistry registry;
+  uint64_t hash = 0;
+  ASSERT_TRUE(registry.GetContentHash(files, L"data/a.txt", hash));
+  ASSERT_TRUE(registry.GetContentHash(files, L"data/a.txt", hash));
+  EXPECT_EQ(files.reads, 2u);
+}
+
+TEST(AssetRegistryTest, LoadsOncePerKeyAndVariant) {
+  AssetRegistry registry;
+  CountingLoader loader;
+  const AssetKey key = {AssetKind::kMesh, 0x1234, 0};
+
+  auto first = Load(registry, key, loader);
+  auto second = Load(registry, key, loader);
+  ASSERT_TRUE(first);
+  EXPECT_EQ(first, second);
+  EXPECT_EQ(loader.loads, 1);
+
+  // Another layout of the same bytes, or the same hash as another kind, is
+  // another asset.
+  auto variant = Load(registry, {AssetKind::kMesh, 0x1234, 1}, loader);
+  auto texture = Load(registry, {AssetKind::kTexture, 0x1234, 0}, loader);
+  EXPECT_NE(variant, first);
+  EXPECT_EQ(loader.loads, 3);
+
+  const AssetRegistryStats stats = registry.GetStats(AssetKind::kMesh);
+  EXPECT_EQ(stats.hits, 1u);
+  EXPECT_EQ(stats.misses, 2u);
+  EXPECT_EQ(stats.resident_count, 2u);
+  EXPECT_EQ(stats.resident_bytes, 2048u);
+  EXPECT_EQ(registry.GetStats(AssetKind::kTexture).resident_count, 1u);
+}
+
+TEST(AssetRegistryTest, LastHandleFreesAndNextRequestReloads) {
+  AssetRegistry registry;
+  CountingLoader loader(4096);
+  const AssetKey key = {AssetKind::kTexture, 42, 0};
+
+  auto handle = Load(registry, key, loader);
+  auto copy = handle;
+  handle.reset();
+  EXPECT_EQ(registry.GetStats(AssetKind::kTexture).resident_bytes, 4096u);
+
+  copy.reset();
+  AssetRegistryStats stats = registry.GetStats(AssetKind::kTexture);
+  EXPECT_EQ(stats.resident_count, 0u);
+  EXPECT_EQ(stats.resident_bytes, 0u);
+
+  auto reloaded = Load(registry, key, loader);
+  EXPECT_EQ(reloaded->id, 2);
+  EXPECT_EQ(registry.GetStats(AssetKind::kTexture).misses, 2u);
+}
+
+TEST(AssetRegistryTest, FailedLoadsAreNotRemembered) {
+  AssetRegistry registry;
+  const AssetKey key = {AssetKind::kMesh, 7, 0};
+
+  auto failed = registry.Acquire<FakeMesh>(
+      key, [](size_t &) { return std::shared_ptr<FakeMesh>(); });
+  EXPECT_FALSE(failed);
+  EXPECT_EQ(registry.GetStats(AssetKind::kMesh).resident_count, 0u);
+
+  CountingLoader loader;
+  EXPECT_TRUE(Load(registry, key, loader));
+  EXPECT_EQ(loader.loads, 1);
+}
+
+TEST(AssetRegistryTest, ConcurrentRequestsWaitForOneLoad) {
+  AssetRegistry registry;
+  const AssetKey key = {AssetKind::kMesh, 99, 0};
+  std::atomic<int> loads{0};
+
+  auto slow_load = [&loads](size_t &resident_bytes) {
+    ++loads;
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    resident_bytes = 1;
+    return std::make_shared<FakeMesh>();
+  };
+
+  std::vector<std::shared_ptr<const FakeMesh>> handles(8);
+  std::vector<std::thread> threads;
+  for (size_t i = 0; i < handles.size(); ++i) {
+    threads.emplace_back([&, i] {
+      handles[i] = registry.Acquire<FakeMesh>(key, slow_load);
+    });
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+
+  EXPECT_EQ(loads, 1);
+  for (const auto &handle : handles) {
+    EXPECT_EQ(handle, handles[0]);
+  }
+  EXPECT_EQ(registry.GetStats(AssetKind::kMesh).hits, 7u);
+}
+
+TEST(AssetRegistryTest, HandlesMayOutliveTheRegistry) {
+  std::shared_ptr<const FakeMesh> handle;
+  {
+    AssetRegistry registry;
+    CountingLoader loader;
+    handle = Load(registry, {AssetKind::kMesh, 1, 0}, loader);
+  }
+  ASSERT_TRUE(handle);
+  EXPECT_EQ(handle->id, 1);
+  handle.reset();
+}
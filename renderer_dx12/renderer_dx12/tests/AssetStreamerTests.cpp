@@ -0,0 +1,247 @@
+#include "AssetStreamer.h"
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "FakeFileSource.h"
+#include "JobSystem.h"
+#include "Task.h"
+
+using namespace ResourceLoader;
+
+namespace {
+
+// Runs a task to completion on the calling thread. Only for tasks that never
+// hop threads.
+template <typename T> auto RunInline(Task<T> task) -> T {
+  struct Runner {
+    struct promise_type {
+      auto get_return_object() const noexcept -> Runner { return {}; }
+
+      auto initial_suspend() const noexcept -> std::suspend_never {
+        return {};
+      }
+
+      auto final_suspend() const noexcept -> std::suspend_never { return {}; }
+
+      void return_void() const noexcept {}
+
+      void unhandled_exception() const noexcept { std::terminate(); }
+    };
+  };
+
+  T result = {};
+  bool finished = false;
+  [](Task<T> task, T &result, bool &finished) -> Runner {
+    result = co_await task;
+    finished = true;
+  }(std::move(task), result, finished);
+  EXPECT_TRUE(finished);
+  return result;
+}
+
+auto Answer(int &runs) -> Task<int> {
+  ++runs;
+  co_return 42;
+}
+
+auto Sum(int depth) -> Task<int> {
+  if (depth == 0) {
+    co_return 0;
+  }
+  co_return 1 + co_await Sum(depth - 1);
+}
+
+auto Count(int count) -> Task<int> {
+  int total = 0;
+  for (int i = 0; i < count; ++i) {
+    int runs = 0;
+    total += co_await Answer(runs);
+  }
+  co_return total;
+}
+
+// A triangle list with one shared edge, in the data/*.txt format.
+const char kQuadText[] = "Vertex Count: 6\n"
+                         "\n"
+                         "Data:\n"
+                         "\n"
+                         "0 0 0 0 1 0 0 -1\n"
+                         "0 1 0 0 0 0 0 -1\n"
+                         "1 0 0 1 1 0 0 -1\n"
+                         "1 0 0 1 1 0 0 -1\n"
+                         "0 1 0 0 0 0 0 -1\n"
+                         "1 1 0 1 0 0 0 -1\n";
+
+// Coroutines take what they touch as parameters: a lambda's captures die with
+// the lambda, long before a lazily started task runs.
+
+struct HopResult {
+  std::atomic<int> stage{0};
+  bool ran_in_background = false;
+  std::thread::id main_thread_id = {};
+};
+
+auto HopThreads(AssetStreamer &streamer, JobSystem &jobs, HopResult &result)
+    -> Task<void> {
+  co_await streamer.ResumeInBackground();
+  result.ran_in_background = jobs.IsWorkerThread();
+  result.stage = 1;
+  co_await streamer.ResumeOnMainThread();
+  result.main_thread_id = std::this_thread::get_id();
+  result.stage = 2;
+}
+
+auto ReadAndPublish(AssetStreamer &streamer, std::wstring path,
+                    std::atomic<size_t> &read_bytes, int &published)
+    -> Task<void> {
+  FileData data = co_await streamer.ReadFile(std::move(path));
+  read_bytes += data.GetSize();
+  co_await streamer.ResumeOnMainThread();
+  ++published;
+}
+
+auto LoadAndPublish(AssetStreamer &streamer, std::wstring path,
+                    std::unique_ptr<MeshFile> &mesh) -> Task<void> {
+  auto loaded = co_await streamer.LoadMesh(std::move(path));
+  co_await streamer.ResumeOnMainThread();
+  mesh = std::move(loaded);
+}
+
+class AssetStreamerTest : public ::testing::Test {
+protected:
+  AssetStreamerTest()
+      : jobs_(JobSystemConfig{2, false}), streamer_(files_, jobs_) {}
+
+  FakeFileSource files_;
+  JobSystem jobs_;
+  AssetStreamer streamer_;
+};
+
+} // namespace
+
+TEST(TaskTest, StartsOnlyWhenAwaited) {
+  int runs = 0;
+  Task<int> task = Answer(runs);
+  EXPECT_TRUE(task.IsValid());
+  EXPECT_EQ(runs, 0);
+  EXPECT_EQ(RunInline(std::move(task)), 42);
+  EXPECT_EQ(runs, 1);
+}
+
+TEST(TaskTest, DroppedTasksNeverRun) {
+  int runs = 0;
+  { Task<int> task = Answer(runs); }
+  EXPECT_EQ(runs, 0);
+}
+
+TEST(TaskTest, LongChainsRunToCompletion) {
+  // Every step finishes synchronously and hands control straight back to
+  // its awaiter. Sizes stay modest: unoptimized builds do not turn the
+  // symmetric transfer into a tail call.
+  EXPECT_EQ(RunInline(Sum(1000)), 1000);
+  EXPECT_EQ(RunInline(Count(10000)), 420000);
+}
+
+TEST_F(AssetStreamerTest, HopsBetweenWorkersAndTheMainThread) {
+  HopResult result;
+  streamer_.Spawn(HopThreads(streamer_, jobs_, result));
+
+  // The main-thread half only runs once the main thread pumps.
+  while (result.stage.load() < 1) {
+    std::this_thread::yield();
+  }
+  std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  EXPECT_EQ(result.stage.load(), 1);
+  EXPECT_EQ(streamer_.GetPendingTaskCount(), 1u);
+
+  streamer_.WaitIdle();
+  EXPECT_EQ(result.stage.load(), 2);
+  EXPECT_TRUE(result.ran_in_background);
+  EXPECT_EQ(result.main_thread_id, std::this_thread::get_id());
+  EXPECT_EQ(streamer_.GetPendingTaskCount(), 0u);
+}
+
+TEST_F(AssetStreamerTest, WaitIdleDrainsEverySpawnedTask) {
+  files_.SetFile(L"data/a.txt", "a");
+  std::atomic<size_t> read_bytes{0};
+  int published = 0;
+  for (int i = 0; i < 64; ++i) {
+    streamer_.Spawn(
+        ReadAndPublish(streamer_, L"data/a.txt", read_bytes, published));
+  }
+  streamer_.WaitIdle();
+  EXPECT_EQ(read_bytes.load(), 64u);
+  EXPECT_EQ(published, 64);
+  EXPECT_EQ(files_.reads, 64u);
+}
+
+TEST_F(AssetStreamerTest, MissingFilesReadAsEmpty) {
+  std::atomic<size_t> read_bytes{0};
+  int published = 0;
+  streamer_.Spawn(
+      ReadAndPublish(streamer_, L"data/missing.txt", read_bytes, published));
+  streamer_.WaitIdle();
+  EXPECT_EQ(published, 1);
+  EXPECT_EQ(read_bytes.load(), 0u);
+}
+
+TEST_F(AssetStreamerTest, LoadMeshCooksOnceAndThenUsesTheCache) {
+  files_.SetFile(L"data/quad.txt", kQuadText);
+
+  std::unique_ptr<MeshFile> mesh;
+  streamer_.Spawn(LoadAndPublish(streamer_, L"data/quad.txt", mesh));
+  streamer_.WaitIdle();
+
+  ASSERT_TRUE(mesh);
+  EXPECT_EQ(mesh->GetVertexCount(), 4u);
+  EXPECT_EQ(mesh->GetIndexCount(), 6u);
+  EXPECT_TRUE(mesh->HasSourceLayout());
+  const auto cache = files_.GetFile(L"data/quad.mesh");
+  ASSERT_FALSE(cache.empty());
+  EXPECT_NE(ValidateMeshImage(cache.data(), cache.size()), nullptr);
+
+  // A current cache is all that is read.
+  const uint32_t reads = files_.reads;
+  mesh = streamer_.ReadMesh(L"data/quad.txt");
+  ASSERT_TRUE(mesh);
+  EXPECT_EQ(files_.reads, reads + 1);
+
+  // A saved source makes the cache stale: the .mesh and the text are read
+  // and it is cooked again.
+  files_.SetFile(L"data/quad.txt", kQuadText);
+  mesh = streamer_.ReadMesh(L"data/quad.txt");
+  ASSERT_TRUE(mesh);
+  EXPECT_EQ(files_.reads, reads + 1 + 2);
+  EXPECT_EQ(files_.GetFile(L"data/quad.mesh").size(), cache.size());
+}
+
+TEST_F(AssetStreamerTest, ReadOnlySourcesStillLoadMeshes) {
+  files_.SetFile(L"data/quad.txt", kQuadText);
+  files_.is_writable = false;
+  auto mesh = streamer_.ReadMesh(L"data/quad.txt");
+  ASSERT_TRUE(mesh);
+  EXPECT_EQ(mesh->GetVertexCount(), 4u);
+  EXPECT_TRUE(files_.GetFile(L"data/quad.mesh").empty());
+}
+
+TEST_F(AssetStreamerTest, BrokenOrMissingSourcesLoadNothing) {
+  EXPECT_FALSE(streamer_.ReadMesh(L"data/missing.txt"));
+
+  files_.SetFile(L"data/broken.txt", "Vertex Count: 3\nData:\n0 0 0\n");
+  EXPECT_FALSE(streamer_.ReadMesh(L"data/broken.txt"));
+
+  // A corrupt cache is rebuilt from the source.
+  files_.SetFile(L"data/quad.txt", kQuadText);
+  files_.SetFile(L"data/quad.mesh", "not a mesh");
+  auto mesh = streamer_.ReadMesh(L"data/quad.txt");
+  ASSERT_TRUE(mesh);
+  const auto cache = files_.GetFile(L"data/quad.mesh");
+  EXPECT_NE(ValidateMeshImage(cache.data(), cache.size()), nullptr);
+}
@@ -0,0 +1,197 @@
+#include "BlockCompressor.h"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <vector>
+
+#include "BlockDecoder.h"
+#include "JobSystem.h"
+#include "TargaFile.h"
+
+using namespace BlockDecoder;
+using namespace ResourceLoader;
+
+namespace {
+
+constexpr BlockFormat kFormats[] = {BlockFormat::kBC1, BlockFormat::kBC3,
+                                    BlockFormat::kBC4, BlockFormat::kBC5,
+                                    BlockFormat::kBC7};
+
+constexpr CompressionQuality kQualities[] = {CompressionQuality::kFast,
+                                             CompressionQuality::kBalanced,
+                                             CompressionQuality::kHigh};
+
+// Largest difference over the channels format stores, between the 4x4 RGBA
+// pixels and their encoded and decoded block.
+auto RoundTripError(JobSystem &jobs, const uint8_t (&pixels)[16][4],
+                    BlockFormat format, CompressionQuality quality) -> int {
+  uint8_t block[16] = {};
+  EXPECT_TRUE(
+      CompressImage(jobs, &pixels[0][0], 4, 4, format, quality, block));
+  DecodedBlock texels;
+  DecodeBlock(block, format, texels);
+
+  int error = 0;
+  for (uint32_t i = 0; i < 16; ++i) {
+    for (uint32_t c = 0; c < GetChannelCount(format); ++c) {
+      error = (std::max)(error, std::abs(texels[i][c] - pixels[i][c]));
+    }
+  }
+  return error;
+}
+
+struct Image {
+  std::vector<uint8_t> pixels;
+  uint32_t width = 0;
+  uint32_t height = 0;
+};
+
+auto LoadImage(const char *name) -> Image {
+  std::ifstream file(std::filesystem::path(RENDERER_DATA_DIR) / name,
+                     std::ios::binary);
+  const std::vector<uint8_t> bytes((std::istreambuf_iterator<char>(file)),
+                                   std::istreambuf_iterator<char>());
+  Image image;
+  TargaInfo info;
+  if (ReadTargaHeader(bytes.data(), bytes.size(), info)) {
+    image.width = info.width;
+    image.height = info.height;
+    image.pixels.resize(size_t{info.width} * info.height * 4);
+    if (!DecodeTargaImage(bytes.data(), bytes.size(), info,
+                          image.pixels.data(), size_t{info.width} * 4)) {
+      image = {};
+    }
+  }
+  return image;
+}
+
+class BlockCompressorTest : public ::testing::Test {
+protected:
+  BlockCompressorTest() : jobs_(JobSystemConfig{3, true}) {}
+
+  JobSystem jobs_;
+};
+
+} // namespace
+
+TEST_F(BlockCompressorTest, FlatBlocksRoundTripExactly) {
+  // 565-exact color that BC4 endpoints hold at full precision. BC7's mode 6
+  // shares one low bit across an endpoint's channels, so 0 and 255 together
+  // are off by one.
+  uint8_t pixels[16][4];
+  for (auto &texel : pixels) {
+    texel[0] = 255;
+    texel[1] = 0;
+    texel[2] = 255;
+    texel[3] = 255;
+  }
+  for (const BlockFormat format : kFormats) {
+    for (const CompressionQuality quality : kQualities) {
+      EXPECT_LE(RoundTripError(jobs_, pixels, format, quality),
+                format == BlockFormat::kBC7 ? 1 : 0)
+          << "format " << static_cast<int>(format) << " quality "
+          << static_cast<int>(quality);
+    }
+  }
+}
+
+TEST_F(BlockCompressorTest, RampsStayWithinEachFormatsPalette) {
+  // Sixteen steps along a line through RGBA space; red spans 150 and alpha
+  // 90. BC1's four colors are 50 apart on red, so every texel is within 25.
+  // BC4's eight values are 13 apart on alpha; the fast preset's unrefined
+  // endpoints can miss by most of a step. The ramp falls close to BC7's
+  // sixteen weights.
+  const auto error_bound = [](BlockFormat format) {
+    switch (format) {
+    case BlockFormat::kBC1:
+    case BlockFormat::kBC3:
+      return 25;
+    case BlockFormat::kBC4:
+    case BlockFormat::kBC5:
+      return 10;
+    case BlockFormat::kBC7:
+      return 2;
+    }
+    return 0;
+  };
+
+  uint8_t rising[16][4];
+  uint8_t crossing[16][4];
+  for (uint32_t i = 0; i < 16; ++i) {
+    rising[i][0] = crossing[i][0] = static_cast<uint8_t>(40 + 10 * i);
+    rising[i][1] = static_cast<uint8_t>(20 + 8 * i);
+    rising[i][2] = crossing[i][2] = static_cast<uint8_t>(90 + 5 * i);
+    rising[i][3] = crossing[i][3] = static_cast<uint8_t>(105 + 6 * i);
+    crossing[i][1] = static_cast<uint8_t>(200 - 8 * i);
+  }
+
+  for (const BlockFormat format : kFormats) {
+    for (const CompressionQuality quality : kQualities) {
+      EXPECT_LE(RoundTripError(jobs_, rising, format, quality),
+                error_bound(format))
+          << "format " << static_cast<int>(format) << " quality "
+          << static_cast<int>(quality);
+    }
+    // Green falls as red rises. The fast preset's bounding-box corners
+    // cannot follow that; the principal axis of the refined ones does.
+    for (const CompressionQuality quality :
+         {CompressionQuality::kBalanced, CompressionQuality::kHigh}) {
+      EXPECT_LE(RoundTripError(jobs_, crossing, format, quality),
+                error_bound(format))
+          << "format " << static_cast<int>(format) << " quality "
+          << static_cast<int>(quality);
+    }
+  }
+}
+
+TEST_F(BlockCompressorTest, ShippedTexturesKeepTheirQuality) {
+  struct Case {
+    const char *image;
+    BlockFormat format;
+    double min_psnr;
+  };
+  // About 1 dB under what the balanced preset measures today.
+  const Case cases[] = {
+      {"pbr/pbr_albedo.tga", BlockFormat::kBC7, 49.0},
+      {"pbr/pbr_albedo.tga", BlockFormat::kBC1, 37.0},
+      {"pbr/pbr_albedo.tga", BlockFormat::kBC3, 38.0},
+      {"pbr/pbr_normal.tga", BlockFormat::kBC5, 40.0},
+      {"pbr/pbr_roughmetal.tga", BlockFormat::kBC4, 51.0},
+  };
+
+  for (const Case &test_case : cases) {
+    const Image image = LoadImage(test_case.image);
+    ASSERT_FALSE(image.pixels.empty()) << test_case.image;
+    std::vector<uint8_t> blocks(
+        GetCompressedSize(image.width, image.height, test_case.format));
+    ASSERT_TRUE(CompressImage(jobs_, image.pixels.data(), image.width,
+                              image.height, test_case.format,
+                              CompressionQuality::kBalanced, blocks.data()));
+    EXPECT_GE(ComputePsnr(image.pixels, image.width, image.height, blocks,
+                          test_case.format),
+              test_case.min_psnr)
+        << test_case.image << " format "
+        << static_cast<int>(test_case.format);
+  }
+}
+
+TEST_F(BlockCompressorTest, ParallelMatchesSerial) {
+  const Image image = LoadImage("pbr/pbr_albedo.tga");
+  ASSERT_FALSE(image.pixels.empty());
+  const size_t size =
+      GetCompressedSize(image.width, image.height, BlockFormat::kBC7);
+  std::vector<uint8_t> serial(size);
+  std::vector<uint8_t> parallel(size);
+  ASSERT_TRUE(CompressImage(jobs_, image.pixels.data(), image.width,
+                            image.height, BlockFormat::kBC7,
+                            CompressionQuality::kFast, serial.data(), false));
+  ASSERT_TRUE(CompressImage(jobs_, image.pixels.data(), image.width,
+                            image.height, BlockFormat::kBC7,
+                            CompressionQuality::kFast, parallel.data()));
+  EXPECT_EQ(serial, parallel);
+}
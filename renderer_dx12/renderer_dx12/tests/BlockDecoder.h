@@ -0,0 +1,256 @@
+#pragma once
+
+#include "BlockCompressor.h"
+
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+// Reference BC1/BC3/BC4/BC5/BC7 decoders for the tests and benchmarks. They
+// are written from the format descriptions rather than the encoder, so they
+// check the bits actually written.
+namespace BlockDecoder {
+
+using ResourceLoader::BlockFormat;
+
+using ResourceLoader::GetBlockSize;
+
+// Two-subset partitions (bit i set: pixel i in subset 1) and the anchor of
+// subset 1, from the BC7 format description.
+inline constexpr uint16_t kPartitions2[64] = {
+    0xcccc, 0x8888, 0xeeee, 0xecc8, 0xc880, 0xfeec, 0xfec8, 0xec80,
+    0xc800, 0xffec, 0xfe80, 0xe800, 0xffe8, 0xff00, 0xfff0, 0xf000,
+    0xf710, 0x008e, 0x7100, 0x08ce, 0x008c, 0x7310, 0x3100, 0x8cce,
+    0x088c, 0x3110, 0x6666, 0x366c, 0x17e8, 0x0ff0, 0x718e, 0x399c,
+    0xaaaa, 0xf0f0, 0x5a5a, 0x33cc, 0x3c3c, 0x55aa, 0x9696, 0xa55a,
+    0x73ce, 0x13c8, 0x324c, 0x3bdc, 0x6996, 0xc33c, 0x9966, 0x0660,
+    0x0272, 0x04e4, 0x4e40, 0x2720, 0xc936, 0x936c, 0x39c6, 0x639c,
+    0x9336, 0x9cc6, 0x817e, 0xe718, 0xccf0, 0x0fcc, 0x7744, 0xee22};
+
+inline constexpr uint8_t kAnchors2[64] = {
+    15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15,
+    15, 2,  8,  2,  2,  8,  8,  15, 2,  8,  2,  2,  8,  8,  2,  2,
+    15, 15, 6,  8,  2,  8,  15, 15, 2,  8,  2,  2,  2,  15, 15, 6,
+    6,  2,  6,  8,  15, 15, 2,  2,  15, 15, 15, 15, 15, 2,  2,  15};
+
+inline constexpr uint32_t kWeights3[8] = {0, 9, 18, 27, 37, 46, 55, 64};
+inline constexpr uint32_t kWeights4[16] = {0,  4,  9,  13, 17, 21, 26, 30,
+                                           34, 38, 43, 47, 51, 55, 60, 64};
+
+class BitReader {
+public:
+  explicit BitReader(const uint8_t *block) : block_(block) {}
+
+  auto Get(uint32_t bit_count) -> uint32_t {
+    uint32_t value = 0;
+    for (uint32_t bit = 0; bit < bit_count; ++bit, ++position_) {
+      value |= ((block_[position_ >> 3] >> (position_ & 7)) & 1u) << bit;
+    }
+    return value;
+  }
+
+private:
+  const uint8_t *block_ = nullptr;
+  uint32_t position_ = 0;
+};
+
+// Texels are RGBA, 16 per block in row order.
+using DecodedBlock = uint8_t[16][4];
+
+inline void DecodeBC1(const uint8_t *block, DecodedBlock &texels) {
+  const uint32_t color0 = block[0] | block[1] << 8;
+  const uint32_t color1 = block[2] | block[3] << 8;
+  uint32_t palette[4][3] = {};
+  for (uint32_t e = 0; e < 2; ++e) {
+    const uint32_t packed = e == 0 ? color0 : color1;
+    const uint32_t r = (packed >> 11) & 31;
+    const uint32_t g = (packed >> 5) & 63;
+    const uint32_t b = packed & 31;
+    palette[e][0] = (r << 3) | (r >> 2);
+    palette[e][1] = (g << 2) | (g >> 4);
+    palette[e][2] = (b << 3) | (b >> 2);
+  }
+  for (uint32_t c = 0; c < 3; ++c) {
+    if (color0 > color1) {
+      palette[2][c] = (2 * palette[0][c] + palette[1][c] + 1) / 3;
+      palette[3][c] = (palette[0][c] + 2 * palette[1][c] + 1) / 3;
+    } else {
+      palette[2][c] = (palette[0][c] + palette[1][c]) / 2;
+      palette[3][c] = 0;
+    }
+  }
+  const uint32_t indices = block[4] | block[5] << 8 | block[6] << 16 |
+                           static_cast<uint32_t>(block[7]) << 24;
+  for (uint32_t i = 0; i < 16; ++i) {
+    const uint32_t index = (indices >> (i * 2)) & 3;
+    for (uint32_t c = 0; c < 3; ++c) {
+      texels[i][c] = static_cast<uint8_t>(palette[index][c]);
+    }
+    texels[i][3] = color0 <= color1 && index == 3 ? 0 : 255;
+  }
+}
+
+inline void DecodeBC4(const uint8_t *block, DecodedBlock &texels,
+                      uint32_t channel) {
+  const uint32_t a0 = block[0];
+  const uint32_t a1 = block[1];
+  uint32_t palette[8] = {a0, a1};
+  if (a0 > a1) {
+    for (uint32_t i = 2; i < 8; ++i) {
+      palette[i] = ((8 - i) * a0 + (i - 1) * a1 + 3) / 7;
+    }
+  } else {
+    for (uint32_t i = 2; i < 6; ++i) {
+      palette[i] = ((6 - i) * a0 + (i - 1) * a1 + 2) / 5;
+    }
+    palette[6] = 0;
+    palette[7] = 255;
+  }
+  uint64_t indices = 0;
+  for (uint32_t i = 0; i < 6; ++i) {
+    indices |= static_cast<uint64_t>(block[2 + i]) << (i * 8);
+  }
+  for (uint32_t i = 0; i < 16; ++i) {
+    const uint64_t index = (indices >> (i * 3)) & 7;
+    texels[i][channel] = static_cast<uint8_t>(palette[index]);
+  }
+}
+
+inline auto Interpolate(uint32_t e0, uint32_t e1, uint32_t weight)
+    -> uint8_t {
+  return static_cast<uint8_t>(((64 - weight) * e0 + weight * e1 + 32) >> 6);
+}
+
+// Modes 1 and 6, the two the encoder writes. Other modes decode as magenta,
+// which shows up in the PSNR.
+inline void DecodeBC7(const uint8_t *block, DecodedBlock &texels) {
+  BitReader reader(block);
+  uint32_t mode = 0;
+  while (mode < 8 && reader.Get(1) == 0) {
+    ++mode;
+  }
+
+  if (mode == 6) {
+    uint32_t endpoints[2][4] = {};
+    for (uint32_t c = 0; c < 4; ++c) {
+      endpoints[0][c] = reader.Get(7);
+      endpoints[1][c] = reader.Get(7);
+    }
+    for (auto &endpoint : endpoints) {
+      const uint32_t pbit = reader.Get(1);
+      for (uint32_t &value : endpoint) {
+        value = value << 1 | pbit;
+      }
+    }
+    for (uint32_t i = 0; i < 16; ++i) {
+      const uint32_t weight = kWeights4[reader.Get(i == 0 ? 3 : 4)];
+      for (uint32_t c = 0; c < 4; ++c) {
+        texels[i][c] = Interpolate(endpoints[0][c], endpoints[1][c], weight);
+      }
+    }
+    return;
+  }
+
+  if (mode == 1) {
+    const uint32_t partition = reader.Get(6);
+    uint32_t endpoints[2][2][3] = {};
+    for (uint32_t c = 0; c < 3; ++c) {
+      for (auto &subset : endpoints) {
+        subset[0][c] = reader.Get(6);
+        subset[1][c] = reader.Get(6);
+      }
+    }
+    for (auto &subset : endpoints) {
+      const uint32_t pbit = reader.Get(1);
+      for (auto &endpoint : subset) {
+        for (uint32_t &value : endpoint) {
+          const uint32_t seven = value << 1 | pbit;
+          value = seven << 1 | seven >> 6;
+        }
+      }
+    }
+    for (uint32_t i = 0; i < 16; ++i) {
+      const bool anchor = i == 0 || i == kAnchors2[partition];
+      const uint32_t weight = kWeights3[reader.Get(anchor ? 2 : 3)];
+      const auto &subset = endpoints[(kPartitions2[partition] >> i) & 1];
+      for (uint32_t c = 0; c < 3; ++c) {
+        texels[i][c] = Interpolate(subset[0][c], subset[1][c], weight);
+      }
+      texels[i][3] = 255;
+    }
+    return;
+  }
+
+  for (auto &texel : texels) {
+    texel[0] = texel[2] = texel[3] = 255;
+    texel[1] = 0;
+  }
+}
+
+inline void DecodeBlock(const uint8_t *block, BlockFormat format,
+                        DecodedBlock &texels) {
+  memset(texels, 0, sizeof(texels));
+  switch (format) {
+  case BlockFormat::kBC1:
+    DecodeBC1(block, texels);
+    break;
+  case BlockFormat::kBC3:
+    DecodeBC1(block + 8, texels);
+    DecodeBC4(block, texels, 3);
+    break;
+  case BlockFormat::kBC4:
+    DecodeBC4(block, texels, 0);
+    break;
+  case BlockFormat::kBC5:
+    DecodeBC4(block, texels, 0);
+    DecodeBC4(block + 8, texels, 1);
+    break;
+  case BlockFormat::kBC7:
+    DecodeBC7(block, texels);
+    break;
+  }
+}
+
+// Channels each format stores.
+inline auto GetChannelCount(BlockFormat format) -> uint32_t {
+  switch (format) {
+  case BlockFormat::kBC1:
+    return 3;
+  case BlockFormat::kBC4:
+    return 1;
+  case BlockFormat::kBC5:
+    return 2;
+  case BlockFormat::kBC3:
+  case BlockFormat::kBC7:
+    return 4;
+  }
+  return 0;
+}
+
+inline auto ComputePsnr(const std::vector<uint8_t> &pixels, uint32_t width,
+                        uint32_t height, const std::vector<uint8_t> &blocks,
+                        BlockFormat format) -> double {
+  const uint32_t blocks_x = (width + 3) / 4;
+  const uint32_t channels = GetChannelCount(format);
+  double squared_error = 0.0;
+  for (uint32_t y = 0; y < height; ++y) {
+    for (uint32_t x = 0; x < width; ++x) {
+      DecodedBlock texels;
+      const size_t block = size_t{y / 4} * blocks_x + x / 4;
+      DecodeBlock(blocks.data() + block * GetBlockSize(format), format,
+                  texels);
+      const uint8_t *decoded = texels[(y & 3) * 4 + (x & 3)];
+      const uint8_t *source = pixels.data() + (size_t{y} * width + x) * 4;
+      for (uint32_t c = 0; c < channels; ++c) {
+        const double delta = static_cast<double>(decoded[c]) - source[c];
+        squared_error += delta * delta;
+      }
+    }
+  }
+  const double mse =
+      squared_error / (static_cast<double>(width) * height * channels);
+  return mse == 0.0 ? 99.0 : 10.0 * std::log10(255.0 * 255.0 / mse);
+}
+
+} // namespace BlockDecoder
@@ -0,0 +1,235 @@
+#include "ClusteredLighting.h"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <vector>
+
+using namespace Lighting;
+
+namespace {
+
+constexpr uint32_t kScreenWidth = 1280;
+constexpr uint32_t kScreenHeight = 720;
+
+const float kIdentity[16] = {1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f,
+                             0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f};
+
+// A left-handed perspective with a 60 degree vertical field of view over
+// the grid's depth range, row-major for row vectors.
+void MakeProjection(const ClusterGridConfig &config, float projection[16]) {
+  const float y_scale = 1.7320508f;
+  const float z_scale = config.far_z / (config.far_z - config.near_z);
+  std::fill(projection, projection + 16, 0.0f);
+  projection[0] = y_scale * kScreenHeight / kScreenWidth;
+  projection[5] = y_scale;
+  projection[10] = z_scale;
+  projection[11] = 1.0f;
+  projection[14] = -config.near_z * z_scale;
+}
+
+// The cluster a view-space point falls in, the way the shaders find it, or
+// false when it is off screen.
+auto FindCluster(const ClusteredLightGrid &grid, const float projection[16],
+                 const float point[3], uint32_t &cluster) -> bool {
+  const ClusterGridConfig &config = grid.GetConfig();
+  if (point[2] <= config.near_z || point[2] >= config.far_z) {
+    return false;
+  }
+  const float ndc_x = point[0] * projection[0] / point[2];
+  const float ndc_y = point[1] * projection[5] / point[2];
+  if (std::fabs(ndc_x) >= 1.0f || std::fabs(ndc_y) >= 1.0f) {
+    return false;
+  }
+  const ClusterConstants &constants = grid.GetConstants();
+  const float pixel_x = (ndc_x + 1.0f) * 0.5f * kScreenWidth;
+  const float pixel_y = (1.0f - ndc_y) * 0.5f * kScreenHeight;
+  const auto tile_x = static_cast<uint32_t>(pixel_x * constants.tile_scale_x);
+  const auto tile_y = static_cast<uint32_t>(pixel_y * constants.tile_scale_y);
+  const float slice =
+      std::log(point[2]) * constants.depth_scale + constants.depth_bias;
+  cluster = grid.GetClusterIndex(
+      std::min(tile_x, config.tiles_x - 1),
+      std::min(tile_y, config.tiles_y - 1),
+      std::min(static_cast<uint32_t>(std::max(slice, 0.0f)),
+               config.slices - 1));
+  return true;
+}
+
+auto HasLight(const ClusteredLightGrid &grid, uint32_t cluster,
+              uint32_t light) -> bool {
+  const ClusterRange &range = grid.GetClusterRanges()[cluster];
+  const auto begin = grid.GetLightIndices().begin() + range.offset;
+  return std::find(begin, begin + range.count, light) != begin + range.count;
+}
+
+// Point lights, with every fourth a spot pointing somewhere random, in
+// front of the camera.
+void AddRandomLights(ClusteredLightGrid &grid, size_t count) {
+  std::mt19937 random(25);
+  std::uniform_real_distribution<float> across(-30.0f, 30.0f);
+  std::uniform_real_distribution<float> depth(0.5f, 60.0f);
+  std::uniform_real_distribution<float> range(1.0f, 8.0f);
+  std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+  std::uniform_real_distribution<float> cone(0.5f, 0.95f);
+  for (size_t i = 0; i < count; ++i) {
+    ClusterLightData light;
+    light.position[0] = across(random);
+    light.position[1] = across(random) * 0.6f;
+    light.position[2] = depth(random);
+    light.range = range(random);
+    if (i % 4 == 0) {
+      float length = 0.0f;
+      do {
+        for (float &axis : light.direction) {
+          axis = unit(random);
+        }
+        length = std::sqrt(light.direction[0] * light.direction[0] +
+                           light.direction[1] * light.direction[1] +
+                           light.direction[2] * light.direction[2]);
+      } while (length < 0.1f || length > 1.0f);
+      for (float &axis : light.direction) {
+        axis /= length;
+      }
+      light.spot_cos_outer = cone(random);
+      light.spot_cos_inner = std::min(light.spot_cos_outer + 0.02f, 1.0f);
+    }
+    grid.AddLight(light);
+  }
+}
+
+} // namespace
+
+TEST(ClusteredLightingTest, EveryLitPointFindsItsLightInItsCluster) {
+  ClusterGridConfig config;
+  config.max_lights_per_cluster = 1024;
+  ClusteredLightGrid grid(config);
+  AddRandomLights(grid, 300);
+  float projection[16];
+  MakeProjection(grid.GetConfig(), projection);
+
+  for (const CullingPath path : {CullingPath::kScalar, CullingPath::kAvx}) {
+    grid.Build(kIdentity, projection, kScreenWidth, kScreenHeight, path);
+    ASSERT_EQ(grid.GetOverflowCount(), 0u);
+    ASSERT_EQ(grid.GetClusterCount(), 16u * 9u * 24u);
+
+    std::mt19937 random(4);
+    std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+    size_t samples = 0;
+    size_t misses = 0;
+    const auto &lights = grid.GetLights();
+    for (uint32_t index = 0; index < lights.size(); ++index) {
+      const ClusterLightData &light = lights[index];
+      for (int i = 0; i < 200; ++i) {
+        float offset[3] = {unit(random), unit(random), unit(random)};
+        const float distance = std::sqrt(offset[0] * offset[0] +
+                                         offset[1] * offset[1] +
+                                         offset[2] * offset[2]);
+        if (distance > 1.0f || distance == 0.0f) {
+          continue;
+        }
+        // Outside a spot's cone is unlit.
+        const float cos_angle = (offset[0] * light.direction[0] +
+                                 offset[1] * light.direction[1] +
+                                 offset[2] * light.direction[2]) /
+                                distance;
+        if (light.spot_cos_outer > -1.0f && cos_angle < light.spot_cos_outer) {
+          continue;
+        }
+        float point[3];
+        for (int axis = 0; axis < 3; ++axis) {
+          point[axis] = light.position[axis] + offset[axis] * light.range;
+        }
+        uint32_t cluster = 0;
+        if (!FindCluster(grid, projection, point, cluster)) {
+          continue;
+        }
+        ++samples;
+        misses += HasLight(grid, cluster, index) ? 0 : 1;
+      }
+    }
+    EXPECT_GT(samples, 10000u);
+    EXPECT_EQ(misses, 0u) << static_cast<int>(path);
+  }
+}
+
+TEST(ClusteredLightingTest, ScalarAndAvxBinIdentically) {
+  ClusteredLightGrid scalar;
+  ClusteredLightGrid avx;
+  AddRandomLights(scalar, 1000);
+  AddRandomLights(avx, 1000);
+  float projection[16];
+  MakeProjection(scalar.GetConfig(), projection);
+
+  scalar.Build(kIdentity, projection, kScreenWidth, kScreenHeight,
+               CullingPath::kScalar);
+  avx.Build(kIdentity, projection, kScreenWidth, kScreenHeight,
+            CullingPath::kAvx);
+  EXPECT_FALSE(scalar.GetLightIndices().empty());
+  EXPECT_EQ(scalar.GetLightIndices(), avx.GetLightIndices());
+  ASSERT_EQ(scalar.GetClusterCount(), avx.GetClusterCount());
+  for (size_t i = 0; i < scalar.GetClusterCount(); ++i) {
+    EXPECT_EQ(scalar.GetClusterRanges()[i].offset,
+              avx.GetClusterRanges()[i].offset);
+    EXPECT_EQ(scalar.GetClusterRanges()[i].count,
+              avx.GetClusterRanges()[i].count);
+  }
+  EXPECT_EQ(scalar.GetOverflowCount(), avx.GetOverflowCount());
+}
+
+TEST(ClusteredLightingTest, ClustersStopAtTheirLimit) {
+  ClusterGridConfig config;
+  config.max_lights_per_cluster = 2;
+  ClusteredLightGrid grid(config);
+  for (int i = 0; i < 5; ++i) {
+    ClusterLightData light;
+    light.position[2] = 10.0f;
+    light.range = 1.0f;
+    grid.AddLight(light);
+  }
+  // No range, no light.
+  grid.AddLight(ClusterLightData{});
+  float projection[16];
+  MakeProjection(grid.GetConfig(), projection);
+  grid.Build(kIdentity, projection, kScreenWidth, kScreenHeight);
+
+  size_t lit_clusters = 0;
+  for (const ClusterRange &range : grid.GetClusterRanges()) {
+    EXPECT_LE(range.count, 2u);
+    lit_clusters += range.count > 0 ? 1 : 0;
+  }
+  EXPECT_GT(lit_clusters, 0u);
+  EXPECT_EQ(grid.GetLightIndices().size(), lit_clusters * 2);
+  EXPECT_EQ(grid.GetOverflowCount(), lit_clusters * 3);
+  for (const uint32_t light : grid.GetLightIndices()) {
+    EXPECT_LT(light, 5u);
+  }
+}
+
+TEST(ClusteredLightingTest, ConstantsMapTheDepthRangeOntoTheSlices) {
+  ClusteredLightGrid grid;
+  float projection[16];
+  MakeProjection(grid.GetConfig(), projection);
+  grid.Build(kIdentity, projection, kScreenWidth, kScreenHeight);
+
+  const ClusterGridConfig &config = grid.GetConfig();
+  const ClusterConstants &constants = grid.GetConstants();
+  EXPECT_EQ(constants.tiles_x, config.tiles_x);
+  EXPECT_EQ(constants.tiles_y, config.tiles_y);
+  EXPECT_EQ(constants.slices, config.slices);
+  EXPECT_EQ(constants.light_count, 0u);
+  EXPECT_FLOAT_EQ(constants.tile_scale_x * kScreenWidth, 16.0f);
+  EXPECT_FLOAT_EQ(constants.tile_scale_y * kScreenHeight, 9.0f);
+  EXPECT_NEAR(std::log(config.near_z) * constants.depth_scale +
+                  constants.depth_bias,
+              0.0f, 1e-4f);
+  EXPECT_NEAR(std::log(config.far_z) * constants.depth_scale +
+                  constants.depth_bias,
+              static_cast<float>(config.slices), 1e-3f);
+  EXPECT_TRUE(grid.GetLightIndices().empty());
+  for (const ClusterRange &range : grid.GetClusterRanges()) {
+    EXPECT_EQ(range.count, 0u);
+  }
+}
@@ -0,0 +1,150 @@
+#include "CommandStateShadow.h"
+
+#include <gtest/gtest.h>
+
+namespace {
+
+// Stand-ins for D3D12 objects; only their addresses matter.
+int root_signature_a = 0;
+int root_signature_b = 0;
+int pipeline_a = 0;
+int pipeline_b = 0;
+int srv_heap = 0;
+int sampler_heap = 0;
+
+} // namespace
+
+TEST(CommandStateShadowTest, FirstCallOfEachKindIsIssued) {
+  CommandStateShadow shadow;
+  EXPECT_TRUE(shadow.SetRootSignature(nullptr));
+  EXPECT_TRUE(shadow.SetPipelineState(nullptr));
+  EXPECT_TRUE(shadow.SetDescriptorHeaps(0, nullptr));
+  EXPECT_TRUE(shadow.SetRootDescriptorTable(0, 0));
+  EXPECT_TRUE(shadow.SetVertexBuffers(0, 1, nullptr));
+  EXPECT_TRUE(shadow.SetIndexBuffer(nullptr));
+  EXPECT_EQ(shadow.GetStats().GetTotalIssued(), 6u);
+  EXPECT_EQ(shadow.GetStats().GetTotalElided(), 0u);
+}
+
+TEST(CommandStateShadowTest, RepeatedBindsAreElided) {
+  CommandStateShadow shadow;
+  EXPECT_TRUE(shadow.SetRootSignature(&root_signature_a));
+  EXPECT_FALSE(shadow.SetRootSignature(&root_signature_a));
+  EXPECT_TRUE(shadow.SetPipelineState(&pipeline_a));
+  EXPECT_FALSE(shadow.SetPipelineState(&pipeline_a));
+  EXPECT_TRUE(shadow.SetPipelineState(&pipeline_b));
+
+  EXPECT_TRUE(shadow.SetRootConstantBufferView(0, 0x1000));
+  EXPECT_FALSE(shadow.SetRootConstantBufferView(0, 0x1000));
+  EXPECT_TRUE(shadow.SetRootConstantBufferView(0, 0x1100));
+  // The same value as another kind of argument is a different call.
+  EXPECT_TRUE(shadow.SetRootShaderResourceView(0, 0x1100));
+
+  const CommandRecorderStats &stats = shadow.GetStats();
+  EXPECT_EQ(stats.GetIssued(ShadowedCommand::kRootSignature), 1u);
+  EXPECT_EQ(stats.GetElided(ShadowedCommand::kRootSignature), 1u);
+  EXPECT_EQ(stats.GetIssued(ShadowedCommand::kPipelineState), 2u);
+  EXPECT_EQ(stats.GetElided(ShadowedCommand::kPipelineState), 1u);
+  EXPECT_EQ(stats.GetIssued(ShadowedCommand::kRootConstantBufferView), 2u);
+  EXPECT_EQ(stats.GetElided(ShadowedCommand::kRootConstantBufferView), 1u);
+  EXPECT_EQ(stats.GetIssued(ShadowedCommand::kRootShaderResourceView), 1u);
+}
+
+TEST(CommandStateShadowTest, RootSignatureChangeForgetsRootArguments) {
+  CommandStateShadow shadow;
+  shadow.SetRootSignature(&root_signature_a);
+  shadow.SetRootDescriptorTable(1, 0x40);
+  shadow.SetRootConstantBufferView(2, 0x2000);
+  EXPECT_FALSE(shadow.SetRootDescriptorTable(1, 0x40));
+
+  // Rebinding the same signature keeps them...
+  EXPECT_FALSE(shadow.SetRootSignature(&root_signature_a));
+  EXPECT_FALSE(shadow.SetRootConstantBufferView(2, 0x2000));
+
+  // ...a different one clears them, as D3D12 does.
+  EXPECT_TRUE(shadow.SetRootSignature(&root_signature_b));
+  EXPECT_TRUE(shadow.SetRootDescriptorTable(1, 0x40));
+  EXPECT_TRUE(shadow.SetRootConstantBufferView(2, 0x2000));
+}
+
+TEST(CommandStateShadowTest, HeapChangeForgetsOnlyDescriptorTables) {
+  CommandStateShadow shadow;
+  const void *both[] = {&srv_heap, &sampler_heap};
+  const void *srv_only[] = {&srv_heap};
+  EXPECT_TRUE(shadow.SetDescriptorHeaps(2, both));
+  EXPECT_FALSE(shadow.SetDescriptorHeaps(2, both));
+
+  shadow.SetRootDescriptorTable(0, 0x80);
+  shadow.SetRootConstantBufferView(1, 0x3000);
+
+  EXPECT_TRUE(shadow.SetDescriptorHeaps(1, srv_only));
+  EXPECT_TRUE(shadow.SetRootDescriptorTable(0, 0x80));
+  EXPECT_FALSE(shadow.SetRootConstantBufferView(1, 0x3000));
+
+  // More heaps than the shadow tracks are always issued.
+  const void *too_many[] = {&srv_heap, &sampler_heap, &srv_heap};
+  EXPECT_TRUE(shadow.SetDescriptorHeaps(3, too_many));
+  EXPECT_TRUE(shadow.SetDescriptorHeaps(3, too_many));
+}
+
+TEST(CommandStateShadowTest, VertexBuffersCompareEverySlot) {
+  CommandStateShadow shadow;
+  const ShadowVertexBuffer views[2] = {{0x10000, 4096, 32}, {0x20000, 512, 16}};
+  EXPECT_TRUE(shadow.SetVertexBuffers(0, 2, views));
+  EXPECT_FALSE(shadow.SetVertexBuffers(0, 2, views));
+  EXPECT_FALSE(shadow.SetVertexBuffers(1, 1, &views[1]));
+
+  // A slot that was never bound is unknown, even inside a known range.
+  EXPECT_TRUE(shadow.SetVertexBuffers(1, 2, views));
+
+  ShadowVertexBuffer other_stride = views[0];
+  other_stride.stride = 48;
+  EXPECT_TRUE(shadow.SetVertexBuffers(0, 1, &other_stride));
+
+  // Unbinding is state too.
+  EXPECT_TRUE(shadow.SetVertexBuffers(0, 1, nullptr));
+  EXPECT_FALSE(shadow.SetVertexBuffers(0, 1, nullptr));
+
+  // Slots past the end are passed through, never elided.
+  EXPECT_TRUE(shadow.SetVertexBuffers(15, 2, views));
+  EXPECT_TRUE(shadow.SetVertexBuffers(15, 2, views));
+}
+
+TEST(CommandStateShadowTest, IndexBufferComparesTheWholeView) {
+  CommandStateShadow shadow;
+  ShadowIndexBuffer view = {0x40000, 1024, 57};
+  EXPECT_TRUE(shadow.SetIndexBuffer(&view));
+  EXPECT_FALSE(shadow.SetIndexBuffer(&view));
+  view.format = 42;
+  EXPECT_TRUE(shadow.SetIndexBuffer(&view));
+  EXPECT_TRUE(shadow.SetIndexBuffer(nullptr));
+  EXPECT_FALSE(shadow.SetIndexBuffer(nullptr));
+}
+
+TEST(CommandStateShadowTest, OutOfRangeRootArgumentsAreAlwaysIssued) {
+  CommandStateShadow shadow;
+  const uint32_t index = CommandStateShadow::kMaxRootParameters;
+  EXPECT_TRUE(shadow.SetRootConstantBufferView(index, 0x1000));
+  EXPECT_TRUE(shadow.SetRootConstantBufferView(index, 0x1000));
+}
+
+TEST(CommandStateShadowTest, ResetForgetsStateButKeepsCounters) {
+  CommandStateShadow shadow;
+  shadow.SetPipelineState(&pipeline_a);
+  shadow.SetPipelineState(&pipeline_a);
+
+  shadow.Reset();
+  EXPECT_TRUE(shadow.SetPipelineState(&pipeline_a));
+  EXPECT_EQ(shadow.GetStats().GetIssued(ShadowedCommand::kPipelineState), 2u);
+
+  const CommandRecorderStats taken = shadow.TakeStats();
+  EXPECT_EQ(taken.GetTotalIssued(), 2u);
+  EXPECT_EQ(taken.GetTotalElided(), 1u);
+  EXPECT_EQ(shadow.GetStats().GetTotalIssued(), 0u);
+
+  CommandRecorderStats frame;
+  frame.Add(taken);
+  frame.Add(taken);
+  EXPECT_EQ(frame.GetIssued(ShadowedCommand::kPipelineState), 4u);
+  EXPECT_EQ(frame.GetTotalElided(), 2u);
+}
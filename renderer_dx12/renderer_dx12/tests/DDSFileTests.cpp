@@ -0,0 +1,287 @@
+#include "DDSFile.h"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <filesystem>
+#include <vector>
+
+#include "FileSource.h"
+
+using namespace ResourceLoader;
+
+namespace {
+
+constexpr size_t kHeaderBytes = sizeof(uint32_t) + sizeof(DirectX::DDS_HEADER);
+constexpr size_t kDX10HeaderBytes =
+    kHeaderBytes + sizeof(DirectX::DDS_HEADER_DXT10);
+
+auto DataPath(const char *name) -> std::wstring {
+  return (std::filesystem::path(RENDERER_DATA_DIR) / name).wstring();
+}
+
+// Every mip of a width x height texture, filled with a running byte.
+auto MakeMips(DXGI_FORMAT format, uint32_t width, uint32_t height,
+              uint32_t mip_count) -> std::vector<uint8_t> {
+  size_t total = 0;
+  for (uint32_t mip = 0; mip < mip_count; ++mip) {
+    size_t bytes = 0;
+    const uint32_t mip_width = (std::max)(width >> mip, 1u);
+    const uint32_t mip_height = (std::max)(height >> mip, 1u);
+    GetSurfaceInfo(mip_width, mip_height, format, &bytes, nullptr, nullptr);
+    total += bytes;
+  }
+  std::vector<uint8_t> texels(total);
+  for (size_t i = 0; i < texels.size(); ++i) {
+    texels[i] = static_cast<uint8_t>(i);
+  }
+  return texels;
+}
+
+auto BuildImage(DXGI_FORMAT format, uint32_t width, uint32_t height,
+                uint32_t mip_count) -> std::vector<uint8_t> {
+  const auto texels = MakeMips(format, width, height, mip_count);
+  DDSImageDesc desc;
+  desc.format = format;
+  desc.width = width;
+  desc.height = height;
+  desc.mip_count = mip_count;
+  desc.data = texels.data();
+  desc.size = texels.size();
+  std::vector<uint8_t> image;
+  EXPECT_TRUE(BuildDDSImage(desc, image));
+  return image;
+}
+
+auto GetHeader(std::vector<uint8_t> &image) -> DirectX::DDS_HEADER * {
+  return reinterpret_cast<DirectX::DDS_HEADER *>(image.data() +
+                                                 sizeof(uint32_t));
+}
+
+auto GetDX10Header(std::vector<uint8_t> &image)
+    -> DirectX::DDS_HEADER_DXT10 * {
+  return reinterpret_cast<DirectX::DDS_HEADER_DXT10 *>(image.data() +
+                                                       kHeaderBytes);
+}
+
+auto Parses(const std::vector<uint8_t> &image, size_t max_size = 0) -> bool {
+  DDSLayout layout;
+  return ParseDDSImage(image.data(), image.size(), max_size, layout);
+}
+
+} // namespace
+
+TEST(DDSFileTest, ParsesTheShippedTextures) {
+  FileData stone;
+  ASSERT_TRUE(MapFile(DataPath("stone01.dds"), stone));
+  DDSLayout layout;
+  ASSERT_TRUE(ParseDDSImage(stone.GetData(), stone.GetSize(), 0, layout));
+  EXPECT_EQ(layout.format, DXGI_FORMAT_B8G8R8A8_UNORM);
+  EXPECT_EQ(layout.dimension, DirectX::DDS_DIMENSION_TEXTURE2D);
+  EXPECT_EQ(layout.width, 512u);
+  EXPECT_EQ(layout.height, 512u);
+  EXPECT_EQ(layout.mip_count, 1u);
+  EXPECT_EQ(layout.array_size, 1u);
+  ASSERT_EQ(layout.subresources.size(), 1u);
+  EXPECT_EQ(layout.subresources[0].offset, kHeaderBytes);
+  EXPECT_EQ(layout.subresources[0].row_bytes, 2048u);
+  EXPECT_EQ(layout.subresources[0].row_count, 512u);
+  EXPECT_EQ(layout.subresources[0].slice_bytes,
+            stone.GetSize() - kHeaderBytes);
+
+  FileData font;
+  ASSERT_TRUE(MapFile(DataPath("font.dds"), font));
+  ASSERT_TRUE(ParseDDSImage(font.GetData(), font.GetSize(), 0, layout));
+  EXPECT_EQ(layout.format, DXGI_FORMAT_R8G8B8A8_UNORM);
+  EXPECT_EQ(layout.width, 1024u);
+  EXPECT_EQ(layout.height, 16u);
+}
+
+TEST(DDSFileTest, EveryShippedTextureParsesWithinItsFile) {
+  size_t texture_count = 0;
+  for (const auto &entry :
+       std::filesystem::directory_iterator(RENDERER_DATA_DIR)) {
+    if (entry.path().extension() != ".dds") {
+      continue;
+    }
+    ++texture_count;
+    SCOPED_TRACE(entry.path().filename().string());
+
+    FileData file;
+    ASSERT_TRUE(MapFile(entry.path().wstring(), file));
+    DDSLayout layout;
+    ASSERT_TRUE(ParseDDSImage(file.GetData(), file.GetSize(), 0, layout));
+    EXPECT_GT(layout.width, 0u);
+    EXPECT_GT(layout.height, 0u);
+    ASSERT_EQ(layout.subresources.size(),
+              static_cast<size_t>(layout.mip_count) * layout.array_size);
+    // Each of a subresource's depth slices is slice_bytes long.
+    for (const DDSSubresource &subresource : layout.subresources) {
+      EXPECT_LE(subresource.offset +
+                    subresource.slice_bytes * subresource.depth,
+                file.GetSize());
+      EXPECT_GE(subresource.slice_bytes,
+                subresource.row_bytes * subresource.row_count);
+    }
+  }
+  EXPECT_GT(texture_count, 0u);
+}
+
+TEST(DDSFileTest, SurfaceInfoCountsBlocksForCompressedFormats) {
+  size_t bytes = 0;
+  size_t row_bytes = 0;
+  size_t rows = 0;
+  GetSurfaceInfo(5, 5, DXGI_FORMAT_BC1_UNORM, &bytes, &row_bytes, &rows);
+  EXPECT_EQ(row_bytes, 16u);
+  EXPECT_EQ(rows, 2u);
+  EXPECT_EQ(bytes, 32u);
+
+  GetSurfaceInfo(1, 1, DXGI_FORMAT_BC7_UNORM, &bytes, &row_bytes, &rows);
+  EXPECT_EQ(bytes, 16u);
+
+  GetSurfaceInfo(3, 2, DXGI_FORMAT_R8G8B8A8_UNORM, &bytes, &row_bytes, &rows);
+  EXPECT_EQ(row_bytes, 12u);
+  EXPECT_EQ(bytes, 24u);
+
+  EXPECT_EQ(BitsPerPixel(DXGI_FORMAT_BC1_UNORM), 4u);
+  EXPECT_EQ(BitsPerPixel(DXGI_FORMAT_BC3_UNORM), 8u);
+  EXPECT_EQ(BitsPerPixel(DXGI_FORMAT_R16G16B16A16_FLOAT), 64u);
+  EXPECT_EQ(BitsPerPixel(DXGI_FORMAT_UNKNOWN), 0u);
+}
+
+TEST(DDSFileTest, BuiltImagesRoundTripWithEveryMip) {
+  std::vector<uint8_t> image = BuildImage(DXGI_FORMAT_BC1_UNORM, 64, 32, 7);
+  DDSLayout layout;
+  ASSERT_TRUE(ParseDDSImage(image.data(), image.size(), 0, layout));
+  EXPECT_EQ(layout.format, DXGI_FORMAT_BC1_UNORM);
+  EXPECT_EQ(layout.mip_count, 7u);
+  ASSERT_EQ(layout.subresources.size(), 7u);
+
+  // Mips are packed back to back after the DX10 header.
+  uint64_t offset = kDX10HeaderBytes;
+  for (const DDSSubresource &mip : layout.subresources) {
+    EXPECT_EQ(mip.offset, offset);
+    offset += mip.slice_bytes;
+  }
+  EXPECT_EQ(offset, image.size());
+  EXPECT_EQ(layout.subresources[6].width, 1u);
+  EXPECT_EQ(layout.subresources[6].slice_bytes, 8u);
+
+  uint32_t reserved[11] = {};
+  EXPECT_TRUE(ReadDDSReserved(image.data(), image.size(), reserved));
+}
+
+TEST(DDSFileTest, ReservedWordsSurviveTheRoundTrip) {
+  const auto texels = MakeMips(DXGI_FORMAT_R8G8B8A8_UNORM, 4, 4, 1);
+  DDSImageDesc desc;
+  desc.format = DXGI_FORMAT_R8G8B8A8_UNORM;
+  desc.width = 4;
+  desc.height = 4;
+  desc.mip_count = 1;
+  desc.data = texels.data();
+  desc.size = texels.size();
+  desc.reserved[0] = 0x4b4f4f43;
+  desc.reserved[10] = 7;
+  std::vector<uint8_t> image;
+  ASSERT_TRUE(BuildDDSImage(desc, image));
+
+  uint32_t reserved[11] = {};
+  ASSERT_TRUE(ReadDDSReserved(image.data(), image.size(), reserved));
+  EXPECT_EQ(reserved[0], 0x4b4f4f43u);
+  EXPECT_EQ(reserved[10], 7u);
+
+  // A size that does not match the mips is refused.
+  desc.size -= 1;
+  EXPECT_FALSE(BuildDDSImage(desc, image));
+}
+
+TEST(DDSFileTest, MaxSizeSkipsLargeMips) {
+  const std::vector<uint8_t> image =
+      BuildImage(DXGI_FORMAT_R8G8B8A8_UNORM, 64, 64, 7);
+  DDSLayout layout;
+  ASSERT_TRUE(ParseDDSImage(image.data(), image.size(), 16, layout));
+  EXPECT_EQ(layout.width, 16u);
+  EXPECT_EQ(layout.height, 16u);
+  EXPECT_EQ(layout.mip_count, 5u);
+  ASSERT_EQ(layout.subresources.size(), 5u);
+  EXPECT_EQ(layout.subresources[0].offset,
+            kDX10HeaderBytes + (64 * 64 + 32 * 32) * 4);
+}
+
+TEST(DDSFileTest, CubeMapsLayOutSixFaces) {
+  std::vector<uint8_t> image = BuildImage(DXGI_FORMAT_BC3_UNORM, 16, 16, 3);
+  const std::vector<uint8_t> face(image.begin() + kDX10HeaderBytes,
+                                  image.end());
+  for (int i = 0; i < 5; ++i) {
+    image.insert(image.end(), face.begin(), face.end());
+  }
+  GetDX10Header(image)->miscFlag = DirectX::DDS_RESOURCE_MISC_TEXTURECUBE;
+
+  DDSLayout layout;
+  ASSERT_TRUE(ParseDDSImage(image.data(), image.size(), 0, layout));
+  EXPECT_TRUE(layout.is_cube_map);
+  EXPECT_EQ(layout.array_size, 6u);
+  ASSERT_EQ(layout.subresources.size(), 18u);
+  EXPECT_EQ(layout.subresources[3].offset, kDX10HeaderBytes + face.size());
+
+  // Five faces' worth of texels is not a cube.
+  image.resize(image.size() - face.size());
+  EXPECT_FALSE(Parses(image));
+}
+
+TEST(DDSFileTest, EveryTruncationFailsCleanly) {
+  const std::vector<uint8_t> image =
+      BuildImage(DXGI_FORMAT_BC1_UNORM, 16, 16, 5);
+  DDSLayout layout;
+  for (size_t size = 0; size < image.size(); ++size) {
+    EXPECT_FALSE(ParseDDSImage(image.data(), size, 0, layout)) << size;
+  }
+}
+
+TEST(DDSFileTest, RejectsHostileHeaders) {
+  const std::vector<uint8_t> valid =
+      BuildImage(DXGI_FORMAT_R8G8B8A8_UNORM, 8, 8, 1);
+  ASSERT_TRUE(Parses(valid));
+
+  auto bad_magic = valid;
+  bad_magic[0] = 'X';
+  EXPECT_FALSE(Parses(bad_magic));
+
+  auto zero_width = valid;
+  GetHeader(zero_width)->width = 0;
+  EXPECT_FALSE(Parses(zero_width));
+
+  // Beyond D3D12_REQ_TEXTURE2D_U_OR_V_DIMENSION, and a mip count no texture
+  // can have; both would otherwise lay out absurd sizes.
+  auto huge = valid;
+  GetHeader(huge)->width = 1u << 20;
+  EXPECT_FALSE(Parses(huge));
+
+  auto many_mips = valid;
+  GetHeader(many_mips)->mipMapCount = 40;
+  EXPECT_FALSE(Parses(many_mips));
+
+  auto no_slices = valid;
+  GetDX10Header(no_slices)->arraySize = 0;
+  EXPECT_FALSE(Parses(no_slices));
+
+  auto palettized = valid;
+  GetDX10Header(palettized)->dxgiFormat = DXGI_FORMAT_P8;
+  EXPECT_FALSE(Parses(palettized));
+
+  auto unknown_format = valid;
+  GetDX10Header(unknown_format)->dxgiFormat = static_cast<DXGI_FORMAT>(150);
+  EXPECT_FALSE(Parses(unknown_format));
+
+  auto bad_dimension = valid;
+  GetDX10Header(bad_dimension)->resourceDimension = 9;
+  EXPECT_FALSE(Parses(bad_dimension));
+
+  // A legacy header may not describe only some faces of a cube.
+  FileData stone;
+  ASSERT_TRUE(MapFile(DataPath("stone01.dds"), stone));
+  std::vector<uint8_t> partial_cube(stone.GetData(),
+                                    stone.GetData() + stone.GetSize());
+  GetHeader(partial_cube)->caps2 = DDS_CUBEMAP | DDS_CUBEMAP_POSITIVEX;
+  EXPECT_FALSE(Parses(partial_cube));
+}
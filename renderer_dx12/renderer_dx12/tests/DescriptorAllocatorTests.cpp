@@ -0,0 +1,197 @@
+#include "DescriptorAllocator.h"
+
+#include <gtest/gtest.h>
+
+#include <random>
+#include <utility>
+#include <vector>
+
+namespace {
+
+struct DescriptorRun {
+  uint32_t offset = 0;
+  uint32_t count = 0;
+};
+
+auto Overlaps(const DescriptorRun &a, const DescriptorRun &b) -> bool {
+  return a.offset < b.offset + b.count && b.offset < a.offset + a.count;
+}
+
+} // namespace
+
+TEST(DescriptorAllocatorTest, HandsOutFirstFitRuns) {
+  DescriptorAllocator allocator(16);
+  uint32_t a = 0;
+  uint32_t b = 0;
+  uint32_t c = 0;
+  ASSERT_TRUE(allocator.Allocate(4, a));
+  ASSERT_TRUE(allocator.Allocate(8, b));
+  ASSERT_TRUE(allocator.Allocate(4, c));
+  EXPECT_EQ(a, 0u);
+  EXPECT_EQ(b, 4u);
+  EXPECT_EQ(c, 12u);
+  EXPECT_EQ(allocator.GetUsed(), 16u);
+  EXPECT_EQ(allocator.GetFreeRunCount(), 0u);
+
+  uint32_t full = 0;
+  EXPECT_FALSE(allocator.Allocate(1, full));
+  EXPECT_FALSE(allocator.Allocate(0, full));
+
+  // The first hole that fits wins, even when a later one fits better.
+  allocator.Free(a, 4);
+  allocator.Free(c, 4);
+  uint32_t small = 0;
+  ASSERT_TRUE(allocator.Allocate(2, small));
+  EXPECT_EQ(small, 0u);
+}
+
+TEST(DescriptorAllocatorTest, FreedRunsMergeWithTheirNeighbours) {
+  DescriptorAllocator allocator(12);
+  uint32_t offsets[3] = {};
+  for (uint32_t &offset : offsets) {
+    ASSERT_TRUE(allocator.Allocate(4, offset));
+  }
+
+  // Two holes that cannot hold 8 descriptors on their own...
+  allocator.Free(offsets[0], 4);
+  allocator.Free(offsets[2], 4);
+  EXPECT_EQ(allocator.GetFreeRunCount(), 2u);
+  uint32_t offset = 0;
+  EXPECT_FALSE(allocator.Allocate(8, offset));
+
+  // ...become one once the run between them goes.
+  allocator.Free(offsets[1], 4);
+  EXPECT_EQ(allocator.GetFreeRunCount(), 1u);
+  EXPECT_EQ(allocator.GetUsed(), 0u);
+  EXPECT_EQ(allocator.GetPeakUsed(), 12u);
+  ASSERT_TRUE(allocator.Allocate(12, offset));
+  EXPECT_EQ(offset, 0u);
+}
+
+TEST(DescriptorAllocatorTest, RandomTrafficMatchesABitmap) {
+  constexpr uint32_t kCapacity = 256;
+  DescriptorAllocator allocator(kCapacity);
+  std::vector<bool> taken(kCapacity, false);
+  std::vector<DescriptorRun> live;
+  std::mt19937 random(1234);
+
+  for (int step = 0; step < 20000; ++step) {
+    if (live.empty() || random() % 3 != 0) {
+      const uint32_t count = 1 + random() % 16;
+      DescriptorRun run = {0, count};
+      if (!allocator.Allocate(count, run.offset)) {
+        continue;
+      }
+      ASSERT_LE(run.offset + count, kCapacity);
+      for (uint32_t i = run.offset; i < run.offset + count; ++i) {
+        ASSERT_FALSE(taken[i]) << "step " << step;
+        taken[i] = true;
+      }
+      live.push_back(run);
+    } else {
+      const size_t victim = random() % live.size();
+      const DescriptorRun run = live[victim];
+      live[victim] = live.back();
+      live.pop_back();
+      allocator.Free(run.offset, run.count);
+      for (uint32_t i = run.offset; i < run.offset + run.count; ++i) {
+        taken[i] = false;
+      }
+    }
+
+    uint32_t used = 0;
+    for (const DescriptorRun &run : live) {
+      used += run.count;
+    }
+    ASSERT_EQ(allocator.GetUsed(), used);
+  }
+
+  for (const DescriptorRun &run : live) {
+    allocator.Free(run.offset, run.count);
+  }
+  EXPECT_EQ(allocator.GetUsed(), 0u);
+  EXPECT_EQ(allocator.GetFreeRunCount(), 1u);
+}
+
+TEST(DescriptorAllocatorTest, ResetFreesEverything) {
+  DescriptorAllocator allocator(8);
+  uint32_t offset = 0;
+  ASSERT_TRUE(allocator.Allocate(8, offset));
+  allocator.Reset(32);
+  EXPECT_EQ(allocator.GetCapacity(), 32u);
+  EXPECT_EQ(allocator.GetUsed(), 0u);
+  EXPECT_EQ(allocator.GetPeakUsed(), 0u);
+  ASSERT_TRUE(allocator.Allocate(32, offset));
+
+  DescriptorAllocator empty;
+  EXPECT_FALSE(empty.Allocate(1, offset));
+}
+
+TEST(DescriptorRingTest, RetiredFramesGiveTheirDescriptorsBack) {
+  DescriptorRing ring(16, 2);
+  uint32_t offset = 0;
+
+  ring.BeginFrame(0);
+  ASSERT_TRUE(ring.Allocate(6, offset));
+  EXPECT_EQ(offset, 0u);
+
+  ring.BeginFrame(1);
+  ASSERT_TRUE(ring.Allocate(6, offset));
+  EXPECT_EQ(offset, 6u);
+  EXPECT_EQ(ring.GetUsed(), 12u);
+
+  // Frame 0 is still in flight: 6 more do not fit before wrapping onto it.
+  EXPECT_FALSE(ring.Allocate(6, offset));
+
+  // Once it retires, the run that did not fit at the end starts at 0. The
+  // four descriptors skipped at the end belong to the new frame.
+  ring.BeginFrame(0);
+  EXPECT_EQ(ring.GetUsed(), 6u);
+  ASSERT_TRUE(ring.Allocate(6, offset));
+  EXPECT_EQ(offset, 0u);
+  EXPECT_EQ(ring.GetUsed(), 16u);
+
+  ring.BeginFrame(1);
+  EXPECT_EQ(ring.GetUsed(), 4u + 6u);
+}
+
+TEST(DescriptorRingTest, ABusyFrameMayUseMoreThanItsShare) {
+  DescriptorRing ring(64, 3);
+  uint32_t offset = 0;
+  ring.BeginFrame(0);
+  ASSERT_TRUE(ring.Allocate(60, offset));
+  EXPECT_FALSE(ring.Allocate(5, offset));
+  EXPECT_FALSE(ring.Allocate(65, offset));
+  EXPECT_FALSE(ring.Allocate(0, offset));
+}
+
+TEST(DescriptorRingTest, InFlightFramesNeverShareDescriptors) {
+  constexpr uint32_t kCapacity = 128;
+  constexpr uint32_t kFrames = 3;
+  DescriptorRing ring(kCapacity, kFrames);
+  std::vector<std::vector<DescriptorRun>> in_flight(kFrames);
+  std::mt19937 random(99);
+
+  for (uint32_t frame = 0; frame < 3000; ++frame) {
+    const uint32_t slot = frame % kFrames;
+    // The slot's previous frame has retired.
+    in_flight[slot].clear();
+    ring.BeginFrame(slot);
+
+    const uint32_t allocations = random() % 8;
+    for (uint32_t i = 0; i < allocations; ++i) {
+      DescriptorRun run = {0, 1 + static_cast<uint32_t>(random() % 12)};
+      if (!ring.Allocate(run.count, run.offset)) {
+        continue;
+      }
+      ASSERT_LE(run.offset + run.count, kCapacity);
+      for (const auto &frame_runs : in_flight) {
+        for (const DescriptorRun &other : frame_runs) {
+          ASSERT_FALSE(Overlaps(run, other)) << "frame " << frame;
+        }
+      }
+      in_flight[slot].push_back(run);
+    }
+    ASSERT_LE(ring.GetUsed(), kCapacity);
+  }
+}
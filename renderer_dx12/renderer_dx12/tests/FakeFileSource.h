@@ -0,0 +1,92 @@
+#pragma once
+
+#include "FileSource.h"
+
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// In-memory FileSource. Every write bumps the file's stamp, the way a save
+// bumps the last-write time on disk.
+class FakeFileSource : public ResourceLoader::FileSource {
+public:
+  void SetFile(const std::wstring &path, const std::string &contents) {
+    SetFile(path, std::vector<uint8_t>(contents.begin(), contents.end()));
+  }
+
+  void SetFile(const std::wstring &path, std::vector<uint8_t> contents) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto &file = files_[path];
+    file.contents = std::move(contents);
+    file.write_time = ++clock_;
+  }
+
+  void RemoveFile(const std::wstring &path) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    files_.erase(path);
+  }
+
+  auto GetFile(const std::wstring &path) -> std::vector<uint8_t> {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = files_.find(path);
+    return it == files_.end() ? std::vector<uint8_t>() : it->second.contents;
+  }
+
+  auto GetPaths() -> std::vector<std::wstring> {
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::vector<std::wstring> paths;
+    for (const auto &file : files_) {
+      paths.push_back(file.first);
+    }
+    return paths;
+  }
+
+  auto ReadFile(const std::wstring &path, ResourceLoader::FileData &data)
+      -> bool override {
+    std::lock_guard<std::mutex> lock(mutex_);
+    ++reads;
+    auto it = files_.find(path);
+    if (it == files_.end()) {
+      return false;
+    }
+    data = ResourceLoader::FileData(it->second.contents);
+    return true;
+  }
+
+  auto GetStamp(const std::wstring &path, ResourceLoader::FileStamp &stamp)
+      -> bool override {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = files_.find(path);
+    if (!has_stamps || it == files_.end()) {
+      return false;
+    }
+    stamp.size = it->second.contents.size();
+    stamp.last_write_time = it->second.write_time;
+    return true;
+  }
+
+  auto WriteFile(const std::wstring &path, const std::vector<uint8_t> &data)
+      -> bool override {
+    if (!is_writable) {
+      return false;
+    }
+    SetFile(path, data);
+    return true;
+  }
+
+  bool has_stamps = true;
+  bool is_writable = true;
+  uint32_t reads = 0;
+
+private:
+  struct File {
+    std::vector<uint8_t> contents;
+    uint64_t write_time = 0;
+  };
+
+  std::mutex mutex_;
+  std::map<std::wstring, File> files_;
+  uint64_t clock_ = 0;
+};
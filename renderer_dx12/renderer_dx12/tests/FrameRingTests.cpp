@@ -0,0 +1,160 @@
+#include "FrameRing.h"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <vector>
+
+namespace {
+
+// A queue that runs submitted frames in order, each taking gpu_time, and
+// signals the frame's fence value when it finishes.
+class SimulatedGpu {
+public:
+  explicit SimulatedGpu(double gpu_time) : gpu_time_(gpu_time) {
+    finish_times_.push_back(0.0);
+  }
+
+  // Fence values are 1, 2, 3... in submission order.
+  auto Submit(double now) -> uint64_t {
+    const double start = (std::max)(now, finish_times_.back());
+    finish_times_.push_back(start + gpu_time_);
+    return finish_times_.size() - 1;
+  }
+
+  auto GetCompletedValue(double now) const -> uint64_t {
+    uint64_t completed = 0;
+    while (completed + 1 < finish_times_.size() &&
+           finish_times_[completed + 1] <= now) {
+      ++completed;
+    }
+    return completed;
+  }
+
+  // The CPU clock after blocking on fence_value.
+  auto WaitFor(uint64_t fence_value, double now) const -> double {
+    return (std::max)(now, finish_times_[fence_value]);
+  }
+
+private:
+  double gpu_time_ = 0.0;
+
+  std::vector<double> finish_times_ = {};
+};
+
+struct TimelineResult {
+  uint32_t waits = 0;
+  double elapsed = 0.0;
+};
+
+// Records frame_count frames of cpu_time each, checking at every Advance that
+// the slot handed back is only touched once its last frame has finished.
+auto RunTimeline(uint32_t latency, double cpu_time, double gpu_time,
+                 uint32_t frame_count) -> TimelineResult {
+  FrameRing ring(latency);
+  SimulatedGpu gpu(gpu_time);
+  TimelineResult result;
+  double now = 0.0;
+
+  for (uint32_t frame = 0; frame < frame_count; ++frame) {
+    now += cpu_time;
+    const uint64_t fence_value = gpu.Submit(now);
+    const uint32_t submitted_slot = ring.GetCurrentSlot();
+
+    const uint64_t wait_value = ring.Advance(fence_value);
+    EXPECT_EQ(ring.GetSlotFenceValue(submitted_slot), fence_value);
+    EXPECT_EQ(ring.GetCurrentSlot(), (submitted_slot + 1) % latency);
+
+    // The slot coming up was last used latency frames ago, not by the frame
+    // that was just submitted.
+    const uint64_t expected_wait =
+        fence_value >= latency ? fence_value - latency + 1 : 0;
+    EXPECT_EQ(wait_value, expected_wait) << "frame " << frame;
+
+    if (!ring.IsSlotReusable(ring.GetCurrentSlot(),
+                             gpu.GetCompletedValue(now))) {
+      ++result.waits;
+      now = gpu.WaitFor(wait_value, now);
+    }
+
+    const uint64_t completed = gpu.GetCompletedValue(now);
+    EXPECT_TRUE(ring.IsSlotReusable(ring.GetCurrentSlot(), completed));
+    // Counting the frame about to be recorded, never more than latency
+    // frames are in flight.
+    EXPECT_LT(fence_value - completed, latency) << "frame " << frame;
+  }
+
+  result.elapsed = now;
+  return result;
+}
+
+} // namespace
+
+TEST(FrameRingTest, ClampsTheFrameCount) {
+  EXPECT_EQ(FrameRing(0).GetFrameCount(), kMinFrameLatency);
+  EXPECT_EQ(FrameRing(3).GetFrameCount(), 3u);
+  EXPECT_EQ(FrameRing(9).GetFrameCount(), kMaxFrameLatency);
+  EXPECT_EQ(FrameRing(3).GetSlotFenceValue(7), 0u);
+}
+
+TEST(FrameRingTest, AdvanceRecordsBeforeItReportsTheNextSlot) {
+  FrameRing ring(2);
+  EXPECT_EQ(ring.Advance(1), 0u);
+  EXPECT_EQ(ring.Advance(2), 1u);
+  EXPECT_EQ(ring.Advance(3), 2u);
+  EXPECT_EQ(ring.GetCurrentSlot(), 1u);
+  EXPECT_FALSE(ring.IsSlotReusable(1, 1));
+  EXPECT_TRUE(ring.IsSlotReusable(1, 2));
+
+  ring.Reset(2);
+  EXPECT_EQ(ring.GetCurrentSlot(), 0u);
+  EXPECT_EQ(ring.Advance(4), 0u);
+}
+
+TEST(FrameRingTest, GpuBoundTimelinesBlockOnlyAfterWrapping) {
+  for (uint32_t latency = kMinFrameLatency; latency <= kMaxFrameLatency;
+       ++latency) {
+    SCOPED_TRACE(latency);
+    const TimelineResult result = RunTimeline(latency, 2.0, 10.0, 200);
+    // The first latency - 1 frames run ahead for free; every frame after
+    // that waits, and the CPU settles to the GPU's pace.
+    EXPECT_EQ(result.waits, 200 - (latency - 1));
+    EXPECT_NEAR(result.elapsed / 200, 10.0, 0.5);
+  }
+}
+
+TEST(FrameRingTest, CpuBoundTimelinesNeverBlock) {
+  for (uint32_t latency = kMinFrameLatency; latency <= kMaxFrameLatency;
+       ++latency) {
+    SCOPED_TRACE(latency);
+    const TimelineResult result = RunTimeline(latency, 10.0, 2.0, 200);
+    EXPECT_EQ(result.waits, 0u);
+    EXPECT_DOUBLE_EQ(result.elapsed, 2000.0);
+  }
+}
+
+TEST(FrameRingTest, DeeperRingsAbsorbOneSlowGpuFrame) {
+  // Balanced CPU and GPU, except that a few GPU frames take three times as
+  // long. A two-frame ring stalls behind each one; four frames hide it.
+  auto stalls = [](uint32_t latency) {
+    FrameRing ring(latency);
+    std::vector<double> finish_times = {0.0};
+    double now = 0.0;
+    uint32_t waits = 0;
+    for (uint32_t frame = 0; frame < 100; ++frame) {
+      now += 5.0;
+      const double gpu_time = frame % 25 == 10 ? 12.0 : 4.0;
+      finish_times.push_back((std::max)(now, finish_times.back()) + gpu_time);
+      const uint64_t fence_value = finish_times.size() - 1;
+      const uint64_t wait_value = ring.Advance(fence_value);
+      if (finish_times[wait_value] > now) {
+        ++waits;
+        now = finish_times[wait_value];
+      }
+    }
+    return waits;
+  };
+
+  EXPECT_GT(stalls(2), 0u);
+  EXPECT_EQ(stalls(4), 0u);
+}
@@ -0,0 +1,101 @@
+#include "FrustumCulling.h"
+
+#include <gtest/gtest.h>
+
+#include <random>
+#include <vector>
+
+namespace {
+
+// A left-handed perspective looking down +z from the origin: 90 degrees
+// each way, near 1, far 100. Row-major for row vectors.
+auto MakeFrustum() -> FrustumPlanes {
+  const float z_scale = 100.0f / 99.0f;
+  const float view_projection[16] = {1.0f, 0.0f, 0.0f,     0.0f,
+                                     0.0f, 1.0f, 0.0f,     0.0f,
+                                     0.0f, 0.0f, z_scale,  1.0f,
+                                     0.0f, 0.0f, -z_scale, 0.0f};
+  FrustumPlanes frustum;
+  ExtractFrustumPlanes(view_projection, frustum);
+  return frustum;
+}
+
+auto MakeBounds(float x, float y, float z, float extent) -> BoundingVolume {
+  BoundingVolume bounds;
+  bounds.center[0] = x;
+  bounds.center[1] = y;
+  bounds.center[2] = z;
+  for (float &axis : bounds.extents) {
+    axis = extent;
+  }
+  bounds.radius = extent * 1.7320508f;
+  return bounds;
+}
+
+} // namespace
+
+TEST(FrustumCullingTest, SingleBoundsAgainstEachPlane) {
+  const FrustumPlanes frustum = MakeFrustum();
+  EXPECT_TRUE(IsVisible(frustum, MakeBounds(0.0f, 0.0f, 50.0f, 1.0f)));
+  EXPECT_FALSE(IsVisible(frustum, MakeBounds(0.0f, 0.0f, -5.0f, 1.0f)));
+  EXPECT_FALSE(IsVisible(frustum, MakeBounds(0.0f, 0.0f, 110.0f, 1.0f)));
+  EXPECT_FALSE(IsVisible(frustum, MakeBounds(-20.0f, 0.0f, 10.0f, 1.0f)));
+  EXPECT_FALSE(IsVisible(frustum, MakeBounds(20.0f, 0.0f, 10.0f, 1.0f)));
+  EXPECT_FALSE(IsVisible(frustum, MakeBounds(0.0f, -20.0f, 10.0f, 1.0f)));
+  EXPECT_FALSE(IsVisible(frustum, MakeBounds(0.0f, 20.0f, 10.0f, 1.0f)));
+  // Straddling a plane is visible.
+  EXPECT_TRUE(IsVisible(frustum, MakeBounds(10.5f, 0.0f, 10.0f, 1.0f)));
+}
+
+TEST(FrustumCullingTest, EveryPathAgreesWithTheSingleTest) {
+  const FrustumPlanes frustum = MakeFrustum();
+  std::mt19937 random(23);
+  std::uniform_real_distribution<float> position(-120.0f, 120.0f);
+  std::uniform_real_distribution<float> extent(0.1f, 8.0f);
+
+  // Not a multiple of the lane count, so the last group is partly padding.
+  std::vector<BoundingVolume> objects(1003);
+  CullingBounds bounds;
+  for (BoundingVolume &object : objects) {
+    object = MakeBounds(position(random), position(random), position(random),
+                        extent(random));
+    bounds.Add(object);
+  }
+
+  size_t expected_count = 0;
+  std::vector<uint8_t> expected(objects.size());
+  for (size_t i = 0; i < objects.size(); ++i) {
+    expected[i] = IsVisible(frustum, objects[i]) ? 1 : 0;
+    expected_count += expected[i];
+  }
+  ASSERT_GT(expected_count, 0u);
+  ASSERT_LT(expected_count, objects.size());
+
+  for (const CullingPath path : {CullingPath::kAuto, CullingPath::kScalar,
+                                 CullingPath::kSse, CullingPath::kAvx}) {
+    // One past the end catches a path writing padding lanes.
+    std::vector<uint8_t> visible(objects.size() + 1, 0xcd);
+    EXPECT_EQ(CullBounds(frustum, bounds, 0, objects.size(), visible.data(),
+                         path),
+              expected_count);
+    EXPECT_EQ(visible.back(), 0xcd);
+    visible.pop_back();
+    EXPECT_EQ(visible, expected) << static_cast<int>(path);
+
+    // A range that starts on a lane group and ends inside one.
+    std::fill(visible.begin(), visible.end(), 0xcd);
+    const size_t begin = CullingBounds::kCullingLaneCount * 3;
+    const size_t end = begin + 13;
+    size_t range_count = 0;
+    for (size_t i = begin; i < end; ++i) {
+      range_count += expected[i];
+    }
+    EXPECT_EQ(
+        CullBounds(frustum, bounds, begin, end, visible.data(), path),
+        range_count);
+    for (size_t i = 0; i < visible.size(); ++i) {
+      const bool in_range = i >= begin && i < end;
+      EXPECT_EQ(visible[i], in_range ? expected[i] : 0xcd) << i;
+    }
+  }
+}
@@ -0,0 +1,232 @@
+#include "JobSystem.h"
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace {
+
+// Runs a ParallelFor over count indices and checks each one was handed out
+// exactly once.
+void ExpectEveryIndexOnce(JobSystem &jobs, size_t count, size_t grain_size) {
+  std::vector<std::atomic<int>> hits(count);
+  jobs.ParallelFor(count, grain_size, [&hits](size_t begin, size_t end) {
+    ASSERT_LE(begin, end);
+    for (size_t i = begin; i < end; ++i) {
+      hits[i].fetch_add(1);
+    }
+  });
+  for (size_t i = 0; i < count; ++i) {
+    ASSERT_EQ(hits[i].load(), 1)
+        << "index " << i << " of " << count << ", grain " << grain_size;
+  }
+}
+
+} // namespace
+
+TEST(JobSystemTest, ParallelForCoversEveryIndexOnce) {
+  JobSystem jobs(JobSystemConfig{3, true});
+  for (const size_t count : {1u, 2u, 7u, 64u, 1000u, 100003u}) {
+    for (const size_t grain_size : {0u, 1u, 3u, 64u, 200000u}) {
+      ExpectEveryIndexOnce(jobs, count, grain_size);
+    }
+  }
+  // Nothing to do is not an error.
+  jobs.ParallelFor(0, 0, [](size_t, size_t) { FAIL(); });
+}
+
+TEST(JobSystemTest, OutsideCallersOnlyWaitWhenTheyDoNotParticipate) {
+  JobSystem jobs(JobSystemConfig{2, false});
+  EXPECT_EQ(jobs.GetConcurrency(), 2u);
+  EXPECT_FALSE(jobs.IsWorkerThread());
+
+  const std::thread::id caller = std::this_thread::get_id();
+  std::atomic<bool> ran_on_caller{false};
+  std::atomic<bool> ran_off_pool{false};
+  jobs.ParallelFor(10000, 16, [&](size_t, size_t) {
+    ran_on_caller = ran_on_caller || std::this_thread::get_id() == caller;
+    ran_off_pool = ran_off_pool || !jobs.IsWorkerThread();
+  });
+  EXPECT_FALSE(ran_on_caller);
+  EXPECT_FALSE(ran_off_pool);
+
+  for (const size_t count : {1u, 5u, 4096u}) {
+    ExpectEveryIndexOnce(jobs, count, 0);
+    ExpectEveryIndexOnce(jobs, count, 1);
+  }
+}
+
+TEST(JobSystemTest, NestedParallelForFromWorkersAndOutsiders) {
+  JobSystem jobs(JobSystemConfig{3, true});
+  std::atomic<size_t> total{0};
+  JobCounter counter;
+  for (int outer = 0; outer < 8; ++outer) {
+    jobs.Submit(
+        [&jobs, &total] {
+          jobs.ParallelFor(1000, 0, [&total](size_t begin, size_t end) {
+            total.fetch_add(end - begin);
+          });
+        },
+        counter);
+  }
+  // The caller nests too, while the workers are busy with the above.
+  jobs.ParallelFor(8, 1, [&jobs, &total](size_t, size_t) {
+    jobs.ParallelFor(1000, 7, [&total](size_t begin, size_t end) {
+      total.fetch_add(end - begin);
+    });
+  });
+  jobs.Wait(counter);
+  EXPECT_EQ(total.load(), 16u * 1000u);
+}
+
+TEST(JobSystemTest, NestedWaitsDoNotDeadlockOneWorker) {
+  // The lone worker must run what it waits for itself, in both modes.
+  for (const bool caller_participates : {true, false}) {
+    JobSystem jobs(JobSystemConfig{1, caller_participates});
+    std::atomic<int> leaves{0};
+    JobCounter outer;
+    for (int i = 0; i < 4; ++i) {
+      jobs.Submit(
+          [&jobs, &leaves] {
+            JobCounter inner;
+            for (int k = 0; k < 4; ++k) {
+              jobs.Submit([&leaves] { leaves.fetch_add(1); }, inner);
+            }
+            jobs.Wait(inner);
+            jobs.ParallelFor(64, 1, [&leaves](size_t begin, size_t end) {
+              leaves.fetch_add(static_cast<int>(end - begin));
+            });
+          },
+          outer);
+    }
+    jobs.Wait(outer);
+    EXPECT_EQ(leaves.load(), 4 * (4 + 64));
+  }
+}
+
+TEST(JobSystemTest, SubmitAfterRunsOnceTheDependencyIsDone) {
+  JobSystem jobs(JobSystemConfig{3, true});
+  std::mutex mutex;
+  std::vector<int> order;
+  const auto record = [&](int step) {
+    std::lock_guard<std::mutex> lock(mutex);
+    order.push_back(step);
+  };
+
+  JobCounter first;
+  JobCounter second;
+  JobCounter third;
+  std::atomic<int> first_done{0};
+  for (int i = 0; i < 8; ++i) {
+    jobs.Submit(
+        [&] {
+          std::this_thread::sleep_for(std::chrono::milliseconds(2));
+          first_done.fetch_add(1);
+        },
+        first);
+  }
+  // Chained before the first batch can finish.
+  jobs.SubmitAfter(first,
+                   [&] {
+                     EXPECT_EQ(first_done.load(), 8);
+                     record(1);
+                   },
+                   second);
+  jobs.SubmitAfter(second, [&] { record(2); }, third);
+  EXPECT_FALSE(third.IsDone());
+
+  jobs.Wait(third);
+  EXPECT_TRUE(first.IsDone());
+  EXPECT_TRUE(second.IsDone());
+  EXPECT_EQ(order, (std::vector<int>{1, 2}));
+}
+
+TEST(JobSystemTest, SubmitAfterADoneCounterRunsRightAway) {
+  JobSystem jobs(JobSystemConfig{2, true});
+  std::atomic<int> runs{0};
+
+  // Never used, and used and finished.
+  JobCounter idle;
+  JobCounter finished;
+  jobs.Submit([] {}, finished);
+  jobs.Wait(finished);
+
+  JobCounter counter;
+  jobs.SubmitAfter(idle, [&runs] { runs.fetch_add(1); }, counter);
+  jobs.SubmitAfter(finished, [&runs] { runs.fetch_add(1); }, counter);
+  jobs.Wait(counter);
+  EXPECT_EQ(runs.load(), 2);
+}
+
+TEST(JobSystemTest, ContinuationsRacingTheLastJobRunExactlyOnce) {
+  // SubmitAfter calls land while the dependency's jobs are finishing, so
+  // some register before the drop to zero and some after it.
+  JobSystem jobs(JobSystemConfig{3, false});
+  for (int round = 0; round < 200; ++round) {
+    std::atomic<int> runs{0};
+    int submitted = 0;
+    JobCounter dependency;
+    JobCounter continuations;
+    for (int i = 0; i < 16; ++i) {
+      jobs.Submit([] {}, dependency);
+    }
+    while ((!dependency.IsDone() && submitted < 256) || submitted < 4) {
+      jobs.SubmitAfter(dependency, [&runs] { runs.fetch_add(1); },
+                       continuations);
+      ++submitted;
+    }
+    jobs.Wait(continuations);
+    jobs.Wait(dependency);
+    ASSERT_EQ(runs.load(), submitted) << "round " << round;
+  }
+}
+
+TEST(JobSystemTest, CountersMayDieRightAfterWait) {
+  // Under ASan, this catches Finish touching a counter its waiter has
+  // already destroyed. Heap counters make the reuse immediate.
+  JobSystem jobs(JobSystemConfig{3, true});
+  std::atomic<int> runs{0};
+  for (int round = 0; round < 5000; ++round) {
+    auto counter = std::make_unique<JobCounter>();
+    for (int i = 0; i < 3; ++i) {
+      jobs.Submit([&runs] { runs.fetch_add(1); }, *counter);
+    }
+    jobs.Wait(*counter);
+    counter.reset();
+
+    auto dependency = std::make_unique<JobCounter>();
+    auto after = std::make_unique<JobCounter>();
+    jobs.Submit([&runs] { runs.fetch_add(1); }, *dependency);
+    jobs.SubmitAfter(*dependency, [&runs] { runs.fetch_add(1); }, *after);
+    jobs.Wait(*after);
+    jobs.Wait(*dependency);
+    dependency.reset();
+    after.reset();
+  }
+  EXPECT_EQ(runs.load(), 5000 * 5);
+}
+
+TEST(JobSystemTest, WaitersWakeForEveryJob) {
+  // Short jobs submitted just as the waiter and the workers go to sleep: a
+  // lost wakeup between Push and Wait hangs this test.
+  for (const bool caller_participates : {true, false}) {
+    JobSystem jobs(JobSystemConfig{2, caller_participates});
+    for (int round = 0; round < 20000; ++round) {
+      JobCounter counter;
+      std::atomic<int> runs{0};
+      jobs.Submit(
+          [&jobs, &counter, &runs] {
+            runs.fetch_add(1);
+            jobs.Submit([&runs] { runs.fetch_add(1); }, counter);
+          },
+          counter);
+      jobs.Wait(counter);
+      ASSERT_EQ(runs.load(), 2) << "round " << round;
+    }
+  }
+}
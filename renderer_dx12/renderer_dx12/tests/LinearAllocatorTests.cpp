@@ -0,0 +1,134 @@
+#include "LinearAllocator.h"
+
+#include <gtest/gtest.h>
+
+#include <vector>
+
+namespace {
+
+// A page of host memory standing in for a mapped upload heap, with a fake
+// GPU address that is deliberately not aligned to the CPU pointer.
+struct FakePage {
+  explicit FakePage(uint64_t size, uint64_t gpu_base)
+      : bytes(size), gpu_base(gpu_base) {}
+
+  void AddTo(LinearAllocator &allocator) {
+    allocator.AddPage(bytes.data(), gpu_base, bytes.size());
+  }
+
+  std::vector<uint8_t> bytes;
+  uint64_t gpu_base = 0;
+};
+
+} // namespace
+
+TEST(LinearAllocatorTest, AlignsTheGpuAddress) {
+  FakePage page(4096, 0x10000 + 16);
+  LinearAllocator allocator;
+  page.AddTo(allocator);
+
+  LinearAllocation first;
+  ASSERT_TRUE(allocator.Allocate(100, kConstantBufferAlignment, first));
+  EXPECT_EQ(first.gpu_address % kConstantBufferAlignment, 0u);
+  EXPECT_EQ(first.gpu_address, 0x10100u);
+  // The CPU pointer sits at the same offset into the page.
+  EXPECT_EQ(first.cpu_address - page.bytes.data(),
+            static_cast<ptrdiff_t>(first.gpu_address - page.gpu_base));
+
+  LinearAllocation second;
+  ASSERT_TRUE(allocator.Allocate(100, kConstantBufferAlignment, second));
+  EXPECT_EQ(second.gpu_address, first.gpu_address + 256);
+  EXPECT_EQ(second.size, 100u);
+  // Padding counts as used: 240 to reach the first boundary, 156 after it.
+  EXPECT_EQ(allocator.GetUsed(), 240u + 256u + 100u);
+
+  LinearAllocation vertices;
+  ASSERT_TRUE(allocator.Allocate(12, 4, vertices));
+  EXPECT_EQ(vertices.gpu_address, second.gpu_address + 100);
+
+  LinearAllocation none;
+  EXPECT_FALSE(allocator.Allocate(0, 4, none));
+  EXPECT_FALSE(allocator.Allocate(4, 0, none));
+}
+
+TEST(LinearAllocatorTest, RollsOverToTheNextPage) {
+  FakePage first_page(1024, 0x10000);
+  FakePage second_page(1024, 0x80000);
+  LinearAllocator allocator;
+  first_page.AddTo(allocator);
+  second_page.AddTo(allocator);
+  EXPECT_EQ(allocator.GetPageCount(), 2u);
+  EXPECT_EQ(allocator.GetCapacity(), 2048u);
+
+  LinearAllocation allocation;
+  ASSERT_TRUE(allocator.Allocate(768, kConstantBufferAlignment, allocation));
+  EXPECT_EQ(allocation.gpu_address, first_page.gpu_base);
+
+  // 512 bytes do not fit in the 256 left, so the tail is skipped.
+  ASSERT_TRUE(allocator.Allocate(512, kConstantBufferAlignment, allocation));
+  EXPECT_EQ(allocation.gpu_address, second_page.gpu_base);
+  EXPECT_EQ(allocation.cpu_address, second_page.bytes.data());
+  EXPECT_EQ(allocator.GetUsed(), 1024u + 512u);
+
+  // Out of room: the owner adds a page and the retry lands in it.
+  ASSERT_TRUE(allocator.Allocate(512, kConstantBufferAlignment, allocation));
+  EXPECT_FALSE(allocator.Allocate(256, kConstantBufferAlignment, allocation));
+  FakePage third_page(1024, 0xc0000);
+  third_page.AddTo(allocator);
+  ASSERT_TRUE(allocator.Allocate(256, kConstantBufferAlignment, allocation));
+  EXPECT_EQ(allocation.gpu_address, third_page.gpu_base);
+
+  // Nothing larger than a page ever fits.
+  EXPECT_FALSE(allocator.Allocate(2048, 4, allocation));
+}
+
+TEST(LinearAllocatorTest, RetireRewindsOnlyOnceTheFenceCompletes) {
+  FakePage first_page(512, 0x10000);
+  FakePage second_page(512, 0x20000);
+  LinearAllocator allocator;
+  first_page.AddTo(allocator);
+  second_page.AddTo(allocator);
+
+  LinearAllocation allocation;
+  ASSERT_TRUE(allocator.Allocate(512, kConstantBufferAlignment, allocation));
+  ASSERT_TRUE(allocator.Allocate(256, kConstantBufferAlignment, allocation));
+  EXPECT_EQ(allocation.gpu_address, second_page.gpu_base);
+
+  allocator.Close(7);
+  EXPECT_TRUE(allocator.IsClosed());
+  EXPECT_FALSE(allocator.Allocate(16, 16, allocation));
+
+  EXPECT_FALSE(allocator.Retire(6));
+  EXPECT_TRUE(allocator.IsClosed());
+  EXPECT_EQ(allocator.GetUsed(), 768u);
+
+  EXPECT_TRUE(allocator.Retire(7));
+  EXPECT_FALSE(allocator.IsClosed());
+  EXPECT_EQ(allocator.GetUsed(), 0u);
+  EXPECT_EQ(allocator.GetPeakUsed(), 768u);
+  // Pages are kept, and the next frame starts again at the first one.
+  EXPECT_EQ(allocator.GetPageCount(), 2u);
+  ASSERT_TRUE(allocator.Allocate(64, kConstantBufferAlignment, allocation));
+  EXPECT_EQ(allocation.gpu_address, first_page.gpu_base);
+
+  // An open allocator has nothing to wait for.
+  EXPECT_TRUE(allocator.Retire(0));
+}
+
+TEST(LinearAllocatorTest, ClearDropsEveryPage) {
+  FakePage page(256, 0x10000);
+  LinearAllocator allocator;
+  page.AddTo(allocator);
+  allocator.AddPage(nullptr, 0x20000, 256);
+  allocator.AddPage(page.bytes.data(), 0x30000, 0);
+  EXPECT_EQ(allocator.GetPageCount(), 1u);
+
+  LinearAllocation allocation;
+  ASSERT_TRUE(allocator.Allocate(64, 64, allocation));
+  allocator.Close(1);
+  allocator.Clear();
+  EXPECT_FALSE(allocator.IsClosed());
+  EXPECT_EQ(allocator.GetPageCount(), 0u);
+  EXPECT_EQ(allocator.GetCapacity(), 0u);
+  EXPECT_FALSE(allocator.Allocate(64, 64, allocation));
+}
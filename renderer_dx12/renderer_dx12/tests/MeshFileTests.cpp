@@ -0,0 +1,153 @@
+#include "MeshFile.h"
+
+#include <gtest/gtest.h>
+
+#include <cstring>
+#include <vector>
+
+using namespace ResourceLoader;
+
+namespace {
+
+// Two triangles sharing an edge, in the source layout.
+const MeshSourceVertex kQuad[4] = {
+    {0, 0, 0, 0, 1, 0, 0, -1},
+    {0, 1, 0, 0, 0, 0, 0, -1},
+    {1, 0, 0, 1, 1, 0, 0, -1},
+    {1, 1, 0, 1, 0, 0, 0, -1},
+};
+
+const uint16_t kQuadIndices[6] = {0, 1, 2, 2, 1, 3};
+
+auto BuildQuadImage() -> std::vector<uint8_t> {
+  MeshImageDesc desc = {};
+  desc.attributes = GetSourceMeshAttributes(desc.attribute_count);
+  desc.vertices = kQuad;
+  desc.vertex_count = 4;
+  desc.vertex_stride = sizeof(MeshSourceVertex);
+  desc.indices = kQuadIndices;
+  desc.index_count = 6;
+  desc.index_size = sizeof(uint16_t);
+  std::vector<uint8_t> image;
+  EXPECT_TRUE(BuildMeshImage(desc, image));
+  return image;
+}
+
+auto GetHeader(std::vector<uint8_t> &image) -> MeshFileHeader * {
+  return reinterpret_cast<MeshFileHeader *>(image.data());
+}
+
+auto GetAttribute(std::vector<uint8_t> &image, uint32_t index)
+    -> MeshAttributeDesc * {
+  return reinterpret_cast<MeshAttributeDesc *>(
+             image.data() + sizeof(MeshFileHeader)) +
+         index;
+}
+
+auto IsValid(const std::vector<uint8_t> &image) -> bool {
+  return ValidateMeshImage(image.data(), image.size()) != nullptr;
+}
+
+} // namespace
+
+TEST(MeshFileTest, BuiltImagesOpenAndRoundTrip) {
+  MeshFile mesh;
+  ASSERT_TRUE(mesh.OpenFromImage(BuildQuadImage()));
+  EXPECT_TRUE(mesh.HasSourceLayout());
+  EXPECT_EQ(mesh.GetVertexCount(), 4u);
+  EXPECT_EQ(mesh.GetIndexSize(), 2u);
+  EXPECT_EQ(memcmp(mesh.GetVertexData(), kQuad, sizeof(kQuad)), 0);
+
+  std::vector<uint32_t> indices;
+  ASSERT_TRUE(mesh.CopyIndices(indices));
+  EXPECT_EQ(indices, (std::vector<uint32_t>{0, 1, 2, 2, 1, 3}));
+
+  MeshFile placeholder;
+  ASSERT_TRUE(OpenPlaceholderMesh(placeholder));
+  EXPECT_EQ(placeholder.GetVertexCount(), 24u);
+  EXPECT_EQ(placeholder.GetIndexCount(), 36u);
+}
+
+TEST(MeshFileTest, EveryTruncationFailsCleanly) {
+  const std::vector<uint8_t> image = BuildQuadImage();
+  ASSERT_TRUE(IsValid(image));
+  for (size_t size = 0; size < image.size(); ++size) {
+    EXPECT_EQ(ValidateMeshImage(image.data(), size), nullptr) << size;
+  }
+  EXPECT_EQ(ValidateMeshImage(nullptr, image.size()), nullptr);
+}
+
+TEST(MeshFileTest, RejectsBadHeaders) {
+  const std::vector<uint8_t> valid = BuildQuadImage();
+
+  auto bad_magic = valid;
+  GetHeader(bad_magic)->magic = 0;
+  EXPECT_FALSE(IsValid(bad_magic));
+
+  auto old_version = valid;
+  GetHeader(old_version)->version = kMeshFileVersion - 1;
+  EXPECT_FALSE(IsValid(old_version));
+
+  auto too_many_attributes = valid;
+  GetHeader(too_many_attributes)->attribute_count = kMaxMeshAttributes + 1;
+  EXPECT_FALSE(IsValid(too_many_attributes));
+
+  auto odd_index_size = valid;
+  GetHeader(odd_index_size)->index_size = 3;
+  EXPECT_FALSE(IsValid(odd_index_size));
+
+  // The blob sizes must agree with the counts they claim to hold.
+  auto vertex_bytes = valid;
+  GetHeader(vertex_bytes)->vertex_bytes -= 4;
+  EXPECT_FALSE(IsValid(vertex_bytes));
+
+  auto unknown_format = valid;
+  GetAttribute(unknown_format, 0)->format =
+      static_cast<MeshAttributeFormat>(7);
+  EXPECT_FALSE(IsValid(unknown_format));
+}
+
+TEST(MeshFileTest, RejectsMisalignedOrOverlappingBlobs) {
+  const std::vector<uint8_t> valid = BuildQuadImage();
+
+  auto misaligned_vertices = valid;
+  GetHeader(misaligned_vertices)->vertex_offset += 4;
+  EXPECT_FALSE(IsValid(misaligned_vertices));
+
+  auto misaligned_indices = valid;
+  GetHeader(misaligned_indices)->index_offset += 2;
+  EXPECT_FALSE(IsValid(misaligned_indices));
+
+  // Vertices over the attribute table, indices over the vertices.
+  auto vertices_on_attributes = valid;
+  GetHeader(vertices_on_attributes)->vertex_offset = sizeof(MeshFileHeader);
+  EXPECT_FALSE(IsValid(vertices_on_attributes));
+
+  auto indices_on_vertices = valid;
+  GetHeader(indices_on_vertices)->index_offset =
+      GetHeader(indices_on_vertices)->vertex_offset;
+  EXPECT_FALSE(IsValid(indices_on_vertices));
+}
+
+TEST(MeshFileTest, RejectsRangesThatWrapAround) {
+  const std::vector<uint8_t> valid = BuildQuadImage();
+
+  // Aligned, past the attribute table, and wrapping to a small end once
+  // the blob's size is added.
+  auto vertices = valid;
+  GetHeader(vertices)->vertex_offset = 0xFFFFFFFFFFFFFFF0ull;
+  EXPECT_FALSE(IsValid(vertices));
+
+  auto indices = valid;
+  GetHeader(indices)->index_offset = 0xFFFFFFFFFFFFFFF0ull;
+  EXPECT_FALSE(IsValid(indices));
+
+  // An attribute offset that wraps to inside the stride in 32 bits.
+  auto attribute = valid;
+  GetAttribute(attribute, 0)->offset = 0xFFFFFFF8u;
+  EXPECT_FALSE(IsValid(attribute));
+
+  auto past_stride = valid;
+  GetAttribute(past_stride, 2)->offset = sizeof(MeshSourceVertex) - 8;
+  EXPECT_FALSE(IsValid(past_stride));
+}
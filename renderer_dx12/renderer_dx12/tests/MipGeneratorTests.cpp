@@ -0,0 +1,222 @@
+#include "MipGenerator.h"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cmath>
+#include <iterator>
+#include <random>
+#include <vector>
+
+#include "JobSystem.h"
+
+using namespace ResourceLoader;
+
+namespace {
+
+// A width x height chain with random texels in level 0.
+auto MakeRandomChain(uint32_t width, uint32_t height, uint32_t seed,
+                     std::vector<MipLevel> &levels) -> std::vector<uint8_t> {
+  std::vector<uint8_t> pixels(LayoutMipChain(width, height, levels));
+  std::mt19937 random(seed);
+  for (size_t i = 0; i < static_cast<size_t>(width) * height * 4; ++i) {
+    pixels[i] = static_cast<uint8_t>(random());
+  }
+  return pixels;
+}
+
+auto MakeOptions(TextureUsage usage, MipFilter filter,
+                 bool allow_parallel = false) -> MipOptions {
+  MipOptions options = {};
+  options.usage = usage;
+  options.filter = filter;
+  options.allow_parallel = allow_parallel;
+  return options;
+}
+
+class MipGeneratorTest : public ::testing::Test {
+protected:
+  MipGeneratorTest() : jobs_(JobSystemConfig{3, true}) {}
+
+  JobSystem jobs_;
+};
+
+} // namespace
+
+TEST(MipLayoutTest, ChainsHalveDownToOneTexel) {
+  EXPECT_EQ(GetMipLevelCount(1, 1), 1u);
+  EXPECT_EQ(GetMipLevelCount(256, 256), 9u);
+  EXPECT_EQ(GetMipLevelCount(1024, 1), 11u);
+
+  // Odd sizes round down, and each axis stops at one.
+  std::vector<MipLevel> levels;
+  EXPECT_EQ(LayoutMipChain(5, 3, levels), (5 * 3 + 2 * 1 + 1 * 1) * 4u);
+  ASSERT_EQ(levels.size(), 3u);
+  EXPECT_EQ(levels[1].width, 2u);
+  EXPECT_EQ(levels[1].height, 1u);
+  EXPECT_EQ(levels[1].offset, 60u);
+  EXPECT_EQ(levels[2].width, 1u);
+  EXPECT_EQ(levels[2].offset, 68u);
+
+  EXPECT_EQ(LayoutMipChain(13, 100, levels), 1697 * 4u);
+  ASSERT_EQ(levels.size(), 7u);
+  EXPECT_EQ(levels[3].width, 1u);
+  EXPECT_EQ(levels[3].height, 12u);
+  EXPECT_EQ(levels[6].height, 1u);
+
+  EXPECT_EQ(LayoutMipChain(0, 8, levels), 0u);
+  EXPECT_TRUE(levels.empty());
+}
+
+TEST_F(MipGeneratorTest, BoxFilterAveragesFourTexels) {
+  std::vector<MipLevel> levels;
+  std::vector<uint8_t> pixels(LayoutMipChain(2, 2, levels));
+  const uint8_t top[16] = {0,  100, 200, 255, 100, 100, 0,   255,
+                           50, 0,   100, 0,   250, 0,   100, 255};
+  std::copy(std::begin(top), std::end(top), pixels.begin());
+
+  ASSERT_TRUE(GenerateMipChain(
+      jobs_, pixels.data(), levels,
+      MakeOptions(TextureUsage::kLinear, MipFilter::kBox)));
+  const uint8_t *mip = pixels.data() + levels[1].offset;
+  EXPECT_EQ(mip[0], 100); // (0 + 100 + 50 + 250) / 4
+  EXPECT_EQ(mip[1], 50);  // (100 + 100 + 0 + 0) / 4
+  EXPECT_EQ(mip[2], 100); // (200 + 0 + 100 + 100) / 4
+  EXPECT_EQ(mip[3], 191); // 191.25
+}
+
+TEST_F(MipGeneratorTest, ColorIsFilteredInLinearLight) {
+  // Black and white side by side, with alpha 0 and 255.
+  std::vector<MipLevel> levels;
+  std::vector<uint8_t> pixels(LayoutMipChain(2, 1, levels));
+  const uint8_t top[8] = {0, 0, 0, 0, 255, 255, 255, 255};
+  std::copy(std::begin(top), std::end(top), pixels.begin());
+  std::vector<uint8_t> linear = pixels;
+
+  ASSERT_TRUE(GenerateMipChain(
+      jobs_, pixels.data(), levels,
+      MakeOptions(TextureUsage::kColor, MipFilter::kBox)));
+  const uint8_t *mip = pixels.data() + levels[1].offset;
+  // Half of white's light is sRGB 0.735, not the 0.5 a byte average gives.
+  EXPECT_EQ(mip[0], 188);
+  EXPECT_EQ(mip[1], 188);
+  EXPECT_EQ(mip[2], 188);
+  // Alpha is linear either way.
+  EXPECT_EQ(mip[3], 128);
+
+  ASSERT_TRUE(GenerateMipChain(
+      jobs_, linear.data(), levels,
+      MakeOptions(TextureUsage::kLinear, MipFilter::kBox)));
+  EXPECT_EQ(linear[levels[1].offset], 128);
+}
+
+TEST_F(MipGeneratorTest, NormalMapLevelsStayUnitLength) {
+  std::vector<MipLevel> levels;
+  std::vector<uint8_t> pixels = MakeRandomChain(64, 32, 5, levels);
+
+  ASSERT_TRUE(GenerateMipChain(
+      jobs_, pixels.data(), levels,
+      MakeOptions(TextureUsage::kNormalMap, MipFilter::kKaiser)));
+  for (size_t level = 1; level < levels.size(); ++level) {
+    const uint8_t *mip = pixels.data() + levels[level].offset;
+    const size_t texel_count =
+        static_cast<size_t>(levels[level].width) * levels[level].height;
+    for (size_t i = 0; i < texel_count; ++i) {
+      const uint8_t *texel = mip + i * 4;
+      const float x = texel[0] / 127.5f - 1.0f;
+      const float y = texel[1] / 127.5f - 1.0f;
+      const float z = texel[2] / 127.5f - 1.0f;
+      // Eight bits per axis are good to within a couple of percent.
+      ASSERT_NEAR(std::sqrt(x * x + y * y + z * z), 1.0f, 0.02f)
+          << "level " << level << " texel " << i;
+    }
+  }
+}
+
+TEST_F(MipGeneratorTest, LinearChannelsAreFilteredApart) {
+  // Noise in channel 0 only; the others hold constants that must survive
+  // the sharpening Kaiser filter untouched.
+  std::vector<MipLevel> levels;
+  std::vector<uint8_t> pixels = MakeRandomChain(32, 32, 9, levels);
+  for (size_t i = 0; i < 32 * 32 * 4; i += 4) {
+    pixels[i + 1] = 77;
+    pixels[i + 2] = 0;
+    pixels[i + 3] = 255;
+  }
+
+  ASSERT_TRUE(GenerateMipChain(
+      jobs_, pixels.data(), levels,
+      MakeOptions(TextureUsage::kLinear, MipFilter::kKaiser)));
+  for (size_t level = 1; level < levels.size(); ++level) {
+    const uint8_t *mip = pixels.data() + levels[level].offset;
+    const size_t texel_count =
+        static_cast<size_t>(levels[level].width) * levels[level].height;
+    for (size_t i = 0; i < texel_count; ++i) {
+      ASSERT_EQ(mip[i * 4 + 1], 77) << "level " << level;
+      ASSERT_EQ(mip[i * 4 + 2], 0) << "level " << level;
+      ASSERT_EQ(mip[i * 4 + 3], 255) << "level " << level;
+    }
+  }
+}
+
+TEST_F(MipGeneratorTest, ParallelMatchesSerial) {
+  // Large enough that the top levels are split across the pool.
+  std::vector<MipLevel> levels;
+  std::vector<uint8_t> serial = MakeRandomChain(256, 192, 3, levels);
+  std::vector<uint8_t> parallel = serial;
+
+  for (const TextureUsage usage :
+       {TextureUsage::kColor, TextureUsage::kNormalMap}) {
+    ASSERT_TRUE(GenerateMipChain(
+        jobs_, serial.data(), levels,
+        MakeOptions(usage, MipFilter::kKaiser, false)));
+    ASSERT_TRUE(GenerateMipChain(
+        jobs_, parallel.data(), levels,
+        MakeOptions(usage, MipFilter::kKaiser, true)));
+    EXPECT_EQ(serial, parallel);
+  }
+}
+
+TEST_F(MipGeneratorTest, OddSizesKeepFlatImagesFlat) {
+  std::vector<MipLevel> levels;
+  std::vector<uint8_t> pixels(LayoutMipChain(13, 5, levels));
+  for (size_t i = 0; i < 13 * 5 * 4; i += 4) {
+    pixels[i + 0] = 30;
+    pixels[i + 1] = 140;
+    pixels[i + 2] = 220;
+    pixels[i + 3] = 90;
+  }
+
+  for (const MipFilter filter : {MipFilter::kBox, MipFilter::kKaiser}) {
+    ASSERT_TRUE(GenerateMipChain(
+        jobs_, pixels.data(), levels,
+        MakeOptions(TextureUsage::kColor, filter)));
+    for (size_t level = 1; level < levels.size(); ++level) {
+      const uint8_t *mip = pixels.data() + levels[level].offset;
+      const size_t texel_count =
+          static_cast<size_t>(levels[level].width) * levels[level].height;
+      for (size_t i = 0; i < texel_count * 4; i += 4) {
+        ASSERT_EQ(mip[i + 0], 30) << "level " << level;
+        ASSERT_EQ(mip[i + 1], 140) << "level " << level;
+        ASSERT_EQ(mip[i + 2], 220) << "level " << level;
+        ASSERT_EQ(mip[i + 3], 90) << "level " << level;
+      }
+    }
+  }
+}
+
+TEST_F(MipGeneratorTest, RejectsChainsThatDoNotHalve) {
+  std::vector<MipLevel> levels;
+  std::vector<uint8_t> pixels(LayoutMipChain(8, 8, levels));
+  const MipOptions options =
+      MakeOptions(TextureUsage::kLinear, MipFilter::kBox);
+
+  std::vector<MipLevel> skipped = levels;
+  skipped.erase(skipped.begin() + 1);
+  EXPECT_FALSE(GenerateMipChain(jobs_, pixels.data(), skipped, options));
+  EXPECT_FALSE(GenerateMipChain(jobs_, nullptr, levels, options));
+  EXPECT_FALSE(GenerateMipChain(jobs_, pixels.data(), {}, options));
+
+  // A lone level has nothing to generate.
+  EXPECT_TRUE(GenerateMipChain(jobs_, pixels.data(), {levels[0]}, options));
+}
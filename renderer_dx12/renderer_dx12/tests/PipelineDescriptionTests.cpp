@@ -0,0 +1,306 @@
+#include "PipelineDescription.h"
+
+#include <gtest/gtest.h>
+
+#include <cstring>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace {
+
+// Values as D3D12 spells them; the description only stores the integers.
+constexpr uint32_t kFormatR32G32B32Float = 6;
+constexpr uint32_t kFormatR32G32Float = 16;
+constexpr uint32_t kFormatR8G8B8A8Unorm = 28;
+constexpr uint32_t kFormatD24UnormS8Uint = 45;
+constexpr uint32_t kTopologyTriangle = 3;
+constexpr uint32_t kFillSolid = 3;
+constexpr uint32_t kCullBack = 3;
+constexpr uint32_t kComparisonLess = 2;
+constexpr uint32_t kBlendOne = 2;
+constexpr uint32_t kBlendOpAdd = 1;
+
+// Owns everything a description points at, so two instances hold equal
+// contents at different addresses.
+class PipelineFixture {
+public:
+  PipelineFixture()
+      : vertex_shader_{'D', 'X', 'B', 'C', 1, 2, 3, 4},
+        pixel_shader_{'D', 'X', 'B', 'C', 5, 6}, position_name_("POSITION"),
+        texcoord_name_("TEXCOORD") {
+    input_elements_.push_back(
+        {position_name_.c_str(), 0, kFormatR32G32B32Float, 0, 0, 0, 0});
+    input_elements_.push_back(
+        {texcoord_name_.c_str(), 0, kFormatR32G32Float, 0, 12, 0, 0});
+  }
+
+  // Assigns every field one at a time, so whatever the padding held before
+  // is still there afterwards.
+  void Describe(GraphicsPipelineDescription &description) const {
+    description.root_signature = 0x1000;
+    description.vertex_shader.data = vertex_shader_.data();
+    description.vertex_shader.size = vertex_shader_.size();
+    description.pixel_shader.data = pixel_shader_.data();
+    description.pixel_shader.size = pixel_shader_.size();
+    for (PipelineBytecode *unused :
+         {&description.domain_shader, &description.hull_shader,
+          &description.geometry_shader, &description.cached_pipeline}) {
+      unused->data = nullptr;
+      unused->size = 0;
+    }
+
+    description.stream_output.entries = nullptr;
+    description.stream_output.entry_count = 0;
+    description.stream_output.buffer_strides = nullptr;
+    description.stream_output.stride_count = 0;
+    description.stream_output.rasterized_stream = 0;
+
+    description.blend.alpha_to_coverage_enable = 0;
+    description.blend.independent_blend_enable = 0;
+    for (PipelineRenderTargetBlend &target : description.blend.render_targets) {
+      target.blend_enable = 0;
+      target.logic_op_enable = 0;
+      target.src_blend = kBlendOne;
+      target.dest_blend = kBlendOne;
+      target.blend_op = kBlendOpAdd;
+      target.src_blend_alpha = kBlendOne;
+      target.dest_blend_alpha = kBlendOne;
+      target.blend_op_alpha = kBlendOpAdd;
+      target.logic_op = 0;
+      target.write_mask = 0xf;
+    }
+    description.sample_mask = 0xffffffff;
+
+    PipelineRasterizerState &rasterizer = description.rasterizer;
+    rasterizer.fill_mode = kFillSolid;
+    rasterizer.cull_mode = kCullBack;
+    rasterizer.front_counter_clockwise = 0;
+    rasterizer.depth_bias = 0;
+    rasterizer.depth_bias_clamp = 0.0f;
+    rasterizer.slope_scaled_depth_bias = 0.0f;
+    rasterizer.depth_clip_enable = 1;
+    rasterizer.multisample_enable = 0;
+    rasterizer.antialiased_line_enable = 0;
+    rasterizer.forced_sample_count = 0;
+    rasterizer.conservative_raster = 0;
+
+    PipelineDepthStencilState &depth_stencil = description.depth_stencil;
+    depth_stencil.depth_enable = 1;
+    depth_stencil.depth_write_mask = 1;
+    depth_stencil.depth_func = kComparisonLess;
+    depth_stencil.stencil_enable = 0;
+    depth_stencil.stencil_read_mask = 0xff;
+    depth_stencil.stencil_write_mask = 0xff;
+    for (PipelineStencilFace *face :
+         {&depth_stencil.front_face, &depth_stencil.back_face}) {
+      face->fail_op = 1;
+      face->depth_fail_op = 1;
+      face->pass_op = 1;
+      face->func = 8;
+    }
+
+    description.input_elements = input_elements_.data();
+    description.input_element_count =
+        static_cast<uint32_t>(input_elements_.size());
+    description.strip_cut_value = 0;
+    description.primitive_topology_type = kTopologyTriangle;
+    description.render_target_count = 1;
+    for (uint32_t &format : description.render_target_formats) {
+      format = 0;
+    }
+    description.render_target_formats[0] = kFormatR8G8B8A8Unorm;
+    description.depth_stencil_format = kFormatD24UnormS8Uint;
+    description.sample_count = 1;
+    description.sample_quality = 0;
+    description.node_mask = 0;
+    description.flags = 0;
+  }
+
+  auto Describe() const -> GraphicsPipelineDescription {
+    GraphicsPipelineDescription description;
+    Describe(description);
+    return description;
+  }
+
+  std::vector<uint8_t> vertex_shader_;
+  std::vector<uint8_t> pixel_shader_;
+  std::string position_name_;
+  std::string texcoord_name_;
+  std::vector<PipelineInputElement> input_elements_;
+};
+
+auto KeyOf(const GraphicsPipelineDescription &description)
+    -> std::vector<uint8_t> {
+  std::vector<uint8_t> key;
+  CanonicalizePipelineDescription(description, key);
+  return key;
+}
+
+} // namespace
+
+TEST(PipelineDescriptionTest, EqualDescriptionsShareOneKey) {
+  const PipelineFixture first;
+  const PipelineFixture second;
+  ASSERT_NE(first.vertex_shader_.data(), second.vertex_shader_.data());
+
+  const auto key = KeyOf(first.Describe());
+  EXPECT_EQ(key, KeyOf(second.Describe()));
+  EXPECT_EQ(HashPipelineKey(key), HashPipelineKey(KeyOf(second.Describe())));
+
+  // Bucketed the way the cache does it: many materials, one pipeline.
+  std::unordered_map<uint64_t, std::vector<std::vector<uint8_t>>> buckets;
+  size_t unique = 0;
+  for (int i = 0; i < 16; ++i) {
+    const PipelineFixture material;
+    const auto material_key = KeyOf(material.Describe());
+    auto &bucket = buckets[HashPipelineKey(material_key)];
+    bool found = false;
+    for (const auto &entry : bucket) {
+      found = found || entry == material_key;
+    }
+    if (!found) {
+      bucket.push_back(material_key);
+      ++unique;
+    }
+  }
+  EXPECT_EQ(buckets.size(), 1u);
+  EXPECT_EQ(unique, 1u);
+}
+
+TEST(PipelineDescriptionTest, PaddingDoesNotReachTheKey) {
+  const PipelineFixture fixture;
+
+  alignas(GraphicsPipelineDescription) unsigned char
+      zeroed[sizeof(GraphicsPipelineDescription)];
+  alignas(GraphicsPipelineDescription) unsigned char
+      dirty[sizeof(GraphicsPipelineDescription)];
+  memset(zeroed, 0, sizeof(zeroed));
+  memset(dirty, 0xcd, sizeof(dirty));
+
+  // Not constructed in place: the constructor would overwrite the padding.
+  auto *clean_description =
+      reinterpret_cast<GraphicsPipelineDescription *>(zeroed);
+  auto *dirty_description =
+      reinterpret_cast<GraphicsPipelineDescription *>(dirty);
+  fixture.Describe(*clean_description);
+  fixture.Describe(*dirty_description);
+  ASSERT_NE(memcmp(zeroed, dirty, sizeof(zeroed)), 0);
+
+  EXPECT_EQ(KeyOf(*clean_description), KeyOf(*dirty_description));
+
+  // Input elements and stream output entries have padding of their own.
+  PipelineStreamOutputEntry entries[2];
+  memset(static_cast<void *>(&entries[0]), 0, sizeof(entries[0]));
+  memset(static_cast<void *>(&entries[1]), 0xcd, sizeof(entries[1]));
+  for (PipelineStreamOutputEntry &entry : entries) {
+    entry.stream = 0;
+    entry.semantic_name = "SV_Position";
+    entry.semantic_index = 0;
+    entry.start_component = 0;
+    entry.component_count = 4;
+    entry.output_slot = 0;
+  }
+  GraphicsPipelineDescription with_first = fixture.Describe();
+  with_first.stream_output.entries = &entries[0];
+  with_first.stream_output.entry_count = 1;
+  GraphicsPipelineDescription with_second = with_first;
+  with_second.stream_output.entries = &entries[1];
+  EXPECT_EQ(KeyOf(with_first), KeyOf(with_second));
+}
+
+TEST(PipelineDescriptionTest, IgnoredFieldsDoNotChangeTheKey) {
+  const PipelineFixture fixture;
+  const GraphicsPipelineDescription base = fixture.Describe();
+  const auto key = KeyOf(base);
+
+  auto expect_same = [&](const char *what, auto change) {
+    GraphicsPipelineDescription description = base;
+    change(description);
+    EXPECT_EQ(KeyOf(description), key) << what;
+  };
+
+  expect_same("unused render target formats", [](auto &d) {
+    d.render_target_formats[1] = kFormatR8G8B8A8Unorm;
+    d.render_target_formats[7] = 99;
+  });
+  expect_same("blend targets without independent blending", [](auto &d) {
+    d.blend.render_targets[3].blend_enable = 1;
+    d.blend.render_targets[3].write_mask = 0;
+  });
+  expect_same("blend factors with blending off", [](auto &d) {
+    d.blend.render_targets[0].src_blend = 5;
+    d.blend.render_targets[0].blend_op_alpha = 3;
+  });
+  expect_same("logic op with logic ops off",
+              [](auto &d) { d.blend.render_targets[0].logic_op = 4; });
+  expect_same("stencil state with stenciling off", [](auto &d) {
+    d.depth_stencil.stencil_read_mask = 0x0f;
+    d.depth_stencil.front_face.func = 3;
+    d.depth_stencil.back_face.pass_op = 7;
+  });
+  expect_same("rasterized stream without stream output",
+              [](auto &d) { d.stream_output.rasterized_stream = 2; });
+  expect_same("a count without an array",
+              [](auto &d) { d.stream_output.stride_count = 3; });
+
+  // Semantics are compared by name, not by where the string lives.
+  const std::string position = fixture.position_name_;
+  std::vector<PipelineInputElement> elements = fixture.input_elements_;
+  elements[0].semantic_name = position.c_str();
+  expect_same("semantic name storage",
+              [&](auto &d) { d.input_elements = elements.data(); });
+
+  GraphicsPipelineDescription depth_off = base;
+  depth_off.depth_stencil.depth_enable = 0;
+  const auto depth_off_key = KeyOf(depth_off);
+  EXPECT_NE(depth_off_key, key);
+  depth_off.depth_stencil.depth_func = 7;
+  depth_off.depth_stencil.depth_write_mask = 0;
+  EXPECT_EQ(KeyOf(depth_off), depth_off_key);
+}
+
+TEST(PipelineDescriptionTest, FieldsThatMatterChangeTheKey) {
+  const PipelineFixture fixture;
+  const GraphicsPipelineDescription base = fixture.Describe();
+  const auto key = KeyOf(base);
+
+  auto expect_different = [&](const char *what, auto change) {
+    GraphicsPipelineDescription description = base;
+    change(description);
+    EXPECT_NE(KeyOf(description), key) << what;
+  };
+
+  expect_different("root signature",
+                   [](auto &d) { d.root_signature = 0x2000; });
+  expect_different("render target format", [](auto &d) {
+    d.render_target_formats[0] = kFormatR32G32B32Float;
+  });
+  expect_different("render target count", [](auto &d) {
+    d.render_target_count = 2;
+    d.render_target_formats[1] = kFormatR8G8B8A8Unorm;
+  });
+  expect_different("blending",
+                   [](auto &d) { d.blend.render_targets[0].blend_enable = 1; });
+  expect_different("independent blending",
+                   [](auto &d) { d.blend.independent_blend_enable = 1; });
+  expect_different("cull mode", [](auto &d) { d.rasterizer.cull_mode = 1; });
+  expect_different("depth bias", [](auto &d) {
+    d.rasterizer.slope_scaled_depth_bias = 1.0f;
+  });
+  expect_different("depth func",
+                   [](auto &d) { d.depth_stencil.depth_func = 4; });
+  expect_different("sample count", [](auto &d) { d.sample_count = 4; });
+  expect_different("no pixel shader",
+                   [](auto &d) { d.pixel_shader = PipelineBytecode{}; });
+
+  // Shader and layout contents count, not just their sizes.
+  PipelineFixture edited;
+  edited.pixel_shader_.back() ^= 1;
+  EXPECT_NE(KeyOf(edited.Describe()), key);
+
+  PipelineFixture renamed;
+  renamed.texcoord_name_ = "NORMAL__";
+  renamed.input_elements_[1].semantic_name = renamed.texcoord_name_.c_str();
+  EXPECT_NE(KeyOf(renamed.Describe()), key);
+}
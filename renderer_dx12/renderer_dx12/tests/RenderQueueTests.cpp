@@ -0,0 +1,198 @@
+#include "RenderQueue.h"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+
+// Logs every call; draws by their start_index, which the tests use as an
+// id.
+struct LoggingRecorder {
+  std::vector<std::string> calls;
+  std::vector<uint32_t> draws;
+
+  void SetRootSignature(uint32_t id) {
+    calls.push_back("root " + std::to_string(id));
+  }
+  void SetPipelineState(uint32_t id) {
+    calls.push_back("pso " + std::to_string(id));
+  }
+  void BindMaterial(uint32_t id) {
+    calls.push_back("material " + std::to_string(id));
+  }
+  void BindGeometry(uint32_t id) {
+    calls.push_back("geometry " + std::to_string(id));
+  }
+  void Draw(const DrawPacket &packet) {
+    calls.push_back("draw " + std::to_string(packet.start_index));
+    draws.push_back(packet.start_index);
+  }
+};
+
+auto MakePacket(uint32_t id, uint32_t pipeline_state, uint32_t root_signature,
+                uint32_t material, uint32_t geometry = 0) -> DrawPacket {
+  DrawPacket packet;
+  packet.pipeline_state = pipeline_state;
+  packet.root_signature = root_signature;
+  packet.material = material;
+  packet.geometry = geometry;
+  packet.index_count = 36;
+  packet.start_index = id;
+  return packet;
+}
+
+auto ReplayDraws(const RenderQueue &queue, uint32_t pass)
+    -> std::vector<uint32_t> {
+  LoggingRecorder recorder;
+  queue.Replay(pass, recorder);
+  return recorder.draws;
+}
+
+} // namespace
+
+TEST(RenderQueueTest, DepthQuantizationClamps) {
+  EXPECT_EQ(QuantizeDrawDepth(0.0f, 100.0f), 0u);
+  EXPECT_EQ(QuantizeDrawDepth(-5.0f, 100.0f), 0u);
+  EXPECT_EQ(QuantizeDrawDepth(std::nanf(""), 100.0f), 0u);
+  EXPECT_EQ(QuantizeDrawDepth(5.0f, 0.0f), 0u);
+  EXPECT_EQ(QuantizeDrawDepth(100.0f, 100.0f),
+            (1u << kDrawSortDepthBits) - 1);
+  EXPECT_EQ(QuantizeDrawDepth(1e9f, 100.0f), (1u << kDrawSortDepthBits) - 1);
+  EXPECT_LT(QuantizeDrawDepth(10.0f, 100.0f),
+            QuantizeDrawDepth(10.5f, 100.0f));
+}
+
+TEST(RenderQueueTest, OpaqueDrawsAreGroupedThenFrontToBack) {
+  // Two states submitted interleaved and far to near.
+  RenderQueue queue;
+  for (uint32_t i = 0; i < 8; ++i) {
+    const uint32_t material = i % 2 == 0 ? 3 : 7;
+    queue.Submit(0, RenderLayer::kOpaque, 1000 - i * 100,
+                 MakePacket(i, 1, 1, material));
+  }
+  queue.Sort();
+  EXPECT_EQ(ReplayDraws(queue, 0),
+            (std::vector<uint32_t>{6, 4, 2, 0, 7, 5, 3, 1}));
+}
+
+TEST(RenderQueueTest, BlendedDrawsGoBackToFrontAcrossStates) {
+  // State only breaks ties between equal depths.
+  RenderQueue queue;
+  queue.Submit(0, RenderLayer::kBlended, 10, MakePacket(0, 1, 1, 1));
+  queue.Submit(0, RenderLayer::kBlended, 500, MakePacket(1, 9, 1, 1));
+  queue.Submit(0, RenderLayer::kBlended, 250, MakePacket(2, 1, 1, 1));
+  queue.Submit(0, RenderLayer::kBlended, 250, MakePacket(3, 0, 1, 1));
+  queue.Submit(0, RenderLayer::kBlended, (1u << kDrawSortDepthBits) - 1,
+               MakePacket(4, 5, 1, 1));
+  queue.Sort();
+  EXPECT_EQ(ReplayDraws(queue, 0), (std::vector<uint32_t>{4, 1, 3, 2, 0}));
+}
+
+TEST(RenderQueueTest, LayersAndPassesKeepTheirOrder) {
+  RenderQueue queue;
+  // Overlay draws ignore depth and keep submission order.
+  queue.Submit(1, RenderLayer::kOverlay, 900, MakePacket(0, 1, 1, 1));
+  queue.Submit(1, RenderLayer::kBlended, 5, MakePacket(1, 1, 1, 1));
+  queue.Submit(1, RenderLayer::kOverlay, 10, MakePacket(2, 1, 1, 1));
+  queue.Submit(1, RenderLayer::kOpaque, 800, MakePacket(3, 1, 1, 1));
+  queue.Submit(0, RenderLayer::kOverlay, 0, MakePacket(4, 1, 1, 1));
+  queue.Submit(kMaxDrawSortPasses - 1, RenderLayer::kOpaque, 0,
+               MakePacket(5, 1, 1, 1));
+  queue.Sort();
+  EXPECT_EQ(queue.GetPacketCount(), 6u);
+
+  EXPECT_EQ(ReplayDraws(queue, 0), (std::vector<uint32_t>{4}));
+  EXPECT_EQ(ReplayDraws(queue, 1), (std::vector<uint32_t>{3, 1, 0, 2}));
+  EXPECT_TRUE(ReplayDraws(queue, 2).empty());
+  EXPECT_EQ(ReplayDraws(queue, kMaxDrawSortPasses - 1),
+            (std::vector<uint32_t>{5}));
+  EXPECT_TRUE(ReplayDraws(queue, kMaxDrawSortPasses).empty());
+
+  queue.Clear();
+  EXPECT_EQ(queue.GetPacketCount(), 0u);
+  EXPECT_TRUE(ReplayDraws(queue, 1).empty());
+}
+
+TEST(RenderQueueTest, EqualKeysKeepSubmissionOrder) {
+  RenderQueue queue;
+  for (uint32_t i = 0; i < 300; ++i) {
+    // Three keys, interleaved.
+    queue.Submit(0, RenderLayer::kOpaque, 40, MakePacket(i, 1 + i % 3, 1, 1));
+  }
+  queue.Sort();
+  std::vector<uint32_t> expected;
+  for (uint32_t state = 0; state < 3; ++state) {
+    for (uint32_t i = state; i < 300; i += 3) {
+      expected.push_back(i);
+    }
+  }
+  EXPECT_EQ(ReplayDraws(queue, 0), expected);
+}
+
+TEST(RenderQueueTest, RadixSortMatchesAStableSort) {
+  // Few distinct values per byte, so buckets hold long runs of equal keys,
+  // and a shared top byte the sort skips.
+  std::mt19937 random(17);
+  std::vector<DrawSortEntry> entries(5000);
+  for (uint32_t i = 0; i < entries.size(); ++i) {
+    uint64_t key = 0x3Cull << 56;
+    for (int byte = 0; byte < 7; ++byte) {
+      key |= uint64_t{random() % 3} << (byte * 8 + byte % 3);
+    }
+    entries[i].key = key;
+    entries[i].packet = i;
+  }
+  std::vector<DrawSortEntry> expected = entries;
+  std::stable_sort(expected.begin(), expected.end(),
+                   [](const DrawSortEntry &a, const DrawSortEntry &b) {
+                     return a.key < b.key;
+                   });
+
+  std::vector<DrawSortEntry> scratch;
+  RadixSortDrawEntries(entries, scratch);
+  ASSERT_EQ(entries.size(), expected.size());
+  for (size_t i = 0; i < entries.size(); ++i) {
+    ASSERT_EQ(entries[i].key, expected[i].key) << i;
+    ASSERT_EQ(entries[i].packet, expected[i].packet) << i;
+  }
+}
+
+TEST(RenderQueueTest, ReplayBindsOnlyWhatChanges) {
+  // A material id too wide for its key field sorts with material 5, but is
+  // still bound as itself.
+  const uint32_t wide_material = 5 + (1u << kDrawSortMaterialBits);
+  const DrawPacket packets[] = {
+      MakePacket(0, 2, 1, 4, 10), MakePacket(1, 2, 1, 4, 11),
+      MakePacket(2, 2, 1, 4, 11), MakePacket(3, 2, 1, 5, 11),
+      MakePacket(4, 2, 2, 5, 11), MakePacket(5, 3, 2, 5, 11),
+      MakePacket(6, 3, 2, wide_material, 11),
+  };
+  // Submitted last to first; depth keeps equal states in id order.
+  RenderQueue queue;
+  for (uint32_t i = 7; i-- > 0;) {
+    queue.Submit(0, RenderLayer::kOpaque, i, packets[i]);
+  }
+  queue.Sort();
+
+  LoggingRecorder recorder;
+  const RenderQueueStats stats = queue.Replay(0, recorder);
+  // A new root signature clears the root parameters, so draw 4 binds the
+  // unchanged material again.
+  const std::vector<std::string> expected = {
+      "root 1", "pso 2", "material 4", "geometry 10", "draw 0",
+      "geometry 11", "draw 1", "draw 2", "material 5", "draw 3",
+      "root 2", "material 5", "draw 4", "pso 3", "draw 5",
+      "material " + std::to_string(wide_material), "draw 6"};
+  EXPECT_EQ(recorder.calls, expected);
+
+  EXPECT_EQ(stats.draws, 7u);
+  EXPECT_EQ(stats.root_signature_binds, 2u);
+  EXPECT_EQ(stats.pipeline_state_binds, 2u);
+  EXPECT_EQ(stats.material_binds, 4u);
+  EXPECT_EQ(stats.geometry_binds, 2u);
+}
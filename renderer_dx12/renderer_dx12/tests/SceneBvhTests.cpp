@@ -0,0 +1,384 @@
+#include "SceneBvh.h"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <random>
+#include <utility>
+#include <vector>
+
+namespace {
+
+constexpr float kWorldSize = 200.0f;
+
+// A box of 0.5 to 4 units in the kWorldSize cube, with the sphere around it.
+auto MakeRandomBounds(std::mt19937 &random) -> BoundingVolume {
+  std::uniform_real_distribution<float> position(0.0f, kWorldSize);
+  std::uniform_real_distribution<float> extent(0.25f, 2.0f);
+  BoundingVolume bounds;
+  float squared_radius = 0.0f;
+  for (int axis = 0; axis < 3; ++axis) {
+    bounds.center[axis] = position(random);
+    bounds.extents[axis] = extent(random);
+    squared_radius += bounds.extents[axis] * bounds.extents[axis];
+  }
+  bounds.radius = std::sqrt(squared_radius);
+  return bounds;
+}
+
+// A left-handed perspective from eye down +z, 90 degrees each way.
+auto MakeFrustum(float x, float y, float z, float far_plane)
+    -> FrustumPlanes {
+  const float near_plane = 0.1f;
+  const float z_scale = far_plane / (far_plane - near_plane);
+  const float view_projection[16] = {
+      1.0f,  0.0f, 0.0f,                                 0.0f,
+      0.0f,  1.0f, 0.0f,                                 0.0f,
+      0.0f,  0.0f, z_scale,                              1.0f,
+      -x,    -y,   -z * z_scale - near_plane * z_scale, -z};
+  FrustumPlanes frustum;
+  ExtractFrustumPlanes(view_projection, frustum);
+  return frustum;
+}
+
+// Partly in view, the whole world in view, and nothing in view.
+auto MakeFrustums() -> std::vector<FrustumPlanes> {
+  return {MakeFrustum(kWorldSize * 0.3f, kWorldSize * 0.6f, -1.0f, 120.0f),
+          MakeFrustum(kWorldSize * 0.5f, kWorldSize * 0.5f, -kWorldSize,
+                      kWorldSize * 4.0f),
+          MakeFrustum(kWorldSize * 0.5f, kWorldSize * 0.5f, kWorldSize * 2.0f,
+                      kWorldSize)};
+}
+
+// From outside the world into it, and from inside it every way, some along
+// an axis so two direction components are zero.
+auto MakeRays() -> std::vector<Ray> {
+  std::mt19937 random(11);
+  std::uniform_real_distribution<float> position(0.0f, kWorldSize);
+  std::uniform_real_distribution<float> direction(-1.0f, 1.0f);
+  std::vector<Ray> rays(300);
+  for (size_t i = 0; i < rays.size(); ++i) {
+    Ray &ray = rays[i];
+    for (int axis = 0; axis < 3; ++axis) {
+      ray.origin[axis] = position(random);
+      ray.direction[axis] = direction(random);
+    }
+    if (i % 3 == 0) {
+      ray.origin[2] = -10.0f;
+      ray.direction[2] = 1.0f;
+    } else if (i % 3 == 1) {
+      const int axis = static_cast<int>(i % 2);
+      ray.direction[axis] = 0.0f;
+      ray.direction[(axis + 1) % 3] = 0.0f;
+    }
+  }
+  return rays;
+}
+
+// What the tree should hold: every object by id, alive or not.
+struct SceneModel {
+  std::vector<BoundingVolume> bounds;
+  std::vector<bool> alive;
+
+  void Set(uint32_t object, const BoundingVolume &volume) {
+    if (object >= bounds.size()) {
+      bounds.resize(object + 1);
+      alive.resize(object + 1, false);
+    }
+    bounds[object] = volume;
+    alive[object] = true;
+  }
+};
+
+// Entry and exit of the ray through a slab box, the way RayCast sets it up.
+auto IntersectBox(const Ray &ray, const BoundingVolume &bounds, float &entry,
+                  float &exit) -> bool {
+  entry = 0.0f;
+  exit = std::numeric_limits<float>::infinity();
+  for (int axis = 0; axis < 3; ++axis) {
+    const float direction = ray.direction[axis] != 0.0f
+                                ? ray.direction[axis]
+                                : std::numeric_limits<float>::min();
+    const float inverse = 1.0f / direction;
+    float near_distance =
+        (bounds.center[axis] - bounds.extents[axis] - ray.origin[axis]) *
+        inverse;
+    float far_distance =
+        (bounds.center[axis] + bounds.extents[axis] - ray.origin[axis]) *
+        inverse;
+    if (near_distance > far_distance) {
+      std::swap(near_distance, far_distance);
+    }
+    entry = (std::max)(entry, near_distance);
+    exit = (std::min)(exit, far_distance);
+  }
+  return entry <= exit;
+}
+
+auto IntersectSphere(const Ray &ray, const BoundingVolume &bounds,
+                     float &entry, float &exit) -> bool {
+  float a = 0.0f;
+  float b = 0.0f;
+  float c = -bounds.radius * bounds.radius;
+  for (int axis = 0; axis < 3; ++axis) {
+    const float offset = ray.origin[axis] - bounds.center[axis];
+    a += ray.direction[axis] * ray.direction[axis];
+    b += offset * ray.direction[axis];
+    c += offset * offset;
+  }
+  const float discriminant = b * b - a * c;
+  if (a <= 0.0f || discriminant < 0.0f) {
+    return false;
+  }
+  const float root = std::sqrt(discriminant);
+  entry = (std::max)((-b - root) / a, 0.0f);
+  exit = (-b + root) / a;
+  return entry <= exit;
+}
+
+// Tests every live object in the model against each frustum and ray, and
+// expects the tree to agree.
+void ExpectMatchesBruteForce(const SceneBvh &bvh, const SceneModel &model) {
+  size_t live_count = 0;
+  for (const bool alive : model.alive) {
+    live_count += alive ? 1 : 0;
+  }
+  ASSERT_EQ(bvh.GetObjectCount(), live_count);
+
+  for (const FrustumPlanes &frustum : MakeFrustums()) {
+    std::vector<uint32_t> expected;
+    for (uint32_t object = 0; object < model.bounds.size(); ++object) {
+      if (model.alive[object] && IsVisible(frustum, model.bounds[object])) {
+        expected.push_back(object);
+      }
+    }
+    // Appended to, never cleared.
+    std::vector<uint32_t> objects = {SceneBvh::kInvalidObject};
+    bvh.QueryFrustum(frustum, objects);
+    ASSERT_EQ(objects.front(), SceneBvh::kInvalidObject);
+    objects.erase(objects.begin());
+    std::sort(objects.begin(), objects.end());
+    EXPECT_EQ(objects, expected);
+  }
+
+  for (const Ray &ray : MakeRays()) {
+    for (const float max_distance : {3.4e38f, 40.0f}) {
+      RayHit expected;
+      expected.distance = max_distance;
+      for (uint32_t object = 0; object < model.bounds.size(); ++object) {
+        float box_entry = 0.0f;
+        float box_exit = 0.0f;
+        float sphere_entry = 0.0f;
+        float sphere_exit = 0.0f;
+        if (!model.alive[object] ||
+            !IntersectBox(ray, model.bounds[object], box_entry, box_exit) ||
+            !IntersectSphere(ray, model.bounds[object], sphere_entry,
+                             sphere_exit)) {
+          continue;
+        }
+        const float entry = (std::max)(box_entry, sphere_entry);
+        if (entry <= (std::min)(box_exit, sphere_exit) &&
+            entry < expected.distance) {
+          expected.object = object;
+          expected.distance = entry;
+        }
+      }
+
+      RayHit hit;
+      const bool found = bvh.RayCast(ray, hit, max_distance);
+      ASSERT_EQ(found, expected.object != SceneBvh::kInvalidObject);
+      EXPECT_EQ(hit.distance, expected.distance);
+      // Either of two objects entered at the same distance will do.
+      if (hit.object != expected.object) {
+        ASSERT_NE(hit.object, SceneBvh::kInvalidObject);
+        float entry = 0.0f;
+        float exit = 0.0f;
+        ASSERT_TRUE(
+            IntersectBox(ray, model.bounds[hit.object], entry, exit));
+        EXPECT_LE(entry, hit.distance);
+      }
+    }
+  }
+}
+
+class SceneBvhTest : public ::testing::Test {
+protected:
+  SceneBvhTest() : random_(5) {
+    for (uint32_t i = 0; i < 2000; ++i) {
+      const BoundingVolume bounds = MakeRandomBounds(random_);
+      model_.Set(bvh_.Insert(bounds), bounds);
+    }
+    bvh_.Build();
+  }
+
+  void Move(uint32_t object, const BoundingVolume &bounds) {
+    bvh_.SetBounds(object, bounds);
+    model_.bounds[object] = bounds;
+  }
+
+  std::mt19937 random_;
+  SceneModel model_;
+  SceneBvh bvh_;
+};
+
+} // namespace
+
+TEST(SceneBvhEmptyTest, EmptyTreesFindNothing) {
+  SceneBvh bvh;
+  bvh.Build();
+  EXPECT_EQ(bvh.GetNodeCount(), 0u);
+  EXPECT_FALSE(bvh.NeedsRebuild());
+
+  std::vector<uint32_t> objects;
+  bvh.QueryFrustum(MakeFrustums()[1], objects);
+  EXPECT_TRUE(objects.empty());
+  RayHit hit;
+  EXPECT_FALSE(bvh.RayCast(MakeRays()[0], hit));
+  EXPECT_EQ(hit.object, SceneBvh::kInvalidObject);
+}
+
+TEST_F(SceneBvhTest, BuiltTreesMatchBruteForce) {
+  EXPECT_GT(bvh_.GetNodeCount(), 2000u / SceneBvh::kMaxLeafSize);
+  ExpectMatchesBruteForce(bvh_, model_);
+
+  // Objects stacked on one point leave no split to find.
+  SceneBvh stacked;
+  SceneModel stacked_model;
+  const BoundingVolume bounds = model_.bounds[0];
+  for (int i = 0; i < 50; ++i) {
+    stacked_model.Set(stacked.Insert(bounds), bounds);
+  }
+  stacked.Build();
+  ExpectMatchesBruteForce(stacked, stacked_model);
+}
+
+TEST_F(SceneBvhTest, WholeSubtreesInViewAreTakenOnce) {
+  // Every object is inside the second frustum, so the root is taken whole
+  // and each object must appear exactly once.
+  std::vector<uint32_t> objects;
+  bvh_.QueryFrustum(MakeFrustums()[1], objects);
+  std::sort(objects.begin(), objects.end());
+  ASSERT_EQ(objects.size(), 2000u);
+  for (uint32_t i = 0; i < objects.size(); ++i) {
+    ASSERT_EQ(objects[i], i);
+  }
+
+  // Objects that left the view since Build must not ride along with the
+  // subtrees they left, once Refit has run, and those that entered it must
+  // be found.
+  const FrustumPlanes frustum = MakeFrustums()[0];
+  for (uint32_t object = 0; object < 2000; object += 97) {
+    BoundingVolume bounds = model_.bounds[object];
+    const bool was_visible = IsVisible(frustum, bounds);
+    bounds.center[0] = was_visible ? 190.0f : 60.0f;
+    bounds.center[1] = 120.0f;
+    bounds.center[2] = was_visible ? 10.0f : 60.0f;
+    Move(object, bounds);
+    ASSERT_NE(IsVisible(frustum, bounds), was_visible);
+  }
+  bvh_.Refit();
+  ExpectMatchesBruteForce(bvh_, model_);
+}
+
+TEST_F(SceneBvhTest, PartialRefitMatchesBruteForce) {
+  // Few enough movers that only their paths are refit. Small nudges leave
+  // most ancestors unchanged, which stops the walk up early; shrinking
+  // boxes must still tighten their leaves.
+  std::uniform_real_distribution<float> nudge(-1.0f, 1.0f);
+  for (int frame = 0; frame < 20; ++frame) {
+    for (int i = 0; i < 30; ++i) {
+      const uint32_t object = random_() % 2000;
+      BoundingVolume bounds = model_.bounds[object];
+      for (float &center : bounds.center) {
+        center += nudge(random_);
+      }
+      if (i % 5 == 0) {
+        for (float &extent : bounds.extents) {
+          extent *= 0.5f;
+        }
+        bounds.radius *= 0.5f;
+      }
+      Move(object, bounds);
+    }
+    bvh_.Refit();
+    ASSERT_NO_FATAL_FAILURE(ExpectMatchesBruteForce(bvh_, model_))
+        << "frame " << frame;
+  }
+  EXPECT_FALSE(bvh_.NeedsRebuild());
+
+  // One object crossing the world grows every box up to the root.
+  BoundingVolume far_away = model_.bounds[7];
+  far_away.center[0] = kWorldSize * 3.0f;
+  Move(7, far_away);
+  bvh_.Refit();
+  ExpectMatchesBruteForce(bvh_, model_);
+}
+
+TEST_F(SceneBvhTest, SweepRefitMatchesBruteForce) {
+  // Every other object moves, far more than the partial walk takes.
+  for (uint32_t object = 0; object < 2000; object += 2) {
+    Move(object, MakeRandomBounds(random_));
+  }
+  bvh_.Refit();
+  ExpectMatchesBruteForce(bvh_, model_);
+  // Scattering half the scene loosens the tree well past what Build left.
+  EXPECT_TRUE(bvh_.NeedsRebuild());
+
+  bvh_.Build();
+  EXPECT_FALSE(bvh_.NeedsRebuild());
+  ExpectMatchesBruteForce(bvh_, model_);
+}
+
+TEST_F(SceneBvhTest, InsertAndRemoveTakeEffectAtRefit) {
+  for (uint32_t object = 3; object < 2000; object += 7) {
+    bvh_.Remove(object);
+    model_.alive[object] = false;
+  }
+  // Removing twice or out of range is harmless.
+  bvh_.Remove(3);
+  bvh_.Remove(5000);
+  for (int i = 0; i < 40; ++i) {
+    const BoundingVolume bounds = MakeRandomBounds(random_);
+    model_.Set(bvh_.Insert(bounds), bounds);
+  }
+  // Moves since the last Build are folded into the rebuild.
+  Move(1, MakeRandomBounds(random_));
+  bvh_.Refit();
+  ExpectMatchesBruteForce(bvh_, model_);
+}
+
+TEST_F(SceneBvhTest, RemovedIdsAreReused) {
+  const uint32_t removed[] = {10, 500, 1999};
+  for (const uint32_t object : removed) {
+    bvh_.Remove(object);
+    model_.alive[object] = false;
+  }
+  // SetBounds on a removed object is ignored.
+  bvh_.SetBounds(500, MakeRandomBounds(random_));
+
+  std::vector<uint32_t> reused;
+  for (int i = 0; i < 4; ++i) {
+    const BoundingVolume bounds = MakeRandomBounds(random_);
+    const uint32_t object = bvh_.Insert(bounds);
+    model_.Set(object, bounds);
+    reused.push_back(object);
+    EXPECT_EQ(bvh_.GetBounds(object).center[0], bounds.center[0]);
+  }
+  std::sort(reused.begin(), reused.end());
+  EXPECT_EQ(reused, (std::vector<uint32_t>{10, 500, 1999, 2000}));
+  bvh_.Refit();
+  ExpectMatchesBruteForce(bvh_, model_);
+
+  // Reused ids move like any other.
+  for (const uint32_t object : reused) {
+    Move(object, MakeRandomBounds(random_));
+  }
+  bvh_.Refit();
+  ExpectMatchesBruteForce(bvh_, model_);
+
+  bvh_.Clear();
+  EXPECT_EQ(bvh_.GetObjectCount(), 0u);
+  EXPECT_EQ(bvh_.Insert(model_.bounds[0]), 0u);
+}
@@ -0,0 +1,228 @@
+#include "ShaderCache.h"
+
+#include <gtest/gtest.h>
+
+#include <string>
+#include <vector>
+
+#include "AssetRegistry.h"
+#include "FakeFileSource.h"
+
+using namespace ResourceLoader;
+
+namespace {
+
+const wchar_t kCacheDirectory[] = L"shader/cache";
+
+class ShaderCacheTest : public ::testing::Test {
+protected:
+  void SetUp() override {
+    files_.SetFile(L"shader/light.hlsl",
+                   "#include \"common.hlsli\"\n"
+                   "  #  include \"lighting/brdf.hlsli\" // comment\n"
+                   "#include <system.hlsli>\n"
+                   "float4 PS() : SV_Target { return 1; }\n");
+    files_.SetFile(L"shader/common.hlsli",
+                   "#include \"lighting/brdf.hlsli\"\n");
+    files_.SetFile(L"shader/lighting/brdf.hlsli",
+                   "#include \"../common.hlsli\"\nfloat D() { return 1; }\n");
+  }
+
+  auto MakeEntry(const std::string &key) -> ShaderCacheEntry {
+    ShaderCacheEntry entry;
+    entry.shader_key = key;
+    entry.compile_flags = 0x11;
+    EXPECT_TRUE(CollectShaderDependencies(files_, L"shader/light.hlsl",
+                                          entry.dependencies));
+    entry.bytecode = {0x44, 0x58, 0x42, 0x43, 1, 2, 3};
+    entry.reflection.instruction_count = 42;
+    entry.reflection.constant_buffer_count = 1;
+    entry.reflection.bindings.push_back({"MatrixBuffer", 0, 0, 1, 0});
+    entry.reflection.inputs.push_back({"POSITION", 0, 0, 3, 7});
+    return entry;
+  }
+
+  FakeFileSource files_;
+};
+
+} // namespace
+
+TEST(ShaderCacheKeyTest, CachePathIsStableAcrossRuns) {
+  // The path is the file name on disk, so it must not depend on the process,
+  // the platform or the width of wchar_t. HashAssetContent is xxHash64.
+  EXPECT_EQ(GetShaderCachePath(L"cache", "shader/light.hlsl|PS|ps_5_1", 0),
+            L"cache/33d5df28d94e7314.shc");
+  EXPECT_EQ(HashAssetContent(reinterpret_cast<const uint8_t *>("abc"), 3),
+            0x44bc2cf5ad770999ull);
+
+  const auto base = GetShaderCachePath(L"cache/", "key", 1);
+  EXPECT_EQ(base, GetShaderCachePath(L"cache", "key", 1));
+  EXPECT_NE(base, GetShaderCachePath(L"cache", "key", 2));
+  EXPECT_NE(base, GetShaderCachePath(L"cache", "key2", 1));
+}
+
+TEST(ShaderCacheKeyTest, ScansQuotedIncludesOnce) {
+  const std::string source = "#include \"a.hlsli\"\n"
+                             "\t#include \"b.hlsli\"\r\n"
+                             "#include <c.hlsli>\n"
+                             "// #include \"d.hlsli\"\n"
+                             "#include \"a.hlsli\"\n"
+                             "#includex \"e.hlsli\"\n";
+  const auto includes = ScanShaderIncludes(
+      reinterpret_cast<const uint8_t *>(source.data()), source.size());
+  EXPECT_EQ(includes, (std::vector<std::string>{"a.hlsli", "b.hlsli"}));
+}
+
+TEST_F(ShaderCacheTest, CollectsIncludesTransitivelyWithoutCycles) {
+  std::vector<ShaderDependency> dependencies;
+  ASSERT_TRUE(CollectShaderDependencies(files_, L"shader/light.hlsl",
+                                        dependencies));
+  ASSERT_EQ(dependencies.size(), 3u);
+  EXPECT_EQ(dependencies[0].path, L"shader/light.hlsl");
+  EXPECT_EQ(dependencies[1].path, L"shader/common.hlsli");
+  EXPECT_EQ(dependencies[2].path, L"shader/lighting/brdf.hlsli");
+  for (const auto &dependency : dependencies) {
+    EXPECT_NE(dependency.content_hash, 0u);
+  }
+
+  EXPECT_FALSE(
+      CollectShaderDependencies(files_, L"shader/missing.hlsl", dependencies));
+}
+
+TEST_F(ShaderCacheTest, StoredEntryLoadsBack) {
+  ShaderCache cache(files_, kCacheDirectory);
+  const ShaderCacheEntry stored = MakeEntry("light|PS|ps_5_1");
+  ASSERT_TRUE(cache.Store(stored));
+
+  ShaderCacheEntry loaded;
+  ASSERT_TRUE(cache.Load("light|PS|ps_5_1", 0x11, loaded));
+  EXPECT_EQ(loaded.bytecode, stored.bytecode);
+  EXPECT_EQ(loaded.dependencies.size(), 3u);
+  EXPECT_EQ(loaded.reflection.instruction_count, 42u);
+  ASSERT_EQ(loaded.reflection.bindings.size(), 1u);
+  EXPECT_EQ(loaded.reflection.bindings[0].name, "MatrixBuffer");
+  ASSERT_EQ(loaded.reflection.inputs.size(), 1u);
+  EXPECT_EQ(loaded.reflection.inputs[0].semantic_name, "POSITION");
+  EXPECT_EQ(loaded.reflection.inputs[0].mask, 7u);
+
+  // Other flags are another entry.
+  EXPECT_FALSE(cache.Load("light|PS|ps_5_1", 0x10, loaded));
+}
+
+TEST_F(ShaderCacheTest, EditingAnIncludeInvalidatesTheEntry) {
+  ShaderCache cache(files_, kCacheDirectory);
+  ASSERT_TRUE(cache.Store(MakeEntry("light")));
+
+  ShaderCacheEntry loaded;
+  ASSERT_TRUE(cache.Load("light", 0x11, loaded));
+
+  // Rewriting the same bytes keeps it: only the contents count.
+  files_.SetFile(L"shader/lighting/brdf.hlsli",
+                 "#include \"../common.hlsli\"\nfloat D() { return 1; }\n");
+  EXPECT_TRUE(cache.Load("light", 0x11, loaded));
+
+  files_.SetFile(L"shader/lighting/brdf.hlsli",
+                 "#include \"../common.hlsli\"\nfloat D() { return 2; }\n");
+  EXPECT_FALSE(cache.Load("light", 0x11, loaded));
+
+  ASSERT_TRUE(cache.Store(MakeEntry("light")));
+  EXPECT_TRUE(cache.Load("light", 0x11, loaded));
+
+  // A deleted include invalidates it as well.
+  files_.RemoveFile(L"shader/common.hlsli");
+  EXPECT_FALSE(cache.Load("light", 0x11, loaded));
+}
+
+TEST_F(ShaderCacheTest, AppearingIncludeInvalidatesTheEntry) {
+  files_.SetFile(L"shader/light.hlsl", "#include \"late.hlsli\"\n");
+  ShaderCache cache(files_, kCacheDirectory);
+  ShaderCacheEntry entry = MakeEntry("late");
+  ASSERT_EQ(entry.dependencies.size(), 2u);
+  EXPECT_EQ(entry.dependencies[1].content_hash, 0u);
+  ASSERT_TRUE(cache.Store(entry));
+
+  ShaderCacheEntry loaded;
+  ASSERT_TRUE(cache.Load("late", 0x11, loaded));
+  files_.SetFile(L"shader/late.hlsli", "float x;\n");
+  EXPECT_FALSE(cache.Load("late", 0x11, loaded));
+}
+
+TEST_F(ShaderCacheTest, RejectsCorruptEntries) {
+  ShaderCache cache(files_, kCacheDirectory);
+  ASSERT_TRUE(cache.Store(MakeEntry("light")));
+  const std::wstring path =
+      GetShaderCachePath(kCacheDirectory, "light", 0x11);
+  const std::vector<uint8_t> image = files_.GetFile(path);
+  ASSERT_FALSE(image.empty());
+
+  ShaderCacheEntry parsed;
+  ASSERT_TRUE(ParseShaderCacheEntry(image.data(), image.size(), parsed));
+
+  // Every truncation fails cleanly.
+  for (size_t size = 0; size < image.size(); ++size) {
+    EXPECT_FALSE(ParseShaderCacheEntry(image.data(), size, parsed)) << size;
+  }
+
+  // Trailing bytes, a wrong magic or version, and an absurd count.
+  auto extended = image;
+  extended.push_back(0);
+  EXPECT_FALSE(ParseShaderCacheEntry(extended.data(), extended.size(), parsed));
+
+  auto bad_magic = image;
+  bad_magic[0] ^= 0xff;
+  EXPECT_FALSE(
+      ParseShaderCacheEntry(bad_magic.data(), bad_magic.size(), parsed));
+
+  auto bad_version = image;
+  bad_version[4] ^= 0xff;
+  EXPECT_FALSE(
+      ParseShaderCacheEntry(bad_version.data(), bad_version.size(), parsed));
+
+  // Magic, version, flags, then the key: the dependency count follows.
+  auto huge_count = image;
+  const size_t count_offset = 12 + 4 + std::string("light").size();
+  huge_count[count_offset + 3] = 0x7f;
+  EXPECT_FALSE(
+      ParseShaderCacheEntry(huge_count.data(), huge_count.size(), parsed));
+
+  // A corrupt file on disk is a miss, not a crash.
+  files_.SetFile(path, bad_magic);
+  ShaderCacheEntry loaded;
+  EXPECT_FALSE(cache.Load("light", 0x11, loaded));
+
+  // An entry whose key does not match the name it was found under, as after
+  // a hash collision, is a miss too.
+  files_.SetFile(path, image);
+  ShaderCacheEntry other = MakeEntry("other");
+  std::vector<uint8_t> other_image;
+  SerializeShaderCacheEntry(other, other_image);
+  files_.SetFile(path, other_image);
+  EXPECT_FALSE(cache.Load("light", 0x11, loaded));
+}
+
+TEST_F(ShaderCacheTest, RefusesEntriesWithoutBytecode) {
+  ShaderCache cache(files_, kCacheDirectory);
+  ShaderCacheEntry entry = MakeEntry("empty");
+  entry.bytecode.clear();
+  EXPECT_FALSE(cache.Store(entry));
+}
+
+TEST(ShaderManifestTest, ParsesEntriesAndComments) {
+  const std::string manifest = "# file entry target\n"
+                               "\n"
+                               "shader/light.hlsl  LightPixelShader ps_5_1\r\n"
+                               "shader/pbr.hlsl PbrVertexShader vs_5_1 # pbr\n";
+  std::vector<ShaderManifestEntry> entries;
+  ASSERT_TRUE(ParseShaderManifest(
+      reinterpret_cast<const uint8_t *>(manifest.data()), manifest.size(),
+      entries));
+  ASSERT_EQ(entries.size(), 2u);
+  EXPECT_EQ(entries[0].file_path, L"shader/light.hlsl");
+  EXPECT_EQ(entries[0].entry_point, "LightPixelShader");
+  EXPECT_EQ(entries[1].target, "vs_5_1");
+
+  const std::string broken = "shader/light.hlsl LightPixelShader\n";
+  EXPECT_FALSE(ParseShaderManifest(
+      reinterpret_cast<const uint8_t *>(broken.data()), broken.size(),
+      entries));
+}
@@ -0,0 +1,238 @@
+#include "TangentGenerator.h"
+
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <cstddef>
+#include <vector>
+
+#include "MeshFile.h"
+
+using namespace ResourceLoader;
+
+namespace {
+
+constexpr float kTolerance = 1e-4f;
+
+struct Frame {
+  float tangent[3];
+  float w;
+  float normal[3];
+};
+
+auto Dot(const float a[3], const float b[3]) -> float {
+  return a[0] * b[0] + a[1] * b[1] + a[2] * b[2];
+}
+
+// The bitangent a shader rebuilds: cross(normal, tangent) * w.
+void RebuildBitangent(const Frame &frame, float bitangent[3]) {
+  const float *n = frame.normal;
+  const float *t = frame.tangent;
+  bitangent[0] = (n[1] * t[2] - n[2] * t[1]) * frame.w;
+  bitangent[1] = (n[2] * t[0] - n[0] * t[2]) * frame.w;
+  bitangent[2] = (n[0] * t[1] - n[1] * t[0]) * frame.w;
+}
+
+auto Generate(const std::vector<MeshSourceVertex> &vertices,
+              const std::vector<uint32_t> &indices) -> std::vector<Frame> {
+  TangentGenerator generator;
+  EXPECT_TRUE(generator.SetSourceVertices(
+      vertices.data(), static_cast<uint32_t>(vertices.size()),
+      sizeof(MeshSourceVertex)));
+  EXPECT_TRUE(generator.Generate(indices.data(), indices.size()));
+
+  std::vector<Frame> frames(vertices.size());
+  for (size_t i = 0; i < frames.size(); ++i) {
+    frames[i].tangent[0] = generator.GetTangentX()[i];
+    frames[i].tangent[1] = generator.GetTangentY()[i];
+    frames[i].tangent[2] = generator.GetTangentZ()[i];
+    frames[i].w = generator.GetHandedness()[i];
+    const float length = sqrtf(vertices[i].nx * vertices[i].nx +
+                               vertices[i].ny * vertices[i].ny +
+                               vertices[i].nz * vertices[i].nz);
+    frames[i].normal[0] = vertices[i].nx / length;
+    frames[i].normal[1] = vertices[i].ny / length;
+    frames[i].normal[2] = vertices[i].nz / length;
+  }
+  return frames;
+}
+
+void ExpectOrthonormal(const std::vector<Frame> &frames) {
+  for (size_t i = 0; i < frames.size(); ++i) {
+    SCOPED_TRACE(i);
+    EXPECT_NEAR(Dot(frames[i].tangent, frames[i].tangent), 1.0f, kTolerance);
+    EXPECT_NEAR(Dot(frames[i].tangent, frames[i].normal), 0.0f, kTolerance);
+    EXPECT_TRUE(frames[i].w == 1.0f || frames[i].w == -1.0f);
+  }
+}
+
+// Two unit quads facing +z, side by side. The right one reuses the left
+// one's texels mirrored in u, as a symmetric model's UV layout does, so its
+// seam vertices are split. v runs down the texture, as in the data/ meshes.
+void BuildMirroredQuads(std::vector<MeshSourceVertex> &vertices,
+                        std::vector<uint32_t> &indices) {
+  vertices.clear();
+  indices.clear();
+  for (int quad = 0; quad < 2; ++quad) {
+    const uint32_t base = static_cast<uint32_t>(vertices.size());
+    for (int corner = 0; corner < 4; ++corner) {
+      const float x = static_cast<float>(quad + (corner & 1));
+      const float y = static_cast<float>(corner >> 1);
+      const float u = quad == 0 ? x : 2.0f - x;
+      vertices.push_back({x, y, 0.0f, u, 1.0f - y, 0.0f, 0.0f, 1.0f});
+    }
+    for (uint32_t index : {0u, 2u, 1u, 1u, 2u, 3u}) {
+      indices.push_back(base + index);
+    }
+  }
+}
+
+} // namespace
+
+TEST(TangentGeneratorTest, MirroredUvsFlipHandedness) {
+  std::vector<MeshSourceVertex> vertices;
+  std::vector<uint32_t> indices;
+  BuildMirroredQuads(vertices, indices);
+  const std::vector<Frame> frames = Generate(vertices, indices);
+  ExpectOrthonormal(frames);
+
+  for (size_t i = 0; i < frames.size(); ++i) {
+    SCOPED_TRACE(i);
+    const bool mirrored = i >= 4;
+    // The tangent follows +u, which runs the other way on the mirrored half.
+    EXPECT_NEAR(frames[i].tangent[0], mirrored ? -1.0f : 1.0f, kTolerance);
+    EXPECT_EQ(frames[i].w, frames[0].w * (mirrored ? -1.0f : 1.0f));
+
+    // Either way the rebuilt bitangent follows +v, which is -y on both.
+    float bitangent[3];
+    RebuildBitangent(frames[i], bitangent);
+    EXPECT_NEAR(bitangent[0], 0.0f, kTolerance);
+    EXPECT_NEAR(bitangent[1], -1.0f, kTolerance);
+    EXPECT_NEAR(bitangent[2], 0.0f, kTolerance);
+  }
+}
+
+TEST(TangentGeneratorTest, VectorLanesMatchTheScalarRemainder) {
+  // Five copies of one skewed triangle: the first four faces and vertices
+  // go through the four-wide path, the rest through the scalar one.
+  std::vector<MeshSourceVertex> vertices;
+  std::vector<uint32_t> indices;
+  for (int copy = 0; copy < 5; ++copy) {
+    const float offset = 3.0f * static_cast<float>(copy);
+    vertices.push_back({offset, 0.0f, 0.0f, 0.1f, 0.9f, 0.2f, 0.1f, 1.0f});
+    vertices.push_back({offset + 1.5f, 0.2f, 0.3f, 0.8f, 0.7f, 0.1f, 0.3f,
+                        1.0f});
+    vertices.push_back({offset + 0.4f, 1.1f, -0.2f, 0.3f, 0.1f, -0.2f, 0.2f,
+                        1.0f});
+    for (uint32_t corner = 0; corner < 3; ++corner) {
+      indices.push_back(static_cast<uint32_t>(copy) * 3 + corner);
+    }
+  }
+  const std::vector<Frame> frames = Generate(vertices, indices);
+  ExpectOrthonormal(frames);
+
+  for (size_t copy = 1; copy < 5; ++copy) {
+    for (size_t corner = 0; corner < 3; ++corner) {
+      const Frame &expected = frames[corner];
+      const Frame &actual = frames[copy * 3 + corner];
+      SCOPED_TRACE(copy * 3 + corner);
+      for (int axis = 0; axis < 3; ++axis) {
+        EXPECT_NEAR(actual.tangent[axis], expected.tangent[axis], kTolerance);
+      }
+      EXPECT_EQ(actual.w, expected.w);
+    }
+  }
+}
+
+TEST(TangentGeneratorTest, MissingUvsStillGiveAFrame) {
+  std::vector<MeshSourceVertex> vertices;
+  std::vector<uint32_t> indices;
+  BuildMirroredQuads(vertices, indices);
+  for (MeshSourceVertex &vertex : vertices) {
+    vertex.tu = 0.0f;
+    vertex.tv = 0.0f;
+  }
+  // One normal along x, where the fallback has to pick another axis.
+  vertices[0].nx = 1.0f;
+  vertices[0].nz = 0.0f;
+  ExpectOrthonormal(Generate(vertices, indices));
+}
+
+TEST(TangentGeneratorTest, LargeMeshesMatchAcrossThreads) {
+  // A curved grid large enough to be split across the job system. Every
+  // vertex sees the same UV orientation, so the handedness is uniform.
+  constexpr int kSide = 100;
+  std::vector<MeshSourceVertex> vertices;
+  std::vector<uint32_t> indices;
+  for (int row = 0; row <= kSide; ++row) {
+    for (int column = 0; column <= kSide; ++column) {
+      const float x = static_cast<float>(column) / kSide;
+      const float y = static_cast<float>(row) / kSide;
+      const float z = 0.2f * sinf(6.0f * x);
+      const float slope = 1.2f * cosf(6.0f * x);
+      vertices.push_back({x, y, z, x, 1.0f - y, -slope, 0.0f, 1.0f});
+    }
+  }
+  for (int row = 0; row < kSide; ++row) {
+    for (int column = 0; column < kSide; ++column) {
+      const uint32_t corner = row * (kSide + 1) + column;
+      for (uint32_t index :
+           {corner, corner + kSide + 1, corner + 1, corner + 1,
+            corner + kSide + 1, corner + kSide + 2}) {
+        indices.push_back(index);
+      }
+    }
+  }
+  ASSERT_GE(indices.size() / 3, TangentGenerator::kParallelTriangleThreshold);
+
+  const std::vector<Frame> frames = Generate(vertices, indices);
+  ExpectOrthonormal(frames);
+  for (size_t i = 0; i < frames.size(); ++i) {
+    // +u runs along the surface in +x.
+    EXPECT_GT(frames[i].tangent[0], 0.5f) << i;
+    EXPECT_EQ(frames[i].w, frames[0].w) << i;
+  }
+}
+
+TEST(TangentGeneratorTest, StoresIntoInterleavedVertices) {
+  struct Vertex {
+    MeshSourceVertex source;
+    float tangent[4];
+  };
+
+  std::vector<MeshSourceVertex> sources;
+  std::vector<uint32_t> indices;
+  BuildMirroredQuads(sources, indices);
+  std::vector<Vertex> vertices(sources.size());
+  for (size_t i = 0; i < sources.size(); ++i) {
+    vertices[i].source = sources[i];
+  }
+
+  TangentGenerator generator;
+  ASSERT_TRUE(generator.SetSourceVertices(
+      vertices.data(), static_cast<uint32_t>(vertices.size()), sizeof(Vertex)));
+  ASSERT_TRUE(generator.Generate(indices.data(), indices.size()));
+  generator.StoreTangents(vertices.data(), sizeof(Vertex),
+                          offsetof(Vertex, tangent));
+  for (size_t i = 0; i < vertices.size(); ++i) {
+    EXPECT_EQ(vertices[i].tangent[0], generator.GetTangentX()[i]);
+    EXPECT_EQ(vertices[i].tangent[3], generator.GetHandedness()[i]);
+    EXPECT_EQ(vertices[i].source.nz, 1.0f);
+  }
+}
+
+TEST(TangentGeneratorTest, RejectsBadInput) {
+  std::vector<MeshSourceVertex> vertices;
+  std::vector<uint32_t> indices;
+  BuildMirroredQuads(vertices, indices);
+
+  TangentGenerator generator;
+  EXPECT_FALSE(generator.Generate(indices.data(), indices.size()));
+  EXPECT_FALSE(generator.SetSourceVertices(vertices.data(), 8, 16));
+  EXPECT_FALSE(generator.SetSourceVertices(nullptr, 8, 32));
+  ASSERT_TRUE(generator.SetSourceVertices(vertices.data(), 8, 32));
+
+  indices[4] = 8;
+  EXPECT_FALSE(generator.Generate(indices.data(), indices.size()));
+  EXPECT_FALSE(generator.Generate(indices.data(), 2));
+}
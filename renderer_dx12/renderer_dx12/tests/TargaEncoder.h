@@ -0,0 +1,80 @@
+#pragma once
+
+// Writes true-color .tga images for the TargaFile tests and benchmark.
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+namespace TargaEncoder {
+
+constexpr size_t kHeaderBytes = 18;
+constexpr uint8_t kTopDownBit = 0x20;
+
+// Runs of equal pixels become run packets, everything else raw packets.
+// Packets take up to 128 pixels wherever they fall, so most of them run on
+// into the next row.
+inline void EncodeRle(const uint8_t *pixels, size_t pixel_count,
+                      size_t pixel_size, std::vector<uint8_t> &output) {
+  auto same = [pixels, pixel_size](size_t a, size_t b) {
+    return memcmp(pixels + a * pixel_size, pixels + b * pixel_size,
+                  pixel_size) == 0;
+  };
+
+  size_t i = 0;
+  while (i < pixel_count) {
+    size_t run = 1;
+    while (i + run < pixel_count && run < 128 && same(i, i + run)) {
+      ++run;
+    }
+    if (run > 1) {
+      output.push_back(static_cast<uint8_t>(0x80 | (run - 1)));
+      output.insert(output.end(), pixels + i * pixel_size,
+                    pixels + (i + 1) * pixel_size);
+      i += run;
+      continue;
+    }
+    size_t raw = 1;
+    while (i + raw < pixel_count && raw < 128 &&
+           (i + raw + 1 >= pixel_count || !same(i + raw, i + raw + 1))) {
+      ++raw;
+    }
+    output.push_back(static_cast<uint8_t>(raw - 1));
+    output.insert(output.end(), pixels + i * pixel_size,
+                  pixels + (i + raw) * pixel_size);
+    i += raw;
+  }
+}
+
+// An image of width x height BGRA pixels, taken in the order they are to be
+// stored: bottom row first unless top_down. A 24-bit image drops alpha.
+inline auto EncodeImage(const uint8_t *bgra, uint32_t width, uint32_t height,
+                        uint32_t bytes_per_pixel, bool rle, bool top_down)
+    -> std::vector<uint8_t> {
+  std::vector<uint8_t> image(kHeaderBytes, 0);
+  image[2] = rle ? 10 : 2;
+  image[12] = static_cast<uint8_t>(width);
+  image[13] = static_cast<uint8_t>(width >> 8);
+  image[14] = static_cast<uint8_t>(height);
+  image[15] = static_cast<uint8_t>(height >> 8);
+  image[16] = static_cast<uint8_t>(bytes_per_pixel * 8);
+  // Alpha bits, then the row order.
+  image[17] = static_cast<uint8_t>((bytes_per_pixel == 4 ? 8 : 0) |
+                                   (top_down ? kTopDownBit : 0));
+
+  const size_t pixel_count = static_cast<size_t>(width) * height;
+  std::vector<uint8_t> pixels;
+  pixels.reserve(pixel_count * bytes_per_pixel);
+  for (size_t i = 0; i < pixel_count; ++i) {
+    pixels.insert(pixels.end(), bgra + i * 4, bgra + i * 4 + bytes_per_pixel);
+  }
+  if (rle) {
+    EncodeRle(pixels.data(), pixel_count, bytes_per_pixel, image);
+  } else {
+    image.insert(image.end(), pixels.begin(), pixels.end());
+  }
+  return image;
+}
+
+} // namespace TargaEncoder
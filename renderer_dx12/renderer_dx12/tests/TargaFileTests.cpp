@@ -0,0 +1,269 @@
+#include "TargaFile.h"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+#include "TargaEncoder.h"
+
+using namespace ResourceLoader;
+using namespace TargaEncoder;
+
+namespace {
+
+// BGRA pixels in file order, bottom row first.
+struct Pixels {
+  std::vector<uint8_t> bgra;
+  uint32_t width = 0;
+  uint32_t height = 0;
+};
+
+struct Variant {
+  uint32_t bytes_per_pixel;
+  bool rle;
+  bool top_down;
+};
+
+constexpr Variant kVariants[] = {
+    {4, false, false}, {4, false, true}, {3, false, false}, {3, false, true},
+    {4, true, false},  {4, true, true},  {3, true, false},  {3, true, true},
+};
+
+auto ReadFile(const char *name) -> std::vector<uint8_t> {
+  std::ifstream file(std::filesystem::path(RENDERER_DATA_DIR) / name,
+                     std::ios::binary);
+  return std::vector<uint8_t>(std::istreambuf_iterator<char>(file),
+                              std::istreambuf_iterator<char>());
+}
+
+// The shipped 32-bit, bottom-up albedo has no id or color map, so its
+// pixels follow the header.
+auto ReadAlbedo() -> Pixels {
+  const std::vector<uint8_t> file = ReadFile("pbr/pbr_albedo.tga");
+  Pixels pixels;
+  if (file.size() < kHeaderBytes || file[16] != 32) {
+    return pixels;
+  }
+  pixels.width = file[12] | file[13] << 8;
+  pixels.height = file[14] | file[15] << 8;
+  const size_t size = static_cast<size_t>(pixels.width) * pixels.height * 4;
+  if (kHeaderBytes + size > file.size()) {
+    return {};
+  }
+  pixels.bgra.assign(file.begin() + kHeaderBytes,
+                     file.begin() + kHeaderBytes + size);
+  return pixels;
+}
+
+// The first width columns of the first height rows.
+auto Crop(const Pixels &source, uint32_t width, uint32_t height) -> Pixels {
+  Pixels pixels;
+  pixels.width = width;
+  pixels.height = height;
+  pixels.bgra.resize(size_t{width} * height * 4);
+  for (uint32_t y = 0; y < height; ++y) {
+    std::copy_n(source.bgra.data() + size_t{y} * source.width * 4,
+                size_t{width} * 4,
+                pixels.bgra.data() + size_t{y} * width * 4);
+  }
+  return pixels;
+}
+
+// Runs of 37 and raw stretches of 23 pixels over 5-pixel rows, so both
+// kinds of packet start mid-row and end several rows later.
+auto MakeRunsAcrossRows(const Pixels &source) -> Pixels {
+  Pixels pixels = Crop(source, 5, 60);
+  for (size_t i = 0; i < pixels.bgra.size() / 4; ++i) {
+    if (i % 60 < 37) {
+      const uint8_t color[4] = {static_cast<uint8_t>(i / 60), 80, 160, 240};
+      std::copy(color, color + 4, pixels.bgra.begin() + i * 4);
+    }
+  }
+  return pixels;
+}
+
+auto Encode(const Pixels &pixels, const Variant &variant)
+    -> std::vector<uint8_t> {
+  return EncodeImage(pixels.bgra.data(), pixels.width, pixels.height,
+                     variant.bytes_per_pixel, variant.rle, variant.top_down);
+}
+
+// One byte at a time: RGBA, top row first, opaque when there is no alpha.
+auto DecodeScalar(const Pixels &pixels, const Variant &variant)
+    -> std::vector<uint8_t> {
+  std::vector<uint8_t> texels(pixels.bgra.size());
+  for (uint32_t y = 0; y < pixels.height; ++y) {
+    const uint32_t row = variant.top_down ? y : pixels.height - 1 - y;
+    const uint8_t *source = pixels.bgra.data() + size_t{y} * pixels.width * 4;
+    uint8_t *destination = texels.data() + size_t{row} * pixels.width * 4;
+    for (uint32_t x = 0; x < pixels.width * 4; x += 4) {
+      destination[x + 0] = source[x + 2];
+      destination[x + 1] = source[x + 1];
+      destination[x + 2] = source[x + 0];
+      destination[x + 3] = variant.bytes_per_pixel == 4 ? source[x + 3] : 255;
+    }
+  }
+  return texels;
+}
+
+// Decodes into rows padded by extra bytes, then strips the padding; fails
+// the test if the padding was written. The image is passed by copy, which
+// holds it exactly, so ASan sees a load past its end.
+auto Decode(const std::vector<uint8_t> image, size_t padding = 0)
+    -> std::vector<uint8_t> {
+  TargaInfo info;
+  EXPECT_TRUE(ReadTargaHeader(image.data(), image.size(), info));
+  const size_t row_bytes = static_cast<size_t>(info.width) * 4;
+  const size_t row_pitch = row_bytes + padding;
+  std::vector<uint8_t> destination(row_pitch * info.height, 0xcd);
+  EXPECT_TRUE(DecodeTargaImage(image.data(), image.size(), info,
+                               destination.data(), row_pitch));
+
+  std::vector<uint8_t> texels;
+  for (uint32_t y = 0; y < info.height; ++y) {
+    const auto row = destination.begin() + y * row_pitch;
+    texels.insert(texels.end(), row, row + row_bytes);
+    for (auto it = row + row_bytes; it != row + row_pitch; ++it) {
+      EXPECT_EQ(*it, 0xcd) << "padding of row " << y;
+    }
+  }
+  return texels;
+}
+
+auto Describe(const Variant &variant) -> std::string {
+  return std::to_string(variant.bytes_per_pixel * 8) + "-bit" +
+         (variant.rle ? " RLE" : "") + (variant.top_down ? " top-down" : "");
+}
+
+} // namespace
+
+TEST(TargaFileTest, ShippedAlbedoMatchesTheScalarDecode) {
+  const std::vector<uint8_t> file = ReadFile("pbr/pbr_albedo.tga");
+  TargaInfo info;
+  ASSERT_TRUE(ReadTargaHeader(file.data(), file.size(), info));
+  EXPECT_EQ(info.bytes_per_pixel, 4u);
+  EXPECT_FALSE(info.is_rle);
+  EXPECT_FALSE(info.is_top_down);
+  EXPECT_EQ(info.pixel_offset, kHeaderBytes);
+
+  const Pixels pixels = ReadAlbedo();
+  ASSERT_FALSE(pixels.bgra.empty());
+  EXPECT_EQ(Decode(file), DecodeScalar(pixels, kVariants[0]));
+}
+
+TEST(TargaFileTest, ReencodedAlbedoMatchesTheScalarDecode) {
+  const Pixels pixels = ReadAlbedo();
+  ASSERT_FALSE(pixels.bgra.empty());
+  for (const Variant &variant : kVariants) {
+    const std::vector<uint8_t> image = Encode(pixels, variant);
+    TargaInfo info;
+    ASSERT_TRUE(ReadTargaHeader(image.data(), image.size(), info));
+    EXPECT_EQ(info.bytes_per_pixel, variant.bytes_per_pixel);
+    EXPECT_EQ(info.is_rle, variant.rle);
+    EXPECT_EQ(info.is_top_down, variant.top_down);
+    EXPECT_EQ(Decode(image), DecodeScalar(pixels, variant))
+        << Describe(variant);
+  }
+}
+
+TEST(TargaFileTest, OddWidthsMatchTheScalarDecode) {
+  // Around each SIMD loop's tail: 4 and 6 pixels for SSSE3, 8 and 11 for
+  // AVX2, with the rest left to the narrower paths.
+  const Pixels albedo = ReadAlbedo();
+  ASSERT_FALSE(albedo.bgra.empty());
+  for (const uint32_t width : {1u, 2u, 3u, 4u, 5u, 6u, 7u, 8u, 10u, 11u, 12u,
+                               13u, 16u, 19u, 21u, 35u}) {
+    const Pixels pixels = Crop(albedo, width, 7);
+    for (const Variant &variant : kVariants) {
+      EXPECT_EQ(Decode(Encode(pixels, variant), 12),
+                DecodeScalar(pixels, variant))
+          << Describe(variant) << ", " << width << " wide";
+    }
+  }
+}
+
+TEST(TargaFileTest, RlePacketsSpanRows) {
+  const Pixels albedo = ReadAlbedo();
+  ASSERT_FALSE(albedo.bgra.empty());
+  const Pixels pixels = MakeRunsAcrossRows(albedo);
+  for (const Variant &variant : kVariants) {
+    if (variant.rle) {
+      EXPECT_EQ(Decode(Encode(pixels, variant)),
+                DecodeScalar(pixels, variant))
+          << Describe(variant);
+    }
+  }
+}
+
+TEST(TargaFileTest, TruncatedImagesFailCleanly) {
+  // Every prefix, copied so that reading past its end is a heap overflow
+  // under ASan. Noise ends in raw packets; the runs image cuts through runs.
+  const Pixels albedo = ReadAlbedo();
+  ASSERT_FALSE(albedo.bgra.empty());
+  for (const Pixels &pixels :
+       {Crop(albedo, 13, 9), MakeRunsAcrossRows(albedo)}) {
+    for (const Variant &variant : kVariants) {
+      const std::vector<uint8_t> image = Encode(pixels, variant);
+      std::vector<uint8_t> destination(pixels.bgra.size());
+      for (size_t size = 0; size < image.size(); ++size) {
+        const std::vector<uint8_t> prefix(image.begin(),
+                                          image.begin() + size);
+        TargaInfo info;
+        if (!ReadTargaHeader(prefix.data(), prefix.size(), info)) {
+          ASSERT_LT(size, kHeaderBytes) << Describe(variant);
+          continue;
+        }
+        ASSERT_FALSE(DecodeTargaImage(prefix.data(), prefix.size(), info,
+                                      destination.data(), pixels.width * 4))
+            << Describe(variant) << ", " << size << " bytes";
+      }
+    }
+  }
+}
+
+TEST(TargaFileTest, RejectsUnsupportedHeaders) {
+  const Pixels albedo = ReadAlbedo();
+  ASSERT_FALSE(albedo.bgra.empty());
+  const Pixels pixels = Crop(albedo, 4, 4);
+  const std::vector<uint8_t> valid = Encode(pixels, kVariants[0]);
+  TargaInfo info;
+  ASSERT_TRUE(ReadTargaHeader(valid.data(), valid.size(), info));
+
+  auto color_mapped = valid;
+  color_mapped[2] = 1;
+  EXPECT_FALSE(ReadTargaHeader(color_mapped.data(), color_mapped.size(),
+                               info));
+
+  auto sixteen_bit = valid;
+  sixteen_bit[16] = 16;
+  EXPECT_FALSE(ReadTargaHeader(sixteen_bit.data(), sixteen_bit.size(), info));
+
+  auto right_to_left = valid;
+  right_to_left[17] |= 0x10;
+  EXPECT_FALSE(
+      ReadTargaHeader(right_to_left.data(), right_to_left.size(), info));
+
+  auto no_width = valid;
+  no_width[12] = 0;
+  EXPECT_FALSE(ReadTargaHeader(no_width.data(), no_width.size(), info));
+
+  // A color map running past the end of the file.
+  auto long_color_map = valid;
+  long_color_map[1] = 1;
+  long_color_map[6] = 0xff;
+  long_color_map[7] = 24;
+  EXPECT_FALSE(
+      ReadTargaHeader(long_color_map.data(), long_color_map.size(), info));
+
+  ASSERT_TRUE(ReadTargaHeader(valid.data(), valid.size(), info));
+  std::vector<uint8_t> destination(4 * 4 * 4);
+  EXPECT_FALSE(DecodeTargaImage(valid.data(), valid.size(), info,
+                                destination.data(), 4 * 4 - 1));
+  EXPECT_FALSE(DecodeTargaImage(valid.data(), valid.size(), info, nullptr,
+                                4 * 4));
+}
@@ -0,0 +1,412 @@
+#include "UploadContext.h"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+using namespace ResourceLoader;
+
+namespace {
+
+// Stands in for a committed texture; tests pass its address as the
+// ID3D12Resource.
+struct FakeTexture {
+  uint32_t width = 0;
+  uint32_t height = 0;
+  uint32_t bytes_per_pixel = 4;
+};
+
+auto AsResource(void *object) -> ID3D12Resource * {
+  return reinterpret_cast<ID3D12Resource *>(object);
+}
+
+struct RecordedCopy {
+  UploadToken batch = kInvalidUploadToken;
+  StagingBufferId staging = 0;
+  uint64_t staging_offset = 0;
+  uint64_t size = 0;
+};
+
+// Records every call and lets the test decide when the "GPU" finishes.
+// WaitForValue completes the fence up to the requested value.
+class MockUploadDevice : public UploadDevice {
+public:
+  auto CreateStagingBuffer(uint64_t size, uint8_t *&mapped_data)
+      -> StagingBufferId override {
+    const StagingBufferId id = next_staging_++;
+    buffers_[id].resize(static_cast<size_t>(size));
+    mapped_data = buffers_[id].data();
+    return id;
+  }
+
+  void ReleaseStagingBuffer(StagingBufferId staging) override {
+    buffers_.erase(staging);
+    released.push_back(staging);
+  }
+
+  auto GetTextureFootprints(ID3D12Resource *destination,
+                            uint32_t first_subresource,
+                            uint32_t subresource_count,
+                            UploadTextureFootprint *footprints,
+                            uint64_t &total_bytes) -> bool override {
+    const auto *texture = reinterpret_cast<const FakeTexture *>(destination);
+    uint64_t offset = 0;
+    for (uint32_t i = 0; i < subresource_count; ++i) {
+      const uint32_t level = first_subresource + i;
+      auto &footprint = footprints[i];
+      footprint.offset = offset;
+      footprint.width = std::max(texture->width >> level, 1u);
+      footprint.height = std::max(texture->height >> level, 1u);
+      footprint.depth = 1;
+      footprint.row_bytes =
+          static_cast<uint64_t>(footprint.width) * texture->bytes_per_pixel;
+      footprint.row_pitch =
+          static_cast<uint32_t>((footprint.row_bytes + 255) / 256 * 256);
+      footprint.row_count = footprint.height;
+      offset += (static_cast<uint64_t>(footprint.row_pitch) *
+                     footprint.row_count +
+                 kTexturePlacementAlignment - 1) /
+                kTexturePlacementAlignment * kTexturePlacementAlignment;
+    }
+    total_bytes = offset;
+    return true;
+  }
+
+  auto BeginBatch() -> bool override {
+    EXPECT_FALSE(batch_open_);
+    batch_open_ = true;
+    return true;
+  }
+
+  void CopyBufferRegion(ID3D12Resource *, uint64_t, StagingBufferId staging,
+                        uint64_t staging_offset, uint64_t size) override {
+    EXPECT_TRUE(batch_open_);
+    open_copies_.push_back({kInvalidUploadToken, staging, staging_offset,
+                            size});
+  }
+
+  void CopyTextureRegion(ID3D12Resource *, uint32_t, StagingBufferId staging,
+                         const UploadTextureFootprint &footprint) override {
+    EXPECT_TRUE(batch_open_);
+    open_copies_.push_back(
+        {kInvalidUploadToken, staging, footprint.offset,
+         static_cast<uint64_t>(footprint.row_pitch) * footprint.row_count});
+  }
+
+  auto SubmitBatch(UploadToken fence_value) -> bool override {
+    EXPECT_TRUE(batch_open_);
+    batch_open_ = false;
+    if (fail_next_submit) {
+      fail_next_submit = false;
+      open_copies_.clear();
+      return false;
+    }
+    EXPECT_GT(fence_value, last_signaled);
+    last_signaled = fence_value;
+    submitted.push_back(fence_value);
+    for (auto &copy : open_copies_) {
+      copy.batch = fence_value;
+      copies.push_back(copy);
+    }
+    open_copies_.clear();
+    return true;
+  }
+
+  auto GetCompletedValue() -> UploadToken override { return completed; }
+
+  auto WaitForValue(UploadToken fence_value) -> bool override {
+    EXPECT_LE(fence_value, last_signaled);
+    completed = std::max(completed, fence_value);
+    ++waits;
+    return true;
+  }
+
+  void ReportError(const wchar_t *message) override {
+    errors.emplace_back(message);
+  }
+
+  auto GetStagingData(StagingBufferId staging) -> const uint8_t * {
+    return buffers_.at(staging).data();
+  }
+
+  auto IsStagingAlive(StagingBufferId staging) const -> bool {
+    return buffers_.count(staging) != 0;
+  }
+
+  UploadToken completed = kInvalidUploadToken;
+  UploadToken last_signaled = kInvalidUploadToken;
+  bool fail_next_submit = false;
+  uint32_t waits = 0;
+  std::vector<UploadToken> submitted;
+  std::vector<RecordedCopy> copies;
+  std::vector<StagingBufferId> released;
+  std::vector<std::wstring> errors;
+
+private:
+  StagingBufferId next_staging_ = 1;
+  bool batch_open_ = false;
+  std::vector<RecordedCopy> open_copies_;
+  std::map<StagingBufferId, std::vector<uint8_t>> buffers_;
+};
+
+class UploadContextTest : public ::testing::Test {
+protected:
+  void SetUp() override { Create(4096); }
+
+  void Create(uint64_t ring_size) {
+    auto device = std::make_unique<MockUploadDevice>();
+    device_ = device.get();
+    context_ = std::make_unique<UploadContext>(std::move(device));
+    ASSERT_TRUE(context_->Initialize(ring_size));
+    ring_id_ = 1;
+  }
+
+  auto Upload(uint64_t size, uint8_t fill = 0xab) -> UploadToken {
+    std::vector<uint8_t> data(static_cast<size_t>(size), fill);
+    return context_->UploadBuffer(AsResource(&destination_), 0, data.data(),
+                                  size);
+  }
+
+  int destination_ = 0;
+  MockUploadDevice *device_ = nullptr;
+  std::unique_ptr<UploadContext> context_;
+  StagingBufferId ring_id_ = 0;
+};
+
+} // namespace
+
+TEST(UploadRingTest, AlignsAndWrapsToTheStart) {
+  UploadRing ring;
+  ring.Reset(1024);
+
+  uint64_t offset = 0;
+  ASSERT_TRUE(ring.Allocate(100, 16, offset));
+  EXPECT_EQ(offset, 0u);
+  ASSERT_TRUE(ring.Allocate(100, 256, offset));
+  EXPECT_EQ(offset, 256u);
+  ASSERT_TRUE(ring.Allocate(500, 16, offset));
+  EXPECT_EQ(offset, 368u);
+  EXPECT_EQ(ring.TakeConsumed(), 868u);
+
+  // 156 bytes left at the end: a 200-byte request must wait for the front.
+  EXPECT_FALSE(ring.Allocate(200, 16, offset));
+  ring.Release(356);
+  ASSERT_TRUE(ring.Allocate(200, 16, offset));
+  EXPECT_EQ(offset, 0u);
+  // The skipped tail counts as consumed so it is released with the batch.
+  EXPECT_EQ(ring.TakeConsumed(), 156u + 200u);
+  EXPECT_EQ(ring.GetUsed(), 868u);
+}
+
+TEST(UploadRingTest, RewindHandsBackTheNewestBytes) {
+  UploadRing ring;
+  ring.Reset(1024);
+
+  uint64_t offset = 0;
+  ASSERT_TRUE(ring.Allocate(600, 16, offset));
+  ring.TakeConsumed();
+  ASSERT_TRUE(ring.Allocate(300, 16, offset));
+  EXPECT_EQ(offset, 608u);
+  ring.Rewind(ring.TakeConsumed());
+  EXPECT_EQ(ring.GetUsed(), 600u);
+
+  ASSERT_TRUE(ring.Allocate(300, 16, offset));
+  EXPECT_EQ(offset, 608u);
+}
+
+TEST(UploadRingTest, RejectsRequestsLargerThanTheRing) {
+  UploadRing ring;
+  ring.Reset(1024);
+
+  uint64_t offset = 0;
+  EXPECT_FALSE(ring.Allocate(1025, 16, offset));
+  EXPECT_FALSE(ring.Allocate(0, 16, offset));
+  EXPECT_TRUE(ring.Allocate(1024, 16, offset));
+  EXPECT_FALSE(ring.Allocate(1, 1, offset));
+}
+
+TEST_F(UploadContextTest, UploadsShareOneBatchUntilFlush) {
+  const UploadToken first = Upload(100, 1);
+  const UploadToken second = Upload(200, 2);
+  EXPECT_NE(first, kInvalidUploadToken);
+  EXPECT_EQ(first, second);
+  EXPECT_TRUE(device_->submitted.empty());
+
+  EXPECT_EQ(context_->Flush(), first);
+  ASSERT_EQ(device_->submitted.size(), 1u);
+  ASSERT_EQ(device_->copies.size(), 2u);
+
+  const auto &copy = device_->copies[1];
+  const uint8_t *staged =
+      device_->GetStagingData(copy.staging) + copy.staging_offset;
+  EXPECT_EQ(copy.size, 200u);
+  EXPECT_EQ(staged[0], 2);
+  EXPECT_EQ(staged[199], 2);
+  EXPECT_EQ(copy.staging_offset % kBufferPlacementAlignment, 0u);
+
+  // A flush with nothing recorded submits nothing.
+  EXPECT_EQ(context_->Flush(), first);
+  EXPECT_EQ(device_->submitted.size(), 1u);
+}
+
+TEST_F(UploadContextTest, TokensRetireInFenceOrder) {
+  const UploadToken first = Upload(1000);
+  context_->Flush();
+  const UploadToken second = Upload(1000);
+  context_->Flush();
+  EXPECT_LT(first, second);
+
+  EXPECT_FALSE(context_->IsComplete(first));
+  EXPECT_FALSE(context_->IsComplete(second));
+
+  device_->completed = first;
+  EXPECT_TRUE(context_->IsComplete(first));
+  EXPECT_FALSE(context_->IsComplete(second));
+
+  EXPECT_TRUE(context_->Wait(second));
+  EXPECT_TRUE(context_->IsComplete(second));
+  EXPECT_TRUE(context_->IsComplete(kInvalidUploadToken));
+  EXPECT_EQ(context_->GetLastSubmittedToken(), second);
+}
+
+TEST_F(UploadContextTest, WaitFlushesTheOpenBatch) {
+  const UploadToken token = Upload(64);
+  EXPECT_TRUE(context_->Wait(token));
+  EXPECT_EQ(device_->submitted.size(), 1u);
+  EXPECT_TRUE(context_->IsComplete(token));
+}
+
+TEST_F(UploadContextTest, RingWrapsOnceEarlierBatchesRetire) {
+  // 4096-byte ring: three 1200-byte uploads fit, the fourth wraps to 0 and
+  // must wait until the batch holding the front of the ring retires.
+  std::vector<UploadToken> tokens;
+  for (int i = 0; i < 3; ++i) {
+    tokens.push_back(Upload(1200, static_cast<uint8_t>(i)));
+    context_->Flush();
+  }
+  EXPECT_EQ(device_->waits, 0u);
+
+  const UploadToken wrapped = Upload(1200, 3);
+  EXPECT_EQ(context_->GetStats().ring_stalls, 1u);
+  EXPECT_EQ(device_->completed, tokens[0]);
+  EXPECT_TRUE(context_->IsComplete(tokens[0]));
+  EXPECT_FALSE(context_->IsComplete(tokens[1]));
+
+  context_->Flush();
+  const auto &copy = device_->copies.back();
+  EXPECT_EQ(copy.batch, wrapped);
+  EXPECT_EQ(copy.staging_offset, 0u);
+  EXPECT_EQ(device_->GetStagingData(copy.staging)[0], 3);
+
+  // Retiring out of turn is impossible: completing the fence up to the last
+  // token retires everything before it as well.
+  device_->completed = wrapped;
+  EXPECT_TRUE(context_->IsComplete(tokens[2]));
+  EXPECT_TRUE(context_->WaitIdle());
+}
+
+TEST_F(UploadContextTest, FullRingSubmitsTheOpenBatch) {
+  // The open batch is limited by the ring: once it holds the whole ring,
+  // the next upload goes out with it and waits for it.
+  const UploadToken first = Upload(2048);
+  const UploadToken same = Upload(2048);
+  EXPECT_EQ(first, same);
+  EXPECT_TRUE(device_->submitted.empty());
+
+  const UploadToken next = Upload(16);
+  ASSERT_EQ(device_->submitted.size(), 1u);
+  EXPECT_EQ(device_->submitted[0], first);
+  EXPECT_GT(next, first);
+  EXPECT_TRUE(context_->IsComplete(first));
+  EXPECT_EQ(context_->GetStats().ring_stalls, 1u);
+}
+
+TEST_F(UploadContextTest, OversizedUploadsGetADedicatedBuffer) {
+  const UploadToken token = Upload(10000, 7);
+  context_->Flush();
+  ASSERT_EQ(device_->copies.size(), 1u);
+
+  const StagingBufferId dedicated = device_->copies[0].staging;
+  EXPECT_NE(dedicated, ring_id_);
+  EXPECT_EQ(context_->GetStats().dedicated_buffers, 1u);
+  EXPECT_EQ(device_->GetStagingData(dedicated)[9999], 7);
+
+  // Released only once the fence has passed the batch.
+  EXPECT_FALSE(context_->IsComplete(token));
+  EXPECT_TRUE(device_->IsStagingAlive(dedicated));
+  device_->completed = token;
+  EXPECT_TRUE(context_->IsComplete(token));
+  EXPECT_FALSE(device_->IsStagingAlive(dedicated));
+}
+
+TEST_F(UploadContextTest, TexturesUsePlacedFootprints) {
+  FakeTexture texture = {16, 8, 4};
+  std::vector<uint8_t> level0(16 * 8 * 4, 0x11);
+  std::vector<uint8_t> level1(8 * 4 * 4, 0x22);
+  UploadSubresourceData subresources[2] = {
+      {level0.data(), 16 * 4, 16 * 8 * 4}, {level1.data(), 8 * 4, 8 * 4 * 4}};
+
+  Upload(100);
+  const UploadToken token = context_->UploadTexture(AsResource(&texture), 0, 2,
+                                                    subresources);
+  context_->Flush();
+  ASSERT_EQ(device_->copies.size(), 3u);
+
+  const auto &mip0 = device_->copies[1];
+  const auto &mip1 = device_->copies[2];
+  EXPECT_EQ(mip0.batch, token);
+  EXPECT_EQ(mip0.staging_offset % kTexturePlacementAlignment, 0u);
+  EXPECT_EQ(mip1.staging_offset % kTexturePlacementAlignment, 0u);
+
+  // Rows land at the 256-byte pitch, not the tight source pitch.
+  const uint8_t *staged = device_->GetStagingData(mip0.staging);
+  EXPECT_EQ(staged[mip0.staging_offset + 256 * 7 + 63], 0x11);
+  EXPECT_EQ(staged[mip1.staging_offset + 256 * 3 + 31], 0x22);
+}
+
+TEST_F(UploadContextTest, FailedSubmitPoisonsItsToken) {
+  const UploadToken failed = Upload(1000);
+  device_->fail_next_submit = true;
+  EXPECT_EQ(context_->Flush(), kInvalidUploadToken);
+  ASSERT_EQ(device_->errors.size(), 1u);
+  EXPECT_NE(device_->errors[0].find(L"[UploadContext]"), std::wstring::npos);
+  EXPECT_EQ(context_->GetStats().failed_batches, 1u);
+
+  // The next batch signals a new value, so completing it does not make the
+  // failed upload look finished.
+  const UploadToken next = Upload(1000);
+  EXPECT_GT(next, failed);
+  EXPECT_EQ(context_->Flush(), next);
+  EXPECT_EQ(device_->submitted.back(), next);
+
+  EXPECT_TRUE(context_->Wait(next));
+  EXPECT_FALSE(context_->Wait(failed));
+  EXPECT_FALSE(context_->IsComplete(failed));
+  EXPECT_TRUE(context_->IsComplete(next));
+
+  // The failed batch's ring space was handed back.
+  EXPECT_EQ(device_->copies.back().staging_offset, 0u);
+}
+
+TEST(UploadContextInitTest, ReportsAStagingRingFailure) {
+  class NoStagingDevice : public MockUploadDevice {
+  public:
+    auto CreateStagingBuffer(uint64_t, uint8_t *&mapped_data)
+        -> StagingBufferId override {
+      mapped_data = nullptr;
+      return 0;
+    }
+  };
+
+  auto device = std::make_unique<NoStagingDevice>();
+  auto *raw = device.get();
+  UploadContext context(std::move(device));
+  EXPECT_FALSE(context.Initialize(4096));
+  ASSERT_EQ(raw->errors.size(), 1u);
+  EXPECT_EQ(context.UploadBuffer(AsResource(raw), 0, raw, 4),
+            kInvalidUploadToken);
+}
@@ -0,0 +1,99 @@
+#include "BlockCompressor.h"
+
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+#include "BlockDecoder.h"
+#include "JobSystem.h"
+#include "TargaFile.h"
+
+using namespace BlockDecoder;
+using namespace ResourceLoader;
+
+namespace {
+
+struct Image {
+  std::vector<uint8_t> pixels;
+  uint32_t width = 0;
+  uint32_t height = 0;
+};
+
+auto LoadImage(const char *name) -> Image {
+  std::ifstream file(std::filesystem::path(RENDERER_DATA_DIR) / name,
+                     std::ios::binary);
+  const std::vector<uint8_t> bytes((std::istreambuf_iterator<char>(file)),
+                                   std::istreambuf_iterator<char>());
+  Image image;
+  TargaInfo info;
+  if (ReadTargaHeader(bytes.data(), bytes.size(), info)) {
+    image.width = info.width;
+    image.height = info.height;
+    image.pixels.resize(size_t{info.width} * info.height * 4);
+    if (!DecodeTargaImage(bytes.data(), bytes.size(), info,
+                          image.pixels.data(), size_t{info.width} * 4)) {
+      image = {};
+    }
+  }
+  return image;
+}
+
+struct Case {
+  const char *image;
+  BlockFormat format;
+  const char *label;
+};
+
+// Each shipped PBR texture in the format its role selects, and the albedo
+// also in the cheaper color formats.
+const Case kCases[] = {
+    {"pbr/pbr_albedo.tga", BlockFormat::kBC7, "albedo BC7"},
+    {"pbr/pbr_albedo.tga", BlockFormat::kBC1, "albedo BC1"},
+    {"pbr/pbr_albedo.tga", BlockFormat::kBC3, "albedo BC3"},
+    {"pbr/pbr_normal.tga", BlockFormat::kBC5, "normal BC5"},
+    {"pbr/pbr_roughmetal.tga", BlockFormat::kBC4, "roughmetal.r BC4"},
+};
+
+const char *const kQualityNames[] = {"fast", "balanced", "high"};
+
+void BM_CompressImage(benchmark::State &state) {
+  const Case &test_case = kCases[state.range(0)];
+  const auto quality = static_cast<CompressionQuality>(state.range(1));
+  const Image image = LoadImage(test_case.image);
+  if (image.pixels.empty()) {
+    state.SkipWithError("cannot load the image");
+    return;
+  }
+
+  std::vector<uint8_t> blocks(
+      GetCompressedSize(image.width, image.height, test_case.format));
+  for (auto _ : state) {
+    CompressImage(JobSystem::Instance(), image.pixels.data(), image.width,
+                  image.height, test_case.format, quality, blocks.data());
+    benchmark::DoNotOptimize(blocks.data());
+  }
+
+  state.SetItemsProcessed(state.iterations() *
+                          static_cast<int64_t>(image.pixels.size() / 4));
+  state.counters["PSNR"] = ComputePsnr(image.pixels, image.width, image.height,
+                                       blocks, test_case.format);
+  state.SetLabel(std::string(test_case.label) + " " +
+                 kQualityNames[state.range(1)]);
+}
+
+} // namespace
+
+// Items are texels; wall-clock time, since large images are compressed on
+// the job system.
+BENCHMARK(BM_CompressImage)
+    ->ArgsProduct({benchmark::CreateDenseRange(0, 4, 1),
+                   benchmark::CreateDenseRange(0, 2, 1)})
+    ->Unit(benchmark::kMillisecond)
+    ->UseRealTime();
@@ -0,0 +1,109 @@
+#include "FrustumCulling.h"
+
+#include <benchmark/benchmark.h>
+
+#include <cmath>
+#include <random>
+#include <vector>
+
+#include "JobSystem.h"
+
+namespace {
+
+constexpr size_t kBoundsCount = 1000000;
+
+// By CullingPath.
+const char *const kPathNames[] = {"auto", "scalar", "sse", "avx"};
+
+// A camera in the middle of a 2000-unit cube looking down +z with a 60
+// degree field of view, so roughly a tenth of the bounds are visible and
+// the rest fail at different planes.
+auto MakeFrustum() -> FrustumPlanes {
+  const float y_scale = 1.7320508f;
+  const float x_scale = y_scale * 9.0f / 16.0f;
+  const float far_plane = 1000.0f;
+  const float z_scale = far_plane / (far_plane - 0.1f);
+  const float view_projection[16] = {x_scale, 0.0f, 0.0f,            0.0f,
+                                     0.0f,    y_scale, 0.0f,         0.0f,
+                                     0.0f,    0.0f, z_scale,         1.0f,
+                                     0.0f,    0.0f, -0.1f * z_scale, 0.0f};
+  FrustumPlanes frustum;
+  ExtractFrustumPlanes(view_projection, frustum);
+  return frustum;
+}
+
+// Boxes of 1 to 8 units, each with the sphere around it. Built once and
+// shared by every benchmark.
+auto GetBounds() -> const CullingBounds & {
+  static CullingBounds bounds;
+  if (bounds.GetCount() > 0) {
+    return bounds;
+  }
+  std::mt19937 random(1000000);
+  std::uniform_real_distribution<float> position(-1000.0f, 1000.0f);
+  std::uniform_real_distribution<float> extent(0.5f, 4.0f);
+  bounds.Reserve(kBoundsCount);
+  for (size_t i = 0; i < kBoundsCount; ++i) {
+    BoundingVolume object;
+    float squared_radius = 0.0f;
+    for (int axis = 0; axis < 3; ++axis) {
+      object.center[axis] = position(random);
+      object.extents[axis] = extent(random);
+      squared_radius += object.extents[axis] * object.extents[axis];
+    }
+    object.radius = std::sqrt(squared_radius);
+    bounds.Add(object);
+  }
+  return bounds;
+}
+
+auto GetPool() -> JobSystem & {
+  static JobSystem pool;
+  return pool;
+}
+
+// range(0) is the CullingPath.
+void BM_CullBounds(benchmark::State &state) {
+  const auto path = static_cast<CullingPath>(state.range(0));
+  if (path == CullingPath::kAvx && !IsAvxCullingSupported()) {
+    state.SkipWithError("AVX is not supported here");
+    return;
+  }
+  const CullingBounds &bounds = GetBounds();
+  const FrustumPlanes frustum = MakeFrustum();
+  std::vector<uint8_t> visible(bounds.GetCount());
+  size_t visible_count = 0;
+  for (auto _ : state) {
+    visible_count = CullBounds(frustum, bounds, 0, bounds.GetCount(),
+                               visible.data(), path);
+    benchmark::DoNotOptimize(visible.data());
+  }
+  state.SetItemsProcessed(state.iterations() * bounds.GetCount());
+  state.counters["visible"] = static_cast<double>(visible_count);
+  state.SetLabel(kPathNames[state.range(0)]);
+}
+
+// The same cull in chunks on the job system, as Graphics runs it.
+void BM_CullBoundsParallel(benchmark::State &state) {
+  JobSystem &pool = GetPool();
+  const CullingBounds &bounds = GetBounds();
+  const FrustumPlanes frustum = MakeFrustum();
+  std::vector<uint8_t> visible;
+  size_t visible_count = 0;
+  for (auto _ : state) {
+    visible_count = CullBoundsParallel(pool, frustum, bounds, visible);
+    benchmark::DoNotOptimize(visible.data());
+  }
+  state.SetItemsProcessed(state.iterations() * bounds.GetCount());
+  state.counters["visible"] = static_cast<double>(visible_count);
+  state.counters["threads"] = pool.GetConcurrency();
+}
+
+} // namespace
+
+BENCHMARK(BM_CullBounds)
+    ->Arg(static_cast<int>(CullingPath::kScalar))
+    ->Arg(static_cast<int>(CullingPath::kSse))
+    ->Arg(static_cast<int>(CullingPath::kAvx))
+    ->Unit(benchmark::kMicrosecond);
+BENCHMARK(BM_CullBoundsParallel)->UseRealTime()->Unit(benchmark::kMicrosecond);
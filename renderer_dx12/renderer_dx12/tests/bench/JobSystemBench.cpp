@@ -0,0 +1,111 @@
+#include "JobSystem.h"
+
+#include <benchmark/benchmark.h>
+
+#include <atomic>
+#include <cmath>
+#include <vector>
+
+namespace {
+
+// Enough arithmetic per element that scheduling is not the whole story.
+auto Work(size_t i) -> float {
+  float value = static_cast<float>(i);
+  for (int k = 0; k < 16; ++k) {
+    value = sqrtf(value * 1.0001f + 1.0f);
+  }
+  return value;
+}
+
+auto GetPool() -> JobSystem & {
+  static JobSystem pool;
+  return pool;
+}
+
+void BM_SerialLoop(benchmark::State &state) {
+  std::vector<float> output(static_cast<size_t>(state.range(0)));
+  for (auto _ : state) {
+    for (size_t i = 0; i < output.size(); ++i) {
+      output[i] = Work(i);
+    }
+    benchmark::DoNotOptimize(output.data());
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+// range(1) is the grain size; 0 splits adaptively.
+void BM_ParallelFor(benchmark::State &state) {
+  JobSystem &pool = GetPool();
+  std::vector<float> output(static_cast<size_t>(state.range(0)));
+  const size_t grain_size = static_cast<size_t>(state.range(1));
+  for (auto _ : state) {
+    pool.ParallelFor(output.size(), grain_size,
+                     [&output](size_t begin, size_t end) {
+                       for (size_t i = begin; i < end; ++i) {
+                         output[i] = Work(i);
+                       }
+                     });
+    benchmark::DoNotOptimize(output.data());
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+  state.counters["threads"] = pool.GetConcurrency();
+}
+
+// Submits range(0) empty jobs against one counter and waits: the per-job
+// cost of the queues themselves.
+void BM_FanOut(benchmark::State &state) {
+  JobSystem &pool = GetPool();
+  std::atomic<size_t> runs{0};
+  for (auto _ : state) {
+    JobCounter counter;
+    for (int64_t i = 0; i < state.range(0); ++i) {
+      pool.Submit([&runs] { runs.fetch_add(1, std::memory_order_relaxed); },
+                  counter);
+    }
+    pool.Wait(counter);
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+// Jobs that fan out from a worker land in its own deque; the rest of the
+// pool only sees them by stealing.
+void BM_NestedFanOut(benchmark::State &state) {
+  JobSystem &pool = GetPool();
+  const int64_t outer = 16;
+  const int64_t inner = state.range(0) / outer;
+  std::atomic<size_t> runs{0};
+  for (auto _ : state) {
+    JobCounter counter;
+    for (int64_t i = 0; i < outer; ++i) {
+      pool.Submit(
+          [&pool, &runs, inner] {
+            JobCounter children;
+            for (int64_t j = 0; j < inner; ++j) {
+              pool.Submit(
+                  [&runs] { runs.fetch_add(1, std::memory_order_relaxed); },
+                  children);
+            }
+            pool.Wait(children);
+          },
+          counter);
+    }
+    pool.Wait(counter);
+  }
+  state.SetItemsProcessed(state.iterations() * outer * inner);
+}
+
+} // namespace
+
+// Wall-clock time throughout: the CPU time of the calling thread misses the
+// work done by the workers.
+BENCHMARK(BM_SerialLoop)->Arg(1 << 16)->Arg(1 << 20)->UseRealTime();
+BENCHMARK(BM_ParallelFor)
+    ->Args({1 << 16, 0})
+    ->Args({1 << 16, 64})
+    ->Args({1 << 16, 4096})
+    ->Args({1 << 20, 0})
+    ->Args({1 << 20, 64})
+    ->Args({1 << 20, 4096})
+    ->UseRealTime();
+BENCHMARK(BM_FanOut)->Arg(1024)->Arg(16384)->UseRealTime();
+BENCHMARK(BM_NestedFanOut)->Arg(1024)->Arg(16384)->UseRealTime();
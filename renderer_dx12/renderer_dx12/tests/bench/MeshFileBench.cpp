@@ -0,0 +1,116 @@
+#include "MeshFile.h"
+
+#include <benchmark/benchmark.h>
+
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <vector>
+
+using namespace ResourceLoader;
+
+namespace {
+
+const char *const kMeshes[] = {"pbr/sphere.txt", "pbr/plane01.txt"};
+
+auto TextPath(int64_t mesh) -> std::filesystem::path {
+  return std::filesystem::path(RENDERER_DATA_DIR) / kMeshes[mesh];
+}
+
+// Cooked once per process into the temp directory, so the data/ tree stays
+// untouched.
+auto CookedPath(int64_t mesh) -> std::wstring {
+  static std::wstring paths[std::size(kMeshes)];
+  if (paths[mesh].empty()) {
+    const auto path = std::filesystem::temp_directory_path() /
+                      TextPath(mesh).filename().replace_extension(".mesh");
+    paths[mesh] = path.wstring();
+    CookTextMesh(TextPath(mesh).wstring(), paths[mesh]);
+  }
+  return paths[mesh];
+}
+
+// The loop every model class ran before the .mesh cache.
+auto LoadWithStreams(const std::filesystem::path &path,
+                     std::vector<MeshSourceVertex> &vertices) -> bool {
+  std::ifstream fin(path);
+  if (fin.fail()) {
+    return false;
+  }
+
+  char input = ' ';
+  fin.get(input);
+  while (input != ':') {
+    fin.get(input);
+  }
+  uint32_t vertex_count = 0;
+  fin >> vertex_count;
+
+  fin.get(input);
+  while (input != ':') {
+    fin.get(input);
+  }
+  fin.get(input);
+  fin.get(input);
+
+  vertices.resize(vertex_count);
+  for (MeshSourceVertex &vertex : vertices) {
+    fin >> vertex.x >> vertex.y >> vertex.z;
+    fin >> vertex.tu >> vertex.tv;
+    fin >> vertex.nx >> vertex.ny >> vertex.nz;
+  }
+  return !fin.fail();
+}
+
+void BM_LoadTextWithStreams(benchmark::State &state) {
+  const auto path = TextPath(state.range(0));
+  std::vector<MeshSourceVertex> vertices;
+  for (auto _ : state) {
+    if (!LoadWithStreams(path, vertices)) {
+      state.SkipWithError("cannot read the mesh");
+      return;
+    }
+    benchmark::DoNotOptimize(vertices.data());
+  }
+  state.SetLabel(kMeshes[state.range(0)]);
+}
+
+void BM_LoadText(benchmark::State &state) {
+  const auto path = TextPath(state.range(0)).wstring();
+  std::vector<MeshSourceVertex> vertices;
+  for (auto _ : state) {
+    if (!LoadTextMesh(path, vertices)) {
+      state.SkipWithError("cannot read the mesh");
+      return;
+    }
+    benchmark::DoNotOptimize(vertices.data());
+  }
+  state.SetLabel(kMeshes[state.range(0)]);
+}
+
+// Maps the cooked mesh and copies both blobs out, as the upload path does.
+void BM_OpenCookedMesh(benchmark::State &state) {
+  const std::wstring path = CookedPath(state.range(0));
+  std::vector<uint8_t> staging;
+  for (auto _ : state) {
+    MeshFile mesh;
+    if (!mesh.Open(path)) {
+      state.SkipWithError("cannot open the cooked mesh");
+      return;
+    }
+    staging.resize(mesh.GetVertexBytes() + mesh.GetIndexBytes());
+    memcpy(staging.data(), mesh.GetVertexData(), mesh.GetVertexBytes());
+    memcpy(staging.data() + mesh.GetVertexBytes(), mesh.GetIndexData(),
+           mesh.GetIndexBytes());
+    benchmark::DoNotOptimize(staging.data());
+  }
+  state.SetLabel(kMeshes[state.range(0)]);
+}
+
+} // namespace
+
+BENCHMARK(BM_LoadTextWithStreams)->DenseRange(0, 1)->Unit(
+    benchmark::kMicrosecond);
+BENCHMARK(BM_LoadText)->DenseRange(0, 1)->Unit(benchmark::kMicrosecond);
+BENCHMARK(BM_OpenCookedMesh)->DenseRange(0, 1)->Unit(benchmark::kMicrosecond);
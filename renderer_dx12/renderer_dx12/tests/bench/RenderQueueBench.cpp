@@ -0,0 +1,173 @@
+#include "RenderQueue.h"
+
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <random>
+#include <vector>
+
+namespace {
+
+constexpr uint32_t kPassCount = 3;
+
+struct SyntheticDraw {
+  uint32_t pass = 0;
+  RenderLayer layer = RenderLayer::kOpaque;
+  uint32_t depth = 0;
+  DrawPacket packet = {};
+};
+
+// A frame of draw_count draws over three passes: mostly opaque, some
+// blended, a few overlay. Each draw is one of 4096 meshes with one of 512
+// materials, and a material implies its pipeline state (64 in all) and root
+// signature (8), as in a real scene. Submission order is random.
+auto MakeFrame(size_t draw_count) -> std::vector<SyntheticDraw> {
+  std::mt19937 random(2024);
+  std::uniform_int_distribution<uint32_t> pass(0, kPassCount - 1);
+  std::uniform_int_distribution<uint32_t> layer(0, 99);
+  std::uniform_int_distribution<uint32_t> mesh(0, 4095);
+  std::uniform_real_distribution<float> depth(0.0f, 1000.0f);
+
+  std::vector<SyntheticDraw> draws(draw_count);
+  for (SyntheticDraw &draw : draws) {
+    draw.pass = pass(random);
+    const uint32_t roll = layer(random);
+    draw.layer = roll < 85   ? RenderLayer::kOpaque
+                 : roll < 95 ? RenderLayer::kBlended
+                             : RenderLayer::kOverlay;
+    draw.depth = QuantizeDrawDepth(depth(random), 1000.0f);
+    const uint32_t mesh_id = mesh(random);
+    draw.packet.geometry = mesh_id;
+    draw.packet.material = (mesh_id * 2654435761u >> 8) % 512;
+    draw.packet.pipeline_state = draw.packet.material % 64;
+    draw.packet.root_signature = draw.packet.pipeline_state % 8;
+    draw.packet.index_count = 36;
+  }
+  return draws;
+}
+
+auto MakeEntries(const std::vector<SyntheticDraw> &draws)
+    -> std::vector<DrawSortEntry> {
+  std::vector<DrawSortEntry> entries(draws.size());
+  for (size_t i = 0; i < draws.size(); ++i) {
+    entries[i].key = MakeDrawSortKey(draws[i].pass, draws[i].layer,
+                                     draws[i].depth, draws[i].packet);
+    entries[i].packet = static_cast<uint32_t>(i);
+  }
+  return entries;
+}
+
+// Counts calls; the ids go nowhere.
+struct NullRecorder {
+  void SetRootSignature(uint32_t id) { benchmark::DoNotOptimize(id); }
+  void SetPipelineState(uint32_t id) { benchmark::DoNotOptimize(id); }
+  void BindMaterial(uint32_t id) { benchmark::DoNotOptimize(id); }
+  void BindGeometry(uint32_t id) { benchmark::DoNotOptimize(id); }
+  void Draw(const DrawPacket &packet) { benchmark::DoNotOptimize(&packet); }
+};
+
+void SetBindCounters(benchmark::State &state, const RenderQueueStats &stats) {
+  state.counters["pso_binds"] = static_cast<double>(stats.pipeline_state_binds);
+  state.counters["material_binds"] = static_cast<double>(stats.material_binds);
+  state.counters["geometry_binds"] = static_cast<double>(stats.geometry_binds);
+}
+
+void BM_RadixSortDrawEntries(benchmark::State &state) {
+  const auto unsorted = MakeEntries(MakeFrame(state.range(0)));
+  std::vector<DrawSortEntry> entries;
+  std::vector<DrawSortEntry> scratch;
+  for (auto _ : state) {
+    entries = unsorted;
+    RadixSortDrawEntries(entries, scratch);
+    benchmark::DoNotOptimize(entries.data());
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+// The comparison sort the radix sort replaces, stable like it.
+void BM_StableSortDrawEntries(benchmark::State &state) {
+  const auto unsorted = MakeEntries(MakeFrame(state.range(0)));
+  std::vector<DrawSortEntry> entries;
+  for (auto _ : state) {
+    entries = unsorted;
+    std::stable_sort(entries.begin(), entries.end(),
+                     [](const DrawSortEntry &a, const DrawSortEntry &b) {
+                       return a.key < b.key;
+                     });
+    benchmark::DoNotOptimize(entries.data());
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+// A whole frame: submit, sort and replay every pass.
+void BM_SubmitSortReplay(benchmark::State &state) {
+  const auto draws = MakeFrame(state.range(0));
+  RenderQueue queue;
+  NullRecorder recorder;
+  RenderQueueStats total = {};
+  for (auto _ : state) {
+    queue.Clear();
+    for (const SyntheticDraw &draw : draws) {
+      queue.Submit(draw.pass, draw.layer, draw.depth, draw.packet);
+    }
+    queue.Sort();
+    total = {};
+    for (uint32_t pass = 0; pass < kPassCount; ++pass) {
+      const RenderQueueStats stats = queue.Replay(pass, recorder);
+      total.pipeline_state_binds += stats.pipeline_state_binds;
+      total.material_binds += stats.material_binds;
+      total.geometry_binds += stats.geometry_binds;
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+  SetBindCounters(state, total);
+}
+
+// The same draws issued in submission order with the same redundant-bind
+// filter, for the bind counts sorting saves.
+void BM_ReplayInSubmissionOrder(benchmark::State &state) {
+  const auto draws = MakeFrame(state.range(0));
+  NullRecorder recorder;
+  RenderQueueStats total = {};
+  for (auto _ : state) {
+    total = {};
+    DrawPacket bound = {~0u, ~0u, ~0u, ~0u};
+    for (const SyntheticDraw &draw : draws) {
+      const DrawPacket &packet = draw.packet;
+      if (packet.root_signature != bound.root_signature) {
+        bound.root_signature = packet.root_signature;
+        bound.material = ~0u;
+        recorder.SetRootSignature(packet.root_signature);
+      }
+      if (packet.pipeline_state != bound.pipeline_state) {
+        bound.pipeline_state = packet.pipeline_state;
+        recorder.SetPipelineState(packet.pipeline_state);
+        ++total.pipeline_state_binds;
+      }
+      if (packet.material != bound.material) {
+        bound.material = packet.material;
+        recorder.BindMaterial(packet.material);
+        ++total.material_binds;
+      }
+      if (packet.geometry != bound.geometry) {
+        bound.geometry = packet.geometry;
+        recorder.BindGeometry(packet.geometry);
+        ++total.geometry_binds;
+      }
+      recorder.Draw(packet);
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+  SetBindCounters(state, total);
+}
+
+} // namespace
+
+BENCHMARK(BM_RadixSortDrawEntries)->Arg(10000)->Arg(100000)->Unit(
+    benchmark::kMicrosecond);
+BENCHMARK(BM_StableSortDrawEntries)->Arg(10000)->Arg(100000)->Unit(
+    benchmark::kMicrosecond);
+BENCHMARK(BM_SubmitSortReplay)->Arg(10000)->Arg(100000)->Unit(
+    benchmark::kMicrosecond);
+BENCHMARK(BM_ReplayInSubmissionOrder)->Arg(100000)->Unit(
+    benchmark::kMicrosecond);
@@ -0,0 +1,197 @@
+#include "SceneBvh.h"
+
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <vector>
+
+namespace {
+
+constexpr float kWorldSize = 1000.0f;
+
+constexpr float kTanHalfFov = 0.57735f;
+
+constexpr float kAspect = 16.0f / 9.0f;
+
+constexpr float kFarPlane = 300.0f;
+
+// Boxes of 1 to 8 units scattered through a kWorldSize cube, each with the
+// sphere around it.
+auto MakeObjects(size_t count) -> std::vector<BoundingVolume> {
+  std::mt19937 random(24);
+  std::uniform_real_distribution<float> position(0.0f, kWorldSize);
+  std::uniform_real_distribution<float> extent(0.5f, 4.0f);
+
+  std::vector<BoundingVolume> objects(count);
+  for (BoundingVolume &bounds : objects) {
+    float squared_radius = 0.0f;
+    for (int axis = 0; axis < 3; ++axis) {
+      bounds.center[axis] = position(random);
+      bounds.extents[axis] = extent(random);
+      squared_radius += bounds.extents[axis] * bounds.extents[axis];
+    }
+    bounds.radius = std::sqrt(squared_radius);
+  }
+  return objects;
+}
+
+void MakeBvh(const std::vector<BoundingVolume> &objects, SceneBvh &bvh) {
+  bvh.Clear();
+  for (const BoundingVolume &bounds : objects) {
+    bvh.Insert(bounds);
+  }
+  bvh.Build();
+}
+
+// A camera in the middle of the cube's front face looking into it, with a
+// 60 degree vertical field of view and a far plane kFarPlane away: about 2%
+// of the cube is in view.
+auto MakeFrustum() -> FrustumPlanes {
+  const float near_plane = 0.1f;
+  const float y_scale = 1.0f / kTanHalfFov;
+  const float z_scale = kFarPlane / (kFarPlane - near_plane);
+  const float eye[3] = {kWorldSize * 0.5f, kWorldSize * 0.5f, -1.0f};
+
+  // A translation by -eye times a left-handed perspective, row-major for
+  // row vectors.
+  const float view_projection[16] = {
+      y_scale / kAspect, 0.0f, 0.0f, 0.0f,
+      0.0f, y_scale, 0.0f, 0.0f,
+      0.0f, 0.0f, z_scale, 1.0f,
+      -eye[0] * y_scale / kAspect, -eye[1] * y_scale,
+      -eye[2] * z_scale - near_plane * z_scale, -eye[2]};
+  FrustumPlanes frustum;
+  ExtractFrustumPlanes(view_projection, frustum);
+  return frustum;
+}
+
+// Rays from the same camera through random points of the screen, as a
+// mouse pick would cast them.
+auto MakeRays(size_t count) -> std::vector<Ray> {
+  std::mt19937 random(7);
+  std::uniform_real_distribution<float> screen(-1.0f, 1.0f);
+  std::vector<Ray> rays(count);
+  for (Ray &ray : rays) {
+    ray.origin[0] = kWorldSize * 0.5f;
+    ray.origin[1] = kWorldSize * 0.5f;
+    ray.origin[2] = -1.0f;
+    ray.direction[0] = screen(random) * kTanHalfFov * kAspect;
+    ray.direction[1] = screen(random) * kTanHalfFov;
+    ray.direction[2] = 1.0f;
+  }
+  return rays;
+}
+
+void BM_Build(benchmark::State &state) {
+  const auto objects = MakeObjects(state.range(0));
+  SceneBvh bvh;
+  for (auto _ : state) {
+    MakeBvh(objects, bvh);
+    benchmark::DoNotOptimize(bvh.GetNodeCount());
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+  state.counters["nodes"] = static_cast<double>(bvh.GetNodeCount());
+  state.counters["sah_cost"] = bvh.GetSahCost();
+}
+
+// range(1) objects move two units and back on alternate frames, so the
+// tree never drifts from the one Build made. Timed per frame: SetBounds on
+// each mover, then Refit.
+void BM_Refit(benchmark::State &state) {
+  const auto objects = MakeObjects(state.range(0));
+  SceneBvh bvh;
+  MakeBvh(objects, bvh);
+
+  std::vector<uint32_t> movers(objects.size());
+  for (uint32_t i = 0; i < movers.size(); ++i) {
+    movers[i] = i;
+  }
+  std::shuffle(movers.begin(), movers.end(), std::mt19937(3));
+  movers.resize(static_cast<size_t>(state.range(1)));
+
+  float offset = 2.0f;
+  for (auto _ : state) {
+    for (const uint32_t object : movers) {
+      BoundingVolume bounds = objects[object];
+      bounds.center[0] += offset;
+      bounds.center[2] -= offset;
+      bvh.SetBounds(object, bounds);
+    }
+    bvh.Refit();
+    offset = offset > 0.0f ? 0.0f : 2.0f;
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(1));
+  state.counters["sah_cost"] = bvh.GetSahCost();
+}
+
+void BM_QueryFrustum(benchmark::State &state) {
+  const auto objects = MakeObjects(state.range(0));
+  SceneBvh bvh;
+  MakeBvh(objects, bvh);
+  const FrustumPlanes frustum = MakeFrustum();
+
+  std::vector<uint32_t> visible;
+  for (auto _ : state) {
+    visible.clear();
+    bvh.QueryFrustum(frustum, visible);
+    benchmark::DoNotOptimize(visible.data());
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+  state.counters["visible"] = static_cast<double>(visible.size());
+}
+
+// The flat cull the query replaces: every bound tested, eight at a time.
+void BM_FlatCull(benchmark::State &state) {
+  const auto objects = MakeObjects(state.range(0));
+  CullingBounds bounds;
+  bounds.Reserve(objects.size());
+  for (const BoundingVolume &object : objects) {
+    bounds.Add(object);
+  }
+  const FrustumPlanes frustum = MakeFrustum();
+
+  std::vector<uint8_t> visible(objects.size());
+  size_t visible_count = 0;
+  for (auto _ : state) {
+    visible_count =
+        CullBounds(frustum, bounds, 0, bounds.GetCount(), visible.data());
+    benchmark::DoNotOptimize(visible.data());
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+  state.counters["visible"] = static_cast<double>(visible_count);
+  state.SetLabel(IsAvxCullingSupported() ? "avx" : "sse");
+}
+
+void BM_RayCast(benchmark::State &state) {
+  const auto objects = MakeObjects(state.range(0));
+  SceneBvh bvh;
+  MakeBvh(objects, bvh);
+  const auto rays = MakeRays(1024);
+
+  size_t hits = 0;
+  for (auto _ : state) {
+    hits = 0;
+    for (const Ray &ray : rays) {
+      RayHit hit;
+      hits += bvh.RayCast(ray, hit) ? 1 : 0;
+      benchmark::DoNotOptimize(hit);
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * rays.size());
+  state.counters["hit_rate"] =
+      static_cast<double>(hits) / static_cast<double>(rays.size());
+}
+
+} // namespace
+
+BENCHMARK(BM_Build)->Arg(100000)->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_Refit)
+    ->Args({100000, 1000})
+    ->Args({100000, 10000})
+    ->Args({100000, 100000})
+    ->Unit(benchmark::kMicrosecond);
+BENCHMARK(BM_QueryFrustum)->Arg(100000)->Unit(benchmark::kMicrosecond);
+BENCHMARK(BM_FlatCull)->Arg(100000)->Unit(benchmark::kMicrosecond);
+BENCHMARK(BM_RayCast)->Arg(100000)->Unit(benchmark::kMicrosecond);
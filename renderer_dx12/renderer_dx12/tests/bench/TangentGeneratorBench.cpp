@@ -0,0 +1,60 @@
+#include "TangentGenerator.h"
+
+#include <benchmark/benchmark.h>
+
+#include <cmath>
+#include <vector>
+
+#include "MeshFile.h"
+
+using namespace ResourceLoader;
+
+namespace {
+
+// A side x side grid of quads over a wavy surface.
+void BuildGrid(int side, std::vector<MeshSourceVertex> &vertices,
+               std::vector<uint32_t> &indices) {
+  for (int row = 0; row <= side; ++row) {
+    for (int column = 0; column <= side; ++column) {
+      const float x = static_cast<float>(column) / side;
+      const float y = static_cast<float>(row) / side;
+      vertices.push_back({x, y, 0.1f * sinf(9.0f * x) * cosf(7.0f * y), x,
+                          1.0f - y, 0.0f, 0.0f, 1.0f});
+    }
+  }
+  for (int row = 0; row < side; ++row) {
+    for (int column = 0; column < side; ++column) {
+      const uint32_t corner = row * (side + 1) + column;
+      for (uint32_t index :
+           {corner, corner + side + 1, corner + 1, corner + 1,
+            corner + side + 1, corner + side + 2}) {
+        indices.push_back(index);
+      }
+    }
+  }
+}
+
+// Built twice: TangentGeneratorBench with the SSE path and
+// TangentGeneratorScalarBench with TANGENT_GENERATOR_USE_SSE=0.
+void BM_Generate(benchmark::State &state) {
+  std::vector<MeshSourceVertex> vertices;
+  std::vector<uint32_t> indices;
+  BuildGrid(static_cast<int>(state.range(0)), vertices, indices);
+
+  TangentGenerator generator;
+  generator.SetSourceVertices(vertices.data(),
+                              static_cast<uint32_t>(vertices.size()),
+                              sizeof(MeshSourceVertex));
+  for (auto _ : state) {
+    generator.Generate(indices.data(), indices.size());
+    benchmark::DoNotOptimize(generator.GetTangentX());
+  }
+  state.SetItemsProcessed(state.iterations() *
+                          static_cast<int64_t>(indices.size() / 3));
+}
+
+} // namespace
+
+// 2k, 20k (past the threshold, so threaded) and 500k triangles.
+BENCHMARK(BM_Generate)->Arg(32)->Arg(100)->Arg(500)->Unit(
+    benchmark::kMicrosecond);
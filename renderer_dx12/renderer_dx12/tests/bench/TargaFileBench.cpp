@@ -0,0 +1,128 @@
+#include "TargaFile.h"
+
+#include <benchmark/benchmark.h>
+
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <vector>
+
+#include "TargaEncoder.h"
+
+using namespace ResourceLoader;
+using namespace TargaEncoder;
+
+namespace {
+
+// Every variant but kTopDown is stored bottom row first, like the shipped
+// files, and so is flipped while decoding.
+enum class Variant {
+  kFile,    // data/pbr/pbr_albedo.tga as shipped, 32-bit
+  kTopDown, // the same pixels marked top row first
+  kBgr,     // 24-bit
+  kRle,     // run-length encoded 32-bit
+};
+
+const char *const kVariantNames[] = {"32-bit", "32-bit top-down", "24-bit",
+                                     "RLE 32-bit"};
+
+auto ReadAlbedo() -> std::vector<uint8_t> {
+  std::ifstream file(std::filesystem::path(RENDERER_DATA_DIR) /
+                         "pbr/pbr_albedo.tga",
+                     std::ios::binary);
+  return std::vector<uint8_t>(std::istreambuf_iterator<char>(file),
+                              std::istreambuf_iterator<char>());
+}
+
+auto BuildImage(Variant variant) -> std::vector<uint8_t> {
+  std::vector<uint8_t> file = ReadAlbedo();
+  if (file.size() <= kHeaderBytes || variant == Variant::kFile) {
+    return file;
+  }
+
+  // The shipped file has no id or color map, so pixels follow the header;
+  // the footer after them is dropped.
+  const uint8_t *pixels = file.data() + kHeaderBytes;
+  const uint32_t width = file[12] | file[13] << 8;
+  const uint32_t height = file[14] | file[15] << 8;
+  if (kHeaderBytes + size_t{width} * height * 4 > file.size()) {
+    return {};
+  }
+
+  switch (variant) {
+  case Variant::kTopDown:
+    return EncodeImage(pixels, width, height, 4, false, true);
+  case Variant::kBgr:
+    return EncodeImage(pixels, width, height, 3, false, false);
+  case Variant::kRle:
+    return EncodeImage(pixels, width, height, 4, true, false);
+  default:
+    return file;
+  }
+}
+
+// The pre-TargaFile path: copy the pixels out, then swizzle and flip into a
+// second buffer one byte at a time. Only handles 32-bit images.
+void BM_DecodeByteLoop(benchmark::State &state) {
+  const std::vector<uint8_t> image =
+      BuildImage(static_cast<Variant>(state.range(0)));
+  const uint32_t width = image[12] | image[13] << 8;
+  const uint32_t height = image[14] | image[15] << 8;
+  const bool flip_vertical = (image[17] & kTopDownBit) == 0;
+  const size_t image_size = static_cast<size_t>(width) * height * 4;
+
+  std::vector<uint8_t> data(image_size);
+  for (auto _ : state) {
+    std::vector<uint8_t> raw_data(image.begin() + kHeaderBytes,
+                                  image.begin() + kHeaderBytes + image_size);
+    for (uint32_t y = 0; y < height; ++y) {
+      const uint32_t src_row = flip_vertical ? (height - 1 - y) : y;
+      const uint8_t *src = raw_data.data() + size_t{src_row} * width * 4;
+      uint8_t *dst = data.data() + size_t{y} * width * 4;
+      for (uint32_t x = 0; x < width; ++x) {
+        dst[0] = src[2];
+        dst[1] = src[1];
+        dst[2] = src[0];
+        dst[3] = src[3];
+        dst += 4;
+        src += 4;
+      }
+    }
+    benchmark::DoNotOptimize(data.data());
+  }
+  state.SetBytesProcessed(state.iterations() *
+                          static_cast<int64_t>(image_size));
+  state.SetLabel(kVariantNames[state.range(0)]);
+}
+
+// Built twice: TargaFileBench dispatches to SSSE3/AVX2 and
+// TargaFileScalarBench is compiled with TARGA_FILE_USE_SIMD=0. Throughput is
+// in decoded RGBA bytes.
+void BM_DecodeTargaImage(benchmark::State &state) {
+  const std::vector<uint8_t> image =
+      BuildImage(static_cast<Variant>(state.range(0)));
+  TargaInfo info;
+  if (!ReadTargaHeader(image.data(), image.size(), info)) {
+    state.SkipWithError("cannot read the header");
+    return;
+  }
+  const size_t row_pitch = static_cast<size_t>(info.width) * 4;
+  std::vector<uint8_t> texels(row_pitch * info.height);
+  for (auto _ : state) {
+    if (!DecodeTargaImage(image.data(), image.size(), info, texels.data(),
+                          row_pitch)) {
+      state.SkipWithError("cannot decode the image");
+      return;
+    }
+    benchmark::DoNotOptimize(texels.data());
+  }
+  state.SetBytesProcessed(state.iterations() *
+                          static_cast<int64_t>(texels.size()));
+  state.SetLabel(kVariantNames[state.range(0)]);
+}
+
+} // namespace
+
+BENCHMARK(BM_DecodeByteLoop)->DenseRange(0, 1)->Unit(benchmark::kMicrosecond);
+BENCHMARK(BM_DecodeTargaImage)->DenseRange(0, 3)->Unit(
+    benchmark::kMicrosecond);
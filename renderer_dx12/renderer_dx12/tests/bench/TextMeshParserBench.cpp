@@ -0,0 +1,86 @@
+#include "TextMeshParser.h"
+
+#include <benchmark/benchmark.h>
+
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "MeshFile.h"
+
+using namespace ResourceLoader;
+
+namespace {
+
+const char *const kMeshes[] = {"pbr/sphere.txt", "pbr/plane01.txt"};
+
+// The whole file in memory, so only parsing is measured.
+auto ReadText(int64_t mesh) -> const std::string & {
+  static std::string texts[std::size(kMeshes)];
+  if (texts[mesh].empty()) {
+    std::ifstream file(std::filesystem::path(RENDERER_DATA_DIR) / kMeshes[mesh],
+                       std::ios::binary);
+    texts[mesh].assign(std::istreambuf_iterator<char>(file),
+                       std::istreambuf_iterator<char>());
+  }
+  return texts[mesh];
+}
+
+// Locale-aware extraction, as the model classes parsed before
+// TextMeshParser.
+void BM_ParseWithStreams(benchmark::State &state) {
+  const std::string &text = ReadText(state.range(0));
+  std::vector<MeshSourceVertex> vertices;
+  for (auto _ : state) {
+    std::istringstream stream(text);
+    stream.ignore(text.size(), ':');
+    uint32_t vertex_count = 0;
+    stream >> vertex_count;
+    stream.ignore(text.size(), ':');
+    vertices.resize(vertex_count);
+    for (MeshSourceVertex &vertex : vertices) {
+      stream >> vertex.x >> vertex.y >> vertex.z >> vertex.tu >> vertex.tv >>
+          vertex.nx >> vertex.ny >> vertex.nz;
+    }
+    if (stream.fail()) {
+      state.SkipWithError("cannot parse the mesh");
+      return;
+    }
+    benchmark::DoNotOptimize(vertices.data());
+  }
+  state.SetBytesProcessed(state.iterations() *
+                          static_cast<int64_t>(text.size()));
+  state.SetLabel(kMeshes[state.range(0)]);
+}
+
+void BM_TextMeshParser(benchmark::State &state) {
+  const std::string &text = ReadText(state.range(0));
+  std::vector<MeshSourceVertex> vertices;
+  for (auto _ : state) {
+    TextMeshParser parser(text.data(), text.size());
+    uint32_t vertex_count = 0;
+    if (!parser.ParseHeader(vertex_count)) {
+      state.SkipWithError("cannot parse the mesh");
+      return;
+    }
+    vertices.resize(vertex_count);
+    if (!parser.ParseVertices(vertices.data(), sizeof(MeshSourceVertex),
+                              vertex_count)) {
+      state.SkipWithError("cannot parse the mesh");
+      return;
+    }
+    benchmark::DoNotOptimize(vertices.data());
+  }
+  state.SetBytesProcessed(state.iterations() *
+                          static_cast<int64_t>(text.size()));
+  state.SetLabel(kMeshes[state.range(0)]);
+}
+
+} // namespace
+
+BENCHMARK(BM_ParseWithStreams)->DenseRange(0, 1)->Unit(
+    benchmark::kMicrosecond);
+BENCHMARK(BM_TextMeshParser)->DenseRange(0, 1)->Unit(benchmark::kMicrosecond);